@@ -3,30 +3,124 @@
 
 #include <core/Log.hpp>
 
+#include <algorithm>
+#include <array>
 #include <format>
+#include <future>
+#include <utility>
 
 namespace mychat
 {
 
-AgentLoop::AgentLoop(LlmEngine& engine, ChatSession& session, ServerManager& servers, AgentConfig config):
-    _engine(engine), _session(session), _servers(servers), _config(std::move(config))
+namespace
+{
+
+    /// @brief Room left in the truncation budget for the omission note.
+    constexpr auto OmissionNoteSize = size_t { 48 };
+
+    /// @brief Instructions for summarizing a tool result that is compacted.
+    constexpr auto SummaryPrompt = std::string_view {
+        "Summarize the following tool output in a few sentences for later reference. Keep the names, "
+        "numbers, paths and error messages that may matter and leave out everything else. Reply with "
+        "the summary only."
+    };
+
+    auto isUtf8Continuation(char c) -> bool
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    /// @brief Returns the name of the tool whose call the result at @p index answers.
+    auto toolNameOf(std::span<const ChatMessage> messages, size_t index) -> std::string
+    {
+        auto const& callId = messages[index].toolCallId;
+        for (auto i = index; i-- > 0;)
+            for (auto const& call: messages[i].toolCalls)
+                if (call.id == callId)
+                    return call.name;
+        return "tool";
+    }
+
+} // namespace
+
+auto truncateToolOutput(std::string text, size_t maxBytes) -> std::string
+{
+    if (maxBytes == 0 || text.size() <= maxBytes)
+        return text;
+
+    auto const keep = maxBytes > OmissionNoteSize ? maxBytes - OmissionNoteSize : 0;
+    auto headEnd = keep * 3 / 4;
+    while (headEnd > 0 && isUtf8Continuation(text[headEnd]))
+        --headEnd;
+    auto tailStart = text.size() - (keep - keep * 3 / 4);
+    while (tailStart < text.size() && isUtf8Continuation(text[tailStart]))
+        ++tailStart;
+
+    auto const note = std::format("\n[... {} bytes omitted ...]\n", tailStart - headEnd);
+    text.replace(headEnd, tailStart - headEnd, note);
+    return text;
+}
+
+AgentLoop::AgentLoop(InferenceEngine& engine,
+                     ChatSession& session,
+                     ServerManager& servers,
+                     AgentConfig config):
+    _engine(&engine),
+    _session(session),
+    _servers(servers),
+    _config(std::move(config)),
+    _toolIndex([this](std::string_view text) { return (_toolEngine ? *_toolEngine : *_engine).embed(text); }),
+    _toolCache(static_cast<size_t>(std::max(1, _config.toolCacheCapacity))),
+    _toolWorkers(static_cast<size_t>(std::max(1, _config.maxParallelToolCalls)))
 {
 }
 
-auto AgentLoop::processMessage(std::string_view userMessage, AgentStreamCallback streamCb)
-    -> Result<std::string>
+auto AgentLoop::processMessage(std::string_view userMessage,
+                               AgentStreamCallback streamCb,
+                               std::stop_token stopToken) -> Result<std::string>
 {
-    _session.addUserMessage(std::string(userMessage));
+    _turnMetrics = {};
+    auto const notes = retrieveMemory(userMessage);
+    _turnMetrics.memoryNotes = static_cast<int>(notes.size());
+    _session.addUserMessage(withMemoryNotes(notes, userMessage));
+    auto const cacheHitsBefore = _toolCache.hits();
 
-    auto tools = _servers.allTools();
+    auto tools = selectTools(userMessage);
+    compactHistory(tools, stopToken);
 
     for (auto step = 0; step < _config.maxToolSteps; ++step)
     {
         log::debug("Agent step {}/{}", step + 1, _config.maxToolSteps);
 
-        auto result = _engine.generate(_session.messages(), tools, _config.sampler, streamCb);
+        // Tool calls are dispatched as soon as the engine has parsed them, so the first call
+        // runs while the model is still writing the next. Independent calls run concurrently on
+        // the worker pool; results are collected in order of appearance, so the history does
+        // not depend on timing.
+        auto dispatched = std::vector<std::future<ToolResult>> {};
+        auto const dispatch = [&](const ToolCall& call) {
+            dispatched.push_back(_toolWorkers.submit([this, call, stopToken] {
+                if (stopToken.stop_requested())
+                    return ToolResult { .callId = call.id, .content = "Error: cancelled", .isError = true };
+                return executeToolCall(call, stopToken);
+            }));
+        };
+
+        if (auto fitted = fitContext(tools); !fitted)
+            return std::unexpected(fitted.error());
+
+        auto result =
+            _engine->generate(_session.messages(), tools, _config.sampler, streamCb, dispatch, stopToken);
         if (!result)
             return std::unexpected(result.error());
+        recordStep(result->metrics);
+
+        if (result->cancelled || (result->hasToolCalls() && stopToken.stop_requested()))
+        {
+            log::info("Generation cancelled");
+            if (!result->text.empty())
+                _session.addAssistantMessage(result->text);
+            return result->text;
+        }
 
         if (!result->hasToolCalls())
         {
@@ -34,59 +128,358 @@ auto AgentLoop::processMessage(std::string_view userMessage, AgentStreamCallback
             return result->text;
         }
 
-        // Execute tool calls
+        // Collect the results of the calls dispatched during generation
         log::info("LLM requested {} tool call(s)", result->toolCalls.size());
         _session.addAssistantMessage(result->text, result->toolCalls);
 
-        auto toolResults = executeToolCalls(result->toolCalls);
-        for (auto& toolResult: toolResults)
-            _session.addToolResult(toolResult.callId, toolResult.content, toolResult.isError);
+        for (auto i = size_t { 0 }; i < result->toolCalls.size(); ++i)
+        {
+            auto toolResult = i < dispatched.size() ? dispatched[i].get()
+                                                    : executeToolCall(result->toolCalls[i], stopToken);
+            if (_toolResultCallback)
+                _toolResultCallback(result->toolCalls[i], toolResult);
+
+            auto const fullSize = toolResult.content.size();
+            auto content = truncateToolOutput(std::move(toolResult.content), _config.maxToolResultBytes);
+            if (content.size() < fullSize)
+                log::info(
+                    "Shortened result of {} from {} to {} bytes", toolResult.callId, fullSize, content.size());
+            _session.addToolResult(std::move(toolResult.callId), std::move(content), toolResult.isError);
+        }
+        _turnMetrics.toolCalls += static_cast<int>(result->toolCalls.size());
+        _turnMetrics.toolCacheHits = static_cast<int>(_toolCache.hits() - cacheHitsBefore);
     }
 
     // Exceeded max steps — generate without tools to force a final answer
     log::warning("Agent reached max tool steps ({}), forcing final response", _config.maxToolSteps);
 
     auto const emptyTools = std::span<const ToolDefinition> {};
-    auto finalResult = _engine.generate(_session.messages(), emptyTools, _config.sampler, streamCb);
+    if (auto fitted = fitContext(emptyTools); !fitted)
+        return std::unexpected(fitted.error());
+
+    auto finalResult =
+        _engine->generate(_session.messages(), emptyTools, _config.sampler, streamCb, {}, stopToken);
     if (!finalResult)
         return std::unexpected(finalResult.error());
+    recordStep(finalResult->metrics);
 
     _session.addAssistantMessage(finalResult->text);
     return finalResult->text;
 }
 
+auto AgentLoop::prefill(std::string_view draft, std::stop_token stopToken) -> VoidResult
+{
+    auto const tools = selectTools(draft);
+    auto messages = _session.messages();
+    messages.push_back(ChatMessage {
+        .role = Role::User,
+        .content = withMemoryNotes(retrieveMemory(draft), draft),
+        .toolCalls = {},
+        .toolCallId = {},
+    });
+    return _engine->prefill(messages, tools, std::move(stopToken));
+}
+
+void AgentLoop::setToolResultCallback(AgentToolResultCallback callback)
+{
+    _toolResultCallback = std::move(callback);
+}
+
+void AgentLoop::setMemory(MemoryIndex* memory, std::string currentSource)
+{
+    _memory = memory;
+    _memorySource = std::move(currentSource);
+}
+
+void AgentLoop::setSampler(const SamplerConfig& sampler)
+{
+    _config.sampler = sampler;
+}
+
+void AgentLoop::setEngine(InferenceEngine& engine, std::filesystem::path toolIndexPath)
+{
+    // The token counts came from the old model's tokenizer; historyTokens() recounts them. The
+    // summary engine runs the old model, and is shared from the new one when next needed.
+    if (_engine != &engine)
+    {
+        _session.clearTokenCounts();
+        _summaryEngine.reset();
+        _summaryEngineFailed = false;
+    }
+    _engine = &engine;
+    if (!_toolEngine)
+        resetToolIndex(std::move(toolIndexPath));
+}
+
+void AgentLoop::setToolSelectionEngine(InferenceEngine& engine, std::filesystem::path toolIndexPath)
+{
+    _toolEngine = &engine;
+    resetToolIndex(std::move(toolIndexPath));
+}
+
+void AgentLoop::resetToolIndex(std::filesystem::path toolIndexPath)
+{
+    _toolIndex.clear();
+    _toolIndexLoaded = false;
+    _indexedToolsVersion.reset();
+    _selectedTools.clear();
+    _config.toolIndexPath = std::move(toolIndexPath);
+}
+
 auto AgentLoop::config() const -> const AgentConfig&
 {
     return _config;
 }
 
-auto AgentLoop::executeToolCalls(const std::vector<ToolCall>& calls) -> std::vector<ToolResult>
+auto AgentLoop::retrieveMemory(std::string_view message) -> std::vector<MemorySnippet>
 {
-    auto results = std::vector<ToolResult> {};
-    results.reserve(calls.size());
+    auto const k = static_cast<size_t>(std::max(0, _config.memorySnippets));
+    if (!_memory || k == 0 || _memory->size() == 0)
+        return {};
+
+    auto snippets = _memory->search(message, k, _memorySource);
+    if (!snippets)
+    {
+        log::warning("No notes from earlier conversations for this turn: {}", snippets.error().message);
+        return {};
+    }
+    auto const minSimilarity = _config.memoryMinSimilarity;
+    std::erase_if(*snippets, [minSimilarity](auto const& snippet) { return snippet.score < minSimilarity; });
+    log::debug("Adding {} note(s) from earlier conversations", snippets->size());
+    return std::move(*snippets);
+}
+
+void AgentLoop::compactHistory(std::span<const ToolDefinition> tools, std::stop_token stopToken)
+{
+    auto const& messages = _session.messages();
+    auto turnStarts = std::vector<size_t> {};
+    for (auto i = size_t { 0 }; i < messages.size(); ++i)
+        if (messages[i].role == Role::User)
+            turnStarts.push_back(i);
+    if (turnStarts.size() < 2)
+        return;
+
+    // Compacts up to the oldest turn in the recency window, or up to the current one when over the threshold.
+    auto end = size_t { 0 };
+    auto const recency = static_cast<size_t>(std::max(0, _config.toolResultRecencyTurns));
+    if (recency > 0 && turnStarts.size() > recency)
+        end = turnStarts[turnStarts.size() - recency];
+    if (_config.compactionTokenThreshold > 0 && historyTokens(tools) > _config.compactionTokenThreshold)
+        end = turnStarts.back();
 
-    for (const auto& call: calls)
+    auto const budget = _config.compactedToolResultBytes;
+    auto compacted = 0;
+    auto saved = size_t { 0 };
+    for (auto i = size_t { 0 }; i < end && !stopToken.stop_requested(); ++i)
     {
-        log::info("Executing tool: {} (id: {})", call.name, call.id);
+        auto const& message = messages[i];
+        if (message.role != Role::Tool || message.content.size() <= budget)
+            continue;
 
-        auto result = _servers.callTool(call.name, call.arguments);
-        if (result)
+        auto const name = toolNameOf(messages, i);
+        auto body = std::string {};
+        if (_config.summarizeToolResults)
         {
-            result->callId = call.id;
-            results.push_back(std::move(*result));
+            if (auto summary = summarizeToolResult(name, message.content, stopToken); summary)
+                body = std::move(*summary);
+            else
+                log::warning("Keeping an excerpt of {}'s result: {}", name, summary.error().message);
         }
+        auto const what = std::format("[{} bytes of {} output, compacted]\n", message.content.size(), name);
+        auto content = truncateToolOutput(what + (body.empty() ? message.content : body), budget);
+        saved += message.content.size() - content.size();
+        _session.setMessageContent(i, std::move(content));
+        ++compacted;
+    }
+    if (compacted > 0)
+        log::info("Compacted {} old tool result(s), {} bytes less to decode", compacted, saved);
+}
+
+auto AgentLoop::historyTokens(std::span<const ToolDefinition> tools) -> size_t
+{
+    if (auto const known = _session.tokenCount())
+        return *known;
+    auto const count = _engine->promptTokenCount(_session.messages(), tools);
+    if (!count)
+        return 0;
+    _session.setTokenCounts(_engine->messageTokenCounts());
+    return _session.tokenCount().value_or(*count);
+}
+
+auto AgentLoop::summarizeToolResult(std::string_view toolName,
+                                    std::string_view output,
+                                    std::stop_token stopToken) -> Result<std::string>
+{
+    auto const messages = std::array {
+        ChatMessage {
+            .role = Role::System,
+            .content = std::string(SummaryPrompt),
+            .toolCalls = {},
+            .toolCallId = {},
+        },
+        ChatMessage {
+            .role = Role::User,
+            .content = std::format("Output of {}:\n{}", toolName, output),
+            .toolCalls = {},
+            .toolCallId = {},
+        },
+    };
+    auto summary = summaryEngine().generate(messages, {}, _config.sampler, {}, {}, std::move(stopToken));
+    if (!summary)
+        return std::unexpected(summary.error());
+    _turnMetrics.summaryTotal += summary->metrics;
+    ++_turnMetrics.summaries;
+    return std::move(summary->text);
+}
+
+auto AgentLoop::summaryEngine() -> InferenceEngine&
+{
+    if (!_summaryEngine && !_summaryEngineFailed)
+    {
+        if (auto shared = _engine->shareEngine())
+            _summaryEngine = std::move(*shared);
         else
         {
-            log::error("Tool call failed: {}", result.error().message);
-            results.push_back(ToolResult {
-                .callId = call.id,
-                .content = std::format("Error: {}", result.error().message),
-                .isError = true,
-            });
+            _summaryEngineFailed = true;
+            log::debug("Summarizing tool results on the conversation's engine: {}", shared.error().message);
         }
     }
+    return _summaryEngine ? *_summaryEngine : *_engine;
+}
+
+auto AgentLoop::fitContext(std::span<const ToolDefinition> tools) -> VoidResult
+{
+    auto const policy = _session.overflowPolicy();
+    _engine->setContextOverflowPolicy(policy);
+    if (policy != ContextOverflowPolicy::EvictHistory)
+        return {};
+
+    auto const budget = _engine->contextBudget();
+    auto evicted = 0;
+
+    // Evicts by the per-message counts first, so the prompt is not re-tokenized for every turn.
+    auto const total = _engine->promptTokenCount(_session.messages(), tools);
+    if (!total)
+        return std::unexpected(total.error());
+    if (*total <= budget)
+        return {};
+    _session.setTokenCounts(_engine->messageTokenCounts());
+    if (auto const history = _session.tokenCount(); history && *history <= *total)
+    {
+        auto const overhead = *total - *history; // The tools and the generation prompt.
+        while (overhead + _session.tokenCount().value_or(0) > budget && _session.evictOldestTurn())
+            ++evicted;
+    }
+
+    // Then verifies the estimate, as a template may render messages differently at other positions.
+    while (true)
+    {
+        auto count = _engine->promptTokenCount(_session.messages(), tools);
+        if (!count)
+            return std::unexpected(count.error());
+        if (*count <= budget || !_session.evictOldestTurn())
+            break;
+        ++evicted;
+    }
+    if (evicted > 0)
+        log::info("Evicted {} old turn(s) to fit the context window", evicted);
+    return {};
+}
+
+auto AgentLoop::selectTools(std::string_view userMessage) -> std::span<const ToolDefinition>
+{
+    _tools = _servers.toolSnapshot();
+    auto const& tools = _tools->tools;
+    auto const k = static_cast<size_t>(std::max(0, _config.toolRetrievalTopK));
+    if (k == 0 || tools.size() <= k)
+        return tools;
+
+    auto const& indexPath = _config.toolIndexPath;
+    if (!std::exchange(_toolIndexLoaded, true) && !indexPath.empty() && std::filesystem::exists(indexPath))
+    {
+        if (auto const loaded = _toolIndex.load(indexPath); !loaded)
+            log::warning("Ignoring tool index: {}", loaded.error().message);
+    }
+
+    // The index only needs to learn about new tools when the tool set changed.
+    if (_indexedToolsVersion != _tools->version)
+    {
+        auto const added = _toolIndex.update(tools);
+        if (!added)
+        {
+            log::warning("Tool retrieval disabled for this turn: {}", added.error().message);
+            return tools;
+        }
+        _indexedToolsVersion = _tools->version;
+        if (*added > 0 && !indexPath.empty())
+        {
+            if (auto const saved = _toolIndex.save(indexPath); !saved)
+                log::warning("{}", saved.error().message);
+        }
+    }
+
+    auto selected = _toolIndex.select(tools, userMessage, k);
+    if (!selected)
+    {
+        log::warning("Tool retrieval disabled for this turn: {}", selected.error().message);
+        return tools;
+    }
+    log::debug("Offering {} of {} tools", selected->size(), tools.size());
+    _selectedTools = std::move(*selected);
+    return _selectedTools;
+}
+
+auto AgentLoop::lastTurnMetrics() const -> const TurnMetrics&
+{
+    return _turnMetrics;
+}
+
+void AgentLoop::recordStep(const GenerateMetrics& metrics)
+{
+    _turnMetrics.total += metrics;
+    ++_turnMetrics.steps;
+
+    auto const& total = _turnMetrics.total;
+    log::debug("Agent step {}: {} prompt tokens ({} reused), {} generated; turn total {} tokens",
+               _turnMetrics.steps,
+               metrics.promptTokens,
+               metrics.reusedTokens,
+               metrics.generatedTokens,
+               total.totalTokens());
+}
+
+auto AgentLoop::executeToolCall(const ToolCall& call, std::stop_token stopToken) -> ToolResult
+{
+    auto const policy = _servers.cachePolicy(call.name);
+    auto const cacheKey =
+        policy ? ToolResultCache::makeKey(policy->server, call.name, call.arguments) : std::string {};
+    if (policy)
+    {
+        if (auto cached = _toolCache.lookup(cacheKey))
+        {
+            log::info("Tool result cache hit: {} (id: {})", call.name, call.id);
+            cached->callId = call.id;
+            return std::move(*cached);
+        }
+    }
+
+    log::info("Executing tool: {} (id: {})", call.name, call.id);
+
+    auto result = _servers.callTool(call.name, call.arguments, std::move(stopToken));
+    if (!result)
+    {
+        log::error("Tool call failed: {}", result.error().message);
+        return ToolResult {
+            .callId = call.id,
+            .content = std::format("Error: {}", result.error().message),
+            .isError = true,
+        };
+    }
 
-    return results;
+    result->callId = call.id;
+    if (policy)
+        _toolCache.store(cacheKey, *result, policy->ttl);
+    return std::move(*result);
 }
 
 } // namespace mychat
@@ -4,12 +4,23 @@
 #include <core/Error.hpp>
 #include <core/Types.hpp>
 #include <llm/ChatSession.hpp>
-#include <llm/LlmEngine.hpp>
+#include <llm/InferenceEngine.hpp>
 #include <llm/Sampler.hpp>
+#include <agent/MemoryIndex.hpp>
+#include <agent/ToolIndex.hpp>
+#include <agent/ToolResultCache.hpp>
+#include <core/WorkerPool.hpp>
 #include <mcp/ServerManager.hpp>
 
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <vector>
 
 namespace mychat
 {
@@ -20,11 +31,72 @@ struct AgentConfig
     int maxToolSteps = 10;
     int maxRetries = 3;
     SamplerConfig sampler;
+
+    /// Maximum number of tool calls of one step that execute at the same time.
+    int maxParallelToolCalls = 4;
+
+    /// Maximum number of memoized tool results (see McpServerConfig::cachedTools).
+    int toolCacheCapacity = 256;
+
+    /// Number of tools offered per turn, chosen by embedding similarity to the user message.
+    /// 0 offers all tools.
+    int toolRetrievalTopK = 0;
+
+    /// Where tool embeddings are persisted between runs (empty to keep them in memory only).
+    std::filesystem::path toolIndexPath;
+
+    /// Number of pieces of earlier conversations put before each user message as notes, retrieved
+    /// from the memory index (see AgentLoop::setMemory()) by embedding similarity. 0 adds none.
+    int memorySnippets = 0;
+
+    /// Minimum cosine similarity to the user message of a piece that is added as a note.
+    float memoryMinSimilarity = 0.5f;
+
+    /// Maximum size in bytes of a tool result's text in the prompt; longer text is shortened
+    /// by truncateToolOutput(). 0 passes results on in full.
+    size_t maxToolResultBytes = 16 * 1024;
+
+    /// Tool results of this many of the latest turns, the current one included, are kept as they
+    /// are; older ones are compacted to compactedToolResultBytes. 0 does not compact by age.
+    int toolResultRecencyTurns = 4;
+
+    /// Prompt tokens of the history above which the tool results of all but the current turn are
+    /// compacted. 0 does not compact by size.
+    size_t compactionTokenThreshold = 0;
+
+    /// Maximum size in bytes of a compacted tool result.
+    size_t compactedToolResultBytes = 1024;
+
+    /// Whether compacted tool results are summarized by the model instead of cut to an excerpt.
+    bool summarizeToolResults = false;
+};
+
+/// @brief Inference metrics of one agent turn, summed over all of its generation steps.
+struct TurnMetrics
+{
+    int steps = 0;                ///< Number of generate() calls made for the turn.
+    GenerateMetrics total;        ///< Accumulated metrics of all steps.
+    int toolCalls = 0;            ///< Number of tool calls executed for the turn.
+    int toolCacheHits = 0;        ///< Tool calls answered from the result cache.
+    int memoryNotes = 0;          ///< Pieces of earlier conversations added to the user message.
+    int summaries = 0;            ///< Tool results summarized for compaction; not counted in steps.
+    GenerateMetrics summaryTotal; ///< Accumulated metrics of the summaries; not part of total.
 };
 
 /// @brief Callback for streaming tokens to the user interface.
 using AgentStreamCallback = std::function<void(std::string_view token)>;
 
+/// @brief Callback receiving each tool result of a turn in full, e.g. to show its images.
+using AgentToolResultCallback = std::function<void(const ToolCall& call, const ToolResult& result)>;
+
+/// @brief Shortens tool output to about @p maxBytes for the prompt.
+///
+/// Keeps the beginning and the end, which usually carry the gist and the outcome of long
+/// output, and states how much was left out in between. Never splits a UTF-8 sequence.
+/// @param text The tool output.
+/// @param maxBytes The budget; 0 keeps @p text as is.
+[[nodiscard]] auto truncateToolOutput(std::string text, size_t maxBytes) -> std::string;
+
 /// @brief Implements a multi-step agent reasoning loop.
 ///
 /// The loop sends user messages to the LLM, executes any tool calls,
@@ -34,29 +106,141 @@ class AgentLoop
 {
   public:
     /// @brief Constructs an AgentLoop.
-    /// @param engine Reference to the LLM engine.
+    /// @param engine Reference to the LLM engine, usually an LlmEngine.
     /// @param session Reference to the chat session.
     /// @param servers Reference to the MCP server manager.
     /// @param config Agent configuration.
-    AgentLoop(LlmEngine& engine, ChatSession& session, ServerManager& servers, AgentConfig config);
+    AgentLoop(InferenceEngine& engine, ChatSession& session, ServerManager& servers, AgentConfig config);
 
     /// @brief Processes a user message through the agent loop.
     /// @param userMessage The user's input text.
     /// @param streamCb Optional callback for streaming tokens.
+    /// @param stopToken Cancels the turn: generation stops between decode steps and no
+    ///                  further tool calls are executed. The partial response is kept.
     /// @return The final assistant response text or an error.
-    [[nodiscard]] auto processMessage(std::string_view userMessage, AgentStreamCallback streamCb = {})
-        -> Result<std::string>;
+    [[nodiscard]] auto processMessage(std::string_view userMessage,
+                                      AgentStreamCallback streamCb = {},
+                                      std::stop_token stopToken = {}) -> Result<std::string>;
+
+    /// @brief Decodes the prompt the next turn would start with, were @p draft its message.
+    ///
+    /// Lets the KV cache hold the message while the user is still typing it, so that
+    /// processMessage() only decodes what changed since. The session is not touched, and the
+    /// history is neither compacted nor fitted to the context, so the prefill gains nothing
+    /// in a turn that has to do either.
+    /// @param draft The message as typed so far.
+    /// @param stopToken Aborts the prefill between batches, keeping what was decoded.
+    [[nodiscard]] auto prefill(std::string_view draft, std::stop_token stopToken = {}) -> VoidResult;
+
+    /// @brief Sets the callback receiving the tool results of each turn.
+    ///
+    /// It runs on the thread calling processMessage(), before results are shortened for the
+    /// prompt. Must not be called while a turn is running.
+    void setToolResultCallback(AgentToolResultCallback callback);
+
+    /// @brief Generates the following turns with @p engine, e.g. another model of a ModelPool.
+    ///
+    /// Unless tool retrieval has an engine of its own, the tool index is rebuilt with @p engine
+    /// and persisted at @p toolIndexPath. Must not be called while a turn is running.
+    void setEngine(InferenceEngine& engine, std::filesystem::path toolIndexPath);
+
+    /// @brief Embeds for tool retrieval (see AgentConfig::toolRetrievalTopK) with @p engine.
+    ///
+    /// A small model can then select the tools while a large one answers, and the tool index
+    /// outlives switching the answering model. The index is rebuilt with @p engine and persisted
+    /// at @p toolIndexPath. Must not be called while a turn is running.
+    void setToolSelectionEngine(InferenceEngine& engine, std::filesystem::path toolIndexPath);
+
+    /// @brief Retrieves notes for each user message from @p memory (see AgentConfig::memorySnippets).
+    ///
+    /// The notes are kept in the session as part of the user message, so the following turns
+    /// reuse its KV cache. Pieces of @p currentSource, the stored conversation the session
+    /// continues, are not retrieved. @p memory embeds on the thread running the turns and must
+    /// outlive the loop; nullptr detaches it. Must not be called while a turn is running.
+    void setMemory(MemoryIndex* memory, std::string currentSource = {});
+
+    /// @brief Replaces the sampling configuration of the following turns.
+    ///
+    /// Must not be called while a turn is running.
+    void setSampler(const SamplerConfig& sampler);
 
     /// @brief Returns the agent configuration.
     [[nodiscard]] auto config() const -> const AgentConfig&;
 
+    /// @brief Returns the metrics of the most recent (or currently running) turn.
+    ///
+    /// Must not be called concurrently with processMessage().
+    [[nodiscard]] auto lastTurnMetrics() const -> const TurnMetrics&;
+
   private:
-    LlmEngine& _engine;
+    InferenceEngine* _engine;
+    InferenceEngine* _toolEngine = nullptr; ///< Embeds for tool retrieval instead of _engine.
+    std::unique_ptr<InferenceEngine> _summaryEngine; ///< Shared from _engine on the first summary.
+    bool _summaryEngineFailed = false;               ///< _engine cannot be shared; it summarizes.
     ChatSession& _session;
     ServerManager& _servers;
     AgentConfig _config;
+    TurnMetrics _turnMetrics;
+    AgentToolResultCallback _toolResultCallback;
+    std::shared_ptr<const ToolSnapshot> _tools;   ///< The tools of the current turn.
+    std::vector<ToolDefinition> _selectedTools; ///< The retrieved subset of _tools, if any.
+    ToolIndex _toolIndex;
+    bool _toolIndexLoaded = false;
+    std::optional<std::uint64_t> _indexedToolsVersion; ///< The ToolSnapshot::version _toolIndex covers.
+    ToolResultCache _toolCache;
+    WorkerPool _toolWorkers;   ///< Executes the tool calls of a step concurrently.
+    MemoryIndex* _memory = nullptr;
+    std::string _memorySource; ///< The conversation whose pieces are not retrieved.
+
+    /// @brief Drops the tool embeddings, to be computed again by another model.
+    void resetToolIndex(std::filesystem::path toolIndexPath);
+
+    /// @brief Returns the tools to offer for @p userMessage.
+    ///
+    /// With tool retrieval enabled, only the most relevant tools are returned; if embedding
+    /// fails, all tools are. The result stays valid until the next call.
+    [[nodiscard]] auto selectTools(std::string_view userMessage) -> std::span<const ToolDefinition>;
+
+    /// @brief Returns the pieces of earlier conversations relevant to @p message, if any.
+    ///
+    /// Failures to embed are logged, and leave the turn without notes.
+    [[nodiscard]] auto retrieveMemory(std::string_view message) -> std::vector<MemorySnippet>;
+
+    /// @brief Shortens the tool results of earlier turns, see AgentConfig::toolResultRecencyTurns.
+    ///
+    /// Only turns before the current one are touched, so the session store, which saves each
+    /// turn when it ends, keeps the results in full. Compacting a result re-decodes the prompt
+    /// after it once, instead of decoding all of it on every following step. Summaries are
+    /// generated by summaryEngine(); on an engine that cannot be shared they evict the cached
+    /// conversation, and the next step decodes the whole prompt again.
+    void compactHistory(std::span<const ToolDefinition> tools, std::stop_token stopToken);
+
+    /// @brief Returns the prompt tokens of the session's messages, counting them if need be.
+    [[nodiscard]] auto historyTokens(std::span<const ToolDefinition> tools) -> size_t;
+
+    /// @brief Returns the engine that summarizes tool results: one shared from _engine, so the
+    ///        conversation stays in _engine's KV cache, or _engine itself if it cannot be shared.
+    [[nodiscard]] auto summaryEngine() -> InferenceEngine&;
+
+    /// @brief Asks the model for a short summary of the output of @p toolName.
+    [[nodiscard]] auto summarizeToolResult(std::string_view toolName,
+                                           std::string_view output,
+                                           std::stop_token stopToken) -> Result<std::string>;
+
+    /// @brief Applies the session's context overflow policy before a generation step.
+    ///
+    /// With EvictHistory, the oldest turns are dropped until the prompt, including the
+    /// description of @p tools, fits the context budget.
+    [[nodiscard]] auto fitContext(std::span<const ToolDefinition> tools) -> VoidResult;
+
+    /// @brief Adds the metrics of one generation step to the current turn.
+    void recordStep(const GenerateMetrics& metrics);
 
-    [[nodiscard]] auto executeToolCalls(const std::vector<ToolCall>& calls) -> std::vector<ToolResult>;
+    /// @brief Executes a single tool call, turning failures into an error result.
+    ///
+    /// Results of tools their server marks as cacheable are memoized per arguments.
+    /// A stop request cancels the call on the server.
+    [[nodiscard]] auto executeToolCall(const ToolCall& call, std::stop_token stopToken) -> ToolResult;
 };
 
 } // namespace mychat
@@ -0,0 +1,736 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "AgentTrace.hpp"
+
+#include <core/Hash.hpp>
+#include <core/JsonUtils.hpp>
+#include <mcp/JsonRpc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto TraceVersion = 1;
+
+    auto millisecondsSince(Clock::time_point start) -> double
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /// @brief Waits for @p duration unless stopped first; returns false if it was.
+    auto waitFor(std::chrono::duration<double, std::milli> duration, std::stop_token const& stopToken) -> bool
+    {
+        if (duration.count() > 0.0)
+        {
+            auto mutex = std::mutex {};
+            auto lock = std::unique_lock(mutex);
+            std::condition_variable_any().wait_for(lock, stopToken, duration, [] { return false; });
+        }
+        return !stopToken.stop_requested();
+    }
+
+    auto concatenated(std::span<const std::string> pieces) -> std::string
+    {
+        auto text = std::string {};
+        for (auto const& piece: pieces)
+            text += piece;
+        return text;
+    }
+
+    auto toJson(ToolCall const& call) -> nlohmann::json
+    {
+        return { { "id", call.id }, { "name", call.name }, { "arguments", call.arguments } };
+    }
+
+    auto toJson(GenerateMetrics const& metrics) -> nlohmann::json
+    {
+        return {
+            { "promptTokens", metrics.promptTokens },
+            { "reusedTokens", metrics.reusedTokens },
+            { "generatedTokens", metrics.generatedTokens },
+            { "prefillMs", metrics.prefillMs },
+            { "timeToFirstTokenMs", metrics.timeToFirstTokenMs },
+            { "decodeMs", metrics.decodeMs },
+            { "toolPreambleTokens", metrics.toolPreambleTokens },
+        };
+    }
+
+    auto metricsFromJson(nlohmann::json const& j) -> GenerateMetrics
+    {
+        auto metrics = GenerateMetrics {};
+        metrics.promptTokens = j.value("promptTokens", 0);
+        metrics.reusedTokens = j.value("reusedTokens", 0);
+        metrics.generatedTokens = j.value("generatedTokens", 0);
+        metrics.prefillMs = j.value("prefillMs", 0.0);
+        metrics.timeToFirstTokenMs = j.value("timeToFirstTokenMs", 0.0);
+        metrics.decodeMs = j.value("decodeMs", 0.0);
+        metrics.toolPreambleTokens = j.value("toolPreambleTokens", 0);
+        return metrics;
+    }
+
+    auto generationToJson(TracedGeneration const& generation) -> nlohmann::json
+    {
+        auto j = nlohmann::json {
+            { "type", "generate" },
+            { "input", generation.inputHash },
+            { "messages", generation.messageCount },
+            { "ms", generation.ms },
+        };
+        if (!generation.pieces.empty())
+            j["pieces"] = generation.pieces;
+        // The text is nearly always what was streamed, so it is only stored when it is not.
+        if (generation.result.text != concatenated(generation.pieces))
+            j["text"] = generation.result.text;
+        if (generation.result.hasToolCalls())
+        {
+            auto& calls = j["toolCalls"] = nlohmann::json::array();
+            for (auto const& call: generation.result.toolCalls)
+                calls.push_back(toJson(call));
+        }
+        if (generation.result.cancelled)
+            j["cancelled"] = true;
+        j["metrics"] = toJson(generation.result.metrics);
+        return j;
+    }
+
+    auto generationFromJson(nlohmann::json const& j) -> TracedGeneration
+    {
+        auto generation = TracedGeneration {};
+        generation.inputHash = j.value("input", std::uint64_t { 0 });
+        generation.messageCount = j.value("messages", size_t { 0 });
+        generation.ms = j.value("ms", 0.0);
+        generation.pieces = j.value("pieces", std::vector<std::string> {});
+        generation.result.text =
+            j.contains("text") ? j["text"].get<std::string>() : concatenated(generation.pieces);
+        for (auto const& call: j.value("toolCalls", nlohmann::json::array()))
+        {
+            generation.result.toolCalls.push_back(ToolCall {
+                .id = json::getStringOr(call, "id", ""),
+                .name = json::getStringOr(call, "name", ""),
+                .arguments = call.value("arguments", nlohmann::json::object()),
+            });
+        }
+        generation.result.cancelled = j.value("cancelled", false);
+        generation.result.metrics = metricsFromJson(j.value("metrics", nlohmann::json::object()));
+        return generation;
+    }
+
+    /// @brief Returns the request of a JSON-RPC message without its id, or null if it is none.
+    auto requestOf(nlohmann::json const& message) -> nlohmann::json
+    {
+        if (!message.is_object() || !message.contains("method") || !message.contains("id"))
+            return nullptr;
+        return { { "method", message["method"] }, { "params", message.value("params", nlohmann::json()) } };
+    }
+
+    /// @brief Wraps a server's transport, recording each request together with its response.
+    class RecordingTransport: public Transport
+    {
+      public:
+        RecordingTransport(std::unique_ptr<Transport> transport, std::string server, TraceRecorder& recorder):
+            _transport(std::move(transport)), _server(std::move(server)), _recorder(recorder)
+        {
+        }
+
+        auto send(nlohmann::json const& message) -> VoidResult override
+        {
+            noteRequests(message);
+            return _transport->send(message);
+        }
+
+        auto sendBatch(std::span<const nlohmann::json> messages) -> VoidResult override
+        {
+            for (auto const& message: messages)
+                noteRequests(message);
+            return _transport->sendBatch(messages);
+        }
+
+        auto receive() -> Result<nlohmann::json> override
+        {
+            auto message = _transport->receive();
+            if (message)
+                noteResponses(*message);
+            return message;
+        }
+
+        auto receiveText() -> Result<std::string> override
+        {
+            auto text = _transport->receiveText();
+            if (text)
+                noteResponses(nlohmann::json::parse(*text, nullptr, false));
+            return text;
+        }
+
+        void close() override { _transport->close(); }
+
+        [[nodiscard]] auto isConnected() const -> bool override { return _transport->isConnected(); }
+
+      private:
+        struct Pending
+        {
+            nlohmann::json request;
+            Clock::time_point sent;
+        };
+
+        void noteRequests(nlohmann::json const& message)
+        {
+            if (message.is_array())
+            {
+                for (auto const& entry: message)
+                    noteRequests(entry);
+                return;
+            }
+            auto request = requestOf(message);
+            if (request.is_null())
+                return;
+            auto const lock = std::lock_guard(_mutex);
+            _pending.insert_or_assign(message["id"].dump(), Pending { std::move(request), Clock::now() });
+        }
+
+        void noteResponses(nlohmann::json const& message)
+        {
+            if (message.is_array())
+            {
+                for (auto const& entry: message)
+                    noteResponses(entry);
+                return;
+            }
+            if (!message.is_object() || message.contains("method") || !message.contains("id"))
+                return;
+
+            auto pending = std::optional<Pending> {};
+            {
+                auto const lock = std::lock_guard(_mutex);
+                auto const it = _pending.find(message["id"].dump());
+                if (it == _pending.end())
+                    return;
+                pending = std::move(it->second);
+                _pending.erase(it);
+            }
+            auto response = message;
+            response.erase("id");
+            response.erase("jsonrpc");
+            _recorder.addExchange(TracedExchange {
+                .server = _server,
+                .request = std::move(pending->request),
+                .response = std::move(response),
+                .ms = millisecondsSince(pending->sent),
+            });
+        }
+
+        std::unique_ptr<Transport> _transport;
+        std::string _server;
+        TraceRecorder& _recorder;
+        std::mutex _mutex; ///< Guards _pending.
+        std::unordered_map<std::string, Pending> _pending; ///< Keyed by the serialized request id.
+    };
+
+    /// @brief Answers requests with the responses a trace recorded for one server.
+    class ReplayTransport: public Transport
+    {
+      public:
+        ReplayTransport(std::vector<TracedExchange const*> exchanges, ReplayTiming timing):
+            _exchanges(std::move(exchanges)), _used(_exchanges.size(), false), _timing(timing)
+        {
+        }
+
+        auto send(nlohmann::json const& message) -> VoidResult override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            if (_closed)
+                return makeError(ErrorCode::TransportError, "Transport closed");
+            if (!message.is_array())
+            {
+                if (auto request = requestOf(message); !request.is_null())
+                {
+                    auto [response, latency] = answer(message["id"], request);
+                    _queue.emplace(Clock::now() + latency, std::move(response));
+                }
+                _wakeup.notify_all();
+                return {};
+            }
+
+            // A batch is answered as a whole, once its slowest request would have been.
+            auto responses = std::vector<nlohmann::json> {};
+            auto latency = Clock::duration::zero();
+            for (auto const& entry: message)
+            {
+                if (auto request = requestOf(entry); !request.is_null())
+                {
+                    auto [response, took] = answer(entry["id"], request);
+                    responses.push_back(std::move(response));
+                    latency = std::max(latency, took);
+                }
+            }
+            if (!responses.empty())
+                _queue.emplace(Clock::now() + latency, jsonrpc::makeBatch(responses));
+            _wakeup.notify_all();
+            return {};
+        }
+
+        auto receive() -> Result<nlohmann::json> override
+        {
+            auto lock = std::unique_lock(_mutex);
+            while (!_closed)
+            {
+                if (_queue.empty())
+                {
+                    _wakeup.wait(lock);
+                    continue;
+                }
+                auto const next = _queue.begin();
+                if (next->first > Clock::now())
+                {
+                    _wakeup.wait_until(lock, next->first);
+                    continue;
+                }
+                auto message = std::move(next->second);
+                _queue.erase(next);
+                return message;
+            }
+            return makeError(ErrorCode::TransportError, "Transport closed");
+        }
+
+        void close() override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _closed = true;
+            _wakeup.notify_all();
+        }
+
+        [[nodiscard]] auto isConnected() const -> bool override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            return !_closed;
+        }
+
+      private:
+        /// @brief Returns the response to @p request and how long it took. Requires _mutex to be held.
+        auto answer(nlohmann::json const& id, nlohmann::json const& request)
+            -> std::pair<nlohmann::json, Clock::duration>
+        {
+            for (auto index = size_t { 0 }; index < _exchanges.size(); ++index)
+            {
+                auto const& exchange = *_exchanges[index];
+                if (_used[index] || exchange.request != request)
+                    continue;
+                _used[index] = true;
+                auto response = exchange.response;
+                response["jsonrpc"] = "2.0";
+                response["id"] = id;
+                auto const latency = _timing == ReplayTiming::Recorded
+                                         ? std::chrono::duration_cast<Clock::duration>(
+                                               std::chrono::duration<double, std::milli>(exchange.ms))
+                                         : Clock::duration::zero();
+                return { std::move(response), latency };
+            }
+            auto const message =
+                std::format("'{}' is not in the trace", request["method"].get<std::string>());
+            return { jsonrpc::makeErrorResponse(id, -32601, message), Clock::duration::zero() };
+        }
+
+        std::vector<TracedExchange const*> _exchanges;
+        std::vector<bool> _used;
+        ReplayTiming _timing;
+
+        mutable std::mutex _mutex; ///< Guards the members below.
+        std::condition_variable _wakeup;
+        std::multimap<Clock::time_point, nlohmann::json> _queue; ///< Responses by when they arrive.
+        bool _closed = false;
+    };
+} // namespace
+
+auto saveAgentTrace(AgentTrace const& trace, std::filesystem::path const& path) -> VoidResult
+{
+    auto out = std::ofstream(path, std::ios::trunc);
+    if (!out)
+        return makeError(ErrorCode::IoError, std::format("Cannot write agent trace {}", path.string()));
+
+    auto const writeLine = [&out](nlohmann::json const& line) { out << line.dump() << '\n'; };
+    writeLine({ { "type", "trace" }, { "version", TraceVersion }, { "contextBudget", trace.contextBudget } });
+    for (auto const& server: trace.servers)
+    {
+        writeLine({
+            { "type", "server" },
+            { "name", server.name },
+            { "cachedTools", server.cachedTools },
+            { "cacheTtlSeconds", server.cacheTtlSeconds },
+        });
+    }
+    for (auto const& generation: trace.generations)
+        writeLine(generationToJson(generation));
+    for (auto const& count: trace.tokenCounts)
+    {
+        writeLine({
+            { "type", "tokens" },
+            { "input", count.inputHash },
+            { "tokens", count.tokens },
+            { "messageTokens", count.messageTokens },
+        });
+    }
+    for (auto const& exchange: trace.exchanges)
+    {
+        writeLine({
+            { "type", "mcp" },
+            { "server", exchange.server },
+            { "request", exchange.request },
+            { "response", exchange.response },
+            { "ms", exchange.ms },
+        });
+    }
+
+    if (!out)
+        return makeError(ErrorCode::IoError, std::format("Cannot write agent trace {}", path.string()));
+    return {};
+}
+
+auto loadAgentTrace(std::filesystem::path const& path) -> Result<AgentTrace>
+{
+    auto in = std::ifstream(path);
+    if (!in)
+        return makeError(ErrorCode::IoError, std::format("Cannot read agent trace {}", path.string()));
+
+    auto trace = AgentTrace {};
+    auto line = std::string {};
+    auto lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        if (line.empty())
+            continue;
+        auto j = json::parse(line);
+        if (!j || !j->is_object())
+            return makeError(ErrorCode::ProtocolError,
+                             std::format("Malformed line {} of agent trace {}", lineNumber, path.string()));
+
+        auto const type = json::getStringOr(*j, "type", "");
+        if (type == "trace")
+        {
+            if (j->value("version", 0) != TraceVersion)
+                return makeError(ErrorCode::ProtocolError,
+                                 std::format("Unsupported agent trace version in {}", path.string()));
+            trace.contextBudget = j->value("contextBudget", size_t { 0 });
+        }
+        else if (type == "server")
+        {
+            trace.servers.push_back(TracedServer {
+                .name = json::getStringOr(*j, "name", ""),
+                .cachedTools = j->value("cachedTools", std::vector<std::string> {}),
+                .cacheTtlSeconds = j->value("cacheTtlSeconds", 300),
+            });
+        }
+        else if (type == "generate")
+            trace.generations.push_back(generationFromJson(*j));
+        else if (type == "tokens")
+        {
+            trace.tokenCounts.push_back(TracedTokenCount {
+                .inputHash = j->value("input", std::uint64_t { 0 }),
+                .tokens = j->value("tokens", size_t { 0 }),
+                .messageTokens = j->value("messageTokens", std::vector<size_t> {}),
+            });
+        }
+        else if (type == "mcp")
+        {
+            trace.exchanges.push_back(TracedExchange {
+                .server = json::getStringOr(*j, "server", ""),
+                .request = j->value("request", nlohmann::json()),
+                .response = j->value("response", nlohmann::json()),
+                .ms = j->value("ms", 0.0),
+            });
+        }
+    }
+    return trace;
+}
+
+auto traceInputHash(std::span<const ChatMessage> messages, std::span<const ToolDefinition> tools)
+    -> std::uint64_t
+{
+    auto hash = Fnv1aOffsetBasis;
+    auto const add = [&hash](std::string_view field) {
+        hash = fnv1a64(field, hash);
+        hash = fnv1a64(std::string_view("\0", 1), hash);
+    };
+    for (auto const& message: messages)
+    {
+        add(std::to_string(static_cast<int>(message.role)));
+        add(message.content);
+        for (auto const& call: message.toolCalls)
+        {
+            add(call.id);
+            add(call.name);
+            add(call.arguments.dump());
+        }
+        add(message.toolCallId);
+    }
+    for (auto const& tool: tools)
+        add(tool.name);
+    return hash;
+}
+
+void TraceRecorder::setContextBudget(size_t budget)
+{
+    auto const lock = std::lock_guard(_mutex);
+    _trace.contextBudget = budget;
+}
+
+void TraceRecorder::addServer(TracedServer server)
+{
+    auto const lock = std::lock_guard(_mutex);
+    // A server that is restarted, e.g. after idling, is still the same server.
+    if (std::ranges::find(_trace.servers, server.name, &TracedServer::name) == _trace.servers.end())
+        _trace.servers.push_back(std::move(server));
+}
+
+void TraceRecorder::addGeneration(TracedGeneration generation)
+{
+    auto const lock = std::lock_guard(_mutex);
+    _trace.generations.push_back(std::move(generation));
+}
+
+void TraceRecorder::addTokenCount(TracedTokenCount count)
+{
+    auto const lock = std::lock_guard(_mutex);
+    _trace.tokenCounts.push_back(std::move(count));
+}
+
+void TraceRecorder::addExchange(TracedExchange exchange)
+{
+    auto const lock = std::lock_guard(_mutex);
+    _trace.exchanges.push_back(std::move(exchange));
+}
+
+auto TraceRecorder::trace() const -> AgentTrace
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _trace;
+}
+
+RecordingEngine::RecordingEngine(InferenceEngine& engine, TraceRecorder& recorder):
+    _engine(engine), _recorder(recorder)
+{
+    _recorder.setContextBudget(_engine.contextBudget());
+}
+
+auto RecordingEngine::generate(std::span<const ChatMessage> messages,
+                               std::span<const ToolDefinition> tools,
+                               const SamplerConfig& sampler,
+                               StreamCallback streamCb,
+                               ToolCallCallback toolCallCb,
+                               std::stop_token stopToken) -> Result<GenerateResult>
+{
+    // Without a stream callback the engine may not stream at all, so none is put in its place.
+    auto pieces = std::vector<std::string> {};
+    auto recordingCb = StreamCallback {};
+    if (streamCb)
+        recordingCb = [&pieces, &streamCb](std::string_view piece) {
+            pieces.emplace_back(piece);
+            streamCb(piece);
+        };
+
+    auto const start = Clock::now();
+    auto result = _engine.generate(
+        messages, tools, sampler, std::move(recordingCb), std::move(toolCallCb), std::move(stopToken));
+    if (result)
+    {
+        _recorder.addGeneration(TracedGeneration {
+            .inputHash = traceInputHash(messages, tools),
+            .messageCount = messages.size(),
+            .pieces = std::move(pieces),
+            .result = *result,
+            .ms = millisecondsSince(start),
+        });
+    }
+    return result;
+}
+
+auto RecordingEngine::prefill(std::span<const ChatMessage> messages,
+                              std::span<const ToolDefinition> tools,
+                              std::stop_token stopToken) -> VoidResult
+{
+    return _engine.prefill(messages, tools, std::move(stopToken));
+}
+
+void RecordingEngine::setContextOverflowPolicy(ContextOverflowPolicy policy)
+{
+    _engine.setContextOverflowPolicy(policy);
+}
+
+auto RecordingEngine::promptTokenCount(std::span<const ChatMessage> messages,
+                                       std::span<const ToolDefinition> tools) -> Result<size_t>
+{
+    auto count = _engine.promptTokenCount(messages, tools);
+    if (count)
+    {
+        _recorder.addTokenCount(TracedTokenCount {
+            .inputHash = traceInputHash(messages, tools),
+            .tokens = *count,
+            .messageTokens = _engine.messageTokenCounts(),
+        });
+    }
+    return count;
+}
+
+auto RecordingEngine::messageTokenCounts() const -> std::vector<size_t>
+{
+    return _engine.messageTokenCounts();
+}
+
+auto RecordingEngine::contextBudget() const -> size_t
+{
+    return _engine.contextBudget();
+}
+
+auto RecordingEngine::embed(std::string_view text) -> Result<std::vector<float>>
+{
+    return _engine.embed(text);
+}
+
+auto recordingTransports(TraceRecorder& recorder) -> TransportFactory
+{
+    return [&recorder](McpServerConfig const& config,
+                       TransportOpener open) -> Result<std::unique_ptr<Transport>> {
+        auto transport = open();
+        if (!transport)
+            return std::unexpected(transport.error());
+        recorder.addServer(TracedServer {
+            .name = config.name,
+            .cachedTools = config.cachedTools,
+            .cacheTtlSeconds = config.cacheTtlSeconds,
+        });
+        return std::make_unique<RecordingTransport>(std::move(*transport), config.name, recorder);
+    };
+}
+
+ReplayEngine::ReplayEngine(AgentTrace const& trace, ReplayTiming timing): _trace(trace), _timing(timing)
+{
+}
+
+auto ReplayEngine::generate(std::span<const ChatMessage> messages,
+                            std::span<const ToolDefinition> tools,
+                            const SamplerConfig& /*sampler*/,
+                            StreamCallback streamCb,
+                            ToolCallCallback toolCallCb,
+                            std::stop_token stopToken) -> Result<GenerateResult>
+{
+    auto index = size_t { 0 };
+    {
+        auto const lock = std::lock_guard(_mutex);
+        if (_next == _trace.generations.size())
+            return makeError(ErrorCode::InferenceError, "The agent trace has no more generations");
+        index = _next++;
+    }
+    auto const& recorded = _trace.generations[index];
+    if (traceInputHash(messages, tools) != recorded.inputHash)
+        ++_divergences;
+
+    // The recorded time is spread over the pieces, so that they stream at the recorded pace.
+    auto const slices = static_cast<double>(recorded.pieces.size() + 1);
+    auto const step = std::chrono::duration<double, std::milli>(
+        _timing == ReplayTiming::Recorded ? recorded.ms / slices : 0.0);
+    auto streamed = std::string {};
+    for (auto const& piece: recorded.pieces)
+    {
+        if (!waitFor(step, stopToken))
+        {
+            auto partial = GenerateResult {};
+            partial.text = std::move(streamed);
+            partial.cancelled = true;
+            return partial;
+        }
+        if (streamCb)
+            streamCb(piece);
+        streamed += piece;
+    }
+    (void) waitFor(step, stopToken);
+
+    if (toolCallCb)
+        for (auto const& call: recorded.result.toolCalls)
+            toolCallCb(call);
+    return recorded.result;
+}
+
+auto ReplayEngine::promptTokenCount(std::span<const ChatMessage> messages,
+                                    std::span<const ToolDefinition> tools) -> Result<size_t>
+{
+    auto const hash = traceInputHash(messages, tools);
+    auto const recorded = std::ranges::find(_trace.tokenCounts, hash, &TracedTokenCount::inputHash);
+
+    auto const lock = std::lock_guard(_mutex);
+    if (recorded != _trace.tokenCounts.end())
+    {
+        _messageTokens = recorded->messageTokens;
+        return recorded->tokens;
+    }
+
+    // About four bytes per token, for prompts the recording never counted.
+    _messageTokens.clear();
+    auto bytes = size_t { 0 };
+    for (auto const& message: messages)
+        bytes += message.content.size() + 16;
+    for (auto const& tool: tools)
+        bytes += tool.name.size() + tool.description.size();
+    return bytes / 4;
+}
+
+auto ReplayEngine::messageTokenCounts() const -> std::vector<size_t>
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _messageTokens;
+}
+
+auto ReplayEngine::contextBudget() const -> size_t
+{
+    return _trace.contextBudget;
+}
+
+auto ReplayEngine::embed(std::string_view /*text*/) -> Result<std::vector<float>>
+{
+    return makeError(ErrorCode::InferenceError, "Agent traces do not record embeddings");
+}
+
+auto ReplayEngine::remaining() const -> size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _trace.generations.size() - _next;
+}
+
+auto replayTransports(AgentTrace const& trace, ReplayTiming timing) -> TransportFactory
+{
+    return [&trace, timing](McpServerConfig const& config, TransportOpener /*open*/)
+               -> Result<std::unique_ptr<Transport>> {
+        auto exchanges = std::vector<TracedExchange const*> {};
+        for (auto const& exchange: trace.exchanges)
+            if (exchange.server == config.name)
+                exchanges.push_back(&exchange);
+        return std::make_unique<ReplayTransport>(std::move(exchanges), timing);
+    };
+}
+
+auto replayServerConfigs(AgentTrace const& trace) -> std::vector<McpServerConfig>
+{
+    auto configs = std::vector<McpServerConfig> {};
+    for (auto const& server: trace.servers)
+    {
+        auto config = McpServerConfig {};
+        config.name = server.name;
+        config.command = "replay";
+        config.cachedTools = server.cachedTools;
+        config.cacheTtlSeconds = server.cacheTtlSeconds;
+        config.lazyStart = false;
+        configs.push_back(std::move(config));
+    }
+    return configs;
+}
+
+} // namespace mychat
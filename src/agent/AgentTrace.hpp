@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+#include <llm/InferenceEngine.hpp>
+#include <mcp/ServerManager.hpp>
+#include <mcp/Transport.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief One call of InferenceEngine::generate(), as recorded.
+struct TracedGeneration
+{
+    std::uint64_t inputHash = 0;     ///< Of the messages and tools, see traceInputHash().
+    size_t messageCount = 0;         ///< Of the prompt, to tell where a replay diverged.
+    std::vector<std::string> pieces; ///< The text in the pieces the stream callback received.
+    GenerateResult result;
+    double ms = 0.0; ///< How long the call took.
+};
+
+/// @brief One call of InferenceEngine::promptTokenCount(), as recorded.
+struct TracedTokenCount
+{
+    std::uint64_t inputHash = 0;
+    size_t tokens = 0;
+    std::vector<size_t> messageTokens; ///< What messageTokenCounts() returned right after.
+};
+
+/// @brief One request to an MCP server and its response, both without their id.
+struct TracedExchange
+{
+    std::string server;
+    nlohmann::json request;  ///< Its method and params.
+    nlohmann::json response; ///< Its result or error.
+    double ms = 0.0;         ///< From sending the request to receiving the response.
+};
+
+/// @brief A server the trace talked to, with what decides which of its calls are cached.
+struct TracedServer
+{
+    std::string name;
+    std::vector<std::string> cachedTools;
+    int cacheTtlSeconds = 300;
+};
+
+/// @brief What the model and the MCP servers did during a stretch of agent turns.
+///
+/// Replaying it (see ReplayEngine and replayTransports()) runs the same turns through AgentLoop
+/// again without the model or the servers, which makes the loop's own overhead measurable.
+struct AgentTrace
+{
+    size_t contextBudget = 0;
+    std::vector<TracedServer> servers;
+    std::vector<TracedGeneration> generations; ///< In the order they were generated.
+    std::vector<TracedTokenCount> tokenCounts;
+    std::vector<TracedExchange> exchanges; ///< In the order their responses arrived.
+};
+
+/// @brief Writes @p trace to @p path, one JSON object per line.
+[[nodiscard]] auto saveAgentTrace(AgentTrace const& trace, std::filesystem::path const& path) -> VoidResult;
+
+/// @brief Reads a trace written by saveAgentTrace().
+[[nodiscard]] auto loadAgentTrace(std::filesystem::path const& path) -> Result<AgentTrace>;
+
+/// @brief Returns a hash of what a prompt consists of, to match a replayed call to a recorded one.
+[[nodiscard]] auto traceInputHash(std::span<const ChatMessage> messages,
+                                  std::span<const ToolDefinition> tools) -> std::uint64_t;
+
+/// @brief Collects an AgentTrace while the engine and the transports are used concurrently.
+class TraceRecorder
+{
+  public:
+    void setContextBudget(size_t budget);
+    void addServer(TracedServer server);
+    void addGeneration(TracedGeneration generation);
+    void addTokenCount(TracedTokenCount count);
+    void addExchange(TracedExchange exchange);
+
+    /// @brief Returns what has been recorded so far.
+    [[nodiscard]] auto trace() const -> AgentTrace;
+
+  private:
+    mutable std::mutex _mutex;
+    AgentTrace _trace;
+};
+
+/// @brief Forwards to another engine, recording each generation and token count.
+class RecordingEngine: public InferenceEngine
+{
+  public:
+    RecordingEngine(InferenceEngine& engine, TraceRecorder& recorder);
+
+    [[nodiscard]] auto generate(std::span<const ChatMessage> messages,
+                                std::span<const ToolDefinition> tools,
+                                const SamplerConfig& sampler,
+                                StreamCallback streamCb = {},
+                                ToolCallCallback toolCallCb = {},
+                                std::stop_token stopToken = {}) -> Result<GenerateResult> override;
+    [[nodiscard]] auto prefill(std::span<const ChatMessage> messages,
+                               std::span<const ToolDefinition> tools = {},
+                               std::stop_token stopToken = {}) -> VoidResult override;
+    void setContextOverflowPolicy(ContextOverflowPolicy policy) override;
+    [[nodiscard]] auto promptTokenCount(std::span<const ChatMessage> messages,
+                                        std::span<const ToolDefinition> tools = {})
+        -> Result<size_t> override;
+    [[nodiscard]] auto messageTokenCounts() const -> std::vector<size_t> override;
+    [[nodiscard]] auto contextBudget() const -> size_t override;
+    [[nodiscard]] auto embed(std::string_view text) -> Result<std::vector<float>> override;
+
+  private:
+    InferenceEngine& _engine;
+    TraceRecorder& _recorder;
+};
+
+/// @brief Returns a transport factory that opens each server's transport as usual and records
+///        its requests and responses.
+///
+/// Notifications, in either direction, are passed on without being recorded.
+[[nodiscard]] auto recordingTransports(TraceRecorder& recorder) -> TransportFactory;
+
+/// @brief How a replay paces the recorded calls.
+enum class ReplayTiming : std::uint8_t
+{
+    Recorded, ///< Each call takes as long as it did when recorded.
+    Instant,  ///< Calls return at once, leaving only the agent loop's own overhead.
+};
+
+/// @brief Plays back the generations of a trace, in order, in place of the model.
+///
+/// A prompt that differs from the recorded one (see traceInputHash()) still gets the next recorded
+/// generation, but counts as a divergence: the agent loop did not do what it did when recorded.
+/// The trace must outlive the engine.
+class ReplayEngine: public InferenceEngine
+{
+  public:
+    ReplayEngine(AgentTrace const& trace, ReplayTiming timing);
+
+    [[nodiscard]] auto generate(std::span<const ChatMessage> messages,
+                                std::span<const ToolDefinition> tools,
+                                const SamplerConfig& sampler,
+                                StreamCallback streamCb = {},
+                                ToolCallCallback toolCallCb = {},
+                                std::stop_token stopToken = {}) -> Result<GenerateResult> override;
+    void setContextOverflowPolicy(ContextOverflowPolicy /*policy*/) override {}
+
+    /// @brief Returns the recorded count for the same prompt, or an estimate from its size.
+    [[nodiscard]] auto promptTokenCount(std::span<const ChatMessage> messages,
+                                        std::span<const ToolDefinition> tools = {})
+        -> Result<size_t> override;
+    [[nodiscard]] auto messageTokenCounts() const -> std::vector<size_t> override;
+    [[nodiscard]] auto contextBudget() const -> size_t override;
+
+    /// @brief Fails: embeddings are not recorded.
+    [[nodiscard]] auto embed(std::string_view text) -> Result<std::vector<float>> override;
+
+    /// @brief Returns the number of prompts that differed from the recorded ones.
+    [[nodiscard]] auto divergences() const -> size_t { return _divergences; }
+
+    /// @brief Returns the number of recorded generations not played back yet.
+    [[nodiscard]] auto remaining() const -> size_t;
+
+  private:
+    AgentTrace const& _trace;
+    ReplayTiming _timing;
+    mutable std::mutex _mutex; ///< Guards the members below.
+    size_t _next = 0;
+    std::vector<size_t> _messageTokens;
+    std::atomic<size_t> _divergences = 0;
+};
+
+/// @brief Returns a transport factory that answers each server's requests with the responses
+///        recorded in @p trace in place of the server.
+///
+/// A request is answered by the first unused exchange with the same method and params; one that
+/// is not in the trace gets an error response. The trace must outlive the ServerManager.
+[[nodiscard]] auto replayTransports(AgentTrace const& trace, ReplayTiming timing) -> TransportFactory;
+
+/// @brief Returns the configurations of the servers @p trace talked to, to add to a ServerManager
+///        whose transports come from replayTransports().
+[[nodiscard]] auto replayServerConfigs(AgentTrace const& trace) -> std::vector<McpServerConfig>;
+
+} // namespace mychat
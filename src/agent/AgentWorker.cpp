@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "AgentWorker.hpp"
+
+#include <core/Log.hpp>
+#include <core/SpscQueue.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace mychat
+{
+
+struct AgentWorker::Impl
+{
+    AgentTask task;
+    AgentPrefillTask prefillTask;
+    AgentLoop* agent = nullptr; ///< The agent loop whose tool result callback publishes images.
+    SpscQueue<AgentEvent> events;
+    std::function<void()> wakeup; ///< Called after publishing an event; set before the first turn.
+
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::optional<std::string> pendingMessage;
+    std::stop_source turnStop;   ///< Cancels the current turn only.
+    std::atomic<bool> busy = false;
+
+    std::optional<std::string> pendingDraft;
+    std::stop_source prefillStop; ///< Stops the prefill of the current draft only.
+    bool prefilling = false;      ///< A draft is being prefilled; guarded by mutex.
+    std::condition_variable prefillDone;
+
+    std::jthread worker; ///< Declared last so it is joined before the members above are destroyed.
+
+    Impl(AgentTask t, AgentPrefillTask p, std::size_t queueCapacity):
+        task(std::move(t)), prefillTask(std::move(p)), events(queueCapacity)
+    {
+        worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+    }
+
+    /// @brief Pushes an event, waiting for the consumer while the queue is full.
+    void publish(AgentEvent event, std::stop_token const& stopToken)
+    {
+        while (!events.tryPush(std::move(event)))
+        {
+            if (stopToken.stop_requested())
+                return;
+            std::this_thread::yield();
+        }
+        if (wakeup)
+            wakeup();
+    }
+
+    /// @brief Prefills @p draft, then marks the worker as no longer prefilling.
+    void runPrefill(std::string const& draft,
+                    std::stop_token const& prefillToken,
+                    std::stop_token const& stopToken)
+    {
+        {
+            auto onShutdown = std::stop_callback(stopToken, [this] { stopPrefill(); });
+            auto const prefilled = prefillTask(draft, prefillToken);
+            if (!prefilled && !prefillToken.stop_requested())
+                log::debug("Prefill of the draft failed: {}", prefilled.error().message);
+        }
+        {
+            auto lock = std::lock_guard(mutex);
+            prefilling = false;
+        }
+        prefillDone.notify_all();
+    }
+
+    /// @brief Worker thread function that executes submitted turns and, between them, draft prefills.
+    void run(std::stop_token const& stopToken)
+    {
+        while (!stopToken.stop_requested())
+        {
+            auto message = std::string {};
+            auto turnToken = std::stop_token {};
+            {
+                auto lock = std::unique_lock(mutex);
+                cv.wait(lock, stopToken, [this] { return pendingMessage || pendingDraft; });
+                if (stopToken.stop_requested())
+                    return;
+                if (!pendingMessage)
+                {
+                    auto const draft = std::move(*pendingDraft);
+                    pendingDraft.reset();
+                    prefillStop = std::stop_source {};
+                    auto const prefillToken = prefillStop.get_token();
+                    prefilling = true;
+                    lock.unlock();
+                    runPrefill(draft, prefillToken, stopToken);
+                    continue;
+                }
+                message = std::move(*pendingMessage);
+                pendingMessage.reset();
+                turnToken = turnStop.get_token();
+            }
+
+            // The turn is aborted on explicit cancel() as well as on worker shutdown.
+            auto onShutdown = std::stop_callback(stopToken, [this] { cancelTurn(); });
+
+            auto const streamCb = [&](std::string_view token) {
+                auto event = AgentEvent {};
+                event.text = std::string(token);
+                publish(std::move(event), stopToken);
+            };
+
+            auto result = task(message, streamCb, turnToken);
+
+            auto finished = AgentEvent {};
+            finished.kind = AgentEvent::Kind::Finished;
+            finished.cancelled = turnToken.stop_requested();
+            if (result)
+                finished.text = std::move(*result);
+            else
+                finished.error = std::move(result.error());
+            publish(std::move(finished), stopToken);
+        }
+    }
+
+    void cancelTurn()
+    {
+        auto lock = std::lock_guard(mutex);
+        turnStop.request_stop();
+    }
+
+    void stopPrefill()
+    {
+        auto lock = std::lock_guard(mutex);
+        prefillStop.request_stop();
+    }
+};
+
+AgentWorker::AgentWorker(AgentLoop& agent, std::size_t queueCapacity):
+    AgentWorker(
+        [&agent](std::string_view message, AgentStreamCallback streamCb, std::stop_token stopToken) {
+            return agent.processMessage(message, std::move(streamCb), std::move(stopToken));
+        },
+        [&agent](std::string_view draft, std::stop_token stopToken) {
+            return agent.prefill(draft, std::move(stopToken));
+        },
+        queueCapacity)
+{
+    // Runs on the worker thread within processMessage(), which keeps the event queue single-producer.
+    _impl->agent = &agent;
+    agent.setToolResultCallback([impl = _impl.get()](ToolCall const& call, ToolResult const& result) {
+        for (auto const& blob: result.blobs)
+        {
+            if (!blob.isImage())
+                continue;
+            auto event = AgentEvent {};
+            event.kind = AgentEvent::Kind::Image;
+            event.text = call.name;
+            event.image = blob;
+            impl->publish(std::move(event), impl->worker.get_stop_token());
+        }
+    });
+}
+
+AgentWorker::AgentWorker(AgentTask task, std::size_t queueCapacity):
+    AgentWorker(std::move(task), AgentPrefillTask {}, queueCapacity)
+{
+}
+
+AgentWorker::AgentWorker(AgentTask task, AgentPrefillTask prefillTask, std::size_t queueCapacity):
+    _impl(std::make_unique<Impl>(std::move(task), std::move(prefillTask), queueCapacity))
+{
+}
+
+AgentWorker::~AgentWorker()
+{
+    _impl->worker.request_stop();
+    if (_impl->agent)
+    {
+        _impl->worker.join();
+        _impl->agent->setToolResultCallback({});
+    }
+}
+
+auto AgentWorker::submit(std::string message) -> bool
+{
+    if (_impl->busy.exchange(true))
+        return false;
+
+    {
+        // The turn starts once a running prefill has stopped; what it decoded is kept.
+        auto lock = std::lock_guard(_impl->mutex);
+        _impl->pendingDraft.reset();
+        _impl->prefillStop.request_stop();
+        _impl->turnStop = std::stop_source {};
+        _impl->pendingMessage = std::move(message);
+    }
+    _impl->cv.notify_one();
+    return true;
+}
+
+auto AgentWorker::prefill(std::string draft) -> bool
+{
+    if (!_impl->prefillTask || _impl->busy.load())
+        return false;
+
+    {
+        auto lock = std::lock_guard(_impl->mutex);
+        _impl->prefillStop.request_stop();
+        _impl->pendingDraft = std::move(draft);
+    }
+    _impl->cv.notify_one();
+    return true;
+}
+
+void AgentWorker::cancelPrefill()
+{
+    auto lock = std::unique_lock(_impl->mutex);
+    _impl->pendingDraft.reset();
+    _impl->prefillStop.request_stop();
+    _impl->prefillDone.wait(lock, [this] { return !_impl->prefilling; });
+}
+
+void AgentWorker::cancel()
+{
+    if (_impl->busy.load())
+        _impl->cancelTurn();
+}
+
+auto AgentWorker::busy() const -> bool
+{
+    return _impl->busy.load();
+}
+
+void AgentWorker::setWakeup(std::function<void()> wakeup)
+{
+    _impl->wakeup = std::move(wakeup);
+}
+
+auto AgentWorker::poll(std::function<void(AgentEvent&)> const& handler) -> std::size_t
+{
+    auto count = std::size_t { 0 };
+    while (auto event = _impl->events.tryPop())
+    {
+        ++count;
+        auto const finished = event->kind == AgentEvent::Kind::Finished;
+        handler(*event);
+        if (finished)
+        {
+            _impl->busy.store(false);
+            break;
+        }
+    }
+    return count;
+}
+
+} // namespace mychat
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <agent/AgentLoop.hpp>
+#include <core/Error.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief An event produced by the inference worker for the UI thread.
+struct AgentEvent
+{
+    enum class Kind : std::uint8_t
+    {
+        Token,    ///< A streamed piece of the response; text holds the token.
+        Image,    ///< A tool returned an image; image holds it and text the tool's name.
+        Finished, ///< The turn ended; text holds the final response unless error is set.
+    };
+
+    Kind kind = Kind::Token;
+    std::string text;
+    ToolContentBlob image;      ///< Set for an Image event.
+    std::optional<Error> error; ///< Set for a Finished event when the turn failed.
+    bool cancelled = false;     ///< Set for a Finished event when the turn was cancelled.
+};
+
+/// @brief Function running one agent turn (normally AgentLoop::processMessage).
+using AgentTask = std::function<Result<std::string>(
+    std::string_view message, AgentStreamCallback streamCb, std::stop_token stopToken)>;
+
+/// @brief Function prefilling the message of the next turn while it is typed (normally AgentLoop::prefill).
+using AgentPrefillTask = std::function<VoidResult(std::string_view draft, std::stop_token stopToken)>;
+
+/// @brief Runs agent turns on a dedicated inference thread.
+///
+/// Tokens are handed to the UI thread through a lock-free single-producer/single-consumer
+/// queue, so the UI keeps processing input (e.g. ESC to cancel) and animating while the
+/// model streams. A turn is cancelled cooperatively via a stop token that LlmEngine checks
+/// between decode steps.
+///
+/// Between turns, the worker prefills the message being typed, so the KV cache already holds
+/// most of it once it is sent. A newer draft or a turn stops the prefill of the previous draft.
+class AgentWorker
+{
+  public:
+    /// @brief Constructs a worker that runs turns through the given agent loop.
+    ///
+    /// Images returned by tools are delivered as AgentEvent::Kind::Image events.
+    /// @param agent The agent loop; must outlive the worker.
+    /// @param queueCapacity Maximum number of undelivered events before the worker waits.
+    explicit AgentWorker(AgentLoop& agent, std::size_t queueCapacity = 4096);
+
+    /// @brief Constructs a worker that runs turns through an arbitrary task.
+    /// @param task The function executing a turn.
+    /// @param queueCapacity Maximum number of undelivered events before the worker waits.
+    explicit AgentWorker(AgentTask task, std::size_t queueCapacity = 4096);
+
+    /// @brief Constructs a worker that runs turns and draft prefills through arbitrary tasks.
+    /// @param task The function executing a turn.
+    /// @param prefillTask The function prefilling a draft.
+    /// @param queueCapacity Maximum number of undelivered events before the worker waits.
+    AgentWorker(AgentTask task, AgentPrefillTask prefillTask, std::size_t queueCapacity = 4096);
+
+    /// @brief Cancels any running turn and joins the worker thread.
+    ~AgentWorker();
+
+    AgentWorker(const AgentWorker&) = delete;
+    AgentWorker& operator=(const AgentWorker&) = delete;
+
+    /// @brief Starts a new turn on the worker thread.
+    /// @param message The user message.
+    /// @return False if a turn is still in progress.
+    [[nodiscard]] auto submit(std::string message) -> bool;
+
+    /// @brief Requests cancellation of the running turn (no-op when idle).
+    void cancel();
+
+    /// @brief Prefills @p draft, the message being typed, on the worker thread.
+    ///
+    /// Replaces a draft not yet started and stops the prefill of a running one.
+    /// @return False, ignoring the draft, if a turn is in progress or the worker cannot prefill.
+    auto prefill(std::string draft) -> bool;
+
+    /// @brief Drops the pending draft and waits until a running prefill has stopped.
+    ///
+    /// Call it before changing the session or the engine on another thread between turns.
+    void cancelPrefill();
+
+    /// @brief Returns true while a turn is running or its events have not all been polled.
+    [[nodiscard]] auto busy() const -> bool;
+
+    /// @brief Sets a function the worker thread calls after publishing each event.
+    ///
+    /// Lets the UI thread sleep until there is something to poll(). Must be set before the first
+    /// submit().
+    void setWakeup(std::function<void()> wakeup);
+
+    /// @brief Delivers pending events to @p handler on the calling (UI) thread.
+    /// @param handler Invoked once per event, in order.
+    /// @return The number of events delivered.
+    auto poll(std::function<void(AgentEvent&)> const& handler) -> std::size_t;
+
+    struct Impl;
+
+  private:
+    std::unique_ptr<Impl> _impl;
+};
+
+} // namespace mychat
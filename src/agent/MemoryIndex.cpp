@@ -0,0 +1,892 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "MemoryIndex.hpp"
+
+#include <core/Hash.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__AVX2__)
+    #define MYCHAT_MEMORY_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define MYCHAT_MEMORY_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define MYCHAT_MEMORY_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Identifies a memory index file ("MCMI") and its format version.
+    constexpr auto FileMagic = std::uint32_t { 0x494d434d };
+    constexpr auto FileVersion = std::uint32_t { 1 };
+
+    /// Sections of the file start at this alignment, so that they can be used in place.
+    constexpr auto SectionAlignment = size_t { 64 };
+
+    /// Embeddings with more dimensions are taken for a corrupt file.
+    constexpr auto MaxDimensions = size_t { 1 } << 16;
+
+    /// Pieces a single message is cut into at most; the rest of a long tool output is left out.
+    constexpr auto MaxChunksPerMessage = size_t { 8 };
+
+    /// Lists a search scans at least, as long as there are that many.
+    constexpr auto MinProbes = size_t { 16 };
+
+    /// Sample size per centroid that k-means is trained on, and its number of iterations.
+    constexpr auto TrainingSamplesPerList = size_t { 32 };
+    constexpr auto KMeansIterations = 8;
+
+    /// The index is clustered anew once it has grown by this factor since it was last clustered.
+    constexpr auto ReclusterGrowth = size_t { 4 };
+
+    constexpr auto NotesHeader = std::string_view { "Notes from earlier conversations that may help:\n" };
+    constexpr auto NotesEnd = std::string_view { "(End of notes.)\n\n" };
+
+    struct FileHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t dimensions;
+        std::uint32_t lists;
+        std::uint64_t chunks;
+        std::uint64_t clusteredChunks;
+        std::uint64_t sources;
+        std::uint64_t textBytes;
+    };
+    static_assert(sizeof(FileHeader) == 48);
+
+    struct ChunkRecord
+    {
+        std::uint64_t key; ///< Hash of the text.
+        std::uint64_t textOffset;
+        std::uint32_t textLength;
+        std::uint32_t source; ///< Index of the chunk's SourceRecord.
+    };
+    static_assert(sizeof(ChunkRecord) == 24);
+
+    struct SourceRecord
+    {
+        std::uint64_t textOffset;
+        std::uint32_t textLength;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(SourceRecord) == 16);
+
+    /// @brief Offsets of the sections of a file with the given header.
+    struct Layout
+    {
+        size_t centroidScales = 0;
+        size_t chunkScales = 0;
+        size_t listOffsets = 0;
+        size_t centroidCodes = 0;
+        size_t chunkCodes = 0;
+        size_t records = 0;
+        size_t sources = 0;
+        size_t text = 0;
+        size_t end = 0;
+    };
+
+    auto alignUp(size_t offset) -> size_t
+    {
+        return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+    }
+
+    auto layoutOf(FileHeader const& header) -> Layout
+    {
+        auto offset = alignUp(sizeof(FileHeader));
+        auto const section = [&offset](size_t bytes) {
+            auto const start = offset;
+            offset = alignUp(start + bytes);
+            return start;
+        };
+        auto const dimensions = size_t { header.dimensions };
+        auto layout = Layout {};
+        layout.centroidScales = section(header.lists * sizeof(float));
+        layout.chunkScales = section(header.chunks * sizeof(float));
+        layout.listOffsets = section((header.lists + size_t { 1 }) * sizeof(std::uint64_t));
+        layout.centroidCodes = section(header.lists * dimensions);
+        layout.chunkCodes = section(header.chunks * dimensions);
+        layout.records = section(header.chunks * sizeof(ChunkRecord));
+        layout.sources = section(header.sources * sizeof(SourceRecord));
+        layout.text = offset;
+        layout.end = layout.text + header.textBytes;
+        return layout;
+    }
+
+    template <typename T>
+    auto sectionOf(std::span<const char> bytes, size_t offset, size_t count) -> std::span<const T>
+    {
+        return { reinterpret_cast<T const*>(bytes.data() + offset), count };
+    }
+
+    template <typename T>
+    auto recordAt(std::span<const char> records, size_t index) -> T
+    {
+        auto record = T {};
+        std::memcpy(&record, records.data() + index * sizeof(T), sizeof(T));
+        return record;
+    }
+
+    /// @brief Whether @p length bytes at @p offset lie within a section of @p size bytes.
+    ///
+    /// Compares without adding, so that offsets read from a corrupt file cannot wrap around.
+    auto fitsIn(std::uint64_t offset, std::uint64_t length, size_t size) noexcept -> bool
+    {
+        return offset <= size && length <= size - offset;
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream& out, T const& value)
+    {
+        out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    /// @brief Writes zeros up to @p offset, the start of the next section.
+    void padTo(std::ofstream& out, size_t offset)
+    {
+        constexpr auto Zeros = std::array<char, SectionAlignment> {};
+        auto const position = static_cast<size_t>(out.tellp());
+        if (offset > position)
+            out.write(Zeros.data(), static_cast<std::streamsize>(offset - position));
+    }
+
+    /// @brief Computes the dot product of two vectors of 8-bit codes.
+    auto dotInt8(std::int8_t const* a, std::int8_t const* b, size_t count) -> std::int32_t
+    {
+        auto i = size_t { 0 };
+        auto result = std::int32_t { 0 };
+
+#if defined(MYCHAT_MEMORY_AVX2)
+        auto const ones = _mm256_set1_epi16(1);
+        auto sum = _mm256_setzero_si256();
+        for (; i + 32 <= count; i += 32)
+        {
+            auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+            auto const y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+            // |x| times y with the sign of x is x times y, as vpmaddubsw multiplies unsigned by signed bytes.
+            auto const pairs = _mm256_maddubs_epi16(_mm256_abs_epi8(x), _mm256_sign_epi8(y, x));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+        }
+        auto lanes = std::array<std::int32_t, 8> {};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data()), sum);
+        for (auto const lane: lanes)
+            result += lane;
+#elif defined(MYCHAT_MEMORY_SSE2)
+        auto sum = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16)
+        {
+            auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+            auto const y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+            // Sign-extends the bytes to 16 bits by pairing each with itself and shifting it down.
+            auto const xLow = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+            auto const xHigh = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+            auto const yLow = _mm_srai_epi16(_mm_unpacklo_epi8(y, y), 8);
+            auto const yHigh = _mm_srai_epi16(_mm_unpackhi_epi8(y, y), 8);
+            sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_madd_epi16(xLow, yLow), _mm_madd_epi16(xHigh, yHigh)));
+        }
+        auto lanes = std::array<std::int32_t, 4> {};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.data()), sum);
+        for (auto const lane: lanes)
+            result += lane;
+#elif defined(MYCHAT_MEMORY_NEON)
+        auto sum = vdupq_n_s32(0);
+        for (; i + 16 <= count; i += 16)
+        {
+            auto const x = vld1q_s8(a + i);
+            auto const y = vld1q_s8(b + i);
+            auto products = vmull_s8(vget_low_s8(x), vget_low_s8(y));
+            products = vmlal_s8(products, vget_high_s8(x), vget_high_s8(y));
+            sum = vpadalq_s16(sum, products);
+        }
+        result = vaddvq_s32(sum);
+#endif
+
+        for (; i < count; ++i)
+            result += std::int32_t { a[i] } * std::int32_t { b[i] };
+        return result;
+    }
+
+    /// @brief Quantizes @p values to @p codes in [-127, 127].
+    /// @return The scale that maps the codes back to the values.
+    auto quantize(std::span<const float> values, std::span<std::int8_t> codes) -> float
+    {
+        auto maxAbs = 0.0f;
+        for (auto const value: values)
+            maxAbs = std::max(maxAbs, std::abs(value));
+        if (maxAbs == 0.0f)
+        {
+            std::ranges::fill(codes, std::int8_t { 0 });
+            return 0.0f;
+        }
+        auto const scale = maxAbs / 127.0f;
+        for (auto i = size_t { 0 }; i < values.size(); ++i)
+            codes[i] = static_cast<std::int8_t>(std::clamp(std::lround(values[i] / scale), -127L, 127L));
+        return scale;
+    }
+
+    /// @brief Quantized cluster centroids, each L2-normalized before it was quantized.
+    struct Centroids
+    {
+        std::vector<std::int8_t> codes;
+        std::vector<float> scales;
+
+        [[nodiscard]] auto count() const noexcept -> size_t { return scales.size(); }
+
+        /// @brief Returns the centroid closest in angle to @p codes.
+        [[nodiscard]] auto nearest(std::int8_t const* vector, size_t dimensions) const -> std::uint32_t
+        {
+            auto best = std::uint32_t { 0 };
+            auto bestScore = -std::numeric_limits<float>::infinity();
+            for (auto list = size_t { 0 }; list < count(); ++list)
+            {
+                auto const score =
+                    static_cast<float>(dotInt8(vector, codes.data() + list * dimensions, dimensions))
+                    * scales[list];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = static_cast<std::uint32_t>(list);
+                }
+            }
+            return best;
+        }
+    };
+
+    /// @brief Clusters the quantized @p vectors around @p lists centroids by spherical k-means.
+    auto cluster(std::span<std::int8_t const* const> vectors,
+                 std::span<const float> scales,
+                 size_t dimensions,
+                 size_t lists) -> Centroids
+    {
+        // An evenly spaced sample finds about the same centroids in a fraction of the time.
+        auto const sampleSize = std::min(vectors.size(), lists * TrainingSamplesPerList);
+        auto sample = std::vector<size_t>(sampleSize);
+        for (auto i = size_t { 0 }; i < sampleSize; ++i)
+            sample[i] = i * vectors.size() / sampleSize;
+
+        auto centroids = Centroids {
+            .codes = std::vector<std::int8_t>(lists * dimensions),
+            .scales = std::vector<float>(lists),
+        };
+        for (auto list = size_t { 0 }; list < lists; ++list)
+        {
+            auto const seed = sample[list * sampleSize / lists];
+            std::copy_n(vectors[seed], dimensions, centroids.codes.data() + list * dimensions);
+            centroids.scales[list] = scales[seed];
+        }
+
+        auto sums = std::vector<float>(lists * dimensions);
+        auto counts = std::vector<size_t>(lists);
+        for (auto iteration = 0; iteration < KMeansIterations; ++iteration)
+        {
+            std::ranges::fill(sums, 0.0f);
+            std::ranges::fill(counts, size_t { 0 });
+            for (auto const i: sample)
+            {
+                auto const list = centroids.nearest(vectors[i], dimensions);
+                ++counts[list];
+                auto* sum = sums.data() + list * dimensions;
+                for (auto d = size_t { 0 }; d < dimensions; ++d)
+                    sum[d] += static_cast<float>(vectors[i][d]) * scales[i];
+            }
+            // A centroid that attracted nothing stays where it was.
+            for (auto list = size_t { 0 }; list < lists; ++list)
+            {
+                if (counts[list] == 0)
+                    continue;
+                auto const sum = std::span(sums).subspan(list * dimensions, dimensions);
+                auto norm = 0.0f;
+                for (auto const value: sum)
+                    norm += value * value;
+                norm = std::sqrt(norm);
+                if (norm > 0.0f)
+                    for (auto& value: sum)
+                        value /= norm;
+                centroids.scales[list] =
+                    quantize(sum, std::span(centroids.codes).subspan(list * dimensions, dimensions));
+            }
+        }
+        return centroids;
+    }
+
+    /// @brief Returns the number of lists to cluster @p chunks into.
+    auto listsFor(size_t chunks) -> size_t
+    {
+        return std::max(size_t { 1 }, static_cast<size_t>(std::sqrt(static_cast<double>(chunks))));
+    }
+
+    /// @brief Returns the number of lists a search scans.
+    auto probesFor(size_t lists) -> size_t
+    {
+        return lists <= MinProbes ? lists : std::max(MinProbes, lists / 16);
+    }
+
+    auto isSpace(char c) -> bool
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    auto trim(std::string_view text) -> std::string_view
+    {
+        while (!text.empty() && isSpace(text.front()))
+            text.remove_prefix(1);
+        while (!text.empty() && isSpace(text.back()))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    /// @brief Returns where to end a piece of at most @p limit bytes of @p text.
+    ///
+    /// Prefers the end of a paragraph, then of a line, then of a word, as long as that keeps
+    /// at least half of the limit; otherwise cuts on a UTF-8 boundary.
+    auto cutPosition(std::string_view text, size_t limit) -> size_t
+    {
+        auto const head = text.substr(0, limit + 1);
+        constexpr auto Separators = std::array<std::string_view, 3> { "\n\n", "\n", " " };
+        for (auto const separator: Separators)
+        {
+            auto const position = head.rfind(separator);
+            if (position != std::string_view::npos && position >= limit / 2)
+                return position;
+        }
+        auto cut = limit;
+        while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80)
+            --cut;
+        return cut;
+    }
+
+    auto roleLabel(Role role) -> std::string_view
+    {
+        switch (role)
+        {
+            case Role::User: return "User: ";
+            case Role::Assistant: return "Assistant: ";
+            case Role::Tool: return "Tool result: ";
+            case Role::System: break;
+        }
+        return {};
+    }
+
+    /// @brief Keeps the @p k best candidates offered, in a min-heap on their score.
+    template <typename Candidate>
+    class TopK
+    {
+      public:
+        explicit TopK(size_t k): _k(k) { _heap.reserve(k); }
+
+        void offer(Candidate candidate)
+        {
+            if (_heap.size() < _k)
+            {
+                _heap.push_back(candidate);
+                std::ranges::push_heap(_heap, byScore);
+            }
+            else if (_k > 0 && candidate.score > _heap.front().score)
+            {
+                std::ranges::pop_heap(_heap, byScore);
+                _heap.back() = candidate;
+                std::ranges::push_heap(_heap, byScore);
+            }
+        }
+
+        /// @brief Returns the candidates, the best first.
+        [[nodiscard]] auto take() -> std::vector<Candidate>
+        {
+            std::ranges::sort_heap(_heap, byScore);
+            return std::move(_heap);
+        }
+
+      private:
+        static auto byScore(Candidate const& a, Candidate const& b) -> bool { return a.score > b.score; }
+
+        size_t _k;
+        std::vector<Candidate> _heap;
+    };
+
+} // namespace
+
+auto memoryChunks(std::span<const ChatMessage> messages) -> std::vector<std::string>
+{
+    auto chunks = std::vector<std::string> {};
+    for (auto const& message: messages)
+    {
+        auto const label = roleLabel(message.role);
+        if (label.empty())
+            continue;
+        auto rest = trim(message.role == Role::User ? withoutMemoryNotes(message.content) : message.content);
+        auto const limit = MemoryIndex::MaxChunkBytes - label.size();
+        for (auto pieces = size_t { 0 }; !rest.empty() && pieces < MaxChunksPerMessage; ++pieces)
+        {
+            auto const cut = rest.size() <= limit ? rest.size() : cutPosition(rest, limit);
+            chunks.push_back(std::format("{}{}", label, trim(rest.substr(0, cut))));
+            rest = trim(rest.substr(cut));
+        }
+    }
+    return chunks;
+}
+
+auto withMemoryNotes(std::span<const MemorySnippet> snippets, std::string_view message) -> std::string
+{
+    if (snippets.empty())
+        return std::string(message);
+    auto text = std::string(NotesHeader);
+    for (auto const& snippet: snippets)
+        text += std::format("- {}\n", snippet.text);
+    text += NotesEnd;
+    text += message;
+    return text;
+}
+
+auto withoutMemoryNotes(std::string_view content) -> std::string_view
+{
+    if (!content.starts_with(NotesHeader))
+        return content;
+    auto const end = content.find(NotesEnd);
+    return end == std::string_view::npos ? content : content.substr(end + NotesEnd.size());
+}
+
+MemoryIndex::MemoryIndex(EmbedFn embed): _embed(std::move(embed))
+{
+}
+
+auto MemoryIndex::add(std::string_view source, std::span<const ChatMessage> messages) -> Result<size_t>
+{
+    loadKeys();
+    auto added = size_t { 0 };
+    for (auto& text: memoryChunks(messages))
+    {
+        auto const key = fnv1a64(text);
+        if (_keys.contains(key))
+            continue;
+        auto embedding = _embed(text);
+        if (!embedding)
+            return std::unexpected(embedding.error());
+        if (size() == 0)
+            _dimensions = embedding->size();
+        if (embedding->size() != _dimensions || _dimensions == 0 || _dimensions > MaxDimensions)
+            return makeError(ErrorCode::InvalidArgument,
+                             std::format("Embedding has {} dimensions, the memory index {}",
+                                         embedding->size(),
+                                         _dimensions));
+
+        auto chunk = PendingChunk {
+            .key = key,
+            .scale = 0.0f,
+            .codes = std::vector<std::int8_t>(_dimensions),
+            .source = std::string(source),
+            .text = std::move(text),
+        };
+        chunk.scale = quantize(*embedding, chunk.codes);
+        _pending.push_back(std::move(chunk));
+        _keys.insert(key);
+        ++added;
+    }
+    if (added > 0)
+        _sources.insert(fnv1a64(source));
+    return added;
+}
+
+auto MemoryIndex::contains(std::string_view source) const -> bool
+{
+    return _sources.contains(fnv1a64(source));
+}
+
+auto MemoryIndex::search(std::string_view query, size_t k, std::string_view excludedSource)
+    -> Result<std::vector<MemorySnippet>>
+{
+    if (size() == 0 || k == 0)
+        return std::vector<MemorySnippet> {};
+    auto embedding = _embed(query);
+    if (!embedding)
+        return std::unexpected(embedding.error());
+    return search(std::span<const float>(*embedding), k, excludedSource);
+}
+
+auto MemoryIndex::search(std::span<const float> embedding, size_t k, std::string_view excludedSource) const
+    -> Result<std::vector<MemorySnippet>>
+{
+    if (size() == 0 || k == 0)
+        return std::vector<MemorySnippet> {};
+    if (embedding.size() != _dimensions)
+        return makeError(
+            ErrorCode::InvalidArgument,
+            std::format("Query has {} dimensions, the memory index {}", embedding.size(), _dimensions));
+
+    auto query = std::vector<std::int8_t>(_dimensions);
+    auto const queryScale = quantize(embedding, query);
+
+    struct Candidate
+    {
+        float score;
+        bool pending;
+        size_t index;
+    };
+    auto best = TopK<Candidate>(k);
+
+    if (_mappedChunks > 0)
+    {
+        // Chunks of the excluded source are recognized by the index of its record.
+        auto excluded = std::numeric_limits<std::uint32_t>::max();
+        if (!excludedSource.empty())
+        {
+            auto const sourceCount = _mapped.sources.size() / sizeof(SourceRecord);
+            for (auto i = size_t { 0 }; i < sourceCount; ++i)
+            {
+                auto const record = recordAt<SourceRecord>(_mapped.sources, i);
+                if (fitsIn(record.textOffset, record.textLength, _mapped.text.size())
+                    && std::string_view(_mapped.text.data() + record.textOffset, record.textLength)
+                           == excludedSource)
+                    excluded = static_cast<std::uint32_t>(i);
+            }
+        }
+
+        struct ListScore
+        {
+            float score;
+            size_t list;
+        };
+        auto lists = std::vector<ListScore>(_mapped.lists);
+        for (auto list = size_t { 0 }; list < _mapped.lists; ++list)
+        {
+            auto const codes = _mapped.centroidCodes.data() + list * _dimensions;
+            auto const score = static_cast<float>(dotInt8(query.data(), codes, _dimensions));
+            lists[list] = ListScore { .score = score * _mapped.centroidScales[list], .list = list };
+        }
+        auto const probes = probesFor(lists.size());
+        std::ranges::partial_sort(lists,
+                                  lists.begin() + static_cast<std::ptrdiff_t>(probes),
+                                  [](ListScore a, ListScore b) { return a.score > b.score; });
+
+        for (auto const& [centroidScore, list]: std::span(lists).first(probes))
+        {
+            for (auto chunk = _mapped.listOffsets[list]; chunk < _mapped.listOffsets[list + 1]; ++chunk)
+            {
+                if (excluded != std::numeric_limits<std::uint32_t>::max()
+                    && recordAt<ChunkRecord>(_mapped.records, chunk).source == excluded)
+                    continue;
+                auto const codes = _mapped.chunkCodes.data() + chunk * _dimensions;
+                auto const score = static_cast<float>(dotInt8(query.data(), codes, _dimensions)) * queryScale
+                                   * _mapped.chunkScales[chunk];
+                best.offer(Candidate { .score = score, .pending = false, .index = chunk });
+            }
+        }
+    }
+
+    for (auto i = size_t { 0 }; i < _pending.size(); ++i)
+    {
+        auto const& chunk = _pending[i];
+        if (!excludedSource.empty() && chunk.source == excludedSource)
+            continue;
+        auto const score = static_cast<float>(dotInt8(query.data(), chunk.codes.data(), _dimensions))
+                           * queryScale * chunk.scale;
+        best.offer(Candidate { .score = score, .pending = true, .index = i });
+    }
+
+    auto snippets = std::vector<MemorySnippet> {};
+    for (auto const& candidate: best.take())
+    {
+        if (candidate.pending)
+        {
+            auto const& chunk = _pending[candidate.index];
+            snippets.push_back(
+                MemorySnippet { .source = chunk.source, .text = chunk.text, .score = candidate.score });
+        }
+        else
+        {
+            snippets.push_back(MemorySnippet {
+                .source = std::string(mappedSource(candidate.index)),
+                .text = std::string(mappedText(candidate.index)),
+                .score = candidate.score,
+            });
+        }
+    }
+    return snippets;
+}
+
+auto MemoryIndex::open(std::filesystem::path const& path) -> VoidResult
+{
+    auto file = MappedFile {};
+    if (!file.open(path))
+        return makeError(ErrorCode::IoError, std::format("Cannot open memory index {}", path.string()));
+
+    auto const bytes = file.bytes();
+    auto header = FileHeader {};
+    if (bytes.size() < sizeof(header))
+        return makeError(ErrorCode::IoError, std::format("Invalid memory index {}", path.string()));
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    // Each count is bounded by the file's size, so that the layout cannot overflow.
+    if (header.magic != FileMagic || header.version != FileVersion || header.dimensions > MaxDimensions
+        || header.chunks > bytes.size() || header.sources > bytes.size() || header.textBytes > bytes.size()
+        || header.lists > header.chunks
+        || (header.chunks > 0 && (header.lists == 0 || header.dimensions == 0)))
+        return makeError(ErrorCode::IoError, std::format("Invalid memory index {}", path.string()));
+
+    auto const layout = layoutOf(header);
+    if (layout.end > bytes.size())
+        return makeError(ErrorCode::IoError, std::format("Truncated memory index {}", path.string()));
+
+    auto const dimensions = size_t { header.dimensions };
+    auto const chunks = static_cast<size_t>(header.chunks);
+    auto const lists = size_t { header.lists };
+    auto mapped = MappedSections {
+        .dimensions = dimensions,
+        .lists = lists,
+        .clusteredChunks = static_cast<size_t>(header.clusteredChunks),
+        .centroidScales = sectionOf<float>(bytes, layout.centroidScales, lists),
+        .chunkScales = sectionOf<float>(bytes, layout.chunkScales, chunks),
+        .listOffsets = sectionOf<std::uint64_t>(bytes, layout.listOffsets, lists + 1),
+        .centroidCodes = sectionOf<std::int8_t>(bytes, layout.centroidCodes, lists * dimensions),
+        .chunkCodes = sectionOf<std::int8_t>(bytes, layout.chunkCodes, chunks * dimensions),
+        .records = bytes.subspan(layout.records, chunks * sizeof(ChunkRecord)),
+        .sources = bytes.subspan(layout.sources, static_cast<size_t>(header.sources) * sizeof(SourceRecord)),
+        .text = bytes.subspan(layout.text, static_cast<size_t>(header.textBytes)),
+    };
+    if (mapped.listOffsets.front() != 0 || mapped.listOffsets.back() != chunks
+        || !std::ranges::is_sorted(mapped.listOffsets))
+        return makeError(ErrorCode::IoError, std::format("Invalid memory index {}", path.string()));
+
+    auto sources = std::unordered_set<std::uint64_t> {};
+    for (auto i = size_t { 0 }; i < header.sources; ++i)
+    {
+        auto const record = recordAt<SourceRecord>(mapped.sources, i);
+        if (!fitsIn(record.textOffset, record.textLength, mapped.text.size()))
+            return makeError(ErrorCode::IoError, std::format("Invalid memory index {}", path.string()));
+        sources.insert(fnv1a64(std::string_view(mapped.text.data() + record.textOffset, record.textLength)));
+    }
+
+    _file = std::move(file);
+    _mapped = mapped;
+    _mappedChunks = chunks;
+    _dimensions = dimensions;
+    _pending.clear();
+    _keys.clear();
+    _keysLoaded = chunks == 0;
+    _sources = std::move(sources);
+    return {};
+}
+
+auto MemoryIndex::save(std::filesystem::path const& path) -> VoidResult
+{
+    // Views of all chunks; those of the mapped file stay valid until the new one is mapped.
+    struct Entry
+    {
+        std::uint64_t key;
+        float scale;
+        std::int8_t const* codes;
+        std::string_view source;
+        std::string_view text;
+        std::uint32_t list;
+    };
+    auto entries = std::vector<Entry> {};
+    entries.reserve(size());
+    for (auto list = size_t { 0 }; list < _mapped.lists; ++list)
+    {
+        for (auto chunk = _mapped.listOffsets[list]; chunk < _mapped.listOffsets[list + 1]; ++chunk)
+        {
+            entries.push_back(Entry {
+                .key = recordAt<ChunkRecord>(_mapped.records, chunk).key,
+                .scale = _mapped.chunkScales[chunk],
+                .codes = _mapped.chunkCodes.data() + chunk * _dimensions,
+                .source = mappedSource(chunk),
+                .text = mappedText(chunk),
+                .list = static_cast<std::uint32_t>(list),
+            });
+        }
+    }
+    for (auto const& chunk: _pending)
+    {
+        entries.push_back(Entry {
+            .key = chunk.key,
+            .scale = chunk.scale,
+            .codes = chunk.codes.data(),
+            .source = chunk.source,
+            .text = chunk.text,
+            .list = 0,
+        });
+    }
+
+    // The centroids are kept while the index grows moderately; new chunks join the nearest one.
+    auto centroids = Centroids {};
+    auto clusteredChunks = _mapped.clusteredChunks;
+    auto firstUnassigned = _mappedChunks;
+    auto const recluster = _mapped.lists == 0 || entries.size() > ReclusterGrowth * _mapped.clusteredChunks;
+    if (!entries.empty() && recluster)
+    {
+        auto vectors = std::vector<std::int8_t const*> {};
+        auto scales = std::vector<float> {};
+        vectors.reserve(entries.size());
+        scales.reserve(entries.size());
+        for (auto const& entry: entries)
+        {
+            vectors.push_back(entry.codes);
+            scales.push_back(entry.scale);
+        }
+        centroids = cluster(vectors, scales, _dimensions, listsFor(entries.size()));
+        clusteredChunks = entries.size();
+        firstUnassigned = 0;
+    }
+    else if (!entries.empty())
+    {
+        centroids.codes.assign(_mapped.centroidCodes.begin(), _mapped.centroidCodes.end());
+        centroids.scales.assign(_mapped.centroidScales.begin(), _mapped.centroidScales.end());
+    }
+    for (auto i = firstUnassigned; i < entries.size(); ++i)
+        entries[i].list = centroids.nearest(entries[i].codes, _dimensions);
+
+    // Lays the chunks out list by list, so that a list is one contiguous range.
+    auto const lists = centroids.count();
+    auto listOffsets = std::vector<std::uint64_t>(lists + 1);
+    for (auto const& entry: entries)
+        ++listOffsets[entry.list + 1];
+    for (auto list = size_t { 0 }; list < lists; ++list)
+        listOffsets[list + 1] += listOffsets[list];
+    auto order = std::vector<size_t>(entries.size());
+    auto next = listOffsets;
+    for (auto i = size_t { 0 }; i < entries.size(); ++i)
+        order[next[entries[i].list]++] = i;
+
+    // The text holds the sources, then the text of each chunk.
+    auto sourceIds = std::unordered_map<std::string_view, std::uint32_t> {};
+    auto sourceRecords = std::vector<SourceRecord> {};
+    auto sourceNames = std::vector<std::string_view> {};
+    auto textBytes = std::uint64_t { 0 };
+    for (auto const& entry: entries)
+    {
+        if (sourceIds.try_emplace(entry.source, static_cast<std::uint32_t>(sourceRecords.size())).second)
+        {
+            sourceRecords.push_back(SourceRecord {
+                .textOffset = textBytes,
+                .textLength = static_cast<std::uint32_t>(entry.source.size()),
+                .reserved = 0,
+            });
+            sourceNames.push_back(entry.source);
+            textBytes += entry.source.size();
+        }
+    }
+    auto chunkRecords = std::vector<ChunkRecord> {};
+    chunkRecords.reserve(entries.size());
+    for (auto const i: order)
+    {
+        chunkRecords.push_back(ChunkRecord {
+            .key = entries[i].key,
+            .textOffset = textBytes,
+            .textLength = static_cast<std::uint32_t>(entries[i].text.size()),
+            .source = sourceIds.at(entries[i].source),
+        });
+        textBytes += entries[i].text.size();
+    }
+
+    auto const header = FileHeader {
+        .magic = FileMagic,
+        .version = FileVersion,
+        .dimensions = static_cast<std::uint32_t>(entries.empty() ? 0 : _dimensions),
+        .lists = static_cast<std::uint32_t>(lists),
+        .chunks = entries.size(),
+        .clusteredChunks = clusteredChunks,
+        .sources = sourceRecords.size(),
+        .textBytes = textBytes,
+    };
+    auto const layout = layoutOf(header);
+
+    auto ec = std::error_code {};
+    std::filesystem::create_directories(path.parent_path(), ec);
+    auto const tempPath = std::filesystem::path(path).concat(".tmp");
+    {
+        auto out = std::ofstream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return makeError(ErrorCode::IoError, std::format("Cannot write memory index {}", path.string()));
+
+        writeValue(out, header);
+        padTo(out, layout.centroidScales);
+        for (auto const scale: centroids.scales)
+            writeValue(out, scale);
+        padTo(out, layout.chunkScales);
+        for (auto const i: order)
+            writeValue(out, entries[i].scale);
+        padTo(out, layout.listOffsets);
+        for (auto const offset: listOffsets)
+            writeValue(out, offset);
+        padTo(out, layout.centroidCodes);
+        out.write(reinterpret_cast<char const*>(centroids.codes.data()),
+                  static_cast<std::streamsize>(centroids.codes.size()));
+        padTo(out, layout.chunkCodes);
+        for (auto const i: order)
+            out.write(reinterpret_cast<char const*>(entries[i].codes),
+                      static_cast<std::streamsize>(_dimensions));
+        padTo(out, layout.records);
+        for (auto const& record: chunkRecords)
+            writeValue(out, record);
+        padTo(out, layout.sources);
+        for (auto const& record: sourceRecords)
+            writeValue(out, record);
+        padTo(out, layout.text);
+        for (auto const name: sourceNames)
+            out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        for (auto const i: order)
+            out.write(entries[i].text.data(), static_cast<std::streamsize>(entries[i].text.size()));
+        if (!out)
+            return makeError(ErrorCode::IoError,
+                             std::format("Failed to write memory index {}", path.string()));
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        return makeError(ErrorCode::IoError,
+                         std::format("Failed to write memory index {}: {}", path.string(), ec.message()));
+    return open(path);
+}
+
+void MemoryIndex::clear() noexcept
+{
+    _file.close();
+    _mapped = {};
+    _mappedChunks = 0;
+    _dimensions = 0;
+    _pending.clear();
+    _keys.clear();
+    _keysLoaded = true;
+    _sources.clear();
+}
+
+void MemoryIndex::loadKeys()
+{
+    if (std::exchange(_keysLoaded, true))
+        return;
+    _keys.reserve(_mappedChunks + _pending.size());
+    for (auto chunk = size_t { 0 }; chunk < _mappedChunks; ++chunk)
+        _keys.insert(recordAt<ChunkRecord>(_mapped.records, chunk).key);
+}
+
+auto MemoryIndex::mappedSource(size_t chunk) const -> std::string_view
+{
+    auto const source = recordAt<ChunkRecord>(_mapped.records, chunk).source;
+    if (source >= _mapped.sources.size() / sizeof(SourceRecord))
+        return {};
+    auto const record = recordAt<SourceRecord>(_mapped.sources, source);
+    return std::string_view(_mapped.text.data() + record.textOffset, record.textLength);
+}
+
+auto MemoryIndex::mappedText(size_t chunk) const -> std::string_view
+{
+    auto const record = recordAt<ChunkRecord>(_mapped.records, chunk);
+    if (!fitsIn(record.textOffset, record.textLength, _mapped.text.size()))
+        return {};
+    return std::string_view(_mapped.text.data() + record.textOffset, record.textLength);
+}
+
+} // namespace mychat
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/MappedFile.hpp>
+#include <core/Types.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief A piece of an earlier conversation returned by MemoryIndex::search().
+struct MemorySnippet
+{
+    std::string source; ///< The conversation it is from, e.g. a session id.
+    std::string text;
+    float score = 0.0f; ///< Cosine similarity to the query.
+};
+
+/// @brief Splits the messages of a conversation into the pieces MemoryIndex embeds.
+///
+/// User and assistant messages and tool results are cut at paragraph, line or word boundaries
+/// into pieces of at most MemoryIndex::MaxChunkBytes, each prefixed with its role. Notes added
+/// by withMemoryNotes() are left out, so that retrieved snippets are not indexed again.
+[[nodiscard]] auto memoryChunks(std::span<const ChatMessage> messages) -> std::vector<std::string>;
+
+/// @brief Returns @p message preceded by the @p snippets as notes for the model.
+[[nodiscard]] auto withMemoryNotes(std::span<const MemorySnippet> snippets, std::string_view message)
+    -> std::string;
+
+/// @brief Returns @p content without the notes withMemoryNotes() put before it, if any.
+[[nodiscard]] auto withoutMemoryNotes(std::string_view content) -> std::string_view;
+
+/// @brief Persistent embedding index over earlier conversations, for retrieving the pieces of
+///        them relevant to a new message.
+///
+/// Embeddings are quantized to 8 bits per dimension with a scale per vector, a quarter of their
+/// float size, and compared with SIMD integer dot products. The saved index is an inverted file:
+/// the chunks are clustered by k-means around about sqrt(n) centroids, and a search only scans
+/// the lists of the centroids nearest to the query. The file is memory-mapped, so opening even
+/// a large index reads nothing up front. Chunks added since it was saved are searched in full.
+/// Not thread-safe.
+class MemoryIndex
+{
+  public:
+    /// @brief Computes an L2-normalized embedding vector for a piece of text.
+    using EmbedFn = std::function<Result<std::vector<float>>(std::string_view)>;
+
+    /// @brief Longest chunk of text that is embedded, in bytes.
+    static constexpr auto MaxChunkBytes = size_t { 768 };
+
+    /// @brief Constructs an empty MemoryIndex using the given embedding function.
+    explicit MemoryIndex(EmbedFn embed);
+
+    /// @brief Embeds the chunks of @p messages (see memoryChunks()) that are not indexed yet.
+    ///
+    /// Chunks are told apart by their text, so adding a conversation again after it went on
+    /// only embeds what is new.
+    /// @param source Names the conversation, e.g. its session id.
+    /// @return The number of newly indexed chunks, or the error of the embedding function.
+    [[nodiscard]] auto add(std::string_view source, std::span<const ChatMessage> messages) -> Result<size_t>;
+
+    /// @brief Returns whether any chunk of @p source is indexed.
+    [[nodiscard]] auto contains(std::string_view source) const -> bool;
+
+    /// @brief Returns up to @p k chunks most similar to @p query, the most similar first.
+    /// @param excludedSource Chunks of this conversation are skipped, e.g. of the current one.
+    [[nodiscard]] auto search(std::string_view query, size_t k, std::string_view excludedSource = {})
+        -> Result<std::vector<MemorySnippet>>;
+
+    /// @brief Returns up to @p k chunks most similar to an L2-normalized @p embedding.
+    [[nodiscard]] auto search(std::span<const float> embedding,
+                              size_t k,
+                              std::string_view excludedSource = {}) const
+        -> Result<std::vector<MemorySnippet>>;
+
+    /// @brief Memory-maps an index written by save(), replacing the current chunks.
+    [[nodiscard]] auto open(std::filesystem::path const& path) -> VoidResult;
+
+    /// @brief Writes all chunks to @p path and maps it in their place.
+    ///
+    /// The chunks are clustered anew once the index grew fourfold since it was last clustered;
+    /// until then, new chunks join the list of their nearest centroid. Parent directories are
+    /// created as needed.
+    [[nodiscard]] auto save(std::filesystem::path const& path) -> VoidResult;
+
+    /// @brief Drops all chunks, e.g. when the embedding model changed.
+    void clear() noexcept;
+
+    /// @brief Returns the number of indexed chunks.
+    [[nodiscard]] auto size() const noexcept -> size_t { return _mappedChunks + _pending.size(); }
+
+    /// @brief Returns the number of clusters of the saved chunks; 0 before the index was saved.
+    [[nodiscard]] auto listCount() const noexcept -> size_t { return _mapped.lists; }
+
+    /// @brief Returns whether chunks were added since the index was opened or saved.
+    [[nodiscard]] auto modified() const noexcept -> bool { return !_pending.empty(); }
+
+  private:
+    /// @brief A chunk added since the index was saved.
+    struct PendingChunk
+    {
+        std::uint64_t key; ///< Hash of the text.
+        float scale;
+        std::vector<std::int8_t> codes;
+        std::string source;
+        std::string text;
+    };
+
+    /// @brief Views of the sections of the mapped file.
+    struct MappedSections
+    {
+        size_t dimensions = 0;
+        size_t lists = 0;
+        size_t clusteredChunks = 0; ///< Chunks when the centroids were computed.
+        std::span<const float> centroidScales;
+        std::span<const float> chunkScales;
+        std::span<const std::uint64_t> listOffsets; ///< lists + 1 entries into the chunks.
+        std::span<const std::int8_t> centroidCodes;
+        std::span<const std::int8_t> chunkCodes;
+        std::span<const char> records; ///< A ChunkRecord per chunk.
+        std::span<const char> sources; ///< A SourceRecord per source.
+        std::span<const char> text;
+    };
+
+    EmbedFn _embed;
+    size_t _dimensions = 0;
+    MappedFile _file;
+    MappedSections _mapped;
+    size_t _mappedChunks = 0;
+    std::vector<PendingChunk> _pending;
+    std::unordered_set<std::uint64_t> _keys;    ///< Text hashes of all chunks, once _keysLoaded.
+    std::unordered_set<std::uint64_t> _sources; ///< Hashes of the sources of all chunks.
+    bool _keysLoaded = true;                    ///< Whether _keys covers the mapped chunks.
+
+    /// @brief Reads the text hashes of the mapped chunks, which only add() needs.
+    void loadKeys();
+    [[nodiscard]] auto mappedSource(size_t chunk) const -> std::string_view;
+    [[nodiscard]] auto mappedText(size_t chunk) const -> std::string_view;
+};
+
+} // namespace mychat
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ToolIndex.hpp"
+
+#include <core/Hash.hpp>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Identifies a tool index file ("MCTI") and its format version.
+    constexpr auto FileMagic = std::uint32_t { 0x4954434d };
+    constexpr auto FileVersion = std::uint32_t { 1 };
+
+    auto keyOf(ToolDefinition const& tool) -> std::uint64_t
+    {
+        return fnv1a64(ToolIndex::embeddingText(tool));
+    }
+
+    auto dot(std::span<const float> a, std::span<const float> b) -> float
+    {
+        auto const n = std::min(a.size(), b.size());
+        return std::inner_product(a.begin(), a.begin() + static_cast<std::ptrdiff_t>(n), b.begin(), 0.f);
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream& out, T const& value)
+    {
+        out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    auto readValue(std::ifstream& in, T& value) -> bool
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+} // namespace
+
+ToolIndex::ToolIndex(EmbedFn embed): _embed(std::move(embed))
+{
+}
+
+auto ToolIndex::embeddingText(ToolDefinition const& tool) -> std::string
+{
+    return tool.description.empty() ? tool.name : std::format("{}: {}", tool.name, tool.description);
+}
+
+auto ToolIndex::update(std::span<const ToolDefinition> tools) -> Result<size_t>
+{
+    auto added = size_t { 0 };
+    for (auto const& tool: tools)
+    {
+        auto const key = keyOf(tool);
+        if (_embeddings.contains(key))
+            continue;
+        auto embedding = _embed(embeddingText(tool));
+        if (!embedding)
+            return std::unexpected(embedding.error());
+        _embeddings.emplace(key, std::move(*embedding));
+        ++added;
+    }
+    return added;
+}
+
+auto ToolIndex::select(std::span<const ToolDefinition> tools, std::string_view query, size_t k)
+    -> Result<std::vector<ToolDefinition>>
+{
+    if (tools.size() <= k)
+        return std::vector<ToolDefinition>(tools.begin(), tools.end());
+
+    auto queryEmbedding = _embed(query);
+    if (!queryEmbedding)
+        return std::unexpected(queryEmbedding.error());
+
+    auto scores = std::vector<float>(tools.size());
+    for (auto i = size_t { 0 }; i < tools.size(); ++i)
+    {
+        auto const it = _embeddings.find(keyOf(tools[i]));
+        scores[i] = it != _embeddings.end() ? dot(*queryEmbedding, it->second) : -1.f;
+    }
+
+    auto order = std::vector<size_t>(tools.size());
+    std::iota(order.begin(), order.end(), size_t { 0 });
+    std::ranges::partial_sort(order, order.begin() + static_cast<std::ptrdiff_t>(k), [&](size_t a, size_t b) {
+        return scores[a] > scores[b];
+    });
+    order.resize(k);
+
+    // Keeping the original order makes the same selection render the same prompt.
+    std::ranges::sort(order);
+    auto selected = std::vector<ToolDefinition> {};
+    selected.reserve(k);
+    for (auto const i: order)
+        selected.push_back(tools[i]);
+    return selected;
+}
+
+auto ToolIndex::load(std::filesystem::path const& path) -> VoidResult
+{
+    auto in = std::ifstream(path, std::ios::binary);
+    if (!in)
+        return makeError(ErrorCode::IoError, std::format("Cannot open tool index {}", path.string()));
+
+    auto magic = std::uint32_t {};
+    auto version = std::uint32_t {};
+    auto count = std::uint64_t {};
+    if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count) || magic != FileMagic
+        || version != FileVersion)
+        return makeError(ErrorCode::IoError, std::format("Invalid tool index {}", path.string()));
+
+    auto embeddings = std::unordered_map<std::uint64_t, std::vector<float>> {};
+    for (auto i = std::uint64_t { 0 }; i < count; ++i)
+    {
+        auto key = std::uint64_t {};
+        auto dimensions = std::uint32_t {};
+        if (!readValue(in, key) || !readValue(in, dimensions))
+            return makeError(ErrorCode::IoError, std::format("Truncated tool index {}", path.string()));
+        auto embedding = std::vector<float>(dimensions);
+        if (!in.read(reinterpret_cast<char*>(embedding.data()),
+                     static_cast<std::streamsize>(embedding.size() * sizeof(float))))
+            return makeError(ErrorCode::IoError, std::format("Truncated tool index {}", path.string()));
+        embeddings.emplace(key, std::move(embedding));
+    }
+
+    _embeddings = std::move(embeddings);
+    return {};
+}
+
+auto ToolIndex::save(std::filesystem::path const& path) const -> VoidResult
+{
+    auto ec = std::error_code {};
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    auto const tempPath = std::filesystem::path(path).concat(".tmp");
+    {
+        auto out = std::ofstream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return makeError(ErrorCode::IoError, std::format("Cannot write tool index {}", path.string()));
+
+        writeValue(out, FileMagic);
+        writeValue(out, FileVersion);
+        writeValue(out, static_cast<std::uint64_t>(_embeddings.size()));
+        for (auto const& [key, embedding]: _embeddings)
+        {
+            writeValue(out, key);
+            writeValue(out, static_cast<std::uint32_t>(embedding.size()));
+            out.write(reinterpret_cast<char const*>(embedding.data()),
+                      static_cast<std::streamsize>(embedding.size() * sizeof(float)));
+        }
+        if (!out)
+            return makeError(ErrorCode::IoError, std::format("Failed to write tool index {}", path.string()));
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        return makeError(ErrorCode::IoError,
+                         std::format("Failed to write tool index {}: {}", path.string(), ec.message()));
+    return {};
+}
+
+} // namespace mychat
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Embedding index over tool definitions for selecting the tools relevant to a message.
+///
+/// Each tool is embedded from its name and description. Embeddings are keyed by a hash of
+/// that text, so re-listing an unchanged tool set costs nothing, and they can be persisted
+/// to skip embedding all tools again on the next start.
+class ToolIndex
+{
+  public:
+    /// @brief Computes an L2-normalized embedding vector for a piece of text.
+    using EmbedFn = std::function<Result<std::vector<float>>(std::string_view)>;
+
+    /// @brief Constructs a ToolIndex using the given embedding function.
+    explicit ToolIndex(EmbedFn embed);
+
+    /// @brief Embeds all tools that have no embedding yet.
+    /// @return The number of newly embedded tools, or the error of the embedding function.
+    [[nodiscard]] auto update(std::span<const ToolDefinition> tools) -> Result<size_t>;
+
+    /// @brief Returns the @p k tools most similar to @p query, in their original order.
+    ///
+    /// All tools must have been passed to update() before. If there are at most @p k tools,
+    /// all of them are returned without embedding the query.
+    [[nodiscard]] auto select(std::span<const ToolDefinition> tools, std::string_view query, size_t k)
+        -> Result<std::vector<ToolDefinition>>;
+
+    /// @brief Loads embeddings written by save(), replacing the current ones.
+    [[nodiscard]] auto load(std::filesystem::path const& path) -> VoidResult;
+
+    /// @brief Writes all embeddings to @p path; parent directories are created as needed.
+    [[nodiscard]] auto save(std::filesystem::path const& path) const -> VoidResult;
+
+    /// @brief Drops all embeddings, e.g. when the embedding model changed.
+    void clear() noexcept { _embeddings.clear(); }
+
+    /// @brief Returns the number of stored embeddings.
+    [[nodiscard]] auto size() const noexcept -> size_t { return _embeddings.size(); }
+
+    /// @brief Returns the text a tool is embedded from.
+    [[nodiscard]] static auto embeddingText(ToolDefinition const& tool) -> std::string;
+
+  private:
+    EmbedFn _embed;
+    std::unordered_map<std::uint64_t, std::vector<float>> _embeddings; ///< Keyed by embedding text hash.
+};
+
+} // namespace mychat
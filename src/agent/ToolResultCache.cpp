@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ToolResultCache.hpp"
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+    /// @brief Estimates the bytes an entry holds: its key, text and the blobs it owns a share of.
+    auto entryBytes(std::string const& key, ToolResult const& result) -> std::size_t
+    {
+        auto bytes = key.size() + result.callId.size() + result.content.size();
+        for (auto const& blob: result.blobs)
+            bytes += blob.mimeType.size() + blob.uri.size() + (blob.data ? blob.data->size() : 0);
+        return bytes;
+    }
+} // namespace
+
+ToolResultCache::ToolResultCache(std::size_t capacity):
+    _capacity(std::max(capacity, std::size_t { 1 })),
+    _memory(memoryRegistry().open(
+        "Tool results", MemoryCategory::Caches, [this](std::size_t bytes) { return reclaim(bytes); }))
+{
+}
+
+auto ToolResultCache::makeKey(std::string_view server, std::string_view tool, nlohmann::json const& arguments)
+    -> std::string
+{
+    return std::format("{}\x1f{}\x1f{}", server, tool, arguments.dump());
+}
+
+auto ToolResultCache::lookup(std::string const& key, Clock::time_point now) -> std::optional<ToolResult>
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto const it = _index.find(key);
+    if (it == _index.end())
+    {
+        ++_misses;
+        return std::nullopt;
+    }
+    if (it->second->expiresAt <= now)
+    {
+        erase(it->second);
+        ++_misses;
+        return std::nullopt;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+    ++_hits;
+    return it->second->result;
+}
+
+void ToolResultCache::store(std::string key, ToolResult result, Clock::duration ttl, Clock::time_point now)
+{
+    if (result.isError || ttl <= Clock::duration::zero())
+        return;
+
+    auto const lock = std::lock_guard(_mutex);
+    if (auto const it = _index.find(key); it != _index.end())
+        erase(it->second);
+    if (_entries.size() >= _capacity)
+        erase(std::prev(_entries.end()));
+
+    auto const bytes = entryBytes(key, result);
+    _entries.push_front(
+        Entry { .key = key, .result = std::move(result), .expiresAt = now + ttl, .bytes = bytes });
+    _index.emplace(std::move(key), _entries.begin());
+    _bytes += bytes;
+    _memory.set(_bytes);
+}
+
+void ToolResultCache::clear()
+{
+    auto const lock = std::lock_guard(_mutex);
+    _entries.clear();
+    _index.clear();
+    _bytes = 0;
+    _memory.set(0);
+}
+
+auto ToolResultCache::size() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _entries.size();
+}
+
+auto ToolResultCache::bytes() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _bytes;
+}
+
+auto ToolResultCache::reclaim(std::size_t bytes) -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto const before = _bytes;
+    while (!_entries.empty() && before - _bytes < bytes)
+        erase(std::prev(_entries.end()));
+    return before - _bytes;
+}
+
+auto ToolResultCache::hits() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _hits;
+}
+
+auto ToolResultCache::misses() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _misses;
+}
+
+void ToolResultCache::erase(std::list<Entry>::iterator it)
+{
+    _bytes -= it->bytes;
+    _memory.set(_bytes);
+    _index.erase(it->key);
+    _entries.erase(it);
+}
+
+} // namespace mychat
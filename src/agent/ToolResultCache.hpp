@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/MemoryRegistry.hpp>
+#include <core/Types.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mychat
+{
+
+/// @brief Memoizes results of idempotent tool calls.
+///
+/// Entries are keyed by server, tool name and arguments, expire after a per-entry TTL and
+/// are evicted least-recently-used first once the capacity is reached. Its size is reported
+/// to memoryRegistry(), which may shrink it when over budget. Safe to use from several threads.
+class ToolResultCache
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Constructs a cache holding at most @p capacity results.
+    explicit ToolResultCache(std::size_t capacity);
+
+    /// @brief Builds the cache key of a call.
+    ///
+    /// nlohmann::json keeps object members sorted, so argument objects that only differ in
+    /// member order yield the same key.
+    [[nodiscard]] static auto makeKey(std::string_view server,
+                                      std::string_view tool,
+                                      nlohmann::json const& arguments) -> std::string;
+
+    /// @brief Returns the cached result for @p key, if present and not expired.
+    [[nodiscard]] auto lookup(std::string const& key, Clock::time_point now = Clock::now())
+        -> std::optional<ToolResult>;
+
+    /// @brief Stores a result; error results are not cached.
+    void store(std::string key,
+               ToolResult result,
+               Clock::duration ttl,
+               Clock::time_point now = Clock::now());
+
+    /// @brief Drops all entries (the counters are kept).
+    void clear();
+
+    /// @brief Returns the number of cached results.
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /// @brief Returns the approximate bytes held by the cached results.
+    [[nodiscard]] auto bytes() const -> std::size_t;
+
+    /// @brief Evicts least recently used entries until at least @p bytes were freed or it is empty.
+    /// @return The bytes freed.
+    auto reclaim(std::size_t bytes) -> std::size_t;
+
+    /// @brief Returns how many lookups were answered from the cache.
+    [[nodiscard]] auto hits() const -> std::size_t;
+
+    /// @brief Returns how many lookups found no usable entry.
+    [[nodiscard]] auto misses() const -> std::size_t;
+
+  private:
+    struct Entry
+    {
+        std::string key;
+        ToolResult result;
+        Clock::time_point expiresAt;
+        std::size_t bytes = 0; ///< What the entry holds, as counted by entryBytes().
+    };
+
+    mutable std::mutex _mutex;
+    std::size_t _capacity;
+    std::list<Entry> _entries; ///< Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    std::size_t _hits = 0;
+    std::size_t _misses = 0;
+    std::size_t _bytes = 0;
+    MemoryAccount _memory; ///< Declared last, so it closes before the entries are destroyed.
+
+    /// @brief Removes the entry at @p it; the caller holds the mutex.
+    void erase(std::list<Entry>::iterator it);
+};
+
+} // namespace mychat
@@ -2,26 +2,42 @@
 
 #include "AudioCapture.hpp"
 
+#include "Dsp.hpp"
+#include "Resampler.hpp"
+
 #include <core/Log.hpp>
 
 #include <miniaudio.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cctype>
-#include <cmath>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace mychat
 {
 
 struct AudioCapture::Impl
 {
+    /// Sample rate delivered to the callback, as speech recognition expects it.
+    static constexpr auto OutputRate = 16000u;
+
+    /// Frames converted per block when the device does not deliver 16 kHz float mono itself.
+    static constexpr auto ScratchFrames = size_t { 1024 };
+
     ma_context context {};
     ma_device device {};
     AudioCallback callback;
     std::atomic<float> peakLevel { 0.0f };
+    ma_format format = ma_format_f32; ///< Sample format the device delivers.
+    unsigned channels = 1;            ///< Channels the device delivers.
+    std::array<float, ScratchFrames> scratch {};
+    std::optional<Resampler> resampler; ///< Set when the device runs at another rate than 16 kHz.
+    std::vector<float> resampled;       ///< Output of the resampler for one block.
     bool contextInitialized = false;
     bool capturing = false;
     bool initialized = false;
@@ -33,18 +49,50 @@ namespace
     void audioDataCallback(ma_device* device, void* /*output*/, const void* input, ma_uint32 frameCount)
     {
         auto* impl = static_cast<AudioCapture::Impl*>(device->pUserData);
-        if (impl && impl->callback && input)
+        if (!impl || !impl->callback || !input)
+            return;
+
+        auto const floatMono = impl->format == ma_format_f32 && impl->channels == 1;
+        if (floatMono && !impl->resampler)
         {
-            auto const* samples = static_cast<const float*>(input);
+            auto const samples = std::span<const float>(static_cast<const float*>(input), frameCount);
+            // Peak amplitude for the voice meter (lock-free)
+            impl->peakLevel.store(dsp::measure(samples).peak, std::memory_order_relaxed);
+            impl->callback(samples);
+            return;
+        }
 
-            // Compute peak amplitude for the voice meter (lock-free)
-            auto peak = 0.0f;
-            for (auto i = ma_uint32 { 0 }; i < frameCount; ++i)
-                peak = std::max(peak, std::abs(samples[i]));
-            impl->peakLevel.store(peak, std::memory_order_relaxed);
+        // Convert to 16 kHz float mono in fixed-size blocks, so the audio thread never allocates.
+        auto peak = 0.0f;
+        for (auto offset = size_t { 0 }; offset < frameCount;)
+        {
+            auto const frames = std::min(AudioCapture::Impl::ScratchFrames, frameCount - offset);
+            auto const first = offset * impl->channels;
+            auto const count = frames * impl->channels;
+            auto mono = std::span<const float>(static_cast<const float*>(input) + first, count);
+            if (!floatMono)
+            {
+                auto const scratch = std::span<float>(impl->scratch).first(frames);
+                if (impl->format == ma_format_s16)
+                    dsp::downmix(std::span(static_cast<const std::int16_t*>(input) + first, count),
+                                 impl->channels,
+                                 scratch);
+                else
+                    dsp::downmix(mono, impl->channels, scratch);
+                mono = scratch;
+            }
 
-            impl->callback(std::span<const float>(samples, frameCount));
+            peak = std::max(peak, dsp::measure(mono).peak);
+            if (impl->resampler)
+            {
+                auto const written = impl->resampler->process(mono, impl->resampled);
+                impl->callback(std::span(impl->resampled).first(written));
+            }
+            else
+                impl->callback(mono);
+            offset += frames;
         }
+        impl->peakLevel.store(peak, std::memory_order_relaxed);
     }
 
 } // namespace
@@ -136,25 +184,46 @@ auto AudioCapture::initialize(AudioCallback callback, std::string_view deviceNam
                      static_cast<int>(enumResult));
     }
 
+    // Open the device in its own format, channel count and rate and convert on our side: asking
+    // for 16 kHz makes many backends add latency, and miniaudio's generic converter is slower.
     auto deviceConfig = ma_device_config_init(ma_device_type_capture);
-    deviceConfig.capture.format = ma_format_f32;
-    deviceConfig.capture.channels = 1;
-    deviceConfig.sampleRate = 16000;
+    deviceConfig.capture.format = ma_format_unknown;
+    deviceConfig.capture.channels = 0;
+    deviceConfig.sampleRate = 0;
     deviceConfig.dataCallback = audioDataCallback;
     deviceConfig.pUserData = _impl.get();
 
     if (matchedDeviceId)
         deviceConfig.capture.pDeviceID = &*matchedDeviceId;
 
-    auto const result = ma_device_init(&_impl->context, &deviceConfig, &_impl->device);
+    auto result = ma_device_init(&_impl->context, &deviceConfig, &_impl->device);
+    if (result == MA_SUCCESS && _impl->device.capture.format != ma_format_f32
+        && _impl->device.capture.format != ma_format_s16)
+    {
+        // Formats without a conversion kernel are converted to float by miniaudio.
+        ma_device_uninit(&_impl->device);
+        deviceConfig.capture.format = ma_format_f32;
+        result = ma_device_init(&_impl->context, &deviceConfig, &_impl->device);
+    }
     if (result != MA_SUCCESS)
         return makeError(ErrorCode::AudioError,
                          std::format("Failed to initialize audio device: {}", static_cast<int>(result)));
 
+    _impl->format = _impl->device.capture.format;
+    _impl->channels = std::max(1u, static_cast<unsigned>(_impl->device.capture.channels));
+    auto const deviceRate = static_cast<unsigned>(_impl->device.sampleRate);
+    if (deviceRate != Impl::OutputRate)
+    {
+        _impl->resampler.emplace(deviceRate, Impl::OutputRate);
+        _impl->resampled.resize(_impl->resampler->maxOutputFrames(Impl::ScratchFrames));
+    }
     log::info("Audio capture device: {}", _impl->device.capture.name);
 
     _impl->initialized = true;
-    log::info("Audio capture initialized (16kHz, mono, float32)");
+    log::info("Audio capture initialized ({}Hz, {} channel(s) of {}, converted to 16kHz mono float32)",
+              deviceRate,
+              _impl->channels,
+              ma_get_format_name(_impl->format));
     return {};
 }
 
@@ -184,6 +253,12 @@ void AudioCapture::stop()
     ma_device_stop(&_impl->device);
     _impl->capturing = false;
     log::info("Audio capture stopped");
+
+    if (auto const& resampler = _impl->resampler; resampler && resampler->processedFrames() > 0)
+        log::debug("Audio capture: resampling {}Hz to {}Hz took {:.2f}% of real time",
+                   resampler->inputRate(),
+                   resampler->outputRate(),
+                   resampler->realTimeFactor() * 100.0);
 }
 
 auto AudioCapture::isCapturing() const -> bool
@@ -1,28 +1,25 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <audio/AudioSource.hpp>
 #include <core/Error.hpp>
 
-#include <functional>
 #include <memory>
-#include <span>
 #include <string_view>
+#include <utility>
 
 namespace mychat
 {
 
-/// @brief Callback invoked when audio data is captured.
-/// @param samples Float32 PCM samples at 16kHz mono.
-using AudioCallback = std::function<void(std::span<const float> samples)>;
-
 /// @brief Captures audio from the microphone using miniaudio.
 ///
-/// Captures float32 PCM audio at 16kHz mono, suitable for speech recognition.
-class AudioCapture
+/// Captures float32 PCM audio at 16kHz mono, suitable for speech recognition. The device runs in its
+/// native format and rate; downmixing and resampling happen in the capture callback.
+class AudioCapture: public AudioSource
 {
   public:
     AudioCapture();
-    ~AudioCapture();
+    ~AudioCapture() override;
 
     AudioCapture(const AudioCapture&) = delete;
     AudioCapture& operator=(const AudioCapture&) = delete;
@@ -32,22 +29,28 @@ class AudioCapture
     /// @param deviceName Optional substring to match against capture device names (case-insensitive).
     ///                   If empty, the system default capture device is used.
     /// @return Success or an error.
-    [[nodiscard]] auto initialize(AudioCallback callback, std::string_view deviceName = {}) -> VoidResult;
+    [[nodiscard]] auto initialize(AudioCallback callback, std::string_view deviceName) -> VoidResult;
+
+    /// @brief Initializes the system default capture device.
+    [[nodiscard]] auto initialize(AudioCallback callback) -> VoidResult override
+    {
+        return initialize(std::move(callback), {});
+    }
 
     /// @brief Starts capturing audio.
     /// @return Success or an error.
-    [[nodiscard]] auto start() -> VoidResult;
+    [[nodiscard]] auto start() -> VoidResult override;
 
     /// @brief Stops capturing audio.
-    void stop();
+    void stop() override;
 
     /// @brief Returns true if currently capturing.
-    [[nodiscard]] auto isCapturing() const -> bool;
+    [[nodiscard]] auto isCapturing() const -> bool override;
 
     /// @brief Returns the current peak audio level (0.0 to 1.0).
     ///
     /// Updated atomically from the audio callback thread. Safe to call from any thread.
-    [[nodiscard]] auto peakLevel() const -> float;
+    [[nodiscard]] auto peakLevel() const -> float override;
 
     // Impl must be accessible from the C audio callback
     struct Impl;
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "AudioFileSource.hpp"
+
+#include "Dsp.hpp"
+#include "Resampler.hpp"
+
+#include <core/Log.hpp>
+
+#include <miniaudio.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    constexpr auto OutputRate = 16000u;
+
+    /// @brief Frames decoded per read.
+    constexpr auto DecodeFrames = size_t { 4096 };
+
+} // namespace
+
+auto decodeAudioFile(std::filesystem::path const& path) -> Result<std::vector<float>>
+{
+    // Decoded in the file's own channels and rate and converted like captured audio is.
+    auto decoderConfig = ma_decoder_config_init(ma_format_f32, 0, 0);
+    auto decoder = ma_decoder {};
+    if (auto const result = ma_decoder_init_file(path.string().c_str(), &decoderConfig, &decoder);
+        result != MA_SUCCESS)
+        return makeError(
+            ErrorCode::AudioError,
+            std::format("Cannot decode audio file {}: {}", path.string(), static_cast<int>(result)));
+
+    auto const channels = std::max(1u, static_cast<unsigned>(decoder.outputChannels));
+    auto const rate = static_cast<unsigned>(decoder.outputSampleRate);
+    auto resampler = std::optional<Resampler> {};
+    if (rate != OutputRate)
+        resampler.emplace(rate, OutputRate);
+
+    auto interleaved = std::vector<float>(DecodeFrames * channels);
+    auto mono = std::vector<float>(DecodeFrames);
+    auto resampled = std::vector<float>(resampler ? resampler->maxOutputFrames(DecodeFrames) : 0);
+    auto samples = std::vector<float> {};
+    while (true)
+    {
+        auto frames = ma_uint64 { 0 };
+        auto const result = ma_decoder_read_pcm_frames(&decoder, interleaved.data(), DecodeFrames, &frames);
+        if (frames > 0)
+        {
+            auto const block = std::span(mono).first(static_cast<size_t>(frames));
+            dsp::downmix(std::span<const float>(interleaved).first(block.size() * channels), channels, block);
+            if (resampler)
+            {
+                auto const written = resampler->process(block, resampled);
+                samples.insert(samples.end(), resampled.begin(), resampled.begin() + written);
+            }
+            else
+                samples.insert(samples.end(), block.begin(), block.end());
+        }
+        if (result != MA_SUCCESS || frames == 0)
+            break;
+    }
+    ma_decoder_uninit(&decoder);
+
+    log::info("Decoded {} ({}Hz, {} channel(s)): {:.1f} s of audio",
+              path.string(),
+              rate,
+              channels,
+              static_cast<double>(samples.size()) / OutputRate);
+    return samples;
+}
+
+AudioFileSource::AudioFileSource(AudioFileSourceConfig config): _config(std::move(config))
+{
+}
+
+AudioFileSource::~AudioFileSource()
+{
+    stop();
+}
+
+auto AudioFileSource::initialize(AudioCallback callback) -> VoidResult
+{
+    auto samples = decodeAudioFile(_config.path);
+    if (!samples)
+        return std::unexpected(samples.error());
+
+    _callback = std::move(callback);
+    _samples = std::move(*samples);
+    _fileSamples = _samples.size();
+    auto const silenceMs = std::max(0.0f, _config.trailingSilenceMs);
+    auto const silence = static_cast<size_t>(silenceMs / 1000.0f * static_cast<float>(OutputRate));
+    _samples.resize(_fileSamples + silence, 0.0f);
+    _position = 0;
+    _finished = _samples.empty();
+    return {};
+}
+
+auto AudioFileSource::start() -> VoidResult
+{
+    if (!_callback)
+        return makeError(ErrorCode::AudioError, "Audio file source not initialized");
+    if (!_thread.joinable())
+        _thread = std::jthread([this](std::stop_token stopToken) { deliver(std::move(stopToken)); });
+    return {};
+}
+
+void AudioFileSource::stop()
+{
+    _thread = {};
+}
+
+auto AudioFileSource::isCapturing() const -> bool
+{
+    return _thread.joinable() && !_finished;
+}
+
+auto AudioFileSource::peakLevel() const -> float
+{
+    return _peakLevel.load(std::memory_order_relaxed);
+}
+
+auto AudioFileSource::finished() const -> bool
+{
+    return _finished;
+}
+
+auto AudioFileSource::fileSamples() const -> std::size_t
+{
+    return _fileSamples;
+}
+
+void AudioFileSource::deliver(std::stop_token stopToken)
+{
+    // Paced from where this start() continues, so a pause does not make up for lost time.
+    using Clock = std::chrono::steady_clock;
+    auto const startedAt = Clock::now();
+    auto const startedFrom = _position;
+    auto const chunkTime = [this](size_t samples) {
+        auto const seconds = static_cast<double>(samples) / OutputRate / _config.speed;
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+
+    auto mutex = std::mutex {};
+    auto lock = std::unique_lock(mutex);
+    auto wakeup = std::condition_variable_any {};
+    while (_position < _samples.size())
+    {
+        // A chunk is delivered once it would have been recorded, as capture devices do.
+        auto const size = std::min(ChunkSamples, _samples.size() - _position);
+        if (_config.speed > 0.0)
+        {
+            auto const due = startedAt + chunkTime(_position + size - startedFrom);
+            wakeup.wait_until(lock, stopToken, due, [] { return false; });
+        }
+        if (stopToken.stop_requested())
+            break;
+
+        auto const chunk = std::span<const float>(_samples).subspan(_position, size);
+        _peakLevel.store(dsp::measure(chunk).peak, std::memory_order_relaxed);
+        _callback(chunk);
+        _position += size;
+    }
+    if (_position == _samples.size())
+    {
+        _peakLevel.store(0.0f, std::memory_order_relaxed);
+        _finished = true;
+    }
+}
+
+} // namespace mychat
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <audio/AudioSource.hpp>
+#include <core/Error.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Decodes an audio file (WAV, FLAC or MP3) into float32 PCM at 16kHz mono.
+[[nodiscard]] auto decodeAudioFile(std::filesystem::path const& path) -> Result<std::vector<float>>;
+
+/// @brief Configuration of an AudioFileSource.
+struct AudioFileSourceConfig
+{
+    std::filesystem::path path;
+
+    /// @brief How many times faster than real time the audio is delivered; 0 delivers it at once.
+    ///
+    /// AudioPipeline buffers only a few seconds of audio its worker has not got to yet, so
+    /// delivering much faster than it transcribes drops samples.
+    double speed = 1.0;
+
+    /// @brief Silence delivered after the file, so that voice activity detection ends its last utterance.
+    float trailingSilenceMs = 2000.0f;
+};
+
+/// @brief Plays an audio file into the pipeline in place of the microphone, to measure voice
+///        latency reproducibly.
+///
+/// The file is decoded by initialize(), so delivering it costs no more than capturing does. It is
+/// delivered in chunks of 10 ms, as capture devices do, from a thread of its own. stop() pauses the
+/// delivery and start() continues it.
+class AudioFileSource: public AudioSource
+{
+  public:
+    /// @brief Samples per chunk, 10 ms.
+    static constexpr auto ChunkSamples = std::size_t { 160 };
+
+    explicit AudioFileSource(AudioFileSourceConfig config);
+    ~AudioFileSource() override;
+
+    AudioFileSource(const AudioFileSource&) = delete;
+    AudioFileSource& operator=(const AudioFileSource&) = delete;
+
+    [[nodiscard]] auto initialize(AudioCallback callback) -> VoidResult override;
+    [[nodiscard]] auto start() -> VoidResult override;
+    void stop() override;
+    [[nodiscard]] auto isCapturing() const -> bool override;
+    [[nodiscard]] auto peakLevel() const -> float override;
+
+    /// @brief Returns true once the file and the trailing silence have been delivered.
+    [[nodiscard]] auto finished() const -> bool;
+
+    /// @brief Returns the length of the decoded file, without the trailing silence, in samples.
+    [[nodiscard]] auto fileSamples() const -> std::size_t;
+
+  private:
+    /// @brief Delivers the remaining chunks, at the configured speed, until stopped.
+    void deliver(std::stop_token stopToken);
+
+    AudioFileSourceConfig _config;
+    AudioCallback _callback;
+    std::vector<float> _samples;  ///< The file followed by the trailing silence.
+    std::size_t _fileSamples = 0; ///< Of _samples, those of the file.
+    std::size_t _position = 0;    ///< The next sample to deliver; only touched by the delivering thread.
+    std::atomic<float> _peakLevel = 0.0f;
+    std::atomic<bool> _finished = false;
+    std::jthread _thread;
+};
+
+} // namespace mychat
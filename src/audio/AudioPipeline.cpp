@@ -2,86 +2,380 @@
 #include "AudioPipeline.hpp"
 
 #include <core/Log.hpp>
-
+#include <core/MemoryRegistry.hpp>
+#include <core/SpscQueue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace mychat
 {
 
+namespace
+{
+
+    constexpr auto SampleRate = 16000;
+
+    /// @brief Captured audio the worker may fall behind by before samples are dropped.
+    constexpr auto RingSamples = size_t { SampleRate * 4 };
+
+    /// @brief Shortest window a pause finishes while streaming, so whisper has enough context.
+    constexpr auto MinCommitSamples = size_t { SampleRate * 3 / 2 };
+
+    /// @brief Longest window while streaming; it is finished mid-speech if no pause comes.
+    constexpr auto MaxWindowSamples = size_t { SampleRate * 8 };
+
+    /// @brief Fixed-capacity history of the most recent samples; older ones are overwritten.
+    class SampleHistory
+    {
+      public:
+        /// @brief Allocates room for @p capacity samples and forgets all samples.
+        void reset(size_t capacity)
+        {
+            _samples.assign(capacity, 0.0f);
+            _next = 0;
+            _size = 0;
+        }
+
+        void push(std::span<const float> samples)
+        {
+            auto const capacity = _samples.size();
+            if (capacity == 0)
+                return;
+            for (auto const sample: samples.last(std::min(samples.size(), capacity)))
+            {
+                _samples[_next] = sample;
+                _next = (_next + 1) % capacity;
+            }
+            _size = std::min(capacity, _size + samples.size());
+        }
+
+        /// @brief Appends the remembered samples to @p out, oldest first.
+        void appendTo(std::vector<float>& out) const
+        {
+            auto const capacity = _samples.size();
+            auto const start = (_next + capacity - _size) % (capacity == 0 ? 1 : capacity);
+            for (auto i = size_t { 0 }; i < _size; ++i)
+                out.push_back(_samples[(start + i) % capacity]);
+        }
+
+        void clear() noexcept { _size = 0; }
+
+      private:
+        std::vector<float> _samples;
+        size_t _next = 0; ///< Where the next sample goes.
+        size_t _size = 0; ///< How many samples are remembered.
+    };
+
+    /// @brief Echo coupling assumed before any has been measured: the echo is as loud as the playback.
+    constexpr auto InitialEchoCoupling = 1.0f;
+
+    /// @brief How much louder than the expected echo a frame must be to count as speech.
+    constexpr auto EchoMargin = 2.0f;
+
+    /// @brief Weight of each new measurement in the running echo coupling estimate.
+    constexpr auto EchoAdaptation = 0.05f;
+
+    /// @brief Playback quieter than this (about -46 dBFS) is not worth suppressing.
+    constexpr auto MinEchoReferenceLevel = 0.005f;
+
+    /// @brief How often the worker looks for new samples.
+    constexpr auto PollInterval = std::chrono::milliseconds(10);
+
+} // namespace
+
 struct AudioPipeline::Impl
 {
+    /// @brief What the worker does next with the utterance being captured.
+    enum class Step : std::uint8_t
+    {
+        Idle,    ///< Wait for more audio.
+        Partial, ///< Transcribe the window for a partial hypothesis.
+        Commit,  ///< Transcribe the window up to a pause and start a new window after it.
+        Final,   ///< The utterance ended; transcribe the window and deliver the whole text.
+    };
+
     AudioPipelineConfig config;
     TranscriptionCallback callback;
+    TranscriptionCallback partialCallback;    ///< Set if the utterance is transcribed while it goes on.
+    SpeechStartCallback speechStartCallback;  ///< Guarded by consumerMutex.
+    SpeechEndCallback speechEndCallback;      ///< Guarded by consumerMutex.
+    EchoReference echoReference;              ///< Guarded by consumerMutex.
+    float echoCoupling = InitialEchoCoupling; ///< Microphone level per unit of playback level.
 
-    AudioCapture capture;
+    std::unique_ptr<AudioSource> source; ///< The capture device, unless another source was set.
     VoiceActivityDetector vad;
     Transcriber transcriber;
 
-    std::vector<float> audioBuffer;
-    std::mutex bufferMutex;
-
-    bool active = false;
-    bool recording = false;
+    /// Samples handed over by the capture callback, the only producer. It never blocks, locks or
+    /// allocates; whoever holds consumerMutex drains the ring.
+    SpscQueue<float> ring { RingSamples };
+    std::atomic<bool> recording = false;
+    std::atomic<size_t> droppedSamples = 0; ///< Samples the capture callback found no room for.
+
+    std::mutex consumerMutex; ///< Guards the ring's consumer side and the members below.
+    std::condition_variable_any wakeup;
+    std::vector<float> audioBuffer; ///< The utterance or push-to-talk recording so far; preallocated.
+    size_t maxUtteranceSamples = 0; ///< The capacity of audioBuffer, never exceeded.
+    SampleHistory preRoll;          ///< The audio right before speech starts, so onsets are kept.
+    std::vector<float> frame;       ///< The VAD frame being filled.
+    size_t frameFill = 0;
+    bool truncated = false;         ///< Whether the push-to-talk recording hit maxUtteranceSamples.
     bool speechDetected = false;
     int silenceFrames = 0;
     int silenceThresholdFrames = 0; // Computed from silenceDurationMs
 
+    // Streaming transcription of the current utterance; audioBuffer holds the current window
+    std::string committedText; ///< Final text of the windows before.
+    std::vector<float> window; ///< The copy of audioBuffer being transcribed, reused.
+    size_t samplesSincePartial = 0;
+    size_t partialIntervalSamples = 0;
+    uint64_t generation = 0; ///< Bumped whenever captured audio is discarded.
+
+    bool active = false;
+    MemoryAccount memory = memoryRegistry().open("Voice input buffers", MemoryCategory::AudioBuffers);
+    std::jthread worker;
+
+    /// @brief Runs on the capture device's real-time thread.
     void handleAudioData(std::span<const float> samples)
     {
-        if (!recording)
+        if (!recording.load(std::memory_order_relaxed))
             return;
 
-        if (config.mode == AudioMode::VoiceActivityDetection)
+        auto const pushed = ring.tryPushSome(samples);
+        if (pushed < samples.size())
+            droppedSamples.fetch_add(samples.size() - pushed, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto streaming() const noexcept -> bool { return partialIntervalSamples > 0; }
+
+    /// @brief Discards all captured audio and the VAD state. Requires consumerMutex.
+    void clear()
+    {
+        auto scratch = std::span(frame);
+        while (ring.tryPopSome(scratch) > 0)
+            ;
+        audioBuffer.clear();
+        preRoll.clear();
+        frameFill = 0;
+        truncated = false;
+        speechDetected = false;
+        silenceFrames = 0;
+        committedText.clear();
+        samplesSincePartial = 0;
+        ++generation;
+        vad.reset();
+    }
+
+    /// @brief Moves the captured samples to audioBuffer, as push-to-talk records. Requires consumerMutex.
+    void drainRecording()
+    {
+        while (true)
         {
-            auto probability = vad.process(samples);
-            if (!probability)
+            auto const size = audioBuffer.size();
+            if (size == maxUtteranceSamples)
+            {
+                if (!std::exchange(truncated, true))
+                    log::warning("Push-to-talk: recording reached the maximum length, ignoring the rest");
+                auto scratch = std::span(frame);
+                while (ring.tryPopSome(scratch) > 0)
+                    ;
                 return;
+            }
+            audioBuffer.resize(std::min(size + VoiceActivityDetector::FrameSamples, maxUtteranceSamples));
+            auto const popped = ring.tryPopSome(std::span(audioBuffer).subspan(size));
+            audioBuffer.resize(size + popped);
+            if (popped == 0)
+                return;
+        }
+    }
+
+    /// @brief Returns true if the current frame is likely just the echo of what is played back.
+    ///
+    /// Frames that are taken for echo refine the estimate of how much of the playback comes back.
+    [[nodiscard]] auto isEcho() -> bool
+    {
+        if (!echoReference)
+            return false;
+        auto const reference = echoReference();
+        if (reference < MinEchoReferenceLevel)
+            return false;
+
+        auto const coupling = VoiceActivityDetector::rmsLevel(frame) / reference;
+        if (coupling >= EchoMargin * echoCoupling)
+            return false;
+        echoCoupling += EchoAdaptation * (coupling - echoCoupling);
+        return true;
+    }
+
+    /// @brief Ends the utterance being captured. Requires consumerMutex.
+    [[nodiscard]] auto endUtterance() -> Step
+    {
+        speechDetected = false;
+        silenceFrames = 0;
+        if (speechEndCallback)
+            speechEndCallback();
+        return Step::Final;
+    }
+
+    /// @brief Runs the VAD over the captured samples, frame by frame. Requires consumerMutex.
+    /// @return What to transcribe, once there is something to.
+    [[nodiscard]] auto drainUtterance() -> Step
+    {
+        while (true)
+        {
+            frameFill += ring.tryPopSome(std::span(frame).subspan(frameFill));
+            if (frameFill < frame.size())
+                return Step::Idle;
+            frameFill = 0;
+
+            auto probability = vad.process(frame);
+            if (!probability)
+                continue;
 
-            if (VoiceActivityDetector::isSpeech(*probability, config.vadThreshold))
+            auto const isSpeech =
+                VoiceActivityDetector::isSpeech(*probability, config.vadThreshold) && !isEcho();
+            if (!isSpeech && !speechDetected)
+            {
+                preRoll.push(frame);
+                continue;
+            }
+
+            if (isSpeech && !speechDetected)
+            {
+                preRoll.appendTo(audioBuffer);
+                preRoll.clear();
+                if (speechStartCallback)
+                    speechStartCallback();
+            }
+            audioBuffer.insert(audioBuffer.end(), frame.begin(), frame.end());
+            if (isSpeech)
             {
                 speechDetected = true;
                 silenceFrames = 0;
-
-                auto lock = std::lock_guard(bufferMutex);
-                audioBuffer.insert(audioBuffer.end(), samples.begin(), samples.end());
             }
-            else if (speechDetected)
+            else if (++silenceFrames >= silenceThresholdFrames)
+                return endUtterance();
+
+            // Room for one more frame is left; audioBuffer never grows beyond its preallocation.
+            auto const full = audioBuffer.size() + frame.size() > maxUtteranceSamples;
+            if (!streaming())
             {
-                ++silenceFrames;
+                if (full)
+                    return endUtterance();
+                continue;
+            }
 
-                {
-                    auto lock = std::lock_guard(bufferMutex);
-                    audioBuffer.insert(audioBuffer.end(), samples.begin(), samples.end());
-                }
+            // A pause is a word boundary, so the window can be finished there without cutting words.
+            auto const windowSamples = audioBuffer.size();
+            if ((silenceFrames == 1 && windowSamples >= MinCommitSamples) || windowSamples >= MaxWindowSamples
+                || full)
+                return Step::Commit;
+
+            samplesSincePartial += frame.size();
+            if (samplesSincePartial >= partialIntervalSamples)
+                return Step::Partial;
+        }
+    }
+
+    /// @brief Transcribes window with the committed text as context, without holding @p lock.
+    /// @return The text, empty if transcription failed, or std::nullopt if the audio was
+    ///         discarded meanwhile.
+    [[nodiscard]] auto transcribeWindow(std::unique_lock<std::mutex>& lock) -> std::optional<std::string>
+    {
+        auto const prompt = committedText;
+        auto const startedIn = generation;
+
+        // Pausing or resuming must not wait for whisper.
+        lock.unlock();
+        auto result = transcriber.transcribe(window, prompt);
+        lock.lock();
+
+        if (generation != startedIn)
+            return std::nullopt;
+        if (!result)
+        {
+            log::error("Transcription failed: {}", result.error().message);
+            return std::string {};
+        }
+        return std::move(*result);
+    }
+
+    /// @brief Returns @p text appended to the committed text.
+    [[nodiscard]] auto withCommitted(std::string_view text) const -> std::string
+    {
+        if (committedText.empty() || text.empty())
+            return committedText.empty() ? std::string(text) : committedText;
+        return committedText + ' ' + std::string(text);
+    }
+
+    /// @brief Carries out @p step for the current utterance. Requires consumerMutex, via @p lock.
+    void transcribe(std::unique_lock<std::mutex>& lock, Step step)
+    {
+        samplesSincePartial = 0;
+        window.assign(audioBuffer.begin(), audioBuffer.end());
+        if (step != Step::Partial)
+            audioBuffer.clear(); // The next window starts after this one.
 
-                if (silenceFrames >= silenceThresholdFrames)
+        auto const text = transcribeWindow(lock);
+        if (!text)
+            return; // The utterance was discarded, and so is its state.
+
+        switch (step)
+        {
+            case Step::Idle: break;
+            case Step::Partial:
+                if (!text->empty())
+                    partialCallback(withCommitted(*text));
+                break;
+            case Step::Commit:
+                committedText = withCommitted(*text);
+                if (!committedText.empty())
+                    partialCallback(committedText);
+                break;
+            case Step::Final: {
+                auto utterance = withCommitted(*text);
+                committedText.clear();
+                if (!utterance.empty())
                 {
-                    speechDetected = false;
-                    silenceFrames = 0;
-
-                    auto buffer = std::vector<float> {};
-                    {
-                        auto lock = std::lock_guard(bufferMutex);
-                        buffer = std::move(audioBuffer);
-                    }
-
-                    if (!buffer.empty())
-                    {
-                        auto result = transcriber.transcribe(buffer);
-                        if (result && !result->empty())
-                        {
-                            log::info("VAD transcription: {}", *result);
-                            callback(std::move(*result));
-                        }
-                    }
+                    log::info("VAD transcription: {}", utterance);
+                    callback(std::move(utterance));
                 }
+                break;
             }
         }
-        else
+    }
+
+    /// @brief Transcribes and delivers what was captured, off the audio thread.
+    void run(std::stop_token stopToken)
+    {
+        auto lock = std::unique_lock(consumerMutex);
+        while (!stopToken.stop_requested())
         {
-            auto lock = std::lock_guard(bufferMutex);
-            audioBuffer.insert(audioBuffer.end(), samples.begin(), samples.end());
+            if (auto const dropped = droppedSamples.exchange(0, std::memory_order_relaxed); dropped > 0)
+                log::warning("Audio pipeline fell behind, dropped {} samples", dropped);
+
+            if (config.mode == AudioMode::PushToTalk)
+                drainRecording();
+            else if (auto const step = drainUtterance(); step != Step::Idle)
+            {
+                transcribe(lock, step);
+                continue;
+            }
+
+            wakeup.wait_for(lock, stopToken, PollInterval, [] { return false; });
         }
     }
 };
@@ -95,20 +389,45 @@ AudioPipeline::~AudioPipeline()
     stop();
 }
 
-auto AudioPipeline::initialize(const AudioPipelineConfig& config, TranscriptionCallback callback)
-    -> VoidResult
+auto AudioPipeline::initialize(const AudioPipelineConfig& config,
+                               TranscriptionCallback callback,
+                               TranscriptionCallback partialCallback) -> VoidResult
 {
     _impl->config = config;
     _impl->callback = std::move(callback);
+    _impl->partialCallback = std::move(partialCallback);
 
-    constexpr auto samplesPerFrame = 512;
-    _impl->silenceThresholdFrames = static_cast<int>((config.silenceDurationMs / 1000.0f) * 16000.0f
-                                                     / static_cast<float>(samplesPerFrame));
+    // Preallocated, so neither speaking nor recording allocates.
+    auto const samplesFor = [](float ms) {
+        return static_cast<size_t>(std::max(0.0f, ms) / 1000.0f * static_cast<float>(SampleRate));
+    };
+    auto const preRollSamples =
+        config.mode == AudioMode::VoiceActivityDetection ? samplesFor(config.preRollMs) : 0;
+    _impl->frame.resize(VoiceActivityDetector::FrameSamples);
+    _impl->preRoll.reset(preRollSamples);
+    _impl->maxUtteranceSamples =
+        std::max(samplesFor(config.maxUtteranceMs), preRollSamples + 2 * VoiceActivityDetector::FrameSamples);
+    _impl->audioBuffer.reserve(_impl->maxUtteranceSamples);
+    _impl->window.reserve(_impl->maxUtteranceSamples);
+    _impl->memory.set(
+        (_impl->ring.capacity() + _impl->audioBuffer.capacity() + _impl->window.capacity() + preRollSamples)
+        * sizeof(float));
+    if (_impl->partialCallback)
+        _impl->partialIntervalSamples = samplesFor(config.partialIntervalMs);
+
+    _impl->silenceThresholdFrames =
+        static_cast<int>((config.silenceDurationMs / 1000.0f) * static_cast<float>(SampleRate)
+                         / static_cast<float>(VoiceActivityDetector::FrameSamples));
 
     auto transConfig = TranscriberConfig {
         .modelPath = config.whisperModelPath,
         .language = config.language,
         .threads = config.transcriptionThreads,
+        .useGpu = config.useGpu,
+        .flashAttention = config.flashAttention,
+        .beamSize = config.beamSize,
+        .reduceAudioContext = config.reduceAudioContext,
+        .warmUp = config.warmUp,
     };
 
     auto transResult = _impl->transcriber.initialize(transConfig);
@@ -126,7 +445,15 @@ auto AudioPipeline::initialize(const AudioPipelineConfig& config, TranscriptionC
         _impl->handleAudioData(samples);
     };
 
-    auto captureResult = _impl->capture.initialize(std::move(captureCallback), config.deviceName);
+    auto captureResult = VoidResult {};
+    if (_impl->source)
+        captureResult = _impl->source->initialize(std::move(captureCallback));
+    else
+    {
+        auto capture = std::make_unique<AudioCapture>();
+        captureResult = capture->initialize(std::move(captureCallback), config.deviceName);
+        _impl->source = std::move(capture);
+    }
     if (!captureResult)
         return captureResult;
 
@@ -140,11 +467,15 @@ auto AudioPipeline::start() -> VoidResult
     if (_impl->active)
         return {};
 
-    auto result = _impl->capture.start();
+    if (!_impl->source)
+        return makeError(ErrorCode::AudioError, "Audio pipeline not initialized");
+
+    auto result = _impl->source->start();
     if (!result)
         return result;
 
     _impl->active = true;
+    _impl->worker = std::jthread([this](std::stop_token stopToken) { _impl->run(std::move(stopToken)); });
 
     if (_impl->config.mode == AudioMode::VoiceActivityDetection)
         _impl->recording = true;
@@ -157,9 +488,13 @@ void AudioPipeline::stop()
     if (!_impl->active)
         return;
 
-    _impl->capture.stop();
-    _impl->active = false;
+    _impl->source->stop();
     _impl->recording = false;
+    _impl->worker = {};
+    _impl->active = false;
+
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->clear();
 }
 
 void AudioPipeline::startRecording()
@@ -167,8 +502,8 @@ void AudioPipeline::startRecording()
     if (_impl->config.mode != AudioMode::PushToTalk)
         return;
 
-    auto lock = std::lock_guard(_impl->bufferMutex);
-    _impl->audioBuffer.clear();
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->clear();
     _impl->recording = true;
     log::debug("Push-to-talk: recording started");
 }
@@ -182,8 +517,11 @@ void AudioPipeline::stopRecording()
 
     auto buffer = std::vector<float> {};
     {
-        auto lock = std::lock_guard(_impl->bufferMutex);
-        buffer = std::move(_impl->audioBuffer);
+        // Picks up what the worker has not moved out of the ring yet.
+        auto lock = std::lock_guard(_impl->consumerMutex);
+        _impl->drainRecording();
+        buffer = _impl->audioBuffer; // Copied, so the preallocated buffer is kept.
+        _impl->audioBuffer.clear();
     }
 
     if (buffer.empty())
@@ -204,11 +542,9 @@ void AudioPipeline::stopRecording()
 
 void AudioPipeline::pauseRecording()
 {
-    auto lock = std::lock_guard(_impl->bufferMutex);
     _impl->recording = false;
-    _impl->audioBuffer.clear();
-    _impl->speechDetected = false;
-    _impl->silenceFrames = 0;
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->clear();
     log::debug("Audio pipeline: recording paused");
 }
 
@@ -217,14 +553,36 @@ void AudioPipeline::resumeRecording()
     if (!_impl->active)
         return;
 
-    auto lock = std::lock_guard(_impl->bufferMutex);
-    _impl->audioBuffer.clear();
-    _impl->speechDetected = false;
-    _impl->silenceFrames = 0;
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->clear();
     _impl->recording = true;
     log::debug("Audio pipeline: recording resumed");
 }
 
+void AudioPipeline::setSpeechStartCallback(SpeechStartCallback callback)
+{
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->speechStartCallback = std::move(callback);
+}
+
+void AudioPipeline::setSpeechEndCallback(SpeechEndCallback callback)
+{
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->speechEndCallback = std::move(callback);
+}
+
+void AudioPipeline::setAudioSource(std::unique_ptr<AudioSource> source)
+{
+    _impl->source = std::move(source);
+}
+
+void AudioPipeline::setEchoReference(EchoReference reference)
+{
+    auto lock = std::lock_guard(_impl->consumerMutex);
+    _impl->echoReference = std::move(reference);
+    _impl->echoCoupling = InitialEchoCoupling;
+}
+
 auto AudioPipeline::isActive() const -> bool
 {
     return _impl->active;
@@ -232,7 +590,7 @@ auto AudioPipeline::isActive() const -> bool
 
 auto AudioPipeline::peakLevel() const -> float
 {
-    return _impl->capture.peakLevel();
+    return _impl->source ? _impl->source->peakLevel() : 0.0f;
 }
 
 } // namespace mychat
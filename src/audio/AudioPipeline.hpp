@@ -16,6 +16,15 @@ namespace mychat
 /// @brief Callback invoked when speech has been transcribed.
 using TranscriptionCallback = std::function<void(std::string text)>;
 
+/// @brief Callback invoked when the VAD detects the start of speech.
+using SpeechStartCallback = std::function<void()>;
+
+/// @brief Callback invoked when the VAD detects the end of an utterance.
+using SpeechEndCallback = std::function<void()>;
+
+/// @brief Returns the level of audio being played back, see AudioPipeline::setEchoReference().
+using EchoReference = std::function<float()>;
+
 /// @brief Voice input mode.
 enum class AudioMode : std::uint8_t
 {
@@ -34,12 +43,32 @@ struct AudioPipelineConfig
     float vadThreshold = 0.5f;
     float silenceDurationMs = 500.0f;
     int transcriptionThreads = 4;
+
+    /// @brief In VAD mode, how often the ongoing utterance is transcribed for a partial hypothesis.
+    ///
+    /// While streaming, each pause in speech also finishes the current window, so the final pass
+    /// at the end of the utterance only covers the audio since the last pause. 0 disables streaming.
+    float partialIntervalMs = 0.0f;
+
+    /// @brief In VAD mode, how much audio from before speech was detected goes into the utterance.
+    float preRollMs = 300.0f;
+
+    /// @brief The longest utterance or push-to-talk recording; VAD finishes longer utterances early.
+    float maxUtteranceMs = 30000.0f;
+
+    bool useGpu = true;              ///< See TranscriberConfig::useGpu.
+    bool flashAttention = false;     ///< See TranscriberConfig::flashAttention.
+    int beamSize = 1;                ///< See TranscriberConfig::beamSize.
+    bool reduceAudioContext = false; ///< See TranscriberConfig::reduceAudioContext.
+    bool warmUp = true;              ///< See TranscriberConfig::warmUp.
 };
 
 /// @brief Orchestrates audio capture, VAD, and transcription.
 ///
 /// In push-to-talk mode, the user explicitly starts/stops recording.
-/// In VAD mode, speech is automatically detected and transcribed.
+/// In VAD mode, speech is automatically detected and transcribed, optionally while it goes on.
+///
+/// Callbacks are invoked on the pipeline's worker thread, or in push-to-talk mode by stopRecording().
 class AudioPipeline
 {
   public:
@@ -49,12 +78,21 @@ class AudioPipeline
     AudioPipeline(const AudioPipeline&) = delete;
     AudioPipeline& operator=(const AudioPipeline&) = delete;
 
+    /// @brief Has the pipeline take its audio from @p source instead of the capture device.
+    ///
+    /// Must be called before initialize(), which initializes the source. Without one (the default),
+    /// the capture device AudioPipelineConfig::deviceName names is used.
+    void setAudioSource(std::unique_ptr<AudioSource> source);
+
     /// @brief Initializes the audio pipeline components.
     /// @param config Pipeline configuration.
     /// @param callback Called when a transcription is ready.
+    /// @param partialCallback Called with the utterance transcribed so far while it goes on, see
+    ///                        AudioPipelineConfig::partialIntervalMs. Each call supersedes the last.
     /// @return Success or an error.
-    [[nodiscard]] auto initialize(const AudioPipelineConfig& config, TranscriptionCallback callback)
-        -> VoidResult;
+    [[nodiscard]] auto initialize(const AudioPipelineConfig& config,
+                                  TranscriptionCallback callback,
+                                  TranscriptionCallback partialCallback = {}) -> VoidResult;
 
     /// @brief Starts the audio pipeline.
     /// @return Success or an error.
@@ -78,12 +116,32 @@ class AudioPipeline
     /// @brief Resumes audio processing after a pause.
     void resumeRecording();
 
+    /// @brief In VAD mode, sets a callback invoked on the worker thread when speech starts.
+    ///
+    /// It is called as soon as the first frame of an utterance is detected, long before the
+    /// utterance is transcribed, e.g. to stop speech output when the user talks over it.
+    void setSpeechStartCallback(SpeechStartCallback callback);
+
+    /// @brief In VAD mode, sets a callback invoked on the worker thread when an utterance ends.
+    ///
+    /// It is called once AudioPipelineConfig::silenceDurationMs of silence followed the speech
+    /// (or the utterance grew too long), right before the utterance is transcribed.
+    void setSpeechEndCallback(SpeechEndCallback callback);
+
+    /// @brief In VAD mode, sets the level of the audio being played back, for echo suppression.
+    ///
+    /// The microphone picks up what the speakers play. While the reference level is non-zero,
+    /// a frame only counts as speech if it is clearly louder than the expected echo. How much of
+    /// the playback reaches the microphone is estimated from the frames that are not.
+    /// @param reference Called once per VAD frame on the worker thread, or empty to disable.
+    void setEchoReference(EchoReference reference);
+
     /// @brief Returns true if the pipeline is active.
     [[nodiscard]] auto isActive() const -> bool;
 
     /// @brief Returns the current peak audio level (0.0 to 1.0).
     ///
-    /// Delegates to AudioCapture. Safe to call from any thread.
+    /// Delegates to the audio source. Safe to call from any thread.
     [[nodiscard]] auto peakLevel() const -> float;
 
   private:
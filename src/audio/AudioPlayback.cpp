@@ -1,31 +1,109 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "AudioPlayback.hpp"
 
+#include "Resampler.hpp"
+
 #include <core/Log.hpp>
+#include <core/MemoryRegistry.hpp>
+#include <core/SpscQueue.hpp>
 
 #include <miniaudio.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <cmath>
 #include <format>
-#include <mutex>
+#include <optional>
 #include <span>
+#include <thread>
+#include <vector>
 
 namespace mychat
 {
 
+namespace
+{
+
+    /// @brief How often a blocked writer or finishStream() checks the ring buffer again.
+    constexpr auto PollInterval = std::chrono::milliseconds(5);
+
+    /// @brief How many samples write() resamples at a time.
+    constexpr auto ResampleBlockFrames = std::size_t { 4096 };
+
+    /// @brief How long the output level takes to decay by a factor of e after the output stopped.
+    ///
+    /// Long enough to cover the delay until the microphone picks up what was played.
+    constexpr auto OutputLevelDecaySeconds = 0.15f;
+
+} // namespace
+
 struct AudioPlayback::Impl
 {
     ma_device device {};
     bool initialized = false;
+    bool deviceStarted = false; ///< Whether the current stream has started the device.
 
-    // Buffer state — guarded by mutex + signalled via condvar
-    std::span<const float> buffer;
-    std::size_t readPos = 0;
-    std::mutex mutex;
-    std::condition_variable done;
+    /// Samples of the current stream; the streaming thread produces, the device callback consumes.
+    std::unique_ptr<SpscQueue<float>> ring;
     std::atomic<bool> cancelled { false };
+    std::atomic<bool> inputEnded { false }; ///< finishStream() was called; running dry is no underrun.
+
+    std::atomic<std::uint64_t> underruns { 0 };
+    std::atomic<std::uint64_t> silentSamples { 0 }; ///< Zeros inserted by underruns in this stream.
+    std::uint64_t streamUnderruns = 0;               ///< underruns when the current stream began.
+    std::atomic<float> outputLevel { 0.0f };         ///< Decaying RMS level of the output.
+
+    std::optional<Resampler> resampler; ///< Set when the device runs at another rate than the stream.
+    std::vector<float> resampled;       ///< Output of the resampler for one block.
+    MemoryAccount memory = memoryRegistry().open("Playback buffer", MemoryCategory::AudioBuffers);
+
+    /// @brief Stops the device, which also waits for a running callback to return.
+    void stopDevice()
+    {
+        if (deviceStarted)
+            ma_device_stop(&device);
+        deviceStarted = false;
+    }
+
+    /// @brief Queues samples at the device rate, starting the device with the first ones.
+    auto push(std::span<const float> samples) -> VoidResult
+    {
+        while (!samples.empty() && !cancelled.load(std::memory_order_relaxed))
+        {
+            samples = samples.subspan(ring->tryPushSome(samples));
+
+            if (!deviceStarted)
+            {
+                auto const startResult = ma_device_start(&device);
+                if (startResult != MA_SUCCESS)
+                    return makeError(
+                        ErrorCode::AudioError,
+                        std::format("Failed to start playback: {}", static_cast<int>(startResult)));
+                deviceStarted = true;
+            }
+
+            if (!samples.empty())
+                std::this_thread::sleep_for(PollInterval);
+        }
+        return {};
+    }
+
+    /// @brief Converts samples of the stream to the device rate and queues them.
+    auto resampleAndPush(std::span<const float> samples) -> VoidResult
+    {
+        while (!samples.empty() && !cancelled.load(std::memory_order_relaxed))
+        {
+            auto const block = samples.first(std::min(ResampleBlockFrames, samples.size()));
+            resampled.resize(resampler->maxOutputFrames(block.size()));
+            resampled.resize(resampler->process(block, resampled));
+            if (auto result = push(resampled); !result)
+                return result;
+            samples = samples.subspan(block.size());
+        }
+        return {};
+    }
 };
 
 namespace
@@ -38,26 +116,30 @@ namespace
         auto const channels = device->playback.channels;
         auto const totalSamples = static_cast<std::size_t>(frameCount) * channels;
 
-        auto lock = std::unique_lock(impl->mutex);
-        auto const remaining = impl->buffer.size() - impl->readPos;
-        auto const toCopy = std::min(totalSamples, remaining);
-
-        if (toCopy > 0)
-        {
-            std::copy_n(impl->buffer.data() + impl->readPos, toCopy, out);
-            impl->readPos += toCopy;
-        }
+        auto const copied = impl->cancelled.load(std::memory_order_relaxed)
+                                ? std::size_t { 0 }
+                                : impl->ring->tryPopSome(std::span(out, totalSamples));
 
         // Zero-fill any remaining output frames
-        if (toCopy < totalSamples)
-            std::fill_n(out + toCopy, totalSamples - toCopy, 0.0f);
-
-        // Signal completion when all samples consumed or cancelled
-        if (impl->readPos >= impl->buffer.size() || impl->cancelled.load(std::memory_order_relaxed))
+        if (copied < totalSamples)
         {
-            lock.unlock();
-            impl->done.notify_one();
+            std::fill_n(out + copied, totalSamples - copied, 0.0f);
+            if (!impl->inputEnded.load(std::memory_order_acquire)
+                && !impl->cancelled.load(std::memory_order_relaxed))
+            {
+                impl->underruns.fetch_add(1, std::memory_order_relaxed);
+                impl->silentSamples.fetch_add(totalSamples - copied, std::memory_order_relaxed);
+            }
         }
+
+        auto energy = 0.0f;
+        for (auto const sample: std::span(out, copied))
+            energy += sample * sample;
+        auto const level = totalSamples == 0 ? 0.0f : std::sqrt(energy / static_cast<float>(totalSamples));
+        auto const decay = std::exp(-static_cast<float>(frameCount)
+                                    / (static_cast<float>(device->sampleRate) * OutputLevelDecaySeconds));
+        auto const previous = impl->outputLevel.load(std::memory_order_relaxed);
+        impl->outputLevel.store(std::max(level, previous * decay), std::memory_order_relaxed);
     }
 
 } // namespace
@@ -73,12 +155,14 @@ AudioPlayback::~AudioPlayback()
         ma_device_uninit(&_impl->device);
 }
 
-auto AudioPlayback::initialize(unsigned sampleRate, unsigned channels) -> VoidResult
+auto AudioPlayback::initialize(unsigned sampleRate, unsigned channels, unsigned bufferedSeconds) -> VoidResult
 {
+    // Mono streams open the device at its native rate and are resampled on our side, which keeps
+    // the backend from adding latency for a rate the hardware does not support.
     auto config = ma_device_config_init(ma_device_type_playback);
     config.playback.format = ma_format_f32;
     config.playback.channels = channels;
-    config.sampleRate = sampleRate;
+    config.sampleRate = channels == 1 ? 0 : sampleRate;
     config.dataCallback = playbackDataCallback;
     config.pUserData = _impl.get();
 
@@ -87,50 +171,107 @@ auto AudioPlayback::initialize(unsigned sampleRate, unsigned channels) -> VoidRe
         return makeError(ErrorCode::AudioError,
                          std::format("Failed to initialize playback device: {}", static_cast<int>(result)));
 
+    auto const deviceRate = static_cast<unsigned>(_impl->device.sampleRate);
+    if (deviceRate != sampleRate)
+        _impl->resampler.emplace(sampleRate, deviceRate);
+    _impl->ring = std::make_unique<SpscQueue<float>>(std::size_t { deviceRate } * channels * bufferedSeconds);
+    _impl->memory.set(_impl->ring->capacity() * sizeof(float));
+
     _impl->initialized = true;
-    log::info("Audio playback initialized ({}Hz, {} channel(s), f32)", sampleRate, channels);
+    log::info("Audio playback initialized ({}Hz, {} channel(s), f32, device at {}Hz)",
+              sampleRate,
+              channels,
+              deviceRate);
     return {};
 }
 
-auto AudioPlayback::play(std::span<const float> samples) -> VoidResult
+void AudioPlayback::beginStream()
+{
+    if (!_impl->initialized)
+        return;
+
+    // The device is stopped between streams, so leftovers of a cancelled one can be drained here.
+    _impl->stopDevice();
+    auto scratch = std::array<float, 256> {};
+    while (_impl->ring->tryPopSome(scratch) > 0)
+        ;
+    _impl->silentSamples.store(0, std::memory_order_relaxed);
+    _impl->streamUnderruns = _impl->underruns.load(std::memory_order_relaxed);
+    _impl->inputEnded.store(false, std::memory_order_release);
+    _impl->cancelled.store(false, std::memory_order_relaxed);
+    if (_impl->resampler)
+        _impl->resampler->reset();
+}
+
+auto AudioPlayback::write(std::span<const float> samples) -> VoidResult
 {
     if (!_impl->initialized)
         return makeError(ErrorCode::AudioError, "Playback device not initialized");
 
-    if (samples.empty())
-        return {};
+    if (_impl->resampler)
+        return _impl->resampleAndPush(samples);
+    return _impl->push(samples);
+}
 
-    {
-        auto lock = std::lock_guard(_impl->mutex);
-        _impl->buffer = samples;
-        _impl->readPos = 0;
-        _impl->cancelled.store(false, std::memory_order_relaxed);
-    }
+void AudioPlayback::finishStream()
+{
+    if (!_impl->initialized)
+        return;
 
-    auto const startResult = ma_device_start(&_impl->device);
-    if (startResult != MA_SUCCESS)
-        return makeError(ErrorCode::AudioError,
-                         std::format("Failed to start playback: {}", static_cast<int>(startResult)));
+    // Push the samples still held back by the resampling filter out with silence.
+    if (_impl->resampler && _impl->deviceStarted)
+        (void) _impl->resampleAndPush(std::vector<float>(_impl->resampler->latency(), 0.0f));
 
-    // Block until all samples consumed or cancelled
-    {
-        auto lock = std::unique_lock(_impl->mutex);
-        _impl->done.wait(lock, [this] {
-            return _impl->readPos >= _impl->buffer.size() || _impl->cancelled.load(std::memory_order_relaxed);
-        });
-    }
+    _impl->inputEnded.store(true, std::memory_order_release);
+    while (_impl->deviceStarted && !_impl->ring->empty() && !_impl->cancelled.load(std::memory_order_relaxed))
+        std::this_thread::sleep_for(PollInterval);
+    _impl->stopDevice();
 
-    ma_device_stop(&_impl->device);
-    return {};
+    auto const underruns = _impl->underruns.load(std::memory_order_relaxed) - _impl->streamUnderruns;
+    if (underruns > 0)
+        log::debug("Audio playback: {} underrun(s), {} ms of silence inserted",
+                   underruns,
+                   _impl->silentSamples.load(std::memory_order_relaxed) * 1000
+                       / (std::uint64_t { _impl->device.sampleRate } * _impl->device.playback.channels));
+    if (auto const& resampler = _impl->resampler; resampler && resampler->processedFrames() > 0)
+        log::debug("Audio playback: resampling {}Hz to {}Hz took {:.2f}% of real time",
+                   resampler->inputRate(),
+                   resampler->outputRate(),
+                   resampler->realTimeFactor() * 100.0);
+}
+
+auto AudioPlayback::play(std::span<const float> samples) -> VoidResult
+{
+    beginStream();
+    auto result = write(samples);
+    finishStream();
+    return result;
 }
 
 void AudioPlayback::stop()
 {
+    // The streaming thread notices on its next poll and stops the device itself.
     _impl->cancelled.store(true, std::memory_order_relaxed);
-    _impl->done.notify_one();
+}
 
-    if (_impl->initialized)
-        ma_device_stop(&_impl->device);
+auto AudioPlayback::outputLevel() const -> float
+{
+    return _impl->outputLevel.load(std::memory_order_relaxed);
+}
+
+auto AudioPlayback::isDrained() const -> bool
+{
+    return !_impl->ring || _impl->ring->empty();
+}
+
+auto AudioPlayback::isStopped() const -> bool
+{
+    return _impl->cancelled.load(std::memory_order_relaxed);
+}
+
+auto AudioPlayback::underrunCount() const -> std::uint64_t
+{
+    return _impl->underruns.load(std::memory_order_relaxed);
 }
 
 } // namespace mychat
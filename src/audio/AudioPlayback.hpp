@@ -3,6 +3,7 @@
 
 #include <core/Error.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <span>
 
@@ -11,8 +12,10 @@ namespace mychat
 
 /// @brief Plays raw PCM audio through the default playback device using miniaudio.
 ///
-/// Uses PIMPL to isolate miniaudio headers from consumers. Playback is blocking:
-/// play() returns once all samples have been consumed by the audio device.
+/// Uses PIMPL to isolate miniaudio headers from consumers. Audio is streamed: samples written
+/// between beginStream() and finishStream() are handed to the device through a lock-free ring
+/// buffer, so playback starts with the first chunk while later ones are still being produced.
+/// One thread at a time may stream; stop() may be called from any thread.
 class AudioPlayback
 {
   public:
@@ -25,10 +28,25 @@ class AudioPlayback
     /// @brief Initializes the playback device.
     /// @param sampleRate Audio sample rate in Hz (e.g. 22050).
     /// @param channels Number of audio channels (e.g. 1 for mono).
+    /// @param bufferedSeconds How much audio write() may queue ahead of the device.
     /// @return Success or an error.
-    [[nodiscard]] auto initialize(unsigned sampleRate, unsigned channels) -> VoidResult;
+    [[nodiscard]] auto initialize(unsigned sampleRate, unsigned channels, unsigned bufferedSeconds = 2)
+        -> VoidResult;
 
-    /// @brief Plays raw PCM audio, blocking until all samples are consumed.
+    /// @brief Starts a new stream, clearing the effect of a previous stop().
+    void beginStream();
+
+    /// @brief Queues samples of the current stream, blocking while the ring buffer is full.
+    ///
+    /// The device starts with the first samples written. Returns right away once stopped.
+    /// @param samples The float32 PCM samples to play.
+    /// @return Success or an error.
+    [[nodiscard]] auto write(std::span<const float> samples) -> VoidResult;
+
+    /// @brief Blocks until all samples written have been consumed by the device, then stops it.
+    void finishStream();
+
+    /// @brief Plays raw PCM audio as a stream of its own, blocking until all samples are consumed.
     /// @param samples The float32 PCM samples to play.
     /// @return Success or an error.
     [[nodiscard]] auto play(std::span<const float> samples) -> VoidResult;
@@ -36,6 +54,20 @@ class AudioPlayback
     /// @brief Cancels the current playback immediately.
     void stop();
 
+    /// @brief Returns the RMS level of what the device played recently, decaying once it plays silence.
+    ///
+    /// Safe to call from any thread.
+    [[nodiscard]] auto outputLevel() const -> float;
+
+    /// @brief Returns true once the device has consumed all samples written to the current stream.
+    [[nodiscard]] auto isDrained() const -> bool;
+
+    /// @brief Returns true if the current stream was cancelled by stop().
+    [[nodiscard]] auto isStopped() const -> bool;
+
+    /// @brief Returns how often the device wanted more samples than a stream had written so far.
+    [[nodiscard]] auto underrunCount() const -> std::uint64_t;
+
     struct Impl;
 
   private:
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+
+#include <functional>
+#include <span>
+
+namespace mychat
+{
+
+/// @brief Callback invoked when audio data is captured.
+/// @param samples Float32 PCM samples at 16kHz mono.
+using AudioCallback = std::function<void(std::span<const float> samples)>;
+
+/// @brief Where voice input comes from: the microphone (AudioCapture) or a file (AudioFileSource).
+///
+/// Sources deliver float32 PCM at 16kHz mono, in chunks, from a thread of their own.
+class AudioSource
+{
+  public:
+    virtual ~AudioSource() = default;
+
+    /// @brief Prepares the source, which delivers its audio to @p callback once started.
+    /// @return Success or an error.
+    [[nodiscard]] virtual auto initialize(AudioCallback callback) -> VoidResult = 0;
+
+    /// @brief Starts delivering audio.
+    /// @return Success or an error.
+    [[nodiscard]] virtual auto start() -> VoidResult = 0;
+
+    /// @brief Stops delivering audio; no callback runs once this returns.
+    virtual void stop() = 0;
+
+    /// @brief Returns true while audio is being delivered.
+    [[nodiscard]] virtual auto isCapturing() const -> bool = 0;
+
+    /// @brief Returns the peak level of the audio delivered last (0.0 to 1.0). Safe to call from any thread.
+    [[nodiscard]] virtual auto peakLevel() const -> float = 0;
+};
+
+} // namespace mychat
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Dsp.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__AVX2__)
+    #define MYCHAT_DSP_AVX2 1
+    #define MYCHAT_DSP_SSE2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define MYCHAT_DSP_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) // Across-vector adds like vaddvq_f32 are AArch64-only.
+    #define MYCHAT_DSP_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace mychat::dsp
+{
+
+namespace
+{
+
+    /// @brief Maps 16-bit PCM to [-1, 1).
+    constexpr auto Int16Scale = 1.0f / 32768.0f;
+
+    /// @brief Folds the per-lane peaks and sums of a vector loop into @p levels.
+    template <size_t N>
+    void reduceLanes(std::array<float, N> const& peaks, std::array<float, N> const& sums, Levels& levels)
+    {
+        for (auto lane = size_t { 0 }; lane < N; ++lane)
+        {
+            levels.peak = std::max(levels.peak, peaks[lane]);
+            levels.sumSquares += sums[lane];
+        }
+    }
+
+} // namespace
+
+auto measure(std::span<const float> samples) -> Levels
+{
+    auto levels = Levels {};
+    auto const* data = samples.data();
+    auto const count = samples.size();
+    auto i = size_t { 0 };
+
+#if defined(MYCHAT_DSP_AVX2)
+    auto const absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto peak = _mm256_setzero_ps();
+    auto sum = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        auto const v = _mm256_loadu_ps(data + i);
+        peak = _mm256_max_ps(peak, _mm256_and_ps(v, absMask));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(v, v));
+    }
+    auto peaks = std::array<float, 8> {};
+    auto sums = std::array<float, 8> {};
+    _mm256_storeu_ps(peaks.data(), peak);
+    _mm256_storeu_ps(sums.data(), sum);
+    reduceLanes(peaks, sums, levels);
+#elif defined(MYCHAT_DSP_SSE2)
+    auto const absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto peak = _mm_setzero_ps();
+    auto sum = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        auto const v = _mm_loadu_ps(data + i);
+        peak = _mm_max_ps(peak, _mm_and_ps(v, absMask));
+        sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+    }
+    auto peaks = std::array<float, 4> {};
+    auto sums = std::array<float, 4> {};
+    _mm_storeu_ps(peaks.data(), peak);
+    _mm_storeu_ps(sums.data(), sum);
+    reduceLanes(peaks, sums, levels);
+#elif defined(MYCHAT_DSP_NEON)
+    auto peak = vdupq_n_f32(0.0f);
+    auto sum = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        auto const v = vld1q_f32(data + i);
+        peak = vmaxq_f32(peak, vabsq_f32(v));
+        sum = vmlaq_f32(sum, v, v);
+    }
+    auto peaks = std::array<float, 4> {};
+    auto sums = std::array<float, 4> {};
+    vst1q_f32(peaks.data(), peak);
+    vst1q_f32(sums.data(), sum);
+    reduceLanes(peaks, sums, levels);
+#endif
+
+    for (; i < count; ++i)
+    {
+        levels.peak = std::max(levels.peak, std::abs(data[i]));
+        levels.sumSquares += data[i] * data[i];
+    }
+    return levels;
+}
+
+auto rms(Levels levels, std::size_t count) -> float
+{
+    return count == 0 ? 0.0f : std::sqrt(levels.sumSquares / static_cast<float>(count));
+}
+
+auto dot(std::span<const float> a, std::span<const float> b) -> float
+{
+    auto const* x = a.data();
+    auto const* y = b.data();
+    auto const count = a.size();
+    auto i = size_t { 0 };
+    auto result = 0.0f;
+
+#if defined(MYCHAT_DSP_AVX2)
+    auto sum = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    auto sums = std::array<float, 8> {};
+    _mm256_storeu_ps(sums.data(), sum);
+    for (auto const lane: sums)
+        result += lane;
+#elif defined(MYCHAT_DSP_SSE2)
+    auto sum = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+    auto sums = std::array<float, 4> {};
+    _mm_storeu_ps(sums.data(), sum);
+    for (auto const lane: sums)
+        result += lane;
+#elif defined(MYCHAT_DSP_NEON)
+    auto sum = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4)
+        sum = vmlaq_f32(sum, vld1q_f32(x + i), vld1q_f32(y + i));
+    result = vaddvq_f32(sum);
+#endif
+
+    for (; i < count; ++i)
+        result += x[i] * y[i];
+    return result;
+}
+
+void toFloat(std::span<const std::int16_t> input, std::span<float> output)
+{
+    auto const* in = input.data();
+    auto* out = output.data();
+    auto const count = input.size();
+    auto i = size_t { 0 };
+
+#if defined(MYCHAT_DSP_AVX2)
+    auto const scale = _mm256_set1_ps(Int16Scale);
+    for (; i + 8 <= count; i += 8)
+    {
+        auto const wide = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale));
+    }
+#elif defined(MYCHAT_DSP_SSE2)
+    auto const scale = _mm_set1_ps(Int16Scale);
+    for (; i + 8 <= count; i += 8)
+    {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+        // Interleaving a value with itself and shifting back sign-extends it to 32 bits.
+        auto const low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        auto const high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+#elif defined(MYCHAT_DSP_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        auto const v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), Int16Scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), Int16Scale));
+    }
+#endif
+
+    for (; i < count; ++i)
+        out[i] = static_cast<float>(in[i]) * Int16Scale;
+}
+
+void downmix(std::span<const float> input, unsigned channels, std::span<float> output)
+{
+    if (channels <= 1)
+    {
+        std::ranges::copy(input, output.begin());
+        return;
+    }
+
+    auto const* in = input.data();
+    auto* out = output.data();
+    auto const frames = input.size() / channels;
+    auto frame = size_t { 0 };
+
+    if (channels == 2)
+    {
+#if defined(MYCHAT_DSP_SSE2)
+        auto const half = _mm_set1_ps(0.5f);
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto const a = _mm_loadu_ps(in + 2 * frame);     // l0 r0 l1 r1
+            auto const b = _mm_loadu_ps(in + 2 * frame + 4); // l2 r2 l3 r3
+            auto const left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            auto const right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + frame, _mm_mul_ps(_mm_add_ps(left, right), half));
+        }
+#elif defined(MYCHAT_DSP_NEON)
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto const v = vld2q_f32(in + 2 * frame);
+            vst1q_f32(out + frame, vmulq_n_f32(vaddq_f32(v.val[0], v.val[1]), 0.5f));
+        }
+#endif
+    }
+
+    auto const scale = 1.0f / static_cast<float>(channels);
+    for (; frame < frames; ++frame)
+    {
+        auto sum = 0.0f;
+        for (auto channel = 0u; channel < channels; ++channel)
+            sum += in[frame * channels + channel];
+        out[frame] = sum * scale;
+    }
+}
+
+void downmix(std::span<const std::int16_t> input, unsigned channels, std::span<float> output)
+{
+    if (channels <= 1)
+    {
+        toFloat(input, output);
+        return;
+    }
+
+    auto const* in = input.data();
+    auto* out = output.data();
+    auto const frames = input.size() / channels;
+    auto frame = size_t { 0 };
+
+    if (channels == 2)
+    {
+        // Multiplying by one and adding adjacent pairs sums left and right without overflow.
+#if defined(MYCHAT_DSP_AVX2)
+        auto const ones = _mm256_set1_epi16(1);
+        auto const scale = _mm256_set1_ps(0.5f * Int16Scale);
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + 2 * frame));
+            auto const sums = _mm256_cvtepi32_ps(_mm256_madd_epi16(v, ones));
+            _mm256_storeu_ps(out + frame, _mm256_mul_ps(sums, scale));
+        }
+#elif defined(MYCHAT_DSP_SSE2)
+        auto const ones = _mm_set1_epi16(1);
+        auto const scale = _mm_set1_ps(0.5f * Int16Scale);
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + 2 * frame));
+            auto const sums = _mm_cvtepi32_ps(_mm_madd_epi16(v, ones));
+            _mm_storeu_ps(out + frame, _mm_mul_ps(sums, scale));
+        }
+#elif defined(MYCHAT_DSP_NEON)
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            auto const v = vld2q_s16(in + 2 * frame);
+            auto const low = vaddl_s16(vget_low_s16(v.val[0]), vget_low_s16(v.val[1]));
+            auto const high = vaddl_s16(vget_high_s16(v.val[0]), vget_high_s16(v.val[1]));
+            vst1q_f32(out + frame, vmulq_n_f32(vcvtq_f32_s32(low), 0.5f * Int16Scale));
+            vst1q_f32(out + frame + 4, vmulq_n_f32(vcvtq_f32_s32(high), 0.5f * Int16Scale));
+        }
+#endif
+    }
+
+    auto const scale = Int16Scale / static_cast<float>(channels);
+    for (; frame < frames; ++frame)
+    {
+        auto sum = 0;
+        for (auto channel = 0u; channel < channels; ++channel)
+            sum += in[frame * channels + channel];
+        out[frame] = static_cast<float>(sum) * scale;
+    }
+}
+
+} // namespace mychat::dsp
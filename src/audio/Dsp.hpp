@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/// @brief Vectorized kernels for the audio hot paths.
+///
+/// Each kernel has SIMD implementations for AVX2, SSE2 and NEON, picked at compile time by the
+/// target the build is for, and a scalar fallback. They neither allocate nor lock, so they are
+/// safe to use on real-time audio threads.
+namespace mychat::dsp
+{
+
+/// @brief Peak and energy of a block of samples, measured in one pass.
+struct Levels
+{
+    float peak = 0.0f;       ///< Largest absolute sample value.
+    float sumSquares = 0.0f; ///< Sum of the squared samples.
+};
+
+/// @brief Measures the peak and the sum of squares of @p samples.
+[[nodiscard]] auto measure(std::span<const float> samples) -> Levels;
+
+/// @brief Returns the RMS level of @p count samples with the given @p levels.
+[[nodiscard]] auto rms(Levels levels, std::size_t count) -> float;
+
+/// @brief Returns the dot product of @p a and @p b, which must have the same size.
+[[nodiscard]] auto dot(std::span<const float> a, std::span<const float> b) -> float;
+
+/// @brief Converts 16-bit PCM to float samples in [-1, 1).
+/// @param input The samples to convert.
+/// @param output Receives the converted samples; must be at least as large as @p input.
+void toFloat(std::span<const std::int16_t> input, std::span<float> output);
+
+/// @brief Averages interleaved channels into mono.
+/// @param input Interleaved frames of @p channels samples each.
+/// @param channels The number of channels, at least 1.
+/// @param output Receives one sample per frame; must hold input.size() / channels samples.
+void downmix(std::span<const float> input, unsigned channels, std::span<float> output);
+
+/// @brief Converts interleaved 16-bit PCM to float and averages its channels into mono.
+/// @param input Interleaved frames of @p channels samples each.
+/// @param channels The number of channels, at least 1.
+/// @param output Receives one sample per frame; must hold input.size() / channels samples.
+void downmix(std::span<const std::int16_t> input, unsigned channels, std::span<float> output);
+
+} // namespace mychat::dsp
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Resampler.hpp"
+
+#include "Dsp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Fraction of the lower Nyquist frequency passed; the transition band fits above it.
+    constexpr auto Rolloff = 0.9;
+
+    /// Kaiser window shape; 8 gives about 80 dB of stopband attenuation.
+    constexpr auto KaiserBeta = 8.0;
+
+    /// @brief Zeroth-order modified Bessel function of the first kind, by its power series.
+    auto besselI0(double x) -> double
+    {
+        auto sum = 1.0;
+        auto term = 1.0;
+        auto const quarterSquare = x * x / 4.0;
+        for (auto k = 1; term > sum * 1e-12; ++k)
+        {
+            term *= quarterSquare / (static_cast<double>(k) * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+} // namespace
+
+Resampler::Resampler(unsigned inputRate, unsigned outputRate, unsigned taps):
+    _inputRate(inputRate), _outputRate(outputRate)
+{
+    auto const divisor = std::gcd(inputRate, outputRate);
+    _upFactor = outputRate / divisor;
+    _downFactor = inputRate / divisor;
+
+    // When decimating, the filter has to span the same time at the higher input rate.
+    auto const lowerRate = std::min(inputRate, outputRate);
+    _taps = std::max<std::size_t>(2, (std::size_t { taps } * inputRate + lowerRate - 1) / lowerRate);
+
+    if (isPassthrough())
+        return;
+
+    // Prototype low-pass at the interpolated rate inputRate * L, split into L phases below.
+    auto const length = _upFactor * _taps;
+    auto const center = static_cast<double>(length - 1) / 2.0;
+    auto const cutoff =
+        Rolloff * 0.5 * lowerRate / (static_cast<double>(_upFactor) * inputRate); // Cycles per sample.
+    auto prototype = std::vector<double>(length);
+    for (auto j = std::size_t { 0 }; j < length; ++j)
+    {
+        auto const t = static_cast<double>(j) - center;
+        auto const sinc =
+            t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * std::numbers::pi * cutoff * t) / (std::numbers::pi * t);
+        auto const ratio = t / center;
+        prototype[j] = sinc * besselI0(KaiserBeta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio)))
+                       / besselI0(KaiserBeta);
+    }
+
+    // Each phase sees one input sample in L, so the gain is L for unity gain overall.
+    auto const sum = std::accumulate(prototype.begin(), prototype.end(), 0.0);
+    auto const gain = static_cast<double>(_upFactor) / sum;
+    _coefficients.resize(length);
+    for (auto phase = std::size_t { 0 }; phase < _upFactor; ++phase)
+        for (auto k = std::size_t { 0 }; k < _taps; ++k)
+            _coefficients[phase * _taps + (_taps - 1 - k)] =
+                static_cast<float>(prototype[phase + k * _upFactor] * gain);
+
+    _history.resize(_taps - 1 + BlockFrames);
+    reset();
+}
+
+auto Resampler::maxOutputFrames(std::size_t inputFrames) const noexcept -> std::size_t
+{
+    if (isPassthrough())
+        return inputFrames;
+    return (inputFrames * _upFactor + _downFactor - 1) / _downFactor + 1;
+}
+
+auto Resampler::process(std::span<const float> input, std::span<float> output) -> std::size_t
+{
+    if (isPassthrough())
+    {
+        std::ranges::copy(input, output.begin());
+        return input.size();
+    }
+
+    auto const started = std::chrono::steady_clock::now();
+    _processedFrames += input.size();
+
+    auto written = std::size_t { 0 };
+    while (!input.empty())
+    {
+        auto const frames = std::min(BlockFrames, input.size());
+        std::ranges::copy(input.first(frames), _history.begin() + static_cast<std::ptrdiff_t>(_taps - 1));
+        written += filterBlock(_taps - 1 + frames, output.subspan(written));
+
+        // Keep the newest _taps - 1 samples as the history of the next block.
+        auto const kept = _history.begin() + static_cast<std::ptrdiff_t>(frames);
+        std::copy(kept, kept + static_cast<std::ptrdiff_t>(_taps - 1), _history.begin());
+        _position -= frames;
+        input = input.subspan(frames);
+    }
+
+    _processingTime += std::chrono::steady_clock::now() - started;
+    return written;
+}
+
+void Resampler::reset()
+{
+    std::ranges::fill(_history, 0.0f);
+    _position = _taps - 1;
+    _phase = 0;
+}
+
+auto Resampler::realTimeFactor() const noexcept -> double
+{
+    if (_processedFrames == 0)
+        return 0.0;
+    auto const audioSeconds = static_cast<double>(_processedFrames) / _inputRate;
+    return std::chrono::duration<double>(_processingTime).count() / audioSeconds;
+}
+
+auto Resampler::filterBlock(std::size_t filled, std::span<float> output) -> std::size_t
+{
+    auto const coefficients = std::span<const float>(_coefficients);
+    auto const history = std::span<const float>(_history);
+
+    auto written = std::size_t { 0 };
+    while (_position < filled)
+    {
+        output[written++] = dsp::dot(coefficients.subspan(_phase * _taps, _taps),
+                                     history.subspan(_position + 1 - _taps, _taps));
+        _phase += _downFactor;
+        _position += _phase / _upFactor;
+        _phase %= _upFactor;
+    }
+    return written;
+}
+
+} // namespace mychat
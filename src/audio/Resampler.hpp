@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Streaming polyphase resampler for mono float audio.
+///
+/// Converts between two fixed rates by the rational factor outputRate / inputRate, filtering with
+/// a Kaiser-windowed sinc low-pass whose bank of phases is computed once at construction. Input
+/// may be fed in blocks of any size; the output does not depend on how it is split. Neither
+/// process() nor reset() allocate, so they are safe to use on real-time audio threads.
+class Resampler
+{
+  public:
+    /// @brief Default filter length, in taps per phase at the lower of the two rates.
+    static constexpr auto DefaultTaps = 64u;
+
+    /// @brief Constructs a resampler from @p inputRate to @p outputRate Hz.
+    /// @param inputRate The sample rate of the input in Hz.
+    /// @param outputRate The sample rate of the output in Hz.
+    /// @param taps Filter length; longer filters have a steeper roll-off and cost more.
+    Resampler(unsigned inputRate, unsigned outputRate, unsigned taps = DefaultTaps);
+
+    [[nodiscard]] auto inputRate() const noexcept -> unsigned { return _inputRate; }
+    [[nodiscard]] auto outputRate() const noexcept -> unsigned { return _outputRate; }
+
+    /// @brief Returns true if both rates are equal, so samples are copied unchanged.
+    [[nodiscard]] auto isPassthrough() const noexcept -> bool { return _inputRate == _outputRate; }
+
+    /// @brief Returns how many input samples the filter delays the signal by.
+    [[nodiscard]] auto latency() const noexcept -> std::size_t { return _taps / 2; }
+
+    /// @brief Returns the most samples process() produces from @p inputFrames input samples.
+    [[nodiscard]] auto maxOutputFrames(std::size_t inputFrames) const noexcept -> std::size_t;
+
+    /// @brief Resamples the next block of the input stream.
+    /// @param input The next input samples.
+    /// @param output Receives the resampled samples; must hold maxOutputFrames(input.size()).
+    /// @return The number of samples written to @p output.
+    auto process(std::span<const float> input, std::span<float> output) -> std::size_t;
+
+    /// @brief Forgets the input seen so far, as if the resampler was just constructed.
+    ///
+    /// The cost counters keep counting.
+    void reset();
+
+    /// @brief Returns how many input samples process() has resampled so far.
+    [[nodiscard]] auto processedFrames() const noexcept -> std::size_t { return _processedFrames; }
+
+    /// @brief Returns the time process() has spent so far.
+    [[nodiscard]] auto processingTime() const noexcept -> std::chrono::nanoseconds { return _processingTime; }
+
+    /// @brief Returns the time spent per second of audio processed, e.g. 0.01 for 1% of real time.
+    [[nodiscard]] auto realTimeFactor() const noexcept -> double;
+
+  private:
+    /// Input samples filtered per pass over the history buffer.
+    static constexpr auto BlockFrames = std::size_t { 256 };
+
+    unsigned _inputRate;
+    unsigned _outputRate;
+    std::size_t _upFactor;   ///< Interpolation factor L, which is also the number of phases.
+    std::size_t _downFactor; ///< Decimation factor M.
+    std::size_t _taps;       ///< Coefficients per phase.
+
+    /// The filter bank, one phase after another, each reversed to run along the history forwards.
+    std::vector<float> _coefficients;
+    /// The last _taps - 1 input samples followed by the block being filtered.
+    std::vector<float> _history;
+    std::size_t _position = 0; ///< Index in _history of the newest sample of the next output.
+    std::size_t _phase = 0;    ///< Filter phase of the next output.
+
+    std::size_t _processedFrames = 0;
+    std::chrono::nanoseconds _processingTime {};
+
+    [[nodiscard]] auto filterBlock(std::size_t filled, std::span<float> output) -> std::size_t;
+};
+
+} // namespace mychat
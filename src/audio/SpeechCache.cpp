@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "SpeechCache.hpp"
+
+#include <core/Hash.hpp>
+#include <core/Log.hpp>
+
+#include <cctype>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Identifies a cached phrase file ("MCSP") and its format version.
+    constexpr auto FileMagic = std::uint32_t { 0x5053434d };
+    constexpr auto FileVersion = std::uint32_t { 1 };
+
+    template <typename T>
+    void writeValue(std::ofstream& out, T const& value)
+    {
+        out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    auto readValue(std::ifstream& in, T& value) -> bool
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    auto bytesOf(std::vector<float> const& samples) -> std::size_t
+    {
+        return samples.size() * sizeof(float);
+    }
+
+} // namespace
+
+SpeechCache::SpeechCache(std::size_t capacityBytes, std::filesystem::path directory):
+    _capacityBytes(capacityBytes), _directory(std::move(directory))
+{
+}
+
+auto SpeechCache::normalize(std::string_view text) -> std::string
+{
+    auto key = std::string {};
+    key.reserve(text.size());
+    for (auto const ch: text)
+    {
+        if (std::isspace(static_cast<unsigned char>(ch)) == 0)
+            key += ch;
+        else if (!key.empty() && key.back() != ' ')
+            key += ' ';
+    }
+    if (!key.empty() && key.back() == ' ')
+        key.pop_back();
+    return key;
+}
+
+auto SpeechCache::lookup(std::string const& key) -> Samples
+{
+    if (auto const it = _index.find(key); it != _index.end())
+    {
+        _entries.splice(_entries.begin(), _entries, it->second);
+        auto& entry = _entries.front();
+        ++_hits;
+
+        // Heard twice now, so the phrase is worth keeping across sessions.
+        if (!entry.persisted && !_directory.empty())
+        {
+            saveToDisk(entry.key, *entry.samples);
+            entry.persisted = true;
+        }
+        return entry.samples;
+    }
+
+    if (auto samples = loadFromDisk(key))
+    {
+        ++_hits;
+        insert(Entry { .key = key, .samples = samples, .persisted = true });
+        return samples;
+    }
+
+    ++_misses;
+    return nullptr;
+}
+
+void SpeechCache::store(std::string key, std::vector<float> samples)
+{
+    if (auto const it = _index.find(key); it != _index.end())
+    {
+        _bytes -= bytesOf(*it->second->samples);
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+
+    insert(Entry {
+        .key = std::move(key),
+        .samples = std::make_shared<const std::vector<float>>(std::move(samples)),
+        .persisted = false,
+    });
+}
+
+void SpeechCache::insert(Entry entry)
+{
+    auto const size = bytesOf(*entry.samples);
+    if (size > _capacityBytes)
+        return;
+
+    while (!_entries.empty() && _bytes + size > _capacityBytes)
+    {
+        _bytes -= bytesOf(*_entries.back().samples);
+        _index.erase(_entries.back().key);
+        _entries.pop_back();
+    }
+
+    _bytes += size;
+    _entries.push_front(std::move(entry));
+    _index.emplace(_entries.front().key, _entries.begin());
+}
+
+auto SpeechCache::pathOf(std::string_view key) const -> std::filesystem::path
+{
+    return _directory / std::format("{:016x}.pcm", fnv1a64(key));
+}
+
+auto SpeechCache::loadFromDisk(std::string const& key) const -> Samples
+{
+    if (_directory.empty())
+        return nullptr;
+
+    auto in = std::ifstream(pathOf(key), std::ios::binary);
+    if (!in)
+        return nullptr;
+
+    auto magic = std::uint32_t {};
+    auto version = std::uint32_t {};
+    auto keySize = std::uint32_t {};
+    auto sampleCount = std::uint64_t {};
+    if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, keySize) || magic != FileMagic
+        || version != FileVersion || keySize != key.size())
+        return nullptr;
+
+    // The file name is a hash, so the stored key tells collisions apart.
+    auto storedKey = std::string(keySize, '\0');
+    if (!in.read(storedKey.data(), keySize) || storedKey != key || !readValue(in, sampleCount)
+        || sampleCount * sizeof(float) > _capacityBytes)
+        return nullptr;
+
+    auto samples = std::vector<float>(sampleCount);
+    if (!in.read(reinterpret_cast<char*>(samples.data()), static_cast<std::streamsize>(bytesOf(samples))))
+        return nullptr;
+    return std::make_shared<const std::vector<float>>(std::move(samples));
+}
+
+void SpeechCache::saveToDisk(std::string_view key, std::vector<float> const& samples) const
+{
+    auto ec = std::error_code {};
+    std::filesystem::create_directories(_directory, ec);
+
+    auto const path = pathOf(key);
+    auto const tempPath = std::filesystem::path(path).concat(".tmp");
+    {
+        auto out = std::ofstream(tempPath, std::ios::binary | std::ios::trunc);
+        writeValue(out, FileMagic);
+        writeValue(out, FileVersion);
+        writeValue(out, static_cast<std::uint32_t>(key.size()));
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+        writeValue(out, static_cast<std::uint64_t>(samples.size()));
+        out.write(reinterpret_cast<char const*>(samples.data()),
+                  static_cast<std::streamsize>(bytesOf(samples)));
+        if (!out)
+        {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            log::warning("TTS: cannot write phrase cache file {}", tempPath.string());
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        log::warning("TTS: cannot write phrase cache file {}: {}", path.string(), ec.message());
+}
+
+} // namespace mychat
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Memoizes synthesized audio of short phrases, so repeated ones skip synthesis.
+///
+/// Entries are keyed by normalized text and evicted least-recently-used first once the cached
+/// samples exceed the memory cap. With a directory, phrases that were heard at least twice are
+/// also written to disk, and phrases missing in memory are looked up there; the directory must
+/// be specific to the voice. Not thread-safe.
+class SpeechCache
+{
+  public:
+    using Samples = std::shared_ptr<const std::vector<float>>;
+
+    /// @brief Constructs a cache holding at most @p capacityBytes of samples in memory.
+    /// @param capacityBytes The memory cap.
+    /// @param directory Where phrases are persisted, or empty to keep them in memory only.
+    explicit SpeechCache(std::size_t capacityBytes, std::filesystem::path directory = {});
+
+    /// @brief Builds the cache key of a phrase: trimmed, with whitespace runs collapsed.
+    ///
+    /// Case and punctuation are kept, since both change how the phrase is spoken.
+    [[nodiscard]] static auto normalize(std::string_view text) -> std::string;
+
+    /// @brief Returns the cached samples for @p key, or nullptr if the phrase is not cached.
+    [[nodiscard]] auto lookup(std::string const& key) -> Samples;
+
+    /// @brief Stores the samples of a phrase; phrases too large for the cache are not stored.
+    void store(std::string key, std::vector<float> samples);
+
+    /// @brief Returns the number of phrases cached in memory.
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return _entries.size(); }
+
+    /// @brief Returns the memory used by cached samples.
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t { return _bytes; }
+
+    /// @brief Returns how many lookups were answered from memory or disk.
+    [[nodiscard]] auto hits() const noexcept -> std::size_t { return _hits; }
+
+    /// @brief Returns how many lookups found no cached phrase.
+    [[nodiscard]] auto misses() const noexcept -> std::size_t { return _misses; }
+
+  private:
+    struct Entry
+    {
+        std::string key;
+        Samples samples;
+        bool persisted = false; ///< Known to be on disk already.
+    };
+
+    std::size_t _capacityBytes;
+    std::filesystem::path _directory;
+    std::list<Entry> _entries; ///< Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    std::size_t _bytes = 0;
+    std::size_t _hits = 0;
+    std::size_t _misses = 0;
+
+    /// @brief Inserts an entry as the most recently used one, evicting others to make room.
+    ///
+    /// Entries whose samples alone exceed the memory cap are dropped.
+    void insert(Entry entry);
+
+    [[nodiscard]] auto pathOf(std::string_view key) const -> std::filesystem::path;
+    [[nodiscard]] auto loadFromDisk(std::string const& key) const -> Samples;
+    void saveToDisk(std::string_view key, std::vector<float> const& samples) const;
+};
+
+} // namespace mychat
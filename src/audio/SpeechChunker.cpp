@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "SpeechChunker.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    using namespace std::string_view_literals;
+
+    constexpr auto EmDash = "—"sv;
+    constexpr auto EnDash = "–"sv;
+
+    /// @brief Returns true if @p text ends a sentence, possibly followed by closing quotes or parentheses.
+    auto endsSentence(std::string_view text) -> bool
+    {
+        auto const end = text.find_last_not_of("\"')");
+        return end != std::string_view::npos && ".!?"sv.contains(text[end]);
+    }
+
+    /// @brief Returns true if @p text ends with a clause separator.
+    auto endsClause(std::string_view text) -> bool
+    {
+        return (!text.empty() && ",;:"sv.contains(text.back())) || text.ends_with(" -"sv)
+               || text.ends_with(" --"sv) || text.ends_with(EmDash) || text.ends_with(EnDash);
+    }
+
+    auto isDigit(char ch) -> bool
+    {
+        return std::isdigit(static_cast<unsigned char>(ch)) != 0;
+    }
+
+    /// @brief Returns true if @p text consists of @p ch only.
+    auto isRunOf(std::string_view text, char ch) -> bool
+    {
+        return !text.empty() && text.find_first_not_of(ch) == std::string_view::npos;
+    }
+
+    /// @brief Returns true if @p text is an ordered list marker without its trailing space, e.g. "12.".
+    auto isOrderedListMarker(std::string_view text) -> bool
+    {
+        return text.size() >= 2 && (text.back() == '.' || text.back() == ')')
+               && std::ranges::all_of(text.substr(0, text.size() - 1), isDigit);
+    }
+
+    /// @brief Returns true if @p text, at the start of a line, may still turn into a markdown marker.
+    auto mayBecomeMarker(std::string_view text) -> bool
+    {
+        return isRunOf(text, '#') || text == ">" || text == "+" || isRunOf(text, '-') || isRunOf(text, '*')
+               || isRunOf(text, '_') || isRunOf(text, '=') || std::ranges::all_of(text, isDigit)
+               || isOrderedListMarker(text);
+    }
+
+    /// @brief Returns true if @p text, followed by a space, is a markdown marker that is not spoken.
+    auto isMarker(std::string_view text) -> bool
+    {
+        return isRunOf(text, '#') || text == "-" || text == "*" || text == "+" || isOrderedListMarker(text);
+    }
+
+} // namespace
+
+SpeechChunker::SpeechChunker(SpeechChunkerConfig config): _config(config)
+{
+    _text.reserve(_config.maxChunkChars);
+}
+
+auto SpeechChunker::feed(std::string_view piece, std::vector<std::string>& chunks) -> size_t
+{
+    auto const before = chunks.size();
+    for (auto const ch: piece)
+    {
+        if (ch == '\n')
+            endLine(chunks);
+        else if (_skipLine)
+            continue;
+        else if (_atLineStart)
+            feedLineStart(ch, chunks);
+        else
+            feedText(ch, chunks);
+    }
+    return chunks.size() - before;
+}
+
+void SpeechChunker::finish(std::vector<std::string>& chunks)
+{
+    endLine(chunks);
+    reset();
+}
+
+void SpeechChunker::reset()
+{
+    _text.clear();
+    _lineStart.clear();
+    _emitted = 0;
+    _atLineStart = true;
+    _skipLine = false;
+    _inCodeBlock = false;
+    _afterBracket = false;
+    _inLinkTarget = false;
+}
+
+void SpeechChunker::endLine(std::vector<std::string>& chunks)
+{
+    // A line that is nothing but markers, such as a horizontal rule, is dropped; a bare number is not.
+    if (_atLineStart && !_inCodeBlock)
+    {
+        auto const held = std::exchange(_lineStart, {});
+        auto const start = held.find_first_not_of(" \t");
+        if (start != std::string::npos && std::ranges::all_of(held.substr(start), isDigit))
+        {
+            for (auto const ch: held.substr(start))
+                feedText(ch, chunks);
+        }
+    }
+
+    _lineStart.clear();
+    _atLineStart = true;
+    _skipLine = false;
+    _afterBracket = false;
+    _inLinkTarget = false;
+    emit(chunks);
+}
+
+void SpeechChunker::feedLineStart(char ch, std::vector<std::string>& chunks)
+{
+    _lineStart += ch;
+    auto const start = _lineStart.find_first_not_of(" \t");
+    if (start == std::string::npos)
+        return; // Indentation
+
+    auto const marker = std::string_view(_lineStart).substr(start);
+    if (marker.starts_with("```"sv))
+    {
+        // The fence's language tag is not spoken either.
+        _inCodeBlock = !_inCodeBlock;
+        _skipLine = true;
+        _atLineStart = false;
+        _lineStart.clear();
+        return;
+    }
+    if ("``"sv.starts_with(marker))
+        return; // May still become a fence
+
+    if (_inCodeBlock)
+    {
+        _skipLine = true;
+        _atLineStart = false;
+        _lineStart.clear();
+        return;
+    }
+
+    if (mayBecomeMarker(marker))
+        return;
+
+    // The last character decides what the held-back start of the line was.
+    auto const body = marker.substr(0, marker.size() - 1);
+    auto const separated = ch == ' ' || ch == '\t';
+    if (body == ">")
+    {
+        // Block quotes may contain further markers, such as list bullets.
+        _lineStart.clear();
+        if (!separated)
+            feedLineStart(ch, chunks);
+        return;
+    }
+
+    auto replay = std::string {};
+    if (!(separated && isMarker(body)))
+        replay = marker;
+    _lineStart.clear();
+    _atLineStart = false;
+    for (auto const c: replay)
+        feedText(c, chunks);
+}
+
+void SpeechChunker::feedText(char ch, std::vector<std::string>& chunks)
+{
+    if (_inLinkTarget)
+    {
+        _inLinkTarget = ch != ')';
+        return;
+    }
+    if (std::exchange(_afterBracket, false) && ch == '(')
+    {
+        _inLinkTarget = true;
+        return;
+    }
+
+    switch (ch)
+    {
+        case '*':
+        case '`':
+        case '[': return;
+        case ']': _afterBracket = true; return;
+        case ' ':
+        case '\t':
+        case '\r': {
+            if (_text.empty() || _text.back() == ' ')
+                return;
+            auto const wordLimit = _emitted == 0 ? _config.firstChunkChars : _config.maxChunkChars;
+            auto const clause = endsClause(_text) && longEnoughForClause();
+            if (endsSentence(_text) || clause || _text.size() >= wordLimit)
+                emit(chunks);
+            else
+                _text += ' ';
+            return;
+        }
+        default: _text += ch; break;
+    }
+
+    // Dashes may also be written without surrounding spaces.
+    if ((_text.ends_with(EmDash) || _text.ends_with(EnDash)) && longEnoughForClause())
+        emit(chunks);
+}
+
+void SpeechChunker::emit(std::vector<std::string>& chunks)
+{
+    while (!_text.empty() && _text.back() == ' ')
+        _text.pop_back();
+
+    // Chunks without a word, such as a lone punctuation mark, are not worth speaking.
+    auto const speakable = std::ranges::any_of(_text, [](char ch) {
+        auto const byte = static_cast<unsigned char>(ch);
+        return std::isalnum(byte) != 0 || byte >= 0x80;
+    });
+    if (speakable)
+    {
+        chunks.push_back(_text);
+        ++_emitted;
+    }
+    _text.clear();
+}
+
+auto SpeechChunker::longEnoughForClause() const noexcept -> bool
+{
+    return _text.size() >= (_emitted == 0 ? _config.firstClauseChars : _config.minClauseChars);
+}
+
+} // namespace mychat
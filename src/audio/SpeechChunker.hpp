@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Length thresholds for SpeechChunker, in bytes of speakable text.
+struct SpeechChunkerConfig
+{
+    size_t firstClauseChars = 12; ///< The first chunk may end at a clause boundary after this many.
+    size_t firstChunkChars = 60;  ///< The first chunk ends at the next word boundary after this many.
+    size_t minClauseChars = 40;   ///< Later chunks may end at a clause boundary after this many.
+    size_t maxChunkChars = 240;   ///< Any chunk ends at the next word boundary after this many.
+};
+
+/// @brief Incremental segmenter turning streamed markdown into chunks of speakable text for TTS.
+///
+/// Pieces of generated text are fed as they are sampled. Each character is looked at once, so
+/// feeding is linear in the length of the message. Chunks end at sentence ends and line breaks,
+/// and at clause boundaries (commas, semicolons, colons and dashes) once they are long enough.
+/// The first chunk of a message is cut early, so speech can start while the rest is generated.
+///
+/// Fenced code blocks are skipped, and markdown syntax (headings, list bullets, block quotes,
+/// emphasis, inline code backticks and link targets) is dropped.
+class SpeechChunker
+{
+  public:
+    explicit SpeechChunker(SpeechChunkerConfig config = {});
+
+    /// @brief Feeds a piece of generated text.
+    /// @param piece The text to append.
+    /// @param chunks Receives (appended) the chunks completed by this piece.
+    /// @return The number of chunks completed by this piece.
+    auto feed(std::string_view piece, std::vector<std::string>& chunks) -> size_t;
+
+    /// @brief Ends the message, releasing the remaining text as a final chunk.
+    ///
+    /// The chunker is reset afterwards, so the next message starts with a quick first chunk again.
+    /// @param chunks Receives (appended) the remaining chunk, if any.
+    void finish(std::vector<std::string>& chunks);
+
+    /// @brief Discards all buffered text and state.
+    void reset();
+
+    /// @brief Returns true while inside a fenced code block.
+    [[nodiscard]] auto insideCodeBlock() const noexcept -> bool { return _inCodeBlock; }
+
+  private:
+    SpeechChunkerConfig _config;
+    std::string _text;          ///< Speakable text of the chunk being built.
+    std::string _lineStart;     ///< Held-back start of a line that may be a markdown marker.
+    size_t _emitted = 0;        ///< Chunks emitted for the current message.
+    bool _atLineStart = true;
+    bool _skipLine = false;     ///< Drops the rest of the line, e.g. a code fence's language tag.
+    bool _inCodeBlock = false;
+    bool _afterBracket = false; ///< The previous character closed a link text.
+    bool _inLinkTarget = false; ///< Inside the `(url)` part of a link.
+
+    /// @brief Ends the current line, which also ends the current chunk.
+    void endLine(std::vector<std::string>& chunks);
+
+    /// @brief Handles a character at the start of a line, holding it back while it may be a marker.
+    void feedLineStart(char ch, std::vector<std::string>& chunks);
+
+    /// @brief Handles a character of running text.
+    void feedText(char ch, std::vector<std::string>& chunks);
+
+    /// @brief Ends the current chunk, appending it to @p chunks if it has anything to say.
+    void emit(std::vector<std::string>& chunks);
+
+    /// @brief Returns true if the current chunk may end at a clause boundary.
+    [[nodiscard]] auto longEnoughForClause() const noexcept -> bool;
+};
+
+} // namespace mychat
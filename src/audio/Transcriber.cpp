@@ -2,13 +2,18 @@
 #include "Transcriber.hpp"
 
 #include <core/Log.hpp>
+#include <core/MemoryRegistry.hpp>
+#include <core/Trace.hpp>
 
 #include <whisper.h>
 
 #include <array>
+#include <chrono>
+#include <filesystem>
 #include <format>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace mychat
 {
@@ -16,8 +21,31 @@ namespace mychat
 namespace
 {
 
+    /// @brief Sample rate whisper expects its input at.
+    constexpr auto SampleRate = 16000;
+
+    /// @brief Encoder positions per second of audio; the full context covers 30 seconds.
+    constexpr auto AudioContextPerSecond = 50;
+    constexpr auto FullAudioContext = 1500;
+
+    /// @brief Encoder positions added to a reduced context, so words at its end are not cut off.
+    constexpr auto AudioContextMargin = 64;
+
+    /// @brief Length of the silent buffer transcribed at load to warm up the model.
+    constexpr auto WarmUpSamples = SampleRate;
+
+    /// @brief Returns the encoder context needed for @p sampleCount samples, or 0 for the full one.
+    auto reducedAudioContext(std::size_t sampleCount) -> int
+    {
+        auto const needed =
+            static_cast<int>(sampleCount * AudioContextPerSecond / SampleRate) + AudioContextMargin;
+        return needed < FullAudioContext ? needed : 0;
+    }
+
     /// @brief Line buffer for whisper.cpp log continuation messages.
-    auto whisperLineBuffer = std::string {};
+    ///
+    /// Each thread logging has its own, so lines from concurrent threads never interleave.
+    thread_local auto whisperLineBuffer = std::string {};
 
     /// @brief Maps ggml_log_level to mychat::log::Level.
     /// @param level The ggml log level.
@@ -82,6 +110,7 @@ struct Transcriber::Impl
 {
     whisper_context* ctx = nullptr;
     TranscriberConfig config;
+    MemoryAccount memory = memoryRegistry().open("Whisper model", MemoryCategory::SpeechModels);
 
     ~Impl()
     {
@@ -103,22 +132,55 @@ auto Transcriber::initialize(const TranscriberConfig& config) -> VoidResult
     whisper_log_set(whisperLogCallback, nullptr);
 
     auto params = whisper_context_default_params();
+    params.use_gpu = config.useGpu;
+    params.flash_attn = config.flashAttention;
     _impl->ctx = whisper_init_from_file_with_params(config.modelPath.c_str(), params);
 
     if (!_impl->ctx)
         return makeError(ErrorCode::TranscriptionError,
                          std::format("Failed to load whisper model: {}", config.modelPath));
 
-    log::info("Whisper model loaded: {}", config.modelPath);
+    // The weights are read into memory as they are stored; the compute buffers come on top.
+    auto ec = std::error_code {};
+    if (auto const fileSize = std::filesystem::file_size(config.modelPath, ec); !ec)
+        _impl->memory.set(static_cast<std::size_t>(fileSize));
+
+    log::info("Whisper model loaded: {} (GPU: {}, flash attention: {}, beam size: {})",
+              config.modelPath,
+              config.useGpu ? "on" : "off",
+              config.flashAttention ? "on" : "off",
+              config.beamSize);
+
+    // The first inference allocates compute buffers and loads kernels; pay for that now.
+    if (config.warmUp)
+    {
+        auto const started = std::chrono::steady_clock::now();
+        auto const silence = std::vector<float>(WarmUpSamples, 0.0f);
+        if (auto const warmUp = transcribe(silence); !warmUp)
+            log::warning("Whisper warm-up failed: {}", warmUp.error().message);
+        else
+        {
+            auto const elapsed = std::chrono::steady_clock::now() - started;
+            log::info("Whisper warm-up took {} ms",
+                      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        }
+    }
     return {};
 }
 
-auto Transcriber::transcribe(std::span<const float> samples) -> Result<std::string>
+auto Transcriber::transcribe(std::span<const float> samples, std::string_view prompt) -> Result<std::string>
 {
+    auto const zone = trace::Zone("audio", "transcribe");
     if (!_impl->ctx)
         return makeError(ErrorCode::TranscriptionError, "Whisper model not loaded");
 
-    auto params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    auto const beamSize = _impl->config.beamSize;
+    auto params =
+        whisper_full_default_params(beamSize > 1 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+    if (beamSize > 1)
+        params.beam_search.beam_size = beamSize;
+    if (_impl->config.reduceAudioContext)
+        params.audio_ctx = reducedAudioContext(samples.size());
     params.language = _impl->config.language.c_str();
     params.translate = _impl->config.translate;
     params.n_threads = _impl->config.threads;
@@ -129,6 +191,10 @@ auto Transcriber::transcribe(std::span<const float> samples) -> Result<std::stri
     params.no_context = true;
     params.single_segment = true;
 
+    auto const initialPrompt = std::string(prompt);
+    if (!initialPrompt.empty())
+        params.initial_prompt = initialPrompt.c_str();
+
     auto const result = whisper_full(_impl->ctx, params, samples.data(), static_cast<int>(samples.size()));
 
     if (result != 0)
@@ -6,6 +6,7 @@
 #include <memory>
 #include <span>
 #include <string>
+#include <string_view>
 
 namespace mychat
 {
@@ -17,6 +18,23 @@ struct TranscriberConfig
     std::string language = "en";
     int threads = 4;
     bool translate = false;
+
+    /// @brief Whether to run the model on the GPU, if whisper.cpp was built with GPU support.
+    bool useGpu = true;
+
+    /// @brief Whether to use flash attention, which is faster on most GPUs.
+    bool flashAttention = false;
+
+    /// @brief Beam search width; 1 decodes greedily, which is fastest.
+    int beamSize = 1;
+
+    /// @brief Whether to shrink the encoder's context to the length of short utterances.
+    ///
+    /// Makes short commands much faster to transcribe, at a small risk of lower accuracy.
+    bool reduceAudioContext = false;
+
+    /// @brief Whether to transcribe a silent buffer at load, so the first real call is not slower.
+    bool warmUp = true;
 };
 
 /// @brief Speech-to-text transcription using whisper.cpp.
@@ -36,8 +54,10 @@ class Transcriber
 
     /// @brief Transcribes audio samples to text.
     /// @param samples Float32 PCM audio at 16kHz mono.
+    /// @param prompt Text spoken right before @p samples, given to whisper as context.
     /// @return The transcribed text or an error.
-    [[nodiscard]] auto transcribe(std::span<const float> samples) -> Result<std::string>;
+    [[nodiscard]] auto transcribe(std::span<const float> samples, std::string_view prompt = {})
+        -> Result<std::string>;
 
     /// @brief Returns true if the model is loaded.
     [[nodiscard]] auto isLoaded() const -> bool;
@@ -1,17 +1,27 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "TtsSpeaker.hpp"
 
+#include <core/Hash.hpp>
 #include <core/Log.hpp>
+#include <core/MemoryRegistry.hpp>
+#include <core/Trace.hpp>
 
+#include <chrono>
 #include <condition_variable>
 #include <deque>
+#include <filesystem>
 #include <format>
+#include <fstream>
+#include <iterator>
 #include <mutex>
+#include <span>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "AudioPlayback.hpp"
+#include "SpeechCache.hpp"
 
 extern "C"
 {
@@ -28,6 +38,29 @@ namespace
     constexpr auto PiperSampleRate = 22050u;
     constexpr auto PiperChannels = 1u;
 
+    /// @brief How far synthesis may run ahead of playback, a few sentences of speech.
+    constexpr auto LookaheadSeconds = 10u;
+
+    /// @brief How often the worker checks whether the stream has played out.
+    constexpr auto DrainPollInterval = std::chrono::milliseconds(10);
+
+    /// @brief Longest phrase whose audio is cached; longer sentences rarely repeat verbatim.
+    constexpr auto MaxCachedPhraseChars = size_t { 80 };
+
+    /// @brief Derives a stable identifier for a voice from its model configuration and file size.
+    ///
+    /// The configuration is small and holds the voice's parameters; hashing the model file itself
+    /// would delay startup for little gain.
+    auto voiceFingerprint(std::string const& modelPath, std::string const& configPath) -> std::string
+    {
+        auto in = std::ifstream(configPath, std::ios::binary);
+        auto const voiceConfig =
+            std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        auto ec = std::error_code {};
+        auto const modelSize = std::filesystem::file_size(modelPath, ec);
+        return std::format("{:016x}", fnv1a64(std::format("{}|{}", voiceConfig, ec ? 0 : modelSize)));
+    }
+
 } // namespace
 
 struct TtsSpeaker::Impl
@@ -35,6 +68,11 @@ struct TtsSpeaker::Impl
     TtsSpeakerConfig config;
     AudioPlayback playback;
     piper_synthesizer* synth = nullptr;
+    std::unique_ptr<SpeechCache> phraseCache; ///< Only used by the worker thread.
+    MemoryAccount voiceMemory = memoryRegistry().open("Piper voice", MemoryCategory::SpeechModels);
+    /// Bounded by TtsSpeakerConfig::phraseCacheBytes and only touched by the worker, so it is not
+    /// shrunk when over budget.
+    MemoryAccount phraseCacheMemory = memoryRegistry().open("Phrase cache", MemoryCategory::Caches);
 
     std::jthread worker;
     std::mutex mutex;
@@ -43,6 +81,9 @@ struct TtsSpeaker::Impl
     bool shutdownRequested = false;
     bool flushRequested = false;
     bool busy = false;
+    std::function<void()> onIdle;       ///< Called with the lock held when the speaker becomes idle.
+    std::function<void()> onAudioStart; ///< Called when a stream's first audio is handed to playback.
+    bool awaitingAudio = false;         ///< No audio of the current stream was written yet; worker only.
 
     ~Impl()
     {
@@ -51,14 +92,46 @@ struct TtsSpeaker::Impl
     }
 
     /// @brief Worker thread function that processes the sentence queue.
+    ///
+    /// Consecutive sentences are synthesized into one playback stream, whose ring buffer holds the
+    /// audio that is ready but not yet played. So the next sentence is synthesized while the
+    /// previous one still plays, as far ahead as the buffer allows.
     /// @param stopToken The stop token for cooperative cancellation.
     void run(const std::stop_token& stopToken)
     {
+        auto streaming = false;
         while (!stopToken.stop_requested())
         {
             auto sentence = std::string {};
             {
                 auto lock = std::unique_lock(mutex);
+
+                // While the stream plays out, a new sentence can still continue it without a gap.
+                while (streaming && queue.empty() && !shutdownRequested && !stopToken.stop_requested())
+                {
+                    if (playback.isDrained() || playback.isStopped())
+                    {
+                        lock.unlock();
+                        playback.finishStream();
+                        lock.lock();
+                        streaming = false;
+
+                        // If queue is now empty and a flush is pending, notify the flusher
+                        busy = false;
+                        if (queue.empty() && onIdle)
+                            onIdle();
+                        if (queue.empty() && flushRequested)
+                        {
+                            flushRequested = false;
+                            cv.notify_all();
+                        }
+                        break;
+                    }
+                    (void) cv.wait_for(lock, stopToken, DrainPollInterval, [this] {
+                        return !queue.empty() || shutdownRequested;
+                    });
+                }
+
                 cv.wait(lock, stopToken, [this] { return !queue.empty() || shutdownRequested; });
 
                 if (stopToken.stop_requested() || shutdownRequested)
@@ -66,6 +139,9 @@ struct TtsSpeaker::Impl
                     // Notify flush waiters before exiting
                     flushRequested = false;
                     cv.notify_all();
+                    lock.unlock();
+                    if (streaming)
+                        playback.finishStream();
                     return;
                 }
 
@@ -77,25 +153,44 @@ struct TtsSpeaker::Impl
                 busy = true;
             }
 
-            synthesizeAndPlay(sentence);
-
-            // If queue is now empty and a flush is pending, notify the flusher
+            // A cancelled stream is not continued; cancel() flushed what it had buffered.
+            if (!streaming || playback.isStopped())
             {
-                auto lock = std::lock_guard(mutex);
-                busy = false;
-                if (queue.empty() && flushRequested)
-                {
-                    flushRequested = false;
-                    cv.notify_all();
-                }
+                playback.beginStream();
+                streaming = true;
+                awaitingAudio = true;
             }
+            synthesize(sentence);
         }
     }
 
-    /// @brief Synthesizes speech for a single sentence and plays it via the piper C API.
+    /// @brief Synthesizes speech for a single sentence into the playback stream via the piper C API.
+    ///
+    /// Each chunk is played as soon as piper produces it, while the next one is synthesized.
+    /// Short phrases are played from the phrase cache if they were synthesized before.
     /// @param text The text to synthesize.
-    void synthesizeAndPlay(const std::string& text)
+    void synthesize(const std::string& text)
     {
+        auto const zone = trace::Zone("tts", "synthesize");
+        auto key = std::string {};
+        if (phraseCache && text.size() <= MaxCachedPhraseChars)
+        {
+            key = SpeechCache::normalize(text);
+            auto const samples = phraseCache->lookup(key);
+            phraseCacheMemory.set(phraseCache->bytes()); // A lookup may load the phrase from disk.
+            if (samples)
+            {
+                log::debug("TTS: playing cached phrase \"{}\"", key);
+                auto const playZone = trace::Zone("tts", "play cached");
+                if (auto result = playback.write(*samples); !result)
+                    log::error("TTS playback failed: {}", result.error().message);
+                else
+                    notifyAudioStart();
+                return;
+            }
+        }
+
+        auto synthesized = std::vector<float> {};
         auto opts = piper_default_synthesize_options(synth);
         auto const startResult = piper_synthesize_start(synth, text.c_str(), &opts);
         if (startResult != 0)
@@ -104,30 +199,46 @@ struct TtsSpeaker::Impl
             return;
         }
 
-        auto audioData = std::vector<float> {};
         auto chunk = piper_audio_chunk {};
-
-        while (true)
+        while (!playback.isStopped())
         {
             auto const rc = piper_synthesize_next(synth, &chunk);
             if (rc == 1) // PIPER_DONE
+            {
+                // Only complete phrases are cached, not ones cut short by cancel().
+                if (!key.empty())
+                {
+                    phraseCache->store(std::move(key), std::move(synthesized));
+                    phraseCacheMemory.set(phraseCache->bytes());
+                }
                 break;
+            }
             if (rc < 0) // PIPER_ERR_GENERIC
             {
                 log::error("TTS: piper_synthesize_next failed ({})", rc);
                 break;
             }
             // rc == 0: PIPER_OK
-            audioData.insert(audioData.end(), chunk.samples, chunk.samples + chunk.num_samples);
-        }
-
-        if (!audioData.empty())
-        {
-            auto result = playback.play(audioData);
+            if (!key.empty())
+                synthesized.insert(synthesized.end(), chunk.samples, chunk.samples + chunk.num_samples);
+            // Blocks while the stream's buffer is full, i.e. while synthesis is ahead of playback.
+            auto const playZone = trace::Zone("tts", "play");
+            auto result = playback.write(std::span<const float>(chunk.samples, chunk.num_samples));
             if (!result)
+            {
                 log::error("TTS playback failed: {}", result.error().message);
+                break;
+            }
+            notifyAudioStart();
         }
     }
+
+    /// @brief Calls onAudioStart for the first audio written to the current stream.
+    void notifyAudioStart()
+    {
+        if (std::exchange(awaitingAudio, false) && onAudioStart)
+            onAudioStart();
+    }
 };
 
 TtsSpeaker::TtsSpeaker(): _impl(std::make_unique<Impl>())
@@ -156,10 +267,23 @@ auto TtsSpeaker::initialize(const TtsSpeakerConfig& config) -> VoidResult
                                      configPath,
                                      espeakData));
 
-    auto result = _impl->playback.initialize(PiperSampleRate, PiperChannels);
+    auto ec = std::error_code {};
+    if (auto const fileSize = std::filesystem::file_size(config.modelPath, ec); !ec)
+        _impl->voiceMemory.set(static_cast<std::size_t>(fileSize));
+
+    auto result = _impl->playback.initialize(PiperSampleRate, PiperChannels, LookaheadSeconds);
     if (!result)
         return result;
 
+    if (config.phraseCacheBytes > 0)
+    {
+        auto directory = std::filesystem::path {};
+        if (!config.phraseCacheDirectory.empty())
+            directory = std::filesystem::path(config.phraseCacheDirectory)
+                        / voiceFingerprint(config.modelPath, configPath);
+        _impl->phraseCache = std::make_unique<SpeechCache>(config.phraseCacheBytes, std::move(directory));
+    }
+
     // Start worker thread
     _impl->worker = std::jthread([this](const std::stop_token& token) { _impl->run(token); });
 
@@ -190,11 +314,31 @@ auto TtsSpeaker::idle() const -> bool
     return _impl->queue.empty() && !_impl->busy;
 }
 
+auto TtsSpeaker::playbackLevel() const -> float
+{
+    return _impl->playback.outputLevel();
+}
+
+void TtsSpeaker::setIdleCallback(std::function<void()> callback)
+{
+    auto lock = std::lock_guard(_impl->mutex);
+    _impl->onIdle = std::move(callback);
+}
+
+void TtsSpeaker::setAudioStartCallback(std::function<void()> callback)
+{
+    auto lock = std::lock_guard(_impl->mutex);
+    _impl->onAudioStart = std::move(callback);
+}
+
 void TtsSpeaker::cancel()
 {
     {
         auto lock = std::lock_guard(_impl->mutex);
         _impl->queue.clear();
+        // A busy worker becomes idle once the stopped stream has drained.
+        if (!_impl->busy && _impl->onIdle)
+            _impl->onIdle();
     }
 
     _impl->playback.stop();
@@ -3,6 +3,8 @@
 
 #include <core/Error.hpp>
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -17,6 +19,14 @@ struct TtsSpeakerConfig
 
     /// @brief Path to the espeak-ng-data directory (defaults to built-in).
     std::string espeakDataPath;
+
+    /// @brief Memory for caching the audio of short phrases, or 0 to synthesize every phrase.
+    std::size_t phraseCacheBytes = 0;
+
+    /// @brief Directory to persist cached phrases in, or empty to keep them in memory only.
+    ///
+    /// Each voice model gets its own subdirectory.
+    std::string phraseCacheDirectory;
 };
 
 /// @brief Synthesizes speech using the piper library (linked at build time).
@@ -47,6 +57,23 @@ class TtsSpeaker
     /// @brief Returns true when no sentences are queued and nothing is being synthesized or played.
     [[nodiscard]] auto idle() const -> bool;
 
+    /// @brief Sets a function called when the speaker becomes idle, e.g. to wake a waiting UI.
+    ///
+    /// Called on the worker thread, or on the thread calling cancel(), with the speaker's lock
+    /// held, so it must not call back into the speaker. Must be set before speaking.
+    void setIdleCallback(std::function<void()> callback);
+
+    /// @brief Sets a function called when speech starts, as the first audio after being idle is
+    ///        handed to playback, e.g. to measure how long speech takes to start.
+    ///
+    /// Called on the worker thread, without the speaker's lock. Must be set before speaking.
+    void setAudioStartCallback(std::function<void()> callback);
+
+    /// @brief Returns the RMS level of the speech played recently, e.g. to tell its echo apart.
+    ///
+    /// Safe to call from any thread.
+    [[nodiscard]] auto playbackLevel() const -> float;
+
     /// @brief Cancels any active synthesis and clears the queue.
     void cancel();
 
@@ -1,21 +1,55 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "VoiceActivityDetector.hpp"
 
+#include "Dsp.hpp"
+
 #include <core/Log.hpp>
 
 #include <whisper.h>
 
-#include <cmath>
+#include <algorithm>
+#include <format>
+#include <string>
+#include <vector>
 
 namespace mychat
 {
 
+namespace
+{
+
+    /// @brief Frames the model sees per decision: the new one plus the ones before it.
+    ///
+    /// whisper_vad_detect_speech() starts every call from a fresh LSTM state, so the state is
+    /// carried across calls by running the model over the most recent audio again (256 ms).
+    constexpr auto HistoryFrames = size_t { 8 };
+
+    /// @brief Below this RMS level (about -54 dBFS) audio is taken as silence without the model.
+    constexpr auto PreGateRms = 0.002f;
+
+} // namespace
+
 struct VoiceActivityDetector::Impl
 {
-    // whisper.cpp includes a built-in VAD implementation
-    // We use a simple energy-based VAD as fallback
+    whisper_vad_context* ctx = nullptr; ///< Silero-VAD, or null to decide by energy alone.
+    std::vector<float> history;         ///< The most recent frames, oldest first.
     float energyThreshold = 0.01f;
-    bool modelLoaded = false;
+    bool initialized = false;
+
+    ~Impl()
+    {
+        if (ctx)
+            whisper_vad_free(ctx);
+    }
+
+    /// @brief Appends @p samples to the history, dropping what no longer fits.
+    void remember(std::span<const float> samples)
+    {
+        history.insert(history.end(), samples.begin(), samples.end());
+        auto const capacity = std::max(FrameSamples * HistoryFrames, samples.size());
+        if (history.size() > capacity)
+            history.erase(history.begin(), history.end() - static_cast<std::ptrdiff_t>(capacity));
+    }
 };
 
 VoiceActivityDetector::VoiceActivityDetector(): _impl(std::make_unique<Impl>())
@@ -26,33 +60,61 @@ VoiceActivityDetector::~VoiceActivityDetector() = default;
 
 auto VoiceActivityDetector::initialize(std::string_view modelPath) -> VoidResult
 {
-    // The Silero-VAD model path is optional; if not provided, use energy-based detection
+    // Without a Silero-VAD model, speech is detected by energy alone.
     if (!modelPath.empty())
     {
-        log::info("VAD model path specified: {} (using energy-based fallback for now)", modelPath);
+        auto params = whisper_vad_default_context_params();
+        params.n_threads = 1;
+        params.use_gpu = false; // A frame takes microseconds on the CPU; a GPU round trip costs more.
+
+        auto const path = std::string(modelPath);
+        _impl->ctx = whisper_vad_init_from_file_with_params(path.c_str(), params);
+        if (!_impl->ctx)
+            return makeError(ErrorCode::AudioError, std::format("Failed to load VAD model: {}", modelPath));
+        _impl->history.reserve(FrameSamples * (HistoryFrames + 1));
+        log::info("Silero-VAD model loaded: {}", modelPath);
+    }
+    else
+    {
+        log::info("No VAD model configured, using energy-based detection");
     }
 
-    _impl->modelLoaded = true;
+    _impl->initialized = true;
     log::info("Voice activity detector initialized");
     return {};
 }
 
 auto VoiceActivityDetector::process(std::span<const float> samples) -> Result<float>
 {
-    if (!_impl->modelLoaded)
+    if (!_impl->initialized)
         return makeError(ErrorCode::AudioError, "VAD not initialized");
 
-    // Energy-based VAD: compute RMS energy
-    auto energy = 0.0f;
-    for (auto const sample: samples)
-        energy += sample * sample;
+    auto const level = rmsLevel(samples);
+    if (!_impl->ctx)
+    {
+        // Normalize to 0..1 range with the threshold
+        return std::min(1.0f, level / (_impl->energyThreshold * 2.0f));
+    }
+
+    _impl->remember(samples);
+
+    // Quiet frames cannot be speech; they still go into the history the model sees next.
+    if (level < PreGateRms)
+        return 0.0f;
 
-    if (!samples.empty())
-        energy = std::sqrt(energy / static_cast<float>(samples.size()));
+    auto const& history = _impl->history;
+    if (!whisper_vad_detect_speech(_impl->ctx, history.data(), static_cast<int>(history.size())))
+        return makeError(ErrorCode::AudioError, "Silero-VAD inference failed");
 
-    // Normalize to 0..1 range with the threshold
-    auto const probability = std::min(1.0f, energy / (_impl->energyThreshold * 2.0f));
-    return probability;
+    auto const count = whisper_vad_n_probs(_impl->ctx);
+    if (count <= 0)
+        return 0.0f;
+    return whisper_vad_probs(_impl->ctx)[count - 1];
+}
+
+auto VoiceActivityDetector::rmsLevel(std::span<const float> samples) -> float
+{
+    return dsp::rms(dsp::measure(samples), samples.size());
 }
 
 auto VoiceActivityDetector::isSpeech(float probability, float threshold) -> bool
@@ -62,7 +124,7 @@ auto VoiceActivityDetector::isSpeech(float probability, float threshold) -> bool
 
 void VoiceActivityDetector::reset()
 {
-    // Reset any internal state
+    _impl->history.clear();
 }
 
 } // namespace mychat
@@ -3,16 +3,24 @@
 
 #include <core/Error.hpp>
 
+#include <cstddef>
 #include <memory>
 #include <span>
+#include <string_view>
 
 namespace mychat
 {
 
 /// @brief Voice Activity Detection using Silero-VAD (via whisper.cpp's GGML implementation).
+///
+/// A cheap RMS level check runs first, so frames that are too quiet to be speech never reach
+/// the model. Without a model, the RMS level alone decides.
 class VoiceActivityDetector
 {
   public:
+    /// @brief Samples per frame Silero-VAD works on, 32 ms at 16 kHz.
+    static constexpr auto FrameSamples = size_t { 512 };
+
     VoiceActivityDetector();
     ~VoiceActivityDetector();
 
@@ -20,12 +28,14 @@ class VoiceActivityDetector
     VoiceActivityDetector& operator=(const VoiceActivityDetector&) = delete;
 
     /// @brief Initializes the VAD model.
-    /// @param modelPath Path to the Silero-VAD ONNX/GGML model file.
+    /// @param modelPath Path to the Silero-VAD GGML model file, or empty for energy-based detection.
     /// @return Success or an error.
     [[nodiscard]] auto initialize(std::string_view modelPath) -> VoidResult;
 
     /// @brief Processes audio samples and returns the speech probability.
-    /// @param samples Float32 PCM samples at 16kHz mono.
+    ///
+    /// Consecutive calls are treated as one stream until reset(), so the model's state carries over.
+    /// @param samples Float32 PCM samples at 16kHz mono, ideally FrameSamples at a time.
     /// @return Speech probability (0.0 to 1.0) or an error.
     [[nodiscard]] auto process(std::span<const float> samples) -> Result<float>;
 
@@ -34,7 +44,10 @@ class VoiceActivityDetector
     /// @param threshold The detection threshold (default: 0.5).
     [[nodiscard]] static auto isSpeech(float probability, float threshold = 0.5f) -> bool;
 
-    /// @brief Resets the VAD state (call between utterances).
+    /// @brief Returns the RMS level of @p samples.
+    [[nodiscard]] static auto rmsLevel(std::span<const float> samples) -> float;
+
+    /// @brief Resets the VAD state, e.g. when the audio stream is interrupted.
     void reset();
 
   private:
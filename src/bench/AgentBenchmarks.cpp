@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <format>
+#include <string>
+
+#include <agent/AgentLoop.hpp>
+#include <bench/EchoServer.hpp>
+#include <bench/Latency.hpp>
+#include <llm/ChatSession.hpp>
+#include <llm/InferenceEngine.hpp>
+#include <mcp/ServerManager.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    /// @brief Stands in for the model: calls the echo tool a fixed number of times per turn, then
+    /// streams a short answer.
+    ///
+    /// It answers at once, so what the agent loop itself costs per step (prompt bookkeeping,
+    /// dispatching tool calls and collecting their results) is all that remains.
+    class ScriptedEngine: public InferenceEngine
+    {
+      public:
+        explicit ScriptedEngine(int toolSteps): _toolSteps(toolSteps) {}
+
+        auto generate(std::span<const ChatMessage> messages,
+                      std::span<const ToolDefinition> tools,
+                      const SamplerConfig& /*sampler*/,
+                      StreamCallback streamCb,
+                      ToolCallCallback toolCallCb,
+                      std::stop_token /*stopToken*/) -> Result<GenerateResult> override
+        {
+            auto result = GenerateResult {};
+            // Each step of the turn so far left an assistant message after the user's.
+            auto const last = messages.rbegin();
+            auto const turn = std::ranges::find(last, messages.rend(), Role::User, &ChatMessage::role);
+            auto const step = std::ranges::count(last, turn, Role::Assistant, &ChatMessage::role);
+            if (step < _toolSteps && !tools.empty())
+            {
+                auto call = ToolCall {
+                    .id = std::format("call_{}", step),
+                    .name = std::string(bench::EchoToolName),
+                    .arguments = { { "text", "The quick brown fox jumps over the lazy dog." } },
+                };
+                if (toolCallCb)
+                    toolCallCb(call);
+                result.toolCalls.push_back(std::move(call));
+                return result;
+            }
+
+            for (auto const token: { "The ", "tool ", "said ", "hello", "." })
+            {
+                if (streamCb)
+                    streamCb(token);
+                result.text += token;
+            }
+            return result;
+        }
+
+        void setContextOverflowPolicy(ContextOverflowPolicy /*policy*/) override {}
+
+        auto promptTokenCount(std::span<const ChatMessage> messages,
+                              std::span<const ToolDefinition> /*tools*/) -> Result<size_t> override
+        {
+            return messages.size() * 32;
+        }
+
+        [[nodiscard]] auto contextBudget() const -> size_t override { return 1 << 20; }
+
+        auto embed(std::string_view /*text*/) -> Result<std::vector<float>> override
+        {
+            return makeError(ErrorCode::InferenceError, "The scripted engine has no embeddings");
+        }
+
+      private:
+        int _toolSteps;
+    };
+
+    /// @brief Runs one user turn through AgentLoop, with the echo server answering its tool calls.
+    void processMessage(benchmark::State& state)
+    {
+        auto servers = ServerManager();
+        auto const server = McpServerConfig {
+            .name = "echo",
+            .command = MYCHAT_BENCH_ECHO_SERVER,
+            .args = {},
+            .env = {},
+            .cachedTools = {},
+            .lazyStart = false,
+        };
+        if (auto added = servers.addServer(server); !added)
+        {
+            state.SkipWithError(added.error().message.c_str());
+            return;
+        }
+
+        auto const toolSteps = static_cast<int>(state.range(0));
+        auto engine = ScriptedEngine(toolSteps);
+        auto session = ChatSession("You are a benchmark.");
+        auto agent = AgentLoop(engine, session, servers, AgentConfig {});
+
+        auto latency = bench::LatencyRecorder {};
+        for (auto _: state)
+        {
+            session.clear();
+            auto reply = Result<std::string> {};
+            latency.measure([&] { reply = agent.processMessage("Say hello through the echo tool."); });
+            if (!reply || agent.lastTurnMetrics().toolCalls != toolSteps)
+            {
+                state.SkipWithError(reply ? "Tool calls went missing" : reply.error().message.c_str());
+                break;
+            }
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * (toolSteps + 1));
+        latency.report(state);
+    }
+} // namespace
+
+BENCHMARK(processMessage)
+    ->Name("AgentLoop/processMessage")
+    ->ArgName("toolSteps")
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Corpus.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <iterator>
+#include <random>
+
+namespace mychat::bench
+{
+
+namespace
+{
+    /// @brief The engine's raw output is the same everywhere, unlike that of std distributions.
+    class Random
+    {
+      public:
+        explicit Random(std::uint32_t seed): _engine(seed) {}
+
+        /// @brief Returns a number in [0, bound).
+        auto below(std::size_t bound) -> std::size_t { return _engine() % bound; }
+
+        template <typename T, std::size_t N>
+        auto pick(std::array<T, N> const& items) -> T const&
+        {
+            return items[below(N)];
+        }
+
+      private:
+        std::mt19937 _engine;
+    };
+
+    constexpr auto Words = std::array<std::string_view, 24> {
+        "the",      "model",   "returns", "a",       "token",  "stream", "which",   "renderer",
+        "wraps",    "at",      "width",   "terminal", "output", "cache",  "context", "prompt",
+        "function", "parses",  "escape",  "sequence", "server", "tool",   "result",  "quickly",
+    };
+
+    constexpr auto Identifiers = std::array<std::string_view, 8> {
+        "std::vector<int>", "renderInputBox()", "--verbose", "config.json",
+        "TerminalOutput",   "0x7fff",           "nullptr",   "wordWrap(text, 80)",
+    };
+
+    constexpr auto CodeLines = std::array<std::string_view, 8> {
+        "for (auto i = 0; i < count; ++i)",
+        "    total += values[i] * weights[i];",
+        "if (!result)",
+        "    return std::unexpected(result.error());",
+        "auto const text = std::format(\"{} items\", items.size());",
+        "// Keep the cursor on the last visible row.",
+        "}",
+        "",
+    };
+
+    constexpr auto CjkPhrases = std::array<std::string_view, 10> {
+        "日本語の文章を表示します",
+        "终端中的中文文本换行",
+        "한국어 문장도 포함됩니다",
+        "東京都渋谷区",
+        "ひらがなとカタカナ",
+        "文字幅は二列です",
+        "漢字仮名交じり文",
+        "모델이 답변을 생성합니다",
+        "简体中文和繁體中文",
+        "全角（かっこ）と句読点、。",
+    };
+
+    constexpr auto Emoji = std::array<std::string_view, 6> {
+        "🙂", "🚀", "👍🏽", "🇯🇵", "👨‍👩‍👧", "✅",
+    };
+
+    void appendSentence(std::string& out, Random& random)
+    {
+        auto const words = 6 + random.below(14);
+        for (auto i = std::size_t { 0 }; i < words; ++i)
+        {
+            if (i > 0)
+                out += ' ';
+            switch (random.below(16))
+            {
+                case 0: std::format_to(std::back_inserter(out), "**{}**", random.pick(Words)); break;
+                case 1: std::format_to(std::back_inserter(out), "*{}*", random.pick(Words)); break;
+                case 2: std::format_to(std::back_inserter(out), "`{}`", random.pick(Identifiers)); break;
+                case 3:
+                    std::format_to(std::back_inserter(out), "[{}](https://example.com)", random.pick(Words));
+                    break;
+                default: out += random.pick(Words); break;
+            }
+        }
+        out += ". ";
+    }
+
+    void appendCodeBlock(std::string& out, Random& random)
+    {
+        out += "```cpp\n";
+        auto const lines = 4 + random.below(12);
+        for (auto i = std::size_t { 0 }; i < lines; ++i)
+        {
+            out += random.pick(CodeLines);
+            out += '\n';
+        }
+        out += "```\n\n";
+    }
+
+    void appendTable(std::string& out, Random& random)
+    {
+        out += "| Name | Value | Notes |\n|------|------:|-------|\n";
+        auto const rows = 3 + random.below(6);
+        for (auto i = std::size_t { 0 }; i < rows; ++i)
+            std::format_to(std::back_inserter(out),
+                           "| {} | {} | {} {} |\n",
+                           random.pick(Identifiers),
+                           random.below(100000),
+                           random.pick(Words),
+                           random.pick(Words));
+        out += '\n';
+    }
+
+    void appendList(std::string& out, Random& random)
+    {
+        auto const items = 2 + random.below(6);
+        auto const ordered = random.below(2) == 0;
+        for (auto i = std::size_t { 0 }; i < items; ++i)
+        {
+            if (ordered)
+                std::format_to(std::back_inserter(out), "{}. ", i + 1);
+            else
+                out += "- ";
+            appendSentence(out, random);
+            out += '\n';
+        }
+        out += '\n';
+    }
+} // namespace
+
+auto markdownTranscript(std::size_t bytes) -> std::string
+{
+    auto random = Random(1);
+    auto out = std::string {};
+    out.reserve(bytes + 1024);
+    while (out.size() < bytes)
+    {
+        switch (random.below(8))
+        {
+            case 0:
+                std::format_to(std::back_inserter(out),
+                               "{} {} {}\n\n",
+                               std::string(1 + random.below(3), '#'),
+                               random.pick(Words),
+                               random.pick(Words));
+                break;
+            case 1: appendCodeBlock(out, random); break;
+            case 2: appendTable(out, random); break;
+            case 3: appendList(out, random); break;
+            default:
+            {
+                auto const sentences = 2 + random.below(4);
+                for (auto i = std::size_t { 0 }; i < sentences; ++i)
+                    appendSentence(out, random);
+                out += "\n\n";
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+auto cjkText(std::size_t bytes) -> std::string
+{
+    auto random = Random(2);
+    auto out = std::string {};
+    out.reserve(bytes + 64);
+    while (out.size() < bytes)
+    {
+        switch (random.below(10))
+        {
+            case 0: out += random.pick(Emoji); break;
+            case 1:
+                out += ' ';
+                out += random.pick(Words);
+                out += ' ';
+                break;
+            default: out += random.pick(CjkPhrases); break;
+        }
+        if (random.below(6) == 0)
+            out += "。";
+    }
+    return out;
+}
+
+auto pastedSource(std::size_t bytes) -> std::string
+{
+    auto random = Random(3);
+    auto out = std::string {};
+    out.reserve(bytes + 64);
+    while (out.size() < bytes)
+    {
+        out += random.pick(CodeLines);
+        out += '\r';
+    }
+    return out;
+}
+
+auto tokenize(std::string_view text) -> std::vector<std::string_view>
+{
+    auto random = Random(4);
+    auto tokens = std::vector<std::string_view> {};
+    tokens.reserve(text.size() / 4);
+    auto pos = std::size_t { 0 };
+    while (pos < text.size())
+    {
+        auto end = std::min(text.size(), pos + 1 + random.below(12));
+        while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80)
+            ++end;
+        tokens.push_back(text.substr(pos, end - pos));
+        pos = end;
+    }
+    return tokens;
+}
+
+auto photo(int width, int height) -> Picture
+{
+    auto random = Random(5);
+    auto picture = Picture { .pixels = {}, .width = width, .height = height };
+    picture.pixels.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4);
+
+    auto const cx = static_cast<float>(width) * 0.6f;
+    auto const cy = static_cast<float>(height) * 0.4f;
+    auto const radius = static_cast<float>(std::min(width, height)) * 0.25f;
+    auto* pixel = picture.pixels.data();
+    for (auto y = 0; y < height; ++y)
+    {
+        for (auto x = 0; x < width; ++x, pixel += 4)
+        {
+            auto const fx = static_cast<float>(x) / static_cast<float>(width);
+            auto const fy = static_cast<float>(y) / static_cast<float>(height);
+            auto r = 40.0f + 180.0f * fx;
+            auto g = 90.0f + 120.0f * fy;
+            auto b = 200.0f - 150.0f * fx * fy;
+            if (std::hypot(static_cast<float>(x) - cx, static_cast<float>(y) - cy) < radius)
+            {
+                r = 230.0f - 60.0f * fy;
+                g = 180.0f;
+                b = 40.0f + 40.0f * fx;
+            }
+            auto const noise = static_cast<float>(random.below(17)) - 8.0f;
+            pixel[0] = static_cast<std::uint8_t>(std::clamp(r + noise, 0.0f, 255.0f));
+            pixel[1] = static_cast<std::uint8_t>(std::clamp(g + noise, 0.0f, 255.0f));
+            pixel[2] = static_cast<std::uint8_t>(std::clamp(b + noise, 0.0f, 255.0f));
+            pixel[3] = 255;
+        }
+    }
+    return picture;
+}
+
+} // namespace mychat::bench
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tui/Sixel.hpp>
+
+/// @brief Inputs for the benchmarks, resembling what mychat renders and parses.
+///
+/// Everything is generated from a fixed seed, so runs on different commits see the same data.
+namespace mychat::bench
+{
+
+/// @brief Returns a long markdown transcript of about @p bytes: headings, paragraphs with
+/// emphasis and inline code, lists, fenced code blocks and tables, as replies of a model are.
+[[nodiscard]] auto markdownTranscript(std::size_t bytes) -> std::string;
+
+/// @brief Returns about @p bytes of mostly CJK prose: Han, kana and Hangul with some ASCII
+/// words, emoji and punctuation mixed in.
+[[nodiscard]] auto cjkText(std::size_t bytes) -> std::string;
+
+/// @brief Returns about @p bytes of pasted source code, lines separated by CR as terminals send.
+[[nodiscard]] auto pastedSource(std::size_t bytes) -> std::string;
+
+/// @brief Splits @p text into pieces of 1 to 12 bytes, as tokens stream in from a model.
+///
+/// Pieces never split a UTF-8 sequence.
+[[nodiscard]] auto tokenize(std::string_view text) -> std::vector<std::string_view>;
+
+/// @brief An RGBA image owning its pixels.
+struct Picture
+{
+    std::vector<std::uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+
+    [[nodiscard]] auto view() const noexcept -> tui::ImageData
+    {
+        return tui::ImageData { .pixels = pixels, .width = width, .height = height };
+    }
+};
+
+/// @brief Returns a photo-like image: smooth gradients, a few shapes and noise, so it has many
+/// distinct colors as screenshots and photos returned by tools do.
+[[nodiscard]] auto photo(int width, int height) -> Picture;
+
+} // namespace mychat::bench
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "EchoServer.hpp"
+
+#include <mcp/JsonRpc.hpp>
+
+namespace mychat::bench
+{
+
+namespace
+{
+    auto respond(nlohmann::json const& request) -> std::optional<nlohmann::json>
+    {
+        if (!request.contains("id"))
+            return std::nullopt;
+
+        auto const& id = request["id"];
+        auto const method = request.value("method", std::string {});
+        auto const params = request.value("params", nlohmann::json::object());
+
+        if (method == "initialize")
+            return jsonrpc::makeResponse(
+                id,
+                {
+                    { "protocolVersion", params.value("protocolVersion", std::string("2024-11-05")) },
+                    { "capabilities", { { "tools", nlohmann::json::object() } } },
+                    { "serverInfo", { { "name", "mychat-bench-echo" }, { "version", "1.0.0" } } },
+                });
+
+        if (method == "tools/list")
+        {
+            auto tool = nlohmann::json {
+                { "name", EchoToolName },
+                { "description", "Returns the given text." },
+                { "inputSchema",
+                  {
+                      { "type", "object" },
+                      { "properties", { { "text", { { "type", "string" } } } } },
+                      { "required", { "text" } },
+                  } },
+            };
+            return jsonrpc::makeResponse(id, { { "tools", nlohmann::json::array({ std::move(tool) }) } });
+        }
+
+        if (method == "tools/call")
+        {
+            auto const arguments = params.value("arguments", nlohmann::json::object());
+            auto content = nlohmann::json {
+                { "type", "text" },
+                { "text", arguments.value("text", std::string {}) },
+            };
+            return jsonrpc::makeResponse(id,
+                                         {
+                                             { "content", nlohmann::json::array({ std::move(content) }) },
+                                             { "isError", false },
+                                         });
+        }
+
+        if (method == "ping")
+            return jsonrpc::makeResponse(id, nlohmann::json::object());
+
+        if (method == "echo")
+            return jsonrpc::makeResponse(id, params);
+
+        return jsonrpc::makeErrorResponse(id, -32601, "Method not found");
+    }
+} // namespace
+
+auto echoServerResponse(nlohmann::json const& message) -> std::optional<nlohmann::json>
+{
+    if (!message.is_array())
+        return respond(message);
+
+    auto responses = nlohmann::json::array();
+    for (auto const& request: message)
+        if (auto response = respond(request))
+            responses.push_back(std::move(*response));
+    if (responses.empty())
+        return std::nullopt;
+    return responses;
+}
+
+} // namespace mychat::bench
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <optional>
+#include <string_view>
+
+namespace mychat::bench
+{
+
+/// @brief Name of the one tool the echo server offers; it returns its "text" argument.
+constexpr auto EchoToolName = std::string_view("echo");
+
+/// @brief Answers a message sent to the scripted echo server.
+///
+/// The server speaks just enough MCP for McpClient and ServerManager: initialize, tools/list
+/// with the echo tool, tools/call and ping. The method "echo" returns its params as the result,
+/// for measuring the transport alone. Batches get a batch of responses.
+/// @return The response, or std::nullopt for notifications.
+[[nodiscard]] auto echoServerResponse(nlohmann::json const& message) -> std::optional<nlohmann::json>;
+
+} // namespace mychat::bench
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: Apache-2.0
+
+// The scripted MCP server the benchmarks talk to over stdio: one JSON-RPC message per line in,
+// one response per line out (see echoServerResponse()).
+
+#include <bench/EchoServer.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+int main()
+{
+    std::ios::sync_with_stdio(false);
+
+    auto line = std::string {};
+    auto output = std::string {};
+    while (std::getline(std::cin, line))
+    {
+        auto const message = nlohmann::json::parse(line, nullptr, false);
+        if (message.is_discarded())
+            continue;
+        auto const response = mychat::bench::echoServerResponse(message);
+        if (!response)
+            continue;
+
+        output = response->dump();
+        output += '\n';
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace mychat::bench
+{
+
+/// @brief Collects how long single operations take, to report their median and tail latency.
+///
+/// Google Benchmark only reports means per run; round trips to another thread or process vary
+/// too much for a mean to tell the whole story.
+class LatencyRecorder
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Runs @p operation and records how long it took.
+    template <typename Operation>
+    void measure(Operation&& operation)
+    {
+        auto const start = Clock::now();
+        operation();
+        _samples.push_back(Clock::now() - start);
+    }
+
+    /// @brief Adds the p50 and p99 latencies in microseconds to the counters of @p state.
+    void report(benchmark::State& state)
+    {
+        if (_samples.empty())
+            return;
+        state.counters["p50_us"] = percentile(0.50);
+        state.counters["p99_us"] = percentile(0.99);
+    }
+
+  private:
+    std::vector<Clock::duration> _samples;
+
+    [[nodiscard]] auto percentile(double fraction) -> double
+    {
+        auto const rank = static_cast<std::size_t>(fraction * static_cast<double>(_samples.size() - 1));
+        auto const nth = _samples.begin() + static_cast<std::ptrdiff_t>(rank);
+        std::nth_element(_samples.begin(), nth, _samples.end());
+        return std::chrono::duration<double, std::micro>(*nth).count();
+    }
+};
+
+} // namespace mychat::bench
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include <bench/Corpus.hpp>
+#include <tui/MarkdownRenderer.hpp>
+#include <tui/Scrollback.hpp>
+#include <tui/TerminalOutput.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    /// @brief Streams a long reply token by token, as the chat area does while a model generates.
+    void feedTokens(benchmark::State& state)
+    {
+        auto const text = bench::markdownTranscript(static_cast<std::size_t>(state.range(0)));
+        auto const tokens = bench::tokenize(text);
+        auto output = tui::TerminalOutput {};
+        auto renderer = tui::MarkdownRenderer(output);
+        for (auto _: state)
+        {
+            renderer.beginStream();
+            for (auto const token: tokens)
+                renderer.feedToken(token);
+            benchmark::DoNotOptimize(output.pendingOutput().data());
+            output.discardPendingOutput();
+
+            // Ending the stream flushes; with the output suspended there is nothing to flush.
+            renderer.setSuspended(true);
+            renderer.endStream();
+            renderer.setSuspended(false);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+                                * static_cast<std::int64_t>(text.size()));
+        state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokens.size()),
+                                                      benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    /// @brief Streams a reply while recording it to the scrollback, as mychat does.
+    void feedTokensRecorded(benchmark::State& state)
+    {
+        auto const text = bench::markdownTranscript(static_cast<std::size_t>(state.range(0)));
+        auto const tokens = bench::tokenize(text);
+        auto output = tui::TerminalOutput {};
+        auto renderer = tui::MarkdownRenderer(output);
+        for (auto _: state)
+        {
+            auto scrollback = tui::Scrollback {};
+            renderer.recordTo(&scrollback);
+            renderer.beginStream();
+            for (auto const token: tokens)
+                renderer.feedToken(token);
+            output.discardPendingOutput();
+            renderer.setSuspended(true);
+            renderer.endStream();
+            renderer.setSuspended(false);
+            renderer.recordTo(nullptr);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+                                * static_cast<std::int64_t>(text.size()));
+    }
+} // namespace
+
+BENCHMARK(feedTokens)->Name("MarkdownRenderer/feedToken")->Arg(4 * 1024)->Arg(256 * 1024);
+BENCHMARK(feedTokensRecorded)->Name("MarkdownRenderer/feedToken/recorded")->Arg(256 * 1024);
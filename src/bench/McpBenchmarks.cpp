@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <bench/EchoServer.hpp>
+#include <bench/Latency.hpp>
+#include <core/JsonUtils.hpp>
+#include <mcp/JsonRpc.hpp>
+#include <mcp/McpClient.hpp>
+#include <mcp/StdioTransport.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    /// @brief A payload of @p bytes that needs no escaping in JSON.
+    auto payload(std::int64_t bytes) -> std::string
+    {
+        auto text = std::string(static_cast<std::size_t>(bytes), ' ');
+        for (auto i = std::size_t { 0 }; i < text.size(); ++i)
+            text[i] = static_cast<char>('a' + i * 7 % 26);
+        return text;
+    }
+
+    void setBytesProcessed(benchmark::State& state, std::int64_t bytesPerIteration)
+    {
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * bytesPerIteration);
+    }
+
+    /// @brief Answers in process what the echo server would, with no process or pipe in between.
+    ///
+    /// Responses are queued by send() as text and handed out by receiveText(), as from a server that
+    /// replies at once, so McpClient's own overhead is all that is measured.
+    class LoopbackTransport: public Transport
+    {
+      public:
+        auto send(const nlohmann::json& message) -> VoidResult override
+        {
+            auto response = bench::echoServerResponse(message);
+            if (!response)
+                return {};
+            auto const lock = std::lock_guard(_mutex);
+            _inbox.push_back(response->dump());
+            _changed.notify_one();
+            return {};
+        }
+
+        auto receive() -> Result<nlohmann::json> override
+        {
+            return receiveText().and_then(json::parse);
+        }
+
+        auto receiveText() -> Result<std::string> override
+        {
+            auto lock = std::unique_lock(_mutex);
+            _changed.wait(lock, [this] { return _closed || !_inbox.empty(); });
+            if (_inbox.empty())
+                return makeError(ErrorCode::TransportError, "Loopback transport closed");
+            auto message = std::move(_inbox.front());
+            _inbox.pop_front();
+            return message;
+        }
+
+        void close() override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _closed = true;
+            _changed.notify_all();
+        }
+
+        auto isConnected() const -> bool override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            return !_closed;
+        }
+
+      private:
+        mutable std::mutex _mutex;
+        std::condition_variable _changed;
+        std::deque<std::string> _inbox;
+        bool _closed = false;
+    };
+
+    // =============================================================================
+    // JSON-RPC
+    // =============================================================================
+
+    /// @brief Builds and serializes a tools/call request, as McpClient does for each call.
+    void makeRequest(benchmark::State& state)
+    {
+        auto const text = payload(state.range(0));
+        auto id = std::int64_t { 0 };
+        for (auto _: state)
+        {
+            auto params =
+                nlohmann::json { { "name", bench::EchoToolName }, { "arguments", { { "text", text } } } };
+            auto request = jsonrpc::makeRequest(++id, "tools/call", std::move(params));
+            benchmark::DoNotOptimize(request.dump());
+        }
+        setBytesProcessed(state, state.range(0));
+    }
+
+    /// @brief A tools/call response line of the echo server, carrying @p bytes of text.
+    auto echoResponseLine(std::int64_t bytes) -> std::string
+    {
+        auto const arguments = nlohmann::json { { "text", payload(bytes) } };
+        auto const params = nlohmann::json { { "name", bench::EchoToolName }, { "arguments", arguments } };
+        return bench::echoServerResponse(jsonrpc::makeRequest(1, "tools/call", params))->dump();
+    }
+
+    /// @brief Parses a received tools/call response line into a DOM, as McpClient used to.
+    void parseResponse(benchmark::State& state)
+    {
+        auto const line = echoResponseLine(state.range(0));
+        for (auto _: state)
+        {
+            auto const message = nlohmann::json::parse(line);
+            benchmark::DoNotOptimize(jsonrpc::parseResponse(message));
+        }
+        setBytesProcessed(state, static_cast<std::int64_t>(line.size()));
+    }
+
+    /// @brief Scans the envelope of the same line, leaving the result as text, as McpClient does.
+    void scanMessage(benchmark::State& state)
+    {
+        auto const line = echoResponseLine(state.range(0));
+        for (auto _: state)
+            benchmark::DoNotOptimize(jsonrpc::scanMessage(line));
+        setBytesProcessed(state, static_cast<std::int64_t>(line.size()));
+    }
+
+    // =============================================================================
+    // McpClient
+    // =============================================================================
+
+    /// @brief Calls the echo tool through McpClient over the in-process transport.
+    void callToolLoopback(benchmark::State& state)
+    {
+        auto client = McpClient(std::make_unique<LoopbackTransport>());
+        if (auto initialized = client.initialize(); !initialized)
+        {
+            state.SkipWithError(initialized.error().message.c_str());
+            return;
+        }
+
+        auto const arguments = nlohmann::json { { "text", payload(state.range(0)) } };
+        auto latency = bench::LatencyRecorder {};
+        for (auto _: state)
+        {
+            latency.measure([&] {
+                auto result = client.callTool(bench::EchoToolName, arguments);
+                benchmark::DoNotOptimize(result);
+            });
+        }
+        latency.report(state);
+    }
+
+    // =============================================================================
+    // StdioTransport
+    // =============================================================================
+
+    /// @brief Sends a payload to the echo server process and waits for it to come back.
+    void stdioRoundTrip(benchmark::State& state)
+    {
+        auto transport = StdioTransport();
+        auto const config = StdioTransportConfig {
+            .command = MYCHAT_BENCH_ECHO_SERVER,
+            .args = {},
+            .env = {},
+            .writeTimeout = {},
+        };
+        if (auto started = transport.start(config); !started)
+        {
+            state.SkipWithError(started.error().message.c_str());
+            return;
+        }
+
+        auto const params = nlohmann::json { { "text", payload(state.range(0)) } };
+        auto latency = bench::LatencyRecorder {};
+        auto id = std::int64_t { 0 };
+        for (auto _: state)
+        {
+            auto failed = false;
+            latency.measure([&] {
+                auto const sent = transport.send(jsonrpc::makeRequest(++id, "echo", params));
+                failed = !sent || !transport.receive();
+            });
+            if (failed)
+            {
+                state.SkipWithError("Echo server did not answer");
+                break;
+            }
+        }
+        transport.close();
+
+        // The payload goes both ways.
+        setBytesProcessed(state, 2 * state.range(0));
+        latency.report(state);
+    }
+} // namespace
+
+BENCHMARK(makeRequest)->Name("jsonrpc/makeRequest")->Arg(64)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(parseResponse)->Name("jsonrpc/parseResponse")->Arg(64)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(scanMessage)->Name("jsonrpc/scanMessage")->Arg(64)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(callToolLoopback)
+    ->Name("McpClient/callTool/loopback")
+    ->Arg(64)
+    ->Arg(64 * 1024)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK(stdioRoundTrip)
+    ->Name("StdioTransport/roundTrip")
+    ->Arg(1024)
+    ->Arg(64 * 1024)
+    ->Arg(1024 * 1024)
+    ->Arg(50 * 1024 * 1024)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <bench/Corpus.hpp>
+#include <tui/Sixel.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    void setPixelsProcessed(benchmark::State& state, bench::Picture const& picture)
+    {
+        state.counters["pixels"] =
+            benchmark::Counter(static_cast<double>(picture.width) * static_cast<double>(picture.height),
+                               benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    /// @brief Quantizes and encodes an image, as done for each image a tool returns.
+    void encode(benchmark::State& state)
+    {
+        auto const picture = bench::photo(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::encodeSixel(picture.view()));
+        setPixelsProcessed(state, picture);
+    }
+
+    void quantize(benchmark::State& state)
+    {
+        auto const picture = bench::photo(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::SixelPalette::quantize(picture.view()));
+        setPixelsProcessed(state, picture);
+    }
+
+    /// @brief Encodes with a palette quantized once, as for the frames of an animation.
+    void encodeWithPalette(benchmark::State& state)
+    {
+        auto const picture = bench::photo(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        auto const palette = tui::SixelPalette::quantize(picture.view());
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::encodeSixel(picture.view(), palette));
+        setPixelsProcessed(state, picture);
+    }
+} // namespace
+
+BENCHMARK(encode)
+    ->Name("encodeSixel")
+    ->Args({ 256, 256 })
+    ->Args({ 1280, 800 })
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(quantize)->Name("SixelPalette/quantize")->Args({ 1280, 800 })->Unit(benchmark::kMillisecond);
+BENCHMARK(encodeWithPalette)
+    ->Name("encodeSixel/palette")
+    ->Args({ 1280, 800 })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
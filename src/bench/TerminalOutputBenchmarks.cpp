@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <bench/Corpus.hpp>
+#include <tui/Box.hpp>
+#include <tui/TerminalOutput.hpp>
+#include <tui/Text.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    /// @brief Draws the input box into a frame, as each keystroke does.
+    void renderBox(benchmark::State& state)
+    {
+        auto output = tui::TerminalOutput {};
+        auto border = tui::Style {};
+        border.fg = tui::RgbColor { .r = 90, .g = 90, .b = 110 };
+        auto const box = tui::Box(tui::BoxConfig {
+            .row = 10,
+            .col = 8,
+            .width = static_cast<int>(state.range(0)),
+            .height = 5,
+            .border = tui::BorderStyle::Rounded,
+            .borderStyle = border,
+            .title = "Message",
+            .titleAlign = tui::TitleAlign::Left,
+            .titleStyle = {},
+            .paddingLeft = 1,
+            .paddingRight = 1,
+            .paddingTop = 0,
+            .paddingBottom = 0,
+            .fillBackground = true,
+            .backgroundStyle = {},
+        });
+        for (auto _: state)
+        {
+            {
+                auto const frame = output.frame();
+                box.render(output);
+            }
+            benchmark::DoNotOptimize(output.pendingOutput().data());
+            output.discardPendingOutput();
+        }
+    }
+
+    /// @brief Writes spans alternating between a few styles, which is what the SGR sequences
+    /// between them are generated for.
+    void writeStyledSpans(benchmark::State& state)
+    {
+        auto styles = std::array<tui::Style, 4> {};
+        styles[1].bold = true;
+        styles[2].fg = tui::RgbColor { .r = 130, .g = 180, .b = 255 };
+        styles[2].underline = true;
+        styles[3].fg = static_cast<std::uint8_t>(8);
+        styles[3].bg = static_cast<std::uint8_t>(236);
+        styles[3].italic = true;
+
+        auto output = tui::TerminalOutput {};
+        constexpr auto Spans = 1024;
+        for (auto _: state)
+        {
+            for (auto i = 0; i < Spans; ++i)
+                output.write("span", styles[static_cast<std::size_t>(i * 7 % 4)]);
+            benchmark::DoNotOptimize(output.pendingOutput().data());
+            output.discardPendingOutput();
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * Spans);
+    }
+
+    /// @brief Redraws a full screen of wrapped styled text in a frame, scrolled by two lines each
+    /// time, so the frame's diff compares every cell and emits most of them.
+    void redrawScreen(benchmark::State& state)
+    {
+        auto output = tui::TerminalOutput {};
+        auto const lines = tui::wordWrap(bench::markdownTranscript(16 * 1024), output.columns());
+        auto accent = tui::Style {};
+        accent.fg = tui::RgbColor { .r = 255, .g = 200, .b = 80 };
+        auto first = std::size_t { 0 };
+        for (auto _: state)
+        {
+            {
+                auto const frame = output.frame();
+                for (auto row = 1; row <= output.rows(); ++row)
+                {
+                    auto const& line = lines[(first + static_cast<std::size_t>(row)) % lines.size()];
+                    output.moveTo(row, 1);
+                    output.write(line, row % 2 == 0 ? accent : tui::Style {});
+                    output.clearToEndOfLine();
+                }
+            }
+            first += 2;
+            benchmark::DoNotOptimize(output.pendingOutput().data());
+            output.discardPendingOutput();
+        }
+    }
+} // namespace
+
+BENCHMARK(renderBox)->Name("Box/render")->Arg(64)->Arg(200);
+BENCHMARK(writeStyledSpans)->Name("TerminalOutput/write/styled");
+BENCHMARK(redrawScreen)->Name("TerminalOutput/frame/redraw");
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include <bench/Corpus.hpp>
+#include <tui/Text.hpp>
+#include <tui/Unicode.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    void setBytesProcessed(benchmark::State& state, std::string const& text)
+    {
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+                                * static_cast<std::int64_t>(text.size()));
+    }
+
+    void wordWrapMarkdown(benchmark::State& state)
+    {
+        auto const text = bench::markdownTranscript(64 * 1024);
+        auto const width = static_cast<int>(state.range(0));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::wordWrap(text, width));
+        setBytesProcessed(state, text);
+    }
+
+    void wordWrapCjk(benchmark::State& state)
+    {
+        auto const text = bench::cjkText(64 * 1024);
+        auto const width = static_cast<int>(state.range(0));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::wordWrap(text, width));
+        setBytesProcessed(state, text);
+    }
+
+    void displayWidthAscii(benchmark::State& state)
+    {
+        auto const text = bench::markdownTranscript(static_cast<std::size_t>(state.range(0)));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::displayWidth(text));
+        setBytesProcessed(state, text);
+    }
+
+    void displayWidthCjk(benchmark::State& state)
+    {
+        auto const text = bench::cjkText(static_cast<std::size_t>(state.range(0)));
+        for (auto _: state)
+            benchmark::DoNotOptimize(tui::displayWidth(text));
+        setBytesProcessed(state, text);
+    }
+} // namespace
+
+BENCHMARK(wordWrapMarkdown)->Name("wordWrap/markdown")->Arg(40)->Arg(80)->Arg(160);
+BENCHMARK(wordWrapCjk)->Name("wordWrap/cjk")->Arg(40)->Arg(80);
+BENCHMARK(displayWidthAscii)->Name("displayWidth/markdown")->Arg(64)->Arg(4096)->Arg(64 * 1024);
+BENCHMARK(displayWidthCjk)->Name("displayWidth/cjk")->Arg(64)->Arg(4096)->Arg(64 * 1024);
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <bench/Corpus.hpp>
+#include <tui/InputEvent.hpp>
+#include <tui/VtParser.hpp>
+
+using namespace mychat;
+
+namespace
+{
+    /// @brief Returns about @p bytes of interactive input: typed words, arrow keys, modified keys
+    /// in the kitty keyboard protocol, and SGR mouse reports.
+    auto interactiveInput(std::size_t bytes) -> std::string
+    {
+        auto const words = bench::markdownTranscript(bytes);
+        auto input = std::string {};
+        input.reserve(bytes * 2);
+        auto position = std::size_t { 0 };
+        for (auto i = 0; input.size() < bytes; ++i)
+        {
+            auto const end = std::min(words.size(), position + 8);
+            input.append(words, position, end - position);
+            position = end == words.size() ? 0 : end;
+            switch (i % 4)
+            {
+                case 0: input += "\033[D\033[C"; break;
+                case 1: input += "\033[97;5u"; break;
+                case 2: input += "\033[<0;42;17M\033[<0;42;17m"; break;
+                default: input += "\x7f"; break;
+            }
+        }
+        return input;
+    }
+
+    void feed(benchmark::State& state, std::string const& input)
+    {
+        auto parser = tui::VtParser {};
+        auto events = std::vector<tui::InputEvent> {};
+        for (auto _: state)
+        {
+            events.clear();
+            parser.feed(input, events);
+            benchmark::DoNotOptimize(events.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+                                * static_cast<std::int64_t>(input.size()));
+    }
+
+    void feedInteractive(benchmark::State& state)
+    {
+        feed(state, interactiveInput(static_cast<std::size_t>(state.range(0))));
+    }
+
+    /// @brief A bracketed paste of source code, as when pasting a file into the input box.
+    void feedPaste(benchmark::State& state)
+    {
+        auto const source = bench::pastedSource(static_cast<std::size_t>(state.range(0)));
+        feed(state, "\033[200~" + source + "\033[201~");
+    }
+
+    /// @brief Text pasted into a terminal without bracketed paste, so it arrives as typed text.
+    void feedCjk(benchmark::State& state)
+    {
+        feed(state, bench::cjkText(static_cast<std::size_t>(state.range(0))));
+    }
+} // namespace
+
+BENCHMARK(feedInteractive)->Name("VtParser/feed/interactive")->Arg(4 * 1024);
+BENCHMARK(feedPaste)->Name("VtParser/feed/paste")->Arg(4 * 1024)->Arg(1024 * 1024);
+BENCHMARK(feedCjk)->Name("VtParser/feed/cjk")->Arg(64 * 1024);
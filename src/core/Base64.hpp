@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Decodes standard (RFC 4648) base64, as used for binary MCP content.
+///
+/// Padding is optional and line breaks are skipped, since some servers wrap their output.
+/// @return The decoded bytes, or std::nullopt if @p text is not valid base64.
+[[nodiscard]] inline auto decodeBase64(std::string_view text) -> std::optional<std::vector<std::uint8_t>>
+{
+    static constexpr auto Invalid = std::uint8_t { 0xFF };
+    static constexpr auto Alphabet = [] {
+        auto table = std::array<std::uint8_t, 256> {};
+        table.fill(Invalid);
+        auto const chars = std::string_view("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                            "abcdefghijklmnopqrstuvwxyz"
+                                            "0123456789+/");
+        for (auto i = size_t { 0 }; i < chars.size(); ++i)
+            table[static_cast<std::uint8_t>(chars[i])] = static_cast<std::uint8_t>(i);
+        return table;
+    }();
+
+    while (!text.empty() && text.back() == '=')
+        text.remove_suffix(1);
+
+    auto bytes = std::vector<std::uint8_t> {};
+    bytes.reserve(text.size() / 4 * 3 + 2);
+    auto bits = std::uint32_t { 0 };
+    auto bitCount = 0;
+    for (auto const c: text)
+    {
+        if (c == '\n' || c == '\r')
+            continue;
+        auto const value = Alphabet[static_cast<std::uint8_t>(c)];
+        if (value == Invalid)
+            return std::nullopt;
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            bytes.push_back(static_cast<std::uint8_t>(bits >> bitCount));
+        }
+    }
+    // A single leftover character cannot encode a byte; more than four bits of it would be lost.
+    if (bitCount >= 6)
+        return std::nullopt;
+    return bytes;
+}
+
+/// @brief Encodes @p bytes as standard (RFC 4648) base64 with padding.
+[[nodiscard]] inline auto encodeBase64(std::span<const std::uint8_t> bytes) -> std::string
+{
+    static constexpr auto Alphabet = std::string_view("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                                      "abcdefghijklmnopqrstuvwxyz"
+                                                      "0123456789+/");
+
+    auto text = std::string {};
+    text.reserve((bytes.size() + 2) / 3 * 4);
+    auto i = size_t { 0 };
+    for (; i + 3 <= bytes.size(); i += 3)
+    {
+        auto const bits =
+            (std::uint32_t { bytes[i] } << 16) | (std::uint32_t { bytes[i + 1] } << 8) | bytes[i + 2];
+        text += Alphabet[(bits >> 18) & 0x3F];
+        text += Alphabet[(bits >> 12) & 0x3F];
+        text += Alphabet[(bits >> 6) & 0x3F];
+        text += Alphabet[bits & 0x3F];
+    }
+    if (auto const rest = bytes.size() - i; rest > 0)
+    {
+        auto bits = std::uint32_t { bytes[i] } << 16;
+        if (rest == 2)
+            bits |= std::uint32_t { bytes[i + 1] } << 8;
+        text += Alphabet[(bits >> 18) & 0x3F];
+        text += Alphabet[(bits >> 12) & 0x3F];
+        text += rest == 2 ? Alphabet[(bits >> 6) & 0x3F] : '=';
+        text += '=';
+    }
+    return text;
+}
+
+} // namespace mychat
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "CpuBudget.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __APPLE__
+    #include <sys/sysctl.h>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+    /// @brief Returns the first line of the file at @p path, or an empty string.
+    auto readLine(std::string const& path) -> std::string
+    {
+        auto file = std::ifstream(path);
+        auto line = std::string {};
+        std::getline(file, line);
+        return line;
+    }
+
+    auto parseNumber(std::string_view text, unsigned& value) noexcept -> bool
+    {
+        auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc {} && end == text.data() + text.size();
+    }
+
+    /// @brief Returns how many of the first @p logicalCpus CPUs are of the fastest kind, or 0 if
+    ///        the system does not tell.
+    auto countPerformanceCpus(unsigned logicalCpus) -> unsigned
+    {
+#if defined(__linux__)
+        // Intel hybrid CPUs list their P-cores under a PMU of their own.
+        if (auto const cores = parseCpuList(readLine("/sys/devices/cpu_core/cpus")); !cores.empty())
+            return static_cast<unsigned>(cores.size());
+
+        // ARM big.LITTLE rates each CPU's capacity, the largest being 1024.
+        auto capacities = std::vector<unsigned> {};
+        for (auto cpu = 0u; cpu < logicalCpus; ++cpu)
+        {
+            auto capacity = 0u;
+            if (!parseNumber(readLine(std::format("/sys/devices/system/cpu/cpu{}/cpu_capacity", cpu)),
+                             capacity))
+                return 0;
+            capacities.push_back(capacity);
+        }
+        if (capacities.empty())
+            return 0;
+        return static_cast<unsigned>(std::ranges::count(capacities, std::ranges::max(capacities)));
+#elif defined(__APPLE__)
+        static_cast<void>(logicalCpus);
+        auto count = 0;
+        auto size = sizeof(count);
+        if (sysctlbyname("hw.perflevel0.logicalcpu", &count, &size, nullptr, 0) != 0 || count <= 0)
+            return 0;
+        return static_cast<unsigned>(count);
+#else
+        static_cast<void>(logicalCpus);
+        return 0;
+#endif
+    }
+} // namespace
+
+auto detectCpuTopology() -> CpuTopology
+{
+    auto const logical = std::max(1u, std::thread::hardware_concurrency());
+    auto const performance = countPerformanceCpus(logical);
+    return CpuTopology {
+        .logicalCpus = logical,
+        .performanceCpus = performance > 0 ? std::min(performance, logical) : logical,
+    };
+}
+
+auto parseCpuList(std::string_view list) -> std::vector<unsigned>
+{
+    while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+        list.remove_suffix(1);
+
+    auto cpus = std::vector<unsigned> {};
+    while (!list.empty())
+    {
+        auto const comma = list.find(',');
+        auto const range = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view {} : list.substr(comma + 1);
+
+        auto const dash = range.find('-');
+        auto first = 0u;
+        auto last = 0u;
+        if (!parseNumber(range.substr(0, dash), first))
+            return {};
+        if (dash == std::string_view::npos)
+            last = first;
+        else if (!parseNumber(range.substr(dash + 1), last) || last < first)
+            return {};
+        for (auto cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+auto planThreads(CpuTopology const& cpus, CpuWorkloads workloads) -> ThreadBudget
+{
+    auto const logical = static_cast<int>(std::max(1u, cpus.logicalCpus));
+    auto const fast = std::clamp(static_cast<int>(cpus.performanceCpus), 1, logical);
+    auto const hasEfficiencyCores = fast < logical;
+
+    auto const transcription = workloads.transcription ? std::clamp(fast / 4, 1, 4) : std::min(fast, 4);
+    auto const speech = workloads.speech && !hasEfficiencyCores ? 1 : 0;
+    auto const batch = std::max(1, fast - speech);
+    return ThreadBudget {
+        .decodeThreads = workloads.transcription ? std::max(1, batch - transcription) : batch,
+        .batchThreads = batch,
+        .transcriptionThreads = transcription,
+    };
+}
+
+} // namespace mychat
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief The CPUs threads can run on, told apart by speed on hybrid machines.
+struct CpuTopology
+{
+    unsigned logicalCpus = 1;
+
+    /// The fastest kind (P-cores, or the big cores of big.LITTLE); all CPUs on other machines.
+    unsigned performanceCpus = 1;
+};
+
+/// @brief Returns the CPUs of this machine.
+///
+/// Performance cores are told from efficiency cores on Linux (sysfs) and macOS (sysctl); elsewhere
+/// all CPUs count as performance cores.
+[[nodiscard]] auto detectCpuTopology() -> CpuTopology;
+
+/// @brief Returns the CPU numbers of a Linux CPU list such as "0-3,8,10-11", or nothing if malformed.
+[[nodiscard]] auto parseCpuList(std::string_view list) -> std::vector<unsigned>;
+
+/// @brief What runs alongside the LLM.
+struct CpuWorkloads
+{
+    bool transcription = false; ///< Whisper, transcribing voice input.
+    bool speech = false;        ///< Piper, speaking replies while the next sentences are decoded.
+};
+
+/// @brief How many threads each inference library gets, so that they do not compete for cores.
+struct ThreadBudget
+{
+    int decodeThreads = 1;        ///< For llama's single-token decode steps.
+    int batchThreads = 1;         ///< For llama's prompt prefill and other batches.
+    int transcriptionThreads = 1; ///< For whisper.
+
+    auto operator==(ThreadBudget const&) const -> bool = default;
+};
+
+/// @brief Splits the CPUs of @p cpus between the LLM and the @p workloads next to it.
+///
+/// llama's threads wait for each other after every layer, so they run on as many threads as there
+/// are performance cores, and fewer of them while whisper or piper need cores too: whisper's share
+/// is taken from decoding, with which partial transcriptions and barge-in overlap, but not from
+/// prefill, which starts once the transcription is done. Piper gets an efficiency core of its own
+/// if there is one, and otherwise one taken from both.
+[[nodiscard]] auto planThreads(CpuTopology const& cpus, CpuWorkloads workloads) -> ThreadBudget;
+
+} // namespace mychat
@@ -24,6 +24,7 @@ enum class ErrorCode
     ToolCallError,
     TimeoutError,
     DownloadError,
+    Cancelled, ///< A stop token ended the operation before it finished.
 };
 
 /// @brief Represents an error with a code and descriptive message.
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief Initial value of a 64-bit FNV-1a hash.
+constexpr auto Fnv1aOffsetBasis = std::uint64_t { 0xcbf29ce484222325ULL };
+
+/// @brief Computes (or continues) a 64-bit FNV-1a hash over raw bytes.
+///
+/// Used for stable cache keys persisted to disk, so unlike std::hash the result must not
+/// depend on the standard library implementation.
+/// @param bytes The data to hash.
+/// @param hash The hash of preceding data, to hash several pieces as one sequence.
+[[nodiscard]] constexpr auto fnv1a64(std::span<const std::uint8_t> bytes,
+                                     std::uint64_t hash = Fnv1aOffsetBasis) -> std::uint64_t
+{
+    for (auto const byte: bytes)
+    {
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/// @brief Computes (or continues) a 64-bit FNV-1a hash over the characters of a string.
+[[nodiscard]] constexpr auto fnv1a64(std::string_view text, std::uint64_t hash = Fnv1aOffsetBasis)
+    -> std::uint64_t
+{
+    for (auto const c: text)
+    {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/// @brief Incremental SHA-256, for verifying downloads against published checksums.
+class Sha256
+{
+  public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    /// @brief Hashes the next @p bytes of the message.
+    void update(std::span<const std::uint8_t> bytes) noexcept
+    {
+        _length += bytes.size();
+        if (_buffered > 0)
+        {
+            auto const take = std::min(bytes.size(), _block.size() - _buffered);
+            std::copy_n(bytes.begin(), take, _block.begin() + static_cast<std::ptrdiff_t>(_buffered));
+            _buffered += take;
+            bytes = bytes.subspan(take);
+            if (_buffered < _block.size())
+                return;
+            compress(_block);
+            _buffered = 0;
+        }
+        for (; bytes.size() >= _block.size(); bytes = bytes.subspan(_block.size()))
+            compress(bytes.first<64>());
+        std::ranges::copy(bytes, _block.begin());
+        _buffered = bytes.size();
+    }
+
+    /// @brief Hashes the next characters of the message.
+    void update(std::string_view text) noexcept
+    {
+        update(std::span(reinterpret_cast<std::uint8_t const*>(text.data()), text.size()));
+    }
+
+    /// @brief Returns the digest of the message hashed so far; the hash must not be updated after.
+    [[nodiscard]] auto finish() noexcept -> Digest
+    {
+        auto const bits = static_cast<std::uint64_t>(_length) * 8;
+        auto padding = std::array<std::uint8_t, 72> {};
+        padding[0] = 0x80;
+        auto const padded = (_buffered < 56 ? 56 : 120) - _buffered;
+        for (auto i = 0; i < 8; ++i)
+            padding[padded + static_cast<size_t>(i)] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+        update(std::span(padding).first(padded + 8));
+
+        auto digest = Digest {};
+        for (auto i = size_t { 0 }; i < _state.size(); ++i)
+            for (auto j = size_t { 0 }; j < 4; ++j)
+                digest[i * 4 + j] = static_cast<std::uint8_t>(_state[i] >> (24 - 8 * j));
+        return digest;
+    }
+
+    /// @brief Returns the digest as 64 lowercase hex digits, like sha256sum prints it.
+    [[nodiscard]] auto hexDigest() noexcept -> std::string
+    {
+        constexpr auto Digits = std::string_view("0123456789abcdef");
+        auto hex = std::string {};
+        for (auto const byte: finish())
+        {
+            hex += Digits[byte >> 4];
+            hex += Digits[byte & 0xf];
+        }
+        return hex;
+    }
+
+  private:
+    void compress(std::span<const std::uint8_t, 64> block) noexcept
+    {
+        static constexpr auto K = std::array<std::uint32_t, 64> {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+
+        auto w = std::array<std::uint32_t, 64> {};
+        for (auto i = size_t { 0 }; i < 16; ++i)
+            w[i] = (std::uint32_t { block[i * 4] } << 24) | (std::uint32_t { block[i * 4 + 1] } << 16)
+                   | (std::uint32_t { block[i * 4 + 2] } << 8) | std::uint32_t { block[i * 4 + 3] };
+        for (auto i = size_t { 16 }; i < 64; ++i)
+        {
+            auto const s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            auto const s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto v = _state;
+        for (auto i = size_t { 0 }; i < 64; ++i)
+        {
+            auto const s1 = std::rotr(v[4], 6) ^ std::rotr(v[4], 11) ^ std::rotr(v[4], 25);
+            auto const choice = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            auto const t1 = v[7] + s1 + choice + K[i] + w[i];
+            auto const s0 = std::rotr(v[0], 2) ^ std::rotr(v[0], 13) ^ std::rotr(v[0], 22);
+            auto const majority = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            v = { t1 + s0 + majority, v[0], v[1], v[2], v[3] + t1, v[4], v[5], v[6] };
+        }
+        for (auto i = size_t { 0 }; i < _state.size(); ++i)
+            _state[i] += v[i];
+    }
+
+    std::array<std::uint32_t, 8> _state { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    std::array<std::uint8_t, 64> _block {};
+    size_t _buffered = 0;
+    std::uint64_t _length = 0;
+};
+
+} // namespace mychat
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "JsonReader.hpp"
+
+#include <charconv>
+
+namespace mychat::json
+{
+
+namespace
+{
+    auto isWhitespace(char c) noexcept -> bool
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    /// @brief Returns the value of the four hex digits at @p digits, or nothing.
+    auto hexQuad(std::string_view digits) noexcept -> std::optional<std::uint32_t>
+    {
+        if (digits.size() < 4)
+            return std::nullopt;
+        auto value = std::uint32_t { 0 };
+        auto const [end, ec] = std::from_chars(digits.data(), digits.data() + 4, value, 16);
+        if (ec != std::errc {} || end != digits.data() + 4)
+            return std::nullopt;
+        return value;
+    }
+
+    void appendUtf8(std::string& out, std::uint32_t codepoint)
+    {
+        if (codepoint < 0x80)
+            out += static_cast<char>(codepoint);
+        else if (codepoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else if (codepoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+} // namespace
+
+auto unescapeString(std::string_view raw, std::string& out) -> bool
+{
+    out.clear();
+    out.reserve(raw.size());
+    auto pos = std::size_t { 0 };
+    while (pos < raw.size())
+    {
+        // Copies the run up to the next escape at once.
+        auto const escape = raw.find('\\', pos);
+        out.append(raw.substr(pos, escape - pos));
+        if (escape == std::string_view::npos)
+            return true;
+        if (escape + 1 >= raw.size())
+            return false;
+
+        pos = escape + 2;
+        switch (raw[escape + 1])
+        {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                auto codepoint = hexQuad(raw.substr(pos));
+                if (!codepoint)
+                    return false;
+                pos += 4;
+                if (*codepoint >= 0xD800 && *codepoint < 0xDC00)
+                {
+                    // A high surrogate, to be followed by the low one.
+                    auto const low =
+                        raw.substr(pos, 2) == "\\u" ? hexQuad(raw.substr(pos + 2)) : std::nullopt;
+                    if (!low || *low < 0xDC00 || *low >= 0xE000)
+                        return false;
+                    pos += 6;
+                    codepoint = 0x10000 + ((*codepoint - 0xD800) << 10) + (*low - 0xDC00);
+                }
+                else if (*codepoint >= 0xDC00 && *codepoint < 0xE000)
+                    return false;
+                appendUtf8(out, *codepoint);
+                break;
+            }
+            default: return false;
+        }
+    }
+    return true;
+}
+
+auto JsonReader::peek() noexcept -> Kind
+{
+    if (_failed)
+        return Kind::Invalid;
+    skipWhitespace();
+    if (_pos == _text.size())
+        return Kind::End;
+    switch (_text[_pos])
+    {
+        case '{': return Kind::Object;
+        case '[': return Kind::Array;
+        case '"': return Kind::String;
+        case 't':
+        case 'f': return Kind::Boolean;
+        case 'n': return Kind::Null;
+        default: {
+            auto const c = _text[_pos];
+            return c == '-' || (c >= '0' && c <= '9') ? Kind::Number : Kind::Invalid;
+        }
+    }
+}
+
+auto JsonReader::enterObject() noexcept -> bool
+{
+    if (!consume('{'))
+        return false;
+    _first = true;
+    return true;
+}
+
+auto JsonReader::enterArray() noexcept -> bool
+{
+    if (!consume('['))
+        return false;
+    _first = true;
+    return true;
+}
+
+auto JsonReader::nextMember() -> std::optional<std::string_view>
+{
+    if (!advance('}'))
+        return std::nullopt;
+
+    skipWhitespace();
+    auto escaped = false;
+    auto key = scanString(escaped);
+    if (!key)
+        return std::nullopt;
+    if (escaped)
+    {
+        if (!unescapeString(*key, _key))
+        {
+            fail();
+            return std::nullopt;
+        }
+        key = _key;
+    }
+    if (!consume(':'))
+        return std::nullopt;
+    return key;
+}
+
+auto JsonReader::nextElement() noexcept -> bool
+{
+    return advance(']');
+}
+
+auto JsonReader::readString(std::string& out) -> bool
+{
+    skipWhitespace();
+    auto escaped = false;
+    auto const raw = scanString(escaped);
+    if (!raw)
+        return false;
+    if (!escaped)
+    {
+        out.assign(*raw);
+        return true;
+    }
+    return unescapeString(*raw, out) || fail();
+}
+
+auto JsonReader::readBoolean(bool& out) noexcept -> bool
+{
+    if (peek() != Kind::Boolean)
+        return fail();
+    out = _text[_pos] == 't';
+    return skipLiteral(out ? "true" : "false");
+}
+
+auto JsonReader::readInteger(std::int64_t& out) noexcept -> bool
+{
+    if (peek() != Kind::Number)
+        return fail();
+    auto const begin = _pos;
+    if (!skipNumber())
+        return false;
+    auto const [end, ec] = std::from_chars(_text.data() + begin, _text.data() + _pos, out);
+    return (ec == std::errc {} && end == _text.data() + _pos) || fail();
+}
+
+auto JsonReader::skipValue() noexcept -> bool
+{
+    switch (peek())
+    {
+        case Kind::String: {
+            auto escaped = false;
+            return scanString(escaped).has_value();
+        }
+        case Kind::Number: return skipNumber();
+        case Kind::Boolean: return skipLiteral(_text[_pos] == 't' ? "true" : "false");
+        case Kind::Null: return skipLiteral("null");
+        case Kind::Object:
+        case Kind::Array: break;
+        case Kind::End:
+        case Kind::Invalid: return fail();
+    }
+
+    // Containers are skipped by counting brackets, stepping over strings as a whole.
+    auto depth = std::size_t { 0 };
+    while (_pos < _text.size())
+    {
+        switch (_text[_pos])
+        {
+            case '"': {
+                auto escaped = false;
+                if (!scanString(escaped))
+                    return false;
+                continue;
+            }
+            case '{':
+            case '[': ++depth; break;
+            case '}':
+            case ']':
+                if (--depth == 0)
+                {
+                    ++_pos;
+                    return true;
+                }
+                break;
+            default: break;
+        }
+        ++_pos;
+    }
+    return fail();
+}
+
+auto JsonReader::rawValue() noexcept -> std::optional<std::string_view>
+{
+    skipWhitespace();
+    auto const begin = _pos;
+    if (!skipValue())
+        return std::nullopt;
+    return _text.substr(begin, _pos - begin);
+}
+
+auto JsonReader::readJson() -> std::optional<nlohmann::json>
+{
+    auto const raw = rawValue();
+    if (!raw)
+        return std::nullopt;
+    auto value = nlohmann::json::parse(*raw, nullptr, false);
+    if (value.is_discarded())
+    {
+        fail();
+        return std::nullopt;
+    }
+    return value;
+}
+
+void JsonReader::skipWhitespace() noexcept
+{
+    while (_pos < _text.size() && isWhitespace(_text[_pos]))
+        ++_pos;
+}
+
+auto JsonReader::fail() noexcept -> bool
+{
+    _failed = true;
+    return false;
+}
+
+auto JsonReader::consume(char expected) noexcept -> bool
+{
+    if (_failed)
+        return false;
+    skipWhitespace();
+    if (_pos == _text.size() || _text[_pos] != expected)
+        return fail();
+    ++_pos;
+    return true;
+}
+
+auto JsonReader::skipLiteral(std::string_view literal) noexcept -> bool
+{
+    if (_text.substr(_pos, literal.size()) != literal)
+        return fail();
+    _pos += literal.size();
+    return true;
+}
+
+auto JsonReader::scanString(bool& escaped) noexcept -> std::optional<std::string_view>
+{
+    if (_failed || _pos == _text.size() || _text[_pos] != '"')
+    {
+        fail();
+        return std::nullopt;
+    }
+
+    auto const begin = ++_pos;
+    escaped = false;
+    while (_pos < _text.size())
+    {
+        auto const c = static_cast<unsigned char>(_text[_pos]);
+        if (c == '"')
+        {
+            ++_pos;
+            return _text.substr(begin, _pos - 1 - begin);
+        }
+        if (c == '\\')
+        {
+            escaped = true;
+            _pos += 2; // The escaped character cannot end the string; unescaping checks the rest.
+            continue;
+        }
+        if (c < 0x20)
+            break; // Control characters must be escaped.
+        ++_pos;
+    }
+    fail();
+    return std::nullopt;
+}
+
+auto JsonReader::skipNumber() noexcept -> bool
+{
+    auto const begin = _pos;
+    while (_pos < _text.size())
+    {
+        auto const c = _text[_pos];
+        if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E')
+            break;
+        ++_pos;
+    }
+    return _pos > begin || fail();
+}
+
+auto JsonReader::advance(char close) noexcept -> bool
+{
+    if (_failed)
+        return false;
+    skipWhitespace();
+    if (_pos < _text.size() && _text[_pos] == close)
+    {
+        // After a separator a value is read, so a trailing one fails there.
+        ++_pos;
+        _first = false;
+        return false;
+    }
+    if (!_first && !consume(','))
+        return false;
+    _first = false;
+    return true;
+}
+
+} // namespace mychat::json
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace mychat::json
+{
+
+/// @brief Reads JSON text front to back without building a DOM.
+///
+/// The caller walks the document, reading the values it needs straight into its own strings and
+/// skipping the rest, or parsing just one value into a nlohmann::json where it wants a DOM. Skipping
+/// only checks that brackets balance and strings end, so a skipped value may be malformed in ways a
+/// full parser would reject; everything that is read is checked.
+///
+/// Errors are sticky: once a call fails, all further calls fail as well, and failed() tells.
+class JsonReader
+{
+  public:
+    /// @brief What the next value is.
+    enum class Kind : std::uint8_t
+    {
+        Object,
+        Array,
+        String,
+        Number,
+        Boolean,
+        Null,
+        End,     ///< Only whitespace is left.
+        Invalid, ///< Not the start of a JSON value, or the reader failed.
+    };
+
+    /// @brief Reads @p text, which must outlive the reader and the views it returns.
+    explicit JsonReader(std::string_view text) noexcept: _text(text) {}
+
+    /// @brief Returns the kind of the next value, without consuming anything but whitespace.
+    [[nodiscard]] auto peek() noexcept -> Kind;
+
+    /// @brief Consumes the `{` of an object; members are then read with nextMember().
+    auto enterObject() noexcept -> bool;
+
+    /// @brief Consumes the `[` of an array; elements are then read with nextElement().
+    auto enterArray() noexcept -> bool;
+
+    /// @brief Moves to the next member of the object entered last, consuming its key.
+    ///
+    /// The member's value is to be read or skipped next.
+    /// @return The key, valid until the next call; or nothing once the object's `}` was consumed,
+    ///         or if the input is malformed.
+    [[nodiscard]] auto nextMember() -> std::optional<std::string_view>;
+
+    /// @brief Moves to the next element of the array entered last.
+    /// @return True if an element is to be read or skipped next; false once the `]` was consumed,
+    ///         or if the input is malformed.
+    [[nodiscard]] auto nextElement() noexcept -> bool;
+
+    /// @brief Reads a string, unescaping it into @p out, which is replaced.
+    auto readString(std::string& out) -> bool;
+
+    /// @brief Reads a boolean.
+    auto readBoolean(bool& out) noexcept -> bool;
+
+    /// @brief Reads an integer that fits @p out.
+    auto readInteger(std::int64_t& out) noexcept -> bool;
+
+    /// @brief Skips the next value, nested ones included.
+    auto skipValue() noexcept -> bool;
+
+    /// @brief Skips the next value and returns its JSON text.
+    [[nodiscard]] auto rawValue() noexcept -> std::optional<std::string_view>;
+
+    /// @brief Parses the next value into a DOM.
+    [[nodiscard]] auto readJson() -> std::optional<nlohmann::json>;
+
+    /// @brief Returns whether a call failed on malformed input.
+    [[nodiscard]] auto failed() const noexcept -> bool { return _failed; }
+
+    /// @brief Returns the offset the reader stopped at, e.g. to tell where the input is malformed.
+    [[nodiscard]] auto offset() const noexcept -> std::size_t { return _pos; }
+
+  private:
+    std::string_view _text;
+    std::size_t _pos = 0;
+    bool _first = false; ///< No member or element was read yet from the container entered last.
+    bool _failed = false;
+    std::string _key;    ///< The last key, if it had to be unescaped.
+
+    void skipWhitespace() noexcept;
+    auto fail() noexcept -> bool;
+    auto consume(char expected) noexcept -> bool;
+    auto skipLiteral(std::string_view literal) noexcept -> bool;
+    /// @brief Consumes a string; returns its raw contents between the quotes, escapes included.
+    auto scanString(bool& escaped) noexcept -> std::optional<std::string_view>;
+    auto skipNumber() noexcept -> bool;
+    /// @brief Ends the container entered last if @p close is next, else consumes the separator.
+    /// @return True if another member or element follows.
+    auto advance(char close) noexcept -> bool;
+};
+
+/// @brief Unescapes the raw contents of a JSON string, as between its quotes, into @p out.
+/// @return False if an escape is malformed.
+auto unescapeString(std::string_view raw, std::string& out) -> bool;
+
+} // namespace mychat::json
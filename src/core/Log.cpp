@@ -1,15 +1,245 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "Log.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <print>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <core/MpscQueue.hpp>
+#include <nlohmann/json.hpp>
 
 namespace mychat::log
 {
 
 namespace
 {
-    auto globalLevel = Level::Info;
+    /// @brief A message waiting in the queue.
+    struct QueuedMessage
+    {
+        Level level = Level::Info;
+        std::string text; ///< Keeps its capacity when the slot is reused.
+    };
+
+    /// @brief A message waiting to be written to the log file.
+    struct FileRecord
+    {
+        Level level = Level::Info;
+        std::chrono::system_clock::time_point time;
+        std::uint32_t thread = 0;
+        std::string text; ///< Keeps its capacity when the slot is reused.
+    };
+
+    /// @brief Messages the log file's queue holds before dropping them.
+    constexpr auto FileQueueCapacity = std::size_t { 8192 };
+
+    /// @brief How long the writer thread sleeps when there is nothing to write.
+    constexpr auto FileFlushInterval = std::chrono::milliseconds { 50 };
+
+    constexpr auto levelPrefix(Level level) -> std::string_view
+    {
+        switch (level)
+        {
+            case Level::Error: return "ERROR";
+            case Level::Warning: return "WARN ";
+            case Level::Info: return "INFO ";
+            case Level::Debug: return "DEBUG";
+            case Level::Trace: return "TRACE";
+        }
+        return "?????";
+    }
+
+    constexpr auto levelName(Level level) -> std::string_view
+    {
+        switch (level)
+        {
+            case Level::Error: return "error";
+            case Level::Warning: return "warning";
+            case Level::Info: return "info";
+            case Level::Debug: return "debug";
+            case Level::Trace: return "trace";
+        }
+        return "unknown";
+    }
+
+    /// @brief Returns a small number identifying the calling thread, in the order threads first log.
+    auto threadNumber() -> std::uint32_t
+    {
+        static auto next = std::atomic<std::uint32_t> { 1 };
+        thread_local auto const number = next.fetch_add(1, std::memory_order_relaxed);
+        return number;
+    }
+
+    /// @brief Rotating log file written by a background thread.
+    class FileSink
+    {
+      public:
+        FileSink(FileSinkConfig config, std::FILE* file): _config(std::move(config)), _file(file)
+        {
+            std::fseek(_file, 0, SEEK_END);
+            _size = static_cast<std::size_t>(std::max(0L, std::ftell(_file)));
+            _writer = std::jthread([this](std::stop_token stop) { run(stop); });
+        }
+
+        ~FileSink()
+        {
+            _writer.request_stop();
+            _writer.join();
+            if (_file != nullptr)
+                std::fclose(_file);
+        }
+
+        FileSink(FileSink const&) = delete;
+        FileSink& operator=(FileSink const&) = delete;
+
+        /// @brief Queues a message (any thread).
+        void push(Level level, std::string_view message)
+        {
+            auto const fill = [&](FileRecord& record) {
+                record.level = level;
+                record.time = std::chrono::system_clock::now();
+                record.thread = threadNumber();
+                record.text.assign(message);
+            };
+            if (!_queue.tryPushWith(fill))
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+      private:
+        FileSinkConfig _config;
+        std::FILE* _file;
+        std::size_t _size = 0; ///< Bytes in the current file.
+        MpscQueue<FileRecord> _queue { FileQueueCapacity };
+        std::atomic<std::uint64_t> _dropped = 0;
+        std::string _line; ///< Reused for formatting each record.
+        std::mutex _sleepMutex;
+        std::condition_variable_any _sleep;
+        std::jthread _writer;
+
+        void run(std::stop_token const& stop)
+        {
+            while (!stop.stop_requested())
+            {
+                if (writeQueued() == 0)
+                {
+                    flush();
+                    auto lock = std::unique_lock(_sleepMutex);
+                    _sleep.wait_for(lock, stop, FileFlushInterval, [] { return false; });
+                }
+            }
+            writeQueued();
+            flush();
+        }
+
+        void flush()
+        {
+            if (_file != nullptr)
+                std::fflush(_file);
+        }
+
+        /// @brief Writes out what is queued; returns the number of records written.
+        auto writeQueued() -> std::size_t
+        {
+            auto count = std::size_t { 0 };
+            while (_queue.tryPopWith([this](FileRecord& record) { writeRecord(record); }))
+                ++count;
+
+            if (auto const dropped = _dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+            {
+                auto note = FileRecord { .level = Level::Warning,
+                                         .time = std::chrono::system_clock::now(),
+                                         .thread = 0,
+                                         .text = std::format("{} log messages dropped", dropped) };
+                writeRecord(note);
+            }
+            return count;
+        }
+
+        void writeRecord(FileRecord const& record)
+        {
+            auto const time = std::chrono::floor<std::chrono::milliseconds>(record.time);
+            _line.clear();
+            if (_config.format == FileFormat::JsonLines)
+            {
+                auto const text = nlohmann::json(record.text).dump(-1, ' ', false,
+                                                                   nlohmann::json::error_handler_t::replace);
+                std::format_to(std::back_inserter(_line),
+                               R"({{"ts":"{:%FT%T}Z","level":"{}","thread":{},"msg":{}}})",
+                               time,
+                               levelName(record.level),
+                               record.thread,
+                               text);
+            }
+            else
+            {
+                std::format_to(std::back_inserter(_line),
+                               "{:%FT%T}Z [{}] [t{}] {}",
+                               time,
+                               levelPrefix(record.level),
+                               record.thread,
+                               record.text);
+            }
+            _line += '\n';
+
+            if (_file != nullptr && _size > 0 && _size + _line.size() > _config.maxBytes)
+                rotate();
+            if (_file == nullptr)
+                return;
+            _size += std::fwrite(_line.data(), 1, _line.size(), _file);
+        }
+
+        /// @brief Moves path to path.1, path.1 to path.2 and so on, and starts a new file.
+        void rotate()
+        {
+            std::fclose(_file);
+            _file = nullptr;
+
+            auto const rotated = [&](int index) {
+                auto name = _config.path;
+                name += std::format(".{}", index);
+                return name;
+            };
+            auto ec = std::error_code {};
+            std::filesystem::remove(rotated(_config.maxFiles), ec);
+            for (auto i = _config.maxFiles - 1; i >= 1; --i)
+                std::filesystem::rename(rotated(i), rotated(i + 1), ec);
+            if (_config.maxFiles > 0)
+                std::filesystem::rename(_config.path, rotated(1), ec);
+
+            _file = std::fopen(_config.path.c_str(), "w");
+            _size = 0;
+        }
+    };
+
+    auto globalLevel = std::atomic<Level> { Level::Info };
     auto globalCallback = LogCallback {};
+
+    auto globalQueue = std::unique_ptr<MpscQueue<QueuedMessage>> {};
+    auto globalNotify = std::function<void()> {};
+    auto queueEnabled = std::atomic<bool> { false };
+    auto droppedCount = std::atomic<std::uint64_t> { 0 };
+
+    auto globalFileSink = std::unique_ptr<FileSink> {};
+    auto fileSink = std::atomic<FileSink*> { nullptr };
+
+    void deliver(Level level, std::string_view message)
+    {
+        if (globalCallback)
+        {
+            globalCallback(level, message);
+            return;
+        }
+
+        std::println(stderr, "[{}] {}", levelPrefix(level), message);
+    }
 } // namespace
 
 void setCallback(LogCallback callback)
@@ -17,40 +247,87 @@ void setCallback(LogCallback callback)
     globalCallback = std::move(callback);
 }
 
+void enableQueue(std::size_t capacity, std::function<void()> notify)
+{
+    drainQueue();
+    globalQueue = std::make_unique<MpscQueue<QueuedMessage>>(capacity);
+    globalNotify = std::move(notify);
+    queueEnabled.store(true, std::memory_order_release);
+}
+
+void disableQueue()
+{
+    queueEnabled.store(false, std::memory_order_release);
+    drainQueue();
+}
+
+auto drainQueue() -> std::size_t
+{
+    if (!globalQueue)
+        return 0;
+
+    auto count = std::size_t { 0 };
+    while (globalQueue->tryPopWith([](QueuedMessage& message) { deliver(message.level, message.text); }))
+        ++count;
+    return count;
+}
+
+auto takeDroppedCount() -> std::uint64_t
+{
+    return droppedCount.exchange(0, std::memory_order_relaxed);
+}
+
+auto openFileSink(FileSinkConfig config) -> VoidResult
+{
+    closeFileSink();
+
+    auto* file = std::fopen(config.path.c_str(), "a");
+    if (file == nullptr)
+        return makeError(ErrorCode::IoError, std::format("Cannot open log file {}", config.path.string()));
+
+    globalFileSink = std::make_unique<FileSink>(std::move(config), file);
+    fileSink.store(globalFileSink.get(), std::memory_order_release);
+    return {};
+}
+
+void closeFileSink()
+{
+    fileSink.store(nullptr, std::memory_order_release);
+    globalFileSink.reset();
+}
+
 void setLevel(Level level)
 {
-    globalLevel = level;
+    globalLevel.store(level, std::memory_order_relaxed);
 }
 
 auto getLevel() -> Level
 {
-    return globalLevel;
+    return globalLevel.load(std::memory_order_relaxed);
 }
 
 void write(Level level, std::string_view message)
 {
-    if (level > globalLevel)
+    if (!enabled(level))
         return;
 
-    if (globalCallback)
+    if (auto* sink = fileSink.load(std::memory_order_acquire))
+        sink->push(level, message);
+
+    if (queueEnabled.load(std::memory_order_acquire))
     {
-        globalCallback(level, message);
+        auto const fill = [&](QueuedMessage& slot) {
+            slot.level = level;
+            slot.text.assign(message);
+        };
+        if (!globalQueue->tryPushWith(fill))
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+        else if (globalNotify)
+            globalNotify();
         return;
     }
 
-    constexpr auto levelPrefix = [](Level l) -> std::string_view {
-        switch (l)
-        {
-            case Level::Error: return "ERROR";
-            case Level::Warning: return "WARN ";
-            case Level::Info: return "INFO ";
-            case Level::Debug: return "DEBUG";
-            case Level::Trace: return "TRACE";
-        }
-        return "?????";
-    };
-
-    std::println(stderr, "[{}] {}", levelPrefix(level), message);
+    deliver(level, message);
 }
 
 } // namespace mychat::log
@@ -1,10 +1,22 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <core/Error.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <format>
 #include <functional>
 #include <string_view>
 
+/// @brief The most verbose log level compiled in, as the index of a log::Level (0 = Error ...
+/// 4 = Trace). Messages above it are removed at compile time, arguments and all.
+#ifndef MYCHAT_LOG_LEVEL
+    #define MYCHAT_LOG_LEVEL 4
+#endif
+
 namespace mychat::log
 {
 
@@ -18,7 +30,12 @@ enum class Level
     Trace,
 };
 
+/// @brief The most verbose level compiled in; see MYCHAT_LOG_LEVEL.
+constexpr auto CompiledLevel = static_cast<Level>(MYCHAT_LOG_LEVEL);
+
 /// @brief Callback type that receives all log messages.
+///
+/// It runs on the thread that logs, or on the one calling drainQueue() while the queue is enabled.
 /// @param level The log level of the message.
 /// @param message The formatted log message text (without level prefix).
 using LogCallback = std::function<void(Level level, std::string_view message)>;
@@ -30,6 +47,61 @@ using LogCallback = std::function<void(Level level, std::string_view message)>;
 /// @param callback The callback to install, or empty to revert to stderr.
 void setCallback(LogCallback callback);
 
+/// @brief Routes log messages through a bounded lock-free queue instead of delivering them at once.
+///
+/// From then on write() only copies the message into a preallocated slot and calls @p notify, so
+/// logging threads never block on each other or on whatever the callback does. Messages finding
+/// the queue full are dropped and counted. The thread owning the output delivers queued messages
+/// with drainQueue().
+///
+/// Call this before other threads start logging, and disableQueue() after they stop; the queue
+/// stays allocated until the next call, so a thread that just missed disableQueue() is safe.
+/// @param capacity The number of messages the queue holds, rounded up to a power of two.
+/// @param notify Called after each queued message, on the logging thread; may be empty.
+void enableQueue(std::size_t capacity, std::function<void()> notify = {});
+
+/// @brief Delivers the queued messages and reverts to delivering messages as they are written.
+void disableQueue();
+
+/// @brief Delivers the messages queued so far, oldest first, to the callback or stderr.
+///
+/// Must only be called by one thread at a time.
+/// @return The number of messages delivered.
+auto drainQueue() -> std::size_t;
+
+/// @brief Returns the number of messages dropped because the queue was full since the last call.
+[[nodiscard]] auto takeDroppedCount() -> std::uint64_t;
+
+/// @brief Format of the lines written to the log file.
+enum class FileFormat
+{
+    Text,      ///< `<timestamp> [LEVEL] [t<thread>] <message>`
+    JsonLines, ///< One JSON object per line, with "ts", "level", "thread" and "msg" members.
+};
+
+/// @brief Settings of the rotating log file.
+struct FileSinkConfig
+{
+    std::filesystem::path path;                    ///< The file written to.
+    std::size_t maxBytes = std::size_t { 8 } << 20; ///< Size at which the file is rotated.
+    int maxFiles = 3;                               ///< Rotated files kept, as path.1 (newest) to path.N.
+    FileFormat format = FileFormat::Text;
+};
+
+/// @brief Writes every message also to a rotating log file, from a background thread.
+///
+/// Logging threads only copy the message, its time and their thread number into a lock-free
+/// queue; the writer thread formats and writes them, so a slow disk never holds up inference.
+/// Messages finding the queue full are dropped, and the file notes how many. The file is
+/// appended to if it exists.
+///
+/// Like enableQueue(), call this and closeFileSink() while no other thread logs.
+/// @return An IoError if the file cannot be opened.
+[[nodiscard]] auto openFileSink(FileSinkConfig config) -> VoidResult;
+
+/// @brief Writes out the messages still queued for the log file and closes it.
+void closeFileSink();
+
 /// @brief Sets the global log verbosity level.
 /// @param level The maximum level to output.
 void setLevel(Level level);
@@ -39,47 +111,85 @@ void setLevel(Level level);
 
 /// @brief Writes a log message at the given level.
 ///
-/// If a callback is installed via setCallback(), the message is routed there.
-/// Otherwise, it is written to stderr with a level prefix.
+/// If the queue is enabled, the message is queued for drainQueue(). Otherwise, if a callback is
+/// installed via setCallback(), the message is routed there, else it is written to stderr with a
+/// level prefix.
 /// @param level The log level.
 /// @param message The message to output.
 void write(Level level, std::string_view message);
 
+/// @brief Returns whether messages at @p level are written.
+[[nodiscard]] inline auto enabled(Level level) -> bool
+{
+    return level <= CompiledLevel && level <= getLevel();
+}
+
+namespace detail
+{
+    /// @brief Size of the buffer on the stack that messages are formatted into; longer ones allocate.
+    constexpr auto InlineMessageSize = std::size_t { 256 };
+
+    /// @brief Formats and writes a message whose level has been checked.
+    template <typename... Args>
+    void formatAndWrite(Level level, std::format_string<Args...> fmt, Args&&... args)
+    {
+        // Formatting only reads the arguments, so they are still there for a second attempt.
+        auto buffer = std::array<char, InlineMessageSize> {};
+        auto const limit = static_cast<std::ptrdiff_t>(buffer.size());
+        auto const result = std::format_to_n(buffer.data(), limit, fmt, std::forward<Args>(args)...);
+        if (result.size <= limit)
+            write(level, std::string_view(buffer.data(), static_cast<std::size_t>(result.size)));
+        else
+            write(level, std::format(fmt, std::forward<Args>(args)...));
+    }
+} // namespace detail
+
+// Each of these checks the level before looking at its arguments, so a message that is not
+// written costs a comparison, or nothing if its level is not compiled in.
+
 /// @brief Logs an error message.
 template <typename... Args>
 void error(std::format_string<Args...> fmt, Args&&... args)
 {
-    write(Level::Error, std::format(fmt, std::forward<Args>(args)...));
+    if constexpr (Level::Error <= CompiledLevel)
+        if (enabled(Level::Error))
+            detail::formatAndWrite(Level::Error, fmt, std::forward<Args>(args)...);
 }
 
 /// @brief Logs a warning message.
 template <typename... Args>
 void warning(std::format_string<Args...> fmt, Args&&... args)
 {
-    write(Level::Warning, std::format(fmt, std::forward<Args>(args)...));
+    if constexpr (Level::Warning <= CompiledLevel)
+        if (enabled(Level::Warning))
+            detail::formatAndWrite(Level::Warning, fmt, std::forward<Args>(args)...);
 }
 
 /// @brief Logs an info message.
 template <typename... Args>
 void info(std::format_string<Args...> fmt, Args&&... args)
 {
-    write(Level::Info, std::format(fmt, std::forward<Args>(args)...));
+    if constexpr (Level::Info <= CompiledLevel)
+        if (enabled(Level::Info))
+            detail::formatAndWrite(Level::Info, fmt, std::forward<Args>(args)...);
 }
 
 /// @brief Logs a debug message.
 template <typename... Args>
 void debug(std::format_string<Args...> fmt, Args&&... args)
 {
-    if (getLevel() >= Level::Debug)
-        write(Level::Debug, std::format(fmt, std::forward<Args>(args)...));
+    if constexpr (Level::Debug <= CompiledLevel)
+        if (enabled(Level::Debug))
+            detail::formatAndWrite(Level::Debug, fmt, std::forward<Args>(args)...);
 }
 
 /// @brief Logs a trace message.
 template <typename... Args>
 void trace(std::format_string<Args...> fmt, Args&&... args)
 {
-    if (getLevel() >= Level::Trace)
-        write(Level::Trace, std::format(fmt, std::forward<Args>(args)...));
+    if constexpr (Level::Trace <= CompiledLevel)
+        if (enabled(Level::Trace))
+            detail::formatAndWrite(Level::Trace, fmt, std::forward<Args>(args)...);
 }
 
 } // namespace mychat::log
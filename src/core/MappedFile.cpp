@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "MappedFile.hpp"
+
+#include <utility>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include <fstream>
+    #include <iterator>
+#endif
+
+namespace mychat
+{
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+#ifndef _WIN32
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#else
+        _buffer = std::move(other._buffer);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+auto MappedFile::open(std::filesystem::path const& path) -> bool
+{
+    close();
+#ifndef _WIN32
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat info {};
+    auto mapped = ::fstat(fd, &info) == 0;
+    if (mapped && info.st_size > 0)
+    {
+        _size = static_cast<std::size_t>(info.st_size);
+        _data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        mapped = _data != MAP_FAILED;
+        if (!mapped)
+        {
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+    ::close(fd);
+    return mapped;
+#else
+    auto in = std::ifstream(path, std::ios::binary);
+    if (!in)
+        return false;
+    _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+#endif
+}
+
+void MappedFile::close() noexcept
+{
+#ifndef _WIN32
+    if (_data)
+        ::munmap(_data, _size);
+    _data = nullptr;
+    _size = 0;
+#else
+    _buffer.clear();
+#endif
+}
+
+auto MappedFile::bytes() const noexcept -> std::span<const char>
+{
+#ifndef _WIN32
+    return { static_cast<char const*>(_data), _size };
+#else
+    return _buffer;
+#endif
+}
+
+} // namespace mychat
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief A file mapped read-only into memory (read into a buffer where mmap is unavailable).
+///
+/// The pages are shared with the page cache, so a large file costs no heap and only the parts
+/// that are read are ever loaded.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    /// @brief Maps @p path, replacing the file mapped before.
+    /// @return False if the file cannot be opened or mapped; an empty file maps to no bytes.
+    [[nodiscard]] auto open(std::filesystem::path const& path) -> bool;
+
+    /// @brief Unmaps the file.
+    void close() noexcept;
+
+    /// @brief Returns the file's contents, or nothing if no file is mapped.
+    [[nodiscard]] auto bytes() const noexcept -> std::span<const char>;
+
+  private:
+#ifndef _WIN32
+    void* _data = nullptr;
+    std::size_t _size = 0;
+#else
+    std::vector<char> _buffer;
+#endif
+};
+
+} // namespace mychat
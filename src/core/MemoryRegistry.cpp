@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "MemoryRegistry.hpp"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+namespace mychat
+{
+
+struct MemoryAccount::Entry
+{
+    std::string name;
+    MemoryCategory category = MemoryCategory::Caches;
+    MemoryReclaimer reclaimer;
+    std::atomic<std::size_t> bytes = 0;
+};
+
+auto memoryCategoryName(MemoryCategory category) noexcept -> std::string_view
+{
+    switch (category)
+    {
+        case MemoryCategory::ModelWeights: return "Model weights";
+        case MemoryCategory::KvCache: return "KV cache";
+        case MemoryCategory::SpeechModels: return "Speech models";
+        case MemoryCategory::AudioBuffers: return "Audio buffers";
+        case MemoryCategory::Caches: return "Caches";
+        case MemoryCategory::History: return "History";
+    }
+    return "Unknown";
+}
+
+MemoryAccount::MemoryAccount(MemoryRegistry& registry, std::shared_ptr<Entry> entry):
+    _registry(&registry), _entry(std::move(entry))
+{
+}
+
+MemoryAccount::MemoryAccount(MemoryAccount&& other) noexcept:
+    _registry(std::exchange(other._registry, nullptr)), _entry(std::move(other._entry))
+{
+}
+
+MemoryAccount& MemoryAccount::operator=(MemoryAccount&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        _registry = std::exchange(other._registry, nullptr);
+        _entry = std::move(other._entry);
+    }
+    return *this;
+}
+
+MemoryAccount::~MemoryAccount()
+{
+    close();
+}
+
+void MemoryAccount::set(std::size_t bytes) noexcept
+{
+    if (_entry)
+        _entry->bytes.store(bytes, std::memory_order_relaxed);
+}
+
+auto MemoryAccount::bytes() const noexcept -> std::size_t
+{
+    return _entry ? _entry->bytes.load(std::memory_order_relaxed) : 0;
+}
+
+void MemoryAccount::close()
+{
+    if (_registry && _entry)
+        _registry->remove(_entry.get());
+    _registry = nullptr;
+    _entry.reset();
+}
+
+auto MemoryRegistry::open(std::string name, MemoryCategory category, MemoryReclaimer reclaimer) -> MemoryAccount
+{
+    auto entry = std::make_shared<MemoryAccount::Entry>();
+    entry->name = std::move(name);
+    entry->category = category;
+    entry->reclaimer = std::move(reclaimer);
+
+    auto const lock = std::lock_guard(_mutex);
+    _entries.push_back(entry);
+    return MemoryAccount(*this, std::move(entry));
+}
+
+void MemoryRegistry::remove(MemoryAccount::Entry const* entry)
+{
+    // Waits for a running enforceBudget(), so a reclaimer never outlives its owner.
+    auto const lock = std::lock_guard(_mutex);
+    std::erase_if(_entries, [entry](auto const& candidate) { return candidate.get() == entry; });
+}
+
+auto MemoryRegistry::usage() const -> std::vector<MemoryUsage>
+{
+    auto result = std::vector<MemoryUsage> {};
+    {
+        auto const lock = std::lock_guard(_mutex);
+        result.reserve(_entries.size());
+        for (auto const& entry: _entries)
+            result.push_back(MemoryUsage { .name = entry->name,
+                                           .category = entry->category,
+                                           .bytes = entry->bytes.load(std::memory_order_relaxed),
+                                           .reclaimable = static_cast<bool>(entry->reclaimer) });
+    }
+    std::ranges::stable_sort(result, std::ranges::greater {}, &MemoryUsage::bytes);
+    return result;
+}
+
+auto MemoryRegistry::totalBytes() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto total = std::size_t { 0 };
+    for (auto const& entry: _entries)
+        total += entry->bytes.load(std::memory_order_relaxed);
+    return total;
+}
+
+auto MemoryRegistry::enforceBudget() -> std::size_t
+{
+    auto const budget = this->budget();
+    if (budget == 0)
+        return 0;
+
+    auto const lock = std::lock_guard(_mutex);
+    auto total = std::size_t { 0 };
+    auto candidates = std::vector<MemoryAccount::Entry*> {};
+    for (auto const& entry: _entries)
+    {
+        total += entry->bytes.load(std::memory_order_relaxed);
+        if (entry->reclaimer)
+            candidates.push_back(entry.get());
+    }
+    if (total <= budget)
+        return 0;
+
+    // Caches before history, then the largest first.
+    std::ranges::stable_sort(candidates, [](auto const* a, auto const* b) {
+        auto const aIsCache = a->category != MemoryCategory::History;
+        auto const bIsCache = b->category != MemoryCategory::History;
+        if (aIsCache != bIsCache)
+            return aIsCache;
+        return a->bytes.load(std::memory_order_relaxed) > b->bytes.load(std::memory_order_relaxed);
+    });
+
+    auto freed = std::size_t { 0 };
+    for (auto* entry: candidates)
+    {
+        if (total <= budget)
+            break;
+        auto const reclaimed = std::min(entry->reclaimer(total - budget), total);
+        total -= reclaimed;
+        freed += reclaimed;
+    }
+    return freed;
+}
+
+auto memoryRegistry() -> MemoryRegistry&
+{
+    // Leaked, so accounts of static objects may close after main() returns.
+    static auto* const registry = new MemoryRegistry();
+    return *registry;
+}
+
+auto formatMemorySize(std::size_t bytes) -> std::string
+{
+    auto const value = static_cast<double>(bytes);
+    if (bytes >= 1'000'000'000)
+        return std::format("{:.1f} GB", value / 1e9);
+    if (bytes >= 1'000'000)
+        return std::format("{:.1f} MB", value / 1e6);
+    if (bytes >= 1'000)
+        return std::format("{} KB", bytes / 1'000);
+    return std::format("{} B", bytes);
+}
+
+} // namespace mychat
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief What a block of accounted memory holds.
+enum class MemoryCategory : std::uint8_t
+{
+    ModelWeights, ///< LLM weights.
+    KvCache,      ///< The LLM's KV cache.
+    SpeechModels, ///< Whisper and piper models.
+    AudioBuffers, ///< Capture and playback buffers.
+    Caches,       ///< Memoized results that can be recomputed.
+    History,      ///< The conversation and its scrollback.
+};
+
+/// @brief Returns a display name for @p category, such as "KV cache".
+[[nodiscard]] auto memoryCategoryName(MemoryCategory category) noexcept -> std::string_view;
+
+/// @brief Frees at least the given number of bytes if it can, returning how many it freed.
+///
+/// It runs on the thread calling MemoryRegistry::enforceBudget() while the registry is locked,
+/// so it must not open or close accounts.
+using MemoryReclaimer = std::function<std::size_t(std::size_t bytes)>;
+
+/// @brief A snapshot of one account.
+struct MemoryUsage
+{
+    std::string name;
+    MemoryCategory category = MemoryCategory::Caches;
+    std::size_t bytes = 0;
+    bool reclaimable = false; ///< Whether the account can shrink when over budget.
+};
+
+class MemoryRegistry;
+
+/// @brief The memory one subsystem reports to a MemoryRegistry; closed when destroyed.
+///
+/// set() is a relaxed store, so it may be called from any thread and as often as the size changes.
+class MemoryAccount
+{
+  public:
+    MemoryAccount() = default;
+    MemoryAccount(MemoryAccount&& other) noexcept;
+    MemoryAccount& operator=(MemoryAccount&& other) noexcept;
+    MemoryAccount(MemoryAccount const&) = delete;
+    MemoryAccount& operator=(MemoryAccount const&) = delete;
+    ~MemoryAccount();
+
+    /// @brief Reports that the subsystem now holds @p bytes; ignored by a closed account.
+    void set(std::size_t bytes) noexcept;
+
+    /// @brief Returns the bytes last reported.
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t;
+
+    /// @brief Removes the account from its registry.
+    void close();
+
+  private:
+    friend class MemoryRegistry;
+    struct Entry;
+
+    MemoryAccount(MemoryRegistry& registry, std::shared_ptr<Entry> entry);
+
+    MemoryRegistry* _registry = nullptr;
+    std::shared_ptr<Entry> _entry;
+};
+
+/// @brief Tracks what the subsystems hold in memory and keeps the total within a budget.
+///
+/// Sizes are reported by the subsystems themselves, so they cover the large allocations (model
+/// weights, KV cache, buffers, caches) rather than every byte of the process.
+class MemoryRegistry
+{
+  public:
+    /// @brief Opens an account named @p name.
+    /// @param reclaimer Shrinks the account when over budget; empty if it cannot shrink.
+    [[nodiscard]] auto open(std::string name, MemoryCategory category, MemoryReclaimer reclaimer = {})
+        -> MemoryAccount;
+
+    /// @brief Returns the open accounts, largest first.
+    [[nodiscard]] auto usage() const -> std::vector<MemoryUsage>;
+
+    /// @brief Returns the bytes of all open accounts.
+    [[nodiscard]] auto totalBytes() const -> std::size_t;
+
+    /// @brief Sets the budget in bytes; 0 means there is none.
+    void setBudget(std::size_t bytes) noexcept { _budget.store(bytes, std::memory_order_relaxed); }
+
+    /// @brief Returns the budget in bytes, or 0 if there is none.
+    [[nodiscard]] auto budget() const noexcept -> std::size_t { return _budget.load(std::memory_order_relaxed); }
+
+    /// @brief Shrinks reclaimable accounts until the total is within the budget.
+    ///
+    /// Caches are shrunk before history, the largest of each first, as they are cheapest to
+    /// rebuild. Call it where shrinking the history is safe, e.g. between turns.
+    /// @return The bytes freed.
+    auto enforceBudget() -> std::size_t;
+
+  private:
+    friend class MemoryAccount;
+
+    mutable std::mutex _mutex;
+    std::vector<std::shared_ptr<MemoryAccount::Entry>> _entries;
+    std::atomic<std::size_t> _budget = 0;
+
+    void remove(MemoryAccount::Entry const* entry);
+};
+
+/// @brief Returns the process-wide registry the subsystems report to.
+[[nodiscard]] auto memoryRegistry() -> MemoryRegistry&;
+
+/// @brief Formats @p bytes for display, such as "512 KB" or "4.2 GB".
+[[nodiscard]] auto formatMemorySize(std::size_t bytes) -> std::string;
+
+} // namespace mychat
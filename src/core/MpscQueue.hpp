@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Bounded lock-free multi-producer/single-consumer queue.
+///
+/// Any number of threads may push, and exactly one thread may pop. Each slot carries a sequence
+/// number telling whether it is free, being written or ready, so producers claim slots with a
+/// single compare-exchange and never wait for each other or for the consumer. The capacity is
+/// rounded up to the next power of two.
+///
+/// The slots are allocated up front and reused: tryPushWith() and tryPopWith() work on a slot in
+/// place, so an element that owns storage, such as a string, keeps it from one use to the next.
+/// @tparam T Element type; must be default-constructible and move-assignable.
+template <typename T>
+class MpscQueue
+{
+  public:
+    /// @brief Constructs a queue holding at least @p capacity elements.
+    explicit MpscQueue(std::size_t capacity):
+        _slots(std::bit_ceil(capacity < 2 ? std::size_t { 2 } : capacity)), _mask(_slots.size() - 1)
+    {
+        for (auto i = std::size_t { 0 }; i < _slots.size(); ++i)
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    /// @brief Enqueues an element (any thread).
+    /// @return False if the queue is full; @p value is left untouched in that case.
+    [[nodiscard]] auto tryPush(T&& value) -> bool
+    {
+        return tryPushWith([&](T& slot) { slot = std::move(value); });
+    }
+
+    /// @brief Enqueues an element by calling @p fill with the slot to write it to (any thread).
+    ///
+    /// Never blocks or allocates by itself.
+    /// @return False if the queue is full, in which case @p fill is not called.
+    template <typename Fill>
+    [[nodiscard]] auto tryPushWith(Fill&& fill) -> bool
+    {
+        auto position = _tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& slot = _slots[position & _mask];
+            auto const sequence = slot.sequence.load(std::memory_order_acquire);
+            auto const lag = static_cast<std::intptr_t>(sequence - position);
+            if (lag == 0)
+            {
+                // Free for this lap; claim it unless another producer got there first.
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    fill(slot.value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+                return false; // Still holds the element from the previous lap.
+            else
+                position = _tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Dequeues an element (consumer side).
+    /// @return The oldest element, or std::nullopt if the queue is empty.
+    [[nodiscard]] auto tryPop() -> std::optional<T>
+    {
+        auto value = std::optional<T> {};
+        static_cast<void>(tryPopWith([&](T& slot) { value.emplace(std::move(slot)); }));
+        return value;
+    }
+
+    /// @brief Dequeues an element by calling @p visit with its slot (consumer side).
+    ///
+    /// The slot is handed back to producers once @p visit returns.
+    /// @return False if the queue is empty, in which case @p visit is not called.
+    template <typename Visit>
+    [[nodiscard]] auto tryPopWith(Visit&& visit) -> bool
+    {
+        auto& slot = _slots[_head & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _head + 1)
+            return false;
+        visit(slot.value);
+        slot.sequence.store(_head + _slots.size(), std::memory_order_release);
+        ++_head;
+        return true;
+    }
+
+    /// @brief Returns the number of elements the queue can hold.
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return _slots.size(); }
+
+  private:
+    static constexpr std::size_t CacheLineSize = 64;
+
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence; ///< Position it is free for; one more once written.
+        T value {};
+    };
+
+    std::vector<Slot> _slots;
+    std::size_t _mask;
+    alignas(CacheLineSize) std::atomic<std::size_t> _tail = 0; ///< Next position to push (shared).
+    alignas(CacheLineSize) std::size_t _head = 0;              ///< Next position to pop (consumer-owned).
+};
+
+} // namespace mychat
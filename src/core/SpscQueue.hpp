@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Bounded lock-free single-producer/single-consumer queue.
+///
+/// Exactly one thread may call tryPush() and exactly one (other) thread may call
+/// tryPop(). The capacity is rounded up to the next power of two.
+/// @tparam T Element type; must be default-constructible and move-assignable.
+template <typename T>
+class SpscQueue
+{
+  public:
+    /// @brief Constructs a queue holding at least @p capacity elements.
+    explicit SpscQueue(std::size_t capacity):
+        _slots(std::bit_ceil(capacity < 2 ? std::size_t { 2 } : capacity)), _mask(_slots.size() - 1)
+    {
+    }
+
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue& operator=(SpscQueue const&) = delete;
+
+    /// @brief Enqueues an element (producer side).
+    /// @return False if the queue is full; @p value is left untouched in that case.
+    [[nodiscard]] auto tryPush(T&& value) -> bool
+    {
+        auto const tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _slots.size())
+            return false;
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Dequeues an element (consumer side).
+    /// @return The oldest element, or std::nullopt if the queue is empty.
+    [[nodiscard]] auto tryPop() -> std::optional<T>
+    {
+        auto const head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return std::nullopt;
+        auto value = std::optional<T> { std::move(_slots[head & _mask]) };
+        _head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    /// @brief Enqueues as many elements of @p values as fit, copying them (producer side).
+    ///
+    /// Never blocks or allocates, so it is safe to call from a real-time thread.
+    /// @return The number of elements enqueued, from the front of @p values.
+    [[nodiscard]] auto tryPushSome(std::span<const T> values) -> std::size_t
+    {
+        auto const tail = _tail.load(std::memory_order_relaxed);
+        auto const room = _slots.size() - (tail - _head.load(std::memory_order_acquire));
+        auto const count = std::min(values.size(), room);
+        for (auto i = std::size_t { 0 }; i < count; ++i)
+            _slots[(tail + i) & _mask] = values[i];
+        _tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /// @brief Dequeues up to `values.size()` elements into @p values (consumer side).
+    /// @return The number of elements dequeued, written to the front of @p values.
+    [[nodiscard]] auto tryPopSome(std::span<T> values) -> std::size_t
+    {
+        auto const head = _head.load(std::memory_order_relaxed);
+        auto const available = _tail.load(std::memory_order_acquire) - head;
+        auto const count = std::min(values.size(), available);
+        for (auto i = std::size_t { 0 }; i < count; ++i)
+            values[i] = std::move(_slots[(head + i) & _mask]);
+        _head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /// @brief Returns true if the queue is empty (approximate when called concurrently).
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    /// @brief Returns the number of elements the queue can hold.
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return _slots.size(); }
+
+  private:
+    static constexpr std::size_t CacheLineSize = 64;
+
+    std::vector<T> _slots;
+    std::size_t _mask;
+    alignas(CacheLineSize) std::atomic<std::size_t> _head = 0; ///< Next slot to pop (consumer-owned).
+    alignas(CacheLineSize) std::atomic<std::size_t> _tail = 0; ///< Next slot to push (producer-owned).
+};
+
+} // namespace mychat
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace mychat::trace
+{
+
+namespace detail
+{
+    std::atomic<bool> recording = false;
+} // namespace detail
+
+namespace
+{
+    /// @brief Zones a thread records per trace before dropping them; 2 MiB of events.
+    constexpr auto ThreadBufferCapacity = std::size_t { 32768 };
+
+    /// @brief Bytes of a zone's detail that are kept.
+    constexpr auto DetailCapacity = std::size_t { 31 };
+
+    /// @brief A recorded zone, copied as is into the thread's buffer.
+    struct Event
+    {
+        char const* category = nullptr;
+        char const* name = nullptr;
+        Clock::time_point begin;
+        Clock::time_point end;
+        std::array<char, DetailCapacity> detail {};
+        std::uint8_t detailSize = 0;
+    };
+
+    /// @brief The zones of one thread. Only that thread writes them; stop() reads what it published.
+    struct ThreadBuffer
+    {
+        std::uint32_t thread = 0; ///< Numbered in the order threads record their first zone.
+        std::unique_ptr<Event[]> events = std::make_unique<Event[]>(ThreadBufferCapacity);
+        std::atomic<std::size_t> size = 0;
+        std::atomic<std::uint64_t> dropped = 0;
+    };
+
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; ///< Never shrinks, so threads keep their buffer.
+    std::FILE* traceFile = nullptr;
+    std::filesystem::path tracePath;
+    Clock::time_point traceStart;
+
+    /// @brief Returns the calling thread's buffer, registering it on the first call.
+    auto threadBuffer() -> ThreadBuffer&
+    {
+        thread_local auto* const buffer = [] {
+            auto const lock = std::lock_guard(buffersMutex);
+            auto& added = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+            added->thread = static_cast<std::uint32_t>(buffers.size());
+            return added.get();
+        }();
+        return *buffer;
+    }
+
+    /// @brief Microseconds from the start of the trace, the unit of the trace event format.
+    auto microseconds(Clock::duration duration) -> double
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    /// @brief Writes the zone @p event of @p thread as a complete ("X") event.
+    void writeEvent(std::FILE* file, Event const& event, std::uint32_t thread)
+    {
+        std::print(file,
+                   "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,"
+                   "\"tid\":{}",
+                   event.name,
+                   event.category,
+                   microseconds(event.begin - traceStart),
+                   microseconds(event.end - event.begin),
+                   thread);
+        if (event.detailSize > 0)
+        {
+            // The detail may have been cut within a UTF-8 sequence.
+            auto const detail = nlohmann::json(std::string(event.detail.data(), event.detailSize))
+                                    .dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+            std::print(file, ",\"args\":{{\"detail\":{}}}", detail);
+        }
+        std::print(file, "}}");
+    }
+} // namespace
+
+void detail::record(char const* category,
+                    char const* name,
+                    std::string_view detail,
+                    Clock::time_point begin,
+                    Clock::time_point end) noexcept
+{
+    auto& buffer = threadBuffer();
+    auto const index = buffer.size.load(std::memory_order_relaxed);
+    if (index >= ThreadBufferCapacity)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& event = buffer.events[index];
+    event.category = category;
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    event.detailSize = static_cast<std::uint8_t>(std::min(detail.size(), DetailCapacity));
+    std::copy_n(detail.data(), event.detailSize, event.detail.data());
+    buffer.size.store(index + 1, std::memory_order_release);
+}
+
+auto start(std::filesystem::path path) -> VoidResult
+{
+    if constexpr (!CompiledIn)
+        return makeError(ErrorCode::ConfigError, "Tracing is not compiled in (MYCHAT_TRACING is off)");
+
+    if (auto stopped = stop(); !stopped)
+        return stopped;
+
+    auto* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr)
+        return makeError(ErrorCode::IoError, std::format("Cannot create trace file {}", path.string()));
+
+    {
+        auto const lock = std::lock_guard(buffersMutex);
+        for (auto const& buffer: buffers)
+        {
+            buffer->size.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+    traceFile = file;
+    tracePath = std::move(path);
+    traceStart = Clock::now();
+    detail::recording.store(true, std::memory_order_release);
+    return {};
+}
+
+auto stop() -> VoidResult
+{
+    if (traceFile == nullptr)
+        return {};
+    detail::recording.store(false, std::memory_order_release);
+    auto* const file = std::exchange(traceFile, nullptr);
+
+    auto dropped = std::uint64_t { 0 };
+    auto separator = "";
+    std::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    {
+        auto const lock = std::lock_guard(buffersMutex);
+        for (auto const& buffer: buffers)
+        {
+            // Zones still closing on other threads are written past this size, so they are left out.
+            auto const size = buffer->size.load(std::memory_order_acquire);
+            for (auto i = std::size_t { 0 }; i < size; ++i)
+            {
+                std::print(file, "{}\n", separator);
+                separator = ",";
+                writeEvent(file, buffer->events[i], buffer->thread);
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+    }
+    std::print(file, "\n],\"otherData\":{{\"droppedZones\":{}}}}}\n", dropped);
+
+    auto const failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || failed)
+        return makeError(ErrorCode::IoError,
+                         std::format("Failed to write trace file {}", tracePath.string()));
+    return {};
+}
+
+} // namespace mychat::trace
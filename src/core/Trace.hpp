@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+/// @brief Whether the trace zones are compiled in (1) or compile to nothing (0).
+#ifndef MYCHAT_TRACING
+    #define MYCHAT_TRACING 1
+#endif
+
+namespace mychat::trace
+{
+
+/// @brief Whether tracing is compiled in; see MYCHAT_TRACING.
+constexpr auto CompiledIn = MYCHAT_TRACING != 0;
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Starts recording zones, to be written to @p path in the Chrome trace event format.
+///
+/// The file opens in Perfetto (ui.perfetto.dev) and chrome://tracing. Each thread records into a
+/// buffer of its own without locking, so recording a zone costs two clock reads and a copy; a
+/// thread whose buffer is full drops its zones, and the file notes how many. The buffers are
+/// allocated on a thread's first zone and kept for later traces.
+///
+/// Like log::openFileSink(), call this and stop() while no other thread records zones.
+/// @return An IoError if the file cannot be created, or a ConfigError if tracing is not compiled in.
+[[nodiscard]] auto start(std::filesystem::path path) -> VoidResult;
+
+/// @brief Stops recording and writes the zones recorded since start() to its file.
+/// @return An IoError if the file cannot be written; success, doing nothing, if not started.
+[[nodiscard]] auto stop() -> VoidResult;
+
+namespace detail
+{
+    /// @brief Set while a trace is recorded.
+    extern std::atomic<bool> recording;
+
+    /// @brief Records a zone of the calling thread; @p detail is cut to what fits the event.
+    void record(char const* category,
+                char const* name,
+                std::string_view detail,
+                Clock::time_point begin,
+                Clock::time_point end) noexcept;
+} // namespace detail
+
+/// @brief Returns whether zones are recorded right now.
+[[nodiscard]] inline auto enabled() noexcept -> bool
+{
+    if constexpr (CompiledIn)
+        return detail::recording.load(std::memory_order_relaxed);
+    else
+        return false;
+}
+
+/// @brief Records a zone that was measured by the caller, from @p begin to @p end.
+///
+/// @p category and @p name must outlive the trace, like string literals do; @p detail is copied,
+/// so it may name what the zone worked on, such as a request's method.
+inline void recordZone(char const* category,
+                       char const* name,
+                       Clock::time_point begin,
+                       Clock::time_point end,
+                       std::string_view detail = {}) noexcept
+{
+    if constexpr (CompiledIn)
+        if (enabled())
+            detail::record(category, name, detail, begin, end);
+}
+
+/// @brief Records the lifetime of a scope as a zone of the calling thread.
+///
+/// Zones nest: a zone opened while another one of the same thread is open shows up beneath it.
+/// Without a trace being recorded a zone costs a relaxed load, and with MYCHAT_TRACING off nothing.
+class Zone
+{
+  public:
+    /// @brief Opens the zone @p name of @p category, which must outlive the trace (string literals do).
+    /// @param detail Copied into the zone, e.g. to name what it worked on.
+    Zone(char const* category, char const* name, std::string_view detail = {}) noexcept
+    {
+        if constexpr (CompiledIn)
+        {
+            if (!enabled())
+                return;
+            _category = category;
+            _name = name;
+            _detail = detail;
+            _begin = Clock::now();
+        }
+    }
+
+    ~Zone()
+    {
+        if constexpr (CompiledIn)
+            if (_name)
+                detail::record(_category, _name, _detail, _begin, Clock::now());
+    }
+
+    Zone(Zone const&) = delete;
+    Zone& operator=(Zone const&) = delete;
+
+  private:
+    char const* _category = nullptr;
+    char const* _name = nullptr; ///< Null unless the zone is recorded.
+    std::string_view _detail;
+    Clock::time_point _begin;
+};
+
+} // namespace mychat::trace
@@ -3,6 +3,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -55,12 +57,26 @@ struct ToolCall
     nlohmann::json arguments;
 };
 
+/// @brief A binary content item of a tool result, such as an image.
+///
+/// The bytes are decoded once and shared, so copying a result (e.g. into the result cache)
+/// does not copy them. They never enter the prompt; the result's text only mentions them.
+struct ToolContentBlob
+{
+    std::string mimeType; ///< E.g. "image/png".
+    std::string uri;      ///< The resource URI, for embedded resources.
+    std::shared_ptr<const std::vector<std::uint8_t>> data;
+
+    [[nodiscard]] auto isImage() const noexcept -> bool { return mimeType.starts_with("image/"); }
+};
+
 /// @brief Represents the result of executing a tool call.
 struct ToolResult
 {
     std::string callId;
-    std::string content;
+    std::string content; ///< The text given to the model.
     bool isError = false;
+    std::vector<ToolContentBlob> blobs {}; ///< Binary content items, in order of appearance.
 };
 
 /// @brief Schema for an input parameter in a tool definition.
@@ -89,11 +105,55 @@ struct ChatMessage
     std::string toolCallId; // For Role::Tool messages
 };
 
+/// @brief What to do when a conversation outgrows the model's context window.
+enum class ContextOverflowPolicy : std::uint8_t
+{
+    EvictHistory, ///< Drop the oldest turns (after the system prompt) and re-decode the rest.
+    ShiftKv,      ///< Discard old tokens from the KV cache and shift the remainder down in place.
+};
+
+/// @brief Timing and token counts of one or more LLM generations.
+struct GenerateMetrics
+{
+    int promptTokens = 0;            ///< Tokens in the prompt.
+    int reusedTokens = 0;            ///< Prompt tokens served from the KV cache instead of decoded.
+    int generatedTokens = 0;         ///< Tokens sampled from the model.
+    double prefillMs = 0.0;          ///< Time spent decoding the prompt.
+    double timeToFirstTokenMs = 0.0; ///< Time from the start of generation to the first sampled token.
+    double decodeMs = 0.0;           ///< Time spent generating after the first token.
+    int toolPreambleTokens = 0;      ///< Prompt tokens taken up by the tool definitions.
+
+    /// @brief Returns the decode throughput in tokens per second (0 if nothing was decoded).
+    [[nodiscard]] auto decodeTokensPerSecond() const -> double
+    {
+        return decodeMs > 0.0 ? generatedTokens * 1000.0 / decodeMs : 0.0;
+    }
+
+    /// @brief Returns the number of prompt and generated tokens.
+    [[nodiscard]] auto totalTokens() const -> int { return promptTokens + generatedTokens; }
+
+    /// @brief Accumulates another generation; the time to first token of the first one is kept.
+    auto operator+=(const GenerateMetrics& other) -> GenerateMetrics&
+    {
+        if (promptTokens == 0 && generatedTokens == 0)
+            timeToFirstTokenMs = other.timeToFirstTokenMs;
+        promptTokens += other.promptTokens;
+        reusedTokens += other.reusedTokens;
+        generatedTokens += other.generatedTokens;
+        prefillMs += other.prefillMs;
+        decodeMs += other.decodeMs;
+        toolPreambleTokens = other.toolPreambleTokens;
+        return *this;
+    }
+};
+
 /// @brief The result of an LLM generation — either text or tool calls.
 struct GenerateResult
 {
     std::string text;
     std::vector<ToolCall> toolCalls;
+    bool cancelled = false; ///< Generation was stopped early via its stop token.
+    GenerateMetrics metrics;
 
     /// @brief Returns true if this result contains tool calls.
     [[nodiscard]] auto hasToolCalls() const -> bool { return !toolCalls.empty(); }
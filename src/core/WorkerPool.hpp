@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Fixed-size pool of worker threads executing tasks in submission order.
+///
+/// At most size() tasks run at the same time; further tasks wait in a FIFO queue.
+/// Destroying the pool finishes all queued tasks before joining the workers.
+class WorkerPool
+{
+  public:
+    /// @brief Starts @p threads workers (at least one).
+    explicit WorkerPool(std::size_t threads)
+    {
+        threads = std::max(threads, std::size_t { 1 });
+        _workers.reserve(threads);
+        for (auto i = std::size_t { 0 }; i < threads; ++i)
+            _workers.emplace_back([this] { run(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _stopping = true;
+        }
+        _wakeup.notify_all();
+    }
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    /// @brief Queues @p task for execution on a worker.
+    /// @return A future receiving the task's result (or exception).
+    template <typename F>
+    [[nodiscard]] auto submit(F task) -> std::future<std::invoke_result_t<F&>>
+    {
+        auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F&>()>>(std::move(task));
+        auto future = packaged->get_future();
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _queue.emplace_back([packaged] { (*packaged)(); });
+        }
+        _wakeup.notify_one();
+        return future;
+    }
+
+    /// @brief Returns the number of worker threads.
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return _workers.size(); }
+
+  private:
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::deque<std::function<void()>> _queue;
+    bool _stopping = false;
+    std::vector<std::jthread> _workers; ///< Declared last so workers are joined before the queue dies.
+
+    void run()
+    {
+        while (true)
+        {
+            auto task = std::function<void()> {};
+            {
+                auto lock = std::unique_lock(_mutex);
+                _wakeup.wait(lock, [this] { return _stopping || !_queue.empty(); });
+                if (_queue.empty())
+                    return;
+                task = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+} // namespace mychat
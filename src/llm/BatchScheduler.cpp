@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "BatchScheduler.hpp"
+
+#include <algorithm>
+#include <format>
+#include <ranges>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// @brief Returns whether @p tokens form a prompt chunk, which may be split across steps.
+    auto isPrefill(std::span<const BatchToken> tokens) -> bool
+    {
+        return tokens.size() > 1
+               && std::ranges::none_of(tokens.first(tokens.size() - 1), &BatchToken::logits);
+    }
+
+    auto decodeError(int status) -> std::unexpected<Error>
+    {
+        return makeError(ErrorCode::InferenceError,
+                         std::format("llama_decode failed with status {}", status));
+    }
+
+} // namespace
+
+BatchLease::BatchLease(BatchLease&& other) noexcept:
+    _scheduler(std::exchange(other._scheduler, nullptr)),
+    _offset(other._offset),
+    _skipped(other._skipped),
+    _size(other._size)
+{
+}
+
+BatchLease& BatchLease::operator=(BatchLease&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        _scheduler = std::exchange(other._scheduler, nullptr);
+        _offset = other._offset;
+        _skipped = other._skipped;
+        _size = other._size;
+    }
+    return *this;
+}
+
+void BatchLease::release(bool resubmitting)
+{
+    if (auto* scheduler = std::exchange(_scheduler, nullptr))
+        scheduler->releaseLease(resubmitting);
+}
+
+BatchScheduler::BatchScheduler(DecodeFn decode, size_t maxBatchTokens, size_t sequences):
+    _decode(std::move(decode)),
+    _maxBatchTokens(std::max(maxBatchTokens, size_t { 1 })),
+    _threaded(sequences > 1)
+{
+    if (_threaded)
+        _thread = std::jthread([this](std::stop_token stopToken) { run(std::move(stopToken)); });
+}
+
+BatchScheduler::~BatchScheduler() = default;
+
+auto BatchScheduler::decode(std::span<const BatchToken> tokens, std::stop_token stopToken)
+    -> Result<BatchLease>
+{
+    if (tokens.empty())
+        return BatchLease {};
+    auto const prefill = isPrefill(tokens);
+    if (!prefill && tokens.size() > _maxBatchTokens)
+        return makeError(ErrorCode::InvalidArgument,
+                         std::format("{} tokens with logits exceed the batch size {}",
+                                     tokens.size(),
+                                     _maxBatchTokens));
+    if (!_threaded)
+        return decodeInline(tokens, stopToken);
+
+    auto submission = Submission { .tokens = tokens, .stopToken = std::move(stopToken), .prefill = prefill };
+    auto lock = std::unique_lock(_mutex);
+    if (_announced > 0)
+        --_announced;
+    _pending.push_back(&submission);
+    _changed.notify_all();
+    _changed.wait(lock, [&] { return submission.done; });
+
+    if (submission.cancelled)
+        return makeError(ErrorCode::InferenceError, "Decoding stopped");
+    if (submission.status != 0)
+        return decodeError(submission.status);
+
+    auto lease = BatchLease {};
+    lease._scheduler = this;
+    lease._offset = submission.offset;
+    lease._skipped = tokens.size() - submission.taken;
+    lease._size = tokens.size();
+    return lease;
+}
+
+auto BatchScheduler::decodeInline(std::span<const BatchToken> tokens, std::stop_token const& stopToken)
+    -> Result<BatchLease>
+{
+    auto lease = BatchLease {};
+    lease._size = tokens.size();
+    for (auto offset = size_t { 0 }; offset < tokens.size(); offset += _maxBatchTokens)
+    {
+        if (stopToken.stop_requested())
+            return makeError(ErrorCode::InferenceError, "Decoding stopped");
+        auto const chunk = tokens.subspan(offset, std::min(_maxBatchTokens, tokens.size() - offset));
+        auto status = 0;
+        {
+            auto const context = std::lock_guard(_contextMutex);
+            status = _decode(chunk);
+        }
+        {
+            auto const lock = std::lock_guard(_mutex);
+            ++_steps;
+            _decodedTokens += chunk.size();
+        }
+        if (status != 0)
+            return decodeError(status);
+        lease._skipped = offset;
+    }
+    return lease;
+}
+
+auto BatchScheduler::lock() -> std::unique_lock<std::mutex>
+{
+    return std::unique_lock(_contextMutex);
+}
+
+auto BatchScheduler::steps() const -> size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _steps;
+}
+
+auto BatchScheduler::decodedTokens() const -> size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    return _decodedTokens;
+}
+
+void BatchScheduler::releaseLease(bool resubmitting)
+{
+    {
+        auto const lock = std::lock_guard(_mutex);
+        --_leases;
+        if (resubmitting)
+            ++_announced;
+    }
+    _changed.notify_all();
+}
+
+void BatchScheduler::run(std::stop_token stopToken)
+{
+    auto lock = std::unique_lock(_mutex);
+    while (true)
+    {
+        if (!_changed.wait(lock, stopToken, [this] { return _leases == 0 && !_pending.empty(); }))
+            return;
+        if (_announced > 0)
+        {
+            // The sequences of the previous step are about to submit their next tokens.
+            _changed.wait_for(lock, stopToken, GatherTimeout, [this] { return _announced == 0; });
+            _announced = 0;
+        }
+
+        for (auto* submission: _pending)
+        {
+            if (!submission->stopToken.stop_requested())
+                continue;
+            submission->cancelled = true;
+            submission->done = true;
+        }
+        std::erase_if(_pending, [](Submission const* submission) { return submission->done; });
+        _changed.notify_all();
+        if (_pending.empty())
+            continue;
+
+        collectStep();
+        lock.unlock();
+        auto status = 0;
+        {
+            auto const context = std::lock_guard(_contextMutex);
+            status = _decode(_step);
+        }
+        lock.lock();
+
+        ++_steps;
+        _decodedTokens += _step.size();
+        for (auto* submission: _running)
+        {
+            submission->decoded += submission->taken;
+            if (status != 0)
+                submission->status = status;
+            else if (submission->decoded < submission->tokens.size())
+                continue;
+            else
+                ++_leases;
+            submission->done = true;
+        }
+        std::erase_if(_pending, [](Submission const* submission) { return submission->done; });
+        _changed.notify_all();
+    }
+}
+
+void BatchScheduler::collectStep()
+{
+    _step.clear();
+    _running.clear();
+    auto const take = [this](Submission& submission, size_t count) {
+        auto const tokens = submission.tokens.subspan(submission.decoded, count);
+        submission.offset = static_cast<std::int32_t>(_step.size());
+        submission.taken = count;
+        _step.insert(_step.end(), tokens.begin(), tokens.end());
+        _running.push_back(&submission);
+    };
+
+    // Generated tokens and verification batches first, so prompts never hold up generation.
+    for (auto* submission: _pending | std::views::filter([](auto const* s) { return !s->prefill; }))
+        if (submission->tokens.size() <= _maxBatchTokens - _step.size())
+            take(*submission, submission->tokens.size());
+
+    // Prompt chunks fill the rest of the step, in the order they arrived.
+    for (auto* submission: _pending | std::views::filter([](auto const* s) { return s->prefill; }))
+    {
+        auto const budget = _maxBatchTokens - _step.size();
+        if (budget == 0)
+            break;
+        take(*submission, std::min(budget, submission->tokens.size() - submission->decoded));
+    }
+}
+
+} // namespace mychat
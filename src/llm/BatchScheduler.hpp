@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief One token of a decode step, i.e. one entry of a llama_batch.
+struct BatchToken
+{
+    std::int32_t token = 0;    ///< Token id (llama_token).
+    std::int32_t position = 0; ///< Position within its sequence.
+    std::int32_t sequence = 0; ///< Sequence of the KV cache the token is decoded into.
+    bool logits = false;       ///< Whether the step computes logits for the token.
+};
+
+class BatchScheduler;
+
+/// @brief Access to the logits of the step that finished a BatchScheduler::decode().
+///
+/// No further step starts while a lease is held, so the logits stay valid until it is released;
+/// release it as soon as the tokens are sampled. A default-constructed lease holds nothing.
+class BatchLease
+{
+  public:
+    BatchLease() = default;
+    ~BatchLease() { release(); }
+
+    BatchLease(BatchLease&& other) noexcept;
+    BatchLease& operator=(BatchLease&& other) noexcept;
+    BatchLease(const BatchLease&) = delete;
+    BatchLease& operator=(const BatchLease&) = delete;
+
+    /// @brief Returns the batch index of the logits of the submission's token @p index, as taken
+    ///        by llama_get_logits_ith() and llama_sampler_sample().
+    ///
+    /// Only tokens decoded in the submission's last step have logits.
+    [[nodiscard]] auto outputIndex(size_t index) const noexcept -> std::int32_t
+    {
+        return _offset + static_cast<std::int32_t>(index - _skipped);
+    }
+
+    /// @brief Returns the batch index of the logits of the submission's last token.
+    [[nodiscard]] auto lastOutputIndex() const noexcept -> std::int32_t { return outputIndex(_size - 1); }
+
+    /// @brief Gives the logits up, so the next step may start.
+    /// @param resubmitting Announces that the holder submits more tokens right away; the next step
+    ///                     waits for them briefly (see BatchScheduler::GatherTimeout).
+    void release(bool resubmitting = false);
+
+  private:
+    friend class BatchScheduler;
+
+    BatchScheduler* _scheduler = nullptr; ///< Null for leases that need no release.
+    std::int32_t _offset = 0;             ///< Batch index of the first token of the last step.
+    size_t _skipped = 0;                  ///< Tokens of the submission decoded in earlier steps.
+    size_t _size = 0;                     ///< Tokens of the submission.
+};
+
+/// @brief Decodes the tokens of several sequences of one llama context in shared steps.
+///
+/// Each sequence submits its tokens from its own thread with decode(). A scheduler thread
+/// collects everything submitted into one batch per step, so the model weights are streamed
+/// once for all sequences rather than once per sequence: generated tokens and verification
+/// batches go first, whole, and prompt chunks fill the rest of the step, split across steps
+/// where needed. After a step, its participants sample from their part of the logits while
+/// holding a BatchLease; the next step starts once every lease is released.
+///
+/// With a single sequence there is nothing to batch, and decode() runs the steps on the calling
+/// thread without a scheduler thread.
+class BatchScheduler
+{
+  public:
+    /// @brief Decodes one step; returns the status of llama_decode() (0 on success).
+    using DecodeFn = std::function<int(std::span<const BatchToken> batch)>;
+
+    /// The longest the next step waits for tokens announced by BatchLease::release(). Sampling
+    /// and streaming a token take far less than a step, so waiting keeps sequences in lockstep.
+    static constexpr auto GatherTimeout = std::chrono::milliseconds { 2 };
+
+    /// @param decode Decodes the steps; always called under lock().
+    /// @param maxBatchTokens Maximum number of tokens per step (the context's n_batch).
+    /// @param sequences Number of sequences that submit concurrently.
+    BatchScheduler(DecodeFn decode, size_t maxBatchTokens, size_t sequences);
+    ~BatchScheduler();
+
+    BatchScheduler(const BatchScheduler&) = delete;
+    BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+    /// @brief Decodes @p tokens together with the tokens of the other sequences.
+    ///
+    /// Blocks until all tokens are decoded. Prompt chunks (more than one token, and only the
+    /// last with logits) may be split across steps; other submissions are decoded in one step
+    /// and must not exceed the step size.
+    /// @param tokens The tokens, which stay referenced until this returns.
+    /// @param stopToken Checked between steps; a stop request drops the tokens not yet decoded.
+    /// @return The lease on the logits, or an error if decoding failed or was stopped. Tokens
+    ///         decoded before a failure stay in the KV cache.
+    [[nodiscard]] auto decode(std::span<const BatchToken> tokens, std::stop_token stopToken = {})
+        -> Result<BatchLease>;
+
+    /// @brief Locks the context against decode steps, for changing the KV cache of a sequence.
+    [[nodiscard]] auto lock() -> std::unique_lock<std::mutex>;
+
+    /// @brief Returns the number of steps decoded so far.
+    [[nodiscard]] auto steps() const -> size_t;
+
+    /// @brief Returns the number of tokens decoded so far, in all steps.
+    [[nodiscard]] auto decodedTokens() const -> size_t;
+
+  private:
+    friend class BatchLease;
+
+    /// @brief A decode() call waiting for its tokens, living on the caller's stack.
+    struct Submission
+    {
+        std::span<const BatchToken> tokens;
+        std::stop_token stopToken;
+        bool prefill = false; ///< May be split across steps.
+        size_t decoded = 0;   ///< Tokens decoded in finished steps.
+        size_t taken = 0;     ///< Tokens in the running step.
+        std::int32_t offset = 0;
+        int status = 0;
+        bool cancelled = false;
+        bool done = false;
+    };
+
+    auto decodeInline(std::span<const BatchToken> tokens, std::stop_token const& stopToken)
+        -> Result<BatchLease>;
+    void run(std::stop_token stopToken);
+    void collectStep();
+    void releaseLease(bool resubmitting);
+
+    DecodeFn _decode;
+    size_t _maxBatchTokens;
+    bool _threaded;
+
+    std::mutex _contextMutex; ///< Held while a step decodes and by lock().
+
+    mutable std::mutex _mutex;
+    std::condition_variable_any _changed;
+    std::deque<Submission*> _pending;
+    std::vector<Submission*> _running; ///< Submissions with tokens in _step.
+    std::vector<BatchToken> _step;
+    size_t _leases = 0;
+    size_t _announced = 0; ///< Submissions announced by released leases and not yet made.
+    size_t _steps = 0;
+    size_t _decodedTokens = 0;
+
+    std::jthread _thread; ///< Declared last so it is stopped before the members it uses go.
+};
+
+} // namespace mychat
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "ChatSession.hpp"
 
+#include <algorithm>
+#include <ranges>
+
 #include <utility>
 
 namespace mychat
@@ -13,7 +16,7 @@ ChatSession::ChatSession(std::string systemPrompt): _systemPrompt(std::move(syst
 
 void ChatSession::addUserMessage(std::string content)
 {
-    _messages.push_back(ChatMessage {
+    append(ChatMessage {
         .role = Role::User,
         .content = std::move(content),
         .toolCalls = {},
@@ -23,7 +26,7 @@ void ChatSession::addUserMessage(std::string content)
 
 void ChatSession::addAssistantMessage(std::string content, std::vector<ToolCall> toolCalls)
 {
-    _messages.push_back(ChatMessage {
+    append(ChatMessage {
         .role = Role::Assistant,
         .content = std::move(content),
         .toolCalls = std::move(toolCalls),
@@ -33,7 +36,7 @@ void ChatSession::addAssistantMessage(std::string content, std::vector<ToolCall>
 
 void ChatSession::addToolResult(std::string callId, std::string content, bool isError)
 {
-    _messages.push_back(ChatMessage {
+    append(ChatMessage {
         .role = Role::Tool,
         .content = std::move(content),
         .toolCalls = {},
@@ -47,10 +50,21 @@ auto ChatSession::messages() const -> const std::vector<ChatMessage>&
     return _messages;
 }
 
+void ChatSession::setMessageContent(size_t index, std::string content)
+{
+    _messages.at(index).content = std::move(content);
+    if (auto& count = _tokenCounts[index]; count != Uncounted)
+    {
+        _countedTokens -= count;
+        count = Uncounted;
+        ++_uncounted;
+    }
+}
+
 void ChatSession::clear()
 {
-    _messages.clear();
-    ensureSystemPrompt();
+    // Keeps the system prompt, which also keeps its token count.
+    erase(_systemPrompt.empty() ? 0 : 1, _messages.size());
 }
 
 auto ChatSession::messageCount() const -> size_t
@@ -60,6 +74,48 @@ auto ChatSession::messageCount() const -> size_t
     return _messages.empty() ? 0 : _messages.size() - 1;
 }
 
+auto ChatSession::memoryBytes() const -> size_t
+{
+    auto bytes = _systemPrompt.capacity() + _messages.capacity() * sizeof(ChatMessage)
+                 + _tokenCounts.capacity() * sizeof(size_t);
+    for (auto const& msg: _messages)
+    {
+        bytes += msg.content.capacity() + msg.toolCallId.capacity();
+        for (auto const& call: msg.toolCalls)
+            bytes +=
+                sizeof(ToolCall) + call.id.capacity() + call.name.capacity() + call.arguments.dump().size();
+    }
+    return bytes;
+}
+
+void ChatSession::setTokenCounts(std::span<const size_t> counts)
+{
+    for (auto i = size_t { 0 }; i < std::min(counts.size(), _tokenCounts.size()); ++i)
+    {
+        auto& entry = _tokenCounts[i];
+        if (entry == Uncounted)
+            --_uncounted;
+        else
+            _countedTokens -= entry;
+        entry = counts[i];
+        _countedTokens += entry;
+    }
+}
+
+void ChatSession::clearTokenCounts() noexcept
+{
+    std::ranges::fill(_tokenCounts, Uncounted);
+    _countedTokens = 0;
+    _uncounted = _tokenCounts.size();
+}
+
+auto ChatSession::tokenCount() const noexcept -> std::optional<size_t>
+{
+    if (_uncounted > 0)
+        return std::nullopt;
+    return _countedTokens;
+}
+
 auto ChatSession::systemPrompt() const -> const std::string&
 {
     return _systemPrompt;
@@ -68,22 +124,94 @@ auto ChatSession::systemPrompt() const -> const std::string&
 void ChatSession::setSystemPrompt(std::string prompt)
 {
     _systemPrompt = std::move(prompt);
-    _messages.clear();
+    erase(0, _messages.size());
+    _stateSnapshot.clear();
     ensureSystemPrompt();
 }
 
+auto ChatSession::evictOldestTurn() -> bool
+{
+    auto const isUser = [](const ChatMessage& msg) { return msg.role == Role::User; };
+    auto const first = std::ranges::find_if(_messages, isUser);
+    if (first == _messages.end())
+        return false;
+    auto const next = std::find_if(std::next(first), _messages.end(), isUser);
+    if (next == _messages.end())
+        return false;
+
+    erase(static_cast<size_t>(first - _messages.begin()), static_cast<size_t>(next - _messages.begin()));
+    return true;
+}
+
+auto ChatSession::fork(size_t messageCount) const -> ChatSession
+{
+    auto branch = *this;
+    branch.truncate(messageCount);
+    return branch;
+}
+
+void ChatSession::truncate(size_t messageCount)
+{
+    auto const keep = std::min(messageCount, this->messageCount()) + (_systemPrompt.empty() ? 0 : 1);
+    erase(std::min(keep, _messages.size()), _messages.size());
+}
+
+auto ChatSession::popLastTurn() -> std::optional<std::string>
+{
+    auto const isUser = [](const ChatMessage& msg) { return msg.role == Role::User; };
+    auto const last = std::ranges::find_if(_messages | std::views::reverse, isUser);
+    if (last == _messages.rend())
+        return std::nullopt;
+
+    auto content = std::move(last->content);
+    erase(static_cast<size_t>(std::prev(last.base()) - _messages.begin()), _messages.size());
+    return content;
+}
+
+void ChatSession::setStateSnapshot(std::filesystem::path path)
+{
+    _stateSnapshot = std::move(path);
+}
+
+auto ChatSession::stateSnapshot() const -> const std::filesystem::path&
+{
+    return _stateSnapshot;
+}
+
 void ChatSession::ensureSystemPrompt()
 {
+    // Only called on an empty history, so the system prompt becomes the first message.
     if (!_systemPrompt.empty())
     {
-        _messages.insert(_messages.begin(),
-                         ChatMessage {
-                             .role = Role::System,
-                             .content = _systemPrompt,
-                             .toolCalls = {},
-                             .toolCallId = {},
-                         });
+        append(ChatMessage {
+            .role = Role::System,
+            .content = _systemPrompt,
+            .toolCalls = {},
+            .toolCallId = {},
+        });
+    }
+}
+
+void ChatSession::append(ChatMessage message)
+{
+    _messages.push_back(std::move(message));
+    _tokenCounts.push_back(Uncounted);
+    ++_uncounted;
+}
+
+void ChatSession::erase(size_t first, size_t last)
+{
+    for (auto const count: std::span(_tokenCounts).subspan(first, last - first))
+    {
+        if (count == Uncounted)
+            --_uncounted;
+        else
+            _countedTokens -= count;
     }
+    _tokenCounts.erase(_tokenCounts.begin() + static_cast<std::ptrdiff_t>(first),
+                       _tokenCounts.begin() + static_cast<std::ptrdiff_t>(last));
+    _messages.erase(_messages.begin() + static_cast<std::ptrdiff_t>(first),
+                    _messages.begin() + static_cast<std::ptrdiff_t>(last));
 }
 
 } // namespace mychat
@@ -3,6 +3,10 @@
 
 #include <core/Types.hpp>
 
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -35,12 +39,32 @@ class ChatSession
     /// @brief Returns all messages in the conversation, including the system prompt.
     [[nodiscard]] auto messages() const -> const std::vector<ChatMessage>&;
 
+    /// @brief Replaces the content of a message, e.g. to compact an old tool result.
+    /// @param index The message's index in messages().
+    void setMessageContent(size_t index, std::string content);
+
     /// @brief Clears all messages except the system prompt.
     void clear();
 
     /// @brief Returns the number of messages (excluding system prompt).
     [[nodiscard]] auto messageCount() const -> size_t;
 
+    /// @brief Returns the approximate bytes held by the messages, including the system prompt.
+    [[nodiscard]] auto memoryBytes() const -> size_t;
+
+    /// @brief Records the prompt tokens each of the first `counts.size()` messages take up.
+    ///
+    /// The counts, e.g. InferenceEngine::messageTokenCounts(), cover the system prompt as well,
+    /// and stay with their messages as turns are evicted, so tokenCount() needs no tokenizer.
+    void setTokenCounts(std::span<const size_t> counts);
+
+    /// @brief Forgets all recorded token counts, e.g. when a model with another tokenizer takes over.
+    void clearTokenCounts() noexcept;
+
+    /// @brief Returns the prompt tokens of all messages, the system prompt included.
+    /// @return The sum of the recorded counts, or nothing if a message has not been counted yet.
+    [[nodiscard]] auto tokenCount() const noexcept -> std::optional<size_t>;
+
     /// @brief Returns the system prompt.
     [[nodiscard]] auto systemPrompt() const -> const std::string&;
 
@@ -48,11 +72,57 @@ class ChatSession
     /// @param prompt The new system prompt.
     void setSystemPrompt(std::string prompt);
 
+    /// @brief Removes the oldest turn: its user message and all replies up to the next user message.
+    ///
+    /// The system prompt and the most recent turn are never removed.
+    /// @return False if there was no turn that could be removed.
+    auto evictOldestTurn() -> bool;
+
+    /// @brief Returns a branch of this conversation sharing its first @p messageCount messages.
+    ///
+    /// The branch keeps the system prompt, overflow policy and state snapshot. Continued on an
+    /// engine forked with LlmEngine::fork(), it reuses the KV cache of the shared prefix.
+    /// @param messageCount Messages to keep, excluding the system prompt; clamped to messageCount().
+    [[nodiscard]] auto fork(size_t messageCount) const -> ChatSession;
+
+    /// @brief Drops all but the first @p messageCount messages (excluding the system prompt).
+    void truncate(size_t messageCount);
+
+    /// @brief Removes the most recent turn, so it can be answered again.
+    /// @return The turn's user message, or nothing if there is no turn.
+    auto popLastTurn() -> std::optional<std::string>;
+
+    /// @brief Sets how the session is kept within the model's context window.
+    void setOverflowPolicy(ContextOverflowPolicy policy) noexcept { _overflowPolicy = policy; }
+
+    /// @brief Returns how the session is kept within the model's context window.
+    [[nodiscard]] auto overflowPolicy() const noexcept -> ContextOverflowPolicy { return _overflowPolicy; }
+
+    /// @brief Associates a KV-cache snapshot (see LlmEngine::saveState()) with this session.
+    ///
+    /// The snapshot covers a prefix of the conversation, typically the system prompt, and is
+    /// dropped when the system prompt changes.
+    /// @param path The snapshot file, or an empty path to detach it.
+    void setStateSnapshot(std::filesystem::path path);
+
+    /// @brief Returns the associated KV-cache snapshot, or an empty path if there is none.
+    [[nodiscard]] auto stateSnapshot() const -> const std::filesystem::path&;
+
   private:
+    static constexpr auto Uncounted = std::numeric_limits<size_t>::max();
+
     std::string _systemPrompt;
     std::vector<ChatMessage> _messages;
+    std::vector<size_t> _tokenCounts; ///< Prompt tokens of each message, or Uncounted.
+    size_t _countedTokens = 0;        ///< Sum of the counted entries of _tokenCounts.
+    size_t _uncounted = 0;            ///< Entries of _tokenCounts that are Uncounted.
+    std::filesystem::path _stateSnapshot;
+    ContextOverflowPolicy _overflowPolicy = ContextOverflowPolicy::ShiftKv;
 
     void ensureSystemPrompt();
+    void append(ChatMessage message);
+    /// @brief Erases the messages in [first, last), along with their token counts.
+    void erase(size_t first, size_t last);
 };
 
 } // namespace mychat
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace mychat
+{
+
+/// @brief Computes how many tokens after the kept prefix to leave out of a prompt.
+///
+/// Used by the ShiftKv overflow policy: the prompt is sent as its first @p keep tokens
+/// followed by everything after the first `keep + shift` tokens. The shift only grows
+/// while the prompt overflows, in steps of half the evictable part, so consecutive turns
+/// share the same layout (and thus their KV cache) until the next shift becomes necessary.
+/// @param promptSize Number of tokens in the full prompt.
+/// @param keep Number of leading tokens that are never discarded (the system prompt).
+/// @param shift The shift used for the previous prompt of this conversation.
+/// @param limit Maximum number of prompt tokens that may be sent.
+/// @return The new shift; 0 if the full prompt fits.
+[[nodiscard]] constexpr auto contextShiftFor(std::size_t promptSize,
+                                             std::size_t keep,
+                                             std::size_t shift,
+                                             std::size_t limit) -> std::size_t
+{
+    if (promptSize <= limit || keep >= promptSize)
+        return 0;
+
+    auto const maxShift = promptSize - keep;
+    shift = std::min(shift, maxShift);
+    while (promptSize - shift > limit && shift < maxShift)
+        shift += std::max<std::size_t>(1, (maxShift - shift) / 2);
+    return std::min(shift, maxShift);
+}
+
+} // namespace mychat
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "GenerationOutput.hpp"
+
+#include <utility>
+
+namespace mychat
+{
+
+void GenerationOutput::begin(std::span<const ToolDefinition> tools, size_t expectedBytes)
+{
+    _toolParser.reset();
+    if (!tools.empty())
+        _toolParser.emplace(tools);
+    _text.clear();
+    _text.reserve(expectedBytes);
+    _dispatched = 0;
+}
+
+void GenerationOutput::append(std::string_view piece,
+                              StreamCallback const& streamCb,
+                              ToolCallCallback const& toolCallCb)
+{
+    if (!_toolParser)
+    {
+        forward(piece, streamCb);
+        return;
+    }
+
+    _visible.clear();
+    _toolParser->feed(piece, _visible);
+    forward(_visible, streamCb);
+    for (auto const& calls = _toolParser->calls(); _dispatched < calls.size(); ++_dispatched)
+        if (toolCallCb)
+            toolCallCb(calls[_dispatched]);
+}
+
+void GenerationOutput::finish(GenerateResult& result, StreamCallback const& streamCb)
+{
+    if (_toolParser)
+    {
+        _visible.clear();
+        _toolParser->finish(_visible);
+        forward(_visible, streamCb);
+        result.toolCalls = _toolParser->takeCalls();
+        _toolParser.reset();
+    }
+    result.text = std::exchange(_text, {});
+}
+
+void GenerationOutput::forward(std::string_view text, StreamCallback const& streamCb)
+{
+    if (text.empty())
+        return;
+    _text += text;
+    if (streamCb)
+        streamCb(text);
+}
+
+} // namespace mychat
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Types.hpp>
+#include <llm/LlmEngine.hpp>
+#include <llm/ToolCallParser.hpp>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief Accumulates the text of one generation turn and routes it to the callbacks.
+///
+/// This is the per-token part of LlmEngine::generate(). Buffers are reserved once per turn
+/// and reused, so appending pieces of ordinary text does not allocate in steady state.
+class GenerationOutput
+{
+  public:
+    /// @brief Starts a new turn.
+    /// @param tools Tools available in this turn; if non-empty, tool-call markup is split off.
+    ///              Must outlive the turn.
+    /// @param expectedBytes Capacity to reserve for the generated text.
+    void begin(std::span<const ToolDefinition> tools, size_t expectedBytes);
+
+    /// @brief Appends a decoded piece of text.
+    /// @param piece The text of one sampled token.
+    /// @param streamCb Receives the displayable part of the piece, if any.
+    /// @param toolCallCb Receives each tool call completed by this piece.
+    void append(std::string_view piece, StreamCallback const& streamCb, ToolCallCallback const& toolCallCb);
+
+    /// @brief Ends the turn, flushing held-back text and moving text and tool calls into @p result.
+    void finish(GenerateResult& result, StreamCallback const& streamCb);
+
+  private:
+    std::optional<ToolCallParser> _toolParser;
+    std::string _text;    ///< Displayable text of the current turn.
+    std::string _visible; ///< Scratch buffer for the displayable part of a piece.
+    size_t _dispatched = 0;
+
+    void forward(std::string_view text, StreamCallback const& streamCb);
+};
+
+} // namespace mychat
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+#include <llm/Sampler.hpp>
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Callback invoked for each generated token during streaming.
+using StreamCallback = std::function<void(std::string_view token)>;
+
+/// @brief Callback invoked for each tool call as soon as it has been completely generated.
+using ToolCallCallback = std::function<void(const ToolCall& call)>;
+
+/// @brief What the agent loop needs of a language model.
+///
+/// LlmEngine implements it with llama.cpp; benchmarks drive the agent loop with a scripted
+/// engine instead, so its overhead can be measured without a model.
+class InferenceEngine
+{
+  public:
+    virtual ~InferenceEngine() = default;
+
+    /// @brief Generates a response given conversation messages and available tools.
+    /// @param messages The conversation history.
+    /// @param tools Available tool definitions (empty if none).
+    /// @param sampler Sampling configuration.
+    /// @param streamCb Optional callback for streaming tokens. Tool-call markup is not streamed.
+    /// @param toolCallCb Optional callback receiving each tool call while generation continues.
+    ///                   All calls are also returned in GenerateResult::toolCalls.
+    /// @param stopToken Checked between decode steps; when stop is requested, generation ends
+    ///                  early and the partial result is returned with GenerateResult::cancelled set.
+    /// @return The generation result containing text and/or tool calls.
+    [[nodiscard]] virtual auto generate(std::span<const ChatMessage> messages,
+                                        std::span<const ToolDefinition> tools,
+                                        const SamplerConfig& sampler,
+                                        StreamCallback streamCb = {},
+                                        ToolCallCallback toolCallCb = {},
+                                        std::stop_token stopToken = {}) -> Result<GenerateResult> = 0;
+
+    /// @brief Decodes the prompt for the given messages and tools into the KV cache without
+    ///        generating, so that a following generate() whose prompt starts the same way only
+    ///        decodes the rest.
+    ///
+    /// The stop token aborts the prefill between batches, failing it with ErrorCode::Cancelled.
+    /// Engines without a KV cache do nothing.
+    [[nodiscard]] virtual auto prefill(std::span<const ChatMessage> /*messages*/,
+                                       std::span<const ToolDefinition> /*tools*/ = {},
+                                       std::stop_token /*stopToken*/ = {}) -> VoidResult
+    {
+        return {};
+    }
+
+    /// @brief Selects how generate() handles conversations that outgrow the context window.
+    virtual void setContextOverflowPolicy(ContextOverflowPolicy policy) = 0;
+
+    /// @brief Returns the number of tokens the prompt for @p messages and @p tools consists of.
+    [[nodiscard]] virtual auto promptTokenCount(std::span<const ChatMessage> messages,
+                                                std::span<const ToolDefinition> tools = {})
+        -> Result<size_t> = 0;
+
+    /// @brief Returns the tokens each message of the prompt built last takes up, e.g. by
+    ///        promptTokenCount(), in order and without the tools or the generation prompt.
+    ///
+    /// Empty if they are unknown, which is what engines without a prompt cache return.
+    [[nodiscard]] virtual auto messageTokenCounts() const -> std::vector<size_t> { return {}; }
+
+    /// @brief Returns the maximum prompt size that still leaves room for a response.
+    [[nodiscard]] virtual auto contextBudget() const -> size_t = 0;
+
+    /// @brief Computes an L2-normalized sentence embedding of @p text.
+    [[nodiscard]] virtual auto embed(std::string_view text) -> Result<std::vector<float>> = 0;
+
+    /// @brief Creates an engine on the same model that generates on a KV cache of its own.
+    ///
+    /// Lets a side task, like summarizing a tool result, run without evicting the conversation
+    /// cached by this engine. Engines that cannot share their model fail.
+    [[nodiscard]] virtual auto shareEngine() const -> Result<std::unique_ptr<InferenceEngine>>
+    {
+        return makeError(ErrorCode::InferenceError, "The engine cannot be shared");
+    }
+};
+
+} // namespace mychat
@@ -1,33 +1,1023 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "LlmEngine.hpp"
+#include "BatchScheduler.hpp"
+#include "ContextShift.hpp"
+#include "GenerationOutput.hpp"
+#include "PromptCache.hpp"
+#include "PromptLookup.hpp"
+#include "ToolCallParser.hpp"
+#include "ToolGrammar.hpp"
+#include "ToolPreamble.hpp"
 
+#include <core/Hash.hpp>
 #include <core/Log.hpp>
+#include <core/MemoryRegistry.hpp>
+#include <core/Trace.hpp>
 
+#include <ggml.h>
 #include <llama.h>
 
 #include <algorithm>
 #include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <format>
+#include <mutex>
 #include <optional>
 #include <ranges>
+#include <stop_token>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace mychat
 {
 
+namespace
+{
+
+    /// Output capacity reserved per turn: an average token decodes to about four bytes of
+    /// text, and the reservation is capped so huge contexts do not reserve megabytes.
+    constexpr auto ExpectedBytesPerToken = size_t { 4 };
+    constexpr auto MaxReservedTokens = 16384;
+
+    /// Context size of the embedding context; enough for tool descriptions and user messages.
+    constexpr auto EmbeddingContextSize = uint32_t { 512 };
+
+    using Clock = std::chrono::steady_clock;
+
+    /// Minimum interval between live metrics reports during decoding.
+    constexpr auto MetricsReportInterval = std::chrono::milliseconds { 250 };
+
+    /// @brief Converts a duration to fractional milliseconds.
+    auto elapsedMs(Clock::duration duration) -> double
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    /// @brief Maps a KV cache type to the corresponding ggml tensor type.
+    auto toGgmlType(KvCacheType type) -> ggml_type
+    {
+        switch (type)
+        {
+            case KvCacheType::F16: return GGML_TYPE_F16;
+            case KvCacheType::Q8_0: return GGML_TYPE_Q8_0;
+            case KvCacheType::Q4_0: return GGML_TYPE_Q4_0;
+        }
+        return GGML_TYPE_F16;
+    }
+
+    /// @brief Maps the flash attention setting to llama.cpp's enum.
+    auto toFlashAttnType(FlashAttention mode) -> llama_flash_attn_type
+    {
+        switch (mode)
+        {
+            case FlashAttention::Auto: return LLAMA_FLASH_ATTN_TYPE_AUTO;
+            case FlashAttention::Enabled: return LLAMA_FLASH_ATTN_TYPE_ENABLED;
+            case FlashAttention::Disabled: return LLAMA_FLASH_ATTN_TYPE_DISABLED;
+        }
+        return LLAMA_FLASH_ATTN_TYPE_AUTO;
+    }
+
+    /// @brief Reads the GGUF metadata value @p key of @p model as an integer, if it is one.
+    auto modelMetaInt(llama_model const* model, std::string const& key) -> std::optional<int64_t>
+    {
+        auto value = std::array<char, 64> {};
+        if (llama_model_meta_val_str(model, key.c_str(), value.data(), value.size()) <= 0)
+            return std::nullopt;
+        auto result = int64_t {};
+        auto const* end = value.data() + std::strlen(value.data());
+        auto const [ptr, ec] = std::from_chars(value.data(), end, result);
+        if (ec != std::errc {} || ptr != end || result <= 0)
+            return std::nullopt;
+        return result;
+    }
+
+    /// @brief Logs the size of the KV cache implied by the model shape and context parameters.
+    ///
+    /// Estimated from the attention geometry (K and V rows of head_dim * n_head_kv elements per
+    /// layer and position), which matches llama.cpp's unified cache for standard transformer
+    /// models. The key and value head dimensions come from the model's metadata, since many
+    /// models set them apart from n_embd / n_head.
+    /// @return The estimated bytes of the K and V caches together, 0 if the model has no heads.
+    auto logKvCacheFootprint(llama_model const* model, llama_context_params const& params) -> size_t
+    {
+        auto const nHead = llama_model_n_head(model);
+        if (nHead <= 0)
+            return 0;
+        auto architecture = std::array<char, 64> {};
+        llama_model_meta_val_str(model, "general.architecture", architecture.data(), architecture.size());
+        auto const prefix = std::format("{}.attention.", architecture.data());
+        auto const defaultHeadDim = static_cast<int64_t>(llama_model_n_embd(model)) / nHead;
+        auto const headDimK = modelMetaInt(model, prefix + "key_length").value_or(defaultHeadDim);
+        auto const headDimV = modelMetaInt(model, prefix + "value_length").value_or(defaultHeadDim);
+        auto const nHeadKv = static_cast<int64_t>(llama_model_n_head_kv(model));
+        auto const cells = static_cast<double>(params.n_ctx) * llama_model_n_layer(model);
+        auto const kBytes = static_cast<double>(ggml_row_size(params.type_k, headDimK * nHeadKv)) * cells;
+        auto const vBytes = static_cast<double>(ggml_row_size(params.type_v, headDimV * nHeadKv)) * cells;
+        auto constexpr MiB = 1024.0 * 1024.0;
+        log::info("KV cache: {:.0f} MiB (K {} {:.0f} MiB, V {} {:.0f} MiB, {} cells)",
+                  (kBytes + vBytes) / MiB,
+                  ggml_type_name(params.type_k),
+                  kBytes / MiB,
+                  ggml_type_name(params.type_v),
+                  vBytes / MiB,
+                  params.n_ctx);
+        return static_cast<size_t>(kBytes + vBytes);
+    }
+
+    /// @brief Shares ownership of @p model, reporting its weights to memoryRegistry() until it is freed.
+    auto shareModel(llama_model* model, std::string name) -> std::shared_ptr<llama_model>
+    {
+        auto memory = std::make_shared<MemoryAccount>(
+            memoryRegistry().open(std::move(name), MemoryCategory::ModelWeights));
+        memory->set(static_cast<size_t>(llama_model_size(model)));
+        return { model, [memory](llama_model* loaded) {
+                    llama_model_free(loaded);
+                    memory->close();
+                } };
+    }
+
+    /// @brief Derives a stable identifier for a model file and the KV cache layout it is used with.
+    ///
+    /// Hashing the multi-gigabyte model file itself would take longer than the prefill a
+    /// snapshot saves, so the identifier combines the model's description, parameter count
+    /// and size with the file size and the KV cache types.
+    auto computeFingerprint(llama_model const* model, LlmEngineConfig const& config) -> std::string
+    {
+        auto desc = std::array<char, 256> {};
+        llama_model_desc(model, desc.data(), desc.size());
+
+        auto ec = std::error_code {};
+        auto const fileSize = std::filesystem::file_size(config.modelPath, ec);
+
+        auto const key = std::format("{}|{}|{}|{}|{}|{}",
+                                     desc.data(),
+                                     llama_model_n_params(model),
+                                     llama_model_size(model),
+                                     ec ? 0 : fileSize,
+                                     kvCacheTypeName(config.kvCacheTypeK),
+                                     kvCacheTypeName(config.kvCacheTypeV));
+        return std::format("{:016x}", fnv1a64(key));
+    }
+
+    /// Tokens that end a repeated sequence for the DRY sampler (llama.cpp's defaults).
+    constexpr auto DrySequenceBreakers = std::array<char const*, 4> { "\n", ":", "\"", "*" };
+
+    /// @brief Returns the length of the longest common prefix of two token sequences.
+    auto commonPrefixLength(std::span<const llama_token> a, std::span<const llama_token> b) -> size_t
+    {
+        auto const [itA, itB] = std::ranges::mismatch(a, b);
+        return static_cast<size_t>(itA - a.begin());
+    }
+
+    /// @brief Appends a token to a batch allocated with llama_batch_init.
+    void batchAdd(llama_batch& batch, BatchToken const& token)
+    {
+        auto const i = batch.n_tokens;
+        batch.token[i] = token.token;
+        batch.pos[i] = token.position;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = token.sequence;
+        batch.logits[i] = token.logits ? 1 : 0;
+        ++batch.n_tokens;
+    }
+
+    /// @brief Builds a cache key identifying a set of tool definitions.
+    auto toolSetKey(std::span<const ToolDefinition> tools) -> std::string
+    {
+        auto key = std::string {};
+        for (auto const& tool: tools)
+        {
+            key += tool.name;
+            key += '\0';
+            key += tool.inputSchema.dump();
+            key += '\0';
+        }
+        return key;
+    }
+
+    /// @brief A llama context and the scheduler batching the decodes of its sequences.
+    ///
+    /// The engines created by share() hold it together with one sequence each, the one their
+    /// tokens are decoded into; it is freed with the last of them.
+    class SharedContext
+    {
+      public:
+        /// @param kvBytes The size of the context's KV cache, reported to memoryRegistry().
+        SharedContext(llama_context* context, size_t sequences, size_t kvBytes):
+            _context(context),
+            _batch(llama_batch_init(static_cast<int32_t>(llama_n_batch(context)), 0, 1)),
+            _sequencesInUse(sequences),
+            _scheduler(
+                [this](std::span<const BatchToken> tokens) {
+                    _batch.n_tokens = 0;
+                    for (auto const& token: tokens)
+                        batchAdd(_batch, token);
+                    auto const status = llama_decode(_context, _batch);
+                    // Settles the order of the outputs, after which the sequences can read
+                    // their logits concurrently.
+                    if (status == 0)
+                        llama_get_logits(_context);
+                    return status;
+                },
+                llama_n_batch(context),
+                sequences)
+        {
+            _memory.set(kvBytes);
+        }
+
+        ~SharedContext()
+        {
+            // The engines holding sequences are gone, so nothing is left to decode.
+            llama_batch_free(_batch);
+            llama_free(_context);
+        }
+
+        SharedContext(SharedContext const&) = delete;
+        SharedContext& operator=(SharedContext const&) = delete;
+
+        [[nodiscard]] auto context() const noexcept -> llama_context* { return _context; }
+        [[nodiscard]] auto scheduler() noexcept -> BatchScheduler& { return _scheduler; }
+
+        /// @brief Reserves a free sequence, or returns std::nullopt if all are in use.
+        auto acquireSequence() -> std::optional<llama_seq_id>
+        {
+            auto const lock = std::lock_guard(_mutex);
+            auto const free = std::ranges::find(_sequencesInUse, false);
+            if (free == _sequencesInUse.end())
+                return std::nullopt;
+            *free = true;
+            return static_cast<llama_seq_id>(free - _sequencesInUse.begin());
+        }
+
+        /// @brief Drops the tokens of @p sequence from the KV cache and makes it available again.
+        void releaseSequence(llama_seq_id sequence)
+        {
+            {
+                auto const context = _scheduler.lock();
+                if (auto* mem = llama_get_memory(_context))
+                    llama_memory_seq_rm(mem, sequence, -1, -1);
+            }
+            auto const lock = std::lock_guard(_mutex);
+            _sequencesInUse[static_cast<size_t>(sequence)] = false;
+        }
+
+        /// @brief The context share() created once all sequences of this one were in use.
+        [[nodiscard]] auto overflow() const -> std::shared_ptr<SharedContext>
+        {
+            auto const lock = std::lock_guard(_mutex);
+            return _overflow.lock();
+        }
+
+        void setOverflow(std::shared_ptr<SharedContext> const& context)
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _overflow = context;
+        }
+
+      private:
+        llama_context* _context;
+        llama_batch _batch;
+        mutable std::mutex _mutex;
+        std::vector<bool> _sequencesInUse;
+        std::weak_ptr<SharedContext> _overflow;
+        MemoryAccount _memory = memoryRegistry().open("KV cache", MemoryCategory::KvCache);
+        BatchScheduler _scheduler; ///< Declared last so it stops before the rest goes.
+    };
+
+} // namespace
+
 struct LlmEngine::Impl
 {
     llama_model* model = nullptr;
+    /// Owns the model; engines created by share() own it too, so it outlives all their contexts.
+    std::shared_ptr<llama_model> sharedModel;
+    /// The context, shared with the engines of share() that decode into its other sequences.
+    std::shared_ptr<SharedContext> sharedContext;
     llama_context* ctx = nullptr;
+    llama_seq_id seq = 0;                  ///< The sequence of ctx this engine decodes into.
+    llama_context_params contextParams {}; ///< What ctx was created with, for the contexts of share().
     int ctxSize = 0;
+    std::string fingerprint; ///< Identifies the model and KV cache layout for state snapshots.
+
+    /// Tokens currently resident in the engine's sequence of the KV cache, in position order.
+    /// Used to find the longest common prefix with the next prompt so that only
+    /// the diverging suffix needs to be decoded.
+    std::vector<llama_token> cachedTokens;
+
+    /// Context overflow handling. With ShiftKv, prompts are sent without the `contextShift`
+    /// tokens that follow the first `contextKeep` ones (the system prompt); promptView holds
+    /// that shortened prompt.
+    ContextOverflowPolicy overflowPolicy = ContextOverflowPolicy::ShiftKv;
+    size_t contextKeep = 0;
+    size_t contextShift = 0;
+    std::vector<llama_token> promptView;
+
+    /// Per-message template fragments and tokens, so each agent step only renders and
+    /// tokenizes the messages added since the previous step.
+    PromptCache promptCache;
+
+    /// Tool definitions rendered into the system message, re-tokenized only when the tool
+    /// set changes. systemScratch holds the system message content with the preamble appended.
+    ToolPreamble toolPreamble;
+    size_t toolPreambleBudget = 0;
+    std::string systemScratch;
+
+    // Speculative decoding (optional): a small draft model proposes tokens that the
+    // main model verifies in a single batched decode.
+    llama_model* draftModel = nullptr;
+    llama_context* draftCtx = nullptr;
+    llama_sampler* draftSampler = nullptr;
+    std::vector<llama_token> draftCachedTokens; ///< Tokens resident in the draft KV cache.
+    std::vector<llama_token> draftScratch;      ///< Proposed tokens of the current step.
+    std::vector<BatchToken> verifyTokens;       ///< Pending + drafted tokens, all with logits.
+    int draftMaxTokens = 0;
+    MemoryAccount draftMemory; ///< Reports the draft model's weights and KV cache.
+
+    /// Drafts by prompt lookup instead, if enabled and there is no draft model.
+    std::optional<PromptLookup> promptLookup;
+
+    /// Context for computing embeddings, created on first use. It shares the model weights
+    /// but has its own small KV cache, so embedding never disturbs the chat context.
+    llama_context* embedCtx = nullptr;
+    uint32_t threads = 0;
+
+    PrefillProgressCallback prefillCallback;
+    GenerateMetricsCallback metricsCallback;
+
+    /// Tool-call grammar for the most recently used tool set (rebuilt when the tools change).
+    std::string toolGrammar;
+    std::string toolGrammarKey;
+
+    /// Sampler chain of the previous turn, reused (after a reset) while the sampler
+    /// configuration and the tool set stay the same. Resetting also clears the penalty
+    /// history, so repetition penalties apply to the tokens generated within a turn.
+    llama_sampler* sampler = nullptr;
+    SamplerConfig samplerConfig;
+    std::string samplerToolKey;
+
+    /// Per-turn output buffers, reused across turns.
+    GenerationOutput output;
+
+    /// Tokens handed to the scheduler, reused across decodes.
+    std::vector<BatchToken> batchScratch;
+
+    /// Reusable scratch buffers for template rendering and tokenization.
+    std::vector<llama_chat_message> chatMessages;
+    std::vector<char> templateBuffer;
+
+    Impl():
+        promptCache([this](std::span<const ChatMessage> messages,
+                           bool addAssistant) { return renderTemplate(messages, addAssistant); },
+                    [this](std::string_view text, bool addSpecial) { return tokenize(text, addSpecial); }),
+        toolPreamble([this](std::string_view text) -> Result<size_t> {
+            auto tokens = tokenize(text, false);
+            if (!tokens)
+                return std::unexpected(tokens.error());
+            return tokens->size();
+        })
+    {
+    }
+
+    Impl(Impl const&) = delete;
+    Impl& operator=(Impl const&) = delete;
 
     ~Impl()
     {
-        if (ctx)
-            llama_free(ctx);
-        if (model)
-            llama_model_free(model);
+        releaseSampler();
+        releaseDraft();
+        releaseEmbeddings();
+        if (sharedContext)
+            sharedContext->releaseSequence(seq);
+        // sharedModel is released after sharedContext, once the contexts using the model are gone.
+    }
+
+    /// @brief Releases the draft model and everything that belongs to it.
+    void releaseDraft()
+    {
+        if (draftSampler)
+            llama_sampler_free(draftSampler);
+        if (draftCtx)
+            llama_free(draftCtx);
+        if (draftModel)
+            llama_model_free(draftModel);
+        draftSampler = nullptr;
+        draftCtx = nullptr;
+        draftModel = nullptr;
+        draftCachedTokens.clear();
+        draftMaxTokens = 0;
+        draftMemory.close();
+        promptLookup.reset();
+    }
+
+    /// @brief Releases the embedding context.
+    void releaseEmbeddings()
+    {
+        if (embedCtx)
+            llama_free(embedCtx);
+        embedCtx = nullptr;
+    }
+
+    /// @brief Computes the mean-pooled, L2-normalized embedding of @p text.
+    ///
+    /// Text longer than the embedding context is truncated.
+    auto embed(std::string_view text) -> Result<std::vector<float>>
+    {
+        if (!embedCtx)
+        {
+            auto params = llama_context_default_params();
+            params.n_ctx = EmbeddingContextSize;
+            params.n_batch = EmbeddingContextSize;
+            params.n_ubatch = EmbeddingContextSize; // Pooling needs the whole sequence in one ubatch.
+            params.n_threads = static_cast<int32_t>(threads);
+            params.n_threads_batch = static_cast<int32_t>(threads);
+            params.embeddings = true;
+            params.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+            embedCtx = llama_init_from_model(model, params);
+            if (!embedCtx)
+                return makeError(ErrorCode::InferenceError, "Failed to create embedding context");
+        }
+
+        auto tokens = tokenize(text, true);
+        if (!tokens)
+            return std::unexpected(tokens.error());
+        if (tokens->size() > EmbeddingContextSize)
+            tokens->resize(EmbeddingContextSize);
+        if (tokens->empty())
+            return makeError(ErrorCode::InvalidArgument, "Cannot embed empty text");
+
+        if (auto* mem = llama_get_memory(embedCtx))
+            llama_memory_clear(mem, true);
+        auto batch = llama_batch_get_one(tokens->data(), static_cast<int32_t>(tokens->size()));
+        if (llama_decode(embedCtx, batch) != 0)
+            return makeError(ErrorCode::InferenceError, "Failed to decode text for embedding");
+
+        auto const* values = llama_get_embeddings_seq(embedCtx, 0);
+        if (!values)
+            return makeError(ErrorCode::InferenceError, "Model does not produce embeddings");
+
+        auto embedding = std::vector<float>(values, values + llama_model_n_embd(model));
+        auto norm = 0.f;
+        for (auto const v: embedding)
+            norm += v * v;
+        if (norm > 0.f)
+        {
+            auto const scale = 1.f / std::sqrt(norm);
+            for (auto& v: embedding)
+                v *= scale;
+        }
+        return embedding;
+    }
+
+    /// @brief Releases the cached sampler chain.
+    void releaseSampler()
+    {
+        if (sampler)
+            llama_sampler_free(sampler);
+        sampler = nullptr;
+        samplerToolKey.clear();
+    }
+
+    /// @brief Returns a sampler chain for the given configuration and tools, ready for a new turn.
+    ///
+    /// The chain is only rebuilt when the configuration or the tool set changed; otherwise the
+    /// cached chain is reset, which restarts the tool-call grammar and reseeds the distribution.
+    /// @param toolKey The toolSetKey() of @p tools (empty if there are none).
+    auto acquireSampler(SamplerConfig const& config,
+                        std::span<const ToolDefinition> tools,
+                        std::string_view toolKey) -> llama_sampler*
+    {
+        if (sampler && config == samplerConfig && toolKey == samplerToolKey)
+        {
+            llama_sampler_reset(sampler);
+            return sampler;
+        }
+
+        releaseSampler();
+        sampler = llama_sampler_chain_init(llama_sampler_chain_default_params());
+
+        // Constrain tool calls with a lazy grammar that activates once the model opens a
+        // <tool_call> block, so every emitted call is valid JSON matching a tool's schema.
+        if (!tools.empty())
+        {
+            if (toolKey != toolGrammarKey)
+            {
+                toolGrammar = buildToolCallGrammar(tools);
+                toolGrammarKey = toolKey;
+            }
+
+            char const* triggerPatterns[] = { "[\\s\\S]*?(<tool_call>)[\\s\\S]*" };
+            auto* grammar = llama_sampler_init_grammar_lazy_patterns(
+                llama_model_get_vocab(model), toolGrammar.c_str(), "root", triggerPatterns, 1, nullptr, 0);
+            if (grammar)
+                llama_sampler_chain_add(sampler, grammar);
+            else
+                log::warning("Failed to initialize tool-call grammar; tool calls are unconstrained");
+        }
+
+        if (config.repeatPenalty != 1.f || config.frequencyPenalty != 0.f || config.presencePenalty != 0.f)
+            llama_sampler_chain_add(sampler,
+                                    llama_sampler_init_penalties(config.repeatLastN,
+                                                                 config.repeatPenalty,
+                                                                 config.frequencyPenalty,
+                                                                 config.presencePenalty));
+        if (config.dryMultiplier > 0.f)
+        {
+            // llama_sampler_init_dry takes a non-const array but copies the strings.
+            auto breakers = DrySequenceBreakers;
+            llama_sampler_chain_add(sampler,
+                                    llama_sampler_init_dry(llama_model_get_vocab(model),
+                                                           llama_model_n_ctx_train(model),
+                                                           config.dryMultiplier,
+                                                           config.dryBase,
+                                                           config.dryAllowedLength,
+                                                           config.dryPenaltyLastN,
+                                                           breakers.data(),
+                                                           breakers.size()));
+        }
+        llama_sampler_chain_add(sampler, llama_sampler_init_top_k(config.topK));
+        llama_sampler_chain_add(sampler, llama_sampler_init_top_p(config.topP, 1));
+        if (config.minP > 0.f)
+            llama_sampler_chain_add(sampler, llama_sampler_init_min_p(config.minP, 1));
+        auto const seed = config.seed < 0 ? LLAMA_DEFAULT_SEED : static_cast<uint32_t>(config.seed);
+        if (config.xtcProbability > 0.f)
+            llama_sampler_chain_add(
+                sampler, llama_sampler_init_xtc(config.xtcProbability, config.xtcThreshold, 1, seed));
+        llama_sampler_chain_add(sampler, llama_sampler_init_temp(config.temperature));
+        llama_sampler_chain_add(sampler, llama_sampler_init_dist(seed));
+
+        samplerConfig = config;
+        samplerToolKey = toolKey;
+        return sampler;
+    }
+
+    /// @brief Number of context positions kept free for the response when fitting a prompt.
+    [[nodiscard]] auto responseReserve() const -> size_t { return static_cast<size_t>(ctxSize / 4); }
+
+    /// @brief Returns the tokens to decode for a prompt, applying the ShiftKv policy.
+    ///
+    /// If the prompt (plus the response reserve) does not fit, the tokens after the system
+    /// prompt are thinned out and the KV cache is shifted along with them, so the part of
+    /// the conversation that stays in context does not have to be decoded again.
+    /// @param messages The conversation the prompt was built from.
+    /// @param tokens The full prompt.
+    [[nodiscard]] auto fitPrompt(std::span<const ChatMessage> messages, std::span<const llama_token> tokens)
+        -> std::span<const llama_token>
+    {
+        auto const limit = static_cast<size_t>(ctxSize) - responseReserve();
+        if (overflowPolicy != ContextOverflowPolicy::ShiftKv || tokens.size() <= limit)
+        {
+            contextShift = 0;
+            return tokens;
+        }
+
+        auto const hasSystem = !messages.empty() && messages.front().role == Role::System;
+        auto const keep = hasSystem ? promptCache.prefixTokenCount(1).value_or(0) : size_t { 0 };
+        if (keep != contextKeep)
+            contextShift = 0;
+        contextKeep = keep;
+
+        auto const previousShift = contextShift;
+        contextShift = contextShiftFor(tokens.size(), keep, contextShift, limit);
+        if (contextShift > previousShift)
+            shiftContext(contextShift - previousShift);
+
+        auto const tail = tokens.subspan(keep + contextShift);
+        promptView.assign(tokens.begin(), tokens.begin() + static_cast<std::ptrdiff_t>(keep));
+        promptView.insert(promptView.end(), tail.begin(), tail.end());
+        return promptView;
+    }
+
+    /// @brief Removes all tokens of the engine's sequence from the KV cache.
+    void dropSequence()
+    {
+        if (auto* mem = llama_get_memory(ctx))
+        {
+            auto const context = sharedContext->scheduler().lock();
+            llama_memory_seq_rm(mem, seq, -1, -1);
+        }
+        cachedTokens.clear();
+    }
+
+    /// @brief Copies the tokens of the engine's sequence into the empty sequence of @p target.
+    /// @return False if the state could not be transferred to a different context.
+    auto copySequenceTo(Impl& target) -> bool
+    {
+        auto* mem = llama_get_memory(ctx);
+        if (!mem || cachedTokens.empty())
+            return true;
+        if (target.sharedContext == sharedContext)
+        {
+            auto const context = sharedContext->scheduler().lock();
+            llama_memory_seq_cp(mem, seq, target.seq, -1, -1);
+            return true;
+        }
+
+        auto state = std::vector<uint8_t> {};
+        {
+            auto const context = sharedContext->scheduler().lock();
+            state.resize(llama_state_seq_get_size(ctx, seq));
+            state.resize(llama_state_seq_get_data(ctx, state.data(), state.size(), seq));
+        }
+        auto const context = target.sharedContext->scheduler().lock();
+        return !state.empty()
+               && llama_state_seq_set_data(target.ctx, state.data(), state.size(), target.seq) != 0;
+    }
+
+    /// @brief Discards @p count tokens following the kept prefix from the engine's sequence and
+    /// moves the remaining tokens down, so they keep their KV entries.
+    /// @return False if the cache does not support shifting; the sequence is dropped in that case.
+    auto shiftContext(size_t count) -> bool
+    {
+        auto* mem = llama_get_memory(ctx);
+        auto const keep = std::min(contextKeep, cachedTokens.size());
+        count = std::min(count, cachedTokens.size() - keep);
+        if (!mem || count == 0)
+            return mem != nullptr;
+
+        auto const first = static_cast<llama_pos>(keep);
+        auto const last = static_cast<llama_pos>(keep + count);
+        auto context = sharedContext->scheduler().lock();
+        if (!llama_memory_can_shift(mem) || !llama_memory_seq_rm(mem, seq, first, last))
+        {
+            context.unlock();
+            log::warning("KV cache does not support shifting; dropping it");
+            dropSequence();
+            return false;
+        }
+        llama_memory_seq_add(mem, seq, last, -1, -static_cast<llama_pos>(count));
+        context.unlock();
+        cachedTokens.erase(cachedTokens.begin() + first, cachedTokens.begin() + last);
+        if (promptLookup)
+            promptLookup->truncate(keep);
+        log::info("Context shift: discarded {} tokens after the first {}", count, keep);
+        return true;
+    }
+
+    /// @brief The outcome of syncPrompt().
+    struct SyncedPrompt
+    {
+        size_t reused = 0; ///< Prompt tokens that were already in the KV cache.
+        BatchLease logits; ///< The logits of the last prompt token.
+    };
+
+    /// @brief Makes the engine's sequence of the main KV cache hold exactly @p tokens.
+    ///
+    /// The longest prefix shared with the cached tokens is reused and only the diverging
+    /// suffix is decoded, in n_batch sized chunks so long prompts neither exceed the batch
+    /// limit nor leave the UI without feedback. At least one token is always decoded so
+    /// fresh logits are available for sampling.
+    /// @return The number of reused tokens and the logits, or std::nullopt if decoding failed
+    ///         or was stopped, in which case the sequence has been dropped.
+    auto syncPrompt(std::span<const llama_token> tokens, std::stop_token const& stopToken)
+        -> std::optional<SyncedPrompt>
+    {
+        auto const zone = trace::Zone("llm", "prefill");
+        auto* mem = llama_get_memory(ctx);
+        auto reused = mem ? commonPrefixLength(cachedTokens, tokens) : size_t { 0 };
+        if (reused == tokens.size() && reused > 0)
+            --reused;
+
+        if (mem && reused < cachedTokens.size())
+        {
+            auto const context = sharedContext->scheduler().lock();
+            if (!llama_memory_seq_rm(mem, seq, static_cast<llama_pos>(reused), -1))
+            {
+                // Partial removal is not supported by this memory type; start from scratch.
+                llama_memory_seq_rm(mem, seq, -1, -1);
+                reused = 0;
+            }
+        }
+        cachedTokens.resize(reused);
+
+        // The prompt may differ from the previous one after the reused prefix.
+        if (promptLookup)
+            promptLookup->truncate(reused);
+
+        log::debug("Prompt: {} tokens, {} reused from KV cache, {} to decode",
+                   tokens.size(),
+                   reused,
+                   tokens.size() - reused);
+
+        auto completed = size_t { 0 };
+        auto logits = decodeSequence(tokens.subspan(reused), &prefillCallback, stopToken, &completed);
+        if (!logits)
+        {
+            // Keeps the chunks decoded before the stop, so the next prompt with the same prefix,
+            // e.g. a speculative prefill superseded by an edit, resumes after them.
+            auto const kept = reused + completed;
+            auto const context = sharedContext->scheduler().lock();
+            if (mem && llama_memory_seq_rm(mem, seq, static_cast<llama_pos>(kept), -1))
+                cachedTokens.insert(cachedTokens.end(),
+                                    tokens.begin() + static_cast<std::ptrdiff_t>(reused),
+                                    tokens.begin() + static_cast<std::ptrdiff_t>(kept));
+            else
+            {
+                if (mem)
+                    llama_memory_seq_rm(mem, seq, -1, -1);
+                cachedTokens.clear();
+            }
+            return std::nullopt;
+        }
+        cachedTokens.insert(
+            cachedTokens.end(), tokens.begin() + static_cast<std::ptrdiff_t>(reused), tokens.end());
+        return SyncedPrompt { .reused = reused, .logits = std::move(*logits) };
+    }
+
+    /// @brief Decodes @p tokens into the engine's sequence, following the cached tokens.
+    ///
+    /// The tokens are handed to the context's scheduler in chunks of at most n_batch tokens,
+    /// and decoded in steps shared with the other sequences of the context.
+    /// @param progress Optional callback receiving (decoded, total) after each chunk.
+    /// @param stopToken Checked between steps; a stop request aborts the decode.
+    /// @param completed Optionally receives the number of tokens in the chunks that were decoded,
+    ///                  which a failed decode leaves in the KV cache.
+    /// @return The lease on the logits of the last token.
+    auto decodeSequence(std::span<const llama_token> tokens,
+                        PrefillProgressCallback const* progress = nullptr,
+                        std::stop_token const& stopToken = {},
+                        size_t* completed = nullptr) -> Result<BatchLease>
+    {
+        batchScratch.clear();
+        for (auto const token: tokens)
+            batchScratch.push_back(BatchToken {
+                .token = token,
+                .position = static_cast<llama_pos>(cachedTokens.size() + batchScratch.size()),
+                .sequence = seq,
+                .logits = false,
+            });
+        if (!batchScratch.empty())
+            batchScratch.back().logits = true;
+
+        auto& scheduler = sharedContext->scheduler();
+        auto const total = batchScratch.size();
+        auto const chunkSize = std::max(size_t { 1 }, static_cast<size_t>(llama_n_batch(ctx)));
+        auto logits = BatchLease {};
+        for (auto offset = size_t { 0 }; offset < total; offset += chunkSize)
+        {
+            auto const chunk = std::span(batchScratch).subspan(offset, std::min(chunkSize, total - offset));
+            auto decoded = scheduler.decode(chunk, stopToken);
+            if (!decoded)
+                return std::unexpected(decoded.error());
+            if (completed)
+                *completed = offset + chunk.size();
+            logits = std::move(*decoded);
+            if (offset + chunk.size() < total)
+                logits.release(true);
+            if (progress && *progress)
+                (*progress)(static_cast<int>(offset + chunk.size()), static_cast<int>(total));
+        }
+        return logits;
+    }
+
+    /// @brief Decodes tokens into sequence 0 of the draft context in chunks of at most n_batch tokens.
+    /// @param context The context to decode into.
+    /// @param tokens The tokens to decode, continuing at the current end of sequence 0.
+    /// @param progress Optional callback receiving (decoded, total) after each chunk.
+    /// @param stopToken Checked between chunks; a stop request aborts the prefill.
+    /// @return True on success, false on decode failure or stop request.
+    static auto decodeTokens(llama_context* context,
+                             std::span<const llama_token> tokens,
+                             PrefillProgressCallback const* progress = nullptr,
+                             std::stop_token const& stopToken = {}) -> bool
+    {
+        auto const total = static_cast<int>(tokens.size());
+        auto const chunkSize = std::max(1, static_cast<int>(llama_n_batch(context)));
+        for (auto offset = 0; offset < total; offset += chunkSize)
+        {
+            if (stopToken.stop_requested())
+                return false;
+            auto const count = std::min(chunkSize, total - offset);
+            // llama_batch_get_one requires a non-const pointer but does not modify the tokens.
+            auto batch = llama_batch_get_one(const_cast<llama_token*>(tokens.data()) + offset, count);
+            if (llama_decode(context, batch) != 0)
+                return false;
+            if (progress && *progress)
+                (*progress)(offset + count, total);
+        }
+        return true;
+    }
+
+    /// @brief Lets the draft model propose up to @p maxDrafts tokens following @p history and @p last.
+    ///
+    /// The draft KV cache is brought in sync with the main context using the same
+    /// longest-common-prefix reuse as the main model. Proposals are greedy.
+    /// @param history Tokens already in the main KV cache.
+    /// @param last The sampled token that is about to be decoded by the main model.
+    /// @param maxDrafts Upper bound on the number of proposed tokens.
+    /// @param out Receives the proposed tokens; empty on failure.
+    void proposeDrafts(std::span<const llama_token> history,
+                       llama_token last,
+                       int maxDrafts,
+                       std::vector<llama_token>& out)
+    {
+        out.clear();
+        if (!draftCtx || maxDrafts <= 0)
+            return;
+
+        auto* draftMem = llama_get_memory(draftCtx);
+        auto reused = commonPrefixLength(draftCachedTokens, history);
+        if (reused < draftCachedTokens.size()
+            && !llama_memory_seq_rm(draftMem, 0, static_cast<llama_pos>(reused), -1))
+        {
+            llama_memory_clear(draftMem, true);
+            reused = 0;
+        }
+        draftCachedTokens.resize(reused);
+
+        auto const resetDraft = [&] {
+            llama_memory_clear(draftMem, true);
+            draftCachedTokens.clear();
+            out.clear();
+        };
+
+        auto const missing = history.subspan(reused);
+        if (!decodeTokens(draftCtx, missing) || !decodeTokens(draftCtx, std::span(&last, 1)))
+        {
+            resetDraft();
+            return;
+        }
+        draftCachedTokens.insert(draftCachedTokens.end(), missing.begin(), missing.end());
+        draftCachedTokens.push_back(last);
+
+        auto const* vocab = llama_model_get_vocab(draftModel);
+        for (auto i = 0; i < maxDrafts; ++i)
+        {
+            auto const token = llama_sampler_sample(draftSampler, draftCtx, -1);
+            if (llama_vocab_is_eog(vocab, token))
+                break;
+            out.push_back(token);
+            if (i + 1 == maxDrafts)
+                break;
+            if (!decodeTokens(draftCtx, std::span(&token, 1)))
+            {
+                resetDraft();
+                return;
+            }
+            draftCachedTokens.push_back(token);
+        }
+    }
+
+    /// @brief Drafts by prompt lookup with the given n-gram size and proposals per step.
+    void enablePromptLookup(size_t ngramSize, int maxDrafts)
+    {
+        promptLookup.emplace(ngramSize);
+        draftMaxTokens = maxDrafts;
+        verifyTokens.reserve(static_cast<size_t>(maxDrafts) + 1);
+    }
+
+    /// @brief Loads the optional draft model; failures only disable speculative decoding.
+    void loadDraft(const LlmEngineConfig& config,
+                   llama_model_params modelParams,
+                   llama_context_params ctxParams)
+    {
+        // A missing or incompatible draft model only disables speculative decoding.
+        log::info("Loading draft model: {}", config.draftModelPath);
+
+        auto* loadedModel = llama_model_load_from_file(config.draftModelPath.c_str(), modelParams);
+        if (!loadedModel)
+        {
+            log::warning("Failed to load draft model, speculative decoding disabled: {}",
+                         config.draftModelPath);
+            return;
+        }
+
+        auto const draftVocabSize = llama_vocab_n_tokens(llama_model_get_vocab(loadedModel));
+        auto const mainVocabSize = llama_vocab_n_tokens(llama_model_get_vocab(model));
+        if (draftVocabSize != mainVocabSize)
+        {
+            log::warning("Draft model vocabulary ({} tokens) does not match main model ({} tokens), "
+                         "speculative decoding disabled",
+                         draftVocabSize,
+                         mainVocabSize);
+            llama_model_free(loadedModel);
+            return;
+        }
+
+        auto* loadedCtx = llama_init_from_model(loadedModel, ctxParams);
+        if (!loadedCtx)
+        {
+            log::warning("Failed to create draft context, speculative decoding disabled");
+            llama_model_free(loadedModel);
+            return;
+        }
+
+        auto const maxDrafts = std::max(1, config.draftMaxTokens);
+        draftModel = loadedModel;
+        draftCtx = loadedCtx;
+        draftSampler = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        llama_sampler_chain_add(draftSampler, llama_sampler_init_greedy());
+        verifyTokens.reserve(static_cast<size_t>(maxDrafts) + 1);
+        draftMaxTokens = maxDrafts;
+        draftMemory = memoryRegistry().open("Draft model", MemoryCategory::ModelWeights);
+        draftMemory.set(static_cast<size_t>(llama_model_size(loadedModel))
+                        + logKvCacheFootprint(loadedModel, ctxParams));
+
+        log::info("Speculative decoding enabled (up to {} draft tokens per step)", maxDrafts);
+    }
+
+    /// @brief Brings the tool preamble up to date with @p tools.
+    ///
+    /// The prompt cache is dropped whenever the preamble text changes, since the preamble is
+    /// part of the first message.
+    /// @param toolKey The toolSetKey() of @p tools (empty if there are none).
+    auto applyToolPreamble(std::span<const ToolDefinition> tools, std::string_view toolKey) -> VoidResult
+    {
+        auto changed = toolPreamble.update(tools, toolKey, toolPreambleBudget);
+        if (!changed)
+            return std::unexpected(changed.error());
+        if (!*changed)
+            return {};
+
+        promptCache.clear();
+        if (!tools.empty())
+            log::info("Tool preamble: {} of {} tools, {} tokens",
+                      toolPreamble.includedToolCount(),
+                      tools.size(),
+                      toolPreamble.tokenCount());
+        return {};
+    }
+
+    /// @brief Renders messages through the model's chat template (or chatml as fallback).
+    auto renderTemplate(std::span<const ChatMessage> messages, bool addAssistant) -> Result<std::string>
+    {
+        auto const* tmpl = llama_model_chat_template(model, nullptr);
+        auto const* chatTemplate = tmpl ? tmpl : "chatml";
+
+        // The tool preamble extends the system message, or becomes one if there is none.
+        auto const& preamble = toolPreamble.text();
+        chatMessages.clear();
+        if (!preamble.empty() && (messages.empty() || messages.front().role != Role::System))
+            chatMessages.push_back(llama_chat_message { .role = "system", .content = preamble.c_str() });
+        for (const auto& msg: messages)
+        {
+            auto const* content = msg.content.c_str();
+            if (!preamble.empty() && chatMessages.empty())
+            {
+                systemScratch.assign(msg.content);
+                if (!systemScratch.empty())
+                    systemScratch += "\n\n";
+                systemScratch += preamble;
+                content = systemScratch.c_str();
+            }
+            chatMessages.push_back(llama_chat_message {
+                .role = roleToString(msg.role).data(), // Backed by null-terminated literals.
+                .content = content,
+            });
+        }
+
+        auto const apply = [&] {
+            return llama_chat_apply_template(chatTemplate,
+                                             chatMessages.data(),
+                                             chatMessages.size(),
+                                             addAssistant,
+                                             templateBuffer.data(),
+                                             static_cast<int32_t>(templateBuffer.size()));
+        };
+
+        auto len = apply();
+        if (len > static_cast<int32_t>(templateBuffer.size()))
+        {
+            templateBuffer.resize(static_cast<size_t>(len));
+            len = apply();
+        }
+        if (len < 0)
+            return makeError(ErrorCode::InferenceError, "Failed to apply chat template");
+
+        return std::string(templateBuffer.data(), static_cast<size_t>(len));
+    }
+
+    /// @brief Tokenizes text with the model vocabulary, parsing special tokens.
+    auto tokenize(std::string_view text, bool addSpecial) -> Result<std::vector<TokenId>>
+    {
+        auto const* vocab = llama_model_get_vocab(model);
+        auto tokens = std::vector<llama_token>(text.size() + 2);
+        auto n = llama_tokenize(vocab,
+                                text.data(),
+                                static_cast<int32_t>(text.size()),
+                                tokens.data(),
+                                static_cast<int32_t>(tokens.size()),
+                                addSpecial,
+                                true);
+        if (n < 0)
+        {
+            tokens.resize(static_cast<size_t>(-n));
+            n = llama_tokenize(vocab,
+                               text.data(),
+                               static_cast<int32_t>(text.size()),
+                               tokens.data(),
+                               static_cast<int32_t>(tokens.size()),
+                               addSpecial,
+                               true);
+        }
+        if (n < 0)
+            return makeError(ErrorCode::InferenceError, "Tokenization failed");
+        tokens.resize(static_cast<size_t>(n));
+        return tokens;
     }
 };
 
@@ -35,7 +1025,9 @@ namespace
 {
 
     /// @brief Line buffer for llama.cpp log continuation messages.
-    auto llamaLineBuffer = std::string {};
+    ///
+    /// Each thread logging has its own, so lines from concurrent threads never interleave.
+    thread_local auto llamaLineBuffer = std::string {};
 
     /// @brief Maps ggml_log_level to mychat::log::Level.
     /// @param level The ggml log level.
@@ -94,72 +1086,6 @@ namespace
         }
     }
 
-    /// @brief Attempts to parse tool calls from generated text.
-    ///
-    /// Supports common formats used by chat models (e.g., Llama 3, Qwen, Mistral).
-    /// Tool calls are typically enclosed in special tags or JSON blocks.
-    void parseToolCalls(GenerateResult& result, std::span<const ToolDefinition> tools)
-    {
-        auto const& text = result.text;
-
-        auto const toolCallStart = std::string_view("<tool_call>");
-        auto const toolCallEnd = std::string_view("</tool_call>");
-
-        auto pos = text.find(toolCallStart);
-        while (pos != std::string::npos)
-        {
-            auto const start = pos + toolCallStart.size();
-            auto const end = text.find(toolCallEnd, start);
-            if (end == std::string::npos)
-                break;
-
-            auto const jsonStr = text.substr(start, end - start);
-            try
-            {
-                auto const json = nlohmann::json::parse(jsonStr);
-                auto call = ToolCall {};
-                call.name = json.value("name", "");
-                call.arguments = json.value("arguments", nlohmann::json::object());
-                call.id = std::format("call_{}", result.toolCalls.size());
-
-                auto const found =
-                    std::ranges::any_of(tools, [&](const auto& t) { return t.name == call.name; });
-                if (found)
-                    result.toolCalls.push_back(std::move(call));
-            }
-            catch (...)
-            {
-                // Skip malformed tool calls
-            }
-
-            pos = text.find(toolCallStart, end + toolCallEnd.size());
-        }
-
-        if (!result.toolCalls.empty())
-        {
-            auto cleaned = std::string {};
-            auto searchPos = size_t { 0 };
-            while (true)
-            {
-                auto const tcStart = text.find(toolCallStart, searchPos);
-                if (tcStart == std::string::npos)
-                {
-                    cleaned += text.substr(searchPos);
-                    break;
-                }
-                cleaned += text.substr(searchPos, tcStart - searchPos);
-                auto const tcEnd = text.find(toolCallEnd, tcStart);
-                if (tcEnd == std::string::npos)
-                {
-                    cleaned += text.substr(tcStart);
-                    break;
-                }
-                searchPos = tcEnd + toolCallEnd.size();
-            }
-            result.text = std::move(cleaned);
-        }
-    }
-
 } // namespace
 
 LlmEngine::LlmEngine(): _impl(std::make_unique<Impl>())
@@ -183,6 +1109,8 @@ auto LlmEngine::load(const LlmEngineConfig& config) -> VoidResult
         modelParams.n_gpu_layers = config.gpuLayers;
     else
         modelParams.n_gpu_layers = 999; // Auto: offload as many as possible
+    modelParams.use_mmap = config.useMmap;
+    modelParams.use_mlock = config.useMlock;
 
     auto* model = llama_model_load_from_file(config.modelPath.c_str(), modelParams);
     if (!model)
@@ -193,141 +1121,594 @@ auto LlmEngine::load(const LlmEngineConfig& config) -> VoidResult
     ctxParams.n_ctx = static_cast<uint32_t>(config.contextSize);
     ctxParams.n_threads = config.threads > 0 ? static_cast<uint32_t>(config.threads)
                                              : static_cast<uint32_t>(std::thread::hardware_concurrency());
-    ctxParams.n_threads_batch = ctxParams.n_threads;
+    ctxParams.n_threads_batch =
+        config.batchThreads > 0 ? static_cast<uint32_t>(config.batchThreads) : ctxParams.n_threads;
+    if (config.batchSize > 0)
+        ctxParams.n_batch = static_cast<uint32_t>(config.batchSize);
+    if (config.ubatchSize > 0)
+        ctxParams.n_ubatch =
+            static_cast<uint32_t>(std::min(config.ubatchSize, static_cast<int>(ctxParams.n_batch)));
+
+    ctxParams.type_k = toGgmlType(config.kvCacheTypeK);
+    ctxParams.type_v = toGgmlType(config.kvCacheTypeV);
+    ctxParams.flash_attn_type = toFlashAttnType(config.flashAttention);
+    ctxParams.offload_kqv = config.offloadKqv;
+    if (config.kvCacheTypeV != KvCacheType::F16 && config.flashAttention == FlashAttention::Disabled)
+        log::warning("A quantized V cache requires flash attention; context creation will likely fail");
 
-    auto* ctx = llama_init_from_model(model, ctxParams);
+    // Each sequence gets a KV cache of its own, contextSize cells long.
+    auto const sequences = static_cast<uint32_t>(std::max(1, config.parallelSequences));
+    auto contextParams = ctxParams;
+    contextParams.n_ctx = ctxParams.n_ctx * sequences;
+    contextParams.n_seq_max = sequences;
+    contextParams.kv_unified = false;
+
+    auto* ctx = llama_init_from_model(model, contextParams);
     if (!ctx)
     {
         llama_model_free(model);
         return makeError(ErrorCode::ModelLoadError, "Failed to create llama context");
     }
 
+    _impl->releaseSampler();
+    _impl->releaseEmbeddings();
+    if (_impl->sharedContext)
+        _impl->sharedContext->releaseSequence(_impl->seq);
+    _impl->sharedContext =
+        std::make_shared<SharedContext>(ctx, sequences, logKvCacheFootprint(model, contextParams));
     _impl->model = model;
+    _impl->sharedModel = shareModel(model, std::filesystem::path(config.modelPath).filename().string());
+    _impl->threads = ctxParams.n_threads_batch;
     _impl->ctx = ctx;
+    _impl->seq = *_impl->sharedContext->acquireSequence();
+    _impl->contextParams = contextParams;
     _impl->ctxSize = config.contextSize;
+    _impl->fingerprint = computeFingerprint(model, config);
+    _impl->cachedTokens.clear();
+    _impl->promptCache.clear();
+    _impl->toolPreamble.clear();
+    _impl->toolPreambleBudget = static_cast<size_t>(std::max(0, config.toolPreambleTokenBudget));
+    _impl->contextShift = 0;
+
+    log::info("Model loaded successfully (context size: {}, batch: {}, ubatch: {}, sequences: {})",
+              config.contextSize,
+              llama_n_batch(ctx),
+              llama_n_ubatch(ctx),
+              sequences);
+
+    _impl->releaseDraft();
+    if (!config.draftModelPath.empty())
+        _impl->loadDraft(config, modelParams, ctxParams);
+    if (!_impl->draftCtx && config.promptLookup)
+    {
+        _impl->enablePromptLookup(static_cast<size_t>(std::max(1, config.promptLookupNgram)),
+                                  std::max(1, config.draftMaxTokens));
+        log::info("Prompt lookup decoding enabled ({}-grams, up to {} draft tokens per step)",
+                  _impl->promptLookup->ngramSize(),
+                  _impl->draftMaxTokens);
+    }
 
-    log::info("Model loaded successfully (context size: {})", config.contextSize);
     return {};
 }
 
-auto LlmEngine::generate(std::span<const ChatMessage> messages,
-                         std::span<const ToolDefinition> tools,
-                         const SamplerConfig& sampler,
-                         StreamCallback streamCb) -> Result<GenerateResult>
+auto LlmEngine::share() const -> Result<LlmEngine>
 {
     if (!isLoaded())
         return makeError(ErrorCode::InferenceError, "No model loaded");
 
-    // Build the prompt using llama_chat_apply_template
-    auto const* tmpl = llama_model_chat_template(_impl->model, nullptr);
-    auto chatTemplate = tmpl ? std::string(tmpl) : std::string("chatml");
+    // Take a free sequence of this context or of the contexts created when it was full.
+    auto context = _impl->sharedContext;
+    auto seq = context->acquireSequence();
+    for (auto next = context->overflow(); !seq && next; next = context->overflow())
+    {
+        context = std::move(next);
+        seq = context->acquireSequence();
+    }
+    if (!seq)
+    {
+        auto* ctx = llama_init_from_model(_impl->model, _impl->contextParams);
+        if (!ctx)
+            return makeError(ErrorCode::ModelLoadError, "Failed to create llama context");
+        auto created = std::make_shared<SharedContext>(
+            ctx, _impl->contextParams.n_seq_max, logKvCacheFootprint(_impl->model, _impl->contextParams));
+        context->setOverflow(created);
+        context = std::move(created);
+        seq = context->acquireSequence();
+    }
+
+    auto engine = LlmEngine();
+    auto& impl = *engine._impl;
+    impl.model = _impl->model;
+    impl.sharedModel = _impl->sharedModel;
+    impl.sharedContext = std::move(context);
+    impl.ctx = impl.sharedContext->context();
+    impl.seq = *seq;
+    impl.contextParams = _impl->contextParams;
+    impl.ctxSize = _impl->ctxSize;
+    impl.threads = _impl->threads;
+    impl.fingerprint = _impl->fingerprint;
+    impl.toolPreambleBudget = _impl->toolPreambleBudget;
+    impl.overflowPolicy = _impl->overflowPolicy;
+    if (_impl->promptLookup)
+        impl.enablePromptLookup(_impl->promptLookup->ngramSize(), _impl->draftMaxTokens);
+    return engine;
+}
+
+auto LlmEngine::shareEngine() const -> Result<std::unique_ptr<InferenceEngine>>
+{
+    auto engine = share();
+    if (!engine)
+        return std::unexpected(engine.error());
+    return std::make_unique<LlmEngine>(std::move(*engine));
+}
+
+auto LlmEngine::fork() const -> Result<LlmEngine>
+{
+    auto engine = share();
+    if (!engine)
+        return engine;
+
+    auto& impl = *engine->_impl;
+    if (_impl->copySequenceTo(impl))
+    {
+        impl.cachedTokens = _impl->cachedTokens;
+        impl.contextKeep = _impl->contextKeep;
+        impl.contextShift = _impl->contextShift;
+    }
+    else
+        log::warning("Failed to copy the KV cache to the forked engine; it starts empty");
+    return engine;
+}
+
+auto LlmEngine::generateAlternatives(std::span<const ChatMessage> messages,
+                                     std::span<const ToolDefinition> tools,
+                                     const SamplerConfig& sampler,
+                                     size_t count,
+                                     std::stop_token stopToken) -> Result<std::vector<GenerateResult>>
+{
+    if (count == 0)
+        return makeError(ErrorCode::InvalidArgument, "At least one alternative is required");
 
-    // Convert messages to llama_chat_message format
-    auto llamaMsgs = std::vector<llama_chat_message> {};
-    llamaMsgs.reserve(messages.size());
+    // Decode the shared prompt once; the forks then only decode the assistant header.
+    if (auto prefilled = prefill(messages, tools, stopToken);
+        !prefilled && prefilled.error().code != ErrorCode::Cancelled)
+        log::warning("Prefill for alternatives failed: {}", prefilled.error().message);
 
-    // We need to keep strings alive
-    auto roleStrings = std::vector<std::string> {};
-    roleStrings.reserve(messages.size());
+    auto forks = std::vector<LlmEngine> {};
+    for (auto i = size_t { 1 }; i < count; ++i)
+    {
+        auto forked = fork();
+        if (!forked)
+            return std::unexpected(forked.error());
+        forks.push_back(std::move(*forked));
+    }
 
-    for (const auto& msg: messages)
+    auto results = std::vector<Result<GenerateResult>>(count, makeError(ErrorCode::InferenceError, ""));
     {
-        roleStrings.emplace_back(roleToString(msg.role));
-        llamaMsgs.push_back(llama_chat_message {
-            .role = roleStrings.back().c_str(),
-            .content = msg.content.c_str(),
-        });
+        auto threads = std::vector<std::jthread> {};
+        for (auto i = size_t { 1 }; i < count; ++i)
+            threads.emplace_back([&, i] {
+                auto config = sampler;
+                if (config.seed >= 0)
+                    config.seed += static_cast<int>(i);
+                results[i] = forks[i - 1].generate(messages, tools, config, {}, {}, stopToken);
+            });
+        results[0] = generate(messages, tools, sampler, {}, {}, stopToken);
     }
 
-    // Apply the chat template
-    auto buf = std::vector<char>(static_cast<size_t>(_impl->ctxSize) * 4);
-    auto const len = llama_chat_apply_template(chatTemplate.c_str(),
-                                               llamaMsgs.data(),
-                                               llamaMsgs.size(),
-                                               true,
-                                               buf.data(),
-                                               static_cast<int32_t>(buf.size()));
+    auto alternatives = std::vector<GenerateResult> {};
+    for (auto& result: results)
+    {
+        if (!result)
+            return std::unexpected(result.error());
+        alternatives.push_back(std::move(*result));
+    }
+    return alternatives;
+}
+
+auto LlmEngine::generate(std::span<const ChatMessage> messages,
+                         std::span<const ToolDefinition> tools,
+                         const SamplerConfig& sampler,
+                         StreamCallback streamCb,
+                         ToolCallCallback toolCallCb,
+                         std::stop_token stopToken) -> Result<GenerateResult>
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+
+    auto const zone = trace::Zone("llm", "generate");
+    auto const startTime = Clock::now();
 
-    if (len < 0)
-        return makeError(ErrorCode::InferenceError, "Failed to apply chat template");
+    auto const toolKey = tools.empty() ? std::string {} : toolSetKey(tools);
+    if (auto applied = _impl->applyToolPreamble(tools, toolKey); !applied)
+        return std::unexpected(applied.error());
 
-    auto prompt = std::string(buf.data(), static_cast<size_t>(len));
+    // Build the prompt from cached per-message tokens; only new messages are rendered and tokenized.
+    auto promptTokens = _impl->promptCache.build(messages);
+    if (!promptTokens)
+        return std::unexpected(promptTokens.error());
+    auto const tokens = _impl->fitPrompt(messages, *promptTokens);
+    auto const nTokens = static_cast<int32_t>(tokens.size());
+    if (nTokens >= _impl->ctxSize)
+        return makeError(ErrorCode::InferenceError,
+                         std::format("Prompt of {} tokens exceeds context size {}", nTokens, _impl->ctxSize));
 
-    // Tokenize
     auto const vocabModel = llama_model_get_vocab(_impl->model);
-    auto tokens = std::vector<llama_token>(static_cast<size_t>(_impl->ctxSize));
-    auto const nTokens = llama_tokenize(vocabModel,
-                                        prompt.c_str(),
-                                        static_cast<int32_t>(prompt.size()),
-                                        tokens.data(),
-                                        static_cast<int32_t>(tokens.size()),
-                                        true,
-                                        true);
-
-    if (nTokens < 0)
-        return makeError(ErrorCode::InferenceError, "Tokenization failed");
-    tokens.resize(static_cast<size_t>(nTokens));
-
-    // Clear KV cache and decode the prompt
+
     auto* mem = llama_get_memory(_impl->ctx);
-    if (mem)
-        llama_memory_clear(mem, true);
+    auto& cached = _impl->cachedTokens;
 
-    auto batch = llama_batch_get_one(tokens.data(), nTokens);
-    if (llama_decode(_impl->ctx, batch) != 0)
+    auto const prefillStartTime = Clock::now();
+    auto synced = _impl->syncPrompt(tokens, stopToken);
+    if (!synced)
+    {
+        if (stopToken.stop_requested())
+        {
+            auto cancelled = GenerateResult {};
+            cancelled.cancelled = true;
+            return cancelled;
+        }
         return makeError(ErrorCode::InferenceError, "Failed to decode prompt");
+    }
+    auto const prefillEndTime = Clock::now();
+    auto const decodeZone = trace::Zone("llm", "decode");
 
-    // Set up sampler chain
-    auto* smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
-    llama_sampler_chain_add(smpl, llama_sampler_init_temp(sampler.temperature));
-    llama_sampler_chain_add(smpl, llama_sampler_init_top_k(sampler.topK));
-    llama_sampler_chain_add(smpl, llama_sampler_init_top_p(sampler.topP, 1));
-    llama_sampler_chain_add(
-        smpl,
-        llama_sampler_init_dist(sampler.seed < 0 ? LLAMA_DEFAULT_SEED : static_cast<uint32_t>(sampler.seed)));
+    auto* smpl = _impl->acquireSampler(sampler, tools, toolKey);
 
     // Generate tokens
     auto result = GenerateResult {};
-    auto const maxTokens = _impl->ctxSize - nTokens;
+    auto& metrics = result.metrics;
+    metrics.promptTokens = nTokens;
+    metrics.reusedTokens = static_cast<int>(synced->reused);
+    metrics.toolPreambleTokens = static_cast<int>(_impl->toolPreamble.tokenCount());
+    metrics.prefillMs = elapsedMs(prefillEndTime - prefillStartTime);
+    // With ShiftKv, the context is shifted whenever it fills up, so a single response is
+    // only bounded by one context's worth of tokens.
+    auto const shifting = _impl->overflowPolicy == ContextOverflowPolicy::ShiftKv;
+    auto const maxTokens = shifting ? _impl->ctxSize : _impl->ctxSize - nTokens;
+    auto generated = 0;
+    auto drafted = size_t { 0 };
+    auto accepted = size_t { 0 };
 
-    for (auto i = 0; i < maxTokens; ++i)
-    {
-        auto const newTokenId = llama_sampler_sample(smpl, _impl->ctx, -1);
-
-        if (llama_vocab_is_eog(vocabModel, newTokenId))
-            break;
+    // Tool-call markup is split off as it streams: it never reaches the stream callback,
+    // and each call is handed out as soon as its closing tag arrives.
+    auto& output = _impl->output;
+    output.begin(tools, static_cast<size_t>(std::min(maxTokens, MaxReservedTokens)) * ExpectedBytesPerToken);
 
+    auto firstTokenTime = Clock::time_point {};
+    auto lastMetricsReport = Clock::time_point {};
+    auto const emit = [&](llama_token token) {
         auto tokenBuf = std::array<char, 256> {};
         auto const tokenLen = llama_token_to_piece(
-            vocabModel, newTokenId, tokenBuf.data(), static_cast<int32_t>(tokenBuf.size()), 0, true);
-
+            vocabModel, token, tokenBuf.data(), static_cast<int32_t>(tokenBuf.size()), 0, true);
         if (tokenLen > 0)
         {
-            auto piece = std::string_view(tokenBuf.data(), static_cast<size_t>(tokenLen));
-            result.text += piece;
-            if (streamCb)
-                streamCb(piece);
+            auto const piece = std::string_view(tokenBuf.data(), static_cast<size_t>(tokenLen));
+            output.append(piece, streamCb, toolCallCb);
         }
+        ++generated;
 
-        // llama_batch_get_one requires non-const pointer
-        auto mutableTokenId = newTokenId;
-        auto singleTokenBatch = llama_batch_get_one(&mutableTokenId, 1);
-        if (llama_decode(_impl->ctx, singleTokenBatch) != 0)
+        if (_impl->metricsCallback)
         {
-            llama_sampler_free(smpl);
-            return makeError(ErrorCode::InferenceError, "Failed to decode generated token");
+            auto const now = Clock::now();
+            if (now - lastMetricsReport >= MetricsReportInterval)
+            {
+                metrics.generatedTokens = generated;
+                metrics.decodeMs = elapsedMs(now - firstTokenTime);
+                _impl->metricsCallback(metrics);
+                lastMetricsReport = now;
+            }
         }
+    };
+
+    auto const fail = [&](std::string_view message) -> Result<GenerateResult> {
+        _impl->dropSequence();
+        return makeError(ErrorCode::InferenceError, std::string(message));
+    };
+
+    // Whether the loop below decodes @p token next; announced to the scheduler along with the
+    // release of the logits, so the other sequences' next step waits for it.
+    auto const continues = [&](llama_token token) {
+        return generated < maxTokens && !llama_vocab_is_eog(vocabModel, token) && !stopToken.stop_requested();
+    };
+
+    auto pending = llama_sampler_sample(smpl, _impl->ctx, synced->logits.lastOutputIndex());
+    synced->logits.release(continues(pending));
+    firstTokenTime = Clock::now();
+    metrics.timeToFirstTokenMs = elapsedMs(firstTokenTime - startTime);
+    while (generated < maxTokens && !llama_vocab_is_eog(vocabModel, pending))
+    {
+        if (stopToken.stop_requested())
+        {
+            result.cancelled = true;
+            break;
+        }
+
+        emit(pending);
+
+        // Make room for the pending token and the draft proposals verified with it.
+        auto const needed = cached.size() + 1 + static_cast<size_t>(std::max(0, _impl->draftMaxTokens));
+        if (shifting && needed >= static_cast<size_t>(_impl->ctxSize))
+        {
+            auto const evictable = cached.size() - std::min(_impl->contextKeep, cached.size());
+            if (!_impl->shiftContext(evictable / 2))
+                return fail("Context is full and cannot be shifted");
+            _impl->contextShift += evictable / 2;
+        }
+
+        // Proposals come from the draft model or, failing that, from prompt lookup.
+        auto& drafts = _impl->draftScratch;
+        drafts.clear();
+        auto const draftBudget = std::min(_impl->draftMaxTokens, maxTokens - generated - 1);
+        if (mem && _impl->draftCtx)
+            _impl->proposeDrafts(cached, pending, draftBudget, drafts);
+        else if (mem && _impl->promptLookup && draftBudget > 0)
+            _impl->promptLookup->propose(cached, pending, static_cast<size_t>(draftBudget), drafts);
+
+        if (drafts.empty())
+        {
+            auto logits = _impl->decodeSequence(std::span(&pending, 1));
+            if (!logits)
+                return fail("Failed to decode generated token");
+            cached.push_back(pending);
+            pending = llama_sampler_sample(smpl, _impl->ctx, logits->lastOutputIndex());
+            logits->release(continues(pending));
+            continue;
+        }
+
+        // Speculative step: decode the pending token together with the draft proposals
+        // and keep the longest prefix of proposals that the main sampler agrees with.
+        // Every emitted token is still sampled from the main model, so the output
+        // distribution is unchanged.
+
+        auto& verifyTokens = _impl->verifyTokens;
+        verifyTokens.clear();
+        auto const basePos = static_cast<llama_pos>(cached.size());
+        verifyTokens.push_back(
+            { .token = pending, .position = basePos, .sequence = _impl->seq, .logits = true });
+        for (auto i = size_t { 0 }; i < drafts.size(); ++i)
+            verifyTokens.push_back({ .token = drafts[i],
+                                     .position = basePos + static_cast<llama_pos>(i + 1),
+                                     .sequence = _impl->seq,
+                                     .logits = true });
+
+        auto logits = _impl->sharedContext->scheduler().decode(verifyTokens);
+        if (!logits)
+            return fail("Failed to decode generated token");
+        cached.push_back(pending);
+        drafted += drafts.size();
+
+        // The accepted proposals are a prefix of drafts; they are emitted once the logits are
+        // released, so streaming them does not hold up the other sequences.
+        auto next = llama_token {};
+        auto agreed = size_t { 0 };
+        for (;; ++agreed)
+        {
+            next = llama_sampler_sample(smpl, _impl->ctx, logits->outputIndex(agreed));
+            if (agreed >= drafts.size() || next != drafts[agreed] || llama_vocab_is_eog(vocabModel, next))
+                break;
+        }
+        logits->release(continues(next));
+        for (auto const token: std::span(drafts).first(agreed))
+        {
+            emit(token);
+            cached.push_back(token);
+        }
+        accepted += agreed;
+
+        // Drop the rejected proposals from the main KV cache.
+        {
+            auto const context = _impl->sharedContext->scheduler().lock();
+            llama_memory_seq_rm(mem, _impl->seq, static_cast<llama_pos>(cached.size()), -1);
+        }
+        pending = next;
     }
 
-    llama_sampler_free(smpl);
+    if (drafted > 0)
+        log::info("Speculative decoding: {}/{} draft tokens accepted ({:.1f}%)",
+                  accepted,
+                  drafted,
+                  100.0 * static_cast<double>(accepted) / static_cast<double>(drafted));
+
+    output.finish(result, streamCb);
 
-    // Parse tool calls from the generated text if tools were provided
-    if (!tools.empty())
-        parseToolCalls(result, tools);
+    metrics.generatedTokens = generated;
+    metrics.decodeMs = elapsedMs(Clock::now() - firstTokenTime);
+    log::info("Generated {} tokens at {:.1f} tok/s (prompt {} tokens, {} reused, prefill {:.0f} ms, "
+              "first token after {:.0f} ms)",
+              metrics.generatedTokens,
+              metrics.decodeTokensPerSecond(),
+              metrics.promptTokens,
+              metrics.reusedTokens,
+              metrics.prefillMs,
+              metrics.timeToFirstTokenMs);
+    if (_impl->metricsCallback)
+        _impl->metricsCallback(metrics);
 
     return result;
 }
 
+void LlmEngine::setPrefillProgressCallback(PrefillProgressCallback callback)
+{
+    _impl->prefillCallback = std::move(callback);
+}
+
+void LlmEngine::setMetricsCallback(GenerateMetricsCallback callback)
+{
+    _impl->metricsCallback = std::move(callback);
+}
+
+void LlmEngine::setThreads(int decodeThreads, int batchThreads)
+{
+    if (!isLoaded())
+        return;
+
+    auto const decode = std::max(1, decodeThreads);
+    auto const batch = std::max(1, batchThreads);
+    {
+        auto const context = _impl->sharedContext->scheduler().lock();
+        llama_set_n_threads(_impl->ctx, decode, batch);
+    }
+    if (_impl->draftCtx)
+        llama_set_n_threads(_impl->draftCtx, decode, batch);
+    // Embedding decodes whole texts at once.
+    if (_impl->embedCtx)
+        llama_set_n_threads(_impl->embedCtx, batch, batch);
+    _impl->threads = static_cast<uint32_t>(batch);
+}
+
+auto LlmEngine::warmUp() -> VoidResult
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+
+    auto const zone = trace::Zone("llm", "warmUp");
+    auto token = llama_vocab_bos(llama_model_get_vocab(_impl->model));
+    if (token == LLAMA_TOKEN_NULL)
+        token = 0;
+    if (auto const decoded = _impl->decodeSequence(std::span(&token, 1)); !decoded)
+    {
+        _impl->dropSequence();
+        return std::unexpected(decoded.error());
+    }
+    // The logits were handed back when the lease went out of scope.
+    _impl->dropSequence();
+    return {};
+}
+
+auto LlmEngine::prefill(std::span<const ChatMessage> messages,
+                        std::span<const ToolDefinition> tools,
+                        std::stop_token stopToken) -> VoidResult
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+
+    if (auto applied = _impl->applyToolPreamble(tools, tools.empty() ? std::string {} : toolSetKey(tools));
+        !applied)
+        return applied;
+
+    auto promptTokens = _impl->promptCache.build(messages);
+    if (!promptTokens)
+        return std::unexpected(promptTokens.error());
+    if (static_cast<int>(promptTokens->size()) >= _impl->ctxSize)
+        return makeError(ErrorCode::InferenceError,
+                         std::format("Prompt of {} tokens exceeds context size {}",
+                                     promptTokens->size(),
+                                     _impl->ctxSize));
+
+    if (!_impl->syncPrompt(*promptTokens, stopToken))
+    {
+        if (stopToken.stop_requested())
+            return makeError(ErrorCode::Cancelled, "Prefill cancelled");
+        return makeError(ErrorCode::InferenceError, "Failed to decode prompt");
+    }
+    return {};
+}
+
+auto LlmEngine::saveState(const std::filesystem::path& path) const -> VoidResult
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+
+    auto ec = std::error_code {};
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Write to a temporary file first so a crash never leaves a truncated snapshot behind.
+    auto const tempPath = std::filesystem::path(path).concat(".tmp");
+    auto const& tokens = _impl->cachedTokens;
+    auto written = size_t { 0 };
+    {
+        auto const context = _impl->sharedContext->scheduler().lock();
+        written = llama_state_seq_save_file(
+            _impl->ctx, tempPath.string().c_str(), _impl->seq, tokens.data(), tokens.size());
+    }
+    if (written == 0)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return makeError(ErrorCode::InferenceError,
+                         std::format("Failed to save KV state to {}", path.string()));
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        return makeError(ErrorCode::InferenceError,
+                         std::format("Failed to save KV state to {}: {}", path.string(), ec.message()));
+
+    log::info("Saved KV state: {} tokens, {} KiB to {}", tokens.size(), written / 1024, path.string());
+    return {};
+}
+
+auto LlmEngine::loadState(const std::filesystem::path& path) -> Result<size_t>
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+
+    auto* mem = llama_get_memory(_impl->ctx);
+    auto& tokens = _impl->cachedTokens;
+    tokens.resize(static_cast<size_t>(_impl->ctxSize));
+    auto count = size_t { 0 };
+    auto read = size_t { 0 };
+    {
+        auto const context = _impl->sharedContext->scheduler().lock();
+        if (mem)
+            llama_memory_seq_rm(mem, _impl->seq, -1, -1);
+        read = llama_state_seq_load_file(
+            _impl->ctx, path.string().c_str(), _impl->seq, tokens.data(), tokens.size(), &count);
+    }
+    if (read == 0)
+    {
+        _impl->dropSequence();
+        return makeError(ErrorCode::InferenceError,
+                         std::format("Failed to load KV state from {}", path.string()));
+    }
+
+    tokens.resize(count);
+    _impl->contextShift = 0;
+    log::info("Restored KV state: {} tokens from {}", count, path.string());
+    return count;
+}
+
+auto LlmEngine::modelFingerprint() const -> const std::string&
+{
+    return _impl->fingerprint;
+}
+
+void LlmEngine::setContextOverflowPolicy(ContextOverflowPolicy policy)
+{
+    _impl->overflowPolicy = policy;
+}
+
+auto LlmEngine::promptTokenCount(std::span<const ChatMessage> messages,
+                                 std::span<const ToolDefinition> tools) -> Result<size_t>
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+    if (auto applied = _impl->applyToolPreamble(tools, tools.empty() ? std::string {} : toolSetKey(tools));
+        !applied)
+        return std::unexpected(applied.error());
+    auto tokens = _impl->promptCache.build(messages);
+    if (!tokens)
+        return std::unexpected(tokens.error());
+    return tokens->size();
+}
+
+auto LlmEngine::messageTokenCounts() const -> std::vector<size_t>
+{
+    return _impl->promptCache.messageTokenCounts();
+}
+
+auto LlmEngine::contextBudget() const -> size_t
+{
+    return static_cast<size_t>(_impl->ctxSize) - _impl->responseReserve();
+}
+
+auto LlmEngine::embed(std::string_view text) -> Result<std::vector<float>>
+{
+    if (!isLoaded())
+        return makeError(ErrorCode::InferenceError, "No model loaded");
+    return _impl->embed(text);
+}
+
 auto LlmEngine::isLoaded() const -> bool
 {
     return _impl->model != nullptr && _impl->ctx != nullptr;
@@ -3,12 +3,18 @@
 
 #include <core/Error.hpp>
 #include <core/Types.hpp>
+#include <llm/InferenceEngine.hpp>
 #include <llm/Sampler.hpp>
 
+#include <cstdint>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <span>
+#include <stop_token>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct llama_model;
@@ -17,8 +23,50 @@ struct llama_context;
 namespace mychat
 {
 
-/// @brief Callback invoked for each generated token during streaming.
-using StreamCallback = std::function<void(std::string_view token)>;
+/// @brief Callback invoked after each prefill chunk with the number of prompt tokens
+/// decoded so far and the total number of prompt tokens to decode.
+using PrefillProgressCallback = std::function<void(int decoded, int total)>;
+
+/// @brief Callback receiving live metrics of the running generation (about four times per
+/// second) and the final metrics once it ends.
+using GenerateMetricsCallback = std::function<void(const GenerateMetrics& metrics)>;
+
+/// @brief Storage type of the KV cache. Quantized types trade some accuracy for memory.
+enum class KvCacheType : std::uint8_t
+{
+    F16,
+    Q8_0,
+    Q4_0,
+};
+
+/// @brief Returns the configuration name of a KV cache type ("f16", "q8_0" or "q4_0").
+[[nodiscard]] constexpr auto kvCacheTypeName(KvCacheType type) -> std::string_view
+{
+    switch (type)
+    {
+        case KvCacheType::F16: return "f16";
+        case KvCacheType::Q8_0: return "q8_0";
+        case KvCacheType::Q4_0: return "q4_0";
+    }
+    return "f16";
+}
+
+/// @brief Parses a KV cache type name as returned by kvCacheTypeName().
+[[nodiscard]] constexpr auto parseKvCacheType(std::string_view name) -> std::optional<KvCacheType>
+{
+    for (auto const type: { KvCacheType::F16, KvCacheType::Q8_0, KvCacheType::Q4_0 })
+        if (kvCacheTypeName(type) == name)
+            return type;
+    return std::nullopt;
+}
+
+/// @brief Whether the context uses flash attention.
+enum class FlashAttention : std::uint8_t
+{
+    Auto, ///< Let llama.cpp decide based on the backend.
+    Enabled,
+    Disabled,
+};
 
 /// @brief Configuration for the LLM engine.
 struct LlmEngineConfig
@@ -27,14 +75,47 @@ struct LlmEngineConfig
     int contextSize = 8192;
     int gpuLayers = -1; // -1 means auto
     int threads = 0;    // 0 means auto
+    int batchSize = 0;  // Logical batch size (n_batch), 0 means llama.cpp default
+    int ubatchSize = 0; // Physical micro-batch size (n_ubatch), 0 means llama.cpp default
+
+    /// Threads for prompt prefill and other batches, 0 means the same as threads. Decoding one
+    /// token is bound by memory bandwidth, so it may need fewer threads than prefill.
+    int batchThreads = 0;
+
+    /// Number of sequences of the context, each with a KV cache of contextSize tokens. The
+    /// engines share() creates take the free ones and decode in steps batched with each other.
+    int parallelSequences = 1;
+
+    /// Optional path to a small draft model sharing the main model's vocabulary.
+    /// When set, generation uses speculative decoding.
+    std::string draftModelPath;
+    int draftMaxTokens = 8; ///< Maximum number of tokens proposed per step, see also promptLookup.
+
+    /// Speculative decoding without a draft model: proposes the tokens that followed the last
+    /// promptLookupNgram tokens where they occurred before in the context, e.g. in a tool result
+    /// the answer quotes (see PromptLookup). Needs no extra model or KV cache; ignored when a
+    /// draft model is loaded.
+    bool promptLookup = false;
+    int promptLookupNgram = 3;
+
+    KvCacheType kvCacheTypeK = KvCacheType::F16;
+    KvCacheType kvCacheTypeV = KvCacheType::F16; ///< Quantized V cache requires flash attention.
+    FlashAttention flashAttention = FlashAttention::Auto;
+    bool useMmap = true;    ///< Memory-map the model file instead of reading it.
+    bool useMlock = false;  ///< Lock the model in RAM so it cannot be swapped out.
+    bool offloadKqv = true; ///< Keep the KV cache and attention on the GPU with offloaded layers.
+
+    /// Maximum number of tokens the tool definitions may take up in the system prompt
+    /// (0 means unlimited). Larger tool sets are described more tersely to fit.
+    int toolPreambleTokenBudget = 2048;
 };
 
 /// @brief Wraps llama.cpp for LLM inference with streaming and tool call support.
-class LlmEngine
+class LlmEngine: public InferenceEngine
 {
   public:
     LlmEngine();
-    ~LlmEngine();
+    ~LlmEngine() override;
 
     LlmEngine(const LlmEngine&) = delete;
     LlmEngine& operator=(const LlmEngine&) = delete;
@@ -46,16 +127,142 @@ class LlmEngine
     /// @return Success or an error.
     [[nodiscard]] auto load(const LlmEngineConfig& config) -> VoidResult;
 
+    /// @brief Decodes one token and drops the KV cache again.
+    ///
+    /// Pages in the memory-mapped weights and lets the backend allocate its buffers, so the first
+    /// prompt after loading does not wait for either.
+    [[nodiscard]] auto warmUp() -> VoidResult;
+
+    /// @brief Creates another engine on the loaded model.
+    ///
+    /// The new engine takes a free sequence of this engine's context (see
+    /// LlmEngineConfig::parallelSequences), or a new context (with as many sequences) once all
+    /// are in use. The weights are shared, so each further engine only costs a KV cache, and
+    /// the engines may generate concurrently on different threads; engines on the same context
+    /// decode their tokens in shared batches, which costs little more time than decoding the
+    /// tokens of one of them. The draft model and the callbacks are not carried over; prompt
+    /// lookup is.
+    /// @return The new engine, or an error if a new context cannot be created.
+    [[nodiscard]] auto share() const -> Result<LlmEngine>;
+
+    /// @brief Creates another engine like share() that starts with this engine's KV cache.
+    ///
+    /// The cached conversation is copied rather than decoded again: within one context the two
+    /// sequences share the cells of the copy, otherwise the sequence state is transferred. A
+    /// fork continuing a branch of the conversation (see ChatSession::fork()) therefore only
+    /// decodes the messages after the branch point.
+    /// @return The new engine, or an error if a new context cannot be created.
+    [[nodiscard]] auto fork() const -> Result<LlmEngine>;
+
+    /// @brief Generates @p count alternative responses to the same conversation.
+    ///
+    /// The prompt is decoded once and forked for the other alternatives, which then generate
+    /// concurrently; on one context their tokens are decoded in shared batches. Alternatives
+    /// differ by their sampling seed (consecutive seeds from SamplerConfig::seed if it is set).
+    /// This engine generates the first alternative and keeps its KV cache.
+    /// @param messages The conversation history.
+    /// @param tools Available tool definitions (empty if none).
+    /// @param sampler Sampling configuration of the first alternative.
+    /// @param count Number of alternatives, at least one.
+    /// @param stopToken Stops all alternatives.
+    /// @return One result per alternative, or the first error.
+    [[nodiscard]] auto generateAlternatives(std::span<const ChatMessage> messages,
+                                            std::span<const ToolDefinition> tools,
+                                            const SamplerConfig& sampler,
+                                            size_t count,
+                                            std::stop_token stopToken = {})
+        -> Result<std::vector<GenerateResult>>;
+
     /// @brief Generates a response given conversation messages and available tools.
+    ///
+    /// The tools are described in a compact preamble appended to the system message.
     /// @param messages The conversation history.
     /// @param tools Available tool definitions (empty if none).
     /// @param sampler Sampling configuration.
-    /// @param streamCb Optional callback for streaming tokens.
+    /// @param streamCb Optional callback for streaming tokens. Tool-call markup is not streamed.
+    /// @param toolCallCb Optional callback receiving each tool call while generation continues.
+    ///                   All calls are also returned in GenerateResult::toolCalls.
+    /// @param stopToken Checked between decode steps; when stop is requested, generation ends
+    ///                  early and the partial result is returned with GenerateResult::cancelled set.
     /// @return The generation result containing text and/or tool calls.
     [[nodiscard]] auto generate(std::span<const ChatMessage> messages,
                                 std::span<const ToolDefinition> tools,
                                 const SamplerConfig& sampler,
-                                StreamCallback streamCb = {}) -> Result<GenerateResult>;
+                                StreamCallback streamCb = {},
+                                ToolCallCallback toolCallCb = {},
+                                std::stop_token stopToken = {}) -> Result<GenerateResult> override;
+
+    /// @brief Decodes the prompt for the given messages into the KV cache without generating.
+    ///
+    /// A following generate() whose prompt starts with these messages only decodes the rest.
+    /// @param messages The conversation prefix, e.g. only the system prompt.
+    /// @param tools The tools the following generate() calls will offer.
+    /// @param stopToken Aborts the prefill between batches, which then fails with ErrorCode::Cancelled.
+    [[nodiscard]] auto prefill(std::span<const ChatMessage> messages,
+                               std::span<const ToolDefinition> tools = {},
+                               std::stop_token stopToken = {}) -> VoidResult override;
+
+    /// @brief Saves the KV cache together with the token sequence it represents.
+    ///
+    /// Snapshots are only valid for the same model and KV cache types; include
+    /// modelFingerprint() in the file name to keep them apart.
+    /// @param path Destination file; parent directories are created as needed.
+    [[nodiscard]] auto saveState(const std::filesystem::path& path) const -> VoidResult;
+
+    /// @brief Replaces the KV cache with a snapshot written by saveState().
+    ///
+    /// The restored tokens take part in prefix reuse, so a following generate() only decodes
+    /// the part of its prompt that is not already in the snapshot.
+    /// @param path The snapshot file.
+    /// @return The number of restored tokens, or an error (the KV cache is empty then).
+    [[nodiscard]] auto loadState(const std::filesystem::path& path) -> Result<size_t>;
+
+    /// @brief Returns an identifier of the loaded model and KV cache layout (16 hex digits).
+    [[nodiscard]] auto modelFingerprint() const -> const std::string&;
+
+    /// @brief Selects how generate() handles conversations that outgrow the context window.
+    ///
+    /// With ShiftKv (the default), old tokens after the system prompt are discarded from the
+    /// KV cache and the rest is shifted down, both when a prompt does not fit and when the
+    /// context fills up during generation. With EvictHistory, prompts must fit (see
+    /// contextBudget()); the caller drops old messages, and generation stops at the end of the
+    /// context.
+    void setContextOverflowPolicy(ContextOverflowPolicy policy) override;
+
+    /// @brief Returns the number of tokens the prompt for @p messages and @p tools consists of.
+    [[nodiscard]] auto promptTokenCount(std::span<const ChatMessage> messages,
+                                        std::span<const ToolDefinition> tools = {})
+        -> Result<size_t> override;
+
+    /// @brief Returns the tokens each message of the prompt built last takes up.
+    [[nodiscard]] auto messageTokenCounts() const -> std::vector<size_t> override;
+
+    /// @brief Returns the maximum prompt size that still leaves room for a response.
+    [[nodiscard]] auto contextBudget() const -> size_t override;
+
+    /// @brief Computes an L2-normalized sentence embedding of @p text with the loaded model.
+    ///
+    /// Uses a separate embedding context (created on first use) with mean pooling, so the
+    /// chat KV cache is left untouched. Long texts are truncated to 512 tokens.
+    [[nodiscard]] auto embed(std::string_view text) -> Result<std::vector<float>> override;
+
+    /// @brief Returns an engine created by share().
+    [[nodiscard]] auto shareEngine() const -> Result<std::unique_ptr<InferenceEngine>> override;
+
+    /// @brief Changes the threads decoding runs on, e.g. when voice input starts to need cores.
+    ///
+    /// llama.cpp runs single-token decode steps on @p decodeThreads and prompt prefill, like
+    /// other batches, on @p batchThreads. The context is shared with the engines share() created;
+    /// call this between turns, not while this engine generates or embeds.
+    void setThreads(int decodeThreads, int batchThreads);
+
+    /// @brief Sets a callback that reports prompt prefill progress during generate().
+    /// @param callback The callback, or an empty function to disable reporting.
+    void setPrefillProgressCallback(PrefillProgressCallback callback);
+
+    /// @brief Sets a callback that reports generation metrics while tokens are decoded.
+    /// @param callback The callback, or an empty function to disable reporting.
+    void setMetricsCallback(GenerateMetricsCallback callback);
 
     /// @brief Returns true if a model is currently loaded.
     [[nodiscard]] auto isLoaded() const -> bool;
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ModelPool.hpp"
+
+#include <core/Log.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <system_error>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+    /// @brief Returns the size of the file at @p path, or 0 if it cannot be read.
+    auto fileBytes(std::string const& path) -> std::size_t
+    {
+        if (path.empty())
+            return 0;
+        auto ec = std::error_code {};
+        auto const size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : static_cast<std::size_t>(size);
+    }
+
+    auto loadEngine(LlmEngineConfig const& config) -> Result<std::unique_ptr<LlmEngine>>
+    {
+        auto engine = std::make_unique<LlmEngine>();
+        if (auto const loaded = engine->load(config); !loaded)
+            return std::unexpected(loaded.error());
+        if (auto const warmed = engine->warmUp(); !warmed)
+            log::warning("Warm-up of {} failed: {}", config.modelPath, warmed.error().message);
+        return engine;
+    }
+} // namespace
+
+auto modelStateName(ModelState state) noexcept -> std::string_view
+{
+    switch (state)
+    {
+        case ModelState::Unloaded: return "not loaded";
+        case ModelState::Loading: return "loading";
+        case ModelState::Resident: return "resident";
+        case ModelState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+ModelPool::ModelPool(std::size_t memoryBudget, ModelLoader loader):
+    _memoryBudget(memoryBudget), _loader(loader ? std::move(loader) : ModelLoader(loadEngine))
+{
+}
+
+ModelPool::~ModelPool()
+{
+    auto const lock = std::lock_guard(_mutex);
+    _stopping = true;
+}
+
+void ModelPool::add(std::string name, LlmEngineConfig config)
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto* entry = find(name);
+    if (!entry)
+    {
+        entry = _entries.emplace_back(std::make_unique<Entry>()).get();
+        entry->name = std::move(name);
+    }
+    entry->config = std::move(config);
+}
+
+auto ModelPool::names() const -> std::vector<std::string>
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto result = std::vector<std::string> {};
+    result.reserve(_entries.size());
+    for (auto const& entry: _entries)
+        result.push_back(entry->name);
+    return result;
+}
+
+auto ModelPool::contains(std::string_view name) const -> bool
+{
+    auto const lock = std::lock_guard(_mutex);
+    return find(name) != nullptr;
+}
+
+auto ModelPool::state(std::string_view name) const -> ModelState
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto const* entry = find(name);
+    return entry ? entry->state : ModelState::Unloaded;
+}
+
+void ModelPool::setLoadedCallback(ModelLoadedCallback callback)
+{
+    _loadedCallback = std::move(callback);
+}
+
+auto ModelPool::load(std::string_view name) -> VoidResult
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto* entry = find(name);
+    if (!entry)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown model: {}", name));
+    if (entry->state == ModelState::Unloaded || entry->state == ModelState::Failed)
+        startLoad(*entry);
+    return {};
+}
+
+auto ModelPool::acquire(std::string_view name) -> Result<LlmEngine*>
+{
+    auto lock = std::unique_lock(_mutex);
+    auto* entry = find(name);
+    if (!entry)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown model: {}", name));
+
+    // A failed model is tried again once; one that fails while we wait reports its error.
+    auto started = false;
+    while (true)
+    {
+        switch (entry->state)
+        {
+            case ModelState::Resident:
+                ++entry->holds;
+                entry->lastUsed = ++_useClock;
+                return entry->engine.get();
+            case ModelState::Failed:
+                if (started)
+                    return std::unexpected(*entry->error);
+                [[fallthrough]];
+            case ModelState::Unloaded:
+                if (_stopping)
+                    return makeError(ErrorCode::ModelLoadError, "The model pool is shutting down");
+                startLoad(*entry);
+                break;
+            case ModelState::Loading: break;
+        }
+        started = true;
+        _changed.wait(lock, [entry] { return entry->state != ModelState::Loading; });
+    }
+}
+
+void ModelPool::release(std::string_view name)
+{
+    auto const lock = std::lock_guard(_mutex);
+    if (auto* entry = find(name); entry && entry->holds > 0)
+        --entry->holds;
+}
+
+auto ModelPool::residentBytes() const -> std::size_t
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto total = std::size_t { 0 };
+    for (auto const& entry: _entries)
+        if (entry->state == ModelState::Resident)
+            total += entry->bytes;
+    return total;
+}
+
+auto ModelPool::find(std::string_view name) const -> Entry*
+{
+    auto const it =
+        std::ranges::find(_entries, name, [](auto const& entry) { return std::string_view(entry->name); });
+    return it != _entries.end() ? it->get() : nullptr;
+}
+
+void ModelPool::startLoad(Entry& entry)
+{
+    entry.state = ModelState::Loading;
+    entry.error.reset();
+    static_cast<void>(_loads.submit([this, &entry] { runLoad(entry); }));
+}
+
+void ModelPool::runLoad(Entry& entry)
+{
+    auto config = LlmEngineConfig {};
+    auto evicted = std::vector<std::unique_ptr<LlmEngine>> {};
+    {
+        auto const lock = std::lock_guard(_mutex);
+        if (_stopping)
+        {
+            entry.state = ModelState::Unloaded;
+            _changed.notify_all();
+            return;
+        }
+        config = entry.config;
+        entry.bytes = fileBytes(config.modelPath) + fileBytes(config.draftModelPath);
+        evictFor(entry, evicted);
+    }
+    // Unloads the evicted models before the new one takes their memory.
+    evicted.clear();
+
+    log::info("Loading model '{}'", entry.name);
+    auto engine = _loader(config);
+    auto result = VoidResult {};
+    {
+        auto const lock = std::lock_guard(_mutex);
+        if (engine)
+        {
+            entry.engine = std::move(*engine);
+            entry.state = ModelState::Resident;
+            entry.lastUsed = ++_useClock;
+        }
+        else
+        {
+            entry.state = ModelState::Failed;
+            entry.error = engine.error();
+            result = std::unexpected(engine.error());
+        }
+    }
+    _changed.notify_all();
+    if (_loadedCallback)
+        _loadedCallback(entry.name, result);
+}
+
+void ModelPool::evictFor(Entry const& entry, std::vector<std::unique_ptr<LlmEngine>>& evicted)
+{
+    if (_memoryBudget == 0)
+        return;
+
+    auto resident = std::size_t { 0 };
+    for (auto const& other: _entries)
+        if (other->state == ModelState::Resident)
+            resident += other->bytes;
+
+    while (resident + entry.bytes > _memoryBudget)
+    {
+        auto victim = _entries.end();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it)
+        {
+            auto const& other = **it;
+            if (other.state == ModelState::Resident && other.holds == 0
+                && (victim == _entries.end() || other.lastUsed < (*victim)->lastUsed))
+                victim = it;
+        }
+        if (victim == _entries.end())
+        {
+            log::warning("Loading model '{}' exceeds the model memory budget; the other models are in use",
+                         entry.name);
+            return;
+        }
+
+        auto& other = **victim;
+        log::info("Unloading model '{}' to make room for '{}'", other.name, entry.name);
+        resident -= other.bytes;
+        other.state = ModelState::Unloaded;
+        evicted.push_back(std::move(other.engine));
+    }
+}
+
+} // namespace mychat
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/WorkerPool.hpp>
+#include <llm/LlmEngine.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief How far a model of a ModelPool is loaded.
+enum class ModelState : std::uint8_t
+{
+    Unloaded,
+    Loading,
+    Resident,
+    Failed, ///< The last load failed; the next load() or acquire() tries again.
+};
+
+/// @brief Returns a display name for @p state, such as "resident".
+[[nodiscard]] auto modelStateName(ModelState state) noexcept -> std::string_view;
+
+/// @brief Creates an engine with the model of @p config loaded.
+using ModelLoader = std::function<Result<std::unique_ptr<LlmEngine>>(LlmEngineConfig const& config)>;
+
+/// @brief Called on the loading thread once a model has loaded, or failed to.
+using ModelLoadedCallback = std::function<void(std::string_view name, VoidResult const& result)>;
+
+/// @brief Keeps several named models loaded, so switching between them needs no reload.
+///
+/// Models load one at a time on a background thread and are warmed up there (see
+/// LlmEngine::warmUp()). The resident models are kept within a memory budget, measured by the
+/// size of their files: before a model loads, the least recently used ones that are not
+/// acquired are unloaded until it fits. Acquired models are never unloaded, so the budget may be
+/// exceeded while they are in use.
+class ModelPool
+{
+  public:
+    /// @param memoryBudget Bytes the files of the resident models may take up; 0 means no limit.
+    /// @param loader Creates the engines; the default loads them with LlmEngine::load().
+    explicit ModelPool(std::size_t memoryBudget = 0, ModelLoader loader = {});
+
+    /// @brief Waits for a running load; queued loads are skipped.
+    ~ModelPool();
+
+    ModelPool(ModelPool const&) = delete;
+    ModelPool& operator=(ModelPool const&) = delete;
+
+    /// @brief Adds the model @p name, or replaces its configuration for the next time it loads.
+    void add(std::string name, LlmEngineConfig config);
+
+    /// @brief Returns the names of the models, in the order they were added.
+    [[nodiscard]] auto names() const -> std::vector<std::string>;
+
+    /// @brief Returns whether a model named @p name was added.
+    [[nodiscard]] auto contains(std::string_view name) const -> bool;
+
+    /// @brief Returns the state of @p name, Unloaded for an unknown model.
+    [[nodiscard]] auto state(std::string_view name) const -> ModelState;
+
+    /// @brief Sets the function called whenever a load ends; must be set before the first load.
+    void setLoadedCallback(ModelLoadedCallback callback);
+
+    /// @brief Starts loading @p name in the background unless it is resident or loading already.
+    /// @return An error for an unknown model.
+    auto load(std::string_view name) -> VoidResult;
+
+    /// @brief Returns the engine of @p name, waiting for it to load, and keeps it loaded.
+    ///
+    /// The engine stays valid until as many release() calls as acquire() calls were made.
+    /// @return The engine, or the error of loading it.
+    [[nodiscard]] auto acquire(std::string_view name) -> Result<LlmEngine*>;
+
+    /// @brief Lets @p name be unloaded again, once per acquire().
+    void release(std::string_view name);
+
+    /// @brief Returns the bytes the files of the resident models take up.
+    [[nodiscard]] auto residentBytes() const -> std::size_t;
+
+  private:
+    struct Entry
+    {
+        std::string name;
+        LlmEngineConfig config;
+        std::unique_ptr<LlmEngine> engine;
+        ModelState state = ModelState::Unloaded;
+        std::optional<Error> error; ///< Why the last load failed.
+        std::size_t bytes = 0;      ///< Size of the model files, counted against the budget.
+        int holds = 0;              ///< Outstanding acquire() calls.
+        std::uint64_t lastUsed = 0; ///< When last acquired, on the scale of _useClock.
+    };
+
+    std::size_t _memoryBudget;
+    ModelLoader _loader;
+    ModelLoadedCallback _loadedCallback;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _changed; ///< Notified when a load ends.
+    std::vector<std::unique_ptr<Entry>> _entries;
+    std::uint64_t _useClock = 0;
+    bool _stopping = false;
+
+    WorkerPool _loads { 1 }; ///< Declared last so a running load ends before the entries die.
+
+    [[nodiscard]] auto find(std::string_view name) const -> Entry*;
+
+    /// @brief Queues the load of @p entry; the mutex must be held.
+    void startLoad(Entry& entry);
+
+    /// @brief Loads @p entry on the loading thread, making room for it first.
+    void runLoad(Entry& entry);
+
+    /// @brief Moves the engines out of the least recently used entries until @p entry fits the
+    ///        budget; the mutex must be held.
+    void evictFor(Entry const& entry, std::vector<std::unique_ptr<LlmEngine>>& evicted);
+};
+
+} // namespace mychat
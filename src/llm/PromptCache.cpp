@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "PromptCache.hpp"
+
+#include <core/Log.hpp>
+
+#include <utility>
+
+namespace mychat
+{
+
+PromptCache::PromptCache(RenderFn render, TokenizeFn tokenize):
+    _render(std::move(render)), _tokenize(std::move(tokenize))
+{
+}
+
+auto PromptCache::build(std::span<const ChatMessage> messages) -> Result<std::span<const TokenId>>
+{
+    // Find the first message that differs from the cached one.
+    auto valid = size_t { 0 };
+    while (valid < _entries.size() && valid < messages.size() && _entries[valid].role == messages[valid].role
+           && _entries[valid].content == messages[valid].content)
+        ++valid;
+    truncate(valid);
+    _hits += valid;
+
+    for (auto i = valid; i < messages.size(); ++i)
+    {
+        auto rendered = _render(messages.first(i + 1), false);
+        if (!rendered)
+            return std::unexpected(rendered.error());
+
+        if (!rendered->starts_with(_rendered))
+        {
+            log::debug("Chat template is not prefix-stable, tokenizing full prompt");
+            clear();
+            return buildUncached(messages);
+        }
+
+        auto const fragment = std::string_view(*rendered).substr(_rendered.size());
+        auto tokens = _tokenize(fragment, i == 0);
+        if (!tokens)
+            return std::unexpected(tokens.error());
+
+        _rendered.append(fragment);
+        _tokens.insert(_tokens.end(), tokens->begin(), tokens->end());
+        _entries.push_back(Entry {
+            .role = messages[i].role,
+            .content = messages[i].content,
+            .renderedEnd = _rendered.size(),
+            .tokenEnd = _tokens.size(),
+        });
+        ++_misses;
+    }
+
+    // The generation prompt only depends on the template, so derive it once from the
+    // last message alone instead of rendering the whole conversation twice.
+    if (!_hasGenerationPrompt && !messages.empty())
+    {
+        auto const last = messages.last(1);
+        auto withPrompt = _render(last, true);
+        if (!withPrompt)
+            return std::unexpected(withPrompt.error());
+        auto withoutPrompt = _render(last, false);
+        if (!withoutPrompt)
+            return std::unexpected(withoutPrompt.error());
+        if (withPrompt->starts_with(*withoutPrompt))
+        {
+            auto tokens = _tokenize(std::string_view(*withPrompt).substr(withoutPrompt->size()), false);
+            if (!tokens)
+                return std::unexpected(tokens.error());
+            _generationPrompt = std::move(*tokens);
+            _hasGenerationPrompt = true;
+        }
+        else
+        {
+            clear();
+            return buildUncached(messages);
+        }
+    }
+
+    _prompt.assign(_tokens.begin(), _tokens.end());
+    _prompt.insert(_prompt.end(), _generationPrompt.begin(), _generationPrompt.end());
+    return std::span<const TokenId>(_prompt);
+}
+
+void PromptCache::clear()
+{
+    truncate(0);
+    _generationPrompt.clear();
+    _hasGenerationPrompt = false;
+}
+
+auto PromptCache::cachedMessageCount() const noexcept -> size_t
+{
+    return _entries.size();
+}
+
+auto PromptCache::prefixTokenCount(size_t messageCount) const -> std::optional<size_t>
+{
+    if (messageCount == 0)
+        return 0;
+    if (messageCount > _entries.size())
+        return std::nullopt;
+    return _entries[messageCount - 1].tokenEnd;
+}
+
+auto PromptCache::messageTokenCounts() const -> std::vector<size_t>
+{
+    auto counts = std::vector<size_t> {};
+    counts.reserve(_entries.size());
+    auto begin = size_t { 0 };
+    for (auto const& entry: _entries)
+        counts.push_back(entry.tokenEnd - std::exchange(begin, entry.tokenEnd));
+    return counts;
+}
+
+void PromptCache::truncate(size_t count)
+{
+    if (count >= _entries.size())
+        return;
+    _entries.resize(count);
+    _rendered.resize(count > 0 ? _entries.back().renderedEnd : 0);
+    _tokens.resize(count > 0 ? _entries.back().tokenEnd : 0);
+}
+
+auto PromptCache::buildUncached(std::span<const ChatMessage> messages) -> Result<std::span<const TokenId>>
+{
+    auto rendered = _render(messages, true);
+    if (!rendered)
+        return std::unexpected(rendered.error());
+    auto tokens = _tokenize(*rendered, true);
+    if (!tokens)
+        return std::unexpected(tokens.error());
+    _misses += messages.size();
+    _prompt = std::move(*tokens);
+    return std::span<const TokenId>(_prompt);
+}
+
+} // namespace mychat
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Token identifier as used by the model vocabulary (matches llama_token).
+using TokenId = std::int32_t;
+
+/// @brief Incremental cache of rendered and tokenized chat messages.
+///
+/// Each message's chat-template fragment and its token IDs are computed once and
+/// reused on subsequent calls, so building the prompt for an agent step only costs
+/// work proportional to the messages that were added or changed since the last step.
+///
+/// A message's fragment is obtained by rendering the conversation up to and including
+/// that message and stripping the (cached) rendering of all preceding messages. Templates
+/// that are not prefix-stable (i.e. rendering older messages differently once newer ones
+/// exist) are detected and handled by falling back to a full render.
+class PromptCache
+{
+  public:
+    /// @brief Renders messages through the chat template.
+    /// The boolean requests that the assistant generation prompt be appended.
+    using RenderFn = std::function<Result<std::string>(std::span<const ChatMessage>, bool)>;
+
+    /// @brief Tokenizes text. The boolean requests that BOS/special prefix tokens be added.
+    using TokenizeFn = std::function<Result<std::vector<TokenId>>(std::string_view, bool)>;
+
+    /// @brief Constructs a PromptCache using the given rendering and tokenization functions.
+    PromptCache(RenderFn render, TokenizeFn tokenize);
+
+    /// @brief Returns the full prompt token sequence for the given conversation.
+    ///
+    /// The returned span stays valid until the next call to build() or clear().
+    /// @param messages The conversation, including the system prompt.
+    /// @return Token IDs of the rendered conversation followed by the generation prompt.
+    [[nodiscard]] auto build(std::span<const ChatMessage> messages) -> Result<std::span<const TokenId>>;
+
+    /// @brief Drops all cached messages.
+    void clear();
+
+    /// @brief Returns the number of messages currently cached.
+    [[nodiscard]] auto cachedMessageCount() const noexcept -> size_t;
+
+    /// @brief Returns the number of prompt tokens covering the first @p messageCount messages.
+    ///
+    /// Refers to the conversation passed to the last build() call.
+    /// @return The token count, or std::nullopt if those messages are not cached (e.g. after
+    ///         falling back to a full render for a non-prefix-stable template).
+    [[nodiscard]] auto prefixTokenCount(size_t messageCount) const -> std::optional<size_t>;
+
+    /// @brief Returns the prompt tokens each cached message takes up, in order.
+    ///
+    /// Refers to the conversation passed to the last build() call; empty after falling back to a
+    /// full render. The generation prompt is not included.
+    [[nodiscard]] auto messageTokenCounts() const -> std::vector<size_t>;
+
+    /// @brief Returns how many messages were served from cache across all build() calls.
+    [[nodiscard]] auto hits() const noexcept -> size_t { return _hits; }
+
+    /// @brief Returns how many messages had to be rendered and tokenized across all build() calls.
+    [[nodiscard]] auto misses() const noexcept -> size_t { return _misses; }
+
+  private:
+    /// @brief A cached message together with the extent of its fragment in the cumulative buffers.
+    struct Entry
+    {
+        Role role = Role::User;
+        std::string content;
+        size_t renderedEnd = 0; ///< End offset of this message's fragment in _rendered.
+        size_t tokenEnd = 0;    ///< End offset of this message's tokens in _tokens.
+    };
+
+    RenderFn _render;
+    TokenizeFn _tokenize;
+
+    std::vector<Entry> _entries;
+    std::string _rendered;        ///< Concatenated template fragments of all cached messages.
+    std::vector<TokenId> _tokens; ///< Concatenated tokens of all cached messages.
+
+    std::vector<TokenId> _generationPrompt; ///< Tokens of the assistant generation prompt.
+    bool _hasGenerationPrompt = false;
+
+    std::vector<TokenId> _prompt; ///< Scratch buffer holding the last built prompt.
+
+    size_t _hits = 0;
+    size_t _misses = 0;
+
+    /// @brief Truncates the cache to the first @p count entries.
+    void truncate(size_t count);
+
+    /// @brief Tokenizes a full render without caching, for non-prefix-stable templates.
+    [[nodiscard]] auto buildUncached(std::span<const ChatMessage> messages)
+        -> Result<std::span<const TokenId>>;
+};
+
+} // namespace mychat
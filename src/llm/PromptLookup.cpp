@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "PromptLookup.hpp"
+
+#include <algorithm>
+
+namespace mychat
+{
+
+PromptLookup::PromptLookup(size_t ngramSize): _ngramSize(std::max<size_t>(1, ngramSize))
+{
+}
+
+void PromptLookup::truncate(size_t count) noexcept
+{
+    _indexed = std::min(_indexed, count);
+}
+
+void PromptLookup::clear() noexcept
+{
+    _indexed = 0;
+    _ends.clear();
+}
+
+void PromptLookup::propose(std::span<const TokenId> context,
+                           TokenId last,
+                           size_t maxDrafts,
+                           std::vector<TokenId>& drafts)
+{
+    drafts.clear();
+    if (context.size() < _indexed)
+        _indexed = context.size();
+
+    // Later occurrences replace earlier ones, as recent text is the likelier to be repeated.
+    for (auto end = std::max(_indexed + 1, _ngramSize); end <= context.size(); ++end)
+        _ends[hash(context.subspan(end - _ngramSize, _ngramSize))] = static_cast<std::uint32_t>(end);
+    _indexed = context.size();
+
+    if (maxDrafts == 0 || context.size() + 1 < _ngramSize)
+        return;
+
+    // The tail to look up is the last n - 1 tokens of the context followed by the pending one.
+    auto const head = context.last(_ngramSize - 1);
+    _tail.assign(head.begin(), head.end());
+    _tail.push_back(last);
+    auto const found = _ends.find(hash(_tail));
+    if (found == _ends.end())
+        return;
+
+    auto const end = static_cast<size_t>(found->second);
+    if (end >= context.size() || !std::ranges::equal(context.subspan(end - _ngramSize, _ngramSize), _tail))
+        return;
+
+    auto const continuation = context.subspan(end, std::min(maxDrafts, context.size() - end));
+    drafts.assign(continuation.begin(), continuation.end());
+}
+
+auto PromptLookup::hash(std::span<const TokenId> ngram) const noexcept -> std::uint64_t
+{
+    // FNV-1a, a token at a time; collisions are caught by comparing the tokens.
+    auto value = std::uint64_t { 0xcbf29ce484222325 };
+    for (auto const token: ngram)
+    {
+        value ^= static_cast<std::uint32_t>(token);
+        value *= 0x100000001b3;
+    }
+    return value;
+}
+
+} // namespace mychat
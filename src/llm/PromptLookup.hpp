@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <llm/PromptCache.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Proposes draft tokens for speculative decoding by looking up n-grams in the context.
+///
+/// Answers often repeat parts of the context, such as file contents from a tool result or code
+/// from an earlier message. The context's n-grams are indexed by where they last occurred, and
+/// when the tail of the sequence matches one of them, the tokens that followed it there are
+/// proposed for the model to verify in one batch. This needs no draft model and only an index
+/// entry per context token.
+///
+/// Entries are checked against the context before they are used, so entries the context no
+/// longer matches, e.g. after a context shift, only cost a missed proposal.
+class PromptLookup
+{
+  public:
+    /// @param ngramSize Tokens that must match before a continuation is proposed; at least 1.
+    explicit PromptLookup(size_t ngramSize = 3);
+
+    /// @brief Returns the number of tokens that must match.
+    [[nodiscard]] auto ngramSize() const noexcept -> size_t { return _ngramSize; }
+
+    /// @brief Re-indexes the context from token @p count on, as it changed there.
+    void truncate(size_t count) noexcept;
+
+    /// @brief Drops the index.
+    void clear() noexcept;
+
+    /// @brief Proposes up to @p maxDrafts tokens to follow @p context and then @p last.
+    ///
+    /// Indexes the tokens of @p context that were added since the last call first.
+    /// @param drafts Receives the proposal; empty if the tail does not occur earlier.
+    void propose(std::span<const TokenId> context,
+                 TokenId last,
+                 size_t maxDrafts,
+                 std::vector<TokenId>& drafts);
+
+  private:
+    size_t _ngramSize;
+    size_t _indexed = 0; ///< The n-grams ending up to this position of the context are indexed.
+    std::unordered_map<std::uint64_t, std::uint32_t> _ends; ///< N-gram hash to where it last ended.
+    std::vector<TokenId> _tail;                              ///< The n-gram looked up.
+
+    [[nodiscard]] auto hash(std::span<const TokenId> ngram) const noexcept -> std::uint64_t;
+};
+
+} // namespace mychat
@@ -5,14 +5,34 @@ namespace mychat
 {
 
 /// @brief Configuration for LLM token sampling.
+///
+/// Samplers are applied in llama.cpp's usual order: repetition penalties, DRY, top-k,
+/// top-p, min-p, XTC, temperature and finally the random distribution.
 struct SamplerConfig
 {
     float temperature = 0.7f;
     float topP = 0.9f;
     int topK = 40;
-    float repeatPenalty = 1.1f;
-    int repeatLastN = 64;
+    float minP = 0.05f; ///< Minimum probability relative to the most likely token, 0 disables.
+
+    float repeatPenalty = 1.1f;   ///< Penalty for recently generated tokens, 1 disables.
+    int repeatLastN = 64;         ///< Number of recent tokens to penalize, -1 = whole context.
+    float frequencyPenalty = 0.f; ///< Penalty scaled by how often a token occurred, 0 disables.
+    float presencePenalty = 0.f;  ///< Penalty for any token that occurred, 0 disables.
+
+    /// DRY ("don't repeat yourself") penalizes extending sequences that already occurred.
+    float dryMultiplier = 0.f; ///< 0 disables DRY.
+    float dryBase = 1.75f;
+    int dryAllowedLength = 2; ///< Repeated sequences up to this length are not penalized.
+    int dryPenaltyLastN = -1; ///< Number of recent tokens to scan, -1 = whole context.
+
+    /// XTC ("exclude top choices") occasionally removes the most likely tokens for variety.
+    float xtcProbability = 0.f; ///< 0 disables XTC.
+    float xtcThreshold = 0.1f;
+
     int seed = -1; // -1 means random
+
+    auto operator==(const SamplerConfig&) const -> bool = default;
 };
 
 } // namespace mychat
@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "SessionStore.hpp"
+
+#include <core/MappedFile.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Identify session logs ("MCSL") and the index ("MCSI"), and their format version.
+    constexpr auto LogMagic = std::uint32_t { 0x4c53434d };
+    constexpr auto IndexMagic = std::uint32_t { 0x4953434d };
+    constexpr auto FormatVersion = std::uint32_t { 1 };
+
+    constexpr auto IndexFileName = "index.bin";
+
+    /// Longest session title, in bytes.
+    constexpr auto MaxTitleBytes = size_t { 60 };
+
+    /// Kinds of log records; loaders skip records of unknown kinds.
+    enum class RecordKind : std::uint32_t
+    {
+        Message = 1,
+        Truncate = 2,
+    };
+
+    template <typename T>
+    void putValue(std::string& out, T const& value)
+    {
+        out.append(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    void putString(std::string& out, std::string_view text)
+    {
+        putValue(out, static_cast<std::uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    /// @brief Appends a record of @p kind with @p payload to @p out.
+    void putRecord(std::string& out, RecordKind kind, std::string_view payload)
+    {
+        putValue(out, static_cast<std::uint32_t>(kind));
+        putString(out, payload);
+    }
+
+    auto encodeMessage(ChatMessage const& message) -> std::string
+    {
+        auto payload = std::string {};
+        putValue(payload, static_cast<std::uint32_t>(message.role));
+        putString(payload, message.content);
+        putString(payload, message.toolCallId);
+        putValue(payload, static_cast<std::uint32_t>(message.toolCalls.size()));
+        for (auto const& call: message.toolCalls)
+        {
+            putString(payload, call.id);
+            putString(payload, call.name);
+            putString(payload, call.arguments.dump());
+        }
+        return payload;
+    }
+
+    /// @brief Reads values from a byte range, failing once it is exhausted.
+    class Reader
+    {
+      public:
+        explicit Reader(std::span<const char> bytes): _bytes(bytes) {}
+
+        template <typename T>
+        [[nodiscard]] auto read(T& value) -> bool
+        {
+            if (_bytes.size() < sizeof(T))
+                return false;
+            std::memcpy(&value, _bytes.data(), sizeof(T));
+            _bytes = _bytes.subspan(sizeof(T));
+            return true;
+        }
+
+        [[nodiscard]] auto read(std::string_view& text) -> bool
+        {
+            auto size = std::uint32_t {};
+            if (!read(size) || _bytes.size() < size)
+                return false;
+            text = std::string_view(_bytes.data(), size);
+            _bytes = _bytes.subspan(size);
+            return true;
+        }
+
+        [[nodiscard]] auto read(std::string& text) -> bool
+        {
+            auto view = std::string_view {};
+            if (!read(view))
+                return false;
+            text.assign(view);
+            return true;
+        }
+
+        /// @brief Returns the number of bytes not read yet.
+        [[nodiscard]] auto remaining() const noexcept -> size_t { return _bytes.size(); }
+
+      private:
+        std::span<const char> _bytes;
+    };
+
+    auto decodeMessage(std::string_view payload) -> std::optional<ChatMessage>
+    {
+        auto reader = Reader(payload);
+        auto role = std::uint32_t {};
+        auto callCount = std::uint32_t {};
+        auto message = ChatMessage {};
+        if (!reader.read(role) || role > static_cast<std::uint32_t>(Role::Tool)
+            || !reader.read(message.content) || !reader.read(message.toolCallId) || !reader.read(callCount))
+            return std::nullopt;
+        message.role = static_cast<Role>(role);
+        for (auto i = std::uint32_t { 0 }; i < callCount; ++i)
+        {
+            auto call = ToolCall {};
+            auto arguments = std::string_view {};
+            if (!reader.read(call.id) || !reader.read(call.name) || !reader.read(arguments))
+                return std::nullopt;
+            call.arguments = nlohmann::json::parse(arguments, nullptr, false);
+            if (call.arguments.is_discarded())
+                call.arguments = nlohmann::json::object();
+            message.toolCalls.push_back(std::move(call));
+        }
+        return message;
+    }
+
+    /// @brief Returns the first line of @p text, cut to MaxTitleBytes on a UTF-8 boundary.
+    auto titleOf(std::string_view text) -> std::string
+    {
+        auto const start = text.find_first_not_of(" \t\r\n");
+        if (start == std::string_view::npos)
+            return {};
+        text = text.substr(start);
+        text = text.substr(0, text.find('\n'));
+        if (text.size() <= MaxTitleBytes)
+            return std::string(text);
+        auto cut = MaxTitleBytes;
+        while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80)
+            --cut;
+        return std::format("{}…", text.substr(0, cut));
+    }
+
+    auto toMilliseconds(std::chrono::system_clock::time_point time) -> std::int64_t
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    }
+
+    /// @brief Writes @p bytes to @p path through a temporary file, so readers never see a partial file.
+    auto replaceFile(std::filesystem::path const& path, std::string const& bytes) -> VoidResult
+    {
+        auto const tempPath = std::filesystem::path(path).concat(".tmp");
+        {
+            auto out = std::ofstream(tempPath, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!out)
+                return makeError(ErrorCode::IoError, std::format("Cannot write {}", tempPath.string()));
+        }
+        auto ec = std::error_code {};
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+            return makeError(ErrorCode::IoError,
+                             std::format("Cannot write {}: {}", path.string(), ec.message()));
+        return {};
+    }
+
+} // namespace
+
+SessionStore::SessionStore(std::filesystem::path directory): _directory(std::move(directory))
+{
+}
+
+auto SessionStore::create() -> Result<std::string>
+{
+    if (auto read = readIndex(); !read)
+        return std::unexpected(read.error());
+
+    auto ec = std::error_code {};
+    std::filesystem::create_directories(_directory, ec);
+    if (ec)
+        return makeError(ErrorCode::IoError,
+                         std::format("Cannot create session directory {}: {}",
+                                     _directory.string(),
+                                     ec.message()));
+
+    auto const now = std::chrono::system_clock::now();
+    auto const stamp = std::format("{:%Y%m%d-%H%M%S}", std::chrono::floor<std::chrono::seconds>(now));
+    auto id = stamp;
+    for (auto n = 2; find(id) || std::filesystem::exists(logPath(id)); ++n)
+        id = std::format("{}-{}", stamp, n);
+
+    auto header = std::string {};
+    putValue(header, LogMagic);
+    putValue(header, FormatVersion);
+    if (auto written = replaceFile(logPath(id), header); !written)
+        return std::unexpected(written.error());
+    _logEnds[id] = header.size();
+
+    _index.push_back(SessionInfo {
+        .id = id,
+        .title = {},
+        .messageCount = 0,
+        .updated = now,
+        .stateSnapshot = {},
+    });
+    if (auto written = writeIndex(); !written)
+        return std::unexpected(written.error());
+    return id;
+}
+
+auto SessionStore::append(std::string_view id, std::span<const ChatMessage> messages) -> VoidResult
+{
+    if (auto read = readIndex(); !read)
+        return read;
+    auto* info = find(id);
+    if (!info)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown session {}", id));
+
+    auto records = std::string {};
+    auto messageCount = info->messageCount;
+    auto title = info->title;
+    for (auto const& message: messages)
+    {
+        if (message.role == Role::System)
+            continue;
+        putRecord(records, RecordKind::Message, encodeMessage(message));
+        ++messageCount;
+        if (title.empty() && message.role == Role::User)
+            title = titleOf(message.content);
+    }
+    if (records.empty())
+        return {};
+    if (auto appended = appendRecords(id, records); !appended)
+        return appended;
+    info->messageCount = messageCount;
+    info->title = std::move(title);
+    info->updated = std::chrono::system_clock::now();
+    return writeIndex();
+}
+
+auto SessionStore::truncate(std::string_view id, size_t messageCount) -> VoidResult
+{
+    if (auto read = readIndex(); !read)
+        return read;
+    auto* info = find(id);
+    if (!info)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown session {}", id));
+    if (messageCount >= info->messageCount)
+        return {};
+
+    auto payload = std::string {};
+    putValue(payload, static_cast<std::uint64_t>(messageCount));
+    auto records = std::string {};
+    putRecord(records, RecordKind::Truncate, payload);
+    if (auto appended = appendRecords(id, records); !appended)
+        return appended;
+    info->messageCount = messageCount;
+    info->updated = std::chrono::system_clock::now();
+    return writeIndex();
+}
+
+auto SessionStore::setStateSnapshot(std::string_view id, std::filesystem::path path) -> VoidResult
+{
+    if (auto read = readIndex(); !read)
+        return read;
+    auto* info = find(id);
+    if (!info)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown session {}", id));
+    if (info->stateSnapshot == path)
+        return {};
+    info->stateSnapshot = std::move(path);
+    return writeIndex();
+}
+
+auto SessionStore::load(std::string_view id) const -> Result<std::vector<ChatMessage>>
+{
+    auto const path = logPath(id);
+    auto file = MappedFile {};
+    if (!file.open(path))
+        return makeError(ErrorCode::IoError, std::format("Cannot open session log {}", path.string()));
+
+    auto reader = Reader(file.bytes());
+    auto magic = std::uint32_t {};
+    auto version = std::uint32_t {};
+    if (!reader.read(magic) || !reader.read(version) || magic != LogMagic || version != FormatVersion)
+        return makeError(ErrorCode::IoError, std::format("Not a session log: {}", path.string()));
+
+    // A record cut short by a crash ends the log; appendRecords() cuts it off before appending.
+    auto const size = file.bytes().size();
+    auto end = size - reader.remaining();
+    auto messages = std::vector<ChatMessage> {};
+    auto kind = std::uint32_t {};
+    auto payload = std::string_view {};
+    while (reader.read(kind) && reader.read(payload))
+    {
+        if (kind == static_cast<std::uint32_t>(RecordKind::Message))
+        {
+            auto message = decodeMessage(payload);
+            if (!message)
+                break;
+            messages.push_back(std::move(*message));
+        }
+        else if (kind == static_cast<std::uint32_t>(RecordKind::Truncate))
+        {
+            auto count = std::uint64_t {};
+            if (!Reader(payload).read(count))
+                break;
+            if (count < messages.size())
+                messages.resize(static_cast<size_t>(count));
+        }
+        end = size - reader.remaining();
+    }
+    _logEnds[std::string(id)] = end;
+    return messages;
+}
+
+auto SessionStore::list() const -> Result<std::vector<SessionInfo>>
+{
+    if (auto read = readIndex(); !read)
+        return std::unexpected(read.error());
+    auto sessions = _index;
+    std::ranges::stable_sort(sessions, std::ranges::greater {}, &SessionInfo::updated);
+    return sessions;
+}
+
+auto SessionStore::logPath(std::string_view id) const -> std::filesystem::path
+{
+    return _directory / std::format("{}.log", id);
+}
+
+auto SessionStore::readIndex() const -> VoidResult
+{
+    if (_indexLoaded)
+        return {};
+
+    auto const path = _directory / IndexFileName;
+    auto file = MappedFile {};
+    if (!std::filesystem::exists(path))
+    {
+        _indexLoaded = true;
+        return {};
+    }
+    if (!file.open(path))
+        return makeError(ErrorCode::IoError, std::format("Cannot open session index {}", path.string()));
+
+    auto reader = Reader(file.bytes());
+    auto magic = std::uint32_t {};
+    auto version = std::uint32_t {};
+    auto count = std::uint32_t {};
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(count) || magic != IndexMagic
+        || version != FormatVersion)
+        return makeError(ErrorCode::IoError, std::format("Not a session index: {}", path.string()));
+
+    auto index = std::vector<SessionInfo> {};
+    for (auto i = std::uint32_t { 0 }; i < count; ++i)
+    {
+        auto info = SessionInfo {};
+        auto messageCount = std::uint64_t {};
+        auto updated = std::int64_t {};
+        auto snapshot = std::string {};
+        if (!reader.read(info.id) || !reader.read(info.title) || !reader.read(messageCount)
+            || !reader.read(updated) || !reader.read(snapshot))
+            return makeError(ErrorCode::IoError, std::format("Truncated session index: {}", path.string()));
+        info.messageCount = static_cast<size_t>(messageCount);
+        info.updated = std::chrono::system_clock::time_point(std::chrono::milliseconds(updated));
+        info.stateSnapshot = snapshot;
+        index.push_back(std::move(info));
+    }
+    _index = std::move(index);
+    _indexLoaded = true;
+    return {};
+}
+
+auto SessionStore::writeIndex() const -> VoidResult
+{
+    auto bytes = std::string {};
+    putValue(bytes, IndexMagic);
+    putValue(bytes, FormatVersion);
+    putValue(bytes, static_cast<std::uint32_t>(_index.size()));
+    for (auto const& info: _index)
+    {
+        putString(bytes, info.id);
+        putString(bytes, info.title);
+        putValue(bytes, static_cast<std::uint64_t>(info.messageCount));
+        putValue(bytes, toMilliseconds(info.updated));
+        putString(bytes, info.stateSnapshot.string());
+    }
+    return replaceFile(_directory / IndexFileName, bytes);
+}
+
+auto SessionStore::find(std::string_view id) const -> SessionInfo*
+{
+    auto const it = std::ranges::find(_index, id, &SessionInfo::id);
+    return it == _index.end() ? nullptr : &*it;
+}
+
+auto SessionStore::appendRecords(std::string_view id, std::string const& records) -> VoidResult
+{
+    auto const path = logPath(id);
+    if (!std::filesystem::exists(path))
+        return makeError(ErrorCode::IoError, std::format("Session log {} is missing", path.string()));
+
+    // Records behind a torn one would never be read, so the log is cut back to its valid records.
+    auto ec = std::error_code {};
+    auto const size = std::filesystem::file_size(path, ec);
+    auto known = _logEnds.find(std::string(id));
+    if (known == _logEnds.end() || size < known->second)
+    {
+        if (auto loaded = load(id); !loaded)
+            return std::unexpected(loaded.error());
+        known = _logEnds.find(std::string(id));
+    }
+    if (size != known->second)
+    {
+        std::filesystem::resize_file(path, known->second, ec);
+        if (ec)
+            return makeError(ErrorCode::IoError,
+                             std::format("Cannot repair session log {}: {}", path.string(), ec.message()));
+    }
+
+    auto out = std::ofstream(path, std::ios::binary | std::ios::app);
+    out.write(records.data(), static_cast<std::streamsize>(records.size()));
+    out.flush();
+    if (!out)
+    {
+        // The bytes that did reach the file are cut off again before the next append.
+        _logEnds.erase(known);
+        return makeError(ErrorCode::IoError, std::format("Cannot append to session log {}", path.string()));
+    }
+    known->second += records.size();
+    return {};
+}
+
+} // namespace mychat
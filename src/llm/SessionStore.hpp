@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Summary of a stored conversation, as kept in the store's index.
+struct SessionInfo
+{
+    std::string id;
+    std::string title;       ///< The start of the first user message.
+    size_t messageCount = 0; ///< Messages of the conversation, excluding the system prompt.
+    std::chrono::system_clock::time_point updated;
+    std::filesystem::path stateSnapshot; ///< KV-cache snapshot of the conversation's prefix, if any.
+};
+
+/// @brief Persists conversations across restarts.
+///
+/// Each session is an append-only binary log (`<id>.log`) of message records: role, content,
+/// tool-call id and tool calls, each string stored as a length-prefixed blob. Changes to the
+/// conversation such as a regenerated reply are appended as truncation records, so nothing is
+/// ever rewritten, and a record cut short by a crash is ignored on load and cut off before the
+/// next append. Logs are memory-mapped for reading. A small index (`index.bin`) holds a SessionInfo per session, so listing the
+/// sessions never reads a log. Not thread-safe.
+class SessionStore
+{
+  public:
+    /// @brief Opens the store in @p directory, which is created on the first write.
+    explicit SessionStore(std::filesystem::path directory);
+
+    /// @brief Returns the store's directory.
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path& { return _directory; }
+
+    /// @brief Starts a new, empty session.
+    /// @return The session's id, derived from the current time.
+    [[nodiscard]] auto create() -> Result<std::string>;
+
+    /// @brief Appends @p messages to the session @p id. System messages are skipped.
+    [[nodiscard]] auto append(std::string_view id, std::span<const ChatMessage> messages) -> VoidResult;
+
+    /// @brief Drops all but the first @p messageCount messages of the session @p id.
+    [[nodiscard]] auto truncate(std::string_view id, size_t messageCount) -> VoidResult;
+
+    /// @brief Associates a KV-cache snapshot (see LlmEngine::saveState()) with the session @p id.
+    [[nodiscard]] auto setStateSnapshot(std::string_view id, std::filesystem::path path) -> VoidResult;
+
+    /// @brief Reads the messages of the session @p id, excluding the system prompt.
+    [[nodiscard]] auto load(std::string_view id) const -> Result<std::vector<ChatMessage>>;
+
+    /// @brief Returns the stored sessions, most recently updated first, read from the index only.
+    [[nodiscard]] auto list() const -> Result<std::vector<SessionInfo>>;
+
+  private:
+    std::filesystem::path _directory;
+    mutable std::vector<SessionInfo> _index;
+    mutable bool _indexLoaded = false;
+    /// Length of each log up to the end of its last complete record, once read or written.
+    mutable std::unordered_map<std::string, std::uint64_t> _logEnds;
+
+    [[nodiscard]] auto logPath(std::string_view id) const -> std::filesystem::path;
+    [[nodiscard]] auto readIndex() const -> VoidResult;
+    [[nodiscard]] auto writeIndex() const -> VoidResult;
+    [[nodiscard]] auto find(std::string_view id) const -> SessionInfo*;
+    /// @brief Appends @p records to the log of @p id, first cutting off a record torn by a crash.
+    [[nodiscard]] auto appendRecords(std::string_view id, std::string const& records) -> VoidResult;
+};
+
+} // namespace mychat
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ToolCallParser.hpp"
+#include "ToolGrammar.hpp"
+
+#include <core/Log.hpp>
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// @brief Returns the length of the longest suffix of @p text that is a proper prefix of @p tag.
+    auto partialTagLength(std::string_view text, std::string_view tag) -> size_t
+    {
+        for (auto len = std::min(text.size(), tag.size() - 1); len > 0; --len)
+        {
+            if (text.ends_with(tag.substr(0, len)))
+                return len;
+        }
+        return 0;
+    }
+
+} // namespace
+
+ToolCallParser::ToolCallParser(std::span<const ToolDefinition> tools): _tools(tools)
+{
+}
+
+auto ToolCallParser::feed(std::string_view piece, std::string& visible) -> size_t
+{
+    _pending += piece;
+    auto completed = size_t { 0 };
+
+    while (true)
+    {
+        if (!_inCall)
+        {
+            auto const open = _pending.find(ToolCallOpenTag);
+            if (open == std::string::npos)
+            {
+                auto const held = partialTagLength(_pending, ToolCallOpenTag);
+                visible.append(_pending, 0, _pending.size() - held);
+                _pending.erase(0, _pending.size() - held);
+                break;
+            }
+            visible.append(_pending, 0, open);
+            _pending.erase(0, open + ToolCallOpenTag.size());
+            _inCall = true;
+        }
+
+        auto const close = _pending.find(ToolCallCloseTag);
+        if (close == std::string::npos)
+            break;
+
+        if (addCall(std::string_view(_pending).substr(0, close)))
+            ++completed;
+        _pending.erase(0, close + ToolCallCloseTag.size());
+        _inCall = false;
+    }
+
+    return completed;
+}
+
+void ToolCallParser::finish(std::string& visible)
+{
+    if (_inCall)
+        visible += ToolCallOpenTag;
+    visible += _pending;
+    _pending.clear();
+    _inCall = false;
+}
+
+auto ToolCallParser::takeCalls() -> std::vector<ToolCall>
+{
+    return std::exchange(_calls, {});
+}
+
+auto ToolCallParser::addCall(std::string_view payload) -> bool
+{
+    ++_blockCount;
+    try
+    {
+        auto const json = nlohmann::json::parse(payload);
+        auto call = ToolCall {
+            .id = std::format("call_{}", _calls.size()),
+            .name = json.value("name", ""),
+            .arguments = json.value("arguments", nlohmann::json::object()),
+        };
+
+        if (!std::ranges::any_of(_tools, [&](const auto& t) { return t.name == call.name; }))
+        {
+            log::warning("Ignoring call to unknown tool '{}'", call.name);
+            return false;
+        }
+        _calls.push_back(std::move(call));
+        return true;
+    }
+    catch (...)
+    {
+        log::warning("Ignoring malformed tool call #{}", _blockCount);
+        return false;
+    }
+}
+
+} // namespace mychat
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Types.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Incremental parser separating `<tool_call>` blocks from streamed model output.
+///
+/// Pieces of generated text are fed as they are sampled. Text outside tool-call blocks is
+/// passed through for display, except for a trailing fragment that might be the start of
+/// an opening tag, which is held back until it can be decided. Each block is parsed as
+/// soon as its closing tag arrives, so callers can act on a call while the model is still
+/// generating the next one.
+class ToolCallParser
+{
+  public:
+    /// @brief Constructs a parser accepting calls to the given tools.
+    /// @param tools Known tools; calls to other names are dropped. Must outlive the parser.
+    explicit ToolCallParser(std::span<const ToolDefinition> tools);
+
+    /// @brief Feeds a piece of generated text.
+    /// @param piece The text to append.
+    /// @param visible Receives (appended) the text that is safe to display.
+    /// @return The number of tool calls completed by this piece.
+    auto feed(std::string_view piece, std::string& visible) -> size_t;
+
+    /// @brief Ends the stream, releasing held-back text.
+    ///
+    /// An unterminated tool-call block is released verbatim, including its opening tag.
+    /// @param visible Receives (appended) the remaining displayable text.
+    void finish(std::string& visible);
+
+    /// @brief Returns true while inside an unterminated tool-call block.
+    [[nodiscard]] auto insideToolCall() const noexcept -> bool { return _inCall; }
+
+    /// @brief Returns all tool calls completed so far, in order of appearance.
+    [[nodiscard]] auto calls() const noexcept -> const std::vector<ToolCall>& { return _calls; }
+
+    /// @brief Moves the completed tool calls out of the parser.
+    [[nodiscard]] auto takeCalls() -> std::vector<ToolCall>;
+
+  private:
+    std::span<const ToolDefinition> _tools;
+    std::vector<ToolCall> _calls;
+    std::string _pending; ///< Held-back text, or the payload of the current tool call.
+    size_t _blockCount = 0;
+    bool _inCall = false;
+
+    /// @brief Parses a complete payload and records the call if it is valid.
+    /// @return True if a call was recorded.
+    auto addCall(std::string_view payload) -> bool;
+};
+
+} // namespace mychat
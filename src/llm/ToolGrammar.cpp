@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ToolGrammar.hpp"
+
+#include <format>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// @brief Primitive rules shared by all schemas (JSON value grammar).
+    constexpr auto PrimitiveRules = std::string_view {
+        R"(ws ::= [ \t\n]{0,20}
+string ::= "\"" ( [^"\\\x7F\x00-\x1F] | "\\" ( ["\\/bfnrt] | "u" [0-9a-fA-F]{4} ) )* "\""
+number ::= "-"? ( "0" | [1-9] [0-9]{0,15} ) ( "." [0-9]+ )? ( [eE] [-+]? [0-9]+ )?
+integer ::= "-"? ( "0" | [1-9] [0-9]{0,15} )
+boolean ::= "true" | "false"
+null ::= "null"
+value ::= object | array | string | number | boolean | null
+object ::= "{" ws ( string ws ":" ws value ( ws "," ws string ws ":" ws value )* )? ws "}"
+array ::= "[" ws ( value ( ws "," ws value )* )? ws "]"
+)"
+    };
+
+    /// @brief Quotes text as a GBNF string literal.
+    auto gbnfLiteral(std::string_view text) -> std::string
+    {
+        auto out = std::string { "\"" };
+        for (auto const c: text)
+        {
+            switch (c)
+            {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default: out += c; break;
+            }
+        }
+        out += '"';
+        return out;
+    }
+
+    /// @brief GBNF literal matching the JSON encoding of a value (e.g. a quoted key).
+    auto jsonLiteral(nlohmann::json const& value) -> std::string
+    {
+        return gbnfLiteral(value.dump());
+    }
+
+    /// @brief Turns an arbitrary name into a valid GBNF rule name fragment.
+    auto sanitizeRuleName(std::string_view name) -> std::string
+    {
+        auto out = std::string {};
+        for (auto const c: name)
+        {
+            auto const alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+            out += alnum ? c : '-';
+        }
+        return out;
+    }
+
+    /// @brief Returns the schema's "type", picking the first non-null entry of a type array.
+    auto schemaType(nlohmann::json const& schema) -> std::string
+    {
+        auto const it = schema.find("type");
+        if (it == schema.end())
+            return schema.contains("properties") ? "object" : std::string {};
+        if (it->is_string())
+            return it->get<std::string>();
+        if (it->is_array())
+            for (auto const& t: *it)
+                if (t.is_string() && t.get<std::string>() != "null")
+                    return t.get<std::string>();
+        return {};
+    }
+
+} // namespace
+
+void appendSchemaRules(nlohmann::json const& schema, std::string const& ruleName, std::string& rules)
+{
+    if (!schema.is_object())
+    {
+        rules += std::format("{} ::= value\n", ruleName);
+        return;
+    }
+
+    if (auto const it = schema.find("enum"); it != schema.end() && it->is_array() && !it->empty())
+    {
+        auto alternatives = std::string {};
+        for (auto const& option: *it)
+        {
+            if (!alternatives.empty())
+                alternatives += " | ";
+            alternatives += jsonLiteral(option);
+        }
+        rules += std::format("{} ::= {}\n", ruleName, alternatives);
+        return;
+    }
+
+    auto const type = schemaType(schema);
+
+    if (type == "string" || type == "number" || type == "integer" || type == "boolean" || type == "null")
+    {
+        rules += std::format("{} ::= {}\n", ruleName, type);
+        return;
+    }
+
+    if (type == "array")
+    {
+        auto const items = schema.find("items");
+        if (items == schema.end())
+        {
+            rules += std::format("{} ::= array\n", ruleName);
+            return;
+        }
+        auto const itemRule = ruleName + "-item";
+        appendSchemaRules(*items, itemRule, rules);
+        rules += std::format(
+            "{0} ::= \"[\" ws ( {1} ( ws \",\" ws {1} )* )? ws \"]\"\n", ruleName, itemRule);
+        return;
+    }
+
+    auto const properties = schema.find("properties");
+    if (type != "object" || properties == schema.end() || !properties->is_object() || properties->empty())
+    {
+        rules += std::format("{} ::= {}\n", ruleName, type == "object" ? "object" : "value");
+        return;
+    }
+
+    auto isRequired = [&](std::string const& key) {
+        auto const required = schema.find("required");
+        if (required == schema.end() || !required->is_array())
+            return false;
+        for (auto const& r: *required)
+            if (r.is_string() && r.get<std::string>() == key)
+                return true;
+        return false;
+    };
+
+    // Required properties appear in key order; optional ones may follow in any order.
+    auto requiredPart = std::string {};
+    auto optionalAlternatives = std::string {};
+    for (auto const& [key, propSchema]: properties->items())
+    {
+        auto const valueRule = std::format("{}-{}", ruleName, sanitizeRuleName(key));
+        appendSchemaRules(propSchema, valueRule, rules);
+        auto const pair = std::format("{} ws \":\" ws {}", jsonLiteral(key), valueRule);
+
+        if (isRequired(key))
+        {
+            if (!requiredPart.empty())
+                requiredPart += " ws \",\" ws ";
+            requiredPart += pair;
+        }
+        else
+        {
+            if (!optionalAlternatives.empty())
+                optionalAlternatives += " | ";
+            optionalAlternatives += "( " + pair + " )";
+        }
+    }
+
+    if (optionalAlternatives.empty())
+    {
+        rules += std::format("{} ::= \"{{\" ws {} ws \"}}\"\n", ruleName, requiredPart);
+        return;
+    }
+
+    auto const optionalRule = ruleName + "-opt";
+    rules += std::format("{} ::= {}\n", optionalRule, optionalAlternatives);
+
+    if (requiredPart.empty())
+        rules += std::format(
+            "{0} ::= \"{{\" ws ( {1} ( ws \",\" ws {1} )* )? ws \"}}\"\n", ruleName, optionalRule);
+    else
+        rules += std::format(
+            "{0} ::= \"{{\" ws {1} ( ws \",\" ws {2} )* ws \"}}\"\n", ruleName, requiredPart, optionalRule);
+}
+
+auto buildToolCallGrammar(std::span<const ToolDefinition> tools) -> std::string
+{
+    if (tools.empty())
+        return {};
+
+    auto rules = std::string {};
+    auto calls = std::string {};
+    for (auto i = size_t { 0 }; i < tools.size(); ++i)
+    {
+        auto const& tool = tools[i];
+        auto const callRule = std::format("call{}-{}", i, sanitizeRuleName(tool.name));
+        auto const argsRule = callRule + "-args";
+        appendSchemaRules(tool.inputSchema, argsRule, rules);
+        rules += std::format(R"({} ::= "{{" ws "\"name\"" ws ":" ws {} ws "," )"
+                             R"(ws "\"arguments\"" ws ":" ws {} ws "}}")"
+                             "\n",
+                             callRule,
+                             jsonLiteral(tool.name),
+                             argsRule);
+
+        if (!calls.empty())
+            calls += " | ";
+        calls += callRule;
+    }
+
+    auto grammar = std::string {};
+    grammar += "root ::= tool-call ( ws tool-call )*\n";
+    grammar += std::format(
+        "tool-call ::= {} ws call ws {}\n", gbnfLiteral(ToolCallOpenTag), gbnfLiteral(ToolCallCloseTag));
+    grammar += std::format("call ::= {}\n", calls);
+    grammar += rules;
+    grammar += PrimitiveRules;
+    return grammar;
+}
+
+} // namespace mychat
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Types.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief Opening tag that starts a tool call in the model output.
+constexpr auto ToolCallOpenTag = std::string_view { "<tool_call>" };
+
+/// @brief Closing tag that ends a tool call in the model output.
+constexpr auto ToolCallCloseTag = std::string_view { "</tool_call>" };
+
+/// @brief Builds a GBNF grammar that only admits well-formed tool calls.
+///
+/// The grammar's root matches one or more `<tool_call>{"name": ..., "arguments": ...}</tool_call>`
+/// blocks where the name is one of the given tools and the arguments follow that tool's
+/// input schema. It is meant to be used as a lazy grammar triggered by ToolCallOpenTag,
+/// so free-form text before the first tool call stays unconstrained.
+/// @param tools The available tools.
+/// @return The grammar text, or an empty string if @p tools is empty.
+[[nodiscard]] auto buildToolCallGrammar(std::span<const ToolDefinition> tools) -> std::string;
+
+/// @brief Converts a JSON schema into GBNF rules.
+///
+/// Supports the subset commonly used by MCP tool schemas: object (properties/required),
+/// array (items), string (enum), number, integer, boolean and null. Anything else is
+/// mapped to an arbitrary JSON value.
+/// @param schema The JSON schema.
+/// @param ruleName Name of the rule that matches the schema.
+/// @param rules Receives the generated rule definitions (one per line).
+void appendSchemaRules(nlohmann::json const& schema, std::string const& ruleName, std::string& rules);
+
+} // namespace mychat
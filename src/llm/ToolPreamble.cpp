@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ToolPreamble.hpp"
+#include "ToolGrammar.hpp"
+
+#include <core/Log.hpp>
+
+#include <array>
+#include <format>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+
+    /// Maximum length of the description shown at the Brief detail level.
+    constexpr auto BriefDescriptionLength = size_t { 100 };
+
+    /// @brief Returns the first sentence (or line) of a description, capped for brevity.
+    auto firstSentence(std::string_view text) -> std::string
+    {
+        auto end = text.find('\n');
+        if (auto const period = text.find(". "); period != std::string_view::npos && period < end)
+            end = period + 1;
+        auto sentence = std::string(text.substr(0, end));
+        if (sentence.size() > BriefDescriptionLength)
+        {
+            sentence.resize(BriefDescriptionLength - 3);
+            sentence += "...";
+        }
+        return sentence;
+    }
+
+    /// @brief Returns whether a property is listed in an object schema's "required" array.
+    auto isRequired(nlohmann::json const& schema, std::string const& key) -> bool
+    {
+        auto const required = schema.find("required");
+        if (required == schema.end() || !required->is_array())
+            return false;
+        for (auto const& r: *required)
+            if (r.is_string() && r.get<std::string>() == key)
+                return true;
+        return false;
+    }
+
+    /// @brief Renders the properties of an object schema as `a: T, b?: U`.
+    auto compactProperties(nlohmann::json const& schema, int depth) -> std::string
+    {
+        auto out = std::string {};
+        auto const properties = schema.find("properties");
+        if (properties == schema.end() || !properties->is_object())
+            return out;
+        for (auto const& [key, propSchema]: properties->items())
+        {
+            if (!out.empty())
+                out += ", ";
+            out += key;
+            if (!isRequired(schema, key))
+                out += '?';
+            out += ": ";
+            out += compactSchemaType(propSchema, depth + 1);
+        }
+        return out;
+    }
+
+} // namespace
+
+auto compactSchemaType(nlohmann::json const& schema, int depth) -> std::string
+{
+    if (!schema.is_object())
+        return "any";
+
+    if (auto const it = schema.find("enum"); it != schema.end() && it->is_array() && !it->empty())
+    {
+        auto out = std::string {};
+        for (auto const& option: *it)
+        {
+            if (!out.empty())
+                out += '|';
+            out += option.dump();
+        }
+        return out;
+    }
+
+    auto type = std::string {};
+    if (auto const it = schema.find("type"); it != schema.end())
+    {
+        if (it->is_string())
+            type = it->get<std::string>();
+        else if (it->is_array())
+            for (auto const& t: *it)
+                if (t.is_string() && t.get<std::string>() != "null")
+                {
+                    type = t.get<std::string>();
+                    break;
+                }
+    }
+    else if (schema.contains("properties"))
+        type = "object";
+
+    if (type == "array")
+    {
+        auto const items = schema.find("items");
+        return (items == schema.end() ? std::string { "any" } : compactSchemaType(*items, depth + 1)) + "[]";
+    }
+    if (type == "object")
+    {
+        if (depth >= 2 || !schema.contains("properties"))
+            return "object";
+        return "{" + compactProperties(schema, depth) + "}";
+    }
+    return type.empty() ? std::string { "any" } : type;
+}
+
+auto toolSignature(ToolDefinition const& tool) -> std::string
+{
+    return std::format("{}({})", tool.name, compactProperties(tool.inputSchema, 0));
+}
+
+auto renderToolPreamble(std::span<const ToolDefinition> tools, ToolPreambleDetail detail) -> std::string
+{
+    if (tools.empty())
+        return {};
+
+    auto out = std::format("# Tools\n\n"
+                           "To call a tool, reply with {}{{\"name\": \"<tool>\", \"arguments\": {{...}}}}{}. "
+                           "Several calls may follow each other.\n\n"
+                           "Available tools (arguments marked ? are optional):\n",
+                           ToolCallOpenTag,
+                           ToolCallCloseTag);
+
+    for (auto const& tool: tools)
+    {
+        out += "- ";
+        out += toolSignature(tool);
+        if (detail != ToolPreambleDetail::Signatures && !tool.description.empty())
+        {
+            out += ": ";
+            out += detail == ToolPreambleDetail::Full ? tool.description : firstSentence(tool.description);
+        }
+        out += '\n';
+
+        if (detail != ToolPreambleDetail::Full)
+            continue;
+        auto const properties = tool.inputSchema.find("properties");
+        if (!tool.inputSchema.is_object() || properties == tool.inputSchema.end() || !properties->is_object())
+            continue;
+        for (auto const& [key, propSchema]: properties->items())
+        {
+            if (!propSchema.is_object() || !propSchema.contains("description")
+                || !propSchema["description"].is_string())
+                continue;
+            out += std::format("  - {}: {}\n", key, propSchema["description"].get<std::string>());
+        }
+    }
+    return out;
+}
+
+ToolPreamble::ToolPreamble(CountTokensFn countTokens): _countTokens(std::move(countTokens))
+{
+}
+
+auto ToolPreamble::update(std::span<const ToolDefinition> tools,
+                          std::string_view toolSetKey,
+                          size_t tokenBudget) -> Result<bool>
+{
+    if (_valid && _key == toolSetKey && _budget == tokenBudget)
+        return false;
+
+    auto const previous = std::exchange(_text, {});
+    _tokenCount = 0;
+    _includedTools = 0;
+    _detail = ToolPreambleDetail::Full;
+
+    // Commits the rendering if it fits; the state is left untouched otherwise.
+    auto const tryRender = [&](std::span<const ToolDefinition> subset,
+                               ToolPreambleDetail detail) -> Result<bool> {
+        auto text = renderToolPreamble(subset, detail);
+        auto count = _countTokens(text);
+        if (!count)
+            return std::unexpected(count.error());
+        if (tokenBudget > 0 && *count > tokenBudget)
+            return false;
+        _text = std::move(text);
+        _tokenCount = *count;
+        _includedTools = subset.size();
+        _detail = detail;
+        return true;
+    };
+
+    auto fits = false;
+    constexpr auto Levels =
+        std::array { ToolPreambleDetail::Full, ToolPreambleDetail::Brief, ToolPreambleDetail::Signatures };
+    for (auto const detail: Levels)
+    {
+        auto rendered = tryRender(tools, detail);
+        if (!rendered)
+            return std::unexpected(rendered.error());
+        if ((fits = *rendered))
+            break;
+    }
+
+    // Even bare signatures do not fit: keep the longest prefix of the tool list that does.
+    if (!fits)
+    {
+        auto low = size_t { 0 };
+        auto high = tools.size();
+        while (low < high)
+        {
+            auto const mid = (low + high + 1) / 2;
+            auto rendered = tryRender(tools.first(mid), ToolPreambleDetail::Signatures);
+            if (!rendered)
+                return std::unexpected(rendered.error());
+            if (*rendered)
+                low = mid;
+            else
+                high = mid - 1;
+        }
+        if (low < tools.size())
+            log::warning("Tool preamble exceeds its budget of {} tokens, describing only {} of {} tools",
+                         tokenBudget,
+                         low,
+                         tools.size());
+    }
+
+    _key = toolSetKey;
+    _budget = tokenBudget;
+    _valid = true;
+    return _text != previous;
+}
+
+void ToolPreamble::clear()
+{
+    _valid = false;
+    _key.clear();
+    _text.clear();
+    _tokenCount = 0;
+    _includedTools = 0;
+}
+
+} // namespace mychat
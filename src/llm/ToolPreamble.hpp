@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief How much of each tool definition the preamble spells out.
+enum class ToolPreambleDetail : std::uint8_t
+{
+    Full,       ///< Signature, description and argument descriptions.
+    Brief,      ///< Signature and the first sentence of the description.
+    Signatures, ///< Signature only.
+};
+
+/// @brief Renders a JSON schema as a compact type expression, e.g. `{path: string, limit?: integer}`.
+/// @param schema The JSON schema.
+/// @param depth Nesting depth; objects nested deeper than two levels are shown as `object`.
+[[nodiscard]] auto compactSchemaType(nlohmann::json const& schema, int depth = 0) -> std::string;
+
+/// @brief Renders a tool as a call signature, e.g. `read_file(path: string, limit?: integer)`.
+[[nodiscard]] auto toolSignature(ToolDefinition const& tool) -> std::string;
+
+/// @brief Renders the prompt section that tells the model which tools exist and how to call them.
+/// @param tools The tools to describe.
+/// @param detail How much of each definition to include.
+[[nodiscard]] auto renderToolPreamble(std::span<const ToolDefinition> tools, ToolPreambleDetail detail)
+    -> std::string;
+
+/// @brief Cached tool preamble that fits into a token budget.
+///
+/// The preamble is re-rendered and re-tokenized only when the tool set or the budget
+/// changes. If the fully detailed preamble exceeds the budget, descriptions are shortened,
+/// then dropped, and finally tools are left out from the end of the list.
+class ToolPreamble
+{
+  public:
+    /// @brief Counts the tokens of a piece of text.
+    using CountTokensFn = std::function<Result<size_t>(std::string_view)>;
+
+    /// @brief Constructs a ToolPreamble using the given token counter.
+    explicit ToolPreamble(CountTokensFn countTokens);
+
+    /// @brief Brings the preamble up to date with the given tool set.
+    /// @param tools The available tools.
+    /// @param toolSetKey A string identifying the tool set; the preamble is only rebuilt
+    ///                   when it (or the budget) changes.
+    /// @param tokenBudget Maximum number of preamble tokens, 0 for no limit.
+    /// @return True if the preamble text changed, or an error from the token counter.
+    [[nodiscard]] auto update(std::span<const ToolDefinition> tools,
+                              std::string_view toolSetKey,
+                              size_t tokenBudget) -> Result<bool>;
+
+    /// @brief Drops the cached preamble.
+    void clear();
+
+    /// @brief Returns the preamble text (empty if there are no tools).
+    [[nodiscard]] auto text() const noexcept -> std::string const& { return _text; }
+
+    /// @brief Returns the number of tokens the preamble costs.
+    [[nodiscard]] auto tokenCount() const noexcept -> size_t { return _tokenCount; }
+
+    /// @brief Returns how many of the tools are described in the preamble.
+    [[nodiscard]] auto includedToolCount() const noexcept -> size_t { return _includedTools; }
+
+    /// @brief Returns the level of detail that fit into the budget.
+    [[nodiscard]] auto detail() const noexcept -> ToolPreambleDetail { return _detail; }
+
+  private:
+    CountTokensFn _countTokens;
+    std::string _key;
+    size_t _budget = 0;
+    bool _valid = false;
+
+    std::string _text;
+    size_t _tokenCount = 0;
+    size_t _includedTools = 0;
+    ToolPreambleDetail _detail = ToolPreambleDetail::Full;
+};
+
+} // namespace mychat
@@ -0,0 +1,1149 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpTransport.hpp"
+
+#include <core/JsonReader.hpp>
+#include <core/JsonUtils.hpp>
+#include <core/Log.hpp>
+#include <mcp/JsonRpc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+
+#ifdef _WIN32
+    using SocketHandle = SOCKET;
+    constexpr auto InvalidSocket = INVALID_SOCKET;
+#else
+    using SocketHandle = int;
+    constexpr auto InvalidSocket = -1;
+#endif
+
+    using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+    /// @brief Bytes requested per read.
+    constexpr auto ReadSize = size_t { 16 * 1024 };
+
+    /// @brief Longest accepted status, header or chunk-size line.
+    constexpr auto MaxLineLength = size_t { 64 * 1024 };
+
+    /// @brief JSON-RPC error code reported for requests that failed at the HTTP level.
+    constexpr auto HttpFailureCode = -32603;
+
+    auto deadlineAfter(std::chrono::milliseconds timeout) -> Deadline
+    {
+        if (timeout <= std::chrono::milliseconds::zero())
+            return std::nullopt;
+        return std::chrono::steady_clock::now() + timeout;
+    }
+
+    auto socketError() -> int
+    {
+#ifdef _WIN32
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    auto wouldBlock(int error) -> bool
+    {
+#ifdef _WIN32
+        return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+        return error == EAGAIN || error == EWOULDBLOCK || error == EINPROGRESS || error == EINTR;
+#endif
+    }
+
+    auto errorMessage(int error) -> std::string
+    {
+#ifdef _WIN32
+        return std::format("socket error {}", error);
+#else
+        return strerror(error);
+#endif
+    }
+
+    void closeSocket(SocketHandle socket)
+    {
+#ifdef _WIN32
+        closesocket(socket);
+#else
+        ::close(socket);
+#endif
+    }
+
+    /// @brief Makes every blocked poll() and read on @p socket return, from any thread.
+    void shutdownSocket(SocketHandle socket)
+    {
+#ifdef _WIN32
+        ::shutdown(socket, SD_BOTH);
+#else
+        ::shutdown(socket, SHUT_RDWR);
+#endif
+    }
+
+    auto pollSocket(SocketHandle socket, short events, int timeoutMs) -> int
+    {
+        auto fd = pollfd { .fd = socket, .events = events, .revents = 0 };
+#ifdef _WIN32
+        return WSAPoll(&fd, 1, timeoutMs);
+#else
+        return ::poll(&fd, 1, timeoutMs);
+#endif
+    }
+
+    auto equalsIgnoreCase(std::string_view a, std::string_view b) -> bool
+    {
+        auto const lower = [](char c) {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+        };
+        return std::ranges::equal(a, b, [&](char x, char y) { return lower(x) == lower(y); });
+    }
+
+    /// @brief Whether a comma-separated header value contains @p token, ignoring case.
+    auto hasToken(std::string_view value, std::string_view token) -> bool
+    {
+        while (!value.empty())
+        {
+            auto const comma = value.find(',');
+            auto item = value.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+            if (equalsIgnoreCase(item, token))
+                return true;
+            if (comma == std::string_view::npos)
+                break;
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    /// @brief An open HTTP/1.1 connection with its receive buffer.
+    struct HttpConnection
+    {
+        SocketHandle socket = InvalidSocket; ///< Non-blocking.
+        std::string key;                     ///< "host:port", for pooling and messages.
+        bool reused = false;                 ///< Taken from the pool rather than freshly connected.
+        std::chrono::steady_clock::time_point idleSince;
+
+        std::string buffer; ///< Received data; bytes before offset are consumed.
+        size_t offset = 0;
+
+        HttpConnection() = default;
+        HttpConnection(const HttpConnection&) = delete;
+        HttpConnection& operator=(const HttpConnection&) = delete;
+
+        ~HttpConnection()
+        {
+            if (socket != InvalidSocket)
+                closeSocket(socket);
+        }
+
+        [[nodiscard]] auto available() const noexcept -> size_t { return buffer.size() - offset; }
+
+        /// @brief Waits until the socket is ready for @p events or the deadline passes.
+        [[nodiscard]] auto waitUntilReady(short events, Deadline deadline) const -> VoidResult
+        {
+            while (true)
+            {
+                auto timeoutMs = -1;
+                if (deadline)
+                {
+                    auto const left = std::chrono::ceil<std::chrono::milliseconds>(
+                        *deadline - std::chrono::steady_clock::now());
+                    if (left <= std::chrono::milliseconds::zero())
+                        return makeError(ErrorCode::TimeoutError,
+                                         std::format("Timed out talking to {}", key));
+                    timeoutMs = static_cast<int>(std::min<std::int64_t>(left.count(), INT_MAX));
+                }
+                auto const ready = pollSocket(socket, events, timeoutMs);
+                if (ready > 0)
+                    return {}; // Also on hang-up or error, which the following read or write reports.
+                if (ready < 0 && socketError() != EINTR)
+                    return makeError(ErrorCode::TransportError,
+                                     std::format("poll failed: {}", errorMessage(socketError())));
+            }
+        }
+
+        [[nodiscard]] auto writeAll(std::string_view data, Deadline deadline) -> VoidResult
+        {
+            while (!data.empty())
+            {
+                auto const chunk = static_cast<int>(std::min<size_t>(data.size(), INT_MAX));
+#if defined(_WIN32)
+                auto const sent = ::send(socket, data.data(), chunk, 0);
+#elif defined(MSG_NOSIGNAL)
+                auto const sent = ::send(socket, data.data(), static_cast<size_t>(chunk), MSG_NOSIGNAL);
+#else
+                auto const sent = ::send(socket, data.data(), static_cast<size_t>(chunk), 0);
+#endif
+                if (sent > 0)
+                {
+                    data.remove_prefix(static_cast<size_t>(sent));
+                    continue;
+                }
+                if (auto const error = socketError(); sent < 0 && !wouldBlock(error))
+                    return makeError(ErrorCode::TransportError,
+                                     std::format("Failed to send to {}: {}", key, errorMessage(error)));
+                if (auto ready = waitUntilReady(POLLOUT, deadline); !ready)
+                    return ready;
+            }
+            return {};
+        }
+
+        /// @brief Receives more data into the buffer.
+        /// @return True if data arrived, false once the peer closed the connection.
+        [[nodiscard]] auto fill() -> Result<bool>
+        {
+            if (offset > 0)
+            {
+                buffer.erase(0, offset);
+                offset = 0;
+            }
+
+            while (true)
+            {
+                auto const oldSize = buffer.size();
+                auto received = std::int64_t { 0 };
+                auto error = 0;
+                buffer.resize_and_overwrite(oldSize + ReadSize, [&](char* data, size_t /*size*/) {
+#ifdef _WIN32
+                    received = ::recv(socket, data + oldSize, static_cast<int>(ReadSize), 0);
+#else
+                    received = ::recv(socket, data + oldSize, ReadSize, 0);
+#endif
+                    error = socketError();
+                    return oldSize + static_cast<size_t>(std::max(received, std::int64_t { 0 }));
+                });
+
+                if (received > 0)
+                    return true;
+                if (received == 0)
+                    return false;
+                if (!wouldBlock(error))
+                    return makeError(ErrorCode::TransportError,
+                                     std::format("Failed to receive from {}: {}", key, errorMessage(error)));
+                if (auto ready = waitUntilReady(POLLIN, std::nullopt); !ready)
+                    return std::unexpected(ready.error());
+            }
+        }
+
+        /// @brief Reads one CRLF- (or LF-) terminated line, without the terminator.
+        [[nodiscard]] auto readLine() -> Result<std::string>
+        {
+            auto scanned = size_t { 0 }; // Bytes after offset known to contain no newline.
+            while (true)
+            {
+                auto const newline = buffer.find('\n', offset + scanned);
+                if (newline != std::string::npos)
+                {
+                    auto line = buffer.substr(offset, newline - offset);
+                    offset = newline + 1;
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    return line;
+                }
+                scanned = available();
+                if (scanned > MaxLineLength)
+                    return makeError(ErrorCode::ProtocolError, std::format("Overlong line from {}", key));
+
+                auto more = fill();
+                if (!more)
+                    return std::unexpected(more.error());
+                if (!*more)
+                    return makeError(ErrorCode::TransportError, std::format("Connection to {} closed", key));
+            }
+        }
+    };
+
+    /// @brief Status and headers of an HTTP response.
+    struct ResponseHead
+    {
+        int status = 0;
+        bool keepAlive = true;
+        std::vector<std::pair<std::string, std::string>> headers;
+
+        [[nodiscard]] auto header(std::string_view name) const -> std::optional<std::string_view>
+        {
+            for (auto const& [key, value]: headers)
+                if (equalsIgnoreCase(key, name))
+                    return value;
+            return std::nullopt;
+        }
+    };
+
+    /// @brief Reads the status line and headers of a response, skipping interim (1xx) responses.
+    auto readResponseHead(HttpConnection& connection) -> Result<ResponseHead>
+    {
+        while (true)
+        {
+            auto statusLine = connection.readLine();
+            if (!statusLine)
+                return std::unexpected(statusLine.error());
+
+            // "HTTP/1.1 200 OK"
+            auto const line = std::string_view(*statusLine);
+            auto head = ResponseHead {};
+            if (!line.starts_with("HTTP/1.") || line.size() < 12
+                || std::from_chars(line.data() + 9, line.data() + 12, head.status).ec != std::errc {})
+                return makeError(ErrorCode::ProtocolError,
+                                 std::format("Malformed HTTP status line from {}", connection.key));
+            auto const http10 = line.starts_with("HTTP/1.0");
+
+            while (true)
+            {
+                auto headerLine = connection.readLine();
+                if (!headerLine)
+                    return std::unexpected(headerLine.error());
+                if (headerLine->empty())
+                    break;
+                auto const colon = headerLine->find(':');
+                if (colon == std::string::npos)
+                    continue;
+                auto value = std::string_view(*headerLine).substr(colon + 1);
+                while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+                    value.remove_prefix(1);
+                head.headers.emplace_back(headerLine->substr(0, colon), value);
+            }
+
+            if (head.status >= 100 && head.status < 200)
+                continue;
+
+            auto const connectionHeader = head.header("Connection");
+            head.keepAlive = http10 ? connectionHeader && hasToken(*connectionHeader, "keep-alive")
+                                    : !connectionHeader || !hasToken(*connectionHeader, "close");
+            return head;
+        }
+    }
+
+    /// @brief Streams a response body in whatever pieces it arrives in.
+    class BodyReader
+    {
+      public:
+        /// @brief Prepares to read the body that @p head announces.
+        ///
+        /// A malformed Content-Length leaves the body's end unknown, so the connection is not reused.
+        [[nodiscard]] static auto open(ResponseHead& head, std::string_view key) -> Result<BodyReader>
+        {
+            auto reader = BodyReader {};
+            if (head.status == 204 || head.status == 304)
+                reader._mode = Mode::Length;
+            else if (auto const encoding = head.header("Transfer-Encoding");
+                     encoding && hasToken(*encoding, "chunked"))
+                reader._mode = Mode::Chunked;
+            else if (auto const length = head.header("Content-Length"))
+            {
+                auto value = *length;
+                while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+                    value.remove_suffix(1);
+                auto const* end = value.data() + value.size();
+                auto const parsed = std::from_chars(value.data(), end, reader._remaining);
+                if (parsed.ec != std::errc {} || parsed.ptr != end)
+                {
+                    head.keepAlive = false;
+                    return makeError(ErrorCode::ProtocolError,
+                                     std::format("Malformed Content-Length from {}", key));
+                }
+            }
+            else
+            {
+                // Delimited by the end of the connection, which then cannot be reused.
+                reader._mode = Mode::UntilClose;
+                head.keepAlive = false;
+            }
+            return reader;
+        }
+
+        /// @brief Appends the next piece of the body to @p out.
+        /// @return True if a piece was appended, false at the end of the body.
+        [[nodiscard]] auto next(HttpConnection& connection, std::string& out) -> Result<bool>
+        {
+            if (_mode == Mode::Chunked && _remaining == 0)
+            {
+                if (_inChunk)
+                {
+                    if (auto crlf = connection.readLine(); !crlf)
+                        return std::unexpected(crlf.error());
+                    _inChunk = false;
+                }
+                auto sizeLine = connection.readLine();
+                if (!sizeLine)
+                    return std::unexpected(sizeLine.error());
+                auto const parsed =
+                    std::from_chars(sizeLine->data(), sizeLine->data() + sizeLine->size(), _remaining, 16);
+                if (parsed.ec != std::errc {})
+                    return makeError(ErrorCode::ProtocolError,
+                                     std::format("Malformed chunk size from {}", connection.key));
+                if (_remaining == 0)
+                {
+                    // Skip the trailer section.
+                    while (true)
+                    {
+                        auto trailer = connection.readLine();
+                        if (!trailer)
+                            return std::unexpected(trailer.error());
+                        if (trailer->empty())
+                            return false;
+                    }
+                }
+                _inChunk = true;
+            }
+
+            if (_mode != Mode::UntilClose && _remaining == 0)
+                return false;
+
+            if (connection.available() == 0)
+            {
+                auto more = connection.fill();
+                if (!more)
+                    return std::unexpected(more.error());
+                if (!*more)
+                {
+                    if (_mode == Mode::UntilClose)
+                        return false;
+                    return makeError(ErrorCode::TransportError,
+                                     std::format("Connection to {} closed mid-response", connection.key));
+                }
+            }
+
+            auto count = connection.available();
+            if (_mode != Mode::UntilClose)
+            {
+                count = std::min(count, _remaining);
+                _remaining -= count;
+            }
+            out.append(connection.buffer, connection.offset, count);
+            connection.offset += count;
+            return true;
+        }
+
+      private:
+        enum class Mode
+        {
+            Length,
+            Chunked,
+            UntilClose,
+        };
+
+        Mode _mode = Mode::Length;
+        size_t _remaining = 0; ///< Bytes left in the body (Length) or the current chunk (Chunked).
+        bool _inChunk = false; ///< Whether the CRLF after the current chunk's data is still due.
+    };
+
+    /// @brief Splits a text/event-stream body into events.
+    class SseParser
+    {
+      public:
+        /// @brief Feeds the next piece of the stream and calls @p onMessage with each completed
+        ///        message event's data.
+        template <typename OnMessage>
+        void feed(std::string_view chunk, OnMessage&& onMessage)
+        {
+            _pending.append(chunk);
+            auto lineStart = size_t { 0 };
+            while (true)
+            {
+                auto const newline = _pending.find('\n', std::max(lineStart, _scanned));
+                if (newline == std::string::npos)
+                    break;
+                auto line = std::string_view(_pending).substr(lineStart, newline - lineStart);
+                lineStart = newline + 1;
+                if (line.ends_with('\r'))
+                    line.remove_suffix(1);
+
+                if (line.empty())
+                {
+                    if (!_data.empty() && (_event.empty() || _event == "message"))
+                    {
+                        _data.pop_back(); // The newline after the last data line.
+                        onMessage(std::string_view(_data));
+                    }
+                    _data.clear();
+                    _event.clear();
+                    continue;
+                }
+                if (line.front() == ':')
+                    continue; // Comment, e.g. a keep-alive ping.
+
+                auto const colon = line.find(':');
+                auto const field = line.substr(0, colon);
+                auto value = colon == std::string_view::npos ? std::string_view {} : line.substr(colon + 1);
+                if (value.starts_with(' '))
+                    value.remove_prefix(1);
+                if (field == "data")
+                {
+                    _data.append(value);
+                    _data += '\n';
+                }
+                else if (field == "event")
+                    _event = value;
+            }
+            _pending.erase(0, lineStart);
+            _scanned = _pending.size();
+        }
+
+      private:
+        std::string _pending; ///< Received text not yet split into lines.
+        size_t _scanned = 0;  ///< Prefix of _pending known to contain no newline.
+        std::string _data;    ///< Data lines of the event being received, each followed by a newline.
+        std::string _event;   ///< Type of the event being received.
+    };
+
+    auto openConnection(HttpEndpoint const& endpoint, std::string key, Deadline deadline)
+        -> Result<std::unique_ptr<HttpConnection>>
+    {
+#ifdef _WIN32
+        static auto const winsockReady = [] {
+            auto data = WSADATA {};
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        if (!winsockReady)
+            return makeError(ErrorCode::TransportError, "Failed to initialize Winsock");
+#endif
+
+        auto hints = addrinfo {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        auto const port = std::to_string(endpoint.port);
+        if (auto const status = getaddrinfo(endpoint.host.c_str(), port.c_str(), &hints, &addresses);
+            status != 0)
+            return makeError(ErrorCode::TransportError,
+                             std::format("Cannot resolve {}: {}", endpoint.host, gai_strerror(status)));
+
+        auto connection = std::make_unique<HttpConnection>();
+        connection->key = std::move(key);
+        auto const connectError = [&](std::string_view reason) {
+            return makeError(ErrorCode::TransportError,
+                             std::format("Cannot connect to {}: {}", connection->key, reason));
+        };
+        auto lastError = connectError("no usable address");
+        for (auto* address = addresses; address; address = address->ai_next)
+        {
+            auto const socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (socket == InvalidSocket)
+                continue;
+            connection->socket = socket;
+#ifdef _WIN32
+            auto nonBlocking = u_long { 1 };
+            ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+            fcntl(socket, F_SETFD, FD_CLOEXEC);
+            fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+#endif
+            // Requests are small and latency-bound; don't let Nagle hold them back.
+            auto const noDelay = 1;
+            setsockopt(socket,
+                       IPPROTO_TCP,
+                       TCP_NODELAY,
+                       reinterpret_cast<char const*>(&noDelay),
+                       sizeof(noDelay));
+
+            if (::connect(socket, address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) != 0)
+            {
+                if (auto const error = socketError(); !wouldBlock(error))
+                {
+                    lastError = connectError(errorMessage(error));
+                    closeSocket(std::exchange(connection->socket, InvalidSocket));
+                    continue;
+                }
+                if (auto ready = connection->waitUntilReady(POLLOUT, deadline); !ready)
+                {
+                    lastError = std::unexpected(ready.error());
+                    closeSocket(std::exchange(connection->socket, InvalidSocket));
+                    continue;
+                }
+                auto error = 0;
+                auto length = socklen_t { sizeof(error) };
+                getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+                if (error != 0)
+                {
+                    lastError = connectError(errorMessage(error));
+                    closeSocket(std::exchange(connection->socket, InvalidSocket));
+                    continue;
+                }
+            }
+            break;
+        }
+        freeaddrinfo(addresses);
+
+        if (connection->socket == InvalidSocket)
+            return lastError;
+        return connection;
+    }
+
+} // namespace
+
+// --- parseHttpUrl ---
+
+auto parseHttpUrl(std::string_view url) -> Result<HttpEndpoint>
+{
+    if (url.starts_with("https://"))
+        return makeError(ErrorCode::ConfigError,
+                         std::format("{}: https is not supported, use a TLS-terminating proxy", url));
+    if (!url.starts_with("http://"))
+        return makeError(ErrorCode::ConfigError, std::format("{}: not an http:// URL", url));
+
+    auto rest = url.substr(7);
+    auto const pathStart = rest.find_first_of("/?");
+    auto endpoint = HttpEndpoint {};
+    if (pathStart != std::string_view::npos)
+    {
+        endpoint.path = rest.substr(pathStart);
+        if (endpoint.path.front() == '?')
+            endpoint.path.insert(0, "/");
+    }
+    auto authority = rest.substr(0, pathStart);
+    if (auto const at = authority.rfind('@'); at != std::string_view::npos)
+        return makeError(ErrorCode::ConfigError,
+                         std::format("{}: credentials belong into an Authorization header", url));
+
+    // "[::1]:8080", "host:8080" or "host"
+    auto portText = std::string_view {};
+    if (authority.starts_with('['))
+    {
+        auto const close = authority.find(']');
+        if (close == std::string_view::npos)
+            return makeError(ErrorCode::ConfigError, std::format("{}: malformed IPv6 address", url));
+        endpoint.host = authority.substr(1, close - 1);
+        if (authority.substr(close + 1).starts_with(':'))
+            portText = authority.substr(close + 2);
+    }
+    else
+    {
+        auto const colon = authority.rfind(':');
+        endpoint.host = authority.substr(0, colon);
+        if (colon != std::string_view::npos)
+            portText = authority.substr(colon + 1);
+    }
+    if (endpoint.host.empty())
+        return makeError(ErrorCode::ConfigError, std::format("{}: missing host", url));
+    if (!portText.empty())
+    {
+        auto const* const end = portText.data() + portText.size();
+        auto const parsed = std::from_chars(portText.data(), end, endpoint.port);
+        if (parsed.ec != std::errc {} || parsed.ptr != end || endpoint.port == 0)
+            return makeError(ErrorCode::ConfigError, std::format("{}: invalid port", url));
+    }
+    return endpoint;
+}
+
+// --- HttpConnectionPool ---
+
+struct HttpConnectionPool::Impl
+{
+    size_t maxIdlePerHost;
+    std::chrono::milliseconds idleTimeout;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::vector<std::unique_ptr<HttpConnection>>, std::less<>> idle; ///< Oldest first.
+    std::atomic<size_t> opened = 0;
+
+    /// @brief Returns an idle connection to @p endpoint, or opens a new one.
+    /// @param fresh Skips idle connections, e.g. to retry a request that a stale one failed.
+    [[nodiscard]] auto acquire(HttpEndpoint const& endpoint, Deadline deadline, bool fresh)
+        -> Result<std::unique_ptr<HttpConnection>>
+    {
+        auto key = std::format("{}:{}", endpoint.host, endpoint.port);
+        if (!fresh)
+        {
+            auto const lock = std::lock_guard(mutex);
+            if (auto it = idle.find(key); it != idle.end())
+            {
+                auto const now = std::chrono::steady_clock::now();
+                auto& connections = it->second;
+                while (!connections.empty())
+                {
+                    auto connection = std::move(connections.back());
+                    connections.pop_back();
+                    // The server closes idle connections eventually; such a one reads as ready.
+                    if (now - connection->idleSince < idleTimeout
+                        && pollSocket(connection->socket, POLLIN, 0) == 0)
+                    {
+                        connection->reused = true;
+                        return connection;
+                    }
+                }
+            }
+        }
+
+        auto connection = openConnection(endpoint, std::move(key), deadline);
+        if (connection)
+            ++opened;
+        return connection;
+    }
+
+    /// @brief Keeps a connection whose last response was read completely for reuse.
+    void release(std::unique_ptr<HttpConnection> connection)
+    {
+        if (connection->available() > 0)
+            return; // Unsolicited data; the connection is out of sync.
+        connection->idleSince = std::chrono::steady_clock::now();
+
+        auto const lock = std::lock_guard(mutex);
+        auto& connections = idle[connection->key];
+        connections.push_back(std::move(connection));
+        if (connections.size() > maxIdlePerHost)
+            connections.erase(connections.begin());
+    }
+};
+
+HttpConnectionPool::HttpConnectionPool(size_t maxIdlePerHost, std::chrono::milliseconds idleTimeout):
+    _impl(std::make_unique<Impl>())
+{
+    _impl->maxIdlePerHost = maxIdlePerHost;
+    _impl->idleTimeout = idleTimeout;
+}
+
+HttpConnectionPool::~HttpConnectionPool() = default;
+
+auto HttpConnectionPool::idleConnectionCount() const -> size_t
+{
+    auto const lock = std::lock_guard(_impl->mutex);
+    auto count = size_t { 0 };
+    for (auto const& [key, connections]: _impl->idle)
+        count += connections.size();
+    return count;
+}
+
+auto HttpConnectionPool::openedConnectionCount() const -> size_t
+{
+    return _impl->opened;
+}
+
+// --- HttpTransport ---
+
+struct HttpTransport::Impl
+{
+    /// @brief A request whose response is read on a background thread.
+    struct Exchange
+    {
+        std::jthread thread;
+        bool finished = false; ///< Set by the thread when done; guarded by mutex.
+    };
+
+    HttpEndpoint endpoint;
+    std::string hostHeader;
+    std::map<std::string, std::string> headers;
+    std::chrono::milliseconds requestTimeout {};
+    std::shared_ptr<HttpConnectionPool> pool;
+
+    std::atomic<bool> connected = false;
+
+    std::mutex mutex; ///< Guards the members below.
+    std::condition_variable messageArrived;
+    std::deque<std::string> inbox; ///< Received messages as JSON text.
+    std::string sessionId;        ///< Assigned by the server in its initialize response.
+    std::string protocolVersion;  ///< Negotiated by the first initialize.
+    bool listening = false;       ///< Whether the GET stream for server-initiated messages was opened.
+    std::vector<SocketHandle> activeSockets; ///< Shut down by close() to wake up their readers.
+    std::list<Exchange> exchanges;
+
+    /// @brief Serializes a request; requires mutex to be held.
+    [[nodiscard]] auto buildRequest(std::string_view method, std::string_view body) const -> std::string
+    {
+        auto request = std::format("{} {} HTTP/1.1\r\nHost: {}\r\n", method, endpoint.path, hostHeader);
+        if (method == "GET")
+            request += "Accept: text/event-stream\r\n";
+        else
+            request += std::format("Accept: application/json, text/event-stream\r\n"
+                                   "Content-Type: application/json\r\nContent-Length: {}\r\n",
+                                   body.size());
+        if (!sessionId.empty())
+            request += std::format("Mcp-Session-Id: {}\r\n", sessionId);
+        if (!protocolVersion.empty())
+            request += std::format("MCP-Protocol-Version: {}\r\n", protocolVersion);
+        for (auto const& [name, value]: headers)
+            request += std::format("{}: {}\r\n", name, value);
+        request += "\r\n";
+        request += body;
+        return request;
+    }
+
+    void track(SocketHandle socket)
+    {
+        auto const lock = std::lock_guard(mutex);
+        activeSockets.push_back(socket);
+    }
+
+    void untrack(SocketHandle socket)
+    {
+        auto const lock = std::lock_guard(mutex);
+        std::erase(activeSockets, socket);
+    }
+
+    /// @brief Hands a received message to receive().
+    /// @param result The JSON text of the message's result, if it has one.
+    void deliver(std::string message, std::string_view result = {})
+    {
+        auto const lock = std::lock_guard(mutex);
+        if (!connected)
+            return;
+        // Later requests must carry the negotiated protocol version.
+        if (protocolVersion.empty() && !result.empty())
+            if (auto negotiated = negotiatedProtocolVersion(result))
+                protocolVersion = std::move(*negotiated);
+        inbox.push_back(std::move(message));
+        messageArrived.notify_one();
+    }
+
+    /// @brief Returns the protocol version of @p result if it answers the initialize request.
+    [[nodiscard]] static auto negotiatedProtocolVersion(std::string_view result) -> std::optional<std::string>
+    {
+        auto reader = json::JsonReader(result);
+        if (reader.peek() != json::JsonReader::Kind::Object)
+            return std::nullopt;
+        reader.enterObject();
+        auto version = std::optional<std::string> {};
+        auto hasCapabilities = false;
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "protocolVersion" && reader.peek() == json::JsonReader::Kind::String)
+                reader.readString(version.emplace());
+            else
+            {
+                hasCapabilities = hasCapabilities || *key == "capabilities";
+                reader.skipValue();
+            }
+        }
+        return hasCapabilities ? version : std::nullopt;
+    }
+
+    /// @brief Answers requests @p ids with a JSON-RPC error, or just logs if there are none.
+    void fail(std::span<nlohmann::json const> ids, std::string const& message)
+    {
+        if (ids.empty())
+        {
+            log::warning("MCP server {}: {}", hostHeader, message);
+            return;
+        }
+        for (auto const& id: ids)
+            deliver(jsonrpc::makeErrorResponse(id, HttpFailureCode, message).dump());
+    }
+
+    /// @brief Reads the response to @p request on a background thread.
+    /// @param ids The IDs of the JSON-RPC requests sent, a batch may carry several. Empty for
+    ///            notifications, responses and the GET stream.
+    void startExchange(std::unique_ptr<HttpConnection> connection,
+                       std::string request,
+                       std::vector<nlohmann::json> ids)
+    {
+        auto const lock = std::lock_guard(mutex);
+        if (!connected)
+            return; // Closing; the destructor may already be joining the exchanges.
+        std::erase_if(exchanges, [](Exchange const& exchange) { return exchange.finished; });
+        auto& exchange = exchanges.emplace_back();
+        exchange.thread = std::jthread([this,
+                                        &exchange,
+                                        connection = std::move(connection),
+                                        request = std::move(request),
+                                        ids = std::move(ids)]() mutable {
+            runExchange(std::move(connection), request, std::move(ids));
+            auto const finishedLock = std::lock_guard(mutex);
+            exchange.finished = true;
+        });
+    }
+
+    /// @brief Opens the GET stream for server-initiated messages, once.
+    void startListening()
+    {
+        auto request = std::string {};
+        {
+            auto const lock = std::lock_guard(mutex);
+            if (listening || !connected)
+                return;
+            listening = true;
+            request = buildRequest("GET", {});
+        }
+        auto connection = pool->_impl->acquire(endpoint, deadlineAfter(requestTimeout), false);
+        if (!connection)
+        {
+            log::debug("MCP server {}: no event stream: {}", hostHeader, connection.error().message);
+            return;
+        }
+        track((*connection)->socket);
+        if (auto written = (*connection)->writeAll(request, deadlineAfter(requestTimeout)); !written)
+        {
+            untrack((*connection)->socket);
+            return;
+        }
+        startExchange(std::move(*connection), std::move(request), {});
+    }
+
+    /// @param unanswered The IDs of the requests sent; answered ones are removed as responses arrive.
+    void runExchange(std::unique_ptr<HttpConnection> connection,
+                     std::string const& request,
+                     std::vector<nlohmann::json> unanswered)
+    {
+        auto const isListener = request.starts_with("GET");
+        auto head = readResponseHead(*connection);
+        if (!head && connection->reused && connection->available() == 0 && connected)
+        {
+            // The server closed the pooled connection before reading the request; retry once.
+            untrack(connection->socket);
+            auto fresh = pool->_impl->acquire(endpoint, deadlineAfter(requestTimeout), true);
+            if (!fresh)
+            {
+                fail(unanswered, fresh.error().message);
+                return;
+            }
+            connection = std::move(*fresh);
+            track(connection->socket);
+            if (auto written = connection->writeAll(request, deadlineAfter(requestTimeout)); !written)
+            {
+                untrack(connection->socket);
+                fail(unanswered, written.error().message);
+                return;
+            }
+            head = readResponseHead(*connection);
+        }
+        if (!head)
+        {
+            untrack(connection->socket);
+            if (connected)
+                fail(unanswered, head.error().message);
+            return;
+        }
+
+        if (auto const session = head->header("Mcp-Session-Id"))
+        {
+            auto const lock = std::lock_guard(mutex);
+            sessionId = *session;
+        }
+
+        auto const contentType = head->header("Content-Type").value_or("");
+        auto const isEventStream = contentType.starts_with("text/event-stream");
+        auto const isJson = contentType.starts_with("application/json");
+        auto const success = head->status >= 200 && head->status < 300;
+
+        auto const handleMessage = [&](std::string_view text) {
+            auto const messages = jsonrpc::scanMessage(text);
+            if (!messages)
+            {
+                log::warning("MCP server {}: {}", hostHeader, messages.error().message);
+                return;
+            }
+            for (auto const& message: *messages)
+            {
+                if (!message.id.is_null() && message.method.empty())
+                    std::erase(unanswered, message.id);
+                deliver(std::string(message.text), message.result);
+            }
+        };
+
+        auto body = BodyReader::open(*head, connection->key);
+        if (!body)
+        {
+            untrack(connection->socket);
+            if (connected)
+                fail(unanswered, body.error().message);
+            return;
+        }
+        auto sse = SseParser {};
+        auto data = std::string {};
+        auto failure = std::optional<Error> {};
+        while (true)
+        {
+            auto piece = std::string {};
+            auto more = body->next(*connection, piece);
+            if (!more)
+            {
+                failure = more.error();
+                break;
+            }
+            if (!*more)
+                break;
+            if (success && isEventStream)
+                sse.feed(piece, handleMessage);
+            else
+                data += piece;
+        }
+        untrack(connection->socket);
+
+        if (failure)
+        {
+            if (connected)
+                fail(unanswered, failure->message);
+            return;
+        }
+        if (success && isJson && !data.empty())
+            handleMessage(data);
+        if (head->keepAlive)
+            pool->_impl->release(std::move(connection));
+
+        if (isListener)
+        {
+            if (head->status != 405 && !success)
+                log::debug("MCP server {}: event stream refused with HTTP {}", hostHeader, head->status);
+            return;
+        }
+        if (!success)
+        {
+            if (head->status == 404)
+            {
+                auto const lock = std::lock_guard(mutex);
+                sessionId.clear();
+            }
+            auto const detail = data.empty() ? std::string {} : ": " + data;
+            fail(unanswered, std::format("HTTP {} from {}{}", head->status, hostHeader, detail));
+            return;
+        }
+        if (!unanswered.empty())
+            fail(unanswered, std::format("{} closed the stream without a response", hostHeader));
+        if (head->header("Mcp-Session-Id"))
+            startListening();
+    }
+};
+
+HttpTransport::HttpTransport(): _impl(std::make_unique<Impl>())
+{
+}
+
+HttpTransport::~HttpTransport()
+{
+    close();
+    // Joined outside the lock, which the finishing threads take one last time.
+    auto exchanges = std::list<Impl::Exchange> {};
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        exchanges.swap(_impl->exchanges);
+    }
+}
+
+auto HttpTransport::start(const HttpTransportConfig& config) -> VoidResult
+{
+    if (_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport already connected");
+
+    auto endpoint = parseHttpUrl(config.url);
+    if (!endpoint)
+        return std::unexpected(endpoint.error());
+
+    _impl->endpoint = std::move(*endpoint);
+    _impl->hostHeader = _impl->endpoint.port == 80
+                            ? _impl->endpoint.host
+                            : std::format("{}:{}", _impl->endpoint.host, _impl->endpoint.port);
+    if (_impl->endpoint.host.contains(':'))
+        _impl->hostHeader = std::format("[{}]:{}", _impl->endpoint.host, _impl->endpoint.port);
+    _impl->headers = config.headers;
+    _impl->requestTimeout = config.requestTimeout;
+    _impl->pool = config.pool ? config.pool : std::make_shared<HttpConnectionPool>();
+    _impl->connected = true;
+    log::info("MCP endpoint: {}", config.url);
+    return {};
+}
+
+auto HttpTransport::send(const nlohmann::json& message) -> VoidResult
+{
+    if (!_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport not connected");
+
+    auto ids = jsonrpc::requestIds(message);
+    auto request = std::string {};
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        request = _impl->buildRequest("POST", message.dump());
+    }
+
+    auto const deadline = deadlineAfter(_impl->requestTimeout);
+    auto connection = _impl->pool->_impl->acquire(_impl->endpoint, deadline, false);
+    if (!connection)
+        return std::unexpected(connection.error());
+    _impl->track((*connection)->socket);
+
+    auto written = (*connection)->writeAll(request, deadline);
+    if (!written && (*connection)->reused && _impl->connected)
+    {
+        // A pooled connection may have been closed by the server in the meantime.
+        _impl->untrack((*connection)->socket);
+        connection = _impl->pool->_impl->acquire(_impl->endpoint, deadline, true);
+        if (!connection)
+            return std::unexpected(connection.error());
+        _impl->track((*connection)->socket);
+        written = (*connection)->writeAll(request, deadline);
+    }
+    if (!written)
+    {
+        _impl->untrack((*connection)->socket);
+        return written;
+    }
+
+    // Messages in flight are answered on their own threads, so the next send need not wait.
+    _impl->startExchange(std::move(*connection), std::move(request), std::move(ids));
+    return {};
+}
+
+auto HttpTransport::receive() -> Result<nlohmann::json>
+{
+    return receiveText().and_then([](std::string const& text) { return json::parse(text); });
+}
+
+auto HttpTransport::receiveText() -> Result<std::string>
+{
+    auto lock = std::unique_lock(_impl->mutex);
+    _impl->messageArrived.wait(lock, [this] { return !_impl->inbox.empty() || !_impl->connected; });
+    if (!_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport closed");
+    auto message = std::move(_impl->inbox.front());
+    _impl->inbox.pop_front();
+    return message;
+}
+
+void HttpTransport::close()
+{
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        if (!_impl->connected.exchange(false))
+            return;
+        for (auto const socket: _impl->activeSockets)
+            shutdownSocket(socket);
+        _impl->inbox.clear();
+    }
+    _impl->messageArrived.notify_all();
+    log::debug("MCP transport closed");
+}
+
+auto HttpTransport::isConnected() const -> bool
+{
+    return _impl->connected;
+}
+
+} // namespace mychat
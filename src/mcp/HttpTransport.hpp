@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <mcp/Transport.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief Location of an HTTP endpoint.
+struct HttpEndpoint
+{
+    std::string host;
+    std::uint16_t port = 80;
+    std::string path = "/"; ///< Including the query string, if any.
+};
+
+/// @brief Parses an `http://host[:port][/path]` URL.
+///
+/// `https://` URLs are rejected, since there is no TLS support; put a TLS-terminating proxy
+/// in front of remote servers instead.
+[[nodiscard]] auto parseHttpUrl(std::string_view url) -> Result<HttpEndpoint>;
+
+/// @brief Keeps idle HTTP/1.1 keep-alive connections for reuse.
+///
+/// Shared by all HttpTransport instances of a ServerManager, so servers behind the same host
+/// and port share their connections. Thread-safe.
+class HttpConnectionPool
+{
+  public:
+    /// @param maxIdlePerHost How many idle connections are kept per host and port.
+    /// @param idleTimeout How long an idle connection is kept; servers close them eventually.
+    explicit HttpConnectionPool(size_t maxIdlePerHost = 8,
+                                std::chrono::milliseconds idleTimeout = std::chrono::seconds(30));
+    ~HttpConnectionPool();
+
+    HttpConnectionPool(const HttpConnectionPool&) = delete;
+    HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+    /// @brief Returns the number of idle connections currently kept.
+    [[nodiscard]] auto idleConnectionCount() const -> size_t;
+
+    /// @brief Returns the number of connections opened so far.
+    [[nodiscard]] auto openedConnectionCount() const -> size_t;
+
+  private:
+    friend class HttpTransport;
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// @brief Configuration for connecting to a remote MCP server.
+struct HttpTransportConfig
+{
+    std::string url;                            ///< The server's MCP endpoint.
+    std::map<std::string, std::string> headers; ///< Sent with every request, e.g. Authorization.
+
+    /// How long connecting and writing a request may take; zero waits forever.
+    std::chrono::milliseconds requestTimeout {};
+
+    /// Where connections are taken from and returned to; a private pool is used if null.
+    std::shared_ptr<HttpConnectionPool> pool;
+};
+
+/// @brief Transport for the MCP Streamable HTTP protocol.
+///
+/// Each message is POSTed to the endpoint over a pooled keep-alive connection. The server
+/// answers with a plain JSON body or with a Server-Sent Events stream that carries the response
+/// along with any notifications; both are read on a background thread per request, so a
+/// long-running tool call does not hold up other requests. Once the server assigned a session,
+/// a GET stream is opened as well for messages the server sends on its own.
+///
+/// A request that fails at the HTTP level is answered with a JSON-RPC error response, so its
+/// caller does not wait for a response that never comes.
+class HttpTransport: public Transport
+{
+  public:
+    HttpTransport();
+    ~HttpTransport() override;
+
+    HttpTransport(const HttpTransport&) = delete;
+    HttpTransport& operator=(const HttpTransport&) = delete;
+
+    /// @brief Prepares the transport; the first connection is made by the first send().
+    /// @param config The endpoint configuration.
+    /// @return Success or an error, e.g. for a malformed URL.
+    [[nodiscard]] auto start(const HttpTransportConfig& config) -> VoidResult;
+
+    [[nodiscard]] auto send(const nlohmann::json& message) -> VoidResult override;
+    [[nodiscard]] auto receive() -> Result<nlohmann::json> override;
+    [[nodiscard]] auto receiveText() -> Result<std::string> override;
+    void close() override;
+    [[nodiscard]] auto isConnected() const -> bool override;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+} // namespace mychat
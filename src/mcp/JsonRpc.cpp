@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "JsonRpc.hpp"
 
+#include <core/JsonReader.hpp>
+
+#include <algorithm>
 #include <format>
 
 namespace mychat::jsonrpc
@@ -33,6 +36,24 @@ auto makeNotification(std::string_view method, nlohmann::json params) -> nlohman
     return msg;
 }
 
+auto makeResponse(nlohmann::json id, nlohmann::json result) -> nlohmann::json
+{
+    return nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", std::move(id) },
+        { "result", std::move(result) },
+    };
+}
+
+auto makeErrorResponse(nlohmann::json id, int code, std::string_view message) -> nlohmann::json
+{
+    return nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", std::move(id) },
+        { "error", { { "code", code }, { "message", message } } },
+    };
+}
+
 auto parseResponse(const nlohmann::json& message) -> Result<Response>
 {
     if (!message.contains("jsonrpc") || message["jsonrpc"] != "2.0")
@@ -65,4 +86,151 @@ auto parseResponse(const nlohmann::json& message) -> Result<Response>
     return response;
 }
 
+namespace
+{
+    /// @brief Reads the members of the message object at the reader's position into @p message.
+    auto scanOne(json::JsonReader& reader, std::string_view text, RawMessage& message) -> bool
+    {
+        auto const begin = reader.offset();
+        if (!reader.enterObject())
+            return false;
+        auto version = std::string {};
+        while (auto const key = reader.nextMember())
+        {
+            auto const isString = reader.peek() == json::JsonReader::Kind::String;
+            if (*key == "jsonrpc" && isString)
+                reader.readString(version);
+            else if (*key == "method" && isString)
+                reader.readString(message.method);
+            else if (*key == "id")
+            {
+                if (auto id = reader.readJson())
+                    message.id = std::move(*id);
+            }
+            else if (*key == "params")
+                message.params = reader.rawValue().value_or(std::string_view {});
+            else if (*key == "result")
+                message.result = reader.rawValue().value_or(std::string_view {});
+            else if (*key == "error")
+                message.error = reader.rawValue().value_or(std::string_view {});
+            else
+                reader.skipValue();
+        }
+        message.valid = version == "2.0";
+        message.text = text.substr(begin, reader.offset() - begin);
+        return !reader.failed();
+    }
+} // namespace
+
+auto scanMessage(std::string_view text) -> Result<std::vector<RawMessage>>
+{
+    auto reader = json::JsonReader(text);
+    auto messages = std::vector<RawMessage> {};
+    if (reader.peek() == json::JsonReader::Kind::Array)
+    {
+        reader.enterArray();
+        while (reader.nextElement())
+            if (!scanOne(reader, text, messages.emplace_back()))
+                break;
+    }
+    else
+        scanOne(reader, text, messages.emplace_back());
+
+    if (reader.failed() || reader.peek() != json::JsonReader::Kind::End)
+        return makeError(ErrorCode::ProtocolError,
+                         std::format("Malformed JSON-RPC message at byte {}", reader.offset()));
+    return messages;
+}
+
+auto parseRpcError(std::string_view text) -> RpcError
+{
+    auto const err = nlohmann::json::parse(text, nullptr, false);
+    if (!err.is_object())
+        return RpcError { .code = 0, .message = "Unknown error", .data = {} };
+    return RpcError {
+        .code = err.value("code", 0),
+        .message = err.value("message", "Unknown error"),
+        .data = err.value("data", nlohmann::json {}),
+    };
+}
+
+auto makeBatch(std::span<nlohmann::json> messages) -> nlohmann::json
+{
+    auto batch = nlohmann::json::array();
+    auto& items = batch.get_ref<nlohmann::json::array_t&>();
+    items.reserve(messages.size());
+    for (auto& message: messages)
+        items.push_back(std::move(message));
+    return batch;
+}
+
+auto requestIds(const nlohmann::json& message) -> std::vector<nlohmann::json>
+{
+    auto ids = std::vector<nlohmann::json> {};
+    auto const collect = [&](const nlohmann::json& item) {
+        if (item.is_object() && item.contains("method") && item.contains("id"))
+            ids.push_back(item["id"]);
+    };
+
+    if (message.is_array())
+        std::ranges::for_each(message, collect);
+    else
+        collect(message);
+    return ids;
+}
+
+auto parseBatchResponse(const nlohmann::json& message, std::span<const nlohmann::json> ids)
+    -> Result<std::vector<Response>>
+{
+    auto responses = std::vector<Response>(ids.size());
+    auto answered = std::vector<bool>(ids.size(), false);
+
+    auto const accept = [&](const nlohmann::json& item) -> VoidResult {
+        auto response = parseResponse(item);
+        if (!response)
+            return std::unexpected(response.error());
+
+        // An error without an ID rejects the batch as a whole.
+        if (response->id.is_null() && response->error)
+        {
+            for (auto i = size_t { 0 }; i < ids.size(); ++i)
+            {
+                if (!answered[i])
+                    responses[i] =
+                        Response { .id = ids[i], .result = std::nullopt, .error = response->error };
+                answered[i] = true;
+            }
+            return {};
+        }
+
+        auto const it = std::ranges::find(ids, response->id);
+        if (it == ids.end())
+            return makeError(ErrorCode::ProtocolError,
+                             std::format("Response to unknown request in batch: {}", response->id.dump()));
+        auto const index = static_cast<size_t>(std::distance(ids.begin(), it));
+        responses[index] = std::move(*response);
+        answered[index] = true;
+        return {};
+    };
+
+    if (message.is_array())
+    {
+        for (auto const& item: message)
+            if (auto accepted = accept(item); !accepted)
+                return std::unexpected(accepted.error());
+    }
+    else if (auto accepted = accept(message); !accepted)
+        return std::unexpected(accepted.error());
+
+    for (auto i = size_t { 0 }; i < ids.size(); ++i)
+        if (!answered[i])
+            responses[i] = Response {
+                .id = ids[i],
+                .result = std::nullopt,
+                .error = RpcError { .code = -32603, .message = "No response in batch", .data = {} },
+            };
+
+    return responses;
+}
+
 } // namespace mychat::jsonrpc
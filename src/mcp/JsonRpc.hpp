@@ -7,7 +7,10 @@
 
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace mychat::jsonrpc
 {
@@ -31,6 +34,20 @@ struct Response
     [[nodiscard]] auto isSuccess() const -> bool { return result.has_value(); }
 };
 
+/// @brief A received JSON-RPC message whose params, result and error are left as JSON text.
+///
+/// The views point into the text given to scanMessage().
+struct RawMessage
+{
+    std::string_view text;   ///< The whole message.
+    bool valid = false;      ///< Whether it is marked as JSON-RPC 2.0.
+    nlohmann::json id;       ///< Null if the message has none.
+    std::string method;      ///< Empty for responses.
+    std::string_view params; ///< Empty if absent, like the members below.
+    std::string_view result;
+    std::string_view error;
+};
+
 /// @brief Builds a JSON-RPC 2.0 request message.
 /// @param id The request ID.
 /// @param method The method name.
@@ -46,9 +63,54 @@ struct Response
 [[nodiscard]] auto makeNotification(std::string_view method, nlohmann::json params = nullptr)
     -> nlohmann::json;
 
+/// @brief Builds a JSON-RPC 2.0 success response, e.g. to answer a request sent by the server.
+/// @param id The ID of the request being answered.
+/// @param result The result value.
+/// @return The JSON-RPC response object.
+[[nodiscard]] auto makeResponse(nlohmann::json id, nlohmann::json result) -> nlohmann::json;
+
+/// @brief Builds a JSON-RPC 2.0 error response.
+/// @param id The ID of the request being answered.
+/// @param code The error code (e.g. -32601 for an unknown method).
+/// @param message A short description of the error.
+/// @return The JSON-RPC response object.
+[[nodiscard]] auto makeErrorResponse(nlohmann::json id, int code, std::string_view message) -> nlohmann::json;
+
 /// @brief Parses a JSON-RPC 2.0 response.
 /// @param message The JSON message to parse.
 /// @return The parsed response or an Error.
 [[nodiscard]] auto parseResponse(const nlohmann::json& message) -> Result<Response>;
 
+/// @brief Splits a received message, or each message of a batch, into its members without a DOM.
+///
+/// Only the envelope is read; params, result and error are skipped over, so the caller parses
+/// just what it needs, e.g. a tool result's text straight into its own strings.
+/// @param text A JSON-RPC message or batch, which the views of the result point into.
+/// @return One entry per message, or an Error if @p text is malformed.
+[[nodiscard]] auto scanMessage(std::string_view text) -> Result<std::vector<RawMessage>>;
+
+/// @brief Parses the error member of a response, see RawMessage::error.
+[[nodiscard]] auto parseRpcError(std::string_view text) -> RpcError;
+
+/// @brief Builds a JSON-RPC 2.0 batch of requests and notifications, sent as one message.
+/// @param messages The messages to send, in order. They are moved into the batch, leaving the
+///                 storage they are in to be reused.
+/// @return The JSON-RPC batch (an array).
+[[nodiscard]] auto makeBatch(std::span<nlohmann::json> messages) -> nlohmann::json;
+
+/// @brief Returns the IDs of the requests in a message or batch, in order.
+///
+/// Notifications and responses have no entry; the result is empty if nothing will be answered.
+[[nodiscard]] auto requestIds(const nlohmann::json& message) -> std::vector<nlohmann::json>;
+
+/// @brief Parses the answer to a batch and correlates it with the requests by ID.
+///
+/// Servers may answer a batch in any order, and answer one that they could not process at all
+/// with a single error response; both are accepted. Requests left unanswered get an internal error.
+/// @param message The JSON message to parse, an array of responses or a single response.
+/// @param ids The IDs of the requests in the batch, see requestIds().
+/// @return One response per entry of @p ids, in the same order, or an Error.
+[[nodiscard]] auto parseBatchResponse(const nlohmann::json& message, std::span<const nlohmann::json> ids)
+    -> Result<std::vector<Response>>;
+
 } // namespace mychat::jsonrpc
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief Splits a received byte stream into newline-delimited messages in linear time.
+///
+/// The newline search resumes where the previous one stopped, consumed messages are dropped
+/// in bulk, and reads go straight into the buffer's tail, so even a message arriving in many
+/// small reads costs time proportional to its size.
+class LineBuffer
+{
+  public:
+    /// @brief Bytes requested per read while messages are small.
+    static constexpr auto MinReadSize = size_t { 16 * 1024 };
+
+    /// @brief Upper bound the read size grows to while receiving a large message.
+    static constexpr auto MaxReadSize = size_t { 1024 * 1024 };
+
+    /// @brief Returns the next complete line without its newline, if one was received.
+    ///
+    /// The view stays valid until the next call to read() or clear().
+    [[nodiscard]] auto nextLine() -> std::optional<std::string_view>
+    {
+        auto const newlinePos = _buffer.find('\n', _scanOffset);
+        if (newlinePos != std::string::npos)
+        {
+            auto const line = std::string_view(_buffer).substr(_readOffset, newlinePos - _readOffset);
+            _readOffset = newlinePos + 1;
+            _scanOffset = _readOffset;
+            return line;
+        }
+        _scanOffset = _buffer.size();
+        return std::nullopt;
+    }
+
+    /// @brief Appends data obtained from @p read to the buffer.
+    /// @param read Called as `read(char* data, size_t size)`; returns the number of bytes it
+    ///             stored at @p data, or a negative value on failure.
+    /// @return The value returned by @p read.
+    template <typename ReadFn>
+    auto read(ReadFn&& read) -> std::int64_t
+    {
+        // Drop consumed messages once they make up half the buffer, which keeps the moves linear.
+        if (_readOffset > 0 && _readOffset >= _buffer.size() / 2)
+        {
+            _buffer.erase(0, _readOffset);
+            _scanOffset -= _readOffset;
+            _readOffset = 0;
+        }
+
+        // Read straight into the buffer's tail, without zero-filling it first.
+        auto const oldSize = _buffer.size();
+        auto const readSize = _readSize;
+        auto bytesRead = std::int64_t { 0 };
+        _buffer.resize_and_overwrite(oldSize + readSize, [&](char* data, size_t /*size*/) {
+            bytesRead = read(data + oldSize, readSize);
+            return oldSize + static_cast<size_t>(std::max(bytesRead, std::int64_t { 0 }));
+        });
+
+        // A message that fills whole reads is large; fetch it in fewer, bigger reads.
+        if (bytesRead > 0 && static_cast<size_t>(bytesRead) == readSize)
+            _readSize = std::min(readSize * 2, MaxReadSize);
+        return bytesRead;
+    }
+
+    /// @brief Discards all buffered data.
+    void clear()
+    {
+        _buffer.clear();
+        _readOffset = 0;
+        _scanOffset = 0;
+        _readSize = MinReadSize;
+    }
+
+  private:
+    std::string _buffer;    ///< Received data; messages before _readOffset are consumed.
+    size_t _readOffset = 0; ///< Start of the next message in _buffer.
+    size_t _scanOffset = 0; ///< Where the newline search resumes; none in [_readOffset, _scanOffset).
+    size_t _readSize = MinReadSize;
+};
+
+} // namespace mychat
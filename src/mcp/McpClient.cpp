@@ -1,25 +1,440 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "McpClient.hpp"
 
+#include <core/Base64.hpp>
+#include <core/JsonReader.hpp>
 #include <core/JsonUtils.hpp>
 #include <core/Log.hpp>
+#include <core/Trace.hpp>
 #include <mcp/JsonRpc.hpp>
 
+#include <algorithm>
 #include <format>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace mychat
 {
 
+namespace
+{
+
+    /// @brief The MCP revision requested by the client, the only one with JSON-RPC batching.
+    ///
+    /// Servers answer with the revision they speak. Newer revisions dropped batching again, so
+    /// batches are only sent to servers that agree on this one.
+    constexpr auto BatchingProtocolVersion = std::string_view("2025-03-26");
+
+    /// @brief Appends a line of text to the model-facing content of @p result.
+    void appendText(ToolResult& result, std::string text)
+    {
+        if (result.content.empty())
+            result.content = std::move(text);
+        else
+        {
+            result.content += '\n';
+            result.content += text;
+        }
+    }
+
+    using Kind = json::JsonReader::Kind;
+
+    /// @brief Reads the next value into @p out if it is a string, and skips it otherwise.
+    void readStringOrSkip(json::JsonReader& reader, std::string& out)
+    {
+        if (reader.peek() == Kind::String)
+            reader.readString(out);
+        else
+            reader.skipValue();
+    }
+
+    /// @brief Returns a ProtocolError for a result of @p method that is not valid JSON.
+    auto malformedResult(std::string_view method, json::JsonReader const& reader) -> Error
+    {
+        return Error { ErrorCode::ProtocolError,
+                       std::format("Malformed {} result at byte {}", method, reader.offset()) };
+    }
+
+    /// @brief Adds a base64 encoded content item to @p result as a blob, mentioning it in the text.
+    void appendBlob(ToolResult& result, std::string_view base64, std::string mimeType, std::string uri)
+    {
+        auto const what = uri.empty() ? std::format("{} content", mimeType) : std::format("resource {}", uri);
+        auto bytes = decodeBase64(base64);
+        if (!bytes)
+        {
+            log::warning("Ignoring undecodable {} in tool result", what);
+            appendText(result, std::format("[invalid {}]", what));
+            return;
+        }
+
+        appendText(result,
+                   uri.empty() ? std::format("[{}, {} bytes]", what, bytes->size())
+                               : std::format("[{} ({}, {} bytes)]", what, mimeType, bytes->size()));
+        result.blobs.push_back(ToolContentBlob {
+            .mimeType = std::move(mimeType),
+            .uri = std::move(uri),
+            .data = std::make_shared<std::vector<std::uint8_t>>(std::move(*bytes)),
+        });
+    }
+
+    /// @brief The members of a content item, or of the resource it embeds, that are used.
+    struct ContentFields
+    {
+        std::string type;
+        std::string text;
+        std::string data; ///< Base64 encoded; `data` of items, `blob` of resources.
+        std::string mimeType;
+        std::string uri;
+        bool hasText = false;
+        bool hasMimeType = false;
+    };
+
+    /// @brief Reads the content item object at the reader's position, whatever its member order.
+    /// @param resource Receives the embedded resource; null when reading one.
+    void readContentFields(json::JsonReader& reader, ContentFields& fields, ContentFields* resource)
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return;
+        }
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "type")
+                readStringOrSkip(reader, fields.type);
+            else if (*key == "text")
+            {
+                fields.hasText = true;
+                readStringOrSkip(reader, fields.text);
+            }
+            else if (*key == (resource ? "data" : "blob"))
+                readStringOrSkip(reader, fields.data);
+            else if (*key == "mimeType")
+            {
+                fields.hasMimeType = true;
+                readStringOrSkip(reader, fields.mimeType);
+            }
+            else if (*key == "uri")
+                readStringOrSkip(reader, fields.uri);
+            else if (*key == "resource" && resource && reader.peek() == Kind::Object)
+            {
+                resource->type = "resource";
+                readContentFields(reader, *resource, nullptr);
+            }
+            else
+                reader.skipValue();
+        }
+    }
+
+    /// @brief Adds one item of a `tools/call` result's content to @p result.
+    ///
+    /// The item's strings are moved into @p result, so large results are not held twice.
+    void appendContentItem(ToolResult& result, ContentFields& item, ContentFields& resource)
+    {
+        if (item.type == "text")
+            appendText(result, std::move(item.text));
+        else if (item.type == "image" || item.type == "audio")
+            appendBlob(result, item.data, std::move(item.mimeType), {});
+        else if (item.type == "resource" && resource.type == "resource")
+        {
+            if (resource.hasText)
+                appendText(result, std::move(resource.text));
+            else
+                appendBlob(result,
+                           resource.data,
+                           resource.hasMimeType ? std::move(resource.mimeType) : "application/octet-stream",
+                           std::move(resource.uri));
+        }
+        else if (item.type == "resource_link")
+            appendText(result, std::format("[resource {}]", item.uri));
+        else
+            log::debug("Ignoring tool result content of type '{}'", item.type);
+    }
+
+    /// @brief Reads a `tools/call` result into a ToolResult.
+    auto parseToolResult(std::string_view text) -> Result<ToolResult>
+    {
+        auto toolResult = ToolResult {};
+        auto reader = json::JsonReader(text);
+        if (reader.peek() != Kind::Object)
+            return toolResult;
+
+        reader.enterObject();
+        auto item = ContentFields {};
+        auto resource = ContentFields {};
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "isError" && reader.peek() == Kind::Boolean)
+                reader.readBoolean(toolResult.isError);
+            else if (*key == "content" && reader.peek() == Kind::Array)
+            {
+                reader.enterArray();
+                while (reader.nextElement())
+                {
+                    item = ContentFields {};
+                    resource = ContentFields {};
+                    readContentFields(reader, item, &resource);
+                    if (!reader.failed())
+                        appendContentItem(toolResult, item, resource);
+                }
+            }
+            else
+                reader.skipValue();
+        }
+        if (reader.failed())
+            return std::unexpected(malformedResult("tools/call", reader));
+        return toolResult;
+    }
+
+    /// @brief Reads the tool definition object at the reader's position; only its schema becomes a DOM.
+    auto readToolDefinition(json::JsonReader& reader) -> std::optional<ToolDefinition>
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return std::nullopt;
+        }
+        auto tool = ToolDefinition {};
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "name")
+                readStringOrSkip(reader, tool.name);
+            else if (*key == "description")
+                readStringOrSkip(reader, tool.description);
+            else if (*key == "inputSchema")
+            {
+                if (auto schema = reader.readJson())
+                    tool.inputSchema = std::move(*schema);
+            }
+            else
+                reader.skipValue();
+        }
+        if (tool.inputSchema.is_null())
+            tool.inputSchema = nlohmann::json::object();
+        return tool;
+    }
+
+    /// @brief Reads the array @p member of a list result, e.g. `tools/list`'s tools, with @p readItem.
+    template <typename ReadItem>
+    auto parseList(std::string_view text, std::string_view method, std::string_view member, ReadItem readItem)
+        -> Result<std::vector<typename std::invoke_result_t<ReadItem&, json::JsonReader&>::value_type>>
+    {
+        auto items = std::vector<typename std::invoke_result_t<ReadItem&, json::JsonReader&>::value_type> {};
+        auto reader = json::JsonReader(text);
+        if (reader.peek() != Kind::Object)
+            return items;
+
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key != member || reader.peek() != Kind::Array)
+            {
+                reader.skipValue();
+                continue;
+            }
+            reader.enterArray();
+            while (reader.nextElement())
+                if (auto item = readItem(reader))
+                    items.push_back(std::move(*item));
+        }
+        if (reader.failed())
+            return std::unexpected(malformedResult(method, reader));
+        return items;
+    }
+
+    /// @brief Reads the resource object of a `resources/list` result at the reader's position.
+    auto readResourceEntry(json::JsonReader& reader) -> std::optional<McpResource>
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return std::nullopt;
+        }
+        auto resource = McpResource {};
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "uri")
+                readStringOrSkip(reader, resource.uri);
+            else if (*key == "name")
+                readStringOrSkip(reader, resource.name);
+            else if (*key == "description")
+                readStringOrSkip(reader, resource.description);
+            else if (*key == "mimeType")
+                readStringOrSkip(reader, resource.mimeType);
+            else
+                reader.skipValue();
+        }
+        if (resource.uri.empty())
+            return std::nullopt;
+        return resource;
+    }
+
+    /// @brief Reads an item of a `resources/read` result, decoding the content of binary ones.
+    auto readResourceContent(json::JsonReader& reader) -> std::optional<McpResourceContent>
+    {
+        auto fields = ContentFields {};
+        readContentFields(reader, fields, nullptr);
+        auto content = McpResourceContent {
+            .uri = std::move(fields.uri),
+            .mimeType = std::move(fields.mimeType),
+            .text = std::move(fields.text),
+            .blob = {},
+        };
+        if (fields.hasText)
+            return content;
+
+        auto bytes = decodeBase64(fields.data);
+        if (!bytes)
+        {
+            log::warning("Ignoring undecodable contents of resource {}", content.uri);
+            return std::nullopt;
+        }
+        content.blob = std::make_shared<std::vector<std::uint8_t>>(std::move(*bytes));
+        return content;
+    }
+
+    /// @brief Reads the argument object of a `prompts/list` entry at the reader's position.
+    auto readPromptArgument(json::JsonReader& reader) -> std::optional<McpPromptArgument>
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return std::nullopt;
+        }
+        auto argument = McpPromptArgument {};
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "name")
+                readStringOrSkip(reader, argument.name);
+            else if (*key == "description")
+                readStringOrSkip(reader, argument.description);
+            else if (*key == "required" && reader.peek() == Kind::Boolean)
+                reader.readBoolean(argument.required);
+            else
+                reader.skipValue();
+        }
+        return argument;
+    }
+
+    /// @brief Reads the prompt object of a `prompts/list` result at the reader's position.
+    auto readPromptEntry(json::JsonReader& reader) -> std::optional<McpPromptInfo>
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return std::nullopt;
+        }
+        auto prompt = McpPromptInfo {};
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "name")
+                readStringOrSkip(reader, prompt.name);
+            else if (*key == "description")
+                readStringOrSkip(reader, prompt.description);
+            else if (*key == "arguments" && reader.peek() == Kind::Array)
+            {
+                reader.enterArray();
+                while (reader.nextElement())
+                    if (auto argument = readPromptArgument(reader))
+                        prompt.arguments.push_back(std::move(*argument));
+            }
+            else
+                reader.skipValue();
+        }
+        if (prompt.name.empty())
+            return std::nullopt;
+        return prompt;
+    }
+
+    /// @brief Reads a message of a `prompts/get` result, whose content is a single item.
+    auto readPromptMessage(json::JsonReader& reader) -> std::optional<ChatMessage>
+    {
+        if (reader.peek() != Kind::Object)
+        {
+            reader.skipValue();
+            return std::nullopt;
+        }
+        auto role = std::string {};
+        auto content = ToolResult {};
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "role")
+                readStringOrSkip(reader, role);
+            else if (*key == "content")
+            {
+                auto item = ContentFields {};
+                auto resource = ContentFields {};
+                readContentFields(reader, item, &resource);
+                if (!reader.failed())
+                    appendContentItem(content, item, resource);
+            }
+            else
+                reader.skipValue();
+        }
+        if (role != "user" && role != "assistant")
+            return std::nullopt;
+        return ChatMessage {
+            .role = role == "user" ? Role::User : Role::Assistant,
+            .content = std::move(content.content),
+            .toolCalls = {},
+            .toolCallId = {},
+        };
+    }
+
+    /// @brief Reads a `prompts/get` result.
+    auto parsePrompt(std::string_view text) -> Result<McpPrompt>
+    {
+        auto prompt = McpPrompt {};
+        auto reader = json::JsonReader(text);
+        if (reader.peek() != Kind::Object)
+            return prompt;
+
+        reader.enterObject();
+        while (auto const key = reader.nextMember())
+        {
+            if (*key == "description")
+                readStringOrSkip(reader, prompt.description);
+            else if (*key == "messages" && reader.peek() == Kind::Array)
+            {
+                reader.enterArray();
+                while (reader.nextElement())
+                    if (auto message = readPromptMessage(reader))
+                        prompt.messages.push_back(std::move(*message));
+            }
+            else
+                reader.skipValue();
+        }
+        if (reader.failed())
+            return std::unexpected(malformedResult("prompts/get", reader));
+        return prompt;
+    }
+
+} // namespace
+
 McpClient::McpClient(std::unique_ptr<Transport> transport): _transport(std::move(transport))
 {
 }
 
-McpClient::~McpClient() = default;
+McpClient::~McpClient()
+{
+    // Closing the transport unblocks the reader's pending receive().
+    _reader.request_stop();
+    _transport->close();
+    if (_reader.joinable())
+        _reader.join();
+}
 
-auto McpClient::initialize() -> Result<McpServerCapabilities>
+auto McpClient::initialize(std::stop_token stopToken) -> Result<McpServerCapabilities>
 {
     auto params = nlohmann::json {
-        { "protocolVersion", "2024-11-05" },
+        { "protocolVersion", BatchingProtocolVersion },
         { "capabilities", nlohmann::json::object() },
         { "clientInfo",
           nlohmann::json {
@@ -28,7 +443,8 @@ auto McpClient::initialize() -> Result<McpServerCapabilities>
           } },
     };
 
-    return sendRequest("initialize", std::move(params))
+    return sendRequest("initialize", std::move(params), std::move(stopToken))
+        .and_then([](std::string const& text) { return json::parse(text); })
         .and_then([this](const nlohmann::json& result) -> Result<McpServerCapabilities> {
             _capabilities.serverName =
                 json::getStringOr(result.value("serverInfo", nlohmann::json {}), "name", "unknown");
@@ -41,11 +457,16 @@ auto McpClient::initialize() -> Result<McpServerCapabilities>
                 _capabilities.hasTools = caps.contains("tools");
                 _capabilities.hasResources = caps.contains("resources");
                 _capabilities.hasPrompts = caps.contains("prompts");
+                _capabilities.supportsResourceSubscriptions =
+                    caps.contains("resources") && caps["resources"].is_object()
+                    && caps["resources"].value("subscribe", false);
             }
+            _capabilities.protocolVersion = json::getStringOr(result, "protocolVersion", "");
+            _capabilities.supportsBatching = _capabilities.protocolVersion == BatchingProtocolVersion;
+            _batching = _capabilities.supportsBatching;
 
-            // Send initialized notification
-            auto notif = jsonrpc::makeNotification("notifications/initialized");
-            (void) _transport->send(notif);
+            // Goes out in the same write as the next request, typically tools/list.
+            queue(jsonrpc::makeNotification("notifications/initialized"));
 
             _initialized = true;
             log::info(
@@ -55,63 +476,109 @@ auto McpClient::initialize() -> Result<McpServerCapabilities>
         });
 }
 
-auto McpClient::listTools() -> Result<std::vector<ToolDefinition>>
+auto McpClient::listTools(std::stop_token stopToken) -> Result<std::vector<ToolDefinition>>
+{
+    if (!_initialized)
+        return makeError(ErrorCode::ProtocolError, "Client not initialized");
+
+    return sendRequest("tools/list", nullptr, std::move(stopToken))
+        .and_then([](std::string const& text) {
+            return parseList(text, "tools/list", "tools", readToolDefinition);
+        });
+}
+
+auto McpClient::callTool(std::string_view name, const nlohmann::json& arguments, std::stop_token stopToken)
+    -> Result<ToolResult>
 {
     if (!_initialized)
         return makeError(ErrorCode::ProtocolError, "Client not initialized");
 
-    return sendRequest("tools/list")
-        .and_then([](const nlohmann::json& result) -> Result<std::vector<ToolDefinition>> {
-            auto tools = std::vector<ToolDefinition> {};
+    auto params = nlohmann::json {
+        { "name", name },
+        { "arguments", arguments },
+    };
 
-            if (!result.contains("tools") || !result["tools"].is_array())
-                return tools;
+    return sendRequest("tools/call", std::move(params), std::move(stopToken))
+        .and_then([](std::string const& text) { return parseToolResult(text); })
+        .transform([&name](ToolResult toolResult) {
+            log::debug("Tool '{}' returned {} characters and {} binary item(s) (isError: {})",
+                       name,
+                       toolResult.content.size(),
+                       toolResult.blobs.size(),
+                       toolResult.isError);
+            return toolResult;
+        });
+}
 
-            for (const auto& toolJson: result["tools"])
-            {
-                auto tool = ToolDefinition {
-                    .name = toolJson.value("name", ""),
-                    .description = toolJson.value("description", ""),
-                    .inputSchema = toolJson.value("inputSchema", nlohmann::json::object()),
-                };
-                tools.push_back(std::move(tool));
-            }
+auto McpClient::listResources(std::stop_token stopToken) -> Result<std::vector<McpResource>>
+{
+    if (!_initialized)
+        return makeError(ErrorCode::ProtocolError, "Client not initialized");
 
-            return tools;
+    return sendRequest("resources/list", nullptr, std::move(stopToken))
+        .and_then([](std::string const& text) {
+            return parseList(text, "resources/list", "resources", readResourceEntry);
         });
 }
 
-auto McpClient::callTool(std::string_view name, const nlohmann::json& arguments) -> Result<ToolResult>
+auto McpClient::readResource(std::string_view uri, std::stop_token stopToken)
+    -> Result<std::vector<McpResourceContent>>
+{
+    if (!_initialized)
+        return makeError(ErrorCode::ProtocolError, "Client not initialized");
+
+    return sendRequest("resources/read", nlohmann::json { { "uri", uri } }, std::move(stopToken))
+        .and_then([](std::string const& text) {
+            return parseList(text, "resources/read", "contents", readResourceContent);
+        });
+}
+
+auto McpClient::subscribeResource(std::string_view uri, std::stop_token stopToken) -> VoidResult
+{
+    if (!_initialized)
+        return makeError(ErrorCode::ProtocolError, "Client not initialized");
+
+    auto result = sendRequest("resources/subscribe", nlohmann::json { { "uri", uri } }, std::move(stopToken));
+    if (!result)
+        return std::unexpected(result.error());
+    return {};
+}
+
+auto McpClient::listPrompts(std::stop_token stopToken) -> Result<std::vector<McpPromptInfo>>
+{
+    if (!_initialized)
+        return makeError(ErrorCode::ProtocolError, "Client not initialized");
+
+    return sendRequest("prompts/list", nullptr, std::move(stopToken))
+        .and_then([](std::string const& text) {
+            return parseList(text, "prompts/list", "prompts", readPromptEntry);
+        });
+}
+
+auto McpClient::getPrompt(std::string_view name, const nlohmann::json& arguments, std::stop_token stopToken)
+    -> Result<McpPrompt>
 {
     if (!_initialized)
         return makeError(ErrorCode::ProtocolError, "Client not initialized");
 
     auto params = nlohmann::json {
         { "name", name },
-        { "arguments", arguments },
+        { "arguments", arguments.is_null() ? nlohmann::json::object() : arguments },
     };
 
-    return sendRequest("tools/call", std::move(params))
-        .and_then([&name](const nlohmann::json& result) -> Result<ToolResult> {
-            auto toolResult = ToolResult {};
-            toolResult.isError = result.value("isError", false);
+    return sendRequest("prompts/get", std::move(params), std::move(stopToken))
+        .and_then([](std::string const& text) { return parsePrompt(text); });
+}
 
-            if (result.contains("content") && result["content"].is_array())
-            {
-                for (const auto& item: result["content"])
-                {
-                    if (item.value("type", "") == "text")
-                    {
-                        if (!toolResult.content.empty())
-                            toolResult.content += "\n";
-                        toolResult.content += item.value("text", "");
-                    }
-                }
-            }
+void McpClient::setRequestTimeout(std::chrono::milliseconds timeout)
+{
+    _requestTimeout.store(timeout, std::memory_order_relaxed);
+}
 
-            log::debug("Tool '{}' returned: {} (isError: {})", name, toolResult.content, toolResult.isError);
-            return toolResult;
-        });
+void McpClient::setNotificationHandler(McpNotificationHandler handler)
+{
+    auto const lock = std::lock_guard(_mutex);
+    _notificationHandler = std::move(handler);
 }
 
 auto McpClient::capabilities() const -> const McpServerCapabilities&
@@ -124,25 +591,201 @@ auto McpClient::isInitialized() const -> bool
     return _initialized;
 }
 
-auto McpClient::sendRequest(std::string_view method, nlohmann::json params) -> Result<nlohmann::json>
+auto McpClient::sendRequest(std::string_view method, nlohmann::json params, std::stop_token stopToken)
+    -> Result<std::string>
 {
+    auto const zone = trace::Zone("mcp", "request", method);
     auto const id = _nextId++;
-    auto request = jsonrpc::makeRequest(id, method, std::move(params));
-
-    return _transport->send(request)
-        .and_then([this]() -> Result<nlohmann::json> { return _transport->receive(); })
-        .and_then([](const nlohmann::json& msg) -> Result<nlohmann::json> {
-            return jsonrpc::parseResponse(msg).and_then(
-                [](const jsonrpc::Response& resp) -> Result<nlohmann::json> {
-                    if (resp.error)
-                    {
-                        return makeError(
-                            ErrorCode::ProtocolError,
-                            std::format("RPC error {}: {}", resp.error->code, resp.error->message));
-                    }
-                    return resp.result.value_or(nlohmann::json::object());
-                });
-        });
+    auto response = std::future<Result<std::string>> {};
+    {
+        auto const lock = std::lock_guard(_mutex);
+        if (_readerError)
+            return std::unexpected(*_readerError);
+        response = _pending[id].get_future();
+        if (!_reader.joinable())
+            _reader = std::jthread([this](std::stop_token readerStop) { readLoop(std::move(readerStop)); });
+    }
+
+    if (auto sent = send(jsonrpc::makeRequest(id, method, std::move(params))); !sent)
+        complete(id, std::unexpected(sent.error()));
+
+    auto const cancel = [this, id, method = std::string(method)] {
+        abandon(id,
+                Error { ErrorCode::ToolCallError, std::format("Request '{}' cancelled", method) },
+                "Cancelled by the user");
+    };
+    auto const onStop = std::stop_callback(stopToken, cancel);
+
+    auto const timeout = _requestTimeout.load(std::memory_order_relaxed);
+    if (timeout > std::chrono::milliseconds::zero()
+        && response.wait_for(timeout) == std::future_status::timeout)
+    {
+        abandon(id,
+                Error { ErrorCode::TimeoutError,
+                        std::format("Request '{}' timed out after {} ms", method, timeout.count()) },
+                "Request timed out");
+    }
+
+    return response.get();
+}
+
+void McpClient::abandon(int64_t id, Error error, std::string_view reason)
+{
+    {
+        auto const lock = std::lock_guard(_mutex);
+        auto const it = _pending.find(id);
+        if (it == _pending.end())
+            return; // Already answered.
+        it->second.set_value(std::unexpected(std::move(error)));
+        _pending.erase(it);
+    }
+
+    auto params = nlohmann::json { { "requestId", id }, { "reason", reason } };
+    (void) send(jsonrpc::makeNotification("notifications/cancelled", std::move(params)));
+}
+
+auto McpClient::send(nlohmann::json message) -> VoidResult
+{
+    auto lock = std::unique_lock(_outboxMutex);
+    _outbox.push_back(std::move(message));
+    auto const ticket = ++_queuedCount;
+
+    while (_writtenCount < ticket && !_writeError)
+    {
+        if (_writing)
+        {
+            _outboxChanged.wait(lock);
+            continue;
+        }
+
+        _writing = true;
+        std::swap(_batch, _outbox);
+        auto const batchEnd = _queuedCount;
+        lock.unlock();
+
+        // JSON-RPC batches hold either requests and notifications or responses, never both.
+        auto const asBatch = _batching && _batch.size() > 1
+                             && std::ranges::all_of(_batch, [](nlohmann::json const& queued) {
+                                    return queued.contains("method");
+                                });
+        auto written = asBatch ? _transport->send(jsonrpc::makeBatch(_batch))
+                               : _transport->sendBatch(_batch);
+        _batch.clear();
+        if (!written)
+        {
+            // Some of the batch may have gone out, so the stream cannot be trusted anymore;
+            // closing it fails the pending requests as well.
+            _transport->close();
+        }
+
+        lock.lock();
+        _writing = false;
+        if (written)
+            _writtenCount = batchEnd;
+        else
+            _writeError = std::move(written.error());
+        _outboxChanged.notify_all();
+    }
+
+    if (_writtenCount >= ticket)
+        return {};
+    return std::unexpected(*_writeError);
+}
+
+void McpClient::queue(nlohmann::json message)
+{
+    auto const lock = std::lock_guard(_outboxMutex);
+    _outbox.push_back(std::move(message));
+    ++_queuedCount;
+}
+
+void McpClient::readLoop(std::stop_token stopToken)
+{
+    while (!stopToken.stop_requested())
+    {
+        auto message = _transport->receiveText();
+        if (!message)
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _readerError = stopToken.stop_requested() ? Error { ErrorCode::TransportError, "Client closed" }
+                                                      : message.error();
+            for (auto& [id, promise]: _pending)
+                promise.set_value(std::unexpected(*_readerError));
+            _pending.clear();
+            return;
+        }
+        dispatch(*message);
+    }
+}
+
+void McpClient::dispatch(std::string_view text)
+{
+    auto const messages = jsonrpc::scanMessage(text);
+    if (!messages)
+    {
+        log::warning("Ignoring MCP message: {}", messages.error().message);
+        return;
+    }
+    for (auto const& message: *messages)
+        dispatch(message);
+}
+
+void McpClient::dispatch(jsonrpc::RawMessage const& message)
+{
+    if (!message.method.empty())
+    {
+        auto const& method = message.method;
+
+        // Requests from the server: answer pings, reject everything else.
+        if (!message.id.is_null())
+        {
+            auto reply = method == "ping"
+                             ? jsonrpc::makeResponse(message.id, nlohmann::json::object())
+                             : jsonrpc::makeErrorResponse(message.id, -32601, "Method not found");
+            (void) send(std::move(reply));
+            return;
+        }
+
+        auto handler = McpNotificationHandler {};
+        {
+            auto const lock = std::lock_guard(_mutex);
+            handler = _notificationHandler;
+        }
+        if (!handler)
+            log::debug("Ignoring MCP notification: {}", method);
+        else if (message.params.empty())
+            handler(method, nlohmann::json::object());
+        else
+            handler(method, nlohmann::json::parse(message.params, nullptr, false));
+        return;
+    }
+
+    auto const answered = !message.result.empty() || !message.error.empty();
+    if (!message.valid || !message.id.is_number_integer() || !answered)
+    {
+        log::warning("Ignoring unexpected MCP message: {}", message.text);
+        return;
+    }
+
+    auto const id = message.id.get<int64_t>();
+    if (!message.result.empty())
+        complete(id, std::string(message.result));
+    else
+    {
+        auto const error = jsonrpc::parseRpcError(message.error);
+        auto const what = std::format("RPC error {}: {}", error.code, error.message);
+        complete(id, makeError(ErrorCode::ProtocolError, what));
+    }
+}
+
+void McpClient::complete(int64_t id, Result<std::string> result)
+{
+    auto const lock = std::lock_guard(_mutex);
+    auto const it = _pending.find(id);
+    if (it == _pending.end())
+        return; // Already cancelled, or a response to an unknown request.
+    it->second.set_value(std::move(result));
+    _pending.erase(it);
 }
 
 } // namespace mychat
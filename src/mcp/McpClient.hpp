@@ -3,11 +3,23 @@
 
 #include <core/Error.hpp>
 #include <core/Types.hpp>
+#include <mcp/JsonRpc.hpp>
 #include <mcp/Transport.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace mychat
@@ -21,11 +33,75 @@ struct McpServerCapabilities
     bool hasPrompts = false;
     std::string serverName;
     std::string serverVersion;
+    std::string protocolVersion;                ///< The MCP revision the server agreed on.
+    bool supportsBatching = false;              ///< Whether JSON-RPC batches may be sent (MCP 2025-03-26).
+    bool supportsResourceSubscriptions = false; ///< Whether `resources/subscribe` may be sent.
 };
 
+/// @brief A resource a server offers, as listed by `resources/list`.
+struct McpResource
+{
+    std::string server; ///< Name of the server offering it; set by ServerManager.
+    std::string uri;
+    std::string name;
+    std::string description;
+    std::string mimeType;
+};
+
+/// @brief One item of a resource's contents, as read by `resources/read`.
+struct McpResourceContent
+{
+    std::string uri;
+    std::string mimeType;
+    std::string text;                                      ///< The content of a text resource.
+    std::shared_ptr<const std::vector<std::uint8_t>> blob; ///< The content of a binary one; null for text.
+};
+
+/// @brief An argument a prompt template takes.
+struct McpPromptArgument
+{
+    std::string name;
+    std::string description;
+    bool required = false;
+};
+
+/// @brief A prompt template a server offers, as listed by `prompts/list`.
+struct McpPromptInfo
+{
+    std::string server; ///< Name of the server offering it; set by ServerManager.
+    std::string name;
+    std::string description;
+    std::vector<McpPromptArgument> arguments;
+};
+
+/// @brief A prompt template filled in by the server, as returned by `prompts/get`.
+///
+/// Binary content of its messages is mentioned in their text rather than kept.
+struct McpPrompt
+{
+    std::string description;
+    std::vector<ChatMessage> messages; ///< User and assistant messages.
+};
+
+/// @brief Callback receiving notifications sent by the server (method and params).
+using McpNotificationHandler = std::function<void(std::string_view method, const nlohmann::json& params)>;
+
 /// @brief Client for the Model Context Protocol (MCP).
 ///
-/// Handles the MCP lifecycle: initialize, list tools, call tools.
+/// Handles the MCP lifecycle: initialize, list tools, call tools, and read resources and
+/// prompts of servers that offer them.
+///
+/// Requests are multiplexed over the transport: a reader thread, started with the first
+/// request, dispatches responses to the waiting callers by request ID and routes server
+/// notifications to the notification handler. All request methods may be called from
+/// several threads at once, so many requests can be in flight per server.
+///
+/// If the server agrees on an MCP revision with JSON-RPC batching, messages that are written
+/// together go out as one batch; otherwise they are written back to back.
+///
+/// Received messages are not parsed into a DOM: the reader only scans their envelope, and tool
+/// results and lists are read from the result text straight into ToolResult and ToolDefinition.
+/// Only input schemas and notification params become nlohmann::json values.
 class McpClient
 {
   public:
@@ -38,18 +114,69 @@ class McpClient
     McpClient& operator=(const McpClient&) = delete;
 
     /// @brief Performs the MCP initialize handshake.
+    /// @param stopToken Abandons the handshake, e.g. when the server is too slow to start.
     /// @return The server's capabilities or an error.
-    [[nodiscard]] auto initialize() -> Result<McpServerCapabilities>;
+    [[nodiscard]] auto initialize(std::stop_token stopToken = {}) -> Result<McpServerCapabilities>;
 
     /// @brief Lists available tools from the server.
+    /// @param stopToken Abandons the request.
     /// @return A vector of tool definitions or an error.
-    [[nodiscard]] auto listTools() -> Result<std::vector<ToolDefinition>>;
+    [[nodiscard]] auto listTools(std::stop_token stopToken = {}) -> Result<std::vector<ToolDefinition>>;
 
     /// @brief Calls a tool on the server.
     /// @param name The tool name.
     /// @param arguments The tool arguments.
+    /// @param stopToken Cancels the call: the server is sent `notifications/cancelled` and
+    ///                  the call returns an error without waiting for the response.
     /// @return The tool result or an error.
-    [[nodiscard]] auto callTool(std::string_view name, const nlohmann::json& arguments) -> Result<ToolResult>;
+    [[nodiscard]] auto callTool(std::string_view name,
+                                const nlohmann::json& arguments,
+                                std::stop_token stopToken = {}) -> Result<ToolResult>;
+
+    /// @brief Lists the resources the server offers.
+    /// @param stopToken Abandons the request.
+    /// @return The resources or an error.
+    [[nodiscard]] auto listResources(std::stop_token stopToken = {}) -> Result<std::vector<McpResource>>;
+
+    /// @brief Reads the contents of a resource.
+    /// @param uri The resource's URI.
+    /// @param stopToken Abandons the request.
+    /// @return The items of its contents or an error.
+    [[nodiscard]] auto readResource(std::string_view uri, std::stop_token stopToken = {})
+        -> Result<std::vector<McpResourceContent>>;
+
+    /// @brief Asks the server to send `notifications/resources/updated` whenever a resource changes.
+    ///
+    /// Only servers with McpServerCapabilities::supportsResourceSubscriptions accept it.
+    /// @param uri The resource's URI.
+    /// @param stopToken Abandons the request.
+    /// @return Success or an error.
+    [[nodiscard]] auto subscribeResource(std::string_view uri, std::stop_token stopToken = {}) -> VoidResult;
+
+    /// @brief Lists the prompt templates the server offers.
+    /// @param stopToken Abandons the request.
+    /// @return The prompts or an error.
+    [[nodiscard]] auto listPrompts(std::stop_token stopToken = {}) -> Result<std::vector<McpPromptInfo>>;
+
+    /// @brief Fills in a prompt template.
+    /// @param name The prompt's name.
+    /// @param arguments The values of its arguments, an object of strings.
+    /// @param stopToken Abandons the request.
+    /// @return The prompt's messages or an error.
+    [[nodiscard]] auto getPrompt(std::string_view name,
+                                 const nlohmann::json& arguments,
+                                 std::stop_token stopToken = {}) -> Result<McpPrompt>;
+
+    /// @brief Sets how long a request may wait for its response; zero (the default) waits forever.
+    ///
+    /// A request that runs out of time fails with ErrorCode::TimeoutError and the server is
+    /// sent `notifications/cancelled` for it.
+    void setRequestTimeout(std::chrono::milliseconds timeout);
+
+    /// @brief Sets the handler for server notifications (e.g. `notifications/progress`).
+    ///
+    /// The handler runs on the reader thread and must not block.
+    void setNotificationHandler(McpNotificationHandler handler);
 
     /// @brief Returns the server capabilities (valid after initialize).
     [[nodiscard]] auto capabilities() const -> const McpServerCapabilities&;
@@ -60,11 +187,55 @@ class McpClient
   private:
     std::unique_ptr<Transport> _transport;
     McpServerCapabilities _capabilities;
-    int64_t _nextId = 1;
-    bool _initialized = false;
+    std::atomic<int64_t> _nextId = 1;
+    std::atomic<bool> _initialized = false;
+    std::atomic<bool> _batching = false; ///< Whether coalesced messages are sent as JSON-RPC batches.
+    std::atomic<std::chrono::milliseconds> _requestTimeout = std::chrono::milliseconds::zero();
+
+    std::mutex _outboxMutex; ///< Guards the outgoing messages below.
+    std::condition_variable _outboxChanged;
+    std::vector<nlohmann::json> _outbox; ///< Messages waiting to be written.
+    std::vector<nlohmann::json> _batch;  ///< Messages being written; reused across batches.
+    uint64_t _queuedCount = 0;           ///< Messages ever queued.
+    uint64_t _writtenCount = 0;          ///< Messages handed to the transport, in queue order.
+    bool _writing = false;               ///< Whether a thread is writing a batch.
+    std::optional<Error> _writeError;    ///< Why writing failed; fails all further sends.
+
+    std::mutex _mutex; ///< Guards the members below.
+    std::unordered_map<int64_t, std::promise<Result<std::string>>> _pending; ///< Answered with result text.
+    std::optional<Error> _readerError; ///< Why the reader stopped; fails all further requests.
+    McpNotificationHandler _notificationHandler;
+    std::jthread _reader;
+
+    /// @brief Sends a request and waits for its response.
+    /// @return The JSON text of the result, or an error.
+    [[nodiscard]] auto sendRequest(std::string_view method,
+                                   nlohmann::json params = nullptr,
+                                   std::stop_token stopToken = {}) -> Result<std::string>;
+
+    /// @brief Sends a message to the server, together with all messages queued before it.
+    ///
+    /// Whichever sender finds the transport idle writes everything queued so far as one
+    /// batch, so messages from concurrent senders are coalesced into fewer writes.
+    [[nodiscard]] auto send(nlohmann::json message) -> VoidResult;
+
+    /// @brief Queues a notification that goes out with the next send().
+    void queue(nlohmann::json message);
+
+    /// @brief Receives messages until the transport fails or stop is requested.
+    void readLoop(std::stop_token stopToken);
+
+    /// @brief Handles one message received from the server, which may be a batch.
+    void dispatch(std::string_view text);
+
+    /// @brief Handles one message of what dispatch() received.
+    void dispatch(jsonrpc::RawMessage const& message);
+
+    /// @brief Fails a request that is still pending and tells the server to stop working on it.
+    void abandon(int64_t id, Error error, std::string_view reason);
 
-    [[nodiscard]] auto sendRequest(std::string_view method, nlohmann::json params = nullptr)
-        -> Result<nlohmann::json>;
+    /// @brief Completes a pending request with @p result, if it is still pending.
+    void complete(int64_t id, Result<std::string> result);
 };
 
 } // namespace mychat
@@ -0,0 +1,704 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "McpDaemon.hpp"
+
+#include <core/Hash.hpp>
+#include <core/JsonUtils.hpp>
+#include <core/Log.hpp>
+#include <mcp/JsonRpc.hpp>
+#include <mcp/LineBuffer.hpp>
+#include <mcp/StdioTransport.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+namespace mychat
+{
+
+auto defaultMcpDaemonSocketPath() -> std::string
+{
+    if (auto const* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir)
+        return (std::filesystem::path(runtimeDir) / "mychat-mcpd.sock").string();
+#ifdef _WIN32
+    return (std::filesystem::temp_directory_path() / "mychat-mcpd.sock").string();
+#else
+    return (std::filesystem::temp_directory_path() / std::format("mychat-mcpd-{}.sock", getuid())).string();
+#endif
+}
+
+#ifdef _WIN32
+
+struct McpDaemon::Impl
+{
+};
+
+McpDaemon::McpDaemon(): _impl(std::make_unique<Impl>())
+{
+}
+
+McpDaemon::~McpDaemon() = default;
+
+auto McpDaemon::start(std::string /*socketPath*/) -> VoidResult
+{
+    return makeError(ErrorCode::TransportError, "mychat-mcpd requires Unix domain sockets");
+}
+
+void McpDaemon::stop()
+{
+}
+
+auto McpDaemon::clientCount() const -> size_t
+{
+    return 0;
+}
+
+auto McpDaemon::serverCount() const -> size_t
+{
+    return 0;
+}
+
+#else
+
+namespace
+{
+
+    /// @brief How long a server may take to answer its first initialize request.
+    constexpr auto StartupTimeout = std::chrono::seconds(30);
+
+    /// @brief How long writing to a server that does not read may block.
+    constexpr auto ServerWriteTimeout = std::chrono::seconds(30);
+
+    /// @brief How long writing to a client that does not read may block before it is dropped.
+    constexpr auto ClientWriteTimeout = std::chrono::seconds(5);
+
+    constexpr auto MethodNotFound = -32601;
+    constexpr auto InternalError = -32603;
+
+    struct Upstream;
+
+    /// @brief A connected client, i.e. one server connection of a mychat instance.
+    struct Session
+    {
+        int socket = -1; ///< Blocking, with ClientWriteTimeout as send timeout.
+        std::mutex writeMutex;
+        Upstream* upstream = nullptr; ///< Set by the attach line; upstreams outlive all sessions.
+
+        /// Client request ID (serialized) to server request ID; guarded by Upstream::mutex.
+        std::map<std::string, std::int64_t> inFlight;
+
+        Session() = default;
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+        ~Session() { ::close(socket); }
+
+        /// @brief Makes the session's blocked read return, ending the session.
+        void disconnect() { ::shutdown(socket, SHUT_RDWR); }
+
+        /// @brief Sends a message to the client; a client that cannot keep up is disconnected.
+        void write(nlohmann::json const& message)
+        {
+            auto line = message.dump();
+            line += '\n';
+
+            auto const lock = std::lock_guard(writeMutex);
+            auto remaining = std::string_view(line);
+            while (!remaining.empty())
+            {
+                auto const written = ::send(socket, remaining.data(), remaining.size(), MSG_NOSIGNAL);
+                if (written >= 0)
+                    remaining.remove_prefix(static_cast<size_t>(written));
+                else if (errno != EINTR)
+                {
+                    disconnect();
+                    return;
+                }
+            }
+        }
+    };
+
+    /// @brief Where the response to a request sent to a server goes.
+    struct Route
+    {
+        std::weak_ptr<Session> session;
+        nlohmann::json clientId;
+        std::shared_ptr<std::promise<nlohmann::json>> waiter; ///< Set for the daemon's own requests.
+    };
+
+    /// @brief A server process shared by all clients that attached to it.
+    struct Upstream
+    {
+        StdioTransportConfig config;
+
+        std::mutex startMutex; ///< Serializes (re)starting and initializing the server.
+        std::mutex sendMutex;  ///< Serializes writes to the transport.
+        std::jthread reader;   ///< Only touched with startMutex held.
+
+        std::mutex mutex; ///< Guards the members below and the sessions' inFlight maps.
+        std::shared_ptr<StdioTransport> transport;
+        bool running = false;
+        std::optional<nlohmann::json> initializeResult;
+        std::int64_t nextId = 1;
+        std::unordered_map<std::int64_t, Route> routes;
+        std::vector<std::weak_ptr<Session>> sessions;
+
+        ~Upstream()
+        {
+            auto const lock = std::lock_guard(startMutex);
+            stopProcess();
+        }
+
+        /// @brief Stops the server process, if any. Requires startMutex to be held.
+        void stopProcess()
+        {
+            auto current = std::shared_ptr<StdioTransport> {};
+            {
+                auto const lock = std::lock_guard(mutex);
+                current = transport;
+            }
+            if (current)
+                current->close();
+            reader = {};
+        }
+
+        [[nodiscard]] auto send(nlohmann::json const& message) -> VoidResult
+        {
+            auto current = std::shared_ptr<StdioTransport> {};
+            {
+                auto const lock = std::lock_guard(mutex);
+                if (!running)
+                    return makeError(ErrorCode::TransportError, "Server is not running");
+                current = transport;
+            }
+            auto const lock = std::lock_guard(sendMutex);
+            return current->send(message);
+        }
+
+        /// @brief Answers a client's initialize request, starting the server if needed.
+        [[nodiscard]] auto initialize(nlohmann::json const& request) -> nlohmann::json
+        {
+            auto const& clientId = request["id"];
+            auto const startLock = std::lock_guard(startMutex);
+            {
+                auto const lock = std::lock_guard(mutex);
+                if (running && initializeResult)
+                    return jsonrpc::makeResponse(clientId, *initializeResult);
+            }
+
+            stopProcess();
+            auto process = std::make_shared<StdioTransport>();
+            if (auto started = process->start(config); !started)
+                return jsonrpc::makeErrorResponse(clientId, InternalError, started.error().message);
+            {
+                auto const lock = std::lock_guard(mutex);
+                transport = process;
+                running = true;
+                initializeResult.reset();
+            }
+            reader = std::jthread([this, process] { readLoop(process); });
+
+            auto waiter = std::make_shared<std::promise<nlohmann::json>>();
+            auto response = waiter->get_future();
+            auto id = std::int64_t { 0 };
+            {
+                auto const lock = std::lock_guard(mutex);
+                id = nextId++;
+                routes[id] = Route { .session = {}, .clientId = nullptr, .waiter = waiter };
+            }
+            auto forwarded = request;
+            forwarded["id"] = id;
+            if (auto sent = send(forwarded); !sent)
+                return jsonrpc::makeErrorResponse(clientId, InternalError, sent.error().message);
+
+            if (response.wait_for(StartupTimeout) != std::future_status::ready)
+            {
+                auto const lock = std::lock_guard(mutex);
+                routes.erase(id);
+                return jsonrpc::makeErrorResponse(
+                    clientId, InternalError, "Server did not initialize in time");
+            }
+
+            auto result = response.get();
+            result["id"] = clientId;
+            if (result.contains("result"))
+            {
+                {
+                    auto const lock = std::lock_guard(mutex);
+                    initializeResult = result["result"];
+                }
+                (void) send(jsonrpc::makeNotification("notifications/initialized"));
+            }
+            return result;
+        }
+
+        /// @brief Forwards a client's request under a server-wide unique ID.
+        void forward(std::shared_ptr<Session> const& session, nlohmann::json request)
+        {
+            auto clientId = request["id"];
+            auto id = std::int64_t { 0 };
+            {
+                auto const lock = std::lock_guard(mutex);
+                id = nextId++;
+                routes[id] = Route { .session = session, .clientId = clientId, .waiter = nullptr };
+                session->inFlight[clientId.dump()] = id;
+            }
+            request["id"] = id;
+            if (auto sent = send(request); !sent)
+            {
+                {
+                    auto const lock = std::lock_guard(mutex);
+                    routes.erase(id);
+                    session->inFlight.erase(clientId.dump());
+                }
+                session->write(jsonrpc::makeErrorResponse(clientId, InternalError, sent.error().message));
+            }
+        }
+
+        /// @brief Forwards a client's cancellation, translating the request ID.
+        void cancel(std::shared_ptr<Session> const& session, nlohmann::json notification)
+        {
+            auto& params = notification["params"];
+            {
+                auto const lock = std::lock_guard(mutex);
+                auto const it = session->inFlight.find(params.value("requestId", nlohmann::json()).dump());
+                if (it == session->inFlight.end())
+                    return;
+                params["requestId"] = it->second;
+            }
+            (void) send(notification);
+        }
+
+        void attach(std::shared_ptr<Session> const& session)
+        {
+            auto const lock = std::lock_guard(mutex);
+            std::erase_if(sessions, [](auto const& weak) { return weak.expired(); });
+            sessions.push_back(session);
+        }
+
+        /// @brief Forgets a leaving client and cancels what it left unanswered.
+        void detach(Session& session)
+        {
+            auto abandoned = std::vector<std::int64_t> {};
+            {
+                auto const lock = std::lock_guard(mutex);
+                for (auto const& [clientId, id]: session.inFlight)
+                {
+                    routes.erase(id);
+                    abandoned.push_back(id);
+                }
+                session.inFlight.clear();
+                std::erase_if(sessions, [&](auto const& weak) {
+                    auto const other = weak.lock();
+                    return !other || other.get() == &session;
+                });
+            }
+            for (auto const id: abandoned)
+                (void) send(jsonrpc::makeNotification(
+                    "notifications/cancelled",
+                    nlohmann::json { { "requestId", id }, { "reason", "Client disconnected" } }));
+        }
+
+        void readLoop(std::shared_ptr<StdioTransport> process)
+        {
+            while (true)
+            {
+                auto message = process->receive();
+                if (!message)
+                    break;
+                dispatch(std::move(*message));
+            }
+
+            auto orphaned = std::unordered_map<std::int64_t, Route> {};
+            auto attached = std::vector<std::shared_ptr<Session>> {};
+            {
+                auto const lock = std::lock_guard(mutex);
+                if (transport != process)
+                    return;
+                running = false;
+                initializeResult.reset();
+                orphaned.swap(routes);
+                for (auto const& weak: sessions)
+                    if (auto session = weak.lock())
+                        attached.push_back(std::move(session));
+                sessions.clear();
+            }
+            log::warning("MCP server '{}' exited", config.command);
+            for (auto& [id, route]: orphaned)
+                if (route.waiter)
+                    route.waiter->set_value(
+                        jsonrpc::makeErrorResponse(nullptr, InternalError, "Server exited"));
+            // Clients notice the lost server as a closed connection, just like a direct child exiting.
+            for (auto const& session: attached)
+                session->disconnect();
+        }
+
+        void dispatch(nlohmann::json message)
+        {
+            if (message.contains("method"))
+            {
+                if (message.contains("id"))
+                {
+                    // A request from the server, which has no single client to go to.
+                    auto const& id = message["id"];
+                    auto const reply =
+                        message["method"] == "ping"
+                            ? jsonrpc::makeResponse(id, nlohmann::json::object())
+                            : jsonrpc::makeErrorResponse(id, MethodNotFound, "Not supported by mychat-mcpd");
+                    (void) send(reply);
+                    return;
+                }
+
+                auto attached = std::vector<std::shared_ptr<Session>> {};
+                {
+                    auto const lock = std::lock_guard(mutex);
+                    for (auto const& weak: sessions)
+                        if (auto session = weak.lock())
+                            attached.push_back(std::move(session));
+                }
+                for (auto const& session: attached)
+                    session->write(message);
+                return;
+            }
+
+            if (!message.contains("id") || !message["id"].is_number_integer())
+                return;
+            auto route = Route {};
+            auto session = std::shared_ptr<Session> {};
+            {
+                auto const lock = std::lock_guard(mutex);
+                auto const it = routes.find(message["id"].get<std::int64_t>());
+                if (it == routes.end())
+                    return; // Cancelled, e.g. because its client disconnected.
+                route = std::move(it->second);
+                routes.erase(it);
+                session = route.session.lock();
+                if (session)
+                    session->inFlight.erase(route.clientId.dump());
+            }
+
+            if (route.waiter)
+                route.waiter->set_value(std::move(message));
+            else if (session)
+            {
+                message["id"] = route.clientId;
+                session->write(message);
+            }
+        }
+    };
+
+    /// @brief Identifies a server by its command line and environment.
+    auto upstreamKey(StdioTransportConfig const& config) -> std::uint64_t
+    {
+        auto key = fnv1a64(config.command);
+        for (const auto& arg: config.args)
+            key = fnv1a64(arg, fnv1a64("\x1f", key));
+        for (const auto& [name, value]: config.env)
+            key = fnv1a64(value, fnv1a64("=", fnv1a64(name, fnv1a64("\x1e", key))));
+        return key;
+    }
+
+    auto makeAddress(std::string const& path) -> std::optional<sockaddr_un>
+    {
+        auto address = sockaddr_un {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return std::nullopt;
+        std::ranges::copy(path, address.sun_path);
+        return address;
+    }
+
+} // namespace
+
+struct McpDaemon::Impl
+{
+    /// @brief A connected client and the thread relaying its messages.
+    struct Client
+    {
+        std::shared_ptr<Session> session;
+        std::jthread thread;
+        std::atomic<bool> finished = false;
+    };
+
+    std::string socketPath;
+    int listener = -1;
+    int wakeRead = -1; ///< Becomes readable when stop() is called, waking the acceptor.
+    int wakeWrite = -1;
+    std::jthread acceptor;
+
+    mutable std::mutex mutex; ///< Guards the members below.
+    std::map<std::uint64_t, std::shared_ptr<Upstream>> upstreams;
+    std::list<Client> clients;
+
+    void acceptLoop()
+    {
+        while (true)
+        {
+            auto fds = std::array {
+                pollfd { .fd = listener, .events = POLLIN, .revents = 0 },
+                pollfd { .fd = wakeRead, .events = POLLIN, .revents = 0 },
+            };
+            if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+                return;
+            if (fds[1].revents != 0)
+                return;
+            if (fds[0].revents == 0)
+                continue;
+
+            auto const socket = ::accept(listener, nullptr, nullptr);
+            if (socket < 0)
+                continue;
+            fcntl(socket, F_SETFD, FD_CLOEXEC);
+            auto const timeout = timeval { .tv_sec = ClientWriteTimeout.count(), .tv_usec = 0 };
+            setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            auto const lock = std::lock_guard(mutex);
+            clients.remove_if([](Client const& client) { return client.finished.load(); });
+            auto& client = clients.emplace_back();
+            client.session = std::make_shared<Session>();
+            client.session->socket = socket;
+            client.thread = std::jthread([this, &client] {
+                serve(client.session);
+                client.finished = true;
+            });
+        }
+    }
+
+    /// @brief Returns the shared server for @p config, creating it (not yet running) if needed.
+    auto upstreamFor(StdioTransportConfig config) -> std::shared_ptr<Upstream>
+    {
+        auto const lock = std::lock_guard(mutex);
+        auto& upstream = upstreams[upstreamKey(config)];
+        if (!upstream)
+        {
+            upstream = std::make_shared<Upstream>();
+            upstream->config = std::move(config);
+            upstream->config.writeTimeout = ServerWriteTimeout;
+        }
+        return upstream;
+    }
+
+    /// @brief Relays the messages of one client until it disconnects.
+    void serve(std::shared_ptr<Session> const& session)
+    {
+        auto lines = LineBuffer {};
+        while (true)
+        {
+            auto const line = lines.nextLine();
+            if (!line)
+            {
+                auto const bytesRead = lines.read([&](char* data, size_t size) -> std::int64_t {
+                    return ::recv(session->socket, data, size, 0);
+                });
+                if (bytesRead < 0 && errno == EINTR)
+                    continue;
+                if (bytesRead <= 0)
+                    break;
+                continue;
+            }
+            if (line->empty())
+                continue;
+
+            auto message = json::parse(*line);
+            if (!message || !(message->is_object() || (message->is_array() && session->upstream)))
+            {
+                log::warning("mychat-mcpd: dropping malformed message from a client");
+                continue;
+            }
+            if (!session->upstream)
+            {
+                if (!attach(session, *message))
+                    break;
+                continue;
+            }
+            if (message->is_array())
+            {
+                // Batches are taken apart, as requests are routed one by one anyway.
+                for (auto& item: *message)
+                    if (item.is_object())
+                        handle(session, std::move(item));
+                continue;
+            }
+            handle(session, std::move(*message));
+        }
+
+        if (session->upstream)
+            session->upstream->detach(*session);
+    }
+
+    /// @brief Handles the first line of a client, which names the server it wants.
+    auto attach(std::shared_ptr<Session> const& session, nlohmann::json const& message) -> bool
+    {
+        auto const it = message.find("attach");
+        if (it == message.end() || !it->is_object() || !it->contains("command"))
+        {
+            log::warning("mychat-mcpd: client did not attach to a server");
+            return false;
+        }
+
+        auto config = StdioTransportConfig {
+            .command = it->value("command", ""),
+            .args = it->value("args", std::vector<std::string> {}),
+            .env = it->value("env", std::map<std::string, std::string> {}),
+        };
+        log::info("mychat-mcpd: client attached to '{}'", config.command);
+        session->upstream = upstreamFor(std::move(config)).get();
+        session->upstream->attach(session);
+        return true;
+    }
+
+    void handle(std::shared_ptr<Session> const& session, nlohmann::json message)
+    {
+        auto& upstream = *session->upstream;
+        auto const method = message.value("method", "");
+        if (method.empty())
+            return; // A response, but clients are never sent requests.
+        if (!message.contains("id"))
+        {
+            if (method == "notifications/cancelled")
+                upstream.cancel(session, std::move(message));
+            else if (method != "notifications/initialized") // Sent once by the daemon itself.
+                (void) upstream.send(message);
+            return;
+        }
+        if (method == "initialize")
+            session->write(upstream.initialize(message));
+        else
+            upstream.forward(session, std::move(message));
+    }
+};
+
+McpDaemon::McpDaemon(): _impl(std::make_unique<Impl>())
+{
+}
+
+McpDaemon::~McpDaemon()
+{
+    stop();
+}
+
+auto McpDaemon::start(std::string socketPath) -> VoidResult
+{
+    if (_impl->listener >= 0)
+        return makeError(ErrorCode::TransportError, "Daemon already started");
+
+    auto const address = makeAddress(socketPath);
+    if (!address)
+        return makeError(ErrorCode::InvalidArgument, std::format("Socket path too long: {}", socketPath));
+
+    // A socket file nobody accepts on is left over from a daemon that did not shut down cleanly.
+    if (std::filesystem::exists(socketPath))
+    {
+        auto const probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        auto const alive =
+            ::connect(probe, reinterpret_cast<sockaddr const*>(&*address), sizeof(*address)) == 0;
+        ::close(probe);
+        if (alive)
+            return makeError(ErrorCode::TransportError,
+                             std::format("Another mychat-mcpd is already listening on {}", socketPath));
+        ::unlink(socketPath.c_str());
+    }
+
+    auto const fail = [&](std::string_view what) {
+        auto const error = errno;
+        for (auto* fd: { &_impl->listener, &_impl->wakeRead, &_impl->wakeWrite })
+            if (*fd >= 0)
+                ::close(std::exchange(*fd, -1));
+        return makeError(ErrorCode::TransportError, std::format("{} failed: {}", what, strerror(error)));
+    };
+
+    _impl->listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_impl->listener < 0)
+        return fail("socket");
+    fcntl(_impl->listener, F_SETFD, FD_CLOEXEC);
+
+    // Clients get servers spawned with this user's environment, so no one else may connect.
+    auto const oldMask = ::umask(0077);
+    auto const bound =
+        ::bind(_impl->listener, reinterpret_cast<sockaddr const*>(&*address), sizeof(*address));
+    ::umask(oldMask);
+    if (bound != 0)
+        return fail("bind");
+    if (::listen(_impl->listener, 64) != 0)
+        return fail("listen");
+
+    int wakePipe[2];
+    if (::pipe(wakePipe) != 0)
+        return fail("pipe");
+    _impl->wakeRead = wakePipe[0];
+    _impl->wakeWrite = wakePipe[1];
+    fcntl(_impl->wakeRead, F_SETFD, FD_CLOEXEC);
+    fcntl(_impl->wakeWrite, F_SETFD, FD_CLOEXEC);
+
+    _impl->socketPath = std::move(socketPath);
+    _impl->acceptor = std::jthread([this] { _impl->acceptLoop(); });
+    log::info("mychat-mcpd listening on {}", _impl->socketPath);
+    return {};
+}
+
+void McpDaemon::stop()
+{
+    if (_impl->listener < 0)
+        return;
+
+    (void) ::write(_impl->wakeWrite, "x", 1);
+    _impl->acceptor = {};
+
+    // Clients first: their threads use the upstreams, which then stop their processes.
+    auto clients = std::list<Impl::Client> {};
+    auto upstreams = std::map<std::uint64_t, std::shared_ptr<Upstream>> {};
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        clients.swap(_impl->clients);
+        upstreams.swap(_impl->upstreams);
+    }
+    for (auto const& client: clients)
+        client.session->disconnect();
+    clients.clear();
+    upstreams.clear();
+
+    for (auto* fd: { &_impl->listener, &_impl->wakeRead, &_impl->wakeWrite })
+        ::close(std::exchange(*fd, -1));
+    ::unlink(_impl->socketPath.c_str());
+    log::info("mychat-mcpd stopped");
+}
+
+auto McpDaemon::clientCount() const -> size_t
+{
+    auto const lock = std::lock_guard(_impl->mutex);
+    return static_cast<size_t>(
+        std::ranges::count_if(_impl->clients, [](Impl::Client const& client) { return !client.finished; }));
+}
+
+auto McpDaemon::serverCount() const -> size_t
+{
+    auto const lock = std::lock_guard(_impl->mutex);
+    return static_cast<size_t>(std::ranges::count_if(_impl->upstreams, [](auto const& entry) {
+        auto const upstreamLock = std::lock_guard(entry.second->mutex);
+        return entry.second->running;
+    }));
+}
+
+#endif
+
+} // namespace mychat
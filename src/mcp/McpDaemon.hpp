@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+
+#include <memory>
+#include <string>
+
+namespace mychat
+{
+
+/// @brief Returns the socket mychat-mcpd listens on by default.
+///
+/// `$XDG_RUNTIME_DIR/mychat-mcpd.sock` if set, otherwise a per-user path in the temp directory.
+[[nodiscard]] auto defaultMcpDaemonSocketPath() -> std::string;
+
+/// @brief Keeps MCP server processes alive across mychat sessions and shares them between instances.
+///
+/// Clients connect to a Unix domain socket (see UnixSocketTransport) and send one line
+/// `{"attach": {"command": ..., "args": [...], "env": {...}}}` naming the server they want. The
+/// daemon spawns each distinct server once and from then on relays newline-delimited JSON-RPC:
+///
+/// - `initialize` is forwarded only for the first client; later ones get the cached result, so
+///   they attach to an already warm server. `notifications/initialized` is sent once.
+/// - Request IDs are rewritten so the requests of all clients can share the server connection,
+///   and responses are routed back to the client that sent the request.
+/// - Server notifications are delivered to every attached client. Server pings are answered by
+///   the daemon; other requests from the server are refused.
+/// - When a client disconnects, its unanswered requests are cancelled on the server.
+/// - JSON-RPC batches from clients are split into their messages, which are relayed one by one.
+///
+/// Servers stay running when their last client leaves and are stopped with the daemon. A server
+/// that exits is detached from its clients and respawned by the next `initialize`.
+///
+/// Servers inherit the daemon's environment, not the client's, plus the attached `env`.
+class McpDaemon
+{
+  public:
+    McpDaemon();
+    ~McpDaemon();
+
+    McpDaemon(const McpDaemon&) = delete;
+    McpDaemon& operator=(const McpDaemon&) = delete;
+
+    /// @brief Starts listening on @p socketPath, replacing a stale socket left by a crashed daemon.
+    /// @return Success, or an error if the socket cannot be created or another daemon is running.
+    [[nodiscard]] auto start(std::string socketPath) -> VoidResult;
+
+    /// @brief Disconnects all clients, stops all servers and removes the socket.
+    void stop();
+
+    /// @brief Returns the number of connected clients.
+    [[nodiscard]] auto clientCount() const -> size_t;
+
+    /// @brief Returns the number of running server processes.
+    [[nodiscard]] auto serverCount() const -> size_t;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+} // namespace mychat
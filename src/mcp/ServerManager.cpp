@@ -1,102 +1,722 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "ServerManager.hpp"
 
+#include <core/Hash.hpp>
+#include <core/JsonUtils.hpp>
 #include <core/Log.hpp>
 
+#include <algorithm>
+#include <condition_variable>
 #include <format>
+#include <fstream>
+#include <sstream>
 
 namespace mychat
 {
 
-ServerManager::ServerManager() = default;
+namespace
+{
+
+    /// @brief How often idle servers are looked for.
+    constexpr auto ReapInterval = std::chrono::seconds(1);
+
+    auto steadyNow() -> std::chrono::steady_clock::rep
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    auto sameTools(std::span<const ToolDefinition> a, std::span<const ToolDefinition> b) -> bool
+    {
+        return std::ranges::equal(a, b, [](ToolDefinition const& x, ToolDefinition const& y) {
+            return x.name == y.name && x.description == y.description && x.inputSchema == y.inputSchema;
+        });
+    }
+
+    auto loadManifest(std::filesystem::path const& path) -> Result<std::vector<ToolDefinition>>
+    {
+        auto in = std::ifstream(path);
+        if (!in)
+            return makeError(ErrorCode::IoError, std::format("Cannot read tool manifest {}", path.string()));
+        auto content = std::stringstream {};
+        content << in.rdbuf();
+
+        auto manifest = json::parse(content.str());
+        if (!manifest)
+            return std::unexpected(manifest.error());
+        if (!manifest->contains("tools") || !(*manifest)["tools"].is_array())
+            return makeError(ErrorCode::ProtocolError,
+                             std::format("Malformed tool manifest {}", path.string()));
+
+        auto tools = std::vector<ToolDefinition> {};
+        for (const auto& toolJson: (*manifest)["tools"])
+        {
+            tools.push_back(ToolDefinition {
+                .name = json::getStringOr(toolJson, "name", ""),
+                .description = json::getStringOr(toolJson, "description", ""),
+                .inputSchema = toolJson.value("inputSchema", nlohmann::json::object()),
+            });
+        }
+        return tools;
+    }
+
+    auto saveManifest(std::filesystem::path const& path, std::span<const ToolDefinition> tools) -> VoidResult
+    {
+        auto ec = std::error_code {};
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        auto toolsJson = nlohmann::json::array();
+        for (const auto& tool: tools)
+        {
+            toolsJson.push_back(nlohmann::json {
+                { "name", tool.name },
+                { "description", tool.description },
+                { "inputSchema", tool.inputSchema },
+            });
+        }
+
+        auto const writeError = [&] {
+            return makeError(ErrorCode::IoError, std::format("Cannot write tool manifest {}", path.string()));
+        };
+
+        // Written aside and renamed, so a concurrently starting instance never reads half a file.
+        auto const tempPath = std::filesystem::path(path).concat(".tmp");
+        {
+            auto out = std::ofstream(tempPath, std::ios::trunc);
+            if (!out)
+                return writeError();
+            out << nlohmann::json { { "tools", std::move(toolsJson) } }.dump(2);
+            if (!out)
+                return writeError();
+        }
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+            return writeError();
+        return {};
+    }
+
+} // namespace
+
+ServerManager::ServerManager():
+    _httpPool(std::make_shared<HttpConnectionPool>()), _toolSnapshot(std::make_shared<const ToolSnapshot>())
+{
+}
 
 ServerManager::~ServerManager()
 {
     shutdown();
 }
 
+void ServerManager::setManifestDirectory(std::filesystem::path directory)
+{
+    _manifestDirectory = std::move(directory);
+}
+
+void ServerManager::setDaemonSocket(std::string socketPath)
+{
+    _daemonSocket = std::move(socketPath);
+}
+
+void ServerManager::setTransportFactory(TransportFactory factory)
+{
+    _transportFactory = std::move(factory);
+}
+
 auto ServerManager::addServer(const McpServerConfig& config) -> VoidResult
 {
-    auto transport = std::make_unique<StdioTransport>();
+    return startServer(config, {});
+}
+
+auto ServerManager::addServers(std::span<const McpServerConfig> configs, std::stop_token stopToken)
+    -> std::vector<VoidResult>
+{
+    auto results = std::vector<VoidResult>(configs.size());
+    {
+        auto workers = std::vector<std::jthread> {};
+        workers.reserve(configs.size());
+        for (auto i = size_t { 0 }; i < configs.size(); ++i)
+            workers.emplace_back([&, i] { results[i] = startServer(configs[i], stopToken); });
+    }
+    return results;
+}
 
-    auto transportConfig = StdioTransportConfig {
-        .command = config.command,
-        .args = config.args,
-        .env = config.env,
-    };
+auto ServerManager::toolSnapshot() const -> std::shared_ptr<const ToolSnapshot>
+{
+    auto const lock = std::shared_lock(_mutex);
+    return _toolSnapshot;
+}
+
+auto ServerManager::allTools() -> std::vector<ToolDefinition>
+{
+    return toolSnapshot()->tools;
+}
+
+auto ServerManager::callTool(std::string_view name,
+                             const nlohmann::json& arguments,
+                             std::stop_token stopToken) -> Result<ToolResult>
+{
+    auto server = std::shared_ptr<ServerEntry> {};
+    {
+        auto const lock = std::shared_lock(_mutex);
+        auto const it = _toolToServer.find(name);
+        if (it == _toolToServer.end())
+            return makeError(ErrorCode::ToolCallError, std::format("Unknown tool: {}", name));
+
+        auto const entry = std::ranges::find(_servers, it->second, &std::shared_ptr<ServerEntry>::get);
+        if (entry == _servers.end())
+            return makeError(ErrorCode::ToolCallError, "Server not registered");
+        server = *entry;
+    }
+
+    auto client = activate(server);
+    if (!client)
+        return std::unexpected(client.error());
+
+    server->lastUsed = steadyNow();
+    auto result = (*client)->callTool(name, arguments, std::move(stopToken));
+    server->lastUsed = steadyNow();
+    if (result)
+        result->callId = std::string(name); // Use tool name as fallback call ID
+
+    return result;
+}
+
+auto ServerManager::listResources(std::stop_token stopToken) -> std::vector<McpResource>
+{
+    auto resources = std::vector<McpResource> {};
+    for (auto const& server: servers())
+    {
+        if (stopToken.stop_requested())
+            break;
+        auto client = activate(server);
+        if (!client)
+        {
+            log::warning(
+                "Cannot list the resources of '{}': {}", server->config.name, client.error().message);
+            continue;
+        }
+        if (!(*client)->capabilities().hasResources)
+            continue;
+
+        server->lastUsed = steadyNow();
+        auto listed = (*client)->listResources(stopToken);
+        server->lastUsed = steadyNow();
+        if (!listed)
+        {
+            log::warning(
+                "Cannot list the resources of '{}': {}", server->config.name, listed.error().message);
+            continue;
+        }
+        for (auto& resource: *listed)
+        {
+            resource.server = server->config.name;
+            resources.push_back(std::move(resource));
+        }
+    }
+    return resources;
+}
+
+auto ServerManager::readResource(std::string_view serverName, std::string_view uri, std::stop_token stopToken)
+    -> Result<std::vector<McpResourceContent>>
+{
+    auto const server = findServer(serverName);
+    if (!server)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown MCP server: {}", serverName));
+    auto client = activate(server);
+    if (!client)
+        return std::unexpected(client.error());
+
+    // Without subscriptions, nothing tells when cached contents go stale.
+    auto caching = (*client)->capabilities().supportsResourceSubscriptions;
+    auto updates = std::uint64_t { 0 };
+    auto connection = std::uint64_t { 0 };
+    auto subscribed = false;
+    if (caching)
+    {
+        auto const lock = std::lock_guard(server->resourceMutex);
+        auto& cached = server->resources[std::string(uri)];
+        if (cached.contents)
+        {
+            log::debug("Resource {} of '{}' read from the cache", uri, serverName);
+            return *cached.contents;
+        }
+        updates = cached.updates;
+        subscribed = cached.subscribed;
+        connection = server->connections;
+    }
+
+    server->lastUsed = steadyNow();
+    // Subscribed before reading, so that a change right after the read is not missed.
+    if (caching && !subscribed)
+    {
+        if (auto result = (*client)->subscribeResource(uri, stopToken); result)
+        {
+            auto const lock = std::lock_guard(server->resourceMutex);
+            if (server->connections == connection)
+                server->resources[std::string(uri)].subscribed = true;
+        }
+        else
+        {
+            log::warning("Not caching resource {} of '{}': {}", uri, serverName, result.error().message);
+            caching = false;
+        }
+    }
+
+    auto contents = (*client)->readResource(uri, std::move(stopToken));
+    server->lastUsed = steadyNow();
+    if (contents && caching)
+    {
+        auto const lock = std::lock_guard(server->resourceMutex);
+        // Not kept if it changed while being read, or the server was restarted meanwhile.
+        if (auto& cached = server->resources[std::string(uri)];
+            server->connections == connection && cached.updates == updates)
+            cached.contents = *contents;
+    }
+    return contents;
+}
+
+auto ServerManager::listPrompts(std::stop_token stopToken) -> std::vector<McpPromptInfo>
+{
+    auto prompts = std::vector<McpPromptInfo> {};
+    for (auto const& server: servers())
+    {
+        if (stopToken.stop_requested())
+            break;
+        auto client = activate(server);
+        if (!client)
+        {
+            log::warning("Cannot list the prompts of '{}': {}", server->config.name, client.error().message);
+            continue;
+        }
+        if (!(*client)->capabilities().hasPrompts)
+            continue;
+
+        server->lastUsed = steadyNow();
+        auto listed = (*client)->listPrompts(stopToken);
+        server->lastUsed = steadyNow();
+        if (!listed)
+        {
+            log::warning("Cannot list the prompts of '{}': {}", server->config.name, listed.error().message);
+            continue;
+        }
+        for (auto& prompt: *listed)
+        {
+            prompt.server = server->config.name;
+            prompts.push_back(std::move(prompt));
+        }
+    }
+    return prompts;
+}
 
-    auto startResult = transport->start(transportConfig);
-    if (!startResult)
-        return std::unexpected(startResult.error());
+auto ServerManager::getPrompt(std::string_view serverName,
+                              std::string_view name,
+                              const nlohmann::json& arguments,
+                              std::stop_token stopToken) -> Result<McpPrompt>
+{
+    auto const server = findServer(serverName);
+    if (!server)
+        return makeError(ErrorCode::InvalidArgument, std::format("Unknown MCP server: {}", serverName));
+    auto client = activate(server);
+    if (!client)
+        return std::unexpected(client.error());
 
-    auto client = std::make_unique<McpClient>(std::move(transport));
+    server->lastUsed = steadyNow();
+    auto prompt = (*client)->getPrompt(name, arguments, std::move(stopToken));
+    server->lastUsed = steadyNow();
+    return prompt;
+}
+
+auto ServerManager::cachePolicy(std::string_view toolName) const -> std::optional<ToolCachePolicy>
+{
+    auto const lock = std::shared_lock(_mutex);
+    auto const it = _toolToServer.find(toolName);
+    if (it == _toolToServer.end())
+        return std::nullopt;
+
+    auto const& config = it->second->config;
+    auto const cached = std::ranges::any_of(
+        config.cachedTools, [&](std::string const& name) { return name == "*" || name == toolName; });
+    auto const ttl = std::chrono::seconds(config.cacheTtlSeconds);
+    if (!cached || ttl <= std::chrono::seconds::zero())
+        return std::nullopt;
+    return ToolCachePolicy { .server = config.name, .ttl = ttl };
+}
 
-    auto initResult = client->initialize();
+auto ServerManager::serverCount() const -> size_t
+{
+    auto const lock = std::shared_lock(_mutex);
+    return _servers.size();
+}
+
+auto ServerManager::runningServerCount() const -> size_t
+{
+    auto const lock = std::shared_lock(_mutex);
+    return static_cast<size_t>(
+        std::ranges::count_if(_servers, [](auto const& server) { return server->client != nullptr; }));
+}
+
+void ServerManager::shutdown()
+{
+    auto reaper = std::jthread {};
+    auto refresher = std::jthread {};
+    auto servers = std::vector<std::shared_ptr<ServerEntry>> {};
+    {
+        auto const lock = std::unique_lock(_mutex);
+        reaper = std::move(_reaper);
+        refresher = std::move(_refresher);
+        servers.swap(_servers);
+        _toolToServer.clear();
+        publishTools();
+    }
+    // The threads are joined and the clients close their transports here, outside the lock.
+}
+
+auto ServerManager::startServer(const McpServerConfig& config, std::stop_token stopToken) -> VoidResult
+{
+    auto server = std::make_shared<ServerEntry>();
+    server->config = config;
+
+    auto const manifest = manifestPath(config);
+    if (config.lazyStart && !manifest.empty() && std::filesystem::exists(manifest))
+    {
+        auto tools = loadManifest(manifest);
+        if (tools)
+        {
+            server->tools = std::move(*tools);
+            log::info("MCP server '{}' will start on first use", config.name);
+            registerServer(std::move(server));
+            return {};
+        }
+        log::warning("Ignoring tool manifest of '{}': {}", config.name, tools.error().message);
+    }
+
+    auto connection = connect(config, std::move(stopToken));
+    if (!connection)
+        return std::unexpected(connection.error());
+    watchServer(server, *connection->client);
+
+    if (!manifest.empty())
+        if (auto saved = saveManifest(manifest, connection->tools); !saved)
+            log::warning("{}", saved.error().message);
+
+    server->client = std::move(connection->client);
+    server->tools = std::move(connection->tools);
+    registerServer(std::move(server));
+    return {};
+}
+
+auto ServerManager::openTransport(const McpServerConfig& config) const -> Result<std::unique_ptr<Transport>>
+{
+    auto const requestTimeout = std::chrono::milliseconds(std::chrono::seconds(config.requestTimeoutSeconds));
+    auto transport = std::unique_ptr<Transport> {};
+    if (!config.url.empty())
+    {
+        auto http = std::make_unique<HttpTransport>();
+        auto startResult = http->start(HttpTransportConfig {
+            .url = config.url,
+            .headers = config.headers,
+            .requestTimeout = requestTimeout,
+            .pool = _httpPool,
+        });
+        if (!startResult)
+            return std::unexpected(startResult.error());
+        transport = std::move(http);
+    }
+    else if (!_daemonSocket.empty())
+    {
+        auto daemon = std::make_unique<UnixSocketTransport>();
+        auto startResult = daemon->start(UnixSocketTransportConfig {
+            .socketPath = _daemonSocket,
+            .command = config.command,
+            .args = config.args,
+            .env = config.env,
+            .writeTimeout = requestTimeout,
+        });
+        if (startResult)
+            transport = std::move(daemon);
+        else
+            log::debug("Spawning '{}' directly: {}", config.name, startResult.error().message);
+    }
+    if (!transport)
+    {
+        auto stdio = std::make_unique<StdioTransport>();
+        auto startResult = stdio->start(StdioTransportConfig {
+            .command = config.command,
+            .args = config.args,
+            .env = config.env,
+            .writeTimeout = requestTimeout,
+        });
+        if (!startResult)
+            return std::unexpected(startResult.error());
+        transport = std::move(stdio);
+    }
+    return transport;
+}
+
+auto ServerManager::connect(const McpServerConfig& config, std::stop_token stopToken) const
+    -> Result<Connection>
+{
+    auto const requestTimeout = std::chrono::milliseconds(std::chrono::seconds(config.requestTimeoutSeconds));
+    auto const open = [this, &config] { return openTransport(config); };
+    auto transport = _transportFactory ? _transportFactory(config, open) : open();
+    if (!transport)
+        return std::unexpected(transport.error());
+
+    auto client = std::make_shared<McpClient>(std::move(*transport));
+    client->setRequestTimeout(requestTimeout);
+
+    // The handshake is abandoned when the caller stops it or the startup timeout expires.
+    auto abort = std::stop_source {};
+    auto const onStop = std::stop_callback(stopToken, [&abort] { abort.request_stop(); });
+    auto watchdog = std::jthread {};
+    if (config.startupTimeoutSeconds > 0)
+    {
+        watchdog = std::jthread(
+            [&abort, timeout = std::chrono::seconds(config.startupTimeoutSeconds)](std::stop_token done) {
+                auto mutex = std::mutex {};
+                auto lock = std::unique_lock(mutex);
+                std::condition_variable_any().wait_for(lock, done, timeout, [] { return false; });
+                if (!done.stop_requested())
+                    abort.request_stop();
+            });
+    }
+
+    auto const failure = [&](Error error) -> Result<Connection> {
+        if (stopToken.stop_requested())
+            return makeError(ErrorCode::TransportError, std::format("Startup of '{}' aborted", config.name));
+        if (abort.stop_requested())
+            return makeError(
+                ErrorCode::TimeoutError,
+                std::format("'{}' did not start within {}s", config.name, config.startupTimeoutSeconds));
+        return std::unexpected(std::move(error));
+    };
+
+    auto initResult = client->initialize(abort.get_token());
     if (!initResult)
-        return std::unexpected(initResult.error());
+        return failure(std::move(initResult.error()));
 
-    auto toolsResult = client->listTools();
+    auto toolsResult = client->listTools(abort.get_token());
     if (!toolsResult)
     {
+        if (abort.stop_requested())
+            return failure(std::move(toolsResult.error()));
         log::warning("Failed to list tools for server '{}': {}", config.name, toolsResult.error().message);
     }
 
-    auto entry = ServerEntry {
-        .name = config.name,
+    return Connection {
         .client = std::move(client),
         .tools = toolsResult ? std::move(*toolsResult) : std::vector<ToolDefinition> {},
     };
+}
 
-    auto const serverIdx = _servers.size();
-    for (const auto& tool: entry.tools)
+auto ServerManager::activate(std::shared_ptr<ServerEntry> const& server) -> Result<std::shared_ptr<McpClient>>
+{
+    auto const activationLock = std::lock_guard(server->activationMutex);
     {
-        _toolToServer[tool.name] = serverIdx;
-        log::info("  Tool registered: {} (from server '{}')", tool.name, config.name);
+        auto const lock = std::shared_lock(_mutex);
+        if (server->client)
+            return server->client;
     }
 
-    _servers.push_back(std::move(entry));
-    log::info("MCP server '{}' connected with {} tools", config.name, _servers.back().tools.size());
+    log::info("Starting MCP server '{}' on demand", server->config.name);
+    auto connection = connect(server->config, {});
+    if (!connection)
+        return std::unexpected(connection.error());
+    watchServer(server, *connection->client);
 
-    return {};
+    server->lastUsed = steadyNow();
+    auto const lock = std::unique_lock(_mutex);
+    updateTools(*server, std::move(connection->tools));
+    server->client = std::move(connection->client);
+    return server->client;
 }
 
-auto ServerManager::allTools() -> std::vector<ToolDefinition>
+void ServerManager::registerServer(std::shared_ptr<ServerEntry> server)
 {
-    auto result = std::vector<ToolDefinition> {};
-    for (const auto& server: _servers)
+    auto const lock = std::unique_lock(_mutex);
+
+    server->lastUsed = steadyNow();
+    auto tools = std::move(server->tools);
+    replaceTools(*server, std::move(tools));
+    log::info("MCP server '{}' registered with {} tools", server->config.name, server->tools.size());
+
+    if (server->config.idleTimeoutSeconds > 0 && !_reaper.joinable())
+        _reaper = std::jthread([this](std::stop_token stopToken) { reapIdleServers(std::move(stopToken)); });
+    if (!_refresher.joinable())
+        _refresher =
+            std::jthread([this](std::stop_token stopToken) { refreshStaleTools(std::move(stopToken)); });
+
+    _servers.push_back(std::move(server));
+    publishTools();
+}
+
+auto ServerManager::findServer(std::string_view name) const -> std::shared_ptr<ServerEntry>
+{
+    auto const lock = std::shared_lock(_mutex);
+    auto const it = std::ranges::find(_servers, name, [](auto const& server) -> std::string_view {
+        return server->config.name;
+    });
+    return it != _servers.end() ? *it : nullptr;
+}
+
+auto ServerManager::servers() const -> std::vector<std::shared_ptr<ServerEntry>>
+{
+    auto const lock = std::shared_lock(_mutex);
+    return _servers;
+}
+
+void ServerManager::watchServer(std::shared_ptr<ServerEntry> const& server, McpClient& client)
+{
+    // The new client has no subscriptions yet.
     {
-        for (const auto& tool: server.tools)
-            result.push_back(tool);
+        auto const lock = std::lock_guard(server->resourceMutex);
+        server->resources.clear();
+        ++server->connections;
     }
-    return result;
+
+    // Runs on the client's reader thread, which must not block on the tools/list response.
+    server->toolsStale = false;
+    auto const onNotification = [this, weakServer = std::weak_ptr(server)](std::string_view method,
+                                                                           nlohmann::json const& params) {
+        auto const changedServer = weakServer.lock();
+        if (!changedServer)
+            return;
+        if (method == "notifications/resources/updated")
+        {
+            auto const uri = json::getStringOr(params, "uri", "");
+            auto const lock = std::lock_guard(changedServer->resourceMutex);
+            if (auto const it = changedServer->resources.find(uri); it != changedServer->resources.end())
+            {
+                ++it->second.updates;
+                it->second.contents.reset();
+                log::debug("Resource {} of '{}' changed", uri, changedServer->config.name);
+            }
+            return;
+        }
+        if (method != "notifications/tools/list_changed")
+            return;
+        changedServer->toolsStale = true;
+        {
+            auto const lock = std::lock_guard(_refreshMutex);
+            _refreshPending = true;
+        }
+        _refreshWakeup.notify_one();
+    };
+    client.setNotificationHandler(onNotification);
 }
 
-auto ServerManager::callTool(std::string_view name, const nlohmann::json& arguments) -> Result<ToolResult>
+void ServerManager::replaceTools(ServerEntry& server, std::vector<ToolDefinition> tools)
 {
-    auto const it = _toolToServer.find(std::string(name));
-    if (it == _toolToServer.end())
-        return makeError(ErrorCode::ToolCallError, std::format("Unknown tool: {}", name));
+    for (const auto& tool: server.tools)
+        if (auto const it = _toolToServer.find(tool.name); it != _toolToServer.end() && it->second == &server)
+            _toolToServer.erase(it);
+    server.tools = std::move(tools);
+    for (const auto& tool: server.tools)
+    {
+        _toolToServer[tool.name] = &server;
+        log::info("  Tool registered: {} (from server '{}')", tool.name, server.config.name);
+    }
+}
 
-    auto const serverIdx = it->second;
-    if (serverIdx >= _servers.size())
-        return makeError(ErrorCode::ToolCallError, "Server index out of range");
+void ServerManager::updateTools(ServerEntry& server, std::vector<ToolDefinition> tools)
+{
+    if (sameTools(tools, server.tools))
+        return;
 
-    auto result = _servers[serverIdx].client->callTool(name, arguments);
-    if (result)
-        result->callId = std::string(name); // Use tool name as fallback call ID
+    log::info("MCP server '{}' changed its tools", server.config.name);
+    if (auto const manifest = manifestPath(server.config); !manifest.empty())
+        if (auto saved = saveManifest(manifest, tools); !saved)
+            log::warning("{}", saved.error().message);
+    replaceTools(server, std::move(tools));
+    publishTools();
+}
 
-    return result;
+void ServerManager::publishTools()
+{
+    auto snapshot = std::make_shared<ToolSnapshot>();
+    snapshot->version = _toolSnapshot->version + 1;
+    for (const auto& server: _servers)
+        snapshot->tools.insert(snapshot->tools.end(), server->tools.begin(), server->tools.end());
+    _toolSnapshot = std::move(snapshot);
 }
 
-auto ServerManager::serverCount() const -> size_t
+auto ServerManager::manifestPath(const McpServerConfig& config) const -> std::filesystem::path
 {
-    return _servers.size();
+    if (_manifestDirectory.empty())
+        return {};
+
+    auto key = fnv1a64(config.url.empty() ? config.command : config.url);
+    for (const auto& arg: config.args)
+        key = fnv1a64(arg, fnv1a64("\x1f", key));
+    for (const auto& [name, value]: config.env)
+        key = fnv1a64(value, fnv1a64("=", fnv1a64(name, fnv1a64("\x1e", key))));
+    return _manifestDirectory / std::format("{:016x}.json", key);
 }
 
-void ServerManager::shutdown()
+void ServerManager::reapIdleServers(std::stop_token stopToken)
 {
-    _servers.clear();
-    _toolToServer.clear();
+    auto mutex = std::mutex {};
+    auto wakeup = std::condition_variable_any {};
+    auto lock = std::unique_lock(mutex);
+    while (!stopToken.stop_requested())
+    {
+        wakeup.wait_for(lock, stopToken, ReapInterval, [] { return false; });
+
+        auto idle = std::vector<std::shared_ptr<McpClient>> {};
+        {
+            auto const serversLock = std::unique_lock(_mutex);
+            auto const now = steadyNow();
+            for (auto const& server: _servers)
+            {
+                auto const timeout = std::chrono::seconds(server->config.idleTimeoutSeconds);
+                auto const idleFor = std::chrono::steady_clock::duration(now - server->lastUsed);
+                // A client referenced elsewhere is in use by a call.
+                auto const busy = !server->client || server->client.use_count() > 1;
+                if (timeout.count() <= 0 || busy || idleFor < timeout)
+                    continue;
+                log::info("Stopping idle MCP server '{}'", server->config.name);
+                idle.push_back(std::move(server->client));
+            }
+        }
+        // The clients close their transports here, outside the lock.
+    }
+}
+
+void ServerManager::refreshStaleTools(std::stop_token stopToken)
+{
+    while (true)
+    {
+        {
+            auto lock = std::unique_lock(_refreshMutex);
+            if (!_refreshWakeup.wait(lock, stopToken, [this] { return _refreshPending; }))
+                return;
+            _refreshPending = false;
+        }
+
+        auto stale = std::vector<std::pair<std::shared_ptr<ServerEntry>, std::shared_ptr<McpClient>>> {};
+        {
+            auto const lock = std::shared_lock(_mutex);
+            for (auto const& server: _servers)
+                if (server->client && server->toolsStale.exchange(false))
+                    stale.emplace_back(server, server->client);
+        }
+
+        for (auto const& [server, client]: stale)
+        {
+            auto tools = client->listTools(stopToken);
+            if (stopToken.stop_requested())
+                return;
+            if (!tools)
+            {
+                log::warning(
+                    "Failed to refresh the tools of '{}': {}", server->config.name, tools.error().message);
+                continue;
+            }
+
+            auto const lock = std::unique_lock(_mutex);
+            if (server->client == client) // Not stopped or restarted meanwhile.
+                updateTools(*server, std::move(*tools));
+        }
+    }
 }
 
 } // namespace mychat
@@ -3,12 +3,28 @@
 
 #include <core/Error.hpp>
 #include <core/Types.hpp>
+#include <mcp/HttpTransport.hpp>
 #include <mcp/McpClient.hpp>
 #include <mcp/StdioTransport.hpp>
+#include <mcp/UnixSocketTransport.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace mychat
@@ -21,9 +37,67 @@ struct McpServerConfig
     std::string command;
     std::vector<std::string> args;
     std::map<std::string, std::string> env;
+
+    /// Endpoint of a remote server speaking MCP Streamable HTTP; when set, it is used instead of
+    /// spawning @c command.
+    std::string url {};
+    std::map<std::string, std::string> headers {}; ///< HTTP headers for @c url, e.g. Authorization.
+
+    /// Tools whose results may be reused for identical arguments; "*" selects all tools of
+    /// the server. Only list tools without side effects whose results do not go stale quickly.
+    std::vector<std::string> cachedTools;
+    int cacheTtlSeconds = 300; ///< How long a cached result stays valid.
+
+    int startupTimeoutSeconds = 30;  ///< Time allowed for starting up and listing tools; 0 waits forever.
+    int requestTimeoutSeconds = 120; ///< Time allowed for each request, e.g. a tool call; 0 waits forever.
+
+    /// Advertise the tools remembered from an earlier run and only spawn the server when one
+    /// of them is called (see ServerManager::setManifestDirectory()).
+    bool lazyStart = true;
+    int idleTimeoutSeconds = 0; ///< Stops the server after this long without calls; 0 keeps it running.
+};
+
+/// @brief How the result of a tool call may be cached.
+struct ToolCachePolicy
+{
+    std::string server;       ///< Name of the server providing the tool.
+    std::chrono::seconds ttl; ///< Lifetime of a cached result.
 };
 
+/// @brief The tools of all registered servers at one point in time.
+///
+/// Snapshots are immutable and shared, so holding on to one is cheap and stays valid while
+/// servers come and go.
+struct ToolSnapshot
+{
+    std::uint64_t version = 0; ///< Increases whenever the set of tools changes.
+    std::vector<ToolDefinition> tools;
+};
+
+/// @brief Opens the transport a server's configuration describes.
+using TransportOpener = std::function<Result<std::unique_ptr<Transport>>()>;
+
+/// @brief Provides the transport of a server in place of the one its configuration describes.
+///
+/// Receives the configuration and a way to open its regular transport, so a factory can also wrap
+/// that transport instead of replacing it, e.g. to record the messages it carries.
+using TransportFactory =
+    std::function<Result<std::unique_ptr<Transport>>(const McpServerConfig& config, TransportOpener open)>;
+
 /// @brief Manages multiple MCP server connections and routes tool calls.
+///
+/// All methods may be called concurrently; servers that finish starting up become visible
+/// to toolSnapshot() and callTool() right away. When a server sends
+/// `notifications/tools/list_changed`, its tools are listed again in the background.
+///
+/// With a manifest directory set, each server's tool list is remembered on disk. Servers
+/// with McpServerConfig::lazyStart then advertise those tools without being spawned and
+/// are started by their first tool call.
+///
+/// Resources read from servers that support subscriptions are cached: the first read subscribes
+/// to the resource, later reads are answered locally until the server announces a change with
+/// `notifications/resources/updated`, which drops the cached contents. A server that was stopped,
+/// e.g. for being idle, starts over with an empty cache.
 class ServerManager
 {
   public:
@@ -33,37 +107,210 @@ class ServerManager
     ServerManager(const ServerManager&) = delete;
     ServerManager& operator=(const ServerManager&) = delete;
 
+    /// @brief Sets where tool manifests are kept; empty (the default) disables them.
+    ///
+    /// Must be called before adding servers. Manifests are keyed by the server's command,
+    /// arguments and environment, so changing any of them starts the server once to
+    /// refresh its tools.
+    void setManifestDirectory(std::filesystem::path directory);
+
+    /// @brief Runs local servers through the mychat-mcpd listening on @p socketPath.
+    ///
+    /// Must be called before adding servers. Servers are spawned directly whenever the daemon
+    /// cannot be reached; empty (the default) always spawns them directly.
+    void setDaemonSocket(std::string socketPath);
+
+    /// @brief Has @p factory provide the transports of all servers, e.g. to record or replay them.
+    ///
+    /// Must be called before adding servers. Without one (the default), each server's transport
+    /// is opened as its configuration describes.
+    void setTransportFactory(TransportFactory factory);
+
     /// @brief Starts and initializes an MCP server.
     /// @param config The server configuration.
     /// @return Success or an error.
     [[nodiscard]] auto addServer(const McpServerConfig& config) -> VoidResult;
 
+    /// @brief Starts and initializes several MCP servers concurrently.
+    ///
+    /// Each server's tools are registered as soon as its handshake completes, so a slow server
+    /// only delays its own tools. A server that does not complete within its
+    /// McpServerConfig::startupTimeoutSeconds is shut down again.
+    /// @param configs The server configurations.
+    /// @param stopToken Aborts the startup of all servers that are not ready yet.
+    /// @return One result per configuration, in the same order.
+    [[nodiscard]] auto addServers(std::span<const McpServerConfig> configs, std::stop_token stopToken = {})
+        -> std::vector<VoidResult>;
+
+    /// @brief Returns the current tools of all servers without copying them.
+    [[nodiscard]] auto toolSnapshot() const -> std::shared_ptr<const ToolSnapshot>;
+
     /// @brief Lists all available tools from all connected servers.
-    /// @return A vector of tool definitions.
+    /// @return A copy of the tool definitions of toolSnapshot().
     [[nodiscard]] auto allTools() -> std::vector<ToolDefinition>;
 
     /// @brief Calls a tool by name, routing to the correct server.
+    ///
+    /// Starts the server first if it is not running. Safe to call from several threads;
+    /// concurrent calls are multiplexed over the servers' connections, also when they go to
+    /// the same server.
     /// @param name The tool name.
     /// @param arguments The tool arguments.
+    /// @param stopToken Cancels the call on the server.
     /// @return The tool result or an error.
-    [[nodiscard]] auto callTool(std::string_view name, const nlohmann::json& arguments) -> Result<ToolResult>;
+    [[nodiscard]] auto callTool(std::string_view name,
+                                const nlohmann::json& arguments,
+                                std::stop_token stopToken = {}) -> Result<ToolResult>;
+
+    /// @brief Lists the resources of all servers that offer any, starting servers that are not running.
+    ///
+    /// Servers that fail to start or to list them are left out and logged.
+    /// @param stopToken Abandons the remaining requests.
+    [[nodiscard]] auto listResources(std::stop_token stopToken = {}) -> std::vector<McpResource>;
+
+    /// @brief Reads a resource of a server, from the cache if it has not changed since it was read.
+    /// @param server The name of the server offering it, see McpResource::server.
+    /// @param uri The resource's URI.
+    /// @param stopToken Abandons the request.
+    /// @return The items of its contents or an error.
+    [[nodiscard]] auto readResource(std::string_view server,
+                                    std::string_view uri,
+                                    std::stop_token stopToken = {})
+        -> Result<std::vector<McpResourceContent>>;
 
-    /// @brief Returns the number of connected servers.
+    /// @brief Lists the prompt templates of all servers that offer any, starting servers that are not
+    ///        running.
+    ///
+    /// Servers that fail to start or to list them are left out and logged.
+    /// @param stopToken Abandons the remaining requests.
+    [[nodiscard]] auto listPrompts(std::stop_token stopToken = {}) -> std::vector<McpPromptInfo>;
+
+    /// @brief Fills in a prompt template of a server.
+    /// @param server The name of the server offering it, see McpPromptInfo::server.
+    /// @param name The prompt's name.
+    /// @param arguments The values of its arguments, an object of strings.
+    /// @param stopToken Abandons the request.
+    /// @return The prompt's messages or an error.
+    [[nodiscard]] auto getPrompt(std::string_view server,
+                                 std::string_view name,
+                                 const nlohmann::json& arguments,
+                                 std::stop_token stopToken = {}) -> Result<McpPrompt>;
+
+    /// @brief Returns the cache policy of a tool, or std::nullopt if its results must not be cached.
+    [[nodiscard]] auto cachePolicy(std::string_view toolName) const -> std::optional<ToolCachePolicy>;
+
+    /// @brief Returns the number of registered servers, whether running or not.
     [[nodiscard]] auto serverCount() const -> size_t;
 
+    /// @brief Returns the number of servers whose process is running.
+    [[nodiscard]] auto runningServerCount() const -> size_t;
+
     /// @brief Shuts down all servers.
     void shutdown();
 
   private:
+    /// @brief What is known about a resource that was read from a server.
+    struct CachedResource
+    {
+        std::uint64_t updates = 0; ///< Changes the server announced, to tell a read that raced one.
+        bool subscribed = false;
+        std::optional<std::vector<McpResourceContent>> contents; ///< Empty until read, or once changed.
+    };
+
     struct ServerEntry
     {
-        std::string name;
-        std::unique_ptr<McpClient> client;
+        McpServerConfig config;
+        std::shared_ptr<McpClient> client; ///< Shared with in-flight tool calls; null while stopped.
         std::vector<ToolDefinition> tools;
+        std::mutex activationMutex;                               ///< Serializes on-demand starts.
+        std::atomic<std::chrono::steady_clock::rep> lastUsed = 0; ///< Steady clock ticks of the last call.
+        std::atomic<bool> toolsStale = false; ///< The server announced that its tools changed.
+
+        std::mutex resourceMutex;                                  ///< Guards the members below.
+        std::unordered_map<std::string, CachedResource> resources; ///< By URI, of the current client.
+        std::uint64_t connections = 0;                             ///< Clients watched so far.
     };
 
-    std::vector<ServerEntry> _servers;
-    std::map<std::string, size_t> _toolToServer; // tool name → server index
+    /// @brief Hashes strings and string views alike, for lookups without a temporary string.
+    struct StringHash
+    {
+        using is_transparent = void;
+        auto operator()(std::string_view text) const noexcept -> size_t
+        {
+            return std::hash<std::string_view> {}(text);
+        }
+    };
+
+    /// @brief A running server together with the tools it reported.
+    struct Connection
+    {
+        std::shared_ptr<McpClient> client;
+        std::vector<ToolDefinition> tools;
+    };
+
+    std::filesystem::path _manifestDirectory;
+    std::string _daemonSocket;
+    std::shared_ptr<HttpConnectionPool> _httpPool; ///< Keep-alive connections shared by remote servers.
+    TransportFactory _transportFactory;
+
+    mutable std::shared_mutex _mutex; ///< Guards the members below and the entries' clients and tools.
+    std::vector<std::shared_ptr<ServerEntry>> _servers;
+    std::unordered_map<std::string, ServerEntry*, StringHash, std::equal_to<>> _toolToServer;
+    std::shared_ptr<const ToolSnapshot> _toolSnapshot; ///< Published by publishTools().
+    std::jthread _reaper; ///< Stops idle servers; started with the first server that has an idle timeout.
+    std::jthread _refresher; ///< Lists the tools of servers that announced a change.
+
+    std::mutex _refreshMutex; ///< Guards _refreshPending.
+    std::condition_variable_any _refreshWakeup;
+    bool _refreshPending = false;
+
+    /// @brief Registers a server, starting it unless its manifest allows a lazy start.
+    [[nodiscard]] auto startServer(const McpServerConfig& config, std::stop_token stopToken) -> VoidResult;
+
+    /// @brief Opens the transport @p config describes: HTTP, the daemon's socket or a child process.
+    [[nodiscard]] auto openTransport(const McpServerConfig& config) const
+        -> Result<std::unique_ptr<Transport>>;
+
+    /// @brief Spawns (or connects to) a server and performs the initialize and tools/list handshake.
+    [[nodiscard]] auto connect(const McpServerConfig& config, std::stop_token stopToken) const
+        -> Result<Connection>;
+
+    /// @brief Returns the server's client, starting the server if it is not running.
+    [[nodiscard]] auto activate(std::shared_ptr<ServerEntry> const& server)
+        -> Result<std::shared_ptr<McpClient>>;
+
+    /// @brief Makes a server and its tools available.
+    void registerServer(std::shared_ptr<ServerEntry> server);
+
+    /// @brief Returns the registered server named @p name, or null.
+    [[nodiscard]] auto findServer(std::string_view name) const -> std::shared_ptr<ServerEntry>;
+
+    /// @brief Returns all registered servers.
+    [[nodiscard]] auto servers() const -> std::vector<std::shared_ptr<ServerEntry>>;
+
+    /// @brief Has @p client's notifications mark @p server's tools for a refresh and drop the cached
+    ///        contents of changed resources, starting with an empty resource cache.
+    void watchServer(std::shared_ptr<ServerEntry> const& server, McpClient& client);
+
+    /// @brief Replaces the tools of a registered server. Requires _mutex to be held exclusively.
+    void replaceTools(ServerEntry& server, std::vector<ToolDefinition> tools);
+
+    /// @brief Adopts a freshly listed tool set if it differs from the known one, updating the manifest.
+    ///
+    /// Requires _mutex to be held exclusively.
+    void updateTools(ServerEntry& server, std::vector<ToolDefinition> tools);
+
+    /// @brief Publishes a new ToolSnapshot of all servers' tools. Requires _mutex to be held exclusively.
+    void publishTools();
+
+    /// @brief Returns the path of the tool manifest for @p config, or an empty path if disabled.
+    [[nodiscard]] auto manifestPath(const McpServerConfig& config) const -> std::filesystem::path;
+
+    /// @brief Periodically stops servers that exceeded their idle timeout.
+    void reapIdleServers(std::stop_token stopToken);
+
+    /// @brief Lists the tools of servers marked by watchServer() again, whenever woken up.
+    void refreshStaleTools(std::stop_token stopToken);
 };
 
 } // namespace mychat
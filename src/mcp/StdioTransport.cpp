@@ -3,8 +3,20 @@
 
 #include <core/JsonUtils.hpp>
 #include <core/Log.hpp>
-
+#include <mcp/LineBuffer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <format>
+#include <optional>
+#include <string>
+#include <string_view>
 
 #ifdef _WIN32
     #define WIN32_LEAN_AND_MEAN
@@ -12,6 +24,8 @@
 #else
     #include <sys/wait.h>
 
+    #include <fcntl.h>
+    #include <poll.h>
     #include <signal.h>
     #include <spawn.h>
     #include <unistd.h>
@@ -22,6 +36,30 @@ extern char** environ;
 namespace mychat
 {
 
+#ifndef _WIN32
+namespace
+{
+
+    /// @brief Creates a pipe whose ends are not inherited by processes spawned later.
+    ///
+    /// Servers are spawned concurrently, so without close-on-exec a server would keep the
+    /// pipes of its siblings open and they would never see end-of-file.
+    auto createPipe(int (&fds)[2]) -> bool
+    {
+    #if defined(__linux__) || defined(__FreeBSD__)
+        return pipe2(fds, O_CLOEXEC) == 0;
+    #else
+        if (pipe(fds) != 0)
+            return false;
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+    #endif
+    }
+
+} // namespace
+#endif
+
 struct StdioTransport::Impl
 {
 #ifdef _WIN32
@@ -30,11 +68,75 @@ struct StdioTransport::Impl
     HANDLE stdoutRead = INVALID_HANDLE_VALUE;
 #else
     pid_t childPid = -1;
-    int stdinWrite = -1;
-    int stdoutRead = -1;
+    int stdinWrite = -1; ///< Non-blocking.
+    int stdoutRead = -1; ///< Non-blocking.
+    int wakeRead = -1;   ///< Becomes readable when close() is called, waking a blocked poll().
+    int wakeWrite = -1;
+#endif
+    std::atomic<bool> connected = false; ///< Read by the receiving thread while another one sends.
+    std::chrono::milliseconds writeTimeout {};
+    std::string writeBuffer; ///< Serialized messages of the batch being sent; reused across sends.
+
+    LineBuffer lines; ///< Data received from the child's stdout.
+
+    /// @brief Closes the read end of the child's stdout (and the wake-up pipe).
+    ///
+    /// Not part of close(), which may run while another thread is blocked reading.
+    void closeStdout()
+    {
+#ifdef _WIN32
+        if (stdoutRead != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(stdoutRead);
+            stdoutRead = INVALID_HANDLE_VALUE;
+        }
+#else
+        for (auto* fd: { &stdoutRead, &wakeRead, &wakeWrite })
+        {
+            if (*fd >= 0)
+            {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+#endif
+    }
+
+#ifndef _WIN32
+    /// @brief Waits until @p fd is ready for @p events.
+    /// @param deadline When to give up, or std::nullopt to wait until ready or closed.
+    /// @return Success, a TimeoutError, or a TransportError once close() was called.
+    [[nodiscard]] auto waitUntilReady(int fd,
+                                      short events,
+                                      std::optional<std::chrono::steady_clock::time_point> deadline) const
+        -> VoidResult
+    {
+        while (true)
+        {
+            auto timeoutMs = -1;
+            if (deadline)
+            {
+                auto const left = std::chrono::ceil<std::chrono::milliseconds>(
+                    *deadline - std::chrono::steady_clock::now());
+                if (left <= std::chrono::milliseconds::zero())
+                    return makeError(ErrorCode::TimeoutError, "Timed out waiting for the MCP server");
+                timeoutMs = static_cast<int>(std::min<std::int64_t>(left.count(), INT_MAX));
+            }
+
+            auto fds = std::array {
+                pollfd { .fd = fd, .events = events, .revents = 0 },
+                pollfd { .fd = wakeRead, .events = POLLIN, .revents = 0 },
+            };
+            auto const ready = ::poll(fds.data(), fds.size(), timeoutMs);
+            if (ready < 0 && errno != EINTR)
+                return makeError(ErrorCode::TransportError, std::format("poll failed: {}", strerror(errno)));
+            if (fds[1].revents != 0)
+                return makeError(ErrorCode::TransportError, "Transport closed");
+            if (fds[0].revents != 0)
+                return {}; // Also on hang-up or error, which the following read or write reports.
+        }
+    }
 #endif
-    bool connected = false;
-    std::string readBuffer;
 };
 
 StdioTransport::StdioTransport(): _impl(std::make_unique<Impl>())
@@ -44,6 +146,7 @@ StdioTransport::StdioTransport(): _impl(std::make_unique<Impl>())
 StdioTransport::~StdioTransport()
 {
     close();
+    _impl->closeStdout();
 }
 
 auto StdioTransport::start(const StdioTransportConfig& config) -> VoidResult
@@ -51,6 +154,10 @@ auto StdioTransport::start(const StdioTransportConfig& config) -> VoidResult
     if (_impl->connected)
         return makeError(ErrorCode::TransportError, "Transport already connected");
 
+    _impl->closeStdout();
+    _impl->writeTimeout = config.writeTimeout;
+    _impl->lines.clear();
+
 #ifdef _WIN32
     // Windows: CreateProcess with pipes
     SECURITY_ATTRIBUTES sa {};
@@ -104,14 +211,21 @@ auto StdioTransport::start(const StdioTransportConfig& config) -> VoidResult
     int stdinPipe[2];
     int stdoutPipe[2];
 
-    if (pipe(stdinPipe) != 0)
+    if (!createPipe(stdinPipe))
         return makeError(ErrorCode::TransportError, "Failed to create stdin pipe");
-    if (pipe(stdoutPipe) != 0)
+    if (!createPipe(stdoutPipe))
     {
         ::close(stdinPipe[0]);
         ::close(stdinPipe[1]);
         return makeError(ErrorCode::TransportError, "Failed to create stdout pipe");
     }
+    int wakePipe[2];
+    if (!createPipe(wakePipe))
+    {
+        for (auto const fd: { stdinPipe[0], stdinPipe[1], stdoutPipe[0], stdoutPipe[1] })
+            ::close(fd);
+        return makeError(ErrorCode::TransportError, "Failed to create wake-up pipe");
+    }
 
     posix_spawn_file_actions_t actions;
     posix_spawn_file_actions_init(&actions);
@@ -154,15 +268,21 @@ auto StdioTransport::start(const StdioTransportConfig& config) -> VoidResult
 
     if (status != 0)
     {
-        ::close(stdinPipe[1]);
-        ::close(stdoutPipe[0]);
+        for (auto const fd: { stdinPipe[1], stdoutPipe[0], wakePipe[0], wakePipe[1] })
+            ::close(fd);
         return makeError(ErrorCode::TransportError,
                          std::format("Failed to spawn process '{}': {}", config.command, strerror(status)));
     }
 
+    // Only our ends become non-blocking; the child's are separate open file descriptions.
+    fcntl(stdinPipe[1], F_SETFL, fcntl(stdinPipe[1], F_GETFL) | O_NONBLOCK);
+    fcntl(stdoutPipe[0], F_SETFL, fcntl(stdoutPipe[0], F_GETFL) | O_NONBLOCK);
+
     _impl->childPid = pid;
     _impl->stdinWrite = stdinPipe[1];
     _impl->stdoutRead = stdoutPipe[0];
+    _impl->wakeRead = wakePipe[0];
+    _impl->wakeWrite = wakePipe[1];
 #endif
 
     _impl->connected = true;
@@ -171,85 +291,127 @@ auto StdioTransport::start(const StdioTransportConfig& config) -> VoidResult
 }
 
 auto StdioTransport::send(const nlohmann::json& message) -> VoidResult
+{
+    return sendBatch(std::span(&message, 1));
+}
+
+auto StdioTransport::sendBatch(std::span<const nlohmann::json> messages) -> VoidResult
 {
     if (!_impl->connected)
         return makeError(ErrorCode::TransportError, "Transport not connected");
 
-    auto const data = message.dump() + "\n";
+    // Serialize all messages into one reused buffer, so a batch costs no allocations once the
+    // buffer has grown and is written with as few syscalls as the pipe allows.
+    auto& data = _impl->writeBuffer;
+    data.clear();
+    for (auto const& message: messages)
+    {
+        auto serializer = nlohmann::detail::serializer<nlohmann::json>(
+            nlohmann::detail::output_adapter<char>(data), ' ', nlohmann::json::error_handler_t::strict);
+        serializer.dump(message, false, false, 0);
+        data += '\n';
+    }
 
+    auto remaining = std::string_view(data);
 #ifdef _WIN32
-    DWORD written;
-    if (!WriteFile(_impl->stdinWrite, data.c_str(), static_cast<DWORD>(data.size()), &written, nullptr))
-        return makeError(ErrorCode::TransportError, "Failed to write to process stdin");
+    while (!remaining.empty())
+    {
+        auto written = DWORD { 0 };
+        auto const size = static_cast<DWORD>(remaining.size());
+        if (!WriteFile(_impl->stdinWrite, remaining.data(), size, &written, nullptr))
+            return makeError(ErrorCode::TransportError, "Failed to write to process stdin");
+        remaining.remove_prefix(written);
+    }
 #else
-    auto const result = ::write(_impl->stdinWrite, data.c_str(), data.size());
-    if (result < 0)
-        return makeError(ErrorCode::TransportError, "Failed to write to process stdin");
+    auto const deadline = _impl->writeTimeout > std::chrono::milliseconds::zero()
+                              ? std::optional(std::chrono::steady_clock::now() + _impl->writeTimeout)
+                              : std::nullopt;
+    while (!remaining.empty())
+    {
+        auto const written = ::write(_impl->stdinWrite, remaining.data(), remaining.size());
+        if (written >= 0)
+        {
+            remaining.remove_prefix(static_cast<size_t>(written));
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return makeError(ErrorCode::TransportError, "Failed to write to process stdin");
+
+        // The server is not reading its input; wait for room in the pipe.
+        if (auto ready = _impl->waitUntilReady(_impl->stdinWrite, POLLOUT, deadline); !ready)
+        {
+            // Half a message would garble every later one, so such a connection is given up.
+            if (remaining.size() < data.size())
+                close();
+            return std::unexpected(ready.error());
+        }
+    }
 #endif
 
     return {};
 }
 
 auto StdioTransport::receive() -> Result<nlohmann::json>
+{
+    return receiveText().and_then([](std::string const& text) { return json::parse(text); });
+}
+
+auto StdioTransport::receiveText() -> Result<std::string>
 {
     if (!_impl->connected)
         return makeError(ErrorCode::TransportError, "Transport not connected");
 
-    // Read until we get a complete line
     while (true)
     {
-        auto const newlinePos = _impl->readBuffer.find('\n');
-        if (newlinePos != std::string::npos)
+        if (auto const line = _impl->lines.nextLine())
         {
-            auto line = _impl->readBuffer.substr(0, newlinePos);
-            _impl->readBuffer.erase(0, newlinePos + 1);
-
-            if (line.empty())
+            if (line->empty())
                 continue;
-
-            return json::parse(line);
+            return std::string(*line);
         }
 
-        auto buf = std::array<char, 4096> {};
+#ifndef _WIN32
+        if (auto ready = _impl->waitUntilReady(_impl->stdoutRead, POLLIN, std::nullopt); !ready)
+            return std::unexpected(ready.error());
+#endif
+
+        auto readError = 0;
+        auto const bytesRead = _impl->lines.read([&](char* data, size_t size) -> std::int64_t {
 #ifdef _WIN32
-        DWORD bytesRead;
-        if (!ReadFile(_impl->stdoutRead, buf.data(), static_cast<DWORD>(buf.size()), &bytesRead, nullptr)
-            || bytesRead == 0)
-        {
-            _impl->connected = false;
-            return makeError(ErrorCode::TransportError, "Process stdout closed");
-        }
-        _impl->readBuffer.append(buf.data(), bytesRead);
+            auto count = DWORD { 0 };
+            if (!ReadFile(_impl->stdoutRead, data, static_cast<DWORD>(size), &count, nullptr))
+                return -1;
+            return count;
 #else
-        auto const bytesRead = ::read(_impl->stdoutRead, buf.data(), buf.size());
+            auto const count = ::read(_impl->stdoutRead, data, size);
+            readError = errno;
+            return count;
+#endif
+        });
+
+        if (bytesRead < 0 && (readError == EAGAIN || readError == EWOULDBLOCK || readError == EINTR))
+            continue;
         if (bytesRead <= 0)
         {
             _impl->connected = false;
             return makeError(ErrorCode::TransportError, "Process stdout closed");
         }
-        _impl->readBuffer.append(buf.data(), static_cast<size_t>(bytesRead));
-#endif
     }
 }
 
 void StdioTransport::close()
 {
-    if (!_impl->connected)
+    if (!_impl->connected.exchange(false))
         return;
 
-    _impl->connected = false;
-
 #ifdef _WIN32
     if (_impl->stdinWrite != INVALID_HANDLE_VALUE)
     {
         CloseHandle(_impl->stdinWrite);
         _impl->stdinWrite = INVALID_HANDLE_VALUE;
     }
-    if (_impl->stdoutRead != INVALID_HANDLE_VALUE)
-    {
-        CloseHandle(_impl->stdoutRead);
-        _impl->stdoutRead = INVALID_HANDLE_VALUE;
-    }
     if (_impl->childProcess != INVALID_HANDLE_VALUE)
     {
         TerminateProcess(_impl->childProcess, 0);
@@ -258,16 +420,13 @@ void StdioTransport::close()
         _impl->childProcess = INVALID_HANDLE_VALUE;
     }
 #else
+    if (_impl->wakeWrite >= 0)
+        (void) ::write(_impl->wakeWrite, "x", 1);
     if (_impl->stdinWrite >= 0)
     {
         ::close(_impl->stdinWrite);
         _impl->stdinWrite = -1;
     }
-    if (_impl->stdoutRead >= 0)
-    {
-        ::close(_impl->stdoutRead);
-        _impl->stdoutRead = -1;
-    }
     if (_impl->childPid > 0)
     {
         kill(_impl->childPid, SIGTERM);
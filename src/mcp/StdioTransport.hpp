@@ -3,6 +3,7 @@
 
 #include <mcp/Transport.hpp>
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <string>
@@ -17,11 +18,16 @@ struct StdioTransportConfig
     std::string command;
     std::vector<std::string> args;
     std::map<std::string, std::string> env;
+
+    /// How long send() may wait for a server that does not read its input; zero waits forever.
+    std::chrono::milliseconds writeTimeout {};
 };
 
 /// @brief Transport that communicates with an MCP server via stdio pipes.
 ///
-/// Spawns a child process and communicates via its stdin/stdout.
+/// Spawns a child process and communicates via its stdin/stdout. On POSIX systems the pipes
+/// are non-blocking and driven by poll(), so close() wakes up a blocked receive() and a send()
+/// to a stalled server gives up after StdioTransportConfig::writeTimeout.
 class StdioTransport: public Transport
 {
   public:
@@ -37,7 +43,9 @@ class StdioTransport: public Transport
     [[nodiscard]] auto start(const StdioTransportConfig& config) -> VoidResult;
 
     [[nodiscard]] auto send(const nlohmann::json& message) -> VoidResult override;
+    [[nodiscard]] auto sendBatch(std::span<const nlohmann::json> messages) -> VoidResult override;
     [[nodiscard]] auto receive() -> Result<nlohmann::json> override;
+    [[nodiscard]] auto receiveText() -> Result<std::string> override;
     void close() override;
     [[nodiscard]] auto isConnected() const -> bool override;
 
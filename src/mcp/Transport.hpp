@@ -5,10 +5,16 @@
 
 #include <nlohmann/json.hpp>
 
+#include <span>
+#include <string>
+
 namespace mychat
 {
 
 /// @brief Abstract interface for MCP transport communication.
+///
+/// send() and receive() are called from different threads (but each from one thread at
+/// a time), so implementations must allow a send while a receive is blocked.
 class Transport
 {
   public:
@@ -19,11 +25,35 @@ class Transport
     /// @return Success or an error.
     [[nodiscard]] virtual auto send(const nlohmann::json& message) -> VoidResult = 0;
 
+    /// @brief Sends several JSON messages, in order.
+    ///
+    /// Transports that can write them in one go should override this; the default sends
+    /// them one by one.
+    /// @param messages The JSON messages to send.
+    /// @return Success or the first error, after which the remaining messages are not sent.
+    [[nodiscard]] virtual auto sendBatch(std::span<const nlohmann::json> messages) -> VoidResult
+    {
+        for (auto const& message: messages)
+            if (auto sent = send(message); !sent)
+                return sent;
+        return {};
+    }
+
     /// @brief Receives a JSON message from the server (blocking).
     /// @return The received JSON message or an error.
     [[nodiscard]] virtual auto receive() -> Result<nlohmann::json> = 0;
 
-    /// @brief Closes the transport connection.
+    /// @brief Receives a JSON message from the server as text, without parsing it (blocking).
+    ///
+    /// Lets the caller parse only what it needs, see jsonrpc::scanMessage(). Transports that
+    /// receive text should override this; the default serializes what receive() returns.
+    /// @return The received JSON text or an error.
+    [[nodiscard]] virtual auto receiveText() -> Result<std::string>
+    {
+        return receive().transform([](nlohmann::json const& message) { return message.dump(); });
+    }
+
+    /// @brief Closes the transport connection, making a blocked receive() return an error.
     virtual void close() = 0;
 
     /// @brief Returns true if the transport is connected.
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "UnixSocketTransport.hpp"
+
+#include <core/JsonUtils.hpp>
+#include <core/Log.hpp>
+#include <mcp/LineBuffer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/un.h>
+
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+namespace mychat
+{
+
+struct UnixSocketTransport::Impl
+{
+    int socket = -1; ///< Non-blocking; closed by the destructor only, as a receive may be blocked on it.
+    std::atomic<bool> connected = false;
+    std::chrono::milliseconds writeTimeout {};
+    std::string writeBuffer; ///< Serialized messages of the batch being sent; reused across sends.
+    LineBuffer lines;
+
+    void closeSocket()
+    {
+#ifndef _WIN32
+        if (socket >= 0)
+        {
+            ::close(socket);
+            socket = -1;
+        }
+#endif
+    }
+
+#ifndef _WIN32
+    /// @brief Waits until the socket is ready for @p events.
+    /// @param deadline When to give up, or std::nullopt to wait until ready or closed.
+    [[nodiscard]] auto waitUntilReady(short events,
+                                      std::optional<std::chrono::steady_clock::time_point> deadline) const
+        -> VoidResult
+    {
+        while (true)
+        {
+            auto timeoutMs = -1;
+            if (deadline)
+            {
+                auto const left = std::chrono::ceil<std::chrono::milliseconds>(
+                    *deadline - std::chrono::steady_clock::now());
+                if (left <= std::chrono::milliseconds::zero())
+                    return makeError(ErrorCode::TimeoutError, "Timed out waiting for mychat-mcpd");
+                timeoutMs = static_cast<int>(std::min<std::int64_t>(left.count(), INT_MAX));
+            }
+
+            auto fd = pollfd { .fd = socket, .events = events, .revents = 0 };
+            auto const ready = ::poll(&fd, 1, timeoutMs);
+            if (ready < 0 && errno != EINTR)
+                return makeError(ErrorCode::TransportError, std::format("poll failed: {}", strerror(errno)));
+            if (!connected)
+                return makeError(ErrorCode::TransportError, "Transport closed");
+            if (ready > 0)
+                return {}; // Also on hang-up or error, which the following read or write reports.
+        }
+    }
+
+    /// @brief Writes all of writeBuffer.
+    [[nodiscard]] auto flush() -> VoidResult
+    {
+        auto const deadline = writeTimeout > std::chrono::milliseconds::zero()
+                                  ? std::optional(std::chrono::steady_clock::now() + writeTimeout)
+                                  : std::nullopt;
+        auto remaining = std::string_view(writeBuffer);
+        while (!remaining.empty())
+        {
+    #ifdef MSG_NOSIGNAL
+            auto const written = ::send(socket, remaining.data(), remaining.size(), MSG_NOSIGNAL);
+    #else
+            auto const written = ::send(socket, remaining.data(), remaining.size(), 0);
+    #endif
+            if (written >= 0)
+            {
+                remaining.remove_prefix(static_cast<size_t>(written));
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return makeError(ErrorCode::TransportError, "Failed to write to mychat-mcpd");
+
+            if (auto ready = waitUntilReady(POLLOUT, deadline); !ready)
+            {
+                // Half a message would garble every later one, so such a connection is given up.
+                if (remaining.size() < writeBuffer.size())
+                {
+                    connected = false;
+                    ::shutdown(socket, SHUT_RDWR);
+                }
+                return std::unexpected(ready.error());
+            }
+        }
+        return {};
+    }
+#endif
+};
+
+UnixSocketTransport::UnixSocketTransport(): _impl(std::make_unique<Impl>())
+{
+}
+
+UnixSocketTransport::~UnixSocketTransport()
+{
+    close();
+    _impl->closeSocket();
+}
+
+auto UnixSocketTransport::start(const UnixSocketTransportConfig& config) -> VoidResult
+{
+#ifdef _WIN32
+    (void) config;
+    return makeError(ErrorCode::TransportError, "Unix domain sockets are not supported on this platform");
+#else
+    if (_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport already connected");
+
+    _impl->closeSocket();
+    _impl->lines.clear();
+    _impl->writeTimeout = config.writeTimeout;
+
+    auto address = sockaddr_un {};
+    address.sun_family = AF_UNIX;
+    if (config.socketPath.size() >= sizeof(address.sun_path))
+        return makeError(ErrorCode::InvalidArgument,
+                         std::format("Socket path too long: {}", config.socketPath));
+    std::ranges::copy(config.socketPath, address.sun_path);
+
+    _impl->socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_impl->socket < 0)
+        return makeError(ErrorCode::TransportError, std::format("socket failed: {}", strerror(errno)));
+    fcntl(_impl->socket, F_SETFD, FD_CLOEXEC);
+
+    if (::connect(_impl->socket, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0)
+    {
+        auto const error = errno;
+        _impl->closeSocket();
+        return makeError(ErrorCode::TransportError,
+                         std::format("Cannot connect to mychat-mcpd at {}: {}",
+                                     config.socketPath,
+                                     strerror(error)));
+    }
+    fcntl(_impl->socket, F_SETFL, fcntl(_impl->socket, F_GETFL) | O_NONBLOCK);
+    _impl->connected = true;
+
+    // Tell the daemon which server this connection is for.
+    auto attach = nlohmann::json {
+        { "attach",
+          nlohmann::json {
+              { "command", config.command },
+              { "args", config.args },
+              { "env", config.env },
+          } },
+    };
+    _impl->writeBuffer = attach.dump();
+    _impl->writeBuffer += '\n';
+    if (auto flushed = _impl->flush(); !flushed)
+    {
+        close();
+        return flushed;
+    }
+
+    log::info("MCP server attached via mychat-mcpd: {}", config.command);
+    return {};
+#endif
+}
+
+auto UnixSocketTransport::send(const nlohmann::json& message) -> VoidResult
+{
+    return sendBatch(std::span(&message, 1));
+}
+
+auto UnixSocketTransport::sendBatch(std::span<const nlohmann::json> messages) -> VoidResult
+{
+    if (!_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport not connected");
+
+#ifdef _WIN32
+    (void) messages;
+    return makeError(ErrorCode::TransportError, "Transport not connected");
+#else
+    auto& data = _impl->writeBuffer;
+    data.clear();
+    for (auto const& message: messages)
+    {
+        auto serializer = nlohmann::detail::serializer<nlohmann::json>(
+            nlohmann::detail::output_adapter<char>(data), ' ', nlohmann::json::error_handler_t::strict);
+        serializer.dump(message, false, false, 0);
+        data += '\n';
+    }
+    return _impl->flush();
+#endif
+}
+
+auto UnixSocketTransport::receive() -> Result<nlohmann::json>
+{
+    return receiveText().and_then([](std::string const& text) { return json::parse(text); });
+}
+
+auto UnixSocketTransport::receiveText() -> Result<std::string>
+{
+    if (!_impl->connected)
+        return makeError(ErrorCode::TransportError, "Transport not connected");
+
+#ifdef _WIN32
+    return makeError(ErrorCode::TransportError, "Transport not connected");
+#else
+    while (true)
+    {
+        if (auto const line = _impl->lines.nextLine())
+        {
+            if (line->empty())
+                continue;
+            return std::string(*line);
+        }
+
+        if (auto ready = _impl->waitUntilReady(POLLIN, std::nullopt); !ready)
+            return std::unexpected(ready.error());
+
+        auto readError = 0;
+        auto const bytesRead = _impl->lines.read([&](char* data, size_t size) -> std::int64_t {
+            auto const count = ::recv(_impl->socket, data, size, 0);
+            readError = errno;
+            return count;
+        });
+
+        if (bytesRead < 0 && (readError == EAGAIN || readError == EWOULDBLOCK || readError == EINTR))
+            continue;
+        if (bytesRead <= 0)
+        {
+            _impl->connected = false;
+            return makeError(ErrorCode::TransportError, "mychat-mcpd closed the connection");
+        }
+    }
+#endif
+}
+
+void UnixSocketTransport::close()
+{
+    if (!_impl->connected.exchange(false))
+        return;
+
+#ifndef _WIN32
+    // Wakes up a blocked receive(); the descriptor itself stays valid until destruction.
+    ::shutdown(_impl->socket, SHUT_RDWR);
+#endif
+    log::debug("MCP transport closed");
+}
+
+auto UnixSocketTransport::isConnected() const -> bool
+{
+    return _impl->connected;
+}
+
+} // namespace mychat
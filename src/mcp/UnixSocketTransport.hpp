@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <mcp/Transport.hpp>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Configuration for reaching an MCP server through a running mychat-mcpd.
+struct UnixSocketTransportConfig
+{
+    std::string socketPath; ///< The daemon's socket (see defaultMcpDaemonSocketPath()).
+
+    /// The server the daemon should attach this connection to, spawning it if it is not running.
+    std::string command;
+    std::vector<std::string> args;
+    std::map<std::string, std::string> env;
+
+    /// How long send() may wait for a daemon that does not read; zero waits forever.
+    std::chrono::milliseconds writeTimeout {};
+};
+
+/// @brief Transport that talks to an MCP server owned by mychat-mcpd over a Unix domain socket.
+///
+/// After connecting, the transport tells the daemon which server it wants (see McpDaemon for
+/// the protocol); from then on it carries newline-delimited JSON-RPC messages like
+/// StdioTransport, with the daemon multiplexing them onto the shared server process.
+///
+/// Only available on POSIX systems; start() fails elsewhere.
+class UnixSocketTransport: public Transport
+{
+  public:
+    UnixSocketTransport();
+    ~UnixSocketTransport() override;
+
+    UnixSocketTransport(const UnixSocketTransport&) = delete;
+    UnixSocketTransport& operator=(const UnixSocketTransport&) = delete;
+
+    /// @brief Connects to the daemon and attaches to the configured server.
+    /// @param config The connection configuration.
+    /// @return Success or an error, e.g. if no daemon is listening.
+    [[nodiscard]] auto start(const UnixSocketTransportConfig& config) -> VoidResult;
+
+    [[nodiscard]] auto send(const nlohmann::json& message) -> VoidResult override;
+    [[nodiscard]] auto sendBatch(std::span<const nlohmann::json> messages) -> VoidResult override;
+    [[nodiscard]] auto receive() -> Result<nlohmann::json> override;
+    [[nodiscard]] auto receiveText() -> Result<std::string> override;
+    void close() override;
+    [[nodiscard]] auto isConnected() const -> bool override;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+} // namespace mychat
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/Log.hpp>
+#include <mcp/McpDaemon.hpp>
+
+#include <CLI/CLI.hpp>
+
+#include <pthread.h>
+#include <signal.h>
+
+int main(int argc, char** argv)
+{
+    auto app = CLI::App { "mychat-mcpd — keeps MCP servers running for mychat" };
+
+    auto socketPath = mychat::defaultMcpDaemonSocketPath();
+    auto verbose = false;
+
+    app.add_option("-s,--socket", socketPath, "Unix socket to listen on")->capture_default_str();
+    app.add_flag("-v,--verbose", verbose, "Enable verbose logging");
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (verbose)
+        mychat::log::setLevel(mychat::log::Level::Debug);
+
+    // Block the termination signals before any thread starts, so only sigwait() below sees them.
+    auto signals = sigset_t {};
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto daemon = mychat::McpDaemon();
+    if (auto started = daemon.start(socketPath); !started)
+    {
+        mychat::log::error("{}", started.error().message);
+        return 1;
+    }
+
+    auto received = 0;
+    sigwait(&signals, &received);
+    mychat::log::info("Received signal {}, shutting down", received);
+    daemon.stop();
+    return 0;
+}
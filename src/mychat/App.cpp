@@ -2,35 +2,56 @@
 #include "App.hpp"
 
 #include <agent/AgentLoop.hpp>
+#include <agent/AgentWorker.hpp>
+#include <agent/MemoryIndex.hpp>
 #include <audio/AudioPipeline.hpp>
+#include <audio/SpeechChunker.hpp>
 #include <audio/TtsSpeaker.hpp>
+#include <core/CpuBudget.hpp>
+#include <core/Hash.hpp>
 #include <core/Log.hpp>
+#include <core/MemoryRegistry.hpp>
+#include <core/Trace.hpp>
 #include <llm/ChatSession.hpp>
 #include <llm/LlmEngine.hpp>
+#include <llm/ModelPool.hpp>
+#include <llm/SessionStore.hpp>
+#include <mcp/McpDaemon.hpp>
 #include <mcp/ServerManager.hpp>
 #include <mychat/Config.hpp>
+#include <mychat/Startup.hpp>
 
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <deque>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <mutex>
+#include <optional>
 #include <print>
+#include <ranges>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include <tui/Box.hpp>
+#include <tui/FrameScheduler.hpp>
+#include <tui/Image.hpp>
 #include <tui/InputField.hpp>
 #include <tui/LogPanel.hpp>
 #include <tui/MarkdownRenderer.hpp>
+#include <tui/Scrollback.hpp>
 #include <tui/Spinner.hpp>
 #include <tui/StatusBar.hpp>
 #include <tui/Terminal.hpp>
+#include <tui/Text.hpp>
 #include <tui/Theme.hpp>
+#include <tui/Unicode.hpp>
 
 namespace mychat
 {
@@ -46,6 +67,30 @@ namespace
     constexpr auto InputBoxMinHeight = 3;   ///< Minimum input box height (1 content line + 2 borders)
     constexpr auto InputBoxMaxHeight = 10;  ///< Maximum input box height before scrolling
     constexpr auto InputBoxMaxWidth = 64;
+    constexpr auto ChatScrollStep = 3;      ///< Rows the chat area scrolls per mouse wheel step
+
+    /// Log messages held for the log panel; model loading logs a few hundred before the TUI starts.
+    constexpr auto LogQueueCapacity = std::size_t { 4096 };
+
+    /// Stored sessions listed by /history.
+    constexpr auto SessionListLimit = size_t { 20 };
+
+    /// Most recent stored sessions indexed for retrieval when a model's memory index is started.
+    constexpr auto MemoryBackfillSessions = size_t { 200 };
+
+    // Input poll timeouts while a turn streams, and for animating the voice meter
+    constexpr auto StreamingPollInterval = std::chrono::milliseconds { 16 };
+    constexpr auto VoiceMeterInterval = std::chrono::milliseconds { 100 };
+
+    /// Name of the main model among those of /model.
+    constexpr auto DefaultModelName = std::string_view { "default" };
+
+    // Typing pause after which the message being typed is prefilled
+    constexpr auto DraftPrefillDelay = std::chrono::milliseconds { 300 };
+
+    // Largest size in pixels at which tool images are shown
+    constexpr auto ToolImageMaxWidth = 640;
+    constexpr auto ToolImageMaxHeight = 480;
 
     // Style helpers for terminal output
     auto greenStyle() -> tui::Style
@@ -91,12 +136,40 @@ struct LayoutGeometry
 struct App::Impl
 {
     AppConfig config;
-    LlmEngine engine;
+    ModelPool models { static_cast<size_t>(std::max(0, config.llm.modelPoolMb)) * 1'000'000 };
+    LlmEngine* engine = nullptr; ///< The active model, acquired from models once it is loaded.
+    std::string activeModel { DefaultModelName };
+    std::string pendingModel; ///< Model that /model switches to once it has loaded.
+
+    CpuTopology cpus = detectCpuTopology();
+    std::optional<ThreadBudget> llmThreads; ///< What the active model was last given by rebalanceThreads().
     ChatSession session;
+    SessionStore sessionStore { std::filesystem::path(defaultDataDir()) / "sessions" };
+    std::string sessionId;     ///< Stored session the conversation is logged to; empty before the first turn.
+    size_t storedMessages = 0; ///< Messages in the session's log.
+    /// The session's messages, shrunk by evicting the oldest turns; they stay in the session's log.
+    MemoryAccount conversationMemory;
+    MemoryAccount scrollbackMemory = memoryRegistry().open("Chat scrollback", MemoryCategory::History);
+    bool memoryBudgetWarned = false; ///< Warned that the budget cannot be kept; warned only once.
     ServerManager servers;
     tui::Terminal terminal;
     tui::InputField inputField;
+    std::unique_ptr<MemoryIndex> memory; ///< Earlier sessions for the agent's turns; outlives agent.
+    std::filesystem::path memoryPath;
     std::unique_ptr<AgentLoop> agent;
+    std::unique_ptr<AgentWorker> agentWorker; ///< Runs agent turns off the UI thread.
+
+    // Prefill progress, published by the inference thread and rendered by the UI thread
+    std::atomic<int> prefillDecoded = 0;
+    std::atomic<int> prefillTotal = 0;
+    std::atomic<bool> prefillDirty = false;
+
+    /// When the input last changed, while it has not been prefilled since.
+    std::optional<std::chrono::steady_clock::time_point> draftChangedAt;
+
+    // Live decode throughput, published by the inference thread and rendered by the UI thread
+    std::atomic<double> decodeTokensPerSecond = 0.0;
+    std::atomic<bool> decodeDirty = false;
 
     // Audio pipeline
     std::unique_ptr<AudioPipeline> audioPipeline;
@@ -105,25 +178,50 @@ struct App::Impl
     bool recording = false;
     std::mutex transcriptionMutex;
     std::deque<std::string> transcriptionQueue;
+    std::string voicePartial; ///< The utterance transcribed so far, shown in the input box.
 
     // TTS
     std::unique_ptr<TtsSpeaker> ttsSpeaker;
     bool ttsEnabled = false;
-    std::string sentenceBuffer;
+    SpeechChunker ttsChunker;
     std::vector<std::string> ttsPendingSentences;
+    bool ttsMutedMicrophone = false; ///< Recording was paused for the reply being spoken.
+    std::atomic<TtsSpeaker*> speakingTts = nullptr; ///< Set while a reply is spoken, for barge-in.
+    std::atomic<bool> ttsInterrupted = false;       ///< The user talked over the reply being spoken.
     bool ttsInsideThink = false;
     std::string ttsTagBuffer;
 
+    // Startup: the components load concurrently, and messages sent meanwhile wait for the model
+    std::unique_ptr<AudioPipeline> startedAudioPipeline; ///< Initialized, not yet taken over by the UI.
+    std::unique_ptr<TtsSpeaker> startedTtsSpeaker;       ///< Initialized, not yet taken over by the UI.
+    std::deque<std::string> queuedMessages;               ///< Sent before the model was ready.
+    bool engineReady = false;                             ///< The UI thread has taken the agent over.
+    std::atomic<bool> startupDirty = false;               ///< A component changed its startup state.
+    StartupComponent llmStartup { "Model" };
+    StartupComponent mcpStartup { "Tools" };
+    StartupComponent audioStartup { "Voice input" };
+    StartupComponent ttsStartup { "Speech" };
+    ComponentStartup startup { [this] { notifyStartup(); } };
+
     // Layout state
     tui::LogPanel logPanel;
     tui::StatusBar statusBar;
     tui::Spinner spinner { tui::SpinnerType::Dots };
     bool conversationStarted = false;
-    bool tuiActive = false;
     bool isProcessing = false;
     std::atomic<bool> logPanelDirty = false;
     LayoutGeometry geo;
 
+    // What the input box shows of the widgets animating within it, so they repaint on their own
+    int spinnerRow = 0;              ///< Where the spinner was last drawn; 0 if it is not shown.
+    int spinnerCol = 0;
+    int meterBarsShown = -1;         ///< Active voice meter bars last drawn; -1 if not shown.
+    std::string voicePartialShown;   ///< The live transcription last drawn.
+
+    // Conversation output, kept to redraw the chat area when scrolled or resized
+    tui::Scrollback chatHistory;
+    tui::ScrollbackView chatView { chatHistory };
+
     // Input scroll state
     int inputScrollOffset = 0;  ///< First visible character position (grapheme index)
     int inputVerticalScrollOffset = 0;  ///< First visible line (for multiline scrolling)
@@ -136,21 +234,62 @@ struct App::Impl
         return std::max(InputBoxMinHeight, contentHeight + 2);  // +2 for top and bottom borders
     }
 
-    /// @brief Messages queued before TUI is active, replayed into the log panel on TUI start.
-    std::vector<tui::LogEntry> pendingLogs;
-
     explicit Impl(AppConfig cfg): config(std::move(cfg)), session(config.llm.systemPrompt)
     {
         inputField.setMultiline(true);
+        session.setOverflowPolicy(config.llm.contextOverflow);
         // No line limit - box grows to InputBoxMaxHeight then scrolls vertically
+
+        // Only shrunk by enforceMemoryBudget(), which runs on the UI thread between turns.
+        conversationMemory = memoryRegistry().open(
+            "Conversation", MemoryCategory::History, [this](size_t bytes) { return evictHistory(bytes); });
+        memoryRegistry().setBudget(static_cast<size_t>(std::max(0, config.memoryBudgetMb)) * 1'000'000);
     }
 
-    /// @brief Replays all pending log messages into the log panel. Called once after TUI init.
-    void replayPendingLogs()
+    /// @brief Evicts the oldest turns of the conversation until @p bytes were freed or one is left.
+    /// @return The bytes freed.
+    auto evictHistory(size_t bytes) -> size_t
     {
-        for (auto& entry: pendingLogs)
-            logPanel.addLog(entry.level, std::move(entry.message));
-        pendingLogs.clear();
+        auto const before = session.memoryBytes();
+        auto evicted = 0;
+        while (before - session.memoryBytes() < bytes && session.evictOldestTurn())
+            ++evicted;
+        auto const after = session.memoryBytes();
+        conversationMemory.set(after);
+        if (evicted > 0)
+            log::info("Memory budget: evicted the {} oldest turn(s) of the conversation", evicted);
+        return before - after;
+    }
+
+    /// @brief Reports the conversation and scrollback sizes and shrinks caches and history when over
+    /// the memory budget.
+    ///
+    /// Must not run while an agent turn uses the session.
+    void enforceMemoryBudget()
+    {
+        conversationMemory.set(session.memoryBytes());
+        scrollbackMemory.set(chatHistory.memoryBytes());
+
+        auto& registry = memoryRegistry();
+        if (registry.budget() == 0)
+            return;
+        if (auto const freed = registry.enforceBudget(); freed > 0)
+            log::info("Memory budget: freed {}", formatMemorySize(freed));
+        if (auto const total = registry.totalBytes(); total > registry.budget() && !memoryBudgetWarned)
+        {
+            memoryBudgetWarned = true;
+            logWarning(std::format("Memory use of {} exceeds the budget of {} (see /stats)",
+                                   formatMemorySize(total),
+                                   formatMemorySize(registry.budget())));
+        }
+    }
+
+    /// @brief Moves the messages logged on any thread into the log panel, noting any dropped.
+    void drainLogs()
+    {
+        log::drainQueue();
+        if (auto const dropped = log::takeDroppedCount(); dropped > 0)
+            logPanel.addLog(tui::LogLevel::Warning, std::format("{} log messages dropped", dropped));
     }
 
     // --- Layout computation ---
@@ -174,6 +313,7 @@ struct App::Impl
             geo.inputRow = geo.logStartRow - geo.inputHeight;
             geo.chatTop = 1;
             geo.chatBottom = geo.inputRow - 1;
+            chatView.setSize(cols, geo.chatBottom - geo.chatTop + 1);
         }
         else
         {
@@ -212,26 +352,93 @@ struct App::Impl
 
     /// @brief Writes output into the chat scroll region (for /help, /tools, etc. in conversation mode).
     /// @param text The text to write.
-    void writeToChatArea(std::string_view text)
+    /// @param style The style to write it in.
+    void writeToChatArea(std::string_view text, tui::Style const& style = {})
     {
         auto& out = terminal.output();
+        followChat();
+        // Text continues the last line written, which is on the bottom row.
+        auto const column = chatView.tailColumn();
+        chatHistory.append(text, style);
         if (conversationStarted)
         {
             out.saveCursor();
             out.setScrollRegion(geo.chatTop, geo.chatBottom);
-            out.moveTo(geo.chatBottom, 1);
-            out.writeRaw(text);
+            out.moveTo(geo.chatBottom, column);
+            out.write(text, style);
             out.resetScrollRegion();
             out.restoreCursor();
             out.flush();
         }
         else
         {
-            out.writeRaw(text);
+            out.write(text, style);
             out.flush();
         }
     }
 
+    /// @brief Redraws the chat area from the conversation history.
+    void renderChatArea()
+    {
+        auto const zone = trace::Zone("ui", "renderChatArea");
+        auto& out = terminal.output();
+        auto const frame = out.frame();
+        chatView.render(out, geo.chatTop);
+    }
+
+    /// @brief Scrolls the chat area back to the latest output, if it shows older output.
+    void followChat()
+    {
+        if (chatView.following())
+            return;
+        chatView.scrollToBottom();
+        renderChatArea();
+        resumeStreaming();
+    }
+
+    /// @brief Restores the streaming position after the chat area was redrawn during a turn.
+    ///
+    /// The reply continues after the last output; nothing is streamed while older output is shown.
+    void resumeStreaming()
+    {
+        if (!isProcessing || !chatView.following())
+            return;
+        auto& out = terminal.output();
+        out.setScrollRegion(geo.chatTop, geo.chatBottom);
+        out.moveTo(geo.chatBottom, chatView.tailColumn());
+        out.flush();
+    }
+
+    /// @brief Shows an image returned by a tool at the streaming position, if enabled.
+    /// @param toolName The tool that returned the image.
+    /// @param image The encoded image.
+    void showToolImage(std::string_view toolName, ToolContentBlob const& image)
+    {
+        if (!config.showToolImages || !image.data)
+            return;
+
+        auto decoded = tui::decodeImage(*image.data);
+        if (!decoded)
+        {
+            logWarning(std::format("Cannot show image from {}: {}", toolName, decoded.error().message));
+            return;
+        }
+        auto const fitted = tui::fitImage(decoded->view(), ToolImageMaxWidth, ToolImageMaxHeight);
+
+        // The history keeps a placeholder; redrawing the chat area does not bring images back.
+        chatHistory.append("\n");
+        chatHistory.append(std::format("[image from {}]", toolName), grayStyle());
+        chatHistory.append("\n");
+        if (!chatView.following())
+            return;
+
+        auto& out = terminal.output();
+        out.writeRaw("\n");
+        if (auto const written = out.writeImage(fitted.view()); !written)
+            logWarning(std::format("Cannot show image from {}: {}", toolName, written.error().message));
+        out.writeRaw("\n");
+    }
+
     /// @brief Prints the user's message label in the chat area.
     /// @param text The user's input text.
     void printUserMessage(std::string_view text)
@@ -239,6 +446,13 @@ struct App::Impl
         auto& out = terminal.output();
         if (conversationStarted)
         {
+            followChat();
+            chatHistory.beginMessage();
+            chatHistory.append("\n");
+            chatHistory.append("You: ", greenStyle());
+            chatHistory.append(text);
+            chatHistory.append("\n\n");
+
             out.setScrollRegion(geo.chatTop, geo.chatBottom);
             out.moveTo(geo.chatBottom, 1);
             out.writeRaw("\n");
@@ -253,16 +467,81 @@ struct App::Impl
     /// @brief Prints available commands to the chat area.
     void printHelp()
     {
+        auto headingStyle = tui::Style {};
+        headingStyle.bold = true;
+
         auto helpText = std::string {};
-        helpText += "\033[1mAvailable commands:\033[m\n";
         helpText += "  /quit   \u2014 Exit the application\n";
         helpText += "  /clear  \u2014 Clear conversation history\n";
+        helpText += "  /regenerate \u2014 Answer the last message again (Ctrl+R)\n";
+        helpText += "  /history \u2014 List stored conversations\n";
+        helpText += "  /resume <id> \u2014 Continue a stored conversation\n";
         helpText += "  /voice  \u2014 Toggle voice input (requires audio config)\n";
         helpText += "  /tts    \u2014 Toggle text-to-speech output (requires tts config)\n";
         helpText += "  /tools  \u2014 List available MCP tools\n";
+        helpText += "  /model [name] \u2014 List the models, or switch to one\n";
+        helpText += "  /stats  \u2014 Show memory use by model, cache and history\n";
         helpText += "  /help   \u2014 Show this help message\n";
         helpText += "\n";
-        writeToChatArea(helpText);
+        chatHistory.beginMessage();
+        writeToChatArea("Available commands:", headingStyle);
+        writeToChatArea("\n" + helpText);
+    }
+
+    /// @brief Prints what the models, buffers, caches and history hold in memory.
+    void printMemoryStats()
+    {
+        conversationMemory.set(session.memoryBytes());
+        scrollbackMemory.set(chatHistory.memoryBytes());
+
+        auto headingStyle = tui::Style {};
+        headingStyle.bold = true;
+        auto& registry = memoryRegistry();
+        auto text = std::string {};
+        for (auto const& usage: registry.usage())
+            text += std::format("  {:<24} {:<14} {:>9}{}\n",
+                                usage.name,
+                                memoryCategoryName(usage.category),
+                                formatMemorySize(usage.bytes),
+                                usage.reclaimable ? "  (reclaimable)" : "");
+        auto const budget = registry.budget();
+        text += std::format("  {:<39} {:>9}  of {}\n\n",
+                            "Total",
+                            formatMemorySize(registry.totalBytes()),
+                            budget > 0 ? formatMemorySize(budget) : "no budget (memoryBudgetMb)");
+        chatHistory.beginMessage();
+        writeToChatArea("Memory:", headingStyle);
+        writeToChatArea("\n" + text);
+    }
+
+    /// @brief Lists the stored sessions, most recent first, from the session index.
+    void printSessions()
+    {
+        auto const sessions = sessionStore.list();
+        if (!sessions)
+        {
+            logError(sessions.error().message);
+            return;
+        }
+        if (sessions->empty())
+        {
+            logInfo("No stored sessions");
+            return;
+        }
+
+        auto headingStyle = tui::Style {};
+        headingStyle.bold = true;
+        auto text = std::string {};
+        for (auto const& info: *sessions | std::views::take(SessionListLimit))
+            text += std::format("  {}  {:%Y-%m-%d %H:%M}  {:>4} messages  {}\n",
+                                info.id,
+                                std::chrono::floor<std::chrono::minutes>(info.updated),
+                                info.messageCount,
+                                info.title);
+        text += "\n";
+        chatHistory.beginMessage();
+        writeToChatArea("Sessions (/resume <id> to continue one):", headingStyle);
+        writeToChatArea("\n" + text);
     }
 
     /// @brief Prints a voice transcription label in the chat area.
@@ -272,6 +551,13 @@ struct App::Impl
         auto& out = terminal.output();
         if (conversationStarted)
         {
+            followChat();
+            chatHistory.beginMessage();
+            chatHistory.append("\n");
+            chatHistory.append("Voice> ", cyanStyle());
+            chatHistory.append(text);
+            chatHistory.append("\n\n");
+
             out.setScrollRegion(geo.chatTop, geo.chatBottom);
             out.moveTo(geo.chatBottom, 1);
             out.writeRaw("\n");
@@ -288,19 +574,25 @@ struct App::Impl
     /// @brief Renders the full screen layout based on the current mode.
     void renderFullScreen()
     {
+        auto const zone = trace::Zone("ui", "renderFullScreen");
         auto& out = terminal.output();
         auto sync = out.syncGuard();
         out.clearScreen();
         computeGeometry();
 
-        if (conversationStarted)
-            renderConversationMode();
-        else
-            renderInitialMode();
+        {
+            auto const frame = out.frame();
+            if (conversationStarted)
+                renderConversationMode();
+            else
+                renderInitialMode();
 
-        renderLogPanel();
-        renderInputBox();
-        renderStatusBar();
+            logPanel.invalidate();
+            statusBar.invalidate();
+            renderLogPanel();
+            renderInputBox();
+            renderStatusBar();
+        }
         positionCursorInInputBox();
         out.flush();
     }
@@ -309,6 +601,7 @@ struct App::Impl
     void renderInitialMode()
     {
         auto& out = terminal.output();
+        auto const frame = out.frame();
         auto const cols = out.columns();
 
         // Center a title above the input box
@@ -322,41 +615,12 @@ struct App::Impl
         }
     }
 
-    /// @brief Renders the conversation mode layout (just sets up the scroll region area).
+    /// @brief Renders the conversation mode layout: the chat area, drawn from the history.
     void renderConversationMode()
     {
-        // The chat area is the scroll region. Content is already scrolled into it
-        // by writeToChatArea / printUserMessage. Nothing to redraw here on initial render.
-    }
-
-    /// @brief Calculates grapheme positions from the input text.
-    /// Returns a vector of byte offsets for each grapheme cluster start.
-    auto calculateGraphemePositions(std::string_view text) const -> std::vector<std::size_t>
-    {
-        auto positions = std::vector<std::size_t> {};
-        positions.push_back(0);
-
-        for (auto i = std::size_t { 0 }; i < text.size();)
-        {
-            auto const ch = static_cast<unsigned char>(text[i]);
-            auto charLen = std::size_t { 1 };
-
-            // Determine UTF-8 character length
-            if ((ch & 0x80) == 0)
-                charLen = 1;
-            else if ((ch & 0xE0) == 0xC0)
-                charLen = 2;
-            else if ((ch & 0xF0) == 0xE0)
-                charLen = 3;
-            else if ((ch & 0xF8) == 0xF0)
-                charLen = 4;
-
-            i += charLen;
-            if (i <= text.size())
-                positions.push_back(i);
-        }
-
-        return positions;
+        // New output is scrolled into the chat area as it comes; this redraws it at the current
+        // size, or at the position it was scrolled back to.
+        chatView.render(terminal.output(), geo.chatTop);
     }
 
     /// @brief Updates the scroll offset to ensure the cursor is visible.
@@ -364,7 +628,7 @@ struct App::Impl
     {
         auto const& text = inputField.text();
         auto const cursorByte = inputField.cursor();
-        auto const graphemes = calculateGraphemePositions(text);
+        auto const graphemes = tui::graphemeBoundaries(text);
 
         // Find cursor grapheme index
         auto cursorGrapheme = 0;
@@ -411,7 +675,9 @@ struct App::Impl
     /// @brief Renders the bordered input box at the computed position.
     void renderInputBox()
     {
+        auto const zone = trace::Zone("ui", "renderInputBox");
         auto& out = terminal.output();
+        auto const frame = out.frame();
         auto const w = geo.inputWidth;
         auto const row = geo.inputRow;
         auto const col = geo.inputCol;
@@ -446,14 +712,16 @@ struct App::Impl
         auto const contentCol = box.contentStartCol();
 
         // Voice meter in top-right if active
+        meterBarsShown = -1;
         if (voiceEnabled && audioPipeline)
         {
-            out.moveTo(row, col + w - static_cast<int>(MeterBarCount) - 3);
-            renderVoiceMeter(audioPipeline->peakLevel());
+            renderVoiceMeter(meterBars(audioPipeline->peakLevel()));
+            out.writeRaw(" ");
         }
+        voicePartialShown = voiceEnabled ? currentVoicePartial() : std::string {};
+        spinnerRow = 0;
 
         // Calculate available width for text
-        auto const& text = inputField.text();
         auto const prefixWidth = isProcessing ? 2 : 0;
         auto availableWidth = innerWidth - prefixWidth;
 
@@ -482,6 +750,8 @@ struct App::Impl
             auto linePrefixWidth = 0;
             if (isProcessing && actualLine == cursorLine)
             {
+                spinnerRow = contentRow + lineIdx;
+                spinnerCol = contentCol;
                 spinner.render(out, theme.textAccent);
                 out.writeRaw(" ");
                 linePrefixWidth = prefixWidth;
@@ -503,10 +773,22 @@ struct App::Impl
 
             auto lineText = inputField.lineAt(actualLine);
 
-            if (lineText.empty() && text.empty() && actualLine == 0 && !isProcessing)
+            if (lineText.empty() && inputField.empty() && actualLine == 0 && !isProcessing)
             {
-                // Placeholder on first line when empty
                 inputScrollOffset = 0;
+
+                // While speaking, the words recognized so far take the placeholder's place
+                if (auto const& partial = voicePartialShown; !partial.empty())
+                {
+                    auto const lines = tui::wordWrap(partial, lineAvailableWidth);
+                    auto const shown = lines.empty() ? std::string {} : lines.back();
+                    out.write(shown, cyanStyle());
+                    auto const pad = std::max(0, lineAvailableWidth - tui::displayWidth(shown));
+                    out.writeRaw(std::string(static_cast<std::size_t>(pad), ' '));
+                    continue;
+                }
+
+                // Placeholder on first line when empty
                 auto placeholder = std::string_view { "Ask anything\u2026" };
                 out.write(placeholder, grayStyle());
                 auto const placeholderLen = 14;
@@ -522,7 +804,7 @@ struct App::Impl
             }
 
             // Calculate grapheme positions for this line
-            auto const graphemes = calculateGraphemePositions(lineText);
+            auto const graphemes = tui::graphemeBoundaries(lineText);
             auto const totalGraphemes = static_cast<int>(graphemes.size()) - 1;
 
             // For the cursor line, handle horizontal scrolling
@@ -542,9 +824,12 @@ struct App::Impl
             }
 
             // Determine overflow indicators
+            auto const startByte = (lineScrollOffset < static_cast<int>(graphemes.size()))
+                                       ? graphemes[static_cast<std::size_t>(lineScrollOffset)]
+                                       : lineText.size();
             auto const hasLeftOverflow = lineScrollOffset > 0;
-            auto const visibleEnd = lineScrollOffset + lineAvailableWidth;
-            auto const hasRightOverflow = visibleEnd < totalGraphemes;
+            auto const remainingWidth = tui::displayWidth(lineText.substr(startByte));
+            auto const hasRightOverflow = remainingWidth > lineAvailableWidth - (hasLeftOverflow ? 1 : 0);
 
             // Adjust available width for indicators
             auto textWidth = lineAvailableWidth;
@@ -563,31 +848,14 @@ struct App::Impl
                 out.write("\u25C0", indicatorStyle);  // ◀
             }
 
-            // Extract visible portion of line
-            auto const startByte = (lineScrollOffset < static_cast<int>(graphemes.size()))
-                                       ? graphemes[static_cast<std::size_t>(lineScrollOffset)]
-                                       : lineText.size();
-
-            auto visibleGraphemeEnd = std::min(lineScrollOffset + textWidth, totalGraphemes);
-            auto const endByte = (visibleGraphemeEnd < static_cast<int>(graphemes.size()))
-                                     ? graphemes[static_cast<std::size_t>(visibleGraphemeEnd)]
-                                     : lineText.size();
+            // Extract the visible portion of the line, in whole clusters that fit the columns
+            auto const endByte = startByte + tui::columnPrefixLength(lineText.substr(startByte), textWidth);
 
             auto visibleText = lineText.substr(startByte, endByte - startByte);
             out.writeRaw(visibleText);
 
-            // Calculate actual display width of visible text
-            auto displayedGraphemes = 0;
-            for (auto i = startByte; i < endByte;)
-            {
-                auto const ch = static_cast<unsigned char>(lineText[i]);
-                if ((ch & 0xC0) != 0x80)
-                    ++displayedGraphemes;
-                ++i;
-            }
-
             // Padding
-            auto const pad = std::max(0, textWidth - displayedGraphemes);
+            auto const pad = std::max(0, textWidth - tui::displayWidth(visibleText));
             out.writeRaw(std::string(static_cast<std::size_t>(pad), ' '));
 
             // Render right overflow indicator
@@ -645,10 +913,9 @@ struct App::Impl
             }
         }
         // Show character count in bottom border when text is non-trivial (single line)
-        else if (!text.empty() && text.size() > 20)
+        else if (auto const text = inputField.lineAt(0); text.size() > 20)
         {
-            auto const graphemes = calculateGraphemePositions(text);
-            auto const totalChars = static_cast<int>(graphemes.size()) - 1;
+            auto const totalChars = tui::graphemeCount(text);
 
             auto countStr = std::format(" {} ", totalChars);
             auto const countLen = static_cast<int>(countStr.size());
@@ -670,9 +937,8 @@ struct App::Impl
     {
         auto& out = terminal.output();
 
-        // Calculate cursor's line and column
+        // Calculate cursor's line
         auto const cursorLine = inputField.cursorLine();
-        auto const cursorColumn = inputField.cursorColumn();
 
         // Calculate which row in the box the cursor is on
         auto const visibleLine = cursorLine - inputVerticalScrollOffset;
@@ -689,51 +955,325 @@ struct App::Impl
         if (hasLeftOverflow)
             textCol += 1;
 
-        // Calculate cursor position relative to scroll offset
-        auto const cursorCol = cursorColumn - inputScrollOffset;
+        // The cursor's column is the width of the visible text before it.
+        auto const lineText = inputField.lineAt(cursorLine).substr(0, inputField.cursorLineOffset());
+        auto const graphemes = tui::graphemeBoundaries(lineText);
+        auto const scrolled = std::min(static_cast<std::size_t>(inputScrollOffset), graphemes.size() - 1);
+        auto const scrollByte = graphemes[scrolled];
+        auto const cursorCol = tui::displayWidth(lineText.substr(scrollByte));
 
         out.moveTo(row, textCol + cursorCol);
         out.showCursor();
     }
 
-    /// @brief Renders the log panel at its computed position.
+    /// @brief Repaints the spinner's cell in the input box if it advanced.
+    void renderSpinner()
+    {
+        if (spinnerRow == 0 || !spinner.damage().dirty())
+            return;
+        auto& out = terminal.output();
+        auto const frame = out.frame();
+        out.moveTo(spinnerRow, spinnerCol);
+        spinner.render(out, tui::currentTheme().textAccent);
+    }
+
+    /// @brief Redraws what changed of the log panel at its computed position.
     void renderLogPanel()
     {
+        auto const zone = trace::Zone("ui", "renderLogPanel");
         auto& out = terminal.output();
         computeGeometry(); // recompute in case log panel height changed
-        logPanel.render(out, geo.logStartRow, out.columns());
+        {
+            auto const frame = out.frame();
+            logPanel.renderDamage(out, geo.logStartRow, out.columns());
+        }
         out.flush();
     }
 
-    /// @brief Renders the status bar at the bottom of the screen.
+    /// @brief Appends the turn that just finished, from its user message on, to the session's log.
+    ///
+    /// The log is started with the conversation's first turn. Turns evicted from the context
+    /// window stay in the log, which records the whole conversation.
+    void persistTurn()
+    {
+        auto const& messages = session.messages();
+        auto const turn = std::ranges::find(messages | std::views::reverse, Role::User, &ChatMessage::role);
+        if (turn == messages.rend())
+            return;
+
+        if (sessionId.empty())
+        {
+            auto created = sessionStore.create();
+            if (!created)
+            {
+                log::warning("Conversation is not saved: {}", created.error().message);
+                return;
+            }
+            sessionId = std::move(*created);
+            storedMessages = 0;
+        }
+
+        auto const replies = std::span(std::prev(turn.base()), messages.end());
+        if (auto const appended = sessionStore.append(sessionId, replies); !appended)
+            log::warning("Conversation is not saved: {}", appended.error().message);
+        else
+            storedMessages += replies.size();
+    }
+
+    /// @brief Opens the memory index of @p embedder's model and gives it to the agent loop.
+    ///
+    /// Embeddings differ between models, so each model has an index of its own. Up to
+    /// @p backfillSessions of the most recent stored sessions that the index does not cover yet
+    /// are indexed first. Nothing happens unless AgentLoopConfig::memorySnippets is set.
+    void openMemory(LlmEngine& embedder, size_t backfillSessions)
+    {
+        if (config.agent.memorySnippets <= 0)
+            return;
+        agent->setMemory(nullptr);
+        memoryPath = memoryIndexPath(embedder.modelFingerprint());
+        memory = std::make_unique<MemoryIndex>(
+            [&embedder](std::string_view text) { return embedder.embed(text); });
+        if (std::filesystem::exists(memoryPath))
+        {
+            if (auto const opened = memory->open(memoryPath); !opened)
+                log::warning("Rebuilding the memory index: {}", opened.error().message);
+        }
+
+        auto sessions = sessionStore.list();
+        if (!sessions)
+        {
+            log::warning("{}", sessions.error().message);
+            sessions = std::vector<SessionInfo> {};
+        }
+        for (auto const& info: *sessions | std::views::take(backfillSessions))
+        {
+            if (info.id == sessionId || memory->contains(info.id))
+                continue;
+            auto messages = sessionStore.load(info.id);
+            if (!messages)
+                continue;
+            auto const added = memory->add(info.id, *messages);
+            if (!added)
+            {
+                log::warning("Memory index left incomplete: {}", added.error().message);
+                break;
+            }
+            log::debug("Indexed {} chunk(s) of session {}", *added, info.id);
+        }
+        saveMemory();
+        log::info("Memory index holds {} chunk(s) of earlier sessions", memory->size());
+        agent->setMemory(memory.get(), sessionId);
+    }
+
+    /// @brief Writes the memory index if chunks were added to it.
+    void saveMemory()
+    {
+        if (!memory || !memory->modified())
+            return;
+        if (auto const saved = memory->save(memoryPath); !saved)
+            log::warning("{}", saved.error().message);
+    }
+
+    /// @brief Drops the last @p count messages of the conversation from the session's log.
+    void unpersistMessages(size_t count)
+    {
+        if (sessionId.empty() || count == 0)
+            return;
+        storedMessages -= std::min(count, storedMessages);
+        if (auto const truncated = sessionStore.truncate(sessionId, storedMessages); !truncated)
+            log::warning("{}", truncated.error().message);
+    }
+
+    /// @brief Ends the stored session, saving the conversation's KV cache so resuming it skips the prefill.
+    void closeSession()
+    {
+        if (sessionId.empty())
+            return;
+        if (memory)
+        {
+            // Indexes the whole conversation, including the turns evicted from the context.
+            if (auto const messages = sessionStore.load(sessionId); !messages)
+                log::warning("{}", messages.error().message);
+            else if (auto const added = memory->add(sessionId, *messages); !added)
+                log::warning("Session not added to the memory index: {}", added.error().message);
+            saveMemory();
+            agent->setMemory(memory.get());
+        }
+        auto const path = std::filesystem::path(defaultDataDir()) / "kv-state"
+                          / std::format("{}-session-{}.state", engine->modelFingerprint(), sessionId);
+        if (auto const saved = engine->saveState(path); !saved)
+            log::warning("{}", saved.error().message);
+        else if (auto const paired = sessionStore.setStateSnapshot(sessionId, path); !paired)
+            log::warning("{}", paired.error().message);
+        sessionId.clear();
+        storedMessages = 0;
+    }
+
+    /// @brief Replaces the conversation with the stored session @p id and restores its KV cache.
+    auto resumeSession(std::string const& id) -> VoidResult
+    {
+        auto messages = sessionStore.load(id);
+        if (!messages)
+            return std::unexpected(messages.error());
+
+        closeSession();
+        session.clear();
+        for (auto& message: *messages)
+        {
+            switch (message.role)
+            {
+                case Role::User: session.addUserMessage(std::move(message.content)); break;
+                case Role::Assistant:
+                    session.addAssistantMessage(std::move(message.content), std::move(message.toolCalls));
+                    break;
+                case Role::Tool:
+                    session.addToolResult(std::move(message.toolCallId), std::move(message.content));
+                    break;
+                case Role::System: break;
+            }
+        }
+        sessionId = id;
+        storedMessages = messages->size();
+        if (memory)
+            agent->setMemory(memory.get(), sessionId);
+
+        // The snapshot is only usable with the model it was taken with; the prompt's prefix
+        // reuse picks up however much of it still matches the conversation.
+        auto const sessions = sessionStore.list();
+        if (!sessions)
+            return {};
+        auto const info = std::ranges::find(*sessions, id, &SessionInfo::id);
+        if (info == sessions->end() || info->stateSnapshot.empty()
+            || !info->stateSnapshot.filename().string().starts_with(engine->modelFingerprint())
+            || !std::filesystem::exists(info->stateSnapshot))
+            return {};
+        if (auto const loaded = engine->loadState(info->stateSnapshot); !loaded)
+            log::warning("Ignoring KV state snapshot: {}", loaded.error().message);
+        return {};
+    }
+
+    /// @brief Restores the system prompt's KV cache from its snapshot, or computes and saves it.
+    ///
+    /// Snapshots live in the data directory, keyed by model fingerprint and system prompt, so
+    /// a restart skips re-decoding a long shared system prompt.
+    void primeSystemPrompt()
+    {
+        // The tools are part of the system message, so they take part in the snapshot key.
+        auto const snapshot = servers.toolSnapshot();
+        auto const& tools = snapshot->tools;
+        auto promptKey = fnv1a64(session.systemPrompt());
+        for (auto const& tool: tools)
+            for (auto const& part: { tool.name, tool.description, tool.inputSchema.dump() })
+                promptKey = fnv1a64(part, promptKey);
+
+        auto const path = std::filesystem::path(defaultDataDir()) / "kv-state"
+                          / std::format("{}-{:016x}.state", engine->modelFingerprint(), promptKey);
+
+        auto restored = false;
+        if (std::filesystem::exists(path))
+        {
+            if (auto const loaded = engine->loadState(path); loaded)
+                restored = true;
+            else
+                log::warning("Ignoring KV state snapshot: {}", loaded.error().message);
+        }
+
+        // Decodes only what the snapshot does not cover, i.e. nothing if it was restored.
+        if (auto const prefilled = engine->prefill(session.messages(), tools); !prefilled)
+        {
+            log::warning("Failed to prefill system prompt: {}", prefilled.error().message);
+            return;
+        }
+
+        if (!restored)
+        {
+            if (auto const saved = engine->saveState(path); !saved)
+            {
+                log::warning("{}", saved.error().message);
+                return;
+            }
+        }
+        session.setStateSnapshot(path);
+    }
+
+    /// @brief Renders the status bar at the bottom of the screen, if it changed.
     void renderStatusBar()
     {
+        auto const zone = trace::Zone("ui", "renderStatusBar");
         auto& out = terminal.output();
-        auto const cols = out.columns();
-        auto const rows = out.rows();
+        auto const frame = out.frame();
 
-        statusBar.clearHints();
-        statusBar.addHint("Ctrl+C", "Quit");
-        statusBar.addHint("Shift+Enter", "Newline");
-        statusBar.addHint("Ctrl+L", "Logs");
+        auto hints = std::vector<tui::KeyHint> {
+            { .key = "Ctrl+C", .action = "Quit" },
+            { .key = "Shift+Enter", .action = "Newline" },
+            { .key = "Ctrl+L", .action = "Logs" },
+            { .key = "Ctrl+R", .action = "Regenerate" },
+        };
         if (audioInitialized)
-            statusBar.addHint("/voice", voiceEnabled ? "Voice On" : "Voice Off");
+            hints.push_back({ .key = "/voice", .action = voiceEnabled ? "Voice On" : "Voice Off" });
         if (ttsSpeaker)
-            statusBar.addHint("/tts", ttsEnabled ? "TTS On" : "TTS Off");
-        statusBar.addHint("/help", "Help");
-
+            hints.push_back({ .key = "/tts", .action = ttsEnabled ? "TTS On" : "TTS Off" });
+        hints.push_back({ .key = "/help", .action = "Help" });
+        statusBar.setHints(std::move(hints));
         statusBar.setStyle(tui::defaultStatusBarStyle());
-        statusBar.render(out, rows, cols);
+
+        if (statusBar.damage().dirty())
+            statusBar.render(out, out.rows(), out.columns());
     }
 
-    // --- Voice meter ---
+    /// @brief Shows prompt prefill progress in the status bar while a long prompt is decoded.
+    /// @param decoded Number of prompt tokens decoded so far.
+    /// @param total Total number of prompt tokens to decode.
+    void showPrefillProgress(int decoded, int total)
+    {
+        if (decoded >= total)
+            showStatusInfo({});
+        else
+            showStatusInfo(std::format("Prefill {}% ({}/{}) ", decoded * 100 / total, decoded, total));
+    }
 
-    /// @brief Renders the voice level meter using styled block characters.
-    /// @param level Peak audio level in [0.0, 1.0].
-    void renderVoiceMeter(float level)
+    /// @brief Shows the live decode throughput in the status bar.
+    void showDecodeThroughput(double tokensPerSecond)
     {
-        auto& output = terminal.output();
+        showStatusInfo(std::format("{:.1f} tok/s ", tokensPerSecond));
+    }
+
+    /// @brief Shows a summary of the finished turn's inference metrics in the status bar.
+    void showTurnMetrics(TurnMetrics const& metrics)
+    {
+        auto const& total = metrics.total;
+        if (total.generatedTokens == 0)
+        {
+            statusBar.setRightText({});
+            return;
+        }
+        auto text = std::format("{:.1f} tok/s | TTFT {:.0f} ms | {} tokens ",
+                                total.decodeTokensPerSecond(),
+                                total.timeToFirstTokenMs,
+                                total.totalTokens());
+        if (metrics.toolCacheHits > 0)
+            text += std::format("| {}/{} tools cached ", metrics.toolCacheHits, metrics.toolCalls);
+        statusBar.setRightText(std::move(text));
+    }
+
+    /// @brief Replaces the right-hand status bar text while streaming, keeping the cursor in place.
+    ///
+    /// The update goes out with the next streamed frame.
+    void showStatusInfo(std::string text)
+    {
+        auto& out = terminal.output();
+        statusBar.setRightText(std::move(text));
+
+        out.saveCursor();
+        renderStatusBar();
+        out.restoreCursor();
+    }
+
+    // --- Voice meter ---
 
+    /// @brief Returns how many voice meter bars light up for a peak level in [0.0, 1.0].
+    [[nodiscard]] static auto meterBars(float level) -> int
+    {
         // Convert linear amplitude to perceptual dB scale
         auto scaledLevel = 0.0f;
         if (level > 0.0f)
@@ -741,13 +1281,21 @@ struct App::Impl
             auto const db = 20.0f * std::log10(level);
             scaledLevel = std::clamp((db - FloorDb) / -FloorDb, 0.0f, 1.0f);
         }
+        return static_cast<int>(scaledLevel * static_cast<float>(MeterBarCount));
+    }
 
-        auto const activeBars = static_cast<std::size_t>(scaledLevel * static_cast<float>(MeterBarCount));
+    /// @brief Draws the voice level meter's bars in the input box's top border.
+    /// @param activeBars Number of bars lit up, see meterBars().
+    void renderVoiceMeter(int activeBars)
+    {
+        auto& output = terminal.output();
+        output.moveTo(geo.inputRow, geo.inputCol + geo.inputWidth - static_cast<int>(MeterBarCount) - 3);
+        meterBarsShown = activeBars;
 
         for (auto i = std::size_t { 0 }; i < MeterBarCount; ++i)
         {
             auto style = tui::Style {};
-            if (i < activeBars)
+            if (i < static_cast<std::size_t>(activeBars))
             {
                 if (i < 2)
                     style.fg = static_cast<std::uint8_t>(2); // Green
@@ -762,7 +1310,18 @@ struct App::Impl
             }
             output.write(MeterBars[i], style);
         }
-        output.writeRaw(" ");
+    }
+
+    /// @brief Repaints the voice meter's bars if the level moved them.
+    void updateVoiceMeter()
+    {
+        if (meterBarsShown < 0 || !audioPipeline)
+            return;
+        if (auto const bars = meterBars(audioPipeline->peakLevel()); bars != meterBarsShown)
+        {
+            auto const frame = terminal.output().frame();
+            renderVoiceMeter(bars);
+        }
     }
 
     /// @brief Transitions from initial mode to conversation mode.
@@ -791,12 +1350,34 @@ struct App::Impl
     /// @brief Thread-safe enqueue of a transcription result.
     /// @param text The transcribed text.
     void enqueueTranscription(std::string text)
+    {
+        {
+            auto lock = std::lock_guard(transcriptionMutex);
+            transcriptionQueue.push_back(std::move(text));
+            voicePartial.clear();
+        }
+        terminal.wake();
+    }
+
+    /// @brief Thread-safe update of the live transcription of an ongoing utterance.
+    /// @param text The utterance transcribed so far, or empty to hide it.
+    void setVoicePartial(std::string text)
+    {
+        {
+            auto lock = std::lock_guard(transcriptionMutex);
+            voicePartial = std::move(text);
+        }
+        terminal.wake();
+    }
+
+    /// @brief Returns the live transcription of an ongoing utterance, if any.
+    auto currentVoicePartial() -> std::string
     {
         auto lock = std::lock_guard(transcriptionMutex);
-        transcriptionQueue.push_back(std::move(text));
+        return voicePartial;
     }
 
-    /// @brief Appends a token to the sentence buffer and speaks complete sentences via TTS.
+    /// @brief Feeds a token to the TTS chunker and speaks completed chunks while the reply is generated.
     /// Filters out content inside <think>...</think> tags (used by reasoning models).
     /// @param token The token to append.
     void feedTtsToken(std::string_view token)
@@ -808,6 +1389,7 @@ struct App::Impl
 
         // Filter out <think>...</think> blocks character by character,
         // since tags may span token boundaries.
+        auto speakable = std::string {};
         for (auto const ch: token)
         {
             if (!ttsTagBuffer.empty())
@@ -831,9 +1413,9 @@ struct App::Impl
                 if ("<think>"sv.starts_with(ttsTagBuffer) || "</think>"sv.starts_with(ttsTagBuffer))
                     continue;
 
-                // Not a tag — flush buffered chars to sentence buffer (unless inside think)
+                // Not a tag — pass buffered chars on to the chunker (unless inside think)
                 if (!ttsInsideThink)
-                    sentenceBuffer.append(ttsTagBuffer);
+                    speakable.append(ttsTagBuffer);
                 ttsTagBuffer.clear();
                 continue;
             }
@@ -845,47 +1427,69 @@ struct App::Impl
             }
 
             if (!ttsInsideThink)
-                sentenceBuffer += ch;
+                speakable += ch;
         }
 
-        // Scan for sentence boundaries: ". ", "! ", "? ", or "\n"
-        while (true)
+        if (ttsChunker.feed(speakable, ttsPendingSentences) > 0)
+            speakPendingTts();
+    }
+
+    /// @brief Returns true if the user may interrupt spoken replies by talking.
+    [[nodiscard]] auto bargeInEnabled() const -> bool
+    {
+        return config.audio.bargeIn && config.audio.mode == VoiceMode::Vad;
+    }
+
+    /// @brief Hands the collected chunks to the TTS speaker.
+    ///        Pauses microphone recording for the reply if muteWhileSpeaking is enabled and
+    ///        barge-in is not.
+    void speakPendingTts()
+    {
+        if (ttsInterrupted.load())
+            ttsPendingSentences.clear(); // The rest of the reply is no longer wanted.
+        if (ttsPendingSentences.empty())
+            return;
+
+        // Pause microphone recording to avoid picking up TTS output
+        if (!ttsMutedMicrophone && voiceEnabled && audioPipeline && config.audio.muteWhileSpeaking
+            && !bargeInEnabled())
         {
-            auto pos = std::string::npos;
-            for (auto i = std::size_t { 0 }; i < sentenceBuffer.size(); ++i)
-            {
-                auto const ch = sentenceBuffer[i];
-                if (ch == '\n')
-                {
-                    pos = i;
-                    break;
-                }
-                if ((ch == '.' || ch == '!' || ch == '?') && i + 1 < sentenceBuffer.size()
-                    && sentenceBuffer[i + 1] == ' ')
-                {
-                    pos = i + 1; // include the trailing space
-                    break;
-                }
-            }
+            audioPipeline->pauseRecording();
+            setVoicePartial({});
+            ttsMutedMicrophone = true;
+        }
 
-            if (pos == std::string::npos)
-                break;
+        speakingTts.store(ttsSpeaker.get());
+        for (auto& sentence: ttsPendingSentences)
+            ttsSpeaker->speak(std::move(sentence));
+        ttsPendingSentences.clear();
+    }
 
-            auto sentence = sentenceBuffer.substr(0, pos + 1);
-            sentenceBuffer.erase(0, pos + 1);
+    /// @brief Stops the reply being spoken, and its generation, because the user started talking.
+    ///
+    /// Called on the audio pipeline's worker thread at the first frame of speech.
+    void interruptSpeech()
+    {
+        auto* const speaker = speakingTts.exchange(nullptr);
+        if (!speaker)
+            return;
 
-            // Trim whitespace from the sentence
-            while (!sentence.empty() && (sentence.back() == ' ' || sentence.back() == '\n'))
-                sentence.pop_back();
+        ttsInterrupted.store(true);
+        speaker->cancel();
+        agentWorker->cancel();
+        log::info("Speech detected, interrupting the spoken reply");
+    }
 
-            if (!sentence.empty())
-                ttsPendingSentences.push_back(std::move(sentence));
-        }
+    /// @brief Returns the level of the reply being spoken, so the pipeline can suppress its echo.
+    [[nodiscard]] auto speakingLevel() const -> float
+    {
+        auto const* const speaker = speakingTts.load();
+        return speaker ? speaker->playbackLevel() : 0.0f;
     }
 
-    /// @brief Flushes any remaining text in the sentence buffer to TTS, resets tag state,
+    /// @brief Speaks any remaining text of the reply, resets tag state,
     ///        and waits for playback to finish. Pressing ESC cancels remaining playback.
-    ///        Pauses microphone recording during playback if muteWhileSpeaking is enabled.
+    ///        Resumes microphone recording if it was paused for the reply.
     void flushTts()
     {
         if (!ttsSpeaker || !ttsEnabled)
@@ -895,34 +1499,15 @@ struct App::Impl
         ttsInsideThink = false;
         ttsTagBuffer.clear();
 
-        // Collect whatever remains in the sentence buffer as a final sentence
-        while (!sentenceBuffer.empty() && (sentenceBuffer.back() == ' ' || sentenceBuffer.back() == '\n'))
-            sentenceBuffer.pop_back();
+        ttsChunker.finish(ttsPendingSentences);
+        speakPendingTts();
 
-        if (!sentenceBuffer.empty())
+        // Wait for TTS to finish, using Terminal poll for ESC detection (already in raw mode).
+        // The speaker wakes the poll when it becomes idle.
+        auto cancelled = false;
+        while (!ttsSpeaker->idle() && !cancelled)
         {
-            ttsPendingSentences.push_back(std::move(sentenceBuffer));
-            sentenceBuffer.clear();
-        }
-
-        if (ttsPendingSentences.empty())
-            return;
-
-        // Pause microphone recording to avoid picking up TTS output
-        auto const shouldMute = voiceEnabled && audioPipeline && config.audio.muteWhileSpeaking;
-        if (shouldMute)
-            audioPipeline->pauseRecording();
-
-        // Enqueue all collected sentences for playback
-        for (auto& sentence: ttsPendingSentences)
-            ttsSpeaker->speak(std::move(sentence));
-        ttsPendingSentences.clear();
-
-        // Wait for TTS to finish, using Terminal poll for ESC detection (already in raw mode)
-        auto cancelled = false;
-        while (!ttsSpeaker->idle() && !cancelled)
-        {
-            auto events = terminal.poll(50);
+            auto events = terminal.poll();
             for (auto const& event: events)
             {
                 if (auto const* key = std::get_if<tui::KeyEvent>(&event))
@@ -937,14 +1522,22 @@ struct App::Impl
             }
         }
 
+        speakingTts.store(nullptr);
+        ttsInterrupted.store(false);
+
         // Resume microphone recording
-        if (shouldMute)
+        if (std::exchange(ttsMutedMicrophone, false))
             audioPipeline->resumeRecording();
     }
 
-    /// @brief Resolves the TTS model path, downloading the default if needed, and initializes the speaker.
-    /// @return Success or an error.
-    auto initializeTts() -> VoidResult
+    /// @brief Resolves the TTS model path, downloading the default if needed, and creates the speaker.
+    ///
+    /// Safe to call on a worker thread, as long as nothing else reads the TTS configuration.
+    /// @param onProgress Receives the progress of the download; a console progress line if empty.
+    /// @param stopToken Aborts the download.
+    /// @return The initialized speaker or an error.
+    auto createTtsSpeaker(DownloadProgressCallback onProgress, std::stop_token stopToken)
+        -> Result<std::unique_ptr<TtsSpeaker>>
     {
         // Auto-resolve model path if not specified
         if (config.tts.modelPath.empty())
@@ -953,36 +1546,44 @@ struct App::Impl
             if (!std::filesystem::exists(ttsModelPath))
             {
                 log::info("No TTS model specified. Downloading default ({})...", defaultTtsModelFilename());
-                auto downloadResult = downloadDefaultTtsModel();
+                auto downloadResult = downloadDefaultTtsModel(std::move(onProgress), std::move(stopToken));
                 if (!downloadResult)
                     return std::unexpected(downloadResult.error());
             }
             config.tts.modelPath = ttsModelPath;
         }
 
-        ttsSpeaker = std::make_unique<TtsSpeaker>();
+        auto phraseCacheDirectory = std::string {};
+        if (config.tts.diskPhraseCache)
+            phraseCacheDirectory = (std::filesystem::path(defaultDataDir()) / "tts-cache").string();
+
+        auto speaker = std::make_unique<TtsSpeaker>();
+        speaker->setIdleCallback([this] { terminal.wake(); });
         auto ttsConfig = TtsSpeakerConfig {
             .modelPath = config.tts.modelPath,
             .espeakDataPath = config.tts.espeakDataPath,
+            .phraseCacheBytes = static_cast<size_t>(std::max(0, config.tts.phraseCacheMb)) * 1024 * 1024,
+            .phraseCacheDirectory = std::move(phraseCacheDirectory),
         };
-        auto ttsResult = ttsSpeaker->initialize(ttsConfig);
+        auto ttsResult = speaker->initialize(ttsConfig);
         if (!ttsResult)
-        {
-            ttsSpeaker.reset();
             return std::unexpected(ttsResult.error());
-        }
 
-        ttsEnabled = true;
         log::info("TTS speaker initialized successfully");
-        return {};
+        return speaker;
     }
 
-    /// @brief Thread-safe check whether there are pending transcriptions.
-    /// @return True if at least one transcription is queued.
-    auto hasTranscriptions() -> bool
+    /// @brief Creates the TTS speaker on the UI thread and enables speech output.
+    /// @param onProgress Receives the progress of the download; a console progress line if empty.
+    /// @return Success or an error.
+    auto initializeTts(DownloadProgressCallback onProgress = {}) -> VoidResult
     {
-        auto lock = std::lock_guard(transcriptionMutex);
-        return !transcriptionQueue.empty();
+        auto speaker = createTtsSpeaker(std::move(onProgress), std::stop_token {});
+        if (!speaker)
+            return std::unexpected(speaker.error());
+        ttsSpeaker = std::move(*speaker);
+        ttsEnabled = true;
+        return {};
     }
 
     /// @brief Thread-safe drain of all pending transcriptions.
@@ -994,13 +1595,426 @@ struct App::Impl
         transcriptionQueue.clear();
         return result;
     }
+
+    // --- Startup ---
+
+    /// @brief Starts loading the model, connecting the MCP servers and initializing voice input and
+    ///        speech output, each on a worker thread of its own.
+    ///
+    /// Called once the TUI is up; adoptStartedComponents() takes each component over when it is ready.
+    void startComponents()
+    {
+        // Servers whose tools are known from an earlier run are only started when first used.
+        servers.setManifestDirectory(std::filesystem::path(defaultDataDir()) / "mcp-manifests");
+        if (config.useMcpDaemon)
+            servers.setDaemonSocket(config.mcpDaemonSocket.empty() ? defaultMcpDaemonSocketPath()
+                                                                   : config.mcpDaemonSocket);
+
+        if (!config.mcpServers.empty())
+            startup.add(mcpStartup, [this](std::stop_token token) { return connectServers(token); });
+        startup.add(llmStartup, [this](std::stop_token token) { return loadModel(token); });
+        if (config.audio.enabled)
+            startup.add(audioStartup, [this](std::stop_token token) { return startAudio(token); });
+        if (config.tts.enabled)
+            startup.add(ttsStartup, [this](std::stop_token token) { return startTts(token); });
+        statusBar.setCenterText(startup.text());
+        startup.start();
+    }
+
+    /// @brief Stops the components that are still starting up and waits for their workers.
+    ///
+    /// Loading the model cannot be interrupted, so that is waited for.
+    void stopComponents() { startup.stop(); }
+
+    void notifyStartup()
+    {
+        startupDirty.store(true, std::memory_order_release);
+        terminal.wake();
+    }
+
+    /// @brief Connects the configured MCP servers; each server's tools become available once it is ready.
+    /// @return Whether any server connected.
+    auto connectServers(std::stop_token stopToken) -> bool
+    {
+        auto serverConfigs = std::vector<McpServerConfig> {};
+        for (const auto& [name, serverConfig]: config.mcpServers)
+            serverConfigs.push_back(serverConfig);
+        auto const results = servers.addServers(serverConfigs, std::move(stopToken));
+        for (auto i = size_t { 0 }; i < results.size(); ++i)
+            if (!results[i])
+                log::warning("Failed to connect MCP server '{}': {}",
+                             serverConfigs[i].name,
+                             results[i].error().message);
+
+        return std::ranges::any_of(results, [](VoidResult const& result) { return result.has_value(); });
+    }
+
+    /// @brief Loads the model and creates the agent that answers the user's messages.
+    /// @return Whether the agent was created.
+    auto loadModel(std::stop_token stopToken) -> bool
+    {
+        models.add(std::string(DefaultModelName), withPlannedThreads(llmEngineConfig(config.llm)));
+        for (auto const& [name, modelPath]: config.llm.models)
+            models.add(name, withPlannedThreads(llmEngineConfig(config.llm, modelPath)));
+        models.setLoadedCallback([this](std::string_view, VoidResult const&) { notifyStartup(); });
+
+        auto loaded = models.acquire(DefaultModelName);
+        if (!loaded)
+        {
+            log::error("Failed to load the model: {}", loaded.error().message);
+            return false;
+        }
+        engine = *loaded;
+        attachEngine(*engine);
+
+        agent = std::make_unique<AgentLoop>(
+            *engine, session, servers, agentLoopConfig(config, engine->modelFingerprint()));
+        agentWorker = std::make_unique<AgentWorker>(*agent);
+        agentWorker->setWakeup([this] { terminal.wake(); });
+
+        // Stays loaded while the answering model is switched, and with it the tool index.
+        auto* embedder = engine;
+        if (auto const& name = config.llm.toolSelectionModel; !name.empty())
+        {
+            if (auto selector = models.acquire(name))
+            {
+                agent->setToolSelectionEngine(**selector, toolIndexPath((*selector)->modelFingerprint()));
+                embedder = *selector;
+            }
+            else
+                log::warning("Tool selection uses the active model: {}", selector.error().message);
+        }
+        if (!stopToken.stop_requested())
+            openMemory(*embedder, MemoryBackfillSessions);
+
+        // The system prompt snapshot is keyed by the tools, so priming it has to wait for all servers.
+        if (config.llm.persistKvState && !stopToken.stop_requested())
+        {
+            mcpStartup.waitWhileLoading();
+            primeSystemPrompt();
+        }
+
+        return true;
+    }
+
+    /// @brief Gives a model loading with automatic threads the ones planned for the LLM on its own.
+    [[nodiscard]] auto withPlannedThreads(LlmEngineConfig engineConfig) const -> LlmEngineConfig
+    {
+        if (engineConfig.threads > 0)
+            return engineConfig;
+        auto const budget = planThreads(cpus, CpuWorkloads {});
+        engineConfig.threads = budget.decodeThreads;
+        engineConfig.batchThreads = budget.batchThreads;
+        return engineConfig;
+    }
+
+    /// @brief Plans the threads for what runs next to the LLM now.
+    [[nodiscard]] auto threadBudget() const -> ThreadBudget
+    {
+        return planThreads(cpus,
+                           CpuWorkloads {
+                               .transcription = voiceEnabled && audioPipeline,
+                               .speech = ttsEnabled && ttsSpeaker,
+                           });
+    }
+
+    /// @brief Moves the active model's threads out of the way of voice input and speech output, or
+    ///        back once they stop, unless the threads are configured.
+    ///
+    /// Waits for the running turn to end; finishAgentTurn() calls it again.
+    void rebalanceThreads()
+    {
+        if (config.llm.threads > 0 || isProcessing || !engineReady)
+            return;
+        auto const budget = threadBudget();
+        if (budget == llmThreads)
+            return;
+        stopDraftPrefill();
+        engine->setThreads(budget.decodeThreads, budget.batchThreads);
+        llmThreads = budget;
+        log::debug("LLM threads: {} for decoding, {} for prefill", budget.decodeThreads, budget.batchThreads);
+    }
+
+    /// @brief Publishes the prefill progress and metrics of @p model to the UI thread.
+    void attachEngine(LlmEngine& model)
+    {
+        // Prefill runs on the inference thread; only publish the progress here.
+        model.setPrefillProgressCallback([this](int decoded, int total) {
+            prefillDecoded.store(decoded, std::memory_order_relaxed);
+            prefillTotal.store(total, std::memory_order_relaxed);
+            prefillDirty.store(true, std::memory_order_release);
+        });
+        model.setMetricsCallback([this](GenerateMetrics const& metrics) {
+            decodeTokensPerSecond.store(metrics.decodeTokensPerSecond(), std::memory_order_relaxed);
+            decodeDirty.store(true, std::memory_order_release);
+        });
+    }
+
+    /// @brief Lists the models of /model and how far each is loaded.
+    void printModels()
+    {
+        auto text = std::string {};
+        for (auto const& name: models.names())
+            text += std::format("  {} {} \u2014 {}\n",
+                                name == activeModel ? '*' : ' ',
+                                name,
+                                modelStateName(models.state(name)));
+        chatHistory.beginMessage();
+        writeToChatArea("\n" + text);
+    }
+
+    /// @brief Answers the following turns with the model @p name, loading it in the background
+    ///        first if need be. Runs on the UI thread.
+    void selectModel(std::string const& name)
+    {
+        if (!models.contains(name))
+        {
+            logError(std::format("Unknown model '{}'; see /model", name));
+            return;
+        }
+        pendingModel = name;
+        if (models.state(name) == ModelState::Resident)
+        {
+            switchToPendingModel();
+            return;
+        }
+        if (auto const loading = models.load(name); !loading)
+        {
+            logError(loading.error().message);
+            pendingModel.clear();
+            return;
+        }
+        logInfo(std::format("Loading model '{}'; it answers once it is loaded", name));
+    }
+
+    /// @brief Switches to the model /model asked for if it has loaded and no turn is running.
+    void switchToPendingModel()
+    {
+        if (pendingModel.empty() || isProcessing || !engineReady)
+            return;
+        auto const state = models.state(pendingModel);
+        if (state == ModelState::Loading)
+            return;
+
+        auto const name = std::exchange(pendingModel, {});
+        if (name == activeModel)
+            return;
+        if (state != ModelState::Resident)
+        {
+            logError(std::format("Model '{}' failed to load", name));
+            return;
+        }
+
+        auto acquired = models.acquire(name);
+        if (!acquired)
+        {
+            logError(acquired.error().message);
+            return;
+        }
+        stopDraftPrefill();
+        attachEngine(**acquired);
+        agent->setEngine(**acquired, toolIndexPath((*acquired)->modelFingerprint()));
+        // Indexing the stored sessions would hold up the switch; they are added as they are closed.
+        if (config.llm.toolSelectionModel.empty())
+            openMemory(**acquired, 0);
+        models.release(activeModel);
+        engine = *acquired;
+        activeModel = name;
+        logInfo(std::format("Switched to model '{}'", name));
+        llmThreads.reset();
+        rebalanceThreads();
+    }
+
+    /// @brief Stops prefilling the message being typed (see AgentWorker::prefill()).
+    ///
+    /// Between turns the inference thread prefills the message being typed; it is stopped before
+    /// the session or the engine is touched on the UI thread.
+    void stopDraftPrefill()
+    {
+        draftChangedAt.reset();
+        if (engineReady)
+            agentWorker->cancelPrefill();
+    }
+
+    /// @brief Resolves the whisper model, downloading the default if needed, and creates the audio pipeline.
+    /// @param stopToken Aborts the download.
+    /// @return The initialized pipeline or an error.
+    auto createAudioPipeline(std::stop_token stopToken) -> Result<std::unique_ptr<AudioPipeline>>
+    {
+        // Auto-resolve whisper model path if not specified
+        if (config.audio.whisperModelPath.empty())
+        {
+            auto const whisperPath = defaultWhisperModelPath();
+            if (!std::filesystem::exists(whisperPath))
+            {
+                log::info("No whisper model specified. Downloading default ({})...",
+                          defaultWhisperModelFilename());
+                auto downloadResult =
+                    downloadDefaultWhisperModel(startup.downloadProgress(audioStartup), std::move(stopToken));
+                if (!downloadResult)
+                    return std::unexpected(downloadResult.error());
+            }
+            config.audio.whisperModelPath = whisperPath;
+        }
+
+        if (!std::filesystem::exists(config.audio.whisperModelPath))
+            return makeError(ErrorCode::AudioError,
+                             std::format("Whisper model not found: {}", config.audio.whisperModelPath));
+
+        auto pipeline = std::make_unique<AudioPipeline>();
+        auto pipelineConfig = AudioPipelineConfig {
+            .whisperModelPath = config.audio.whisperModelPath,
+            .vadModelPath = config.audio.vadModelPath,
+            .language = config.audio.language,
+            .deviceName = config.audio.deviceName,
+            .mode = toAudioMode(config.audio.mode),
+            .silenceDurationMs = static_cast<float>(config.audio.silenceDurationMs),
+            .transcriptionThreads =
+                config.audio.threads > 0
+                    ? config.audio.threads
+                    : planThreads(cpus, CpuWorkloads { .transcription = true, .speech = config.tts.enabled })
+                          .transcriptionThreads,
+            .partialIntervalMs = static_cast<float>(config.audio.partialIntervalMs),
+            .maxUtteranceMs = static_cast<float>(config.audio.maxUtteranceMs),
+            .useGpu = config.audio.useGpu,
+            .flashAttention = config.audio.flashAttention,
+            .beamSize = config.audio.beamSize,
+            .reduceAudioContext = config.audio.reduceAudioContext,
+            .warmUp = config.audio.warmUp,
+        };
+
+        auto initResult = pipeline->initialize(
+            pipelineConfig,
+            [this](std::string text) { enqueueTranscription(std::move(text)); },
+            [this](std::string text) { setVoicePartial(std::move(text)); });
+        if (!initResult)
+            return std::unexpected(initResult.error());
+
+        if (bargeInEnabled())
+        {
+            pipeline->setSpeechStartCallback([this] { interruptSpeech(); });
+            pipeline->setEchoReference([this] { return speakingLevel(); });
+        }
+        return pipeline;
+    }
+
+    auto startAudio(std::stop_token stopToken) -> bool
+    {
+        auto pipeline = createAudioPipeline(std::move(stopToken));
+        if (!pipeline)
+        {
+            log::error("Voice input unavailable, audio initialization failed: {}", pipeline.error().message);
+            return false;
+        }
+        startedAudioPipeline = std::move(*pipeline);
+        log::info("Audio pipeline initialized successfully");
+        return true;
+    }
+
+    auto startTts(std::stop_token stopToken) -> bool
+    {
+        auto speaker = createTtsSpeaker(startup.downloadProgress(ttsStartup), std::move(stopToken));
+        if (!speaker)
+        {
+            log::error("TTS initialization failed: {}", speaker.error().message);
+            return false;
+        }
+        startedTtsSpeaker = std::move(*speaker);
+        return true;
+    }
+
+    /// @brief Takes over the components that became ready since the last call and shows the
+    ///        startup progress in the status bar. Runs on the UI thread.
+    void adoptStartedComponents()
+    {
+        if (!engineReady)
+        {
+            if (llmStartup.adopt())
+            {
+                engineReady = true;
+                logInfo("Model ready");
+            }
+            else if (llmStartup.state() == ComponentState::Failed && !queuedMessages.empty())
+            {
+                logError(
+                    std::format("No model is loaded; {} queued message(s) dropped", queuedMessages.size()));
+                queuedMessages.clear();
+            }
+        }
+
+        if (audioStartup.adopt())
+        {
+            audioPipeline = std::move(startedAudioPipeline);
+            audioInitialized = true;
+            logInfo("Audio pipeline ready \u2014 use /voice to enable voice input");
+        }
+
+        if (ttsStartup.adopt())
+        {
+            ttsSpeaker = std::move(startedTtsSpeaker);
+            ttsEnabled = true;
+            logInfo("TTS ready \u2014 use /tts to toggle speech output");
+        }
+
+        switchToPendingModel();
+        rebalanceThreads();
+
+        statusBar.setCenterText(startup.text());
+        if (statusBar.damage().dirty())
+        {
+            auto& out = terminal.output();
+            out.saveCursor();
+            renderStatusBar();
+            out.restoreCursor();
+            out.flush();
+        }
+    }
+
+    /// @brief Holds a message sent before the model is ready; it is sent once the model is.
+    void queueMessage(std::string message)
+    {
+        if (llmStartup.state() == ComponentState::Failed)
+        {
+            logError("No model is loaded \u2014 the log tells why loading it failed");
+            return;
+        }
+        queuedMessages.push_back(std::move(message));
+        logInfo("The model is still loading \u2014 the message is sent once it is ready");
+    }
+
+    /// @brief Returns the queued messages as one, in the order they were sent.
+    auto takeQueuedMessages() -> std::string
+    {
+        auto message = std::string {};
+        for (auto const& queued: queuedMessages)
+        {
+            if (!message.empty())
+                message += "\n\n";
+            message += queued;
+        }
+        queuedMessages.clear();
+        return message;
+    }
+
+    /// @brief Tells the user to wait if the model is not ready, for commands that change the conversation.
+    /// @return Whether the model is ready.
+    auto ensureModelReady() -> bool
+    {
+        if (engineReady)
+            return true;
+        if (llmStartup.state() == ComponentState::Failed)
+            logError("No model is loaded");
+        else
+            logInfo("The model is still loading");
+        return false;
+    }
 };
 
 App::App(AppConfig config): _impl(std::make_unique<Impl>(std::move(config)))
 {
-    // Install log callback immediately so all messages (including model loading)
-    // are captured. Before TUI is active, messages are queued; after, they go
-    // directly to the LogPanel.
+    // Queue log messages from now on so all of them (including model loading) are captured,
+    // without the threads logging them ever waiting on the UI. The UI thread drains the queue
+    // into the LogPanel, which is where the callback runs.
     log::setCallback([this](log::Level level, std::string_view message) {
         auto tuiLevel = tui::LogLevel::Info;
         switch (level)
@@ -1009,20 +2023,21 @@ App::App(AppConfig config): _impl(std::make_unique<Impl>(std::move(config)))
             case log::Level::Warning: tuiLevel = tui::LogLevel::Warning; break;
             default: tuiLevel = tui::LogLevel::Info; break;
         }
-        if (_impl->tuiActive)
-        {
-            _impl->logPanel.addLog(tuiLevel, std::string(message));
-            _impl->logPanelDirty.store(true, std::memory_order_relaxed);
-        }
-        else
-        {
-            _impl->pendingLogs.push_back(
-                tui::LogEntry { .level = tuiLevel, .message = std::string(message) });
-        }
+        _impl->logPanel.addLog(tuiLevel, std::string(message));
+    });
+    log::enableQueue(LogQueueCapacity, [this] {
+        // One wake per drain is enough.
+        if (!_impl->logPanelDirty.exchange(true, std::memory_order_acq_rel))
+            _impl->terminal.wake();
     });
 }
 
-App::~App() = default;
+App::~App()
+{
+    // Whatever is still logged goes to stderr, never to this App.
+    log::setCallback(nullptr);
+    log::disableQueue();
+}
 
 auto App::initialize() -> VoidResult
 {
@@ -1032,20 +2047,13 @@ auto App::initialize() -> VoidResult
         auto const models = availableModels();
 
         // Check if any known model already exists locally
-        auto found = false;
-        for (const auto& model: models)
+        auto const existing = downloadedModelPath();
+        if (existing)
         {
-            auto const path = modelFilePath(model);
-            if (std::filesystem::exists(path))
-            {
-                _impl->config.llm.modelPath = path;
-                log::info("Using existing model: {}", path);
-                found = true;
-                break;
-            }
+            _impl->config.llm.modelPath = *existing;
+            log::info("Using existing model: {}", *existing);
         }
-
-        if (!found)
+        else
         {
             // Present model selection to the user (cooked mode, before terminal init)
             std::println("");
@@ -1088,94 +2096,11 @@ auto App::initialize() -> VoidResult
         }
     }
 
-    auto engineConfig = LlmEngineConfig {
-        .modelPath = _impl->config.llm.modelPath,
-        .contextSize = _impl->config.llm.contextSize,
-        .gpuLayers = _impl->config.llm.gpuLayers,
-    };
-
-    auto loadResult = _impl->engine.load(engineConfig);
-    if (!loadResult)
-        return loadResult;
-
-    // Connect MCP servers
-    for (const auto& [name, serverConfig]: _impl->config.mcpServers)
-    {
-        auto addResult = _impl->servers.addServer(serverConfig);
-        if (!addResult)
-            log::warning("Failed to connect MCP server '{}': {}", name, addResult.error().message);
-    }
-
-    // Create agent loop
-    auto agentConfig = AgentConfig {
-        .maxToolSteps = _impl->config.agent.maxToolSteps,
-        .maxRetries = _impl->config.agent.maxRetries,
-        .sampler = SamplerConfig { .temperature = _impl->config.llm.temperature },
-    };
-
-    _impl->agent = std::make_unique<AgentLoop>(_impl->engine, _impl->session, _impl->servers, agentConfig);
-
-    // Initialize audio pipeline if configured
-    if (_impl->config.audio.enabled)
-    {
-        // Auto-resolve whisper model path if not specified
-        if (_impl->config.audio.whisperModelPath.empty())
-        {
-            auto const whisperPath = defaultWhisperModelPath();
-            if (!std::filesystem::exists(whisperPath))
-            {
-                log::info("No whisper model specified. Downloading default ({})...",
-                          defaultWhisperModelFilename());
-                auto downloadResult = downloadDefaultWhisperModel();
-                if (!downloadResult)
-                {
-                    log::error("Whisper model download failed: {}", downloadResult.error().message);
-                }
-            }
-            if (std::filesystem::exists(whisperPath))
-                _impl->config.audio.whisperModelPath = whisperPath;
-        }
-
-        if (_impl->config.audio.whisperModelPath.empty()
-            || !std::filesystem::exists(_impl->config.audio.whisperModelPath))
-        {
-            log::warning("Audio configured but whisper model not found \u2014 voice input unavailable");
-        }
-        else
-        {
-            _impl->audioPipeline = std::make_unique<AudioPipeline>();
-
-            auto pipelineConfig = AudioPipelineConfig {
-                .whisperModelPath = _impl->config.audio.whisperModelPath,
-                .vadModelPath = _impl->config.audio.vadModelPath,
-                .language = _impl->config.audio.language,
-                .deviceName = _impl->config.audio.deviceName,
-                .mode = Impl::toAudioMode(_impl->config.audio.mode),
-            };
-
-            auto initResult = _impl->audioPipeline->initialize(
-                pipelineConfig, [this](std::string text) { _impl->enqueueTranscription(std::move(text)); });
-
-            if (initResult)
-            {
-                _impl->audioInitialized = true;
-                log::info("Audio pipeline initialized successfully");
-            }
-            else
-            {
-                log::error("Audio initialization failed: {}", initResult.error().message);
-                _impl->audioPipeline.reset();
-            }
-        }
-    }
-
-    // Initialize TTS speaker if configured
-    if (_impl->config.tts.enabled)
-    {
-        auto ttsResult = _impl->initializeTts();
-        if (!ttsResult)
-            log::error("TTS initialization failed: {}", ttsResult.error().message);
-    }
+    // Loading the model is left to run(), which shows the TUI meanwhile; a missing file is
+    // reported right away though.
+    if (!std::filesystem::exists(_impl->config.llm.modelPath))
+        return makeError(ErrorCode::ModelLoadError,
+                         std::format("Model file not found: {}", _impl->config.llm.modelPath));
 
     // Auto-create config file with resolved settings if none exists
     auto const configPath = defaultConfigPath();
@@ -1212,102 +2137,273 @@ auto App::run() -> int
     output.hideCursor();
     output.flush();
 
-    // Mark TUI as active and replay any messages queued during initialize()
-    _impl->tuiActive = true;
-    _impl->replayPendingLogs();
+    // Show the messages queued during initialize()
+    _impl->drainLogs();
+
+    // The components load in the background; their progress shows in the status bar.
+    _impl->startComponents();
 
     // Expand the log panel on startup if requested via --log CLI flag
     if (_impl->config.logPanelExpanded)
         _impl->logPanel.toggle();
 
-    // Log initial status messages
-    if (_impl->audioInitialized)
-        _impl->logInfo("Audio pipeline ready \u2014 use /voice to enable voice input");
-
-    if (_impl->ttsSpeaker)
-        _impl->logInfo("TTS ready \u2014 use /tts to toggle speech output");
-
     _impl->logInfo("Type /help for commands, /quit to exit");
 
     auto mdRenderer = tui::MarkdownRenderer(output);
+    mdRenderer.recordTo(&_impl->chatHistory);
+
+    // Streamed tokens, the spinner and the voice meter go out together, a frame at a time.
+    auto frames = tui::FrameScheduler(output);
 
     // Render initial layout
     _impl->renderFullScreen();
 
-    auto const processTranscription = [&](std::string_view text) {
-        if (!_impl->conversationStarted)
-            _impl->transitionToConversation();
+    // Hands the message being typed to the inference thread once typing paused. Commands are not
+    // sent to the model, and an empty draft leaves the KV cache as the last turn left it.
+    auto const prefillDraft = [&] {
+        _impl->draftChangedAt.reset();
+        auto const draft = _impl->inputField.text();
+        if (!draft.empty() && !draft.starts_with('/'))
+            _impl->agentWorker->prefill(std::string(draft));
+    };
+
+    // Starts an agent turn on the inference thread; its output is streamed by pumpAgentEvents().
+    // Messages sent while the model still loads wait for it.
+    auto const startAgentTurn = [&](std::string message) {
+        if (!_impl->engineReady)
+        {
+            _impl->queueMessage(std::move(message));
+            return;
+        }
 
-        _impl->printVoiceTranscription(text);
+        _impl->isProcessing = true;
+        _impl->draftChangedAt.reset();
+        _impl->prefillDirty.store(false, std::memory_order_relaxed); // Left over by a draft prefill.
 
-        // Set scroll region for streaming
+        // Set scroll region for streaming output
+        _impl->followChat();
         output.setScrollRegion(_impl->geo.chatTop, _impl->geo.chatBottom);
         output.moveTo(_impl->geo.chatBottom, 1);
+        output.flush();
 
+        _impl->chatHistory.beginMessage();
         mdRenderer.beginStream();
-        auto streamCb = [&](std::string_view token) {
-            mdRenderer.feedToken(token);
-            output.flush();
-            _impl->feedTtsToken(token);
-        };
-
-        auto result = _impl->agent->processMessage(text, streamCb);
-        if (!result)
-            _impl->logError(std::format("{}", result.error()));
+        if (!_impl->agentWorker->submit(std::move(message)))
+            _impl->logError("Agent is still busy");
+    };
 
+    auto const finishAgentTurn = [&](AgentEvent const& finished) {
+        _impl->isProcessing = false;
+        _impl->decodeDirty = false;
+        // The worker has finished the turn before publishing its final event.
+        _impl->showTurnMetrics(_impl->agent->lastTurnMetrics());
+        _impl->persistTurn();
+        _impl->enforceMemoryBudget();
+        _impl->switchToPendingModel();
+        _impl->rebalanceThreads();
+        // What was typed during the turn is prefilled as if typing paused now.
+        if (_impl->config.llm.speculativePrefill && !_impl->inputField.empty())
+            _impl->draftChangedAt = std::chrono::steady_clock::now();
+
+        if (finished.error)
+            _impl->logError(std::format("{}", *finished.error));
+        else if (finished.cancelled)
+            _impl->logInfo("Generation cancelled");
+
+        mdRenderer.setSuspended(!_impl->chatView.following());
         mdRenderer.endStream();
         output.resetScrollRegion();
         output.writeRaw("\n");
         output.flush();
 
         _impl->flushTts();
+
+        auto sync = output.syncGuard();
+        output.hideCursor();
         _impl->renderInputBox();
+        _impl->renderLogPanel();
+        _impl->renderStatusBar();
         _impl->positionCursorInInputBox();
         output.flush();
     };
 
+    // Drains streamed tokens from the inference thread and keeps the spinner animated.
+    auto const pumpAgentEvents = [&] {
+        auto const zone = trace::Zone("ui", "pumpAgentEvents");
+        auto finished = std::optional<AgentEvent> {};
+        _impl->agentWorker->poll([&](AgentEvent& event) {
+            if (event.kind == AgentEvent::Kind::Token)
+            {
+                mdRenderer.setSuspended(!_impl->chatView.following());
+                mdRenderer.feedToken(event.text);
+                _impl->feedTtsToken(event.text);
+            }
+            else if (event.kind == AgentEvent::Kind::Image)
+                _impl->showToolImage(event.text, event.image);
+            else
+                finished = std::move(event);
+        });
+
+        if (_impl->prefillDirty.exchange(false, std::memory_order_acquire))
+            _impl->showPrefillProgress(_impl->prefillDecoded.load(std::memory_order_relaxed),
+                                       _impl->prefillTotal.load(std::memory_order_relaxed));
+        if (_impl->decodeDirty.exchange(false, std::memory_order_acquire) && _impl->isProcessing)
+            _impl->showDecodeThroughput(_impl->decodeTokensPerSecond.load(std::memory_order_relaxed));
+
+        if (frames.due())
+        {
+            // The spinner and voice meter animate along with the frame, each repainting its own cells.
+            auto const spinnerAdvanced = _impl->spinner.tick();
+            if (spinnerAdvanced || (_impl->voiceEnabled && _impl->audioPipeline))
+            {
+                output.saveCursor();
+                _impl->renderSpinner();
+                _impl->updateVoiceMeter();
+                output.restoreCursor();
+            }
+            frames.flush();
+        }
+
+        if (finished)
+            finishAgentTurn(*finished);
+    };
+
+    // Scrolls the chat area through the history. While it shows older output, the reply being
+    // streamed is only recorded; it is drawn from the history once scrolled back down.
+    auto const scrollChat = [&](int rows) {
+        auto const wasFollowing = _impl->chatView.following();
+        _impl->chatView.scrollBy(rows);
+        if (wasFollowing && _impl->chatView.following())
+            return;
+
+        auto sync = output.syncGuard();
+        output.hideCursor();
+        if (wasFollowing && _impl->isProcessing)
+            output.resetScrollRegion();
+        _impl->renderChatArea();
+        if (_impl->isProcessing)
+            _impl->resumeStreaming();
+        else
+            _impl->positionCursorInInputBox();
+        output.flush();
+    };
+
+    auto const processTranscriptions = [&](std::vector<std::string> const& texts) {
+        if (texts.empty())
+            return;
+        _impl->stopDraftPrefill();
+
+        if (!_impl->conversationStarted)
+            _impl->transitionToConversation();
+
+        auto message = std::string {};
+        for (auto const& text: texts)
+        {
+            _impl->printVoiceTranscription(text);
+            if (!message.empty())
+                message += ' ';
+            message += text;
+        }
+
+        startAgentTurn(std::move(message));
+    };
+
+    // Answers the last user message again. Its prompt is still in the KV cache, so only the new
+    // reply is decoded.
+    auto const regenerateLastTurn = [&] {
+        if (!_impl->ensureModelReady())
+            return;
+        _impl->stopDraftPrefill();
+        auto const messageCount = _impl->session.messageCount();
+        auto message = _impl->session.popLastTurn();
+        if (!message)
+        {
+            _impl->logInfo("Nothing to regenerate");
+            return;
+        }
+        // The notes from earlier sessions are retrieved anew.
+        *message = std::string(withoutMemoryNotes(*message));
+        _impl->unpersistMessages(messageCount - _impl->session.messageCount());
+        _impl->logInfo("Regenerating the last response");
+        _impl->printUserMessage(*message);
+        startAgentTurn(std::move(*message));
+    };
+
     auto running = true;
     while (running)
     {
-        // In VAD mode with voice enabled, drain any pending transcriptions
-        if (_impl->voiceEnabled && _impl->config.audio.mode == VoiceMode::Vad)
-        {
-            for (auto const& text: _impl->drainTranscriptions())
-                processTranscription(text);
-        }
+        // Background threads wake the poll below after changing any of this. Checking it before
+        // every poll also covers wakes consumed by a nested poll, like the one in flushTts().
 
-        auto events = _impl->terminal.poll(100);
+        // Take over the components that finished starting, then send what waited for the model
+        if (_impl->startupDirty.exchange(false, std::memory_order_acq_rel))
+            _impl->adoptStartedComponents();
+        if (_impl->engineReady && !_impl->isProcessing && !_impl->queuedMessages.empty())
+            startAgentTurn(_impl->takeQueuedMessages());
 
-        if (events.empty())
+        // In VAD mode with voice enabled, drain any pending transcriptions
+        if (_impl->voiceEnabled && _impl->config.audio.mode == VoiceMode::Vad && !_impl->isProcessing)
+            processTranscriptions(_impl->drainTranscriptions());
+
+        // Re-render log panel if background threads added entries
+        if (_impl->logPanelDirty.exchange(false, std::memory_order_acq_rel))
         {
-            // Timeout — redraw input box for voice meter animation
-            if (_impl->voiceEnabled && _impl->audioPipeline)
+            _impl->drainLogs();
+            auto sync = output.syncGuard();
+            if (_impl->isProcessing)
+            {
+                output.saveCursor();
+                _impl->renderLogPanel();
+                output.restoreCursor();
+            }
+            else
             {
-                auto sync = output.syncGuard();
                 output.hideCursor();
-                _impl->renderInputBox();
+                _impl->renderLogPanel();
                 _impl->positionCursorInInputBox();
-                output.flush();
             }
+            output.flush();
+        }
+
+        // Poll faster while a turn is streaming so tokens and the spinner stay fluid, and wake up
+        // when withheld output is due. The voice meter animates at its own pace; otherwise there
+        // is nothing to do until input arrives or a background thread wakes us.
+        auto timeout = std::chrono::milliseconds { -1 };
+        if (_impl->isProcessing)
+            timeout = frames.timeout(StreamingPollInterval);
+        else if (_impl->voiceEnabled && _impl->audioPipeline)
+            timeout = VoiceMeterInterval;
+        if (_impl->draftChangedAt)
+        {
+            auto const due = std::chrono::ceil<std::chrono::milliseconds>(
+                *_impl->draftChangedAt + DraftPrefillDelay - std::chrono::steady_clock::now());
+            auto const delay = std::max(due, std::chrono::milliseconds { 0 });
+            timeout = timeout.count() < 0 ? delay : std::min(timeout, delay);
+        }
+        auto events = _impl->terminal.poll(static_cast<int>(timeout.count()));
+
+        if (_impl->draftChangedAt
+            && std::chrono::steady_clock::now() - *_impl->draftChangedAt >= DraftPrefillDelay)
+            prefillDraft();
+
+        if (_impl->isProcessing)
+            pumpAgentEvents();
 
-            // Re-render log panel if background threads added entries
-            if (_impl->logPanelDirty.exchange(false, std::memory_order_relaxed))
+        if (events.empty())
+        {
+            // Timeout or wake — update the voice meter, and the input box for a new live
+            // transcription (part of the frames while streaming)
+            if (_impl->voiceEnabled && _impl->audioPipeline && !_impl->isProcessing)
             {
                 auto sync = output.syncGuard();
                 output.hideCursor();
-                _impl->renderLogPanel();
+                if (_impl->currentVoicePartial() != _impl->voicePartialShown)
+                    _impl->renderInputBox();
+                else
+                    _impl->updateVoiceMeter();
                 _impl->positionCursorInInputBox();
                 output.flush();
             }
-
-            // Check if VAD has transcriptions ready
-            if (_impl->voiceEnabled && _impl->config.audio.mode == VoiceMode::Vad
-                && _impl->hasTranscriptions())
-            {
-                for (auto const& text: _impl->drainTranscriptions())
-                    processTranscription(text);
-            }
-
             continue;
         }
 
@@ -1318,9 +2414,27 @@ auto App::run() -> int
             {
                 output.updateDimensions();
                 _impl->renderFullScreen();
+                _impl->resumeStreaming();
                 continue;
             }
 
+            // While a turn is streaming, ESC or Ctrl+C cancels it instead of editing/quitting
+            if (auto const* key = std::get_if<tui::KeyEvent>(&event); key && _impl->isProcessing)
+            {
+                auto const isCtrlC =
+                    key->codepoint == 'c' && hasModifier(key->modifiers, tui::Modifier::Ctrl);
+                if (key->key == tui::KeyCode::Escape || isCtrlC)
+                {
+                    _impl->agentWorker->cancel();
+                    continue;
+                }
+                if (key->key == tui::KeyCode::Enter)
+                {
+                    _impl->logInfo("Still generating \u2014 press Esc to cancel");
+                    continue;
+                }
+            }
+
             // Handle mouse events for log panel
             if (auto const* mouse = std::get_if<tui::MouseEvent>(&event))
             {
@@ -1332,16 +2446,27 @@ auto App::run() -> int
                         output.hideCursor();
                         _impl->computeGeometry();
                         _impl->renderFullScreen();
+                        _impl->resumeStreaming();
                         continue;
                     }
                 }
+                else if (_impl->conversationStarted && mouse->y <= _impl->geo.chatBottom
+                         && (mouse->type == tui::MouseEvent::Type::ScrollUp
+                             || mouse->type == tui::MouseEvent::Type::ScrollDown))
+                {
+                    auto const up = mouse->type == tui::MouseEvent::Type::ScrollUp;
+                    scrollChat(up ? -ChatScrollStep : ChatScrollStep);
+                    continue;
+                }
                 else if (mouse->type == tui::MouseEvent::Type::ScrollUp && mouse->y >= _impl->geo.logStartRow)
                 {
                     _impl->logPanel.scrollUp();
                     auto sync = output.syncGuard();
-                    output.hideCursor();
+                    output.saveCursor();
                     _impl->renderLogPanel();
-                    _impl->positionCursorInInputBox();
+                    output.restoreCursor();
+                    if (!_impl->isProcessing)
+                        _impl->positionCursorInInputBox();
                     output.flush();
                     continue;
                 }
@@ -1350,9 +2475,11 @@ auto App::run() -> int
                 {
                     _impl->logPanel.scrollDown();
                     auto sync = output.syncGuard();
-                    output.hideCursor();
+                    output.saveCursor();
                     _impl->renderLogPanel();
-                    _impl->positionCursorInInputBox();
+                    output.restoreCursor();
+                    if (!_impl->isProcessing)
+                        _impl->positionCursorInInputBox();
                     output.flush();
                     continue;
                 }
@@ -1368,6 +2495,23 @@ auto App::run() -> int
                     output.hideCursor();
                     _impl->computeGeometry();
                     _impl->renderFullScreen();
+                    _impl->resumeStreaming();
+                    continue;
+                }
+
+                if (key->codepoint == 'r' && hasModifier(key->modifiers, tui::Modifier::Ctrl)
+                    && !_impl->isProcessing && _impl->conversationStarted)
+                {
+                    regenerateLastTurn();
+                    continue;
+                }
+
+                // Page through the chat history, keeping a row of context
+                if (_impl->conversationStarted
+                    && (key->key == tui::KeyCode::PageUp || key->key == tui::KeyCode::PageDown))
+                {
+                    auto const page = std::max(1, _impl->chatView.height() - 1);
+                    scrollChat(key->key == tui::KeyCode::PageUp ? -page : page);
                     continue;
                 }
             }
@@ -1376,6 +2520,7 @@ auto App::run() -> int
             switch (action)
             {
                 case tui::InputFieldAction::Submit: {
+                    _impl->stopDraftPrefill();
                     auto line = std::string(_impl->inputField.text());
                     _impl->inputField.addHistory(line);
                     _impl->inputField.clear();
@@ -1398,8 +2543,7 @@ auto App::run() -> int
                             _impl->audioPipeline->stopRecording();
                             _impl->recording = false;
 
-                            for (auto const& text: _impl->drainTranscriptions())
-                                processTranscription(text);
+                            processTranscriptions(_impl->drainTranscriptions());
                         }
                         {
                             auto sync = output.syncGuard();
@@ -1443,10 +2587,84 @@ auto App::run() -> int
                         break;
                     }
 
+                    if (line == "/regenerate")
+                    {
+                        if (!_impl->conversationStarted)
+                            _impl->transitionToConversation();
+                        regenerateLastTurn();
+                        break;
+                    }
+
+                    if (line == "/history" || line.starts_with("/resume "))
+                    {
+                        if (!_impl->conversationStarted)
+                            _impl->transitionToConversation();
+                        if (line == "/history")
+                            _impl->printSessions();
+                        else if (_impl->ensureModelReady())
+                        {
+                            auto const id = line.substr(std::string_view("/resume ").size());
+                            if (auto const resumed = _impl->resumeSession(id))
+                            {
+                                _impl->enforceMemoryBudget();
+                                _impl->logInfo(std::format("Resumed session {} ({} messages)",
+                                                           id,
+                                                           _impl->session.messageCount()));
+                            }
+                            else
+                                _impl->logError(resumed.error().message);
+                        }
+                        {
+                            auto sync = output.syncGuard();
+                            output.hideCursor();
+                            _impl->renderInputBox();
+                            _impl->positionCursorInInputBox();
+                            output.flush();
+                        }
+                        break;
+                    }
+
+                    if (line == "/model" || line.starts_with("/model "))
+                    {
+                        if (!_impl->conversationStarted)
+                            _impl->transitionToConversation();
+                        if (line == "/model")
+                            _impl->printModels();
+                        else if (_impl->ensureModelReady())
+                            _impl->selectModel(line.substr(std::string_view("/model ").size()));
+                        {
+                            auto sync = output.syncGuard();
+                            output.hideCursor();
+                            _impl->renderInputBox();
+                            _impl->positionCursorInInputBox();
+                            output.flush();
+                        }
+                        break;
+                    }
+
+                    if (line == "/stats")
+                    {
+                        if (!_impl->conversationStarted)
+                            _impl->transitionToConversation();
+                        _impl->printMemoryStats();
+                        {
+                            auto sync = output.syncGuard();
+                            output.hideCursor();
+                            _impl->renderInputBox();
+                            _impl->positionCursorInInputBox();
+                            output.flush();
+                        }
+                        break;
+                    }
+
                     if (line == "/clear")
                     {
-                        _impl->session.clear();
-                        _impl->logInfo("Conversation cleared");
+                        if (_impl->ensureModelReady())
+                        {
+                            _impl->closeSession();
+                            _impl->session.clear();
+                            _impl->logInfo("Conversation cleared");
+                        }
                         {
                             auto sync = output.syncGuard();
                             output.hideCursor();
@@ -1459,11 +2677,14 @@ auto App::run() -> int
 
                     if (line == "/voice")
                     {
+                        _impl->adoptStartedComponents();
                         if (!_impl->audioInitialized)
                         {
-                            _impl->logError(
-                                "Voice input not available. Configure audio in config.json with a whisper "
-                                "model path.");
+                            if (_impl->audioStartup.state() == ComponentState::Loading)
+                                _impl->logInfo("Voice input is still loading");
+                            else
+                                _impl->logError("Voice input not available. Configure audio in config.json "
+                                                "with a whisper model path.");
                             auto sync = output.syncGuard();
                             output.hideCursor();
                             _impl->renderInputBox();
@@ -1506,6 +2727,7 @@ auto App::run() -> int
                             _impl->audioPipeline->stop();
                             _impl->logInfo("Voice input disabled");
                         }
+                        _impl->rebalanceThreads();
                         {
                             auto sync = output.syncGuard();
                             output.hideCursor();
@@ -1518,9 +2740,28 @@ auto App::run() -> int
 
                     if (line == "/tts")
                     {
+                        _impl->adoptStartedComponents();
+                        if (!_impl->ttsSpeaker && _impl->ttsStartup.state() == ComponentState::Loading)
+                        {
+                            _impl->logInfo("Speech output is still loading");
+                            auto sync = output.syncGuard();
+                            output.hideCursor();
+                            _impl->renderInputBox();
+                            _impl->positionCursorInInputBox();
+                            output.flush();
+                            break;
+                        }
+
                         if (!_impl->ttsSpeaker)
                         {
-                            auto ttsResult = _impl->initializeTts();
+                            // A first use downloads the voice; its progress goes to the status bar.
+                            auto ttsResult = _impl->initializeTts([this](DownloadProgress const& progress) {
+                                auto text = std::string {};
+                                if (!progress.done)
+                                    text = std::format("Voice {} ", formatDownloadProgress(progress));
+                                _impl->showStatusInfo(std::move(text));
+                                _impl->terminal.output().flush();
+                            });
                             if (!ttsResult)
                             {
                                 _impl->logError(
@@ -1533,6 +2774,7 @@ auto App::run() -> int
                                 break;
                             }
                             _impl->logInfo("TTS enabled \u2014 agent responses will be spoken aloud");
+                            _impl->rebalanceThreads();
                             auto sync = output.syncGuard();
                             output.hideCursor();
                             _impl->renderInputBox();
@@ -1550,6 +2792,7 @@ auto App::run() -> int
                             _impl->ttsSpeaker->cancel();
                             _impl->logInfo("TTS disabled");
                         }
+                        _impl->rebalanceThreads();
                         {
                             auto sync = output.syncGuard();
                             output.hideCursor();
@@ -1565,18 +2808,23 @@ auto App::run() -> int
                         if (!_impl->conversationStarted)
                             _impl->transitionToConversation();
 
-                        auto tools = _impl->servers.allTools();
+                        auto const snapshot = _impl->servers.toolSnapshot();
+                        auto const& tools = snapshot->tools;
                         if (tools.empty())
                         {
                             _impl->logInfo("No tools available");
                         }
                         else
                         {
-                            auto toolsText =
-                                std::format("\033[34mInfo:\033[m {} tool(s) available:\n", tools.size());
+                            auto infoStyle = tui::Style {};
+                            infoStyle.fg = static_cast<std::uint8_t>(4); // Blue
+
+                            auto toolsText = std::format(" {} tool(s) available:\n", tools.size());
                             for (auto const& tool: tools)
                                 toolsText += std::format("  {} \u2014 {}\n", tool.name, tool.description);
                             toolsText += "\n";
+                            _impl->chatHistory.beginMessage();
+                            _impl->writeToChatArea("Info:", infoStyle);
                             _impl->writeToChatArea(toolsText);
                         }
                         {
@@ -1608,52 +2856,7 @@ auto App::run() -> int
 
                     _impl->printUserMessage(line);
 
-                    // Mark as processing (for spinner display)
-                    _impl->isProcessing = true;
-
-                    // Set scroll region for streaming output
-                    output.setScrollRegion(_impl->geo.chatTop, _impl->geo.chatBottom);
-                    output.moveTo(_impl->geo.chatBottom, 1);
-
-                    mdRenderer.beginStream();
-                    auto streamCb = [&](std::string_view token) {
-                        mdRenderer.feedToken(token);
-                        output.flush();
-                        _impl->feedTtsToken(token);
-                        // Tick the spinner during streaming
-                        if (_impl->spinner.tick())
-                        {
-                            output.saveCursor();
-                            _impl->renderInputBox();
-                            output.restoreCursor();
-                            output.flush();
-                        }
-                    };
-
-                    auto result = _impl->agent->processMessage(line, streamCb);
-
-                    // Mark processing as complete
-                    _impl->isProcessing = false;
-
-                    if (!result)
-                        _impl->logError(std::format("{}", result.error()));
-
-                    mdRenderer.endStream();
-                    output.resetScrollRegion();
-                    output.writeRaw("\n");
-                    output.flush();
-
-                    _impl->flushTts();
-
-                    {
-                        auto sync = output.syncGuard();
-                        output.hideCursor();
-                        _impl->renderInputBox();
-                        _impl->renderLogPanel();
-                        _impl->renderStatusBar();
-                        _impl->positionCursorInInputBox();
-                        output.flush();
-                    }
+                    startAgentTurn(std::move(line));
                     break;
                 }
 
@@ -1668,6 +2871,17 @@ auto App::run() -> int
 
                 case tui::InputFieldAction::Changed: {
                     auto sync = output.syncGuard();
+                    if (_impl->isProcessing)
+                    {
+                        // Keep the streaming cursor where it is; the box is redrawn in place
+                        output.saveCursor();
+                        _impl->renderInputBox();
+                        output.restoreCursor();
+                        output.flush();
+                        break;
+                    }
+                    if (_impl->engineReady && _impl->config.llm.speculativePrefill)
+                        _impl->draftChangedAt = std::chrono::steady_clock::now();
                     output.hideCursor();
                     // Check if input box height changed (line added/removed)
                     auto const newHeight = _impl->computeInputBoxHeight();
@@ -1694,6 +2908,8 @@ auto App::run() -> int
     }
 
     // Shutdown: revert log output to stderr before tearing down the TUI
+    _impl->drainLogs();
+    log::disableQueue();
     log::setCallback(nullptr);
 
     // Shutdown: leave alt screen and restore cursor
@@ -1717,6 +2933,14 @@ auto App::run() -> int
         _impl->audioPipeline->stop();
     }
 
+    // Shutdown: keep the conversation's KV cache for resuming it, unless a turn is still running
+    if (!_impl->isProcessing)
+    {
+        _impl->stopDraftPrefill();
+        _impl->closeSession();
+    }
+
+    _impl->stopComponents();
     _impl->servers.shutdown();
     _impl->terminal.shutdown();
     return 0;
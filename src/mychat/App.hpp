@@ -21,11 +21,15 @@ class App
     App(const App&) = delete;
     App& operator=(const App&) = delete;
 
-    /// @brief Initializes all components (model loading, MCP servers, audio).
+    /// @brief Resolves the model to use, letting the user pick one to download if there is none.
     /// @return Success or an error.
     [[nodiscard]] auto initialize() -> VoidResult;
 
     /// @brief Runs the main interactive loop.
+    ///
+    /// The TUI comes up right away while the model, the MCP servers, voice input and speech output
+    /// are initialized concurrently in the background. Messages sent before the model is ready are
+    /// held and sent once it is.
     /// @return Exit code (0 for success).
     [[nodiscard]] auto run() -> int;
 
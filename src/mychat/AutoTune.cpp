@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "AutoTune.hpp"
+
+#include <audio/Transcriber.hpp>
+#include <core/Log.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <numbers>
+#include <span>
+
+namespace mychat
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto ReferencePromptTokens = 1000.0;
+    constexpr auto ReferenceReplyTokens = 200.0;
+
+    /// Short responses and a smaller context keep each candidate to seconds rather than minutes.
+    constexpr auto TuningMaxTokens = 32;
+    constexpr auto TuningContextSize = 4096;
+
+    constexpr auto TranscriptionSampleRate = 16000;
+    constexpr auto TranscriptionSeconds = 10;
+
+    auto settingName(AutotuneSetting setting) -> std::string_view
+    {
+        switch (setting)
+        {
+            case AutotuneSetting::GpuLayers: return "GPU layers";
+            case AutotuneSetting::FlashAttention: return "Flash attention";
+            case AutotuneSetting::MicroBatch: return "Micro-batch size";
+            case AutotuneSetting::Threads: return "Threads";
+        }
+        return "Setting";
+    }
+
+    auto flashAttentionLabel(FlashAttention flashAttention) -> std::string_view
+    {
+        switch (flashAttention)
+        {
+            case FlashAttention::Auto: return "auto";
+            case FlashAttention::Enabled: return "on";
+            case FlashAttention::Disabled: return "off";
+        }
+        return "auto";
+    }
+
+    auto autotuneLabel(LlmEngineConfig const& config) -> std::string
+    {
+        auto const count = [](int value) { return value > 0 ? std::to_string(value) : std::string("auto"); };
+        return std::format("gpu-layers={} flash-attn={} ubatch={} threads={}",
+                           config.gpuLayers < 0 ? std::string("all") : std::to_string(config.gpuLayers),
+                           flashAttentionLabel(config.flashAttention),
+                           count(config.ubatchSize),
+                           count(config.threads));
+    }
+
+    auto elapsedMs(Clock::time_point start) -> double
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /// @brief The fastest of the candidates fastest() measured.
+    struct Fastest
+    {
+        std::size_t index = 0;
+        double turnMs = 0.0;
+    };
+
+    /// @brief Measures each of @p candidates, adding a line per candidate to @p report.
+    /// @return The fastest one, or nothing if none could be measured.
+    auto fastest(std::span<const LlmBenchmarkVariant> candidates,
+                 SamplerConfig const& sampler,
+                 std::string& report) -> std::optional<Fastest>
+    {
+        auto const runs = runLlmBenchmark(candidates, sampler, TuningMaxTokens);
+        auto best = std::optional<Fastest> {};
+        for (auto i = std::size_t { 0 }; i < runs.size(); ++i)
+        {
+            auto const ms = autotuneTurnMs(runs[i]);
+            if (!ms)
+            {
+                auto const& error = runs[i].error;
+                std::format_to(std::back_inserter(report),
+                               "  {:<56} failed: {}\n",
+                               candidates[i].label,
+                               error.empty() ? "no rates measured" : error);
+                continue;
+            }
+            std::format_to(
+                std::back_inserter(report), "  {:<56} {:>8.0f} ms per turn\n", candidates[i].label, *ms);
+            if (!best || *ms < best->turnMs)
+                best = Fastest { .index = i, .turnMs = *ms };
+        }
+        return best;
+    }
+
+    /// @brief Returns a tone rising and falling like speech, to give whisper's encoder a
+    ///        full window of work.
+    auto testAudio() -> std::vector<float>
+    {
+        auto samples =
+            std::vector<float>(static_cast<std::size_t>(TranscriptionSampleRate) * TranscriptionSeconds);
+        for (auto i = std::size_t { 0 }; i < samples.size(); ++i)
+        {
+            auto const t = static_cast<double>(i) / TranscriptionSampleRate;
+            auto const envelope = 0.5 + 0.5 * std::sin(2.0 * std::numbers::pi * 3.0 * t);
+            samples[i] = static_cast<float>(0.1 * envelope * std::sin(2.0 * std::numbers::pi * 220.0 * t));
+        }
+        return samples;
+    }
+
+    /// @brief Returns the seconds whisper takes per second of audio with @p config.
+    auto measureTranscription(TranscriberConfig const& config, std::span<const float> samples)
+        -> Result<double>
+    {
+        auto transcriber = Transcriber();
+        if (auto initialized = transcriber.initialize(config); !initialized)
+            return std::unexpected(initialized.error());
+        auto const start = Clock::now();
+        if (auto text = transcriber.transcribe(samples); !text)
+            return std::unexpected(text.error());
+        return elapsedMs(start) / (TranscriptionSeconds * 1000.0);
+    }
+
+    /// @brief Tunes whisper's threads, then its flash attention, in @p config.
+    /// @return The real-time factor of the fastest settings, or nothing if whisper is not there.
+    auto tuneTranscription(AppConfig& config, CpuTopology const& cpus, std::string& report)
+        -> std::optional<double>
+    {
+        auto modelPath = config.audio.whisperModelPath.empty() ? defaultWhisperModelPath()
+                                                               : config.audio.whisperModelPath;
+        if (!std::filesystem::exists(modelPath))
+        {
+            report += "Transcription: no whisper model, skipped\n";
+            return std::nullopt;
+        }
+
+        auto const planned =
+            planThreads(cpus, CpuWorkloads { .transcription = true, .speech = config.tts.enabled })
+                .transcriptionThreads;
+        auto best = TranscriberConfig {
+            .modelPath = std::move(modelPath),
+            .language = config.audio.language,
+            .threads = config.audio.threads > 0 ? config.audio.threads : planned,
+            .translate = false,
+            .useGpu = config.audio.useGpu,
+            .flashAttention = config.audio.flashAttention,
+            .beamSize = config.audio.beamSize,
+            .reduceAudioContext = config.audio.reduceAudioContext,
+            .warmUp = true,
+        };
+
+        report += "Transcription:\n";
+        auto const samples = testAudio();
+        auto bestFactor = std::optional<double> {};
+        auto const measure = [&](TranscriberConfig const& candidate) {
+            auto const label = std::format(
+                "threads={} flash-attn={}", candidate.threads, candidate.flashAttention ? "on" : "off");
+            auto const factor = measureTranscription(candidate, samples);
+            if (!factor)
+            {
+                std::format_to(
+                    std::back_inserter(report), "  {:<56} failed: {}\n", label, factor.error().message);
+                return;
+            }
+            std::format_to(std::back_inserter(report), "  {:<56} {:>8.3f}x real time\n", label, *factor);
+            if (!bestFactor || *factor < *bestFactor)
+            {
+                bestFactor = *factor;
+                best = candidate;
+            }
+        };
+
+        auto tried = std::vector<int> {};
+        for (auto const threads: { planned, 2, 4, 8 })
+        {
+            if (threads > static_cast<int>(cpus.logicalCpus) || std::ranges::find(tried, threads) != tried.end())
+                continue;
+            tried.push_back(threads);
+            auto candidate = best;
+            candidate.threads = threads;
+            measure(candidate);
+        }
+        // Flash attention only makes a difference on the GPU; compared at the best thread count.
+        if (config.audio.useGpu && bestFactor)
+        {
+            auto candidate = best;
+            candidate.flashAttention = !best.flashAttention;
+            measure(candidate);
+        }
+
+        if (bestFactor)
+        {
+            config.audio.threads = best.threads == planned ? 0 : best.threads;
+            config.audio.flashAttention = best.flashAttention;
+        }
+        return bestFactor;
+    }
+} // namespace
+
+auto autotuneCandidates(LlmEngineConfig const& best,
+                        AutotuneSetting setting,
+                        CpuTopology const& cpus,
+                        bool partialLayers) -> std::vector<LlmBenchmarkVariant>
+{
+    auto variants = std::vector<LlmBenchmarkVariant> {};
+    auto const add = [&](auto const& apply) {
+        auto config = best;
+        apply(config);
+        auto label = autotuneLabel(config);
+        if (std::ranges::none_of(variants, [&](auto const& other) { return other.label == label; }))
+            variants.push_back({ .label = std::move(label), .engine = std::move(config) });
+    };
+
+    switch (setting)
+    {
+        case AutotuneSetting::GpuLayers:
+            if (partialLayers)
+                for (auto const layers: { 32, 16, 8 })
+                    add([&](LlmEngineConfig& config) { config.gpuLayers = layers; });
+            else
+                for (auto const layers: { -1, 0 })
+                    add([&](LlmEngineConfig& config) { config.gpuLayers = layers; });
+            break;
+        case AutotuneSetting::FlashAttention:
+            for (auto const flashAttention: { FlashAttention::Enabled, FlashAttention::Disabled })
+                add([&](LlmEngineConfig& config) { config.flashAttention = flashAttention; });
+            break;
+        case AutotuneSetting::MicroBatch:
+            for (auto const ubatch: { 256, 512, 1024 })
+                add([&](LlmEngineConfig& config) {
+                    config.ubatchSize = ubatch;
+                    if (config.batchSize > 0)
+                        config.batchSize = std::max(config.batchSize, ubatch);
+                });
+            break;
+        case AutotuneSetting::Threads: {
+            auto const fast = planThreads(cpus, CpuWorkloads {}).batchThreads;
+            for (auto const threads: { fast, std::max(1, fast / 2), static_cast<int>(cpus.logicalCpus) })
+                add([&](LlmEngineConfig& config) {
+                    config.threads = threads;
+                    config.batchThreads = 0;
+                });
+            break;
+        }
+    }
+    return variants;
+}
+
+auto autotuneTurnMs(LlmBenchmarkRun const& run) -> std::optional<double>
+{
+    if (!run.error.empty())
+        return std::nullopt;
+
+    auto prefill = 0.0;
+    auto decodeSum = 0.0;
+    auto decodeSamples = 0;
+    for (auto const& sample: run.samples)
+    {
+        if (sample.scenario == "long-prefill")
+            prefill = sample.prefillTokensPerSecond();
+        if (auto const decode = sample.metrics.decodeTokensPerSecond(); decode > 0.0)
+        {
+            decodeSum += decode;
+            ++decodeSamples;
+        }
+    }
+    if (prefill <= 0.0 || decodeSamples == 0)
+        return std::nullopt;
+    return 1000.0 * (ReferencePromptTokens / prefill + ReferenceReplyTokens / (decodeSum / decodeSamples));
+}
+
+auto autotune(AppConfig const& config) -> Result<AutotuneResult>
+{
+    auto const cpus = detectCpuTopology();
+    auto best = llmEngineConfig(config.llm);
+    if (best.modelPath.empty())
+    {
+        auto path = downloadedModelPath();
+        if (!path)
+            return makeError(ErrorCode::ConfigError,
+                             "No model to tune; pass --model or download one by running mychat");
+        best.modelPath = std::move(*path);
+    }
+    best.contextSize = std::min(best.contextSize, TuningContextSize);
+    auto const plannedThreads = planThreads(cpus, CpuWorkloads {}).batchThreads;
+    if (best.threads <= 0)
+        best.threads = plannedThreads;
+
+    // A fixed seed, so that every candidate generates the same text.
+    auto sampler = samplerConfig(config.llm);
+    sampler.seed = 42;
+
+    auto result = AutotuneResult { .config = config, .turnMs = {}, .realTimeFactor = {}, .report = {} };
+    // Every candidate carries the best settings so far, so the last time chosen covers them all.
+    for (auto const setting: { AutotuneSetting::GpuLayers,
+                               AutotuneSetting::FlashAttention,
+                               AutotuneSetting::MicroBatch,
+                               AutotuneSetting::Threads })
+    {
+        log::info("Tuning {}", settingName(setting));
+        std::format_to(std::back_inserter(result.report), "{}:\n", settingName(setting));
+        auto candidates = autotuneCandidates(best, setting, cpus);
+        auto chosen = fastest(candidates, sampler, result.report);
+        // Full offload failing to load usually means it does not fit the GPU's memory.
+        if (setting == AutotuneSetting::GpuLayers && (!chosen || chosen->index != 0))
+        {
+            auto partial = autotuneCandidates(best, setting, cpus, true);
+            if (auto const fits = fastest(partial, sampler, result.report);
+                fits && (!chosen || fits->turnMs < chosen->turnMs))
+            {
+                candidates.push_back(std::move(partial[fits->index]));
+                chosen = Fastest { .index = candidates.size() - 1, .turnMs = fits->turnMs };
+            }
+        }
+        if (chosen)
+        {
+            best = candidates[chosen->index].engine;
+            result.turnMs = chosen->turnMs;
+        }
+    }
+    if (!result.turnMs)
+        return makeError(ErrorCode::InferenceError, "No configuration could be measured");
+
+    auto& llm = result.config.llm;
+    llm.gpuLayers = best.gpuLayers;
+    llm.flashAttention = best.flashAttention;
+    llm.ubatchSize = best.ubatchSize;
+    llm.batchSize = best.batchSize;
+    llm.threads = best.threads == plannedThreads ? 0 : best.threads;
+
+    result.realTimeFactor = tuneTranscription(result.config, cpus, result.report);
+    return result;
+}
+
+} // namespace mychat
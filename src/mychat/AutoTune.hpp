@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/CpuBudget.hpp>
+#include <core/Error.hpp>
+#include <llm/LlmEngine.hpp>
+#include <mychat/Config.hpp>
+#include <mychat/LlmBenchmark.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief An engine setting the auto-tuner sweeps, one after the other.
+enum class AutotuneSetting : std::uint8_t
+{
+    GpuLayers,
+    FlashAttention,
+    MicroBatch, ///< The physical batch size (n_ubatch) prefill runs in.
+    Threads,
+};
+
+/// @brief Returns the variants of @p best that differ in @p setting, the values worth comparing.
+///
+/// For GpuLayers these are full offload and none; partialLayers adds layer counts in between,
+/// for when full offload does not fit the GPU's memory.
+[[nodiscard]] auto autotuneCandidates(LlmEngineConfig const& best,
+                                      AutotuneSetting setting,
+                                      CpuTopology const& cpus,
+                                      bool partialLayers = false) -> std::vector<LlmBenchmarkVariant>;
+
+/// @brief Returns how long a reference turn would take at the rates @p run measured, or nothing
+///        if it failed.
+///
+/// The turn prefills 1000 tokens and generates 200, so both prefill and decode rates count.
+[[nodiscard]] auto autotuneTurnMs(LlmBenchmarkRun const& run) -> std::optional<double>;
+
+/// @brief The settings the auto-tuner found fastest.
+struct AutotuneResult
+{
+    AppConfig config;                     ///< The input configuration with the best settings applied.
+    std::optional<double> turnMs;         ///< See autotuneTurnMs(), for the best LLM settings.
+    std::optional<double> realTimeFactor; ///< Transcription time per second of audio, if measured.
+    std::string report;                   ///< What was measured, one line per candidate.
+};
+
+/// @brief Sweeps the LLM's GPU layers, flash attention, micro-batch size and threads, and then
+///        whisper's threads and flash attention, keeping the fastest value of each in turn.
+///
+/// Each LLM candidate loads the model and runs the benchmark suite (see runLlmBenchmark()) with
+/// short responses; whisper is only measured if its model is there. Thread counts equal to the
+/// planned ones (see planThreads()) are stored as 0, so the app keeps planning them.
+/// @return The tuned configuration, or an error if no LLM candidate could be measured.
+[[nodiscard]] auto autotune(AppConfig const& config) -> Result<AutotuneResult>;
+
+} // namespace mychat
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Batch.hpp"
+
+#include <core/Log.hpp>
+#include <llm/ChatSession.hpp>
+#include <llm/LlmEngine.hpp>
+#include <mcp/ServerManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace mychat
+{
+
+namespace
+{
+
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Hands out the input items to the sequences and collects their results.
+    class BatchChannel
+    {
+      public:
+        BatchChannel(std::istream& input, std::ostream& output): _input(input), _output(output) {}
+
+        /// @brief Returns the next item, or std::nullopt once the input is exhausted.
+        ///
+        /// Malformed lines are answered with an error result right away.
+        auto next() -> std::optional<BatchItem>
+        {
+            auto const lock = std::lock_guard(_inputMutex);
+            auto line = std::string {};
+            while (std::getline(_input, line))
+            {
+                ++_lineNumber;
+                auto item = parseBatchItem(line, _lineNumber);
+                if (item && *item)
+                    return std::move(**item);
+                if (!item)
+                    write({ .id = std::to_string(_lineNumber),
+                            .response = std::unexpected(item.error()),
+                            .metrics = {},
+                            .elapsedMs = 0.0,
+                            .sequence = -1 });
+            }
+            return std::nullopt;
+        }
+
+        /// @brief Writes the JSON line of @p result.
+        void write(const BatchResult& result)
+        {
+            auto const line = batchResultJson(result).dump();
+            auto const lock = std::lock_guard(_outputMutex);
+            // Flushed per line, so an interrupted run keeps the results it has.
+            _output << line << '\n' << std::flush;
+            ++_summary.items;
+            if (!result.response)
+                ++_summary.failed;
+        }
+
+        [[nodiscard]] auto summary() const -> BatchSummary
+        {
+            auto const lock = std::lock_guard(_outputMutex);
+            return _summary;
+        }
+
+      private:
+        std::istream& _input;
+        std::ostream& _output;
+        std::mutex _inputMutex;
+        mutable std::mutex _outputMutex;
+        size_t _lineNumber = 0;
+        BatchSummary _summary;
+    };
+
+    /// @brief Answers the items of @p channel one after another on one sequence.
+    void runSequence(const AppConfig& config,
+                     LlmEngine& engine,
+                     ServerManager& servers,
+                     BatchChannel& channel,
+                     int sequence)
+    {
+        auto session = ChatSession(config.llm.systemPrompt);
+        session.setOverflowPolicy(config.llm.contextOverflow);
+
+        auto agentConfig = agentLoopConfig(config, engine.modelFingerprint());
+        // Sequences would race writing it; the others embed the tools themselves.
+        if (sequence > 0)
+            agentConfig.toolIndexPath.clear();
+        auto agent = AgentLoop(engine, session, servers, std::move(agentConfig));
+
+        while (auto item = channel.next())
+        {
+            session.clear();
+            auto const start = Clock::now();
+            auto response = agent.processMessage(item->prompt);
+            auto const elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start);
+            channel.write({ .id = std::move(item->id),
+                            .response = std::move(response),
+                            .metrics = agent.lastTurnMetrics(),
+                            .elapsedMs = elapsed.count(),
+                            .sequence = sequence });
+        }
+    }
+
+} // namespace
+
+auto parseBatchItem(std::string_view line, size_t lineNumber) -> Result<std::optional<BatchItem>>
+{
+    if (line.ends_with('\r'))
+        line.remove_suffix(1);
+    auto const start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+        return std::nullopt;
+    if (line[start] != '{')
+        return BatchItem { .id = std::to_string(lineNumber), .prompt = std::string(line) };
+
+    auto const object = nlohmann::json::parse(line, nullptr, false);
+    if (object.is_discarded() || !object.is_object())
+        return makeError(ErrorCode::InvalidArgument, std::format("Line {}: invalid JSON", lineNumber));
+    auto const prompt = object.find("prompt");
+    if (prompt == object.end() || !prompt->is_string())
+        return makeError(ErrorCode::InvalidArgument,
+                         std::format("Line {}: missing \"prompt\" string", lineNumber));
+
+    auto item = BatchItem { .id = std::to_string(lineNumber), .prompt = prompt->get<std::string>() };
+    if (auto const id = object.find("id"); id != object.end())
+    {
+        if (id->is_string())
+            item.id = id->get<std::string>();
+        else if (id->is_number())
+            item.id = id->dump();
+    }
+    return item;
+}
+
+auto batchResultJson(const BatchResult& result) -> nlohmann::json
+{
+    auto const& metrics = result.metrics;
+    auto line = nlohmann::json {
+        { "id", result.id },
+    };
+    if (result.response)
+        line["response"] = *result.response;
+    else
+        line["error"] = result.response.error().message;
+    line["metrics"] = {
+        { "elapsedMs", result.elapsedMs },
+        { "sequence", result.sequence },
+        { "steps", metrics.steps },
+        { "toolCalls", metrics.toolCalls },
+        { "toolCacheHits", metrics.toolCacheHits },
+        { "promptTokens", metrics.total.promptTokens },
+        { "reusedTokens", metrics.total.reusedTokens },
+        { "generatedTokens", metrics.total.generatedTokens },
+        { "prefillMs", metrics.total.prefillMs },
+        { "timeToFirstTokenMs", metrics.total.timeToFirstTokenMs },
+        { "decodeMs", metrics.total.decodeMs },
+        { "decodeTokensPerSecond", metrics.total.decodeTokensPerSecond() },
+        { "summaries", metrics.summaries },
+        { "summaryTokens", metrics.summaryTotal.totalTokens() },
+    };
+    return line;
+}
+
+auto runBatch(const AppConfig& config, std::istream& input, std::ostream& output, int parallel)
+    -> Result<BatchSummary>
+{
+    parallel = std::max(1, parallel);
+
+    auto engineConfig = llmEngineConfig(config.llm);
+    if (engineConfig.modelPath.empty())
+    {
+        auto path = downloadedModelPath();
+        if (!path)
+            return makeError(ErrorCode::ConfigError, "No model configured or downloaded");
+        engineConfig.modelPath = std::move(*path);
+    }
+    // The sequences share one context, whose scheduler decodes their tokens in joint batches.
+    engineConfig.parallelSequences = parallel;
+
+    auto engines = std::vector<LlmEngine>(1);
+    if (auto loaded = engines.front().load(engineConfig); !loaded)
+        return std::unexpected(loaded.error());
+    for (auto i = 1; i < parallel; ++i)
+    {
+        auto engine = engines.front().share();
+        if (!engine)
+            return std::unexpected(engine.error());
+        engines.push_back(std::move(*engine));
+    }
+    log::info("Running batch on {} sequence(s)", parallel);
+
+    auto servers = ServerManager();
+    connectMcpServers(config, servers);
+
+    auto channel = BatchChannel(input, output);
+    {
+        auto sequences = std::vector<std::jthread> {};
+        sequences.reserve(engines.size());
+        for (auto i = size_t { 0 }; i < engines.size(); ++i)
+            sequences.emplace_back([&, i] {
+                runSequence(config, engines[i], servers, channel, static_cast<int>(i));
+            });
+    }
+    return channel.summary();
+}
+
+} // namespace mychat
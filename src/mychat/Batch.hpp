@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <agent/AgentLoop.hpp>
+#include <core/Error.hpp>
+#include <mychat/Config.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace mychat
+{
+
+/// @brief One prompt of a batch run.
+struct BatchItem
+{
+    std::string id; ///< Copied to the result; the line number unless the input names it.
+    std::string prompt;
+};
+
+/// @brief Parses one line of batch input.
+///
+/// A line starting with `{` is a JSON object with a "prompt" string and an optional "id"
+/// (string or number); any other line is the prompt itself.
+/// @param line The line, without its line break.
+/// @param lineNumber The 1-based line number, the id of items that do not name one.
+/// @return The item, std::nullopt for a blank line, or an error for malformed JSON.
+[[nodiscard]] auto parseBatchItem(std::string_view line, size_t lineNumber)
+    -> Result<std::optional<BatchItem>>;
+
+/// @brief The outcome of one item of a batch run.
+struct BatchResult
+{
+    std::string id;
+    Result<std::string> response; ///< The final assistant response, or why there is none.
+    TurnMetrics metrics;
+    double elapsedMs = 0.0; ///< Wall time of the whole turn, tool calls included.
+    int sequence = 0;       ///< The model sequence the item ran on.
+};
+
+/// @brief Returns the JSON line written for @p result.
+[[nodiscard]] auto batchResultJson(const BatchResult& result) -> nlohmann::json;
+
+/// @brief How many items a batch run processed.
+struct BatchSummary
+{
+    size_t items = 0;
+    size_t failed = 0; ///< Items without a response, including malformed input lines.
+};
+
+/// @brief Answers prompts without a terminal, for offline evaluation.
+///
+/// Loads the model once and runs @p parallel sequences on it, each an LlmEngine on its own
+/// sequence of one context (see LlmEngine::share()) with a conversation and an agent loop of its
+/// own, so that items run concurrently and their tokens are decoded in shared batches. Each item
+/// goes through AgentLoop::processMessage() in a fresh conversation, with the tools of all
+/// configured MCP servers. Results are written as JSON lines in the order the items finish; the
+/// id ties them to the input.
+/// @param config The application configuration; an empty model path selects a downloaded model.
+/// @param input Batch input, one item per line (see parseBatchItem()).
+/// @param output Receives one JSON line per item (see batchResultJson()).
+/// @param parallel Number of sequences.
+/// @return The summary, or an error if the model cannot be loaded.
+[[nodiscard]] auto runBatch(const AppConfig& config, std::istream& input, std::ostream& output, int parallel)
+    -> Result<BatchSummary>;
+
+} // namespace mychat
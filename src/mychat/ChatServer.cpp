@@ -0,0 +1,1145 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ChatServer.hpp"
+
+#include <core/Log.hpp>
+#include <llm/ChatSession.hpp>
+#include <llm/LlmEngine.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <unistd.h>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+
+    using nlohmann::json;
+
+    /// @brief Serializes @p value, replacing invalid UTF-8 (e.g. in model output) instead of throwing.
+    auto serialize(json const& value) -> std::string
+    {
+        return value.dump(-1, ' ', false, json::error_handler_t::replace);
+    }
+
+    auto invalidRequest(std::string message) -> std::unexpected<Error>
+    {
+        return makeError(ErrorCode::InvalidArgument, std::move(message));
+    }
+
+    /// @brief Returns the text of an OpenAI message content: a string, null, or an array of parts.
+    auto contentText(json const& content) -> Result<std::string>
+    {
+        if (content.is_null())
+            return std::string {};
+        if (content.is_string())
+            return content.get<std::string>();
+        if (!content.is_array())
+            return invalidRequest("Message content must be a string or an array of parts");
+
+        auto text = std::string {};
+        for (auto const& part: content)
+        {
+            if (!part.is_object() || part.value("type", "") != "text" || !part.contains("text")
+                || !part["text"].is_string())
+                return invalidRequest("Only text content parts are supported");
+            text += part["text"].get<std::string>();
+        }
+        return text;
+    }
+
+    auto parseRole(std::string_view role) -> std::optional<Role>
+    {
+        if (role == "system" || role == "developer")
+            return Role::System;
+        if (role == "user")
+            return Role::User;
+        if (role == "assistant")
+            return Role::Assistant;
+        if (role == "tool")
+            return Role::Tool;
+        return std::nullopt;
+    }
+
+    auto parseToolCall(json const& call) -> Result<ToolCall>
+    {
+        if (!call.is_object() || !call.contains("function") || !call["function"].is_object())
+            return invalidRequest("Tool calls must have a \"function\" object");
+        auto const& function = call["function"];
+        if (!function.contains("name") || !function["name"].is_string())
+            return invalidRequest("Tool calls must name their function");
+
+        auto parsed = ToolCall {
+            .id = call.value("id", ""),
+            .name = function["name"].get<std::string>(),
+            .arguments = json::object(),
+        };
+        // OpenAI sends the arguments as a JSON string; arguments that do not parse are kept as is.
+        if (auto const arguments = function.find("arguments"); arguments != function.end())
+        {
+            if (arguments->is_string())
+            {
+                auto decoded = json::parse(arguments->get<std::string>(), nullptr, false);
+                parsed.arguments = decoded.is_discarded() ? *arguments : std::move(decoded);
+            }
+            else if (arguments->is_object())
+                parsed.arguments = *arguments;
+        }
+        return parsed;
+    }
+
+    auto parseMessage(json const& message, size_t index) -> Result<ChatMessage>
+    {
+        if (!message.is_object())
+            return invalidRequest(std::format("messages[{}] is not an object", index));
+        auto const role = parseRole(message.value("role", ""));
+        if (!role)
+            return invalidRequest(std::format("messages[{}] has an unknown role", index));
+        auto content = contentText(message.value("content", json()));
+        if (!content)
+            return invalidRequest(std::format("messages[{}]: {}", index, content.error().message));
+
+        auto parsed = ChatMessage {
+            .role = *role,
+            .content = std::move(*content),
+            .toolCalls = {},
+            .toolCallId = {},
+        };
+        if (auto const calls = message.find("tool_calls"); *role == Role::Assistant && calls != message.end())
+        {
+            if (!calls->is_array())
+                return invalidRequest(std::format("messages[{}].tool_calls is not an array", index));
+            for (auto const& call: *calls)
+            {
+                auto toolCall = parseToolCall(call);
+                if (!toolCall)
+                    return invalidRequest(std::format("messages[{}]: {}", index, toolCall.error().message));
+                parsed.toolCalls.push_back(std::move(*toolCall));
+            }
+        }
+        if (*role == Role::Tool)
+        {
+            auto const callId = message.find("tool_call_id");
+            if (callId == message.end() || !callId->is_string())
+                return invalidRequest(std::format("messages[{}] lacks a \"tool_call_id\"", index));
+            parsed.toolCallId = callId->get<std::string>();
+        }
+        return parsed;
+    }
+
+    auto parseTool(json const& tool, size_t index) -> Result<ToolDefinition>
+    {
+        if (!tool.is_object() || tool.value("type", "function") != "function" || !tool.contains("function")
+            || !tool["function"].is_object())
+            return invalidRequest(std::format("tools[{}] is not a function tool", index));
+        auto const& function = tool["function"];
+        if (!function.contains("name") || !function["name"].is_string())
+            return invalidRequest(std::format("tools[{}] lacks a name", index));
+        return ToolDefinition {
+            .name = function["name"].get<std::string>(),
+            .description = function.value("description", ""),
+            .inputSchema =
+                function.value("parameters", json { { "type", "object" }, { "properties", json::object() } }),
+        };
+    }
+
+    /// @brief Reads the optional number @p name of @p body into @p value.
+    template <typename T>
+    auto readNumber(json const& body, std::string_view name, T& value) -> VoidResult
+    {
+        auto const field = body.find(name);
+        if (field == body.end() || field->is_null())
+            return {};
+        if (!field->is_number())
+            return invalidRequest(std::format("\"{}\" must be a number", name));
+        value = field->get<T>();
+        return {};
+    }
+
+    auto toolCallsJson(std::span<const ToolCall> calls, bool indexed) -> json
+    {
+        auto array = json::array();
+        for (auto i = size_t { 0 }; i < calls.size(); ++i)
+        {
+            auto const& call = calls[i];
+            auto arguments =
+                call.arguments.is_string() ? call.arguments.get<std::string>() : serialize(call.arguments);
+            auto entry = json {
+                { "id", call.id },
+                { "type", "function" },
+                { "function",
+                  {
+                      { "name", call.name },
+                      { "arguments", std::move(arguments) },
+                  } },
+            };
+            // Streamed deltas identify the call they extend by its index.
+            if (indexed)
+                entry["index"] = i;
+            array.push_back(std::move(entry));
+        }
+        return array;
+    }
+
+    auto usageJson(GenerateMetrics const& metrics) -> json
+    {
+        return {
+            { "prompt_tokens", metrics.promptTokens },
+            { "completion_tokens", metrics.generatedTokens },
+            { "total_tokens", metrics.promptTokens + metrics.generatedTokens },
+            { "prompt_tokens_details", { { "cached_tokens", metrics.reusedTokens } } },
+        };
+    }
+
+} // namespace
+
+auto parseChatCompletionRequest(const nlohmann::json& body, const SamplerConfig& defaults)
+    -> Result<ChatCompletionRequest>
+{
+    if (!body.is_object())
+        return invalidRequest("The request body must be a JSON object");
+
+    auto request = ChatCompletionRequest {};
+    request.sampler = defaults;
+
+    auto const messages = body.find("messages");
+    if (messages == body.end() || !messages->is_array() || messages->empty())
+        return invalidRequest("\"messages\" must be a non-empty array");
+    for (auto i = size_t { 0 }; i < messages->size(); ++i)
+    {
+        auto message = parseMessage((*messages)[i], i);
+        if (!message)
+            return std::unexpected(message.error());
+        request.messages.push_back(std::move(*message));
+    }
+
+    if (auto const tools = body.find("tools"); tools != body.end() && !tools->is_null())
+    {
+        if (!tools->is_array())
+            return invalidRequest("\"tools\" must be an array");
+        for (auto i = size_t { 0 }; i < tools->size(); ++i)
+        {
+            auto tool = parseTool((*tools)[i], i);
+            if (!tool)
+                return std::unexpected(tool.error());
+            request.tools.push_back(std::move(*tool));
+        }
+    }
+    // Without client tools, the agent loop answers the last message as the user's new input.
+    if (request.tools.empty() && request.messages.back().role != Role::User)
+        return invalidRequest("Without \"tools\", the last message must come from the user");
+
+    for (auto const& [name, value]: { std::pair { "temperature", &request.sampler.temperature },
+                                      std::pair { "top_p", &request.sampler.topP },
+                                      std::pair { "frequency_penalty", &request.sampler.frequencyPenalty },
+                                      std::pair { "presence_penalty", &request.sampler.presencePenalty } })
+        if (auto read = readNumber(body, name, *value); !read)
+            return std::unexpected(read.error());
+    if (auto read = readNumber(body, "seed", request.sampler.seed); !read)
+        return std::unexpected(read.error());
+    if (auto read = readNumber(body, "max_tokens", request.maxTokens); !read)
+        return std::unexpected(read.error());
+    if (auto read = readNumber(body, "max_completion_tokens", request.maxTokens); !read)
+        return std::unexpected(read.error());
+    if (request.maxTokens < 0)
+        return invalidRequest("\"max_tokens\" must not be negative");
+
+    if (auto const stream = body.find("stream"); stream != body.end() && !stream->is_null())
+    {
+        if (!stream->is_boolean())
+            return invalidRequest("\"stream\" must be a boolean");
+        request.stream = stream->get<bool>();
+    }
+    if (auto const options = body.find("stream_options"); options != body.end() && options->is_object())
+        request.streamUsage = options->value("include_usage", false);
+    return request;
+}
+
+auto chatCompletionJson(const ChatCompletion& completion,
+                        std::string_view id,
+                        std::string_view model,
+                        std::int64_t created) -> nlohmann::json
+{
+    // Like OpenAI, a message that only calls tools has null content.
+    auto const toolCallsOnly = completion.text.empty() && !completion.toolCalls.empty();
+    auto message = json {
+        { "role", "assistant" },
+        { "content", toolCallsOnly ? json() : json(completion.text) },
+    };
+    if (!completion.toolCalls.empty())
+        message["tool_calls"] = toolCallsJson(completion.toolCalls, false);
+    return {
+        { "id", id },
+        { "object", "chat.completion" },
+        { "created", created },
+        { "model", model },
+        { "choices",
+          json::array({ {
+              { "index", 0 },
+              { "message", std::move(message) },
+              { "finish_reason", completion.finishReason },
+          } }) },
+        { "usage", usageJson(completion.metrics) },
+    };
+}
+
+auto chatCompletionChunkJson(std::string_view id,
+                             std::string_view model,
+                             std::int64_t created,
+                             nlohmann::json delta,
+                             std::optional<std::string_view> finishReason) -> nlohmann::json
+{
+    return {
+        { "id", id },
+        { "object", "chat.completion.chunk" },
+        { "created", created },
+        { "model", model },
+        { "choices",
+          json::array({ {
+              { "index", 0 },
+              { "delta", std::move(delta) },
+              { "finish_reason", finishReason ? json(*finishReason) : json() },
+          } }) },
+    };
+}
+
+#ifdef _WIN32
+
+struct ChatServer::Impl
+{
+};
+
+ChatServer::ChatServer(InferenceEngine& /*engine*/,
+                       ServerManager& /*servers*/,
+                       AgentConfig /*agentConfig*/,
+                       ChatServerConfig /*config*/):
+    _impl(std::make_unique<Impl>())
+{
+}
+
+ChatServer::ChatServer(std::span<InferenceEngine* const> /*engines*/,
+                       ServerManager& /*servers*/,
+                       AgentConfig /*agentConfig*/,
+                       ChatServerConfig /*config*/):
+    _impl(std::make_unique<Impl>())
+{
+}
+
+ChatServer::~ChatServer() = default;
+
+auto ChatServer::start() -> VoidResult
+{
+    return makeError(ErrorCode::TransportError, "mychat --serve is not supported on Windows yet");
+}
+
+void ChatServer::stop()
+{
+}
+
+auto ChatServer::port() const -> int
+{
+    return 0;
+}
+
+auto ChatServer::queuedRequests() const -> size_t
+{
+    return 0;
+}
+
+#else
+
+namespace
+{
+
+    using namespace std::chrono_literals;
+
+    constexpr auto MaxHeaderBytes = size_t { 64 } << 10;
+    constexpr auto MaxBodyBytes = size_t { 16 } << 20;
+    constexpr auto ClientTimeout = std::chrono::seconds(30); ///< For reading the request and each write.
+    constexpr auto DisconnectPollInterval = 200ms;
+
+    struct HttpRequest
+    {
+        std::string method;
+        std::string target; ///< Without the query string.
+        std::map<std::string, std::string, std::less<>> headers; ///< Names in lower case.
+        std::string body;
+    };
+
+    /// @brief Why a request could not be read; status 0 means the client is gone.
+    struct HttpError
+    {
+        int status = 0;
+        std::string message;
+    };
+
+    auto statusText(int status) -> std::string_view
+    {
+        switch (status)
+        {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 411: return "Length Required";
+            case 413: return "Payload Too Large";
+            case 431: return "Request Header Fields Too Large";
+            case 503: return "Service Unavailable";
+            default: return "Internal Server Error";
+        }
+    }
+
+    auto sendAll(int socket, std::string_view data) -> bool
+    {
+        while (!data.empty())
+        {
+    #ifdef MSG_NOSIGNAL
+            auto const written = ::send(socket, data.data(), data.size(), MSG_NOSIGNAL);
+    #else
+            auto const written = ::send(socket, data.data(), data.size(), 0);
+    #endif
+            if (written >= 0)
+                data.remove_prefix(static_cast<size_t>(written));
+            else if (errno != EINTR)
+                return false;
+        }
+        return true;
+    }
+
+    auto sendJson(int socket, int status, json const& body) -> bool
+    {
+        auto const text = serialize(body);
+        return sendAll(socket,
+                       std::format("HTTP/1.1 {} {}\r\nContent-Type: application/json\r\n"
+                                   "Content-Length: {}\r\nConnection: close\r\n\r\n{}",
+                                   status,
+                                   statusText(status),
+                                   text.size(),
+                                   text));
+    }
+
+    auto errorJson(std::string_view message, int status) -> json
+    {
+        auto const type = status == 400 ? "invalid_request_error" : "server_error";
+        return { { "error", { { "message", message }, { "type", type } } } };
+    }
+
+    auto sendError(int socket, int status, std::string_view message) -> bool
+    {
+        return sendJson(socket, status, errorJson(message, status));
+    }
+
+    auto statusOf(Error const& error) -> int
+    {
+        return error.code == ErrorCode::InvalidArgument ? 400 : 500;
+    }
+
+    auto readRequest(int socket) -> std::expected<HttpRequest, HttpError>
+    {
+        auto buffer = std::string {};
+        auto chunk = std::array<char, 8192> {};
+        auto const receive = [&]() -> bool {
+            while (true)
+            {
+                auto const bytesRead = ::recv(socket, chunk.data(), chunk.size(), 0);
+                if (bytesRead < 0 && errno == EINTR)
+                    continue;
+                if (bytesRead <= 0)
+                    return false;
+                buffer.append(chunk.data(), static_cast<size_t>(bytesRead));
+                return true;
+            }
+        };
+
+        auto headEnd = std::string::npos;
+        while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (buffer.size() > MaxHeaderBytes)
+                return std::unexpected(HttpError { 431, "Request header too large" });
+            if (!receive())
+                return std::unexpected(HttpError {});
+        }
+
+        auto request = HttpRequest {};
+        auto head = std::string_view(buffer).substr(0, headEnd);
+        auto const lineEnd = head.find("\r\n");
+        auto const requestLine = head.substr(0, lineEnd);
+        auto const methodEnd = requestLine.find(' ');
+        auto const targetEnd = requestLine.find(' ', methodEnd + 1);
+        if (methodEnd == std::string_view::npos || targetEnd == std::string_view::npos
+            || !requestLine.substr(targetEnd + 1).starts_with("HTTP/1."))
+            return std::unexpected(HttpError { 400, "Malformed request line" });
+        request.method = requestLine.substr(0, methodEnd);
+        request.target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+        request.target = request.target.substr(0, request.target.find('?'));
+
+        head.remove_prefix(lineEnd == std::string_view::npos ? head.size() : lineEnd + 2);
+        while (!head.empty())
+        {
+            auto const end = head.find("\r\n");
+            auto const line = head.substr(0, end);
+            head.remove_prefix(end == std::string_view::npos ? head.size() : end + 2);
+            auto const colon = line.find(':');
+            if (colon == std::string_view::npos)
+                return std::unexpected(HttpError { 400, "Malformed header line" });
+            auto name = std::string(line.substr(0, colon));
+            std::ranges::transform(name, name.begin(), [](unsigned char c) { return std::tolower(c); });
+            auto value = line.substr(colon + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+            value = value.substr(0, value.find_last_not_of(" \t") + 1);
+            request.headers[std::move(name)] = value;
+        }
+
+        if (request.headers.contains("transfer-encoding"))
+            return std::unexpected(HttpError { 411, "Chunked request bodies are not supported" });
+        auto contentLength = size_t { 0 };
+        if (auto const length = request.headers.find("content-length"); length != request.headers.end())
+        {
+            auto const& text = length->second;
+            auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), contentLength);
+            if (error != std::errc {} || end != text.data() + text.size())
+                return std::unexpected(HttpError { 400, "Malformed Content-Length" });
+        }
+        if (contentLength > MaxBodyBytes)
+            return std::unexpected(HttpError { 413, "Request body too large" });
+
+        // curl waits a moment for this before sending bodies above 1 KiB.
+        if (auto const expect = request.headers.find("expect");
+            expect != request.headers.end() && expect->second == "100-continue")
+            (void) sendAll(socket, "HTTP/1.1 100 Continue\r\n\r\n");
+
+        buffer.erase(0, headEnd + 4);
+        while (buffer.size() < contentLength)
+            if (!receive())
+                return std::unexpected(HttpError {});
+        buffer.resize(contentLength);
+        request.body = std::move(buffer);
+        return request;
+    }
+
+    /// @brief Returns true if the client has closed the connection.
+    auto peerClosed(int socket) -> bool
+    {
+        auto fd = pollfd { .fd = socket, .events = POLLIN, .revents = 0 };
+        if (::poll(&fd, 1, 0) <= 0)
+            return false;
+        if ((fd.revents & (POLLHUP | POLLERR)) != 0)
+            return true;
+        auto byte = char {};
+        return ::recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+    }
+
+    auto unixTime() -> std::int64_t
+    {
+        auto const now = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+    }
+
+    /// @brief A request waiting for or being answered by an inference thread.
+    struct Job
+    {
+        ChatCompletionRequest request;
+        AgentStreamCallback onToken; ///< Called on an inference thread with each streamed piece.
+        std::stop_source stop;       ///< Requested when the client disconnects or the server stops.
+        std::promise<Result<ChatCompletion>> done;
+    };
+
+} // namespace
+
+struct ChatServer::Impl
+{
+    /// @brief A connected client and the thread answering its request.
+    struct Client
+    {
+        int socket = -1; ///< Closed by the thread when done; guarded by Impl::mutex.
+        std::jthread thread;
+        std::atomic<bool> finished = false;
+    };
+
+    /// @brief An inference thread and the engine it answers requests with.
+    struct Worker
+    {
+        Worker(InferenceEngine& workerEngine,
+               ServerManager& servers,
+               AgentConfig agentConfig,
+               ChatServerConfig const& config):
+            engine(workerEngine),
+            session(config.systemPrompt),
+            agent(engine, session, servers, std::move(agentConfig))
+        {
+            session.setOverflowPolicy(config.contextOverflow);
+        }
+
+        InferenceEngine& engine;
+        ChatSession session; ///< The conversation of the request the agent loop answers.
+        AgentLoop agent;
+        std::shared_ptr<Job> running; ///< Guarded by Impl::mutex.
+        std::jthread thread;
+    };
+
+    Impl(std::span<InferenceEngine* const> engines,
+         ServerManager& servers,
+         AgentConfig agentConfig,
+         ChatServerConfig serverConfig):
+        config(std::move(serverConfig)),
+        defaultSampler(agentConfig.sampler)
+    {
+        for (auto* engine: engines)
+        {
+            workers.emplace_back(*engine, servers, agentConfig, config);
+            // Workers would race writing it; the others embed the tools themselves.
+            agentConfig.toolIndexPath.clear();
+        }
+    }
+
+    ChatServerConfig config;
+    SamplerConfig defaultSampler;
+    std::list<Worker> workers;
+
+    int listener = -1;
+    int wakeRead = -1; ///< Becomes readable when stop() is called, waking the acceptor.
+    int wakeWrite = -1;
+    int boundPort = 0;
+    std::atomic<std::uint64_t> lastId = 0;
+    std::jthread acceptor;
+
+    mutable std::mutex mutex; ///< Guards the members below and Worker::running.
+    std::condition_variable_any queueChanged;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::list<Client> clients;
+    bool stopping = false;
+
+    void acceptLoop()
+    {
+        while (true)
+        {
+            auto fds = std::array {
+                pollfd { .fd = listener, .events = POLLIN, .revents = 0 },
+                pollfd { .fd = wakeRead, .events = POLLIN, .revents = 0 },
+            };
+            if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+                return;
+            if (fds[1].revents != 0)
+                return;
+            if (fds[0].revents == 0)
+                continue;
+
+            auto const socket = ::accept(listener, nullptr, nullptr);
+            if (socket < 0)
+                continue;
+            fcntl(socket, F_SETFD, FD_CLOEXEC);
+            auto const timeout = timeval { .tv_sec = ClientTimeout.count(), .tv_usec = 0 };
+            setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    #ifdef SO_NOSIGPIPE
+            auto const noSigPipe = 1;
+            setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+    #endif
+
+            auto const lock = std::lock_guard(mutex);
+            clients.remove_if([](Client const& client) { return client.finished.load(); });
+            auto& client = clients.emplace_back();
+            client.socket = socket;
+            client.thread = std::jthread([this, &client, socket] {
+                serve(socket);
+                {
+                    auto const clientLock = std::lock_guard(mutex);
+                    ::close(std::exchange(client.socket, -1));
+                }
+                client.finished = true;
+            });
+        }
+    }
+
+    /// @brief Answers the one request of a connection.
+    void serve(int socket)
+    {
+        auto request = readRequest(socket);
+        if (!request)
+        {
+            if (request.error().status != 0)
+                (void) sendError(socket, request.error().status, request.error().message);
+            return;
+        }
+
+        auto const allowed = [&](std::string_view method) {
+            if (request->method == method)
+                return true;
+            (void) sendError(socket, 405, std::format("Use {} for {}", method, request->target));
+            return false;
+        };
+        if (request->target == "/v1/chat/completions")
+        {
+            if (allowed("POST"))
+                answerCompletion(socket, *request);
+        }
+        else if (request->target == "/v1/models")
+        {
+            if (allowed("GET"))
+                (void) sendJson(socket,
+                                200,
+                                { { "object", "list" },
+                                  { "data",
+                                    json::array({ {
+                                        { "id", config.modelName },
+                                        { "object", "model" },
+                                        { "created", 0 },
+                                        { "owned_by", "mychat" },
+                                    } }) } });
+        }
+        else if (request->target == "/health")
+        {
+            if (allowed("GET"))
+            {
+                auto queued = size_t { 0 };
+                {
+                    auto const lock = std::lock_guard(mutex);
+                    queued = queue.size();
+                }
+                (void) sendJson(socket, 200, { { "status", "ok" }, { "queued", queued } });
+            }
+        }
+        else
+            (void) sendError(socket, 404, std::format("No such endpoint: {}", request->target));
+    }
+
+    void answerCompletion(int socket, HttpRequest const& httpRequest)
+    {
+        auto const body = json::parse(httpRequest.body, nullptr, false);
+        if (body.is_discarded())
+        {
+            (void) sendError(socket, 400, "The request body is not valid JSON");
+            return;
+        }
+        auto request = parseChatCompletionRequest(body, defaultSampler);
+        if (!request)
+        {
+            (void) sendError(socket, 400, request.error().message);
+            return;
+        }
+
+        auto const id = std::format("chatcmpl-{}", ++lastId);
+        auto const created = unixTime();
+        auto const& model = config.modelName;
+        auto const stream = request->stream;
+        auto const streamUsage = request->streamUsage;
+        auto job = std::make_shared<Job>();
+        job->request = std::move(*request);
+
+        // Streamed responses start with the first token, so a full queue can still be refused with 503.
+        auto headersSent = false;
+        auto connected = true;
+        auto const event = [](json const& chunk) {
+            return std::format("data: {}\n\n", serialize(chunk));
+        };
+        auto const emit = [&](std::string_view events) {
+            if (!connected)
+                return;
+            auto text = std::string {};
+            if (!headersSent)
+            {
+                text = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                       "Connection: close\r\n\r\n";
+                auto const role = json { { "role", "assistant" }, { "content", "" } };
+                text += event(chatCompletionChunkJson(id, model, created, role));
+                headersSent = true;
+            }
+            text += events;
+            if (!sendAll(socket, text))
+            {
+                connected = false;
+                job->stop.request_stop();
+            }
+        };
+        if (stream)
+            job->onToken = [&](std::string_view piece) {
+                emit(event(chatCompletionChunkJson(id, model, created, { { "content", piece } })));
+            };
+
+        auto done = job->done.get_future();
+        if (auto queued = enqueue(job); !queued)
+        {
+            (void) sendError(socket, 503, queued.error().message);
+            return;
+        }
+        log::debug("{}: {} message(s), {} client tool(s)",
+                   id,
+                   job->request.messages.size(),
+                   job->request.tools.size());
+
+        while (done.wait_for(DisconnectPollInterval) != std::future_status::ready)
+            if (!job->stop.stop_requested() && peerClosed(socket))
+            {
+                log::info("{}: client disconnected, cancelling", id);
+                job->stop.request_stop();
+            }
+
+        auto const result = done.get();
+        if (result)
+            log::info("{}: {} prompt tokens ({} cached), {} generated, finish reason {}",
+                      id,
+                      result->metrics.promptTokens,
+                      result->metrics.reusedTokens,
+                      result->metrics.generatedTokens,
+                      result->finishReason);
+        else
+            log::info("{}: {}", id, result.error().message);
+
+        if (!stream || (!result && !headersSent))
+        {
+            if (result)
+                (void) sendJson(socket, 200, chatCompletionJson(*result, id, model, created));
+            else
+                (void) sendError(socket, statusOf(result.error()), result.error().message);
+            return;
+        }
+        if (!result)
+        {
+            emit(event(errorJson(result.error().message, statusOf(result.error()))) + "data: [DONE]\n\n");
+            return;
+        }
+
+        auto events = std::string {};
+        if (!result->toolCalls.empty())
+            events += event(chatCompletionChunkJson(
+                id, model, created, { { "tool_calls", toolCallsJson(result->toolCalls, true) } }));
+        events += event(chatCompletionChunkJson(id, model, created, json::object(), result->finishReason));
+        if (streamUsage)
+        {
+            auto usage = chatCompletionChunkJson(id, model, created, json::object());
+            usage["choices"] = json::array();
+            usage["usage"] = usageJson(result->metrics);
+            events += event(usage);
+        }
+        events += "data: [DONE]\n\n";
+        emit(events);
+    }
+
+    auto enqueue(std::shared_ptr<Job> job) -> VoidResult
+    {
+        {
+            auto const lock = std::lock_guard(mutex);
+            if (stopping)
+                return makeError(ErrorCode::InferenceError, "The server is shutting down");
+            if (queue.size() >= config.maxQueuedRequests)
+                return makeError(ErrorCode::InferenceError,
+                                 std::format("{} requests are waiting; try again later", queue.size()));
+            queue.push_back(std::move(job));
+        }
+        queueChanged.notify_one();
+        return {};
+    }
+
+    /// @brief Answers queued requests with @p worker's engine one after another, until stop is requested.
+    void inferenceLoop(Worker& worker, std::stop_token stopToken)
+    {
+        while (true)
+        {
+            auto job = std::shared_ptr<Job> {};
+            {
+                auto lock = std::unique_lock(mutex);
+                if (!queueChanged.wait(lock, stopToken, [&] { return !queue.empty(); }))
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+                worker.running = job;
+            }
+            auto result = Result<ChatCompletion> {};
+            if (job->stop.stop_requested())
+                result = makeError(ErrorCode::InferenceError, "Request cancelled");
+            else
+                result = complete(worker, *job);
+            {
+                auto const lock = std::lock_guard(mutex);
+                worker.running.reset();
+            }
+            job->done.set_value(std::move(result));
+        }
+    }
+
+    auto complete(Worker& worker, Job& job) -> Result<ChatCompletion>
+    {
+        auto& session = worker.session;
+        auto& agent = worker.agent;
+        auto const& request = job.request;
+        auto const stopToken = job.stop.get_token();
+        auto pieces = 0;
+        auto truncated = false;
+        auto const stream = [&](std::string_view piece) {
+            if (truncated)
+                return;
+            if (job.onToken)
+                job.onToken(piece);
+            if (request.maxTokens > 0 && ++pieces >= request.maxTokens)
+            {
+                truncated = true;
+                job.stop.request_stop();
+            }
+        };
+
+        auto completion = ChatCompletion {};
+        if (!request.tools.empty())
+        {
+            // The same system prompt for every request that brings none, so its KV cache is reused.
+            auto messages = request.messages;
+            if (messages.front().role != Role::System && !config.systemPrompt.empty())
+                messages.insert(messages.begin(),
+                                ChatMessage {
+                                    .role = Role::System,
+                                    .content = config.systemPrompt,
+                                    .toolCalls = {},
+                                    .toolCallId = {},
+                                });
+            worker.engine.setContextOverflowPolicy(config.contextOverflow);
+            auto result =
+                worker.engine.generate(messages, request.tools, request.sampler, stream, {}, stopToken);
+            if (!result)
+                return std::unexpected(result.error());
+            completion.text = std::move(result->text);
+            completion.toolCalls = std::move(result->toolCalls);
+            completion.metrics = result->metrics;
+        }
+        else
+        {
+            // The session becomes the request's conversation, which the agent loop continues.
+            auto systemPrompt = std::string {};
+            for (auto const& message: request.messages)
+                if (message.role == Role::System)
+                    systemPrompt += (systemPrompt.empty() ? "" : "\n\n") + message.content;
+            session.setSystemPrompt(systemPrompt.empty() ? config.systemPrompt : std::move(systemPrompt));
+            for (auto const& message: std::span(request.messages).first(request.messages.size() - 1))
+            {
+                if (message.role == Role::User)
+                    session.addUserMessage(message.content);
+                else if (message.role == Role::Assistant)
+                    session.addAssistantMessage(message.content, message.toolCalls);
+                else if (message.role == Role::Tool)
+                    session.addToolResult(message.toolCallId, message.content);
+            }
+            agent.setSampler(request.sampler);
+            auto reply = agent.processMessage(request.messages.back().content, stream, stopToken);
+            if (!reply)
+                return std::unexpected(reply.error());
+            completion.text = std::move(*reply);
+            completion.metrics = agent.lastTurnMetrics().total;
+        }
+
+        if (job.stop.stop_requested() && !truncated)
+            return makeError(ErrorCode::InferenceError, "Request cancelled");
+        if (!completion.toolCalls.empty())
+            completion.finishReason = "tool_calls";
+        else
+            completion.finishReason = truncated ? "length" : "stop";
+        return completion;
+    }
+};
+
+ChatServer::ChatServer(InferenceEngine& engine,
+                       ServerManager& servers,
+                       AgentConfig agentConfig,
+                       ChatServerConfig config):
+    ChatServer(std::array { &engine }, servers, std::move(agentConfig), std::move(config))
+{
+}
+
+ChatServer::ChatServer(std::span<InferenceEngine* const> engines,
+                       ServerManager& servers,
+                       AgentConfig agentConfig,
+                       ChatServerConfig config):
+    _impl(std::make_unique<Impl>(engines, servers, std::move(agentConfig), std::move(config)))
+{
+}
+
+ChatServer::~ChatServer()
+{
+    stop();
+}
+
+auto ChatServer::start() -> VoidResult
+{
+    if (_impl->listener >= 0)
+        return makeError(ErrorCode::TransportError, "Server already started");
+
+    auto const& config = _impl->config;
+    auto address = sockaddr_in {};
+    address.sin_family = AF_INET;
+    if (config.port < 0 || config.port > 65535)
+        return makeError(ErrorCode::InvalidArgument, std::format("Invalid port: {}", config.port));
+    address.sin_port = htons(static_cast<std::uint16_t>(config.port));
+    if (::inet_pton(AF_INET, config.address.c_str(), &address.sin_addr) != 1)
+        return makeError(ErrorCode::InvalidArgument, std::format("Invalid IPv4 address: {}", config.address));
+
+    auto const fail = [&](std::string_view what) {
+        auto const error = errno;
+        for (auto* fd: { &_impl->listener, &_impl->wakeRead, &_impl->wakeWrite })
+            if (*fd >= 0)
+                ::close(std::exchange(*fd, -1));
+        return makeError(ErrorCode::TransportError, std::format("{} failed: {}", what, strerror(error)));
+    };
+
+    _impl->listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (_impl->listener < 0)
+        return fail("socket");
+    fcntl(_impl->listener, F_SETFD, FD_CLOEXEC);
+    auto const reuse = 1;
+    setsockopt(_impl->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (::bind(_impl->listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0)
+        return fail("bind");
+    if (::listen(_impl->listener, 64) != 0)
+        return fail("listen");
+    auto bound = sockaddr_in {};
+    auto boundSize = socklen_t { sizeof(bound) };
+    if (::getsockname(_impl->listener, reinterpret_cast<sockaddr*>(&bound), &boundSize) != 0)
+        return fail("getsockname");
+    _impl->boundPort = ntohs(bound.sin_port);
+
+    int wakePipe[2];
+    if (::pipe(wakePipe) != 0)
+        return fail("pipe");
+    _impl->wakeRead = wakePipe[0];
+    _impl->wakeWrite = wakePipe[1];
+    fcntl(_impl->wakeRead, F_SETFD, FD_CLOEXEC);
+    fcntl(_impl->wakeWrite, F_SETFD, FD_CLOEXEC);
+
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        _impl->stopping = false;
+    }
+    for (auto& worker: _impl->workers)
+        worker.thread = std::jthread([this, &worker](std::stop_token stopToken) {
+            _impl->inferenceLoop(worker, std::move(stopToken));
+        });
+    _impl->acceptor = std::jthread([this] { _impl->acceptLoop(); });
+    log::info("Serving an OpenAI-compatible API on http://{}:{}/v1", config.address, _impl->boundPort);
+    return {};
+}
+
+void ChatServer::stop()
+{
+    if (_impl->listener < 0)
+        return;
+
+    (void) ::write(_impl->wakeWrite, "x", 1);
+    _impl->acceptor = {};
+
+    // Waiting requests are refused, running ones are cancelled and their clients disconnected.
+    auto clients = std::list<Impl::Client> {};
+    {
+        auto const lock = std::lock_guard(_impl->mutex);
+        _impl->stopping = true;
+        for (auto const& job: _impl->queue)
+            job->done.set_value(makeError(ErrorCode::InferenceError, "The server is shutting down"));
+        _impl->queue.clear();
+        for (auto const& worker: _impl->workers)
+            if (worker.running)
+                worker.running->stop.request_stop();
+        for (auto const& client: _impl->clients)
+            if (client.socket >= 0)
+                ::shutdown(client.socket, SHUT_RDWR);
+        clients.swap(_impl->clients);
+    }
+    for (auto& worker: _impl->workers)
+        worker.thread = {};
+    clients.clear();
+
+    for (auto* fd: { &_impl->listener, &_impl->wakeRead, &_impl->wakeWrite })
+        ::close(std::exchange(*fd, -1));
+    log::info("Chat server stopped");
+}
+
+auto ChatServer::port() const -> int
+{
+    return _impl->boundPort;
+}
+
+auto ChatServer::queuedRequests() const -> size_t
+{
+    auto const lock = std::lock_guard(_impl->mutex);
+    return _impl->queue.size();
+}
+
+#endif
+
+auto serveChat(const AppConfig& config, ChatServerConfig serverConfig) -> VoidResult
+{
+#ifndef _WIN32
+    // Block the termination signals before any thread starts, so only sigwait() below sees them.
+    auto signals = sigset_t {};
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+    auto engineConfig = llmEngineConfig(config.llm);
+    if (engineConfig.modelPath.empty())
+    {
+        auto path = downloadedModelPath();
+        if (!path)
+            return makeError(ErrorCode::ConfigError, "No model configured or downloaded");
+        engineConfig.modelPath = std::move(*path);
+    }
+    // One sequence of the context per parallel request, decoded in shared batches.
+    engineConfig.parallelSequences = static_cast<int>(std::max(serverConfig.parallelRequests, size_t { 1 }));
+    auto engines = std::vector<LlmEngine>(1);
+    if (auto loaded = engines.front().load(engineConfig); !loaded)
+        return loaded;
+    for (auto i = 1; i < engineConfig.parallelSequences; ++i)
+    {
+        auto engine = engines.front().share();
+        if (!engine)
+            return std::unexpected(engine.error());
+        engines.push_back(std::move(*engine));
+    }
+    auto enginePointers = std::vector<InferenceEngine*> {};
+    for (auto& engine: engines)
+        enginePointers.push_back(&engine);
+
+    auto servers = ServerManager();
+    connectMcpServers(config, servers);
+
+    serverConfig.systemPrompt = config.llm.systemPrompt;
+    serverConfig.contextOverflow = config.llm.contextOverflow;
+    auto agentConfig = agentLoopConfig(config, engines.front().modelFingerprint());
+    auto server = ChatServer(enginePointers, servers, std::move(agentConfig), std::move(serverConfig));
+    if (auto started = server.start(); !started)
+        return started;
+
+#ifndef _WIN32
+    auto received = 0;
+    sigwait(&signals, &received);
+    log::info("Received signal {}, shutting down", received);
+#endif
+    server.stop();
+    return {};
+}
+
+} // namespace mychat
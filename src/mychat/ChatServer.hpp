@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <agent/AgentLoop.hpp>
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+#include <llm/InferenceEngine.hpp>
+#include <llm/Sampler.hpp>
+#include <mcp/ServerManager.hpp>
+#include <mychat/Config.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Settings of the OpenAI-compatible HTTP server (see ChatServer).
+struct ChatServerConfig
+{
+    std::string address = "127.0.0.1"; ///< IPv4 address to listen on; there is no authentication.
+    int port = 8080;                    ///< 0 picks a free port, see ChatServer::port().
+    size_t maxQueuedRequests = 16;      ///< Requests waiting for the model beyond this are refused.
+    size_t parallelRequests = 1;        ///< Requests serveChat() answers at the same time.
+    std::string modelName = "mychat";   ///< Reported by /v1/models and in every response.
+    std::string systemPrompt;           ///< Used for requests that do not bring their own.
+    ContextOverflowPolicy contextOverflow = ContextOverflowPolicy::EvictHistory;
+};
+
+/// @brief A parsed /v1/chat/completions request.
+struct ChatCompletionRequest
+{
+    std::vector<ChatMessage> messages;
+    std::vector<ToolDefinition> tools; ///< Tools of the client; empty lets mychat run its MCP tools.
+    SamplerConfig sampler;
+    int maxTokens = 0; ///< Upper bound of the response in streamed pieces, 0 for none.
+    bool stream = false;
+    bool streamUsage = false; ///< Whether a streamed response ends with a usage chunk.
+};
+
+/// @brief Parses the body of a /v1/chat/completions request.
+///
+/// Understands the OpenAI fields mychat can honour: `messages` (text content, assistant
+/// `tool_calls`, `tool` results), `tools` of type "function", `temperature`, `top_p`, `seed`,
+/// `frequency_penalty`, `presence_penalty`, `max_tokens` (or `max_completion_tokens`), `stream`
+/// and `stream_options.include_usage`. Other fields are ignored.
+/// @param body The request body.
+/// @param defaults Sampling settings for the fields the request leaves out.
+/// @return The request, or an InvalidArgument error naming the offending field.
+[[nodiscard]] auto parseChatCompletionRequest(const nlohmann::json& body, const SamplerConfig& defaults)
+    -> Result<ChatCompletionRequest>;
+
+/// @brief The answer to a chat completion request.
+struct ChatCompletion
+{
+    std::string text;
+    std::vector<ToolCall> toolCalls; ///< Calls of client tools, for the client to execute.
+    std::string finishReason;        ///< "stop", "length" or "tool_calls".
+    GenerateMetrics metrics;
+};
+
+/// @brief Returns the `chat.completion` object answering a request that is not streamed.
+[[nodiscard]] auto chatCompletionJson(const ChatCompletion& completion,
+                                      std::string_view id,
+                                      std::string_view model,
+                                      std::int64_t created) -> nlohmann::json;
+
+/// @brief Returns one `chat.completion.chunk` object of a streamed response.
+/// @param delta The change to the message, e.g. `{"content": "..."}`.
+/// @param finishReason Set on the last chunk of the choice.
+[[nodiscard]] auto chatCompletionChunkJson(std::string_view id,
+                                           std::string_view model,
+                                           std::int64_t created,
+                                           nlohmann::json delta,
+                                           std::optional<std::string_view> finishReason = std::nullopt)
+    -> nlohmann::json;
+
+/// @brief Serves the model over an OpenAI-compatible HTTP API, so other tools can share it.
+///
+/// Endpoints:
+///
+/// - `POST /v1/chat/completions`, answered as JSON or, with `"stream": true`, as server-sent
+///   events ending with `data: [DONE]`.
+/// - `GET /v1/models`, listing the one model.
+/// - `GET /health`.
+///
+/// A request that brings `tools` is answered by a single generation; tool calls are returned to
+/// the client in OpenAI's format. A request without tools runs through an AgentLoop instead,
+/// with the tools of the MCP servers, and only the final response is returned.
+///
+/// Each engine generates for one request at a time, and requests are handed to the engines in
+/// the order they arrive; up to ChatServerConfig::maxQueuedRequests wait, later ones get 503. A
+/// request whose client disconnects is cancelled, whether it waits or generates. Requests keep
+/// no state between them, but each engine keeps the KV cache of its previous prompt, so a system
+/// prompt shared between requests is decoded only once per engine (reported as
+/// `usage.prompt_tokens_details.cached_tokens`).
+///
+/// Each connection carries one request (`Connection: close`); request bodies need a
+/// Content-Length.
+class ChatServer
+{
+  public:
+    /// @param engine The model; only used by the server's inference thread while the server runs.
+    /// @param servers The MCP servers offered to requests without tools.
+    /// @param agentConfig Configuration of the agent loop answering requests without tools.
+    /// @param config Server settings.
+    ChatServer(InferenceEngine& engine,
+               ServerManager& servers,
+               AgentConfig agentConfig,
+               ChatServerConfig config);
+
+    /// @brief Answers as many requests at a time as there are @p engines, each on an inference
+    ///        thread of its own; e.g. LlmEngines on the sequences of one context (see LlmEngine::share()).
+    ChatServer(std::span<InferenceEngine* const> engines,
+               ServerManager& servers,
+               AgentConfig agentConfig,
+               ChatServerConfig config);
+    ~ChatServer();
+
+    ChatServer(const ChatServer&) = delete;
+    ChatServer& operator=(const ChatServer&) = delete;
+
+    /// @brief Starts listening and answering requests.
+    /// @return Success, or an error if the address cannot be bound.
+    [[nodiscard]] auto start() -> VoidResult;
+
+    /// @brief Cancels all requests, disconnects all clients and stops listening.
+    void stop();
+
+    /// @brief Returns the port listened on, which differs from the configured one if that was 0.
+    [[nodiscard]] auto port() const -> int;
+
+    /// @brief Returns the number of requests waiting for the model.
+    [[nodiscard]] auto queuedRequests() const -> size_t;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// @brief Loads the model and MCP servers of @p config and serves them until SIGINT or SIGTERM.
+///
+/// The implementation of `mychat --serve`.
+/// @param config The application configuration; an empty model path selects a downloaded model.
+/// @param serverConfig Server settings; the system prompt and overflow policy come from @p config.
+///                     ChatServerConfig::parallelRequests sets the number of sequences of the model.
+/// @return Success after a signal, or an error if the model cannot be loaded or the server started.
+[[nodiscard]] auto serveChat(const AppConfig& config, ChatServerConfig serverConfig) -> VoidResult;
+
+} // namespace mychat
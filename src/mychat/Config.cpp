@@ -3,9 +3,11 @@
 
 #include <core/JsonUtils.hpp>
 #include <core/Log.hpp>
+#include <mcp/McpDaemon.hpp>
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <filesystem>
@@ -59,8 +61,157 @@ namespace
         },
     } };
 
+    /// @brief Reads a KV cache type, warning about (and ignoring) unknown names.
+    auto getKvCacheTypeOr(nlohmann::json const& obj, std::string_view key, KvCacheType defaultValue)
+        -> KvCacheType
+    {
+        auto const name = json::getStringOr(obj, key, std::string(kvCacheTypeName(defaultValue)));
+        if (auto const type = parseKvCacheType(name))
+            return *type;
+        log::warning("Unknown KV cache type '{}' for {}, using {}", name, key, kvCacheTypeName(defaultValue));
+        return defaultValue;
+    }
+
+    /// @brief Reads the flash attention mode ("auto", "on" or "off").
+    auto getFlashAttentionOr(nlohmann::json const& obj, std::string_view key, FlashAttention defaultValue)
+        -> FlashAttention
+    {
+        auto const name = json::getStringOr(obj, key, "");
+        if (name == "on")
+            return FlashAttention::Enabled;
+        if (name == "off")
+            return FlashAttention::Disabled;
+        if (name == "auto")
+            return FlashAttention::Auto;
+        return defaultValue;
+    }
+
+    /// @brief Returns the configuration name of a flash attention mode.
+    auto flashAttentionName(FlashAttention mode) -> std::string_view
+    {
+        switch (mode)
+        {
+            case FlashAttention::Enabled: return "on";
+            case FlashAttention::Disabled: return "off";
+            case FlashAttention::Auto: break;
+        }
+        return "auto";
+    }
+
+    /// @brief Downloads @p url to @p path for downloadModel() and friends.
+    /// @param what Names the file in log and error messages.
+    /// @param onProgress Receives the progress; a console progress line if empty.
+    /// @param stopToken Aborts the download.
+    auto fetchModelFile(std::string_view what,
+                        std::string_view url,
+                        std::string const& path,
+                        DownloadProgressCallback onProgress,
+                        std::stop_token stopToken = {}) -> VoidResult
+    {
+        log::info("Downloading {} to {}", what, path);
+        auto options = DownloadOptions {};
+        options.onProgress = onProgress ? std::move(onProgress) : consoleDownloadProgress();
+        options.stopToken = std::move(stopToken);
+        if (auto downloaded = downloadFile(std::string(url), path, options); !downloaded)
+            return makeError(ErrorCode::DownloadError,
+                             std::format("Failed to download {}: {}", what, downloaded.error().message));
+        return {};
+    }
+
 } // namespace
 
+auto llmEngineConfig(const LlmConfig& llm) -> LlmEngineConfig
+{
+    return LlmEngineConfig {
+        .modelPath = llm.modelPath,
+        .contextSize = llm.contextSize,
+        .gpuLayers = llm.gpuLayers,
+        .threads = llm.threads,
+        .batchSize = llm.batchSize,
+        .ubatchSize = llm.ubatchSize,
+        .draftModelPath = llm.draftModelPath,
+        .draftMaxTokens = llm.draftMaxTokens,
+        .promptLookup = llm.promptLookup,
+        .promptLookupNgram = llm.promptLookupNgram,
+        .kvCacheTypeK = llm.kvCacheTypeK,
+        .kvCacheTypeV = llm.kvCacheTypeV,
+        .flashAttention = llm.flashAttention,
+        .useMmap = llm.useMmap,
+        .useMlock = llm.useMlock,
+        .offloadKqv = llm.offloadKqv,
+        .toolPreambleTokenBudget = llm.toolPreambleTokenBudget,
+    };
+}
+
+auto samplerConfig(const LlmConfig& llm) -> SamplerConfig
+{
+    return SamplerConfig {
+        .temperature = llm.temperature,
+        .topP = llm.topP,
+        .topK = llm.topK,
+        .minP = llm.minP,
+        .repeatPenalty = llm.repeatPenalty,
+        .repeatLastN = llm.repeatLastN,
+        .dryMultiplier = llm.dryMultiplier,
+        .xtcProbability = llm.xtcProbability,
+    };
+}
+
+auto llmEngineConfig(const LlmConfig& llm, std::string_view modelPath) -> LlmEngineConfig
+{
+    auto config = llmEngineConfig(llm);
+    config.modelPath = std::string(modelPath);
+    config.draftModelPath.clear();
+    return config;
+}
+
+auto toolIndexPath(std::string_view modelFingerprint) -> std::filesystem::path
+{
+    return std::filesystem::path(defaultDataDir()) / "tool-index" / std::format("{}.index", modelFingerprint);
+}
+
+auto memoryIndexPath(std::string_view modelFingerprint) -> std::filesystem::path
+{
+    return std::filesystem::path(defaultDataDir()) / "memory" / std::format("{}.index", modelFingerprint);
+}
+
+auto agentLoopConfig(const AppConfig& config, std::string_view modelFingerprint) -> AgentConfig
+{
+    return AgentConfig {
+        .maxToolSteps = config.agent.maxToolSteps,
+        .maxRetries = config.agent.maxRetries,
+        .sampler = samplerConfig(config.llm),
+        .maxParallelToolCalls = config.agent.maxParallelToolCalls,
+        .toolCacheCapacity = config.agent.toolCacheCapacity,
+        .toolRetrievalTopK = config.agent.toolRetrievalTopK,
+        .toolIndexPath = toolIndexPath(modelFingerprint),
+        .memorySnippets = config.agent.memorySnippets,
+        .memoryMinSimilarity = config.agent.memoryMinSimilarity,
+        .maxToolResultBytes = static_cast<size_t>(std::max(0, config.agent.maxToolResultBytes)),
+        .toolResultRecencyTurns = config.agent.toolResultRecencyTurns,
+        .compactionTokenThreshold = static_cast<size_t>(std::max(0, config.agent.compactionTokenThreshold)),
+        .compactedToolResultBytes = static_cast<size_t>(std::max(0, config.agent.compactedToolResultBytes)),
+        .summarizeToolResults = config.agent.summarizeToolResults,
+    };
+}
+
+void connectMcpServers(const AppConfig& config, ServerManager& servers)
+{
+    servers.setManifestDirectory(std::filesystem::path(defaultDataDir()) / "mcp-manifests");
+    if (config.useMcpDaemon)
+        servers.setDaemonSocket(config.mcpDaemonSocket.empty() ? defaultMcpDaemonSocketPath()
+                                                               : config.mcpDaemonSocket);
+    auto serverConfigs = std::vector<McpServerConfig> {};
+    for (const auto& [name, serverConfig]: config.mcpServers)
+        serverConfigs.push_back(serverConfig);
+    auto const results = servers.addServers(serverConfigs);
+    for (auto i = size_t { 0 }; i < results.size(); ++i)
+        if (!results[i])
+            log::warning("Failed to connect MCP server '{}': {}",
+                         serverConfigs[i].name,
+                         results[i].error().message);
+}
+
 auto defaultConfigDir() -> std::string
 {
 #ifdef _WIN32
@@ -156,9 +307,43 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
         config.llm.modelPath = json::getStringOr(llm, "modelPath", "");
         config.llm.contextSize = json::getIntOr(llm, "contextSize", 8192);
         config.llm.gpuLayers = json::getIntOr(llm, "gpuLayers", -1);
+        config.llm.batchSize = json::getIntOr(llm, "batchSize", 0);
+        config.llm.ubatchSize = json::getIntOr(llm, "ubatchSize", 0);
+        config.llm.threads = json::getIntOr(llm, "threads", 0);
         config.llm.temperature = json::getFloatOr(llm, "temperature", 0.7f);
+        config.llm.topP = json::getFloatOr(llm, "topP", 0.9f);
+        config.llm.topK = json::getIntOr(llm, "topK", 40);
+        config.llm.minP = json::getFloatOr(llm, "minP", 0.05f);
+        config.llm.repeatPenalty = json::getFloatOr(llm, "repeatPenalty", 1.1f);
+        config.llm.repeatLastN = json::getIntOr(llm, "repeatLastN", 64);
+        config.llm.dryMultiplier = json::getFloatOr(llm, "dryMultiplier", 0.f);
+        config.llm.xtcProbability = json::getFloatOr(llm, "xtcProbability", 0.f);
         config.llm.systemPrompt =
             json::getStringOr(llm, "systemPrompt", "You are a helpful assistant with access to tools.");
+        config.llm.draftModelPath = json::getStringOr(llm, "draftModelPath", "");
+        config.llm.draftMaxTokens = json::getIntOr(llm, "draftMaxTokens", 8);
+        config.llm.promptLookup = json::getBoolOr(llm, "promptLookup", false);
+        config.llm.promptLookupNgram = json::getIntOr(llm, "promptLookupNgram", 3);
+        if (llm.contains("models") && llm["models"].is_object())
+        {
+            for (auto const& [name, modelPath]: llm["models"].items())
+                if (modelPath.is_string())
+                    config.llm.models[name] = modelPath.get<std::string>();
+        }
+        config.llm.modelPoolMb = std::max(0, json::getIntOr(llm, "modelPoolMb", 0));
+        config.llm.toolSelectionModel = json::getStringOr(llm, "toolSelectionModel", "");
+        config.llm.kvCacheTypeK = getKvCacheTypeOr(llm, "kvCacheTypeK", KvCacheType::F16);
+        config.llm.kvCacheTypeV = getKvCacheTypeOr(llm, "kvCacheTypeV", KvCacheType::F16);
+        config.llm.flashAttention = getFlashAttentionOr(llm, "flashAttention", FlashAttention::Auto);
+        config.llm.useMmap = json::getBoolOr(llm, "useMmap", true);
+        config.llm.useMlock = json::getBoolOr(llm, "useMlock", false);
+        config.llm.offloadKqv = json::getBoolOr(llm, "offloadKqv", true);
+        config.llm.toolPreambleTokenBudget = json::getIntOr(llm, "toolPreambleTokenBudget", 2048);
+        config.llm.persistKvState = json::getBoolOr(llm, "persistKvState", true);
+        config.llm.speculativePrefill = json::getBoolOr(llm, "speculativePrefill", true);
+        config.llm.contextOverflow = json::getStringOr(llm, "contextOverflow", "shift") == "evict"
+                                         ? ContextOverflowPolicy::EvictHistory
+                                         : ContextOverflowPolicy::ShiftKv;
     }
 
     // Audio section
@@ -174,6 +359,16 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
         auto const modeStr = json::getStringOr(audio, "mode", "push-to-talk");
         config.audio.mode = (modeStr == "vad") ? VoiceMode::Vad : VoiceMode::PushToTalk;
         config.audio.muteWhileSpeaking = json::getBoolOr(audio, "muteWhileSpeaking", true);
+        config.audio.bargeIn = json::getBoolOr(audio, "bargeIn", false);
+        config.audio.silenceDurationMs = json::getIntOr(audio, "silenceDurationMs", 500);
+        config.audio.partialIntervalMs = json::getIntOr(audio, "partialIntervalMs", 0);
+        config.audio.maxUtteranceMs = json::getIntOr(audio, "maxUtteranceMs", 30000);
+        config.audio.useGpu = json::getBoolOr(audio, "useGpu", true);
+        config.audio.flashAttention = json::getBoolOr(audio, "flashAttention", false);
+        config.audio.beamSize = json::getIntOr(audio, "beamSize", 1);
+        config.audio.threads = json::getIntOr(audio, "threads", 0);
+        config.audio.reduceAudioContext = json::getBoolOr(audio, "reduceAudioContext", false);
+        config.audio.warmUp = json::getBoolOr(audio, "warmUp", true);
     }
 
     // TTS section
@@ -183,6 +378,8 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
         config.tts.enabled = json::getBoolOr(tts, "enabled", false);
         config.tts.modelPath = json::getStringOr(tts, "modelPath", "");
         config.tts.espeakDataPath = json::getStringOr(tts, "espeakDataPath", "");
+        config.tts.phraseCacheMb = json::getIntOr(tts, "phraseCacheMb", 16);
+        config.tts.diskPhraseCache = json::getBoolOr(tts, "diskPhraseCache", false);
     }
 
     // MCP servers section
@@ -195,6 +392,7 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
                 .command = json::getStringOr(serverJson, "command", ""),
                 .args = {},
                 .env = {},
+                .cachedTools = {},
             };
 
             if (serverJson.contains("args") && serverJson["args"].is_array())
@@ -215,9 +413,42 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
                 }
             }
 
+            serverConfig.url = json::getStringOr(serverJson, "url", "");
+            if (serverJson.contains("headers") && serverJson["headers"].is_object())
+            {
+                for (const auto& [key, value]: serverJson["headers"].items())
+                {
+                    if (value.is_string())
+                        serverConfig.headers[key] = value.get<std::string>();
+                }
+            }
+
+            if (serverJson.contains("cache") && serverJson["cache"].is_object())
+            {
+                auto const& cache = serverJson["cache"];
+                if (cache.contains("tools") && cache["tools"].is_array())
+                {
+                    for (const auto& tool: cache["tools"])
+                    {
+                        if (tool.is_string())
+                            serverConfig.cachedTools.push_back(tool.get<std::string>());
+                    }
+                }
+                serverConfig.cacheTtlSeconds = json::getIntOr(cache, "ttlSeconds", 300);
+            }
+
+            serverConfig.startupTimeoutSeconds = json::getIntOr(serverJson, "startupTimeoutSeconds", 30);
+            serverConfig.requestTimeoutSeconds = json::getIntOr(serverJson, "requestTimeoutSeconds", 120);
+            serverConfig.lazyStart = json::getBoolOr(serverJson, "lazyStart", true);
+            serverConfig.idleTimeoutSeconds = json::getIntOr(serverJson, "idleTimeoutSeconds", 0);
+
             config.mcpServers[name] = std::move(serverConfig);
         }
     }
+    config.useMcpDaemon = json::getBoolOr(root, "useMcpDaemon", false);
+    config.mcpDaemonSocket = json::getStringOr(root, "mcpDaemonSocket", "");
+    config.showToolImages = json::getBoolOr(root, "showToolImages", false);
+    config.memoryBudgetMb = std::max(0, json::getIntOr(root, "memoryBudgetMb", 0));
 
     // Agent section
     if (root.contains("agent"))
@@ -226,6 +457,16 @@ auto loadConfigFromFile(std::string_view path) -> Result<AppConfig>
         config.agent.maxToolSteps = json::getIntOr(agent, "maxToolSteps", 10);
         config.agent.maxRetries = json::getIntOr(agent, "maxRetries", 3);
         config.agent.verbose = json::getBoolOr(agent, "verbose", false);
+        config.agent.toolRetrievalTopK = json::getIntOr(agent, "toolRetrievalTopK", 0);
+        config.agent.maxParallelToolCalls = json::getIntOr(agent, "maxParallelToolCalls", 4);
+        config.agent.toolCacheCapacity = json::getIntOr(agent, "toolCacheCapacity", 256);
+        config.agent.maxToolResultBytes = json::getIntOr(agent, "maxToolResultBytes", 16 * 1024);
+        config.agent.toolResultRecencyTurns = json::getIntOr(agent, "toolResultRecencyTurns", 4);
+        config.agent.compactionTokenThreshold = json::getIntOr(agent, "compactionTokenThreshold", 0);
+        config.agent.compactedToolResultBytes = json::getIntOr(agent, "compactedToolResultBytes", 1024);
+        config.agent.summarizeToolResults = json::getBoolOr(agent, "summarizeToolResults", false);
+        config.agent.memorySnippets = json::getIntOr(agent, "memorySnippets", 0);
+        config.agent.memoryMinSimilarity = json::getFloatOr(agent, "memoryMinSimilarity", 0.5f);
     }
 
     return config;
@@ -241,8 +482,39 @@ auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidRes
         llm["modelPath"] = config.llm.modelPath;
     llm["contextSize"] = config.llm.contextSize;
     llm["gpuLayers"] = config.llm.gpuLayers;
+    llm["batchSize"] = config.llm.batchSize;
+    llm["ubatchSize"] = config.llm.ubatchSize;
+    llm["threads"] = config.llm.threads;
     llm["temperature"] = config.llm.temperature;
+    llm["topP"] = config.llm.topP;
+    llm["topK"] = config.llm.topK;
+    llm["minP"] = config.llm.minP;
+    llm["repeatPenalty"] = config.llm.repeatPenalty;
+    llm["repeatLastN"] = config.llm.repeatLastN;
+    llm["dryMultiplier"] = config.llm.dryMultiplier;
+    llm["xtcProbability"] = config.llm.xtcProbability;
     llm["systemPrompt"] = config.llm.systemPrompt;
+    if (!config.llm.draftModelPath.empty())
+        llm["draftModelPath"] = config.llm.draftModelPath;
+    llm["draftMaxTokens"] = config.llm.draftMaxTokens;
+    llm["promptLookup"] = config.llm.promptLookup;
+    llm["promptLookupNgram"] = config.llm.promptLookupNgram;
+    if (!config.llm.models.empty())
+        llm["models"] = config.llm.models;
+    llm["modelPoolMb"] = config.llm.modelPoolMb;
+    if (!config.llm.toolSelectionModel.empty())
+        llm["toolSelectionModel"] = config.llm.toolSelectionModel;
+    llm["kvCacheTypeK"] = kvCacheTypeName(config.llm.kvCacheTypeK);
+    llm["kvCacheTypeV"] = kvCacheTypeName(config.llm.kvCacheTypeV);
+    llm["flashAttention"] = flashAttentionName(config.llm.flashAttention);
+    llm["useMmap"] = config.llm.useMmap;
+    llm["useMlock"] = config.llm.useMlock;
+    llm["offloadKqv"] = config.llm.offloadKqv;
+    llm["toolPreambleTokenBudget"] = config.llm.toolPreambleTokenBudget;
+    llm["persistKvState"] = config.llm.persistKvState;
+    llm["speculativePrefill"] = config.llm.speculativePrefill;
+    llm["contextOverflow"] =
+        config.llm.contextOverflow == ContextOverflowPolicy::EvictHistory ? "evict" : "shift";
     root["llm"] = std::move(llm);
 
     // Audio section
@@ -257,6 +529,16 @@ auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidRes
         audio["deviceName"] = config.audio.deviceName;
     audio["mode"] = (config.audio.mode == VoiceMode::Vad) ? "vad" : "push-to-talk";
     audio["muteWhileSpeaking"] = config.audio.muteWhileSpeaking;
+    audio["bargeIn"] = config.audio.bargeIn;
+    audio["silenceDurationMs"] = config.audio.silenceDurationMs;
+    audio["partialIntervalMs"] = config.audio.partialIntervalMs;
+    audio["maxUtteranceMs"] = config.audio.maxUtteranceMs;
+    audio["useGpu"] = config.audio.useGpu;
+    audio["flashAttention"] = config.audio.flashAttention;
+    audio["beamSize"] = config.audio.beamSize;
+    audio["threads"] = config.audio.threads;
+    audio["reduceAudioContext"] = config.audio.reduceAudioContext;
+    audio["warmUp"] = config.audio.warmUp;
     root["audio"] = std::move(audio);
 
     // TTS section
@@ -266,6 +548,8 @@ auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidRes
         tts["modelPath"] = config.tts.modelPath;
     if (!config.tts.espeakDataPath.empty())
         tts["espeakDataPath"] = config.tts.espeakDataPath;
+    tts["phraseCacheMb"] = config.tts.phraseCacheMb;
+    tts["diskPhraseCache"] = config.tts.diskPhraseCache;
     root["tts"] = std::move(tts);
 
     // MCP servers section
@@ -275,7 +559,10 @@ auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidRes
         for (const auto& [name, serverConfig]: config.mcpServers)
         {
             auto server = nlohmann::json::object();
-            server["command"] = serverConfig.command;
+            if (!serverConfig.url.empty())
+                server["url"] = serverConfig.url;
+            else
+                server["command"] = serverConfig.command;
             if (!serverConfig.args.empty())
             {
                 auto args = nlohmann::json::array();
@@ -290,16 +577,49 @@ auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidRes
                     env[key] = value;
                 server["env"] = std::move(env);
             }
+            if (!serverConfig.headers.empty())
+            {
+                auto headers = nlohmann::json::object();
+                for (const auto& [key, value]: serverConfig.headers)
+                    headers[key] = value;
+                server["headers"] = std::move(headers);
+            }
+            if (!serverConfig.cachedTools.empty())
+            {
+                auto cache = nlohmann::json::object();
+                cache["tools"] = serverConfig.cachedTools;
+                cache["ttlSeconds"] = serverConfig.cacheTtlSeconds;
+                server["cache"] = std::move(cache);
+            }
+            server["startupTimeoutSeconds"] = serverConfig.startupTimeoutSeconds;
+            server["requestTimeoutSeconds"] = serverConfig.requestTimeoutSeconds;
+            server["lazyStart"] = serverConfig.lazyStart;
+            server["idleTimeoutSeconds"] = serverConfig.idleTimeoutSeconds;
             servers[name] = std::move(server);
         }
         root["mcpServers"] = std::move(servers);
     }
+    root["useMcpDaemon"] = config.useMcpDaemon;
+    if (!config.mcpDaemonSocket.empty())
+        root["mcpDaemonSocket"] = config.mcpDaemonSocket;
+    root["showToolImages"] = config.showToolImages;
+    root["memoryBudgetMb"] = config.memoryBudgetMb;
 
     // Agent section
     auto agent = nlohmann::json::object();
     agent["maxToolSteps"] = config.agent.maxToolSteps;
     agent["maxRetries"] = config.agent.maxRetries;
     agent["verbose"] = config.agent.verbose;
+    agent["toolRetrievalTopK"] = config.agent.toolRetrievalTopK;
+    agent["maxParallelToolCalls"] = config.agent.maxParallelToolCalls;
+    agent["toolCacheCapacity"] = config.agent.toolCacheCapacity;
+    agent["maxToolResultBytes"] = config.agent.maxToolResultBytes;
+    agent["toolResultRecencyTurns"] = config.agent.toolResultRecencyTurns;
+    agent["compactionTokenThreshold"] = config.agent.compactionTokenThreshold;
+    agent["compactedToolResultBytes"] = config.agent.compactedToolResultBytes;
+    agent["summarizeToolResults"] = config.agent.summarizeToolResults;
+    agent["memorySnippets"] = config.agent.memorySnippets;
+    agent["memoryMinSimilarity"] = config.agent.memoryMinSimilarity;
     root["agent"] = std::move(agent);
 
     // Create parent directory if needed
@@ -334,40 +654,12 @@ auto loadConfig() -> Result<AppConfig>
     return loadConfigFromFile(path);
 }
 
-auto downloadDefaultModel() -> VoidResult
+auto downloadDefaultModel(DownloadProgressCallback onProgress) -> VoidResult
 {
-    auto const modelDir = defaultModelDir();
-    auto const modelPath = defaultModelPath();
-
-    // Create model directory if it doesn't exist
-    auto ec = std::error_code {};
-    std::filesystem::create_directories(modelDir, ec);
-    if (ec)
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to create model directory '{}': {}", modelDir, ec.message()));
-
-    // Download using curl
-    log::info("Downloading default model to {}", modelPath);
-    auto const command =
-        std::format("curl -fSL --progress-bar -o '{}' '{}'", modelPath, DefaultModelDownloadUrl);
-    auto const exitCode = std::system(command.c_str());
-    if (exitCode != 0)
-    {
-        // Clean up partial download
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to download default model (curl exit code: {}). "
-                                     "Ensure curl is installed and you have internet access.",
-                                     exitCode));
-    }
-
-    // Verify the file was actually created and has content
-    if (!std::filesystem::exists(modelPath) || std::filesystem::file_size(modelPath) == 0)
-    {
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError, "Downloaded model file is empty or missing");
-    }
-
+    auto fetched =
+        fetchModelFile("default model", DefaultModelDownloadUrl, defaultModelPath(), std::move(onProgress));
+    if (!fetched)
+        return fetched;
     log::info("Default model downloaded successfully");
     return {};
 }
@@ -387,40 +679,15 @@ auto defaultWhisperModelUrl() -> std::string_view
     return DefaultWhisperModelDownloadUrl;
 }
 
-auto downloadDefaultWhisperModel() -> VoidResult
+auto downloadDefaultWhisperModel(DownloadProgressCallback onProgress, std::stop_token stopToken) -> VoidResult
 {
-    auto const modelDir = defaultModelDir();
-    auto const modelPath = defaultWhisperModelPath();
-
-    // Create model directory if it doesn't exist
-    auto ec = std::error_code {};
-    std::filesystem::create_directories(modelDir, ec);
-    if (ec)
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to create model directory '{}': {}", modelDir, ec.message()));
-
-    // Download using curl
-    log::info("Downloading default whisper model to {}", modelPath);
-    auto const command =
-        std::format("curl -fSL --progress-bar -o '{}' '{}'", modelPath, DefaultWhisperModelDownloadUrl);
-    auto const exitCode = std::system(command.c_str());
-    if (exitCode != 0)
-    {
-        // Clean up partial download
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to download default whisper model (curl exit code: {}). "
-                                     "Ensure curl is installed and you have internet access.",
-                                     exitCode));
-    }
-
-    // Verify the file was actually created and has content
-    if (!std::filesystem::exists(modelPath) || std::filesystem::file_size(modelPath) == 0)
-    {
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError, "Downloaded whisper model file is empty or missing");
-    }
-
+    auto fetched = fetchModelFile("default whisper model",
+                                  DefaultWhisperModelDownloadUrl,
+                                  defaultWhisperModelPath(),
+                                  std::move(onProgress),
+                                  std::move(stopToken));
+    if (!fetched)
+        return fetched;
     log::info("Default whisper model downloaded successfully");
     return {};
 }
@@ -440,59 +707,20 @@ auto defaultTtsModelUrl() -> std::string_view
     return DefaultTtsModelDownloadUrl;
 }
 
-auto downloadDefaultTtsModel() -> VoidResult
+auto downloadDefaultTtsModel(DownloadProgressCallback onProgress, std::stop_token stopToken) -> VoidResult
 {
-    auto const modelDir = defaultModelDir();
     auto const modelPath = defaultTtsModelPath();
-    auto const configPath = modelPath + ".json";
-
-    // Create model directory if it doesn't exist
-    auto ec = std::error_code {};
-    std::filesystem::create_directories(modelDir, ec);
-    if (ec)
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to create model directory '{}': {}", modelDir, ec.message()));
-
-    // Download the ONNX model
-    log::info("Downloading default TTS voice model to {}", modelPath);
-    auto command =
-        std::format("curl -fSL --progress-bar -o '{}' '{}'", modelPath, DefaultTtsModelDownloadUrl);
-    auto exitCode = std::system(command.c_str());
-    if (exitCode != 0)
-    {
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to download default TTS model (curl exit code: {}). "
-                                     "Ensure curl is installed and you have internet access.",
-                                     exitCode));
-    }
-
-    if (!std::filesystem::exists(modelPath) || std::filesystem::file_size(modelPath) == 0)
-    {
-        std::filesystem::remove(modelPath, ec);
-        return makeError(ErrorCode::DownloadError, "Downloaded TTS model file is empty or missing");
-    }
-
-    // Download the JSON config
-    log::info("Downloading TTS model config to {}", configPath);
-    command =
-        std::format("curl -fSL --progress-bar -o '{}' '{}'", configPath, DefaultTtsModelConfigDownloadUrl);
-    exitCode = std::system(command.c_str());
-    if (exitCode != 0)
-    {
-        std::filesystem::remove(configPath, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to download TTS model config (curl exit code: {}). "
-                                     "Ensure curl is installed and you have internet access.",
-                                     exitCode));
-    }
-
-    if (!std::filesystem::exists(configPath) || std::filesystem::file_size(configPath) == 0)
-    {
-        std::filesystem::remove(configPath, ec);
-        return makeError(ErrorCode::DownloadError, "Downloaded TTS model config file is empty or missing");
-    }
-
+    auto fetched = fetchModelFile(
+        "default TTS voice model", DefaultTtsModelDownloadUrl, modelPath, onProgress, stopToken);
+    if (!fetched)
+        return fetched;
+    fetched = fetchModelFile("TTS model config",
+                             DefaultTtsModelConfigDownloadUrl,
+                             modelPath + ".json",
+                             std::move(onProgress),
+                             std::move(stopToken));
+    if (!fetched)
+        return fetched;
     log::info("Default TTS voice model downloaded successfully");
     return {};
 }
@@ -507,37 +735,19 @@ auto modelFilePath(const ModelInfo& model) -> std::string
     return defaultModelDir() + "/" + std::string(model.filename);
 }
 
-auto downloadModel(const ModelInfo& model) -> VoidResult
+auto downloadedModelPath() -> std::optional<std::string>
 {
-    auto const modelDir = defaultModelDir();
-    auto const path = modelFilePath(model);
-
-    auto ec = std::error_code {};
-    std::filesystem::create_directories(modelDir, ec);
-    if (ec)
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to create model directory '{}': {}", modelDir, ec.message()));
-
-    log::info("Downloading {} to {}", model.name, path);
-    auto const command = std::format("curl -fSL --progress-bar -o '{}' '{}'", path, model.url);
-    auto const exitCode = std::system(command.c_str());
-    if (exitCode != 0)
-    {
-        std::filesystem::remove(path, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Failed to download {} (curl exit code: {}). "
-                                     "Ensure curl is installed and you have internet access.",
-                                     model.name,
-                                     exitCode));
-    }
-
-    if (!std::filesystem::exists(path) || std::filesystem::file_size(path) == 0)
-    {
-        std::filesystem::remove(path, ec);
-        return makeError(ErrorCode::DownloadError,
-                         std::format("Downloaded model file is empty or missing: {}", path));
-    }
+    for (const auto& model: availableModels())
+        if (auto path = modelFilePath(model); std::filesystem::exists(path))
+            return path;
+    return std::nullopt;
+}
 
+auto downloadModel(const ModelInfo& model, DownloadProgressCallback onProgress) -> VoidResult
+{
+    auto fetched = fetchModelFile(model.name, model.url, modelFilePath(model), std::move(onProgress));
+    if (!fetched)
+        return fetched;
     log::info("{} downloaded successfully", model.name);
     return {};
 }
@@ -1,11 +1,17 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <agent/AgentLoop.hpp>
 #include <core/Error.hpp>
+#include <llm/LlmEngine.hpp>
 #include <mcp/ServerManager.hpp>
+#include <mychat/Downloader.hpp>
 
+#include <filesystem>
 #include <map>
+#include <optional>
 #include <span>
+#include <stop_token>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -26,8 +32,64 @@ struct LlmConfig
     std::string modelPath;
     int contextSize = 8192;
     int gpuLayers = -1;
+    int batchSize = 0;  ///< Logical prefill batch size (n_batch), 0 = llama.cpp default.
+    int ubatchSize = 0; ///< Physical micro-batch size (n_ubatch), 0 = llama.cpp default.
+    int threads = 0;    ///< LLM threads, 0 = planned around voice input and speech output.
     float temperature = 0.7f;
+    float topP = 0.9f;
+    int topK = 40;
+    float minP = 0.05f;         ///< 0 disables min-p sampling.
+    float repeatPenalty = 1.1f; ///< 1 disables the repetition penalty.
+    int repeatLastN = 64;       ///< Number of recent tokens penalized, -1 = whole context.
+    float dryMultiplier = 0.f;  ///< DRY repetition sampler strength, 0 disables it.
+    float xtcProbability = 0.f; ///< XTC sampler probability, 0 disables it.
     std::string systemPrompt = "You are a helpful assistant with access to tools.";
+
+    /// @brief Optional draft model for speculative decoding (must share the main model's vocabulary).
+    std::string draftModelPath;
+
+    /// @brief Maximum number of tokens the draft model, or prompt lookup, proposes per decode step.
+    int draftMaxTokens = 8;
+
+    /// @brief Without a draft model, draft by looking up the last tokens in the context instead.
+    bool promptLookup = false;
+
+    /// @brief Number of tokens prompt lookup matches before proposing what followed them.
+    int promptLookupNgram = 3;
+
+    /// @brief Further models to switch to with /model, by name, with the main model's settings.
+    ///
+    /// The main model is named "default". The draft model only accompanies the main model.
+    std::map<std::string, std::string> models;
+
+    /// @brief Megabytes the loaded models may take up together; 0 means no limit.
+    ///
+    /// Beyond it, the least recently used models that are not in use are unloaded.
+    int modelPoolMb = 0;
+
+    /// @brief Model that embeds for tool retrieval, e.g. a small one from models; empty uses the
+    ///        model answering.
+    std::string toolSelectionModel;
+
+    /// @brief KV cache storage types; q8_0 roughly halves the f16 footprint, q4_0 quarters it.
+    KvCacheType kvCacheTypeK = KvCacheType::F16;
+    KvCacheType kvCacheTypeV = KvCacheType::F16;
+    FlashAttention flashAttention = FlashAttention::Auto;
+    bool useMmap = true;
+    bool useMlock = false;
+    bool offloadKqv = true;
+
+    /// @brief Maximum number of prompt tokens spent on tool definitions (0 means unlimited).
+    int toolPreambleTokenBudget = 2048;
+
+    /// @brief How long conversations are kept within the context window.
+    ContextOverflowPolicy contextOverflow = ContextOverflowPolicy::ShiftKv;
+
+    /// @brief Save the KV cache of the system prompt to disk and restore it on the next start.
+    bool persistKvState = true;
+
+    /// @brief Prefill the message being typed once the input pauses, so sending it only decodes the rest.
+    bool speculativePrefill = true;
 };
 
 /// @brief Audio configuration section.
@@ -43,6 +105,37 @@ struct AudioConfig
     /// @brief Whether to pause microphone recording during TTS playback.
     /// Prevents the mic from picking up spoken output. Defaults to true.
     bool muteWhileSpeaking = true;
+
+    /// @brief In VAD mode, keep listening during TTS playback and stop the reply when the user talks.
+    /// Takes precedence over muteWhileSpeaking; the playback's echo is suppressed.
+    bool bargeIn = false;
+
+    /// @brief In VAD mode, how long a silence ends an utterance.
+    int silenceDurationMs = 500;
+
+    /// @brief In VAD mode, how often the ongoing utterance is transcribed and shown live, or 0 not to.
+    int partialIntervalMs = 0;
+
+    /// @brief The longest utterance or push-to-talk recording that is transcribed as one.
+    int maxUtteranceMs = 30000;
+
+    /// @brief Whether whisper runs on the GPU, if it was built with GPU support.
+    bool useGpu = true;
+
+    /// @brief Whether whisper uses flash attention, which is faster on most GPUs.
+    bool flashAttention = false;
+
+    /// @brief Whisper's beam search width; 1 decodes greedily, which is fastest.
+    int beamSize = 1;
+
+    /// @brief Whisper's threads, 0 = planned around the LLM's (see planThreads()).
+    int threads = 0;
+
+    /// @brief Whether whisper's encoder context shrinks to the length of short utterances.
+    bool reduceAudioContext = false;
+
+    /// @brief Whether a silent buffer is transcribed at startup, so the first command is not slower.
+    bool warmUp = true;
 };
 
 /// @brief Text-to-speech configuration section.
@@ -56,6 +149,12 @@ struct TtsConfig
 
     /// @brief Path to the espeak-ng-data directory (optional, defaults to built-in).
     std::string espeakDataPath;
+
+    /// @brief Memory for caching the audio of short, often repeated phrases, or 0 not to cache.
+    int phraseCacheMb = 16;
+
+    /// @brief Whether cached phrases are also kept on disk (per voice) across sessions.
+    bool diskPhraseCache = false;
 };
 
 /// @brief Agent loop configuration section.
@@ -64,6 +163,38 @@ struct AgentLoopConfig
     int maxToolSteps = 10;
     int maxRetries = 3;
     bool verbose = false;
+
+    /// @brief Offer only the N tools most relevant to each user message (0 offers all tools).
+    int toolRetrievalTopK = 0;
+
+    /// @brief Maximum number of tool calls of one step that execute concurrently.
+    int maxParallelToolCalls = 4;
+
+    /// @brief Maximum number of memoized tool results (see McpServerConfig::cachedTools).
+    int toolCacheCapacity = 256;
+
+    /// @brief Longer tool results are shortened to this many bytes for the model (0 disables).
+    int maxToolResultBytes = 16 * 1024;
+
+    /// @brief Tool results of older turns than this many are compacted (0 keeps them in full).
+    int toolResultRecencyTurns = 4;
+
+    /// @brief History size in tokens above which all earlier tool results are compacted (0 disables).
+    int compactionTokenThreshold = 0;
+
+    /// @brief Size in bytes compacted tool results are cut to.
+    int compactedToolResultBytes = 1024;
+
+    /// @brief Whether compacted tool results are summarized by the model instead of cut.
+    bool summarizeToolResults = false;
+
+    /// @brief Put the N pieces of earlier sessions most relevant to each user message before it
+    ///        as notes (0 disables). They are embedded by the tool selection model if there is
+    ///        one, else by the answering model.
+    int memorySnippets = 0;
+
+    /// @brief Minimum cosine similarity of a piece of an earlier session to the user message.
+    float memoryMinSimilarity = 0.5f;
 };
 
 /// @brief Top-level application configuration.
@@ -75,6 +206,20 @@ struct AppConfig
     std::map<std::string, McpServerConfig> mcpServers;
     AgentLoopConfig agent;
 
+    /// @brief Run local MCP servers through mychat-mcpd, keeping them warm across sessions.
+    ///
+    /// Servers are spawned directly whenever the daemon is not reachable.
+    bool useMcpDaemon = false;
+    std::string mcpDaemonSocket; ///< The daemon's socket; empty uses defaultMcpDaemonSocketPath().
+
+    /// @brief Show images returned by tools inline; requires a terminal with sixel support.
+    bool showToolImages = false;
+
+    /// @brief Memory budget in megabytes for what mychat holds (see /stats); 0 means no budget.
+    ///
+    /// When over budget after a turn, caches are shrunk and then the oldest turns evicted.
+    int memoryBudgetMb = 0;
+
     /// @brief Whether to expand the log panel on startup (set via --log CLI flag).
     bool logPanelExpanded = false;
 };
@@ -94,6 +239,34 @@ struct AppConfig
 /// @return Success or an error.
 [[nodiscard]] auto saveConfigToFile(std::string_view path, const AppConfig& config) -> VoidResult;
 
+/// @brief Returns the engine configuration described by the LLM section.
+[[nodiscard]] auto llmEngineConfig(const LlmConfig& llm) -> LlmEngineConfig;
+
+/// @brief Returns the engine configuration of @p modelPath, one of LlmConfig::models.
+///
+/// It is that of the main model, without the draft model.
+[[nodiscard]] auto llmEngineConfig(const LlmConfig& llm, std::string_view modelPath) -> LlmEngineConfig;
+
+/// @brief Returns the sampling configuration described by the LLM section.
+[[nodiscard]] auto samplerConfig(const LlmConfig& llm) -> SamplerConfig;
+
+/// @brief Returns the agent loop configuration described by @p config.
+///
+/// The tool index is kept in the data directory, per model (see LlmEngine::modelFingerprint()).
+[[nodiscard]] auto agentLoopConfig(const AppConfig& config, std::string_view modelFingerprint) -> AgentConfig;
+
+/// @brief Returns where the tool index of the model with @p modelFingerprint is kept.
+[[nodiscard]] auto toolIndexPath(std::string_view modelFingerprint) -> std::filesystem::path;
+
+/// @brief Returns where the memory index of earlier sessions embedded by the model with
+///        @p modelFingerprint is kept.
+[[nodiscard]] auto memoryIndexPath(std::string_view modelFingerprint) -> std::filesystem::path;
+
+/// @brief Connects the MCP servers of @p config, waiting until each is ready or has failed.
+///
+/// Servers are started through the daemon if configured; failures are logged, not returned.
+void connectMcpServers(const AppConfig& config, ServerManager& servers);
+
 /// @brief Returns the default config directory path for the current platform.
 [[nodiscard]] auto defaultConfigDir() -> std::string;
 
@@ -119,8 +292,9 @@ struct AppConfig
 [[nodiscard]] auto defaultModelFilename() -> std::string_view;
 
 /// @brief Downloads the default model to the default model directory.
+/// @param onProgress Receives the download progress; a console progress line is drawn if empty.
 /// @return Success or an error with download details.
-[[nodiscard]] auto downloadDefaultModel() -> VoidResult;
+[[nodiscard]] auto downloadDefaultModel(DownloadProgressCallback onProgress = {}) -> VoidResult;
 
 /// @brief Returns the default whisper model file path.
 [[nodiscard]] auto defaultWhisperModelPath() -> std::string;
@@ -132,8 +306,11 @@ struct AppConfig
 [[nodiscard]] auto defaultWhisperModelUrl() -> std::string_view;
 
 /// @brief Downloads the default whisper model to the default model directory.
+/// @param onProgress Receives the download progress; a console progress line is drawn if empty.
+/// @param stopToken Aborts the download, keeping what was fetched for the next attempt.
 /// @return Success or an error with download details.
-[[nodiscard]] auto downloadDefaultWhisperModel() -> VoidResult;
+[[nodiscard]] auto downloadDefaultWhisperModel(DownloadProgressCallback onProgress = {},
+                                               std::stop_token stopToken = {}) -> VoidResult;
 
 /// @brief Returns the default TTS voice model file path.
 [[nodiscard]] auto defaultTtsModelPath() -> std::string;
@@ -145,8 +322,11 @@ struct AppConfig
 [[nodiscard]] auto defaultTtsModelUrl() -> std::string_view;
 
 /// @brief Downloads the default TTS voice model (and its JSON config) to the default model directory.
+/// @param onProgress Receives the download progress; a console progress line is drawn if empty.
+/// @param stopToken Aborts the download, keeping what was fetched for the next attempt.
 /// @return Success or an error with download details.
-[[nodiscard]] auto downloadDefaultTtsModel() -> VoidResult;
+[[nodiscard]] auto downloadDefaultTtsModel(DownloadProgressCallback onProgress = {},
+                                           std::stop_token stopToken = {}) -> VoidResult;
 
 /// @brief Metadata for a downloadable LLM model.
 struct ModelInfo
@@ -166,9 +346,14 @@ struct ModelInfo
 /// @return Absolute path under the default model directory.
 [[nodiscard]] auto modelFilePath(const ModelInfo& model) -> std::string;
 
+/// @brief Returns the path of the first model of availableModels() that was downloaded, if any.
+[[nodiscard]] auto downloadedModelPath() -> std::optional<std::string>;
+
 /// @brief Downloads a model to the default model directory.
 /// @param model The model to download.
+/// @param onProgress Receives the download progress; a console progress line is drawn if empty.
 /// @return Success or an error with download details.
-[[nodiscard]] auto downloadModel(const ModelInfo& model) -> VoidResult;
+[[nodiscard]] auto downloadModel(const ModelInfo& model, DownloadProgressCallback onProgress = {})
+    -> VoidResult;
 
 } // namespace mychat
@@ -0,0 +1,691 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Downloader.hpp"
+
+#include <core/Hash.hpp>
+#include <core/Log.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(MYCHAT_HAVE_CURL)
+    #include <curl/curl.h>
+#else
+    #include <cstdlib>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto HashBufferBytes = size_t { 1 } << 20;
+
+    auto partPathOf(std::filesystem::path const& destination) -> std::filesystem::path
+    {
+        return std::filesystem::path(destination).concat(".part");
+    }
+
+    auto progressPathOf(std::filesystem::path const& destination) -> std::filesystem::path
+    {
+        return std::filesystem::path(destination).concat(".part.json");
+    }
+
+    auto toLower(std::string_view text) -> std::string
+    {
+        auto lower = std::string(text);
+        std::ranges::transform(lower, lower.begin(), [](unsigned char c) { return std::tolower(c); });
+        return lower;
+    }
+
+    auto isSha256(std::string_view text) -> bool
+    {
+        return text.size() == 64
+               && std::ranges::all_of(text, [](unsigned char c) { return std::isxdigit(c) != 0; });
+    }
+
+    /// @brief Continues @p sha over @p count bytes of @p in from its current position.
+    auto hashRange(std::ifstream& in, std::uint64_t count, Sha256& sha, std::vector<char>& buffer) -> bool
+    {
+        while (count > 0)
+        {
+            auto const size = static_cast<std::streamsize>(std::min<std::uint64_t>(count, buffer.size()));
+            if (!in.read(buffer.data(), size))
+                return false;
+            sha.update(std::string_view(buffer.data(), static_cast<size_t>(size)));
+            count -= static_cast<std::uint64_t>(size);
+        }
+        return true;
+    }
+
+    /// @brief Moves the verified download into place, or removes it if its checksum mismatches.
+    auto finishDownload(std::filesystem::path const& destination,
+                        std::string const& expected,
+                        std::optional<std::string> const& actual) -> VoidResult
+    {
+        auto const partPath = partPathOf(destination);
+        auto ec = std::error_code {};
+        if (actual && *actual != expected)
+        {
+            std::filesystem::remove(partPath, ec);
+            std::filesystem::remove(progressPathOf(destination), ec);
+            return makeError(ErrorCode::DownloadError,
+                             std::format("Checksum mismatch for {}: expected {}, got {}",
+                                         destination.filename().string(),
+                                         expected,
+                                         *actual));
+        }
+        if (std::filesystem::file_size(partPath, ec) == 0)
+        {
+            std::filesystem::remove(partPath, ec);
+            return makeError(ErrorCode::DownloadError,
+                             std::format("Downloaded file is empty: {}", destination.string()));
+        }
+
+        std::filesystem::rename(partPath, destination, ec);
+        if (ec)
+            return makeError(ErrorCode::DownloadError,
+                             std::format(
+                                 "Cannot move download to {}: {}", destination.string(), ec.message()));
+        std::filesystem::remove(progressPathOf(destination), ec);
+        if (actual)
+            log::info("Verified SHA-256 of {}", destination.filename().string());
+        return {};
+    }
+
+#if defined(MYCHAT_HAVE_CURL)
+
+    constexpr auto MaxChunkAttempts = 3;
+    constexpr auto ProgressInterval = std::chrono::milliseconds { 250 };
+
+    /// @brief What a HEAD request tells about the file to download.
+    struct RemoteFile
+    {
+        std::uint64_t size = 0; ///< 0 if unknown.
+        bool ranges = false;
+        std::string sha256;    ///< Published checksum, if any.
+        std::string validator; ///< Identifies the file's version, so stale partial downloads are discarded.
+    };
+
+    /// @brief Owns a curl easy handle.
+    class CurlHandle
+    {
+      public:
+        CurlHandle(): _handle(curl_easy_init()) {}
+        ~CurlHandle()
+        {
+            if (_handle)
+                curl_easy_cleanup(_handle);
+        }
+        CurlHandle(CurlHandle const&) = delete;
+        CurlHandle& operator=(CurlHandle const&) = delete;
+
+        [[nodiscard]] auto get() const noexcept -> CURL* { return _handle; }
+
+      private:
+        CURL* _handle;
+    };
+
+    void initializeCurl()
+    {
+        static auto once = std::once_flag {};
+        std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+
+    void setCommonOptions(CURL* curl, std::string const& url)
+    {
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "mychat");
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        // Give up on connections that stall rather than waiting forever.
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 30L);
+    }
+
+    auto headerCallback(char* data, size_t size, size_t count, void* user) -> size_t
+    {
+        auto& file = *static_cast<RemoteFile*>(user);
+        auto const bytes = size * count;
+        auto line = std::string_view(data, bytes);
+
+        // Each response of a redirect chain starts with its status line; the last one describes the file.
+        if (line.starts_with("HTTP/"))
+        {
+            file.size = 0;
+            file.ranges = false;
+            file.validator.clear();
+            return bytes;
+        }
+        auto const colon = line.find(':');
+        if (colon == std::string_view::npos)
+            return bytes;
+
+        auto const trim = [](std::string_view text) {
+            auto const first = text.find_first_not_of(" \t\r\n\"");
+            auto const last = text.find_last_not_of(" \t\r\n\"");
+            if (first == std::string_view::npos)
+                return std::string_view {};
+            return text.substr(first, last - first + 1);
+        };
+        auto const name = toLower(trim(line.substr(0, colon)));
+        auto const value = trim(line.substr(colon + 1));
+        if (name == "content-length")
+            std::from_chars(value.data(), value.data() + value.size(), file.size);
+        else if (name == "accept-ranges")
+            file.ranges = toLower(value) == "bytes";
+        else if (name == "etag" || name == "last-modified")
+            file.validator = value;
+        else if (name == "x-linked-etag" && isSha256(value))
+            file.sha256 = toLower(value);
+        return bytes;
+    }
+
+    auto probe(std::string const& url) -> Result<RemoteFile>
+    {
+        auto curl = CurlHandle {};
+        if (!curl.get())
+            return makeError(ErrorCode::DownloadError, "Failed to initialize libcurl");
+
+        auto file = RemoteFile {};
+        setCommonOptions(curl.get(), url);
+        curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, &headerCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &file);
+        if (auto const code = curl_easy_perform(curl.get()); code != CURLE_OK)
+            return makeError(ErrorCode::DownloadError,
+                             std::format("Cannot reach {}: {}", url, curl_easy_strerror(code)));
+        if (!file.sha256.empty())
+            file.validator = file.sha256;
+        return file;
+    }
+
+    /// @brief Downloads the chunks of one file on several connections into its partial file.
+    class ChunkedDownload
+    {
+      public:
+        ChunkedDownload(std::string url,
+                        std::filesystem::path destination,
+                        RemoteFile remote,
+                        DownloadOptions const& options):
+            _url(std::move(url)),
+            _destination(std::move(destination)),
+            _partPath(partPathOf(_destination)),
+            _remote(std::move(remote)),
+            _options(options),
+            _chunked(_remote.ranges && _remote.size > 0),
+            _chunkBytes(_chunked ? std::max<std::uint64_t>(options.chunkBytes, 1) : _remote.size),
+            _chunkCount(_chunked ? static_cast<size_t>((_remote.size + _chunkBytes - 1) / _chunkBytes) : 1),
+            _done(_chunkCount, false)
+        {
+        }
+
+        /// @brief Fetches the missing chunks; returns the SHA-256 of the file if @p hash is set.
+        auto run(bool hash) -> Result<std::optional<std::string>>
+        {
+            if (auto prepared = prepare(); !prepared)
+                return std::unexpected(prepared.error());
+
+            auto const connections =
+                std::clamp(_options.connections, 1, static_cast<int>(std::max<size_t>(_pending.size(), 1)));
+            auto const start = Clock::now();
+            auto const resumed = _received.load();
+            auto sha = Sha256 {};
+            auto hashed = size_t { 0 };
+            auto buffer = std::vector<char>(hash ? HashBufferBytes : 0);
+            auto reader = std::ifstream {};
+            auto hashFailed = false;
+
+            // Hashes the finished chunks that continue the hashed prefix of the file.
+            auto const hashReady = [&] {
+                while (hash && !hashFailed && hashed < _chunkCount && isDone(hashed))
+                {
+                    if (!reader.is_open())
+                        reader.open(_partPath, std::ios::binary);
+                    // Without chunks, the size may only be known once the file is complete.
+                    auto ec = std::error_code {};
+                    auto const size =
+                        _chunked ? chunkSize(hashed) : std::filesystem::file_size(_partPath, ec);
+                    hashFailed = ec || !hashRange(reader, size, sha, buffer);
+                    ++hashed;
+                }
+            };
+            auto const report = [&](bool done) {
+                if (!_options.onProgress)
+                    return;
+                auto const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                auto const received = _received.load();
+                _options.onProgress(DownloadProgress {
+                    .received = received,
+                    .total = _remote.size,
+                    .bytesPerSecond = seconds > 0 ? static_cast<double>(received - resumed) / seconds : 0.0,
+                    .done = done,
+                });
+            };
+
+            {
+                auto workers = std::vector<std::jthread> {};
+                for (auto i = 0; i < connections; ++i)
+                    workers.emplace_back([this] { work(); });
+
+                auto lock = std::unique_lock(_mutex);
+                while (_finishedWorkers < connections)
+                {
+                    _changed.wait_for(lock, ProgressInterval);
+                    lock.unlock();
+                    hashReady();
+                    report(false);
+                    lock.lock();
+                }
+            }
+            hashReady();
+            if (!_rangesIgnored)
+                report(true);
+
+            if (_error)
+                return std::unexpected(*_error);
+            if (_options.stopToken.stop_requested())
+                return makeError(ErrorCode::DownloadError, "Download cancelled");
+            if (hashFailed)
+                return makeError(ErrorCode::DownloadError,
+                                 std::format("Cannot read {} to verify it", _partPath.string()));
+            if (!hash)
+                return std::optional<std::string> {};
+            return std::optional(sha.hexDigest());
+        }
+
+        /// @brief Returns whether the server answered a range request with the whole file.
+        [[nodiscard]] auto rangesIgnored() const noexcept -> bool { return _rangesIgnored; }
+
+      private:
+        /// @brief Opens the partial file, resuming the chunks recorded in the sidecar if it matches.
+        auto prepare() -> VoidResult
+        {
+            auto ec = std::error_code {};
+            auto const progressPath = progressPathOf(_destination);
+            if (_chunked && readSidecar(progressPath)
+                && std::filesystem::file_size(_partPath, ec) == _remote.size)
+            {
+                auto const finished = std::ranges::count(_done, true);
+                if (finished > 0)
+                    log::info("Resuming download of {}: {} of {} chunks present",
+                              _destination.filename().string(),
+                              finished,
+                              _chunkCount);
+            }
+            else
+            {
+                _done.assign(_chunkCount, false);
+                {
+                    auto out = std::ofstream(_partPath, std::ios::binary | std::ios::trunc);
+                    if (!out)
+                        return makeError(ErrorCode::DownloadError,
+                                         std::format("Cannot create {}", _partPath.string()));
+                }
+                if (_chunked)
+                    std::filesystem::resize_file(_partPath, _remote.size, ec);
+                if (ec)
+                    return makeError(ErrorCode::DownloadError,
+                                     std::format("Cannot allocate {}: {}", _partPath.string(), ec.message()));
+            }
+
+            for (auto i = size_t { 0 }; i < _chunkCount; ++i)
+            {
+                if (_done[i])
+                    _received += chunkSize(i);
+                else
+                    _pending.push_back(i);
+            }
+            return {};
+        }
+
+        [[nodiscard]] auto chunkSize(size_t chunk) const -> std::uint64_t
+        {
+            if (!_chunked)
+                return _remote.size;
+            return std::min(_chunkBytes, _remote.size - chunk * _chunkBytes);
+        }
+
+        [[nodiscard]] auto isDone(size_t chunk) -> bool
+        {
+            auto const lock = std::lock_guard(_mutex);
+            return _done[chunk];
+        }
+
+        /// @brief Fetches chunks until none are left or the download is given up.
+        void work()
+        {
+            auto out = std::fstream(_partPath, std::ios::in | std::ios::out | std::ios::binary);
+            while (auto const chunk = takeChunk())
+            {
+                auto fetched = false;
+                auto error = std::string {};
+                for (auto attempt = 1; attempt <= MaxChunkAttempts && !fetched && !stopped(); ++attempt)
+                {
+                    auto written = std::uint64_t { 0 };
+                    fetched = fetch(*chunk, out, written, error);
+                    if (!fetched)
+                    {
+                        _received -= written;
+                        log::warning("Download of chunk {} failed (attempt {}): {}", *chunk, attempt, error);
+                    }
+                }
+                if (!fetched)
+                {
+                    fail(std::move(error));
+                    break;
+                }
+                markDone(*chunk);
+            }
+
+            auto const lock = std::lock_guard(_mutex);
+            ++_finishedWorkers;
+            _changed.notify_all();
+        }
+
+        auto takeChunk() -> std::optional<size_t>
+        {
+            auto const lock = std::lock_guard(_mutex);
+            if (_error || _nextPending >= _pending.size())
+                return std::nullopt;
+            return _pending[_nextPending++];
+        }
+
+        [[nodiscard]] auto stopped() -> bool
+        {
+            if (_options.stopToken.stop_requested() || _rangesIgnored)
+                return true;
+            auto const lock = std::lock_guard(_mutex);
+            return _error.has_value();
+        }
+
+        void fail(std::string message)
+        {
+            auto const lock = std::lock_guard(_mutex);
+            if (!_error)
+                _error = Error { .code = ErrorCode::DownloadError, .message = std::move(message) };
+        }
+
+        void markDone(size_t chunk)
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _done[chunk] = true;
+            if (_chunked)
+                writeSidecar(progressPathOf(_destination));
+            _changed.notify_all();
+        }
+
+        /// @brief State of a transfer, shared with the curl callbacks.
+        struct Transfer
+        {
+            ChunkedDownload* download;
+            std::fstream* out;
+            std::uint64_t written = 0;
+            long status = 0;           ///< Status of the response whose headers arrive.
+            bool rangeIgnored = false; ///< The response to a range request was not partial.
+        };
+
+        /// @brief Refuses the body of a response to a range request unless it is partial (206).
+        ///
+        /// A server that ignores the range answers with the whole file, which would overwrite
+        /// the chunks after this one, so the transfer is aborted at the end of the headers.
+        static auto chunkHeaderCallback(char* data, size_t size, size_t count, void* user) -> size_t
+        {
+            auto& transfer = *static_cast<Transfer*>(user);
+            auto const bytes = size * count;
+            auto const line = std::string_view(data, bytes);
+            if (line.starts_with("HTTP/"))
+            {
+                // Each response of a redirect chain starts with its status line, e.g. "HTTP/2 206".
+                auto const code = line.substr(std::min(line.find(' '), line.size())).substr(1);
+                transfer.status = 0;
+                std::from_chars(code.data(), code.data() + code.size(), transfer.status);
+                return bytes;
+            }
+            auto const redirect = transfer.status >= 300 && transfer.status < 400;
+            if (line.find_first_not_of("\r\n") == std::string_view::npos && transfer.download->_chunked
+                && transfer.status != 206 && !redirect)
+            {
+                transfer.rangeIgnored = true;
+                return 0;
+            }
+            return bytes;
+        }
+
+        static auto writeCallback(char* data, size_t size, size_t count, void* user) -> size_t
+        {
+            auto& transfer = *static_cast<Transfer*>(user);
+            auto const bytes = size * count;
+            if (!transfer.out->write(data, static_cast<std::streamsize>(bytes)))
+                return 0;
+            transfer.written += bytes;
+            transfer.download->_received += bytes;
+            return bytes;
+        }
+
+        static auto progressCallback(void* user, curl_off_t, curl_off_t, curl_off_t, curl_off_t) -> int
+        {
+            auto& transfer = *static_cast<Transfer*>(user);
+            return transfer.download->stopped() ? 1 : 0;
+        }
+
+        /// @brief Fetches @p chunk into @p out, counting the bytes written into @p written.
+        auto fetch(size_t chunk, std::fstream& out, std::uint64_t& written, std::string& error) -> bool
+        {
+            auto curl = CurlHandle {};
+            if (!curl.get() || !out)
+            {
+                error = "Cannot start transfer";
+                return false;
+            }
+
+            auto const begin = chunk * _chunkBytes;
+            auto const size = chunkSize(chunk);
+            out.clear();
+            out.seekp(static_cast<std::streamoff>(begin));
+
+            auto transfer = Transfer { .download = this, .out = &out };
+            auto const range = std::format("{}-{}", begin, begin + size - 1);
+            setCommonOptions(curl.get(), _url);
+            if (_chunked)
+                curl_easy_setopt(curl.get(), CURLOPT_RANGE, range.c_str());
+            curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, &chunkHeaderCallback);
+            curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &transfer);
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &writeCallback);
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &transfer);
+            curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, &progressCallback);
+            curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, &transfer);
+            curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0L);
+
+            auto const code = curl_easy_perform(curl.get());
+            out.flush();
+            written = transfer.written;
+            auto status = long { 0 };
+            curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &status);
+            if (transfer.rangeIgnored || (code == CURLE_OK && _chunked && status != 206))
+            {
+                // Retrying will not help; downloadFile() fetches the file in one stream instead.
+                if (status == 200)
+                    _rangesIgnored = true;
+                error = std::format("Server ignored the range request (HTTP {})", status);
+            }
+            else if (code != CURLE_OK)
+                error = curl_easy_strerror(code);
+            else if (!out)
+                error = std::format("Cannot write {}", _partPath.string());
+            else if (_remote.size > 0 && written != size)
+                error = std::format("Received {} of {} bytes", written, size);
+            else
+                return true;
+            return false;
+        }
+
+        auto readSidecar(std::filesystem::path const& path) -> bool
+        {
+            auto in = std::ifstream(path);
+            auto const state = nlohmann::json::parse(in, nullptr, false);
+            if (!state.is_object() || state.value("url", "") != _url
+                || state.value("size", std::uint64_t { 0 }) != _remote.size
+                || state.value("chunkBytes", std::uint64_t { 0 }) != _chunkBytes
+                || state.value("validator", "") != _remote.validator || !state.contains("done")
+                || !state["done"].is_array())
+                return false;
+            for (auto const& chunk: state["done"])
+                if (chunk.is_number_unsigned() && chunk.get<size_t>() < _chunkCount)
+                    _done[chunk.get<size_t>()] = true;
+            return true;
+        }
+
+        void writeSidecar(std::filesystem::path const& path) const
+        {
+            auto done = nlohmann::json::array();
+            for (auto i = size_t { 0 }; i < _chunkCount; ++i)
+                if (_done[i])
+                    done.push_back(i);
+            auto const state = nlohmann::json {
+                { "url", _url },
+                { "size", _remote.size },
+                { "chunkBytes", _chunkBytes },
+                { "validator", _remote.validator },
+                { "done", std::move(done) },
+            };
+
+            // Written aside and renamed, so a crash never leaves a sidecar claiming too much.
+            auto const tempPath = std::filesystem::path(path).concat(".tmp");
+            {
+                auto out = std::ofstream(tempPath, std::ios::trunc);
+                out << state.dump();
+            }
+            auto ec = std::error_code {};
+            std::filesystem::rename(tempPath, path, ec);
+        }
+
+        std::string _url;
+        std::filesystem::path _destination;
+        std::filesystem::path _partPath;
+        RemoteFile _remote;
+        DownloadOptions const& _options;
+        bool _chunked;
+        std::uint64_t _chunkBytes;
+        size_t _chunkCount;
+
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        std::vector<bool> _done;
+        std::vector<size_t> _pending;
+        size_t _nextPending = 0;
+        int _finishedWorkers = 0;
+        std::optional<Error> _error;
+        std::atomic<std::uint64_t> _received = 0;
+        std::atomic<bool> _rangesIgnored = false;
+    };
+
+#endif
+
+} // namespace
+
+auto downloadFile(std::string const& url,
+                  std::filesystem::path const& destination,
+                  DownloadOptions const& options) -> VoidResult
+{
+    auto ec = std::error_code {};
+    if (destination.has_parent_path())
+        std::filesystem::create_directories(destination.parent_path(), ec);
+    if (ec)
+        return makeError(ErrorCode::DownloadError,
+                         std::format("Failed to create directory '{}': {}",
+                                     destination.parent_path().string(),
+                                     ec.message()));
+
+#if defined(MYCHAT_HAVE_CURL)
+    initializeCurl();
+    auto remote = probe(url);
+    if (!remote)
+        return std::unexpected(remote.error());
+
+    auto expected = toLower(options.sha256.empty() ? remote->sha256 : options.sha256);
+    auto download = ChunkedDownload(url, destination, *remote, options);
+    auto actual = download.run(!expected.empty());
+    if (!actual && download.rangesIgnored() && !options.stopToken.stop_requested())
+    {
+        // The server advertised ranges but does not serve them, so the file comes in one stream.
+        log::warning("{} ignores range requests; downloading it on one connection", url);
+        remote->ranges = false;
+        auto single = ChunkedDownload(url, destination, std::move(*remote), options);
+        actual = single.run(!expected.empty());
+    }
+    if (!actual)
+        return std::unexpected(actual.error());
+    return finishDownload(destination, expected, *actual);
+#else
+    // Without libcurl, the curl tool resumes the partial file but fetches it in one stream.
+    auto const partPath = partPathOf(destination);
+    auto const command = std::format("curl -fSL -C - --progress-bar -o '{}' '{}'", partPath.string(), url);
+    if (auto const exitCode = std::system(command.c_str()); exitCode != 0)
+        return makeError(ErrorCode::DownloadError,
+                         std::format("Failed to download {} (curl exit code: {}). "
+                                     "Ensure curl is installed and you have internet access.",
+                                     url,
+                                     exitCode));
+
+    auto const expected = toLower(options.sha256);
+    auto actual = std::optional<std::string> {};
+    if (!expected.empty())
+    {
+        auto in = std::ifstream(partPath, std::ios::binary);
+        auto sha = Sha256 {};
+        auto buffer = std::vector<char>(HashBufferBytes);
+        if (!hashRange(in, std::filesystem::file_size(partPath, ec), sha, buffer))
+            return makeError(ErrorCode::DownloadError,
+                             std::format("Cannot read {} to verify it", partPath.string()));
+        actual = sha.hexDigest();
+    }
+    return finishDownload(destination, expected, actual);
+#endif
+}
+
+auto formatDownloadProgress(DownloadProgress const& progress) -> std::string
+{
+    auto const size = [](std::uint64_t bytes) {
+        if (bytes >= 1'000'000'000)
+            return std::format("{:.1f} GB", static_cast<double>(bytes) / 1e9);
+        return std::format("{:.1f} MB", static_cast<double>(bytes) / 1e6);
+    };
+    auto const rate = progress.bytesPerSecond / 1e6;
+    if (progress.total == 0)
+        return std::format("{}, {:.1f} MB/s", size(progress.received), rate);
+    return std::format(
+        "{}% of {}, {:.1f} MB/s", progress.received * 100 / progress.total, size(progress.total), rate);
+}
+
+auto consoleDownloadProgress() -> DownloadProgressCallback
+{
+    return [](DownloadProgress const& progress) {
+        std::print(stderr, "\r  {}\033[K", formatDownloadProgress(progress));
+        if (progress.done)
+            std::println(stderr, "");
+        std::fflush(stderr);
+    };
+}
+
+} // namespace mychat
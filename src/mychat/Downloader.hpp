@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string>
+
+namespace mychat
+{
+
+/// @brief Progress of a running download.
+struct DownloadProgress
+{
+    std::uint64_t received = 0;  ///< Bytes downloaded, including those of a resumed earlier attempt.
+    std::uint64_t total = 0;     ///< Size of the file, or 0 if the server does not tell.
+    double bytesPerSecond = 0.0; ///< Transfer rate of this attempt.
+    bool done = false;           ///< Set on the last report, whether the download succeeded or not.
+};
+
+/// @brief Receives download progress on the thread that called downloadFile().
+using DownloadProgressCallback = std::function<void(DownloadProgress const&)>;
+
+/// @brief How downloadFile() fetches and verifies a file.
+struct DownloadOptions
+{
+    int connections = 4; ///< Range requests fetched concurrently.
+    std::uint64_t chunkBytes = std::uint64_t { 32 } * 1024 * 1024; ///< Size of each range request.
+    /// Expected SHA-256 as hex digits. If empty, the checksum published by the server is used
+    /// where there is one (Hugging Face sends it as X-Linked-Etag); otherwise nothing is verified.
+    std::string sha256;
+    DownloadProgressCallback onProgress; ///< Called a few times per second and once at the end.
+    std::stop_token stopToken;           ///< Aborts the download, keeping what was fetched.
+};
+
+/// @brief Downloads @p url to @p destination.
+///
+/// The file is split into chunks that are fetched concurrently with HTTP range requests into
+/// `<destination>.part`. A sidecar file records the finished chunks, so a download that failed
+/// or was stopped resumes where it left off. The checksum is computed while the chunks arrive,
+/// in file order, and the file is only moved to @p destination once it matches. Servers
+/// without range support are downloaded in one request.
+///
+/// Built without libcurl, this runs the curl command line tool instead, which resumes but
+/// fetches sequentially.
+/// @return Success, or an error; the partial download is kept unless its checksum mismatched.
+[[nodiscard]] auto downloadFile(std::string const& url,
+                                std::filesystem::path const& destination,
+                                DownloadOptions const& options = {}) -> VoidResult;
+
+/// @brief Formats download progress for display, such as "42% of 5.5 GB, 35.1 MB/s".
+[[nodiscard]] auto formatDownloadProgress(DownloadProgress const& progress) -> std::string;
+
+/// @brief Returns a progress callback that redraws a progress line on the console.
+[[nodiscard]] auto consoleDownloadProgress() -> DownloadProgressCallback;
+
+} // namespace mychat
@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "LlmBenchmark.hpp"
+
+#include <core/Log.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stop_token>
+#include <string_view>
+
+#if defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+namespace mychat
+{
+
+namespace
+{
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto SystemPrompt = std::string_view { "You are a helpful assistant with access to tools." };
+
+    /// @brief Text repeated to fill the context for the long prefill.
+    constexpr auto FillerParagraph = std::string_view {
+        "The terminal emulator reads bytes from the pseudo terminal, parses escape sequences and "
+        "updates a grid of cells. Each cell holds a character and its attributes. The renderer walks "
+        "the grid, groups cells with equal attributes and draws them with the font's glyphs. "
+    };
+
+    auto message(Role role, std::string_view content) -> ChatMessage
+    {
+        return ChatMessage {
+            .role = role,
+            .content = std::string(content),
+            .toolCalls = {},
+            .toolCallId = {},
+        };
+    }
+
+    auto weatherTool() -> ToolDefinition
+    {
+        return ToolDefinition {
+            .name = "get_weather",
+            .description = "Returns the current weather for a city.",
+            .inputSchema = { { "type", "object" },
+                             { "properties", { { "city", { { "type", "string" } } } } },
+                             { "required", { "city" } } },
+        };
+    }
+
+    /// @brief Forgets the peak RSS so far, so that each variant reports its own.
+    void resetPeakResident()
+    {
+#if defined(__linux__)
+        // Writing 5 resets VmHWM (Linux 4.0 and later).
+        auto file = std::ofstream("/proc/self/clear_refs");
+        file << "5";
+#endif
+    }
+
+    /// @brief Returns the peak RSS since the last resetPeakResident(), if the platform tells.
+    ///
+    /// macOS cannot reset it, so there it is the peak of the whole process. Memory of GPU
+    /// backends is not included.
+    auto peakResidentBytes() -> std::optional<size_t>
+    {
+#if defined(__linux__)
+        auto file = std::ifstream("/proc/self/status");
+        auto line = std::string {};
+        while (std::getline(file, line))
+        {
+            auto kilobytes = size_t { 0 };
+            if (std::sscanf(line.c_str(), "VmHWM: %zu kB", &kilobytes) == 1)
+                return kilobytes * 1024;
+        }
+        return std::nullopt;
+#elif defined(__APPLE__)
+        auto usage = rusage {};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return std::nullopt;
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return std::nullopt;
+#endif
+    }
+
+    auto elapsedMs(Clock::time_point start) -> double
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /// @brief Drives the prompt suite against one loaded engine.
+    class Suite
+    {
+      public:
+        Suite(LlmEngine& engine, const SamplerConfig& sampler, int maxTokens):
+            _engine(engine), _sampler(sampler), _maxTokens(maxTokens)
+        {
+        }
+
+        auto run(LlmBenchmarkRun& results) -> VoidResult
+        {
+            auto const system = message(Role::System, SystemPrompt);
+
+            // Not reported: the first generation also pays for allocating buffers and samplers.
+            auto const warmUp = std::vector { system, message(Role::User, "Hello!") };
+            if (auto result = generate(warmUp, {}, 8); !result)
+                return std::unexpected(result.error());
+
+            auto chat = std::vector {
+                system, message(Role::User, "Explain in a few sentences what a terminal emulator does.")
+            };
+            auto reply = measure(results, "short-chat", chat, {});
+            if (!reply)
+                return std::unexpected(reply.error());
+
+            chat.push_back(message(Role::Assistant, reply->text));
+            chat.push_back(message(Role::User, "Now explain how it draws text on the screen."));
+            if (auto followUp = measure(results, "multi-turn", chat, {}); !followUp)
+                return std::unexpected(followUp.error());
+
+            auto const tools = std::vector { weatherTool() };
+            auto const toolTurn =
+                std::vector { system, message(Role::User, "What is the weather in Berlin right now?") };
+            if (auto called = measure(results, "tool-call", toolTurn, tools); !called)
+                return std::unexpected(called.error());
+
+            auto const longPrompt = fillContext(system);
+            if (!longPrompt)
+                return std::unexpected(longPrompt.error());
+            if (auto summary = measure(results, "long-prefill", *longPrompt, {}, 32); !summary)
+                return std::unexpected(summary.error());
+            return {};
+        }
+
+      private:
+        LlmEngine& _engine;
+        SamplerConfig _sampler;
+        int _maxTokens;
+
+        /// @brief Generates a response, stopping it after @p maxTokens streamed pieces.
+        auto generate(std::span<const ChatMessage> messages,
+                      std::span<const ToolDefinition> tools,
+                      int maxTokens) -> Result<GenerateResult>
+        {
+            auto stop = std::stop_source {};
+            auto pieces = 0;
+            auto const count = [&](std::string_view /*piece*/) {
+                if (++pieces >= maxTokens)
+                    stop.request_stop();
+            };
+            return _engine.generate(messages, tools, _sampler, count, {}, stop.get_token());
+        }
+
+        auto measure(LlmBenchmarkRun& results,
+                     std::string_view scenario,
+                     std::span<const ChatMessage> messages,
+                     std::span<const ToolDefinition> tools,
+                     std::optional<int> maxTokens = std::nullopt) -> Result<GenerateResult>
+        {
+            auto result = generate(messages, tools, maxTokens.value_or(_maxTokens));
+            if (result)
+                results.samples.push_back({ .scenario = std::string(scenario), .metrics = result->metrics });
+            return result;
+        }
+
+        /// @brief Returns a conversation whose prompt takes up about half of the context.
+        auto fillContext(const ChatMessage& system) -> Result<std::vector<ChatMessage>>
+        {
+            auto const prompt = [&](size_t paragraphs) {
+                auto text = std::string {};
+                text.reserve(paragraphs * FillerParagraph.size() + 64);
+                for (auto i = size_t { 0 }; i < paragraphs; ++i)
+                    text += FillerParagraph;
+                text += "\n\nSummarize the text above in one sentence.";
+                return std::vector { system, message(Role::User, text) };
+            };
+
+            auto const one = _engine.promptTokenCount(prompt(1));
+            auto const two = _engine.promptTokenCount(prompt(2));
+            if (!one)
+                return std::unexpected(one.error());
+            if (!two)
+                return std::unexpected(two.error());
+            auto const perParagraph = std::max(size_t { 1 }, *two - *one);
+            auto const target = static_cast<size_t>(_engine.contextSize()) / 2;
+            return prompt(target > *one ? 1 + (target - *one) / perParagraph : 1);
+        }
+    };
+
+    auto kvLabel(const LlmEngineConfig& config) -> std::string
+    {
+        if (config.kvCacheTypeK == config.kvCacheTypeV)
+            return std::string(kvCacheTypeName(config.kvCacheTypeK));
+        return std::format(
+            "{}/{}", kvCacheTypeName(config.kvCacheTypeK), kvCacheTypeName(config.kvCacheTypeV));
+    }
+
+    auto countLabel(int value, int automatic) -> std::string
+    {
+        return value == automatic ? std::string("auto") : std::to_string(value);
+    }
+
+} // namespace
+
+auto llmBenchmarkVariants(const LlmEngineConfig& base, const LlmBenchmarkMatrix& matrix)
+    -> std::vector<LlmBenchmarkVariant>
+{
+    auto const orBase = [](auto const& values, auto baseValue) {
+        return values.empty() ? std::vector { baseValue } : values;
+    };
+    auto const threads = orBase(matrix.threads, base.threads);
+    auto const gpuLayers = orBase(matrix.gpuLayers, base.gpuLayers);
+    // No KV type keeps the base's, which may differ between K and V.
+    auto kvTypes =
+        std::vector<std::optional<KvCacheType>>(matrix.kvCacheTypes.begin(), matrix.kvCacheTypes.end());
+    if (kvTypes.empty())
+        kvTypes.emplace_back();
+
+    auto variants = std::vector<LlmBenchmarkVariant> {};
+    variants.reserve(threads.size() * gpuLayers.size() * kvTypes.size());
+    for (auto const threadCount: threads)
+        for (auto const layers: gpuLayers)
+            for (auto const kv: kvTypes)
+            {
+                auto config = base;
+                config.threads = threadCount;
+                config.gpuLayers = layers;
+                if (kv)
+                    config.kvCacheTypeK = config.kvCacheTypeV = *kv;
+                auto label = std::format("threads={} gpu-layers={} kv={}",
+                                         countLabel(threadCount, 0),
+                                         countLabel(layers, -1),
+                                         kvLabel(config));
+                variants.push_back({ .label = std::move(label), .engine = std::move(config) });
+            }
+    return variants;
+}
+
+auto runLlmBenchmark(std::span<const LlmBenchmarkVariant> variants,
+                     const SamplerConfig& sampler,
+                     int maxTokens) -> std::vector<LlmBenchmarkRun>
+{
+    auto runs = std::vector<LlmBenchmarkRun> {};
+    runs.reserve(variants.size());
+    for (auto const& variant: variants)
+    {
+        log::info("Benchmarking {}", variant.label);
+        auto& run = runs.emplace_back();
+        run.variant = variant.label;
+        resetPeakResident();
+        {
+            // Scoped, so the model is unloaded before the next variant loads.
+            auto engine = LlmEngine();
+            auto const loadStart = Clock::now();
+            if (auto loaded = engine.load(variant.engine); !loaded)
+            {
+                run.error = loaded.error().message;
+                continue;
+            }
+            run.loadMs = elapsedMs(loadStart);
+
+            if (auto completed = Suite(engine, sampler, maxTokens).run(run); !completed)
+                run.error = completed.error().message;
+        }
+        run.peakResidentBytes = peakResidentBytes();
+    }
+    return runs;
+}
+
+auto formatLlmBenchmarkTable(std::span<const LlmBenchmarkRun> runs) -> std::string
+{
+    constexpr auto RowFormat = "{:<14} {:>8} {:>8} {:>12} {:>11} {:>10}\n";
+    auto out = std::string {};
+    for (auto const& run: runs)
+    {
+        std::format_to(std::back_inserter(out), "{}\n", run.variant);
+        if (!run.error.empty())
+            std::format_to(std::back_inserter(out), "  failed: {}\n", run.error);
+        if (run.samples.empty())
+        {
+            out += '\n';
+            continue;
+        }
+
+        auto const peak = run.peakResidentBytes ? std::format("{} MiB", *run.peakResidentBytes >> 20)
+                                                : std::string("unknown");
+        std::format_to(std::back_inserter(out), "  loaded in {:.0f} ms, peak RSS {}\n", run.loadMs, peak);
+        std::format_to(std::back_inserter(out),
+                       RowFormat,
+                       "  scenario",
+                       "prompt",
+                       "reused",
+                       "prefill t/s",
+                       "decode t/s",
+                       "TTFT ms");
+        for (auto const& sample: run.samples)
+        {
+            auto const& metrics = sample.metrics;
+            std::format_to(std::back_inserter(out),
+                           RowFormat,
+                           "  " + sample.scenario,
+                           metrics.promptTokens,
+                           metrics.reusedTokens,
+                           std::format("{:.1f}", sample.prefillTokensPerSecond()),
+                           std::format("{:.1f}", metrics.decodeTokensPerSecond()),
+                           std::format("{:.0f}", metrics.timeToFirstTokenMs));
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+auto llmBenchmarkJson(std::span<const LlmBenchmarkRun> runs) -> nlohmann::json
+{
+    auto result = nlohmann::json::array();
+    for (auto const& run: runs)
+    {
+        auto samples = nlohmann::json::array();
+        for (auto const& sample: run.samples)
+        {
+            auto const& metrics = sample.metrics;
+            samples.push_back({
+                { "scenario", sample.scenario },
+                { "promptTokens", metrics.promptTokens },
+                { "reusedTokens", metrics.reusedTokens },
+                { "generatedTokens", metrics.generatedTokens },
+                { "prefillMs", metrics.prefillMs },
+                { "prefillTokensPerSecond", sample.prefillTokensPerSecond() },
+                { "decodeMs", metrics.decodeMs },
+                { "decodeTokensPerSecond", metrics.decodeTokensPerSecond() },
+                { "timeToFirstTokenMs", metrics.timeToFirstTokenMs },
+            });
+        }
+
+        auto entry = nlohmann::json {
+            { "variant", run.variant },
+            { "loadMs", run.loadMs },
+            { "samples", std::move(samples) },
+        };
+        entry["peakResidentBytes"] =
+            run.peakResidentBytes ? nlohmann::json(*run.peakResidentBytes) : nlohmann::json(nullptr);
+        if (!run.error.empty())
+            entry["error"] = run.error;
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+} // namespace mychat
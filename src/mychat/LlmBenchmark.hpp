@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <core/Types.hpp>
+#include <llm/LlmEngine.hpp>
+#include <llm/Sampler.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief An engine configuration compared by the LLM benchmark.
+struct LlmBenchmarkVariant
+{
+    std::string label; ///< Names the settings that differ, e.g. "threads=8 gpu-layers=99 kv=q8_0".
+    LlmEngineConfig engine;
+};
+
+/// @brief The settings to compare; each empty list keeps the value of the base configuration.
+struct LlmBenchmarkMatrix
+{
+    std::vector<int> threads;
+    std::vector<int> gpuLayers;
+    std::vector<KvCacheType> kvCacheTypes; ///< Used for both the K and the V cache.
+};
+
+/// @brief Returns every combination of the settings in @p matrix applied to @p base.
+[[nodiscard]] auto llmBenchmarkVariants(const LlmEngineConfig& base, const LlmBenchmarkMatrix& matrix)
+    -> std::vector<LlmBenchmarkVariant>;
+
+/// @brief The measurements of one prompt of the suite.
+struct LlmBenchmarkSample
+{
+    std::string scenario;
+    GenerateMetrics metrics;
+
+    /// @brief Returns the prefill throughput in tokens per second, counting only decoded tokens.
+    [[nodiscard]] auto prefillTokensPerSecond() const -> double
+    {
+        auto const decoded = metrics.promptTokens - metrics.reusedTokens;
+        return metrics.prefillMs > 0.0 ? decoded * 1000.0 / metrics.prefillMs : 0.0;
+    }
+};
+
+/// @brief The results of running the prompt suite with one variant.
+struct LlmBenchmarkRun
+{
+    std::string variant;
+    std::string error;  ///< Why the variant could not be measured; empty if it was.
+    double loadMs = 0.0;
+    std::optional<size_t> peakResidentBytes; ///< Peak RSS while loading and running, if known.
+    std::vector<LlmBenchmarkSample> samples;
+};
+
+/// @brief Loads each variant in turn and runs the fixed prompt suite with it.
+///
+/// The suite is a short chat, a follow-up in the same conversation (which reuses its KV cache),
+/// a turn offering a tool, and a prompt filling half the context. Each response is cut off after
+/// @p maxTokens streamed pieces, so decode rates are comparable. A warm-up generation precedes
+/// the suite. A variant that fails to load is reported as such and the others still run.
+/// @param variants The configurations to compare.
+/// @param sampler Sampling settings; use a fixed seed to compare runs.
+/// @param maxTokens Upper bound of each response.
+[[nodiscard]] auto runLlmBenchmark(std::span<const LlmBenchmarkVariant> variants,
+                                   const SamplerConfig& sampler,
+                                   int maxTokens = 128) -> std::vector<LlmBenchmarkRun>;
+
+/// @brief Formats the results as a table with one row per variant and scenario.
+[[nodiscard]] auto formatLlmBenchmarkTable(std::span<const LlmBenchmarkRun> runs) -> std::string;
+
+/// @brief Returns the results as JSON, an array with one object per variant.
+[[nodiscard]] auto llmBenchmarkJson(std::span<const LlmBenchmarkRun> runs) -> nlohmann::json;
+
+} // namespace mychat
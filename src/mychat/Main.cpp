@@ -1,11 +1,143 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <core/Log.hpp>
+#include <core/Trace.hpp>
 #include <mychat/App.hpp>
+#include <mychat/AutoTune.hpp>
+#include <mychat/Batch.hpp>
+#include <mychat/ChatServer.hpp>
 #include <mychat/Config.hpp>
+#include <mychat/LlmBenchmark.hpp>
+#include <mychat/VoiceBenchmark.hpp>
 
 #include <CLI/CLI.hpp>
 
+#include <algorithm>
 #include <format>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /// @brief Writes out the trace, if one is recorded, and closes the log file.
+    void closeOutputs()
+    {
+        if (auto traceResult = mychat::trace::stop(); !traceResult)
+            mychat::log::warning("{}", traceResult.error().message);
+        mychat::log::closeFileSink();
+    }
+
+    /// @brief Runs the --bench-llm prompt suite for each configuration and prints the results.
+    auto benchmarkLlm(mychat::AppConfig const& config, mychat::LlmBenchmarkMatrix const& matrix, bool json)
+        -> int
+    {
+        auto engineConfig = mychat::llmEngineConfig(config.llm);
+        if (engineConfig.modelPath.empty())
+        {
+            auto path = mychat::downloadedModelPath();
+            if (!path)
+            {
+                mychat::log::error("No model to benchmark; pass --model or download one by running mychat");
+                return 1;
+            }
+            engineConfig.modelPath = std::move(*path);
+        }
+
+        // A fixed seed, so that every configuration generates the same text.
+        auto sampler = mychat::samplerConfig(config.llm);
+        sampler.seed = 42;
+
+        auto const variants = mychat::llmBenchmarkVariants(engineConfig, matrix);
+        auto const runs = mychat::runLlmBenchmark(variants, sampler);
+        if (json)
+            std::println("{}", mychat::llmBenchmarkJson(runs).dump(2));
+        else
+            std::print("{}", mychat::formatLlmBenchmarkTable(runs));
+        return std::ranges::all_of(runs, [](auto const& run) { return run.error.empty(); }) ? 0 : 1;
+    }
+
+    /// @brief Plays @p audioFile through the voice pipeline and prints the latencies, for --bench-voice.
+    auto benchmarkVoice(mychat::AppConfig const& config, std::string const& audioFile, bool json) -> int
+    {
+        auto const samples = mychat::runVoiceBenchmark(config, audioFile);
+        if (!samples)
+        {
+            mychat::log::error("Voice benchmark failed: {}", samples.error().message);
+            return 1;
+        }
+        if (json)
+            std::println("{}", mychat::voiceBenchmarkJson(*samples).dump(2));
+        else
+            std::print("{}", mychat::formatVoiceBenchmarkTable(*samples));
+        return samples->empty() ? 1 : 0;
+    }
+
+    /// @brief Finds the fastest engine settings for this machine and writes them to @p configPath,
+    ///        for --autotune.
+    auto autotuneConfig(mychat::AppConfig const& config, std::string const& configPath) -> int
+    {
+        auto tuned = mychat::autotune(config);
+        if (!tuned)
+        {
+            mychat::log::error("Auto-tuning failed: {}", tuned.error().message);
+            return 1;
+        }
+        std::print("{}", tuned->report);
+        std::println("Reference turn: {:.0f} ms", *tuned->turnMs);
+        if (tuned->realTimeFactor)
+            std::println("Transcription: {:.3f}x real time", *tuned->realTimeFactor);
+
+        auto const path = configPath.empty() ? mychat::defaultConfigPath() : configPath;
+        if (auto saved = mychat::saveConfigToFile(path, tuned->config); !saved)
+        {
+            mychat::log::error("Failed to save the tuned settings: {}", saved.error().message);
+            return 1;
+        }
+        std::println("Saved the fastest settings to {}", path);
+        return 0;
+    }
+
+    /// @brief Answers the prompts of @p inputPath (or stdin) without a terminal, for --batch.
+    auto answerBatch(mychat::AppConfig const& config,
+                     std::string const& inputPath,
+                     std::string const& outputPath,
+                     int parallel) -> int
+    {
+        auto inputFile = std::ifstream {};
+        if (!inputPath.empty() && inputPath != "-")
+        {
+            inputFile.open(inputPath);
+            if (!inputFile)
+            {
+                mychat::log::error("Cannot open batch input: {}", inputPath);
+                return 1;
+            }
+        }
+        auto outputFile = std::ofstream {};
+        if (!outputPath.empty() && outputPath != "-")
+        {
+            outputFile.open(outputPath);
+            if (!outputFile)
+            {
+                mychat::log::error("Cannot open batch output: {}", outputPath);
+                return 1;
+            }
+        }
+
+        auto& input = inputFile.is_open() ? static_cast<std::istream&>(inputFile) : std::cin;
+        auto& output = outputFile.is_open() ? static_cast<std::ostream&>(outputFile) : std::cout;
+        auto const summary = mychat::runBatch(config, input, output, parallel);
+        if (!summary)
+        {
+            mychat::log::error("Batch failed: {}", summary.error().message);
+            return 1;
+        }
+        mychat::log::info("Batch done: {} item(s), {} failed", summary->items, summary->failed);
+        return summary->failed == 0 ? 0 : 2;
+    }
+} // namespace
 
 int main(int argc, char** argv)
 {
@@ -16,30 +148,100 @@ int main(int argc, char** argv)
     auto contextSize = 0;
     auto gpuLayers = -1;
     auto temperature = 0.0f;
+    auto batchSize = 0;
+    auto ubatchSize = 0;
+    auto draftModelPath = std::string {};
+    auto promptLookup = false;
+    auto cacheTypeK = std::string {};
+    auto cacheTypeV = std::string {};
+    auto flashAttention = std::string {};
     auto voiceMode = std::string {};
     auto verbose = false;
     auto showLog = false;
+    auto logFile = std::string {};
+    auto logJson = false;
+    auto traceFile = std::string {};
+    auto batch = false;
+    auto batchInput = std::string {};
+    auto batchOutput = std::string {};
+    auto batchParallel = 1;
+    auto benchLlm = false;
+    auto benchJson = false;
+    auto benchThreads = std::vector<int> {};
+    auto benchGpuLayers = std::vector<int> {};
+    auto benchKvTypes = std::vector<std::string> {};
+    auto benchVoice = std::string {};
+    auto runAutotune = false;
+    auto serve = false;
+    auto serverConfig = mychat::ChatServerConfig {};
 
     app.add_option("-m,--model", modelPath, "Path to GGUF model file");
     app.add_option("-c,--config", configPath, "Path to config file");
     app.add_option("--context-size", contextSize, "Context window size");
     app.add_option("--gpu-layers", gpuLayers, "Number of GPU layers (-1 = auto)");
+    app.add_option("--batch-size", batchSize, "Prompt processing batch size (n_batch)");
+    app.add_option("--ubatch-size", ubatchSize, "Physical micro-batch size (n_ubatch)");
     app.add_option("--temperature", temperature, "Sampling temperature");
+    app.add_option("--draft-model", draftModelPath, "Path to GGUF draft model for speculative decoding");
+    app.add_flag("--prompt-lookup", promptLookup, "Speculative decoding by n-gram lookup in the context");
+    app.add_option("--cache-type-k", cacheTypeK, "KV cache type for K (f16|q8_0|q4_0)");
+    app.add_option("--cache-type-v", cacheTypeV, "KV cache type for V (f16|q8_0|q4_0)");
+    app.add_option("--flash-attn", flashAttention, "Flash attention (auto|on|off)");
     app.add_option("--voice-mode", voiceMode, "Voice input mode (push-to-talk|vad)");
     app.add_flag("-v,--verbose", verbose, "Enable verbose logging");
     app.add_flag("--log", showLog, "Expand the log panel on startup");
+    app.add_option("--log-file", logFile, "Also write log messages to this file, rotated at 8 MiB");
+    app.add_flag("--log-json", logJson, "Write the log file as JSON lines");
+    app.add_option("--trace", traceFile, "Record a trace of the session to this file, for Perfetto");
+    app.add_flag("--batch", batch, "Answer prompts, one per line, without the TUI, then exit");
+    app.add_option("--batch-input", batchInput, "Read --batch prompts from this JSONL file instead of stdin");
+    app.add_option("--batch-output", batchOutput, "Write --batch results to this file instead of stdout");
+    app.add_option("--batch-parallel", batchParallel, "Number of --batch prompts answered at the same time");
+    app.add_flag("--bench-llm", benchLlm, "Measure LLM throughput with a fixed prompt suite, then exit");
+    app.add_option("--bench-threads", benchThreads, "Thread counts for --bench-llm to compare (e.g. 4,8)")
+        ->delimiter(',');
+    app.add_option("--bench-gpu-layers", benchGpuLayers, "GPU layer counts for --bench-llm to compare")
+        ->delimiter(',');
+    app.add_option("--bench-kv-types", benchKvTypes, "KV cache types for --bench-llm to compare")
+        ->delimiter(',');
+    app.add_option("--bench-voice", benchVoice, "Measure voice latency with this audio file, then exit");
+    app.add_flag("--bench-json", benchJson, "Print the --bench-llm or --bench-voice results as JSON");
+    app.add_flag("--autotune", runAutotune, "Find the fastest engine settings and save them to the config");
+    app.add_flag("--serve", serve, "Serve the model over an OpenAI-compatible HTTP API instead of the TUI");
+    app.add_option("--serve-address", serverConfig.address, "IPv4 address for --serve to listen on")
+        ->capture_default_str();
+    app.add_option("--serve-port", serverConfig.port, "Port for --serve to listen on")->capture_default_str();
+    app.add_option("--serve-queue", serverConfig.maxQueuedRequests, "Requests --serve lets wait at most")
+        ->capture_default_str();
+    app.add_option("--serve-parallel", serverConfig.parallelRequests, "Requests --serve answers at once")
+        ->capture_default_str();
 
     CLI11_PARSE(app, argc, argv);
 
     if (verbose)
         mychat::log::setLevel(mychat::log::Level::Debug);
 
+    if (!logFile.empty())
+    {
+        auto const format = logJson ? mychat::log::FileFormat::JsonLines : mychat::log::FileFormat::Text;
+        auto sinkResult = mychat::log::openFileSink({ .path = logFile, .format = format });
+        if (!sinkResult)
+            mychat::log::warning("{}", sinkResult.error().message);
+    }
+
+    if (!traceFile.empty())
+    {
+        if (auto traceResult = mychat::trace::start(traceFile); !traceResult)
+            mychat::log::warning("{}", traceResult.error().message);
+    }
+
     // Load config
     auto configResult = configPath.empty() ? mychat::loadConfig() : mychat::loadConfigFromFile(configPath);
 
     if (!configResult)
     {
         mychat::log::error("Failed to load config: {}", configResult.error().message);
+        closeOutputs();
         return 1;
     }
 
@@ -52,8 +254,36 @@ int main(int argc, char** argv)
         config.llm.contextSize = contextSize;
     if (gpuLayers != -1)
         config.llm.gpuLayers = gpuLayers;
+    if (batchSize > 0)
+        config.llm.batchSize = batchSize;
+    if (ubatchSize > 0)
+        config.llm.ubatchSize = ubatchSize;
     if (temperature > 0.0f)
         config.llm.temperature = temperature;
+    if (!draftModelPath.empty())
+        config.llm.draftModelPath = draftModelPath;
+    if (promptLookup)
+        config.llm.promptLookup = true;
+    if (!cacheTypeK.empty())
+    {
+        if (auto const type = mychat::parseKvCacheType(cacheTypeK))
+            config.llm.kvCacheTypeK = *type;
+        else
+            mychat::log::warning("Ignoring unknown KV cache type: {}", cacheTypeK);
+    }
+    if (!cacheTypeV.empty())
+    {
+        if (auto const type = mychat::parseKvCacheType(cacheTypeV))
+            config.llm.kvCacheTypeV = *type;
+        else
+            mychat::log::warning("Ignoring unknown KV cache type: {}", cacheTypeV);
+    }
+    if (flashAttention == "on")
+        config.llm.flashAttention = mychat::FlashAttention::Enabled;
+    else if (flashAttention == "off")
+        config.llm.flashAttention = mychat::FlashAttention::Disabled;
+    else if (flashAttention == "auto")
+        config.llm.flashAttention = mychat::FlashAttention::Auto;
     if (!voiceMode.empty())
     {
         if (voiceMode == "vad")
@@ -65,13 +295,72 @@ int main(int argc, char** argv)
     if (showLog)
         config.logPanelExpanded = true;
 
-    auto application = mychat::App(std::move(config));
-    auto initResult = application.initialize();
-    if (!initResult)
+    if (batch)
     {
-        mychat::log::error("Initialization failed: {}", initResult.error().message);
-        return 1;
+        auto const exitCode = answerBatch(config, batchInput, batchOutput, batchParallel);
+        closeOutputs();
+        return exitCode;
+    }
+
+    if (serve)
+    {
+        auto exitCode = 0;
+        if (auto served = mychat::serveChat(config, std::move(serverConfig)); !served)
+        {
+            mychat::log::error("Server failed: {}", served.error().message);
+            exitCode = 1;
+        }
+        closeOutputs();
+        return exitCode;
+    }
+
+    if (runAutotune)
+    {
+        auto const exitCode = autotuneConfig(config, configPath);
+        closeOutputs();
+        return exitCode;
+    }
+
+    if (!benchVoice.empty())
+    {
+        auto const exitCode = benchmarkVoice(config, benchVoice, benchJson);
+        closeOutputs();
+        return exitCode;
+    }
+
+    if (benchLlm)
+    {
+        auto matrix = mychat::LlmBenchmarkMatrix {
+            .threads = benchThreads,
+            .gpuLayers = benchGpuLayers,
+            .kvCacheTypes = {},
+        };
+        for (auto const& name: benchKvTypes)
+        {
+            if (auto const type = mychat::parseKvCacheType(name))
+                matrix.kvCacheTypes.push_back(*type);
+            else
+                mychat::log::warning("Ignoring unknown KV cache type: {}", name);
+        }
+        auto const exitCode = benchmarkLlm(config, matrix, benchJson);
+        closeOutputs();
+        return exitCode;
+    }
+
+    auto exitCode = 0;
+    {
+        auto application = mychat::App(std::move(config));
+        auto initResult = application.initialize();
+        if (!initResult)
+        {
+            mychat::log::error("Initialization failed: {}", initResult.error().message);
+            exitCode = 1;
+        }
+        else
+            exitCode = application.run();
     }
 
-    return application.run();
+    // After the App's threads are gone, so that nothing logs or traces while the files close
+    closeOutputs();
+    return exitCode;
 }
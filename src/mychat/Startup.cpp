@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Startup.hpp"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+namespace mychat
+{
+
+ComponentStartup::ComponentStartup(std::function<void()> notify): _notify(std::move(notify))
+{
+}
+
+ComponentStartup::~ComponentStartup()
+{
+    stop();
+}
+
+void ComponentStartup::add(StartupComponent& component, Task task)
+{
+    component._state.store(ComponentState::Loading, std::memory_order_release);
+    _entries.push_back(Entry { .component = &component, .task = std::move(task), .worker = {} });
+}
+
+void ComponentStartup::start()
+{
+    for (auto& entry: _entries)
+    {
+        if (entry.worker.joinable())
+            continue;
+        entry.worker = std::jthread([this, &entry](std::stop_token stopToken) {
+            auto const ready = entry.task(std::move(stopToken));
+            finish(*entry.component, ready ? ComponentState::Ready : ComponentState::Failed);
+        });
+    }
+}
+
+void ComponentStartup::stop()
+{
+    for (auto& entry: _entries)
+        entry.worker.request_stop();
+    for (auto& entry: _entries)
+        if (entry.worker.joinable())
+            entry.worker.join();
+}
+
+auto ComponentStartup::downloadProgress(StartupComponent& component) -> DownloadProgressCallback
+{
+    return [this, &component](DownloadProgress const& progress) {
+        auto percent = -1;
+        if (!progress.done && progress.total > 0)
+            percent = static_cast<int>(progress.received * 100 / progress.total);
+        if (component._downloadPercent.exchange(percent, std::memory_order_relaxed) != percent && _notify)
+            _notify();
+    };
+}
+
+auto ComponentStartup::text() const -> std::string
+{
+    auto const loading = [](Entry const& entry) {
+        return entry.component->state() == ComponentState::Loading;
+    };
+    if (std::ranges::none_of(_entries, loading))
+        return {};
+
+    auto text = std::string {};
+    for (auto const& entry: _entries)
+    {
+        auto const& component = *entry.component;
+        if (!text.empty())
+            text += "  ";
+        switch (component.state())
+        {
+            case ComponentState::Loading:
+                if (auto const percent = component.downloadPercent(); percent >= 0)
+                    text += std::format("{}: downloading {}%", component.label(), percent);
+                else
+                    text += std::format("{}: loading", component.label());
+                break;
+            case ComponentState::Ready: text += std::format("{}: ready", component.label()); break;
+            case ComponentState::Failed: text += std::format("{}: failed", component.label()); break;
+            case ComponentState::Disabled: break;
+        }
+    }
+    return text;
+}
+
+void ComponentStartup::finish(StartupComponent& component, ComponentState state)
+{
+    component._state.store(state, std::memory_order_release);
+    component._state.notify_all();
+    if (_notify)
+        _notify();
+}
+
+} // namespace mychat
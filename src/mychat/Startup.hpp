@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "Downloader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief Readiness of a component that is initialized in the background at startup.
+enum class ComponentState : std::uint8_t
+{
+    Disabled, ///< Not configured, so never started.
+    Loading,
+    Ready,
+    Failed,
+};
+
+/// @brief A component initialized on a worker thread while the TUI is already up.
+///
+/// The worker publishes what it initialized before the state turns Ready; the UI thread takes the
+/// component over once adopt() returns true.
+class StartupComponent
+{
+  public:
+    explicit StartupComponent(std::string_view label): _label(label) {}
+
+    /// @brief Names the component in the status bar.
+    [[nodiscard]] auto label() const noexcept -> std::string_view { return _label; }
+
+    [[nodiscard]] auto state() const noexcept -> ComponentState
+    {
+        return _state.load(std::memory_order_acquire);
+    }
+
+    /// @brief Returns the progress of the component's model download in percent; -1 if there is none.
+    [[nodiscard]] auto downloadPercent() const noexcept -> int
+    {
+        return _downloadPercent.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Blocks while the component is loading, e.g. in the task of one that needs it.
+    void waitWhileLoading() const noexcept
+    {
+        _state.wait(ComponentState::Loading, std::memory_order_acquire);
+    }
+
+    /// @brief Returns true on the first call that finds the component ready, and false otherwise.
+    ///
+    /// From then on, the caller sees what the component's task published. Call from one thread only.
+    [[nodiscard]] auto adopt() noexcept -> bool
+    {
+        if (_adopted || state() != ComponentState::Ready)
+            return false;
+        _adopted = true;
+        return true;
+    }
+
+  private:
+    friend class ComponentStartup;
+
+    std::string_view _label;
+    std::atomic<ComponentState> _state = ComponentState::Disabled;
+    std::atomic<int> _downloadPercent = -1;
+    bool _adopted = false;
+};
+
+/// @brief Initializes components concurrently, each on a worker thread of its own.
+///
+/// A component that fails or takes long leaves the others alone: each publishes its own state
+/// the moment its task returns.
+class ComponentStartup
+{
+  public:
+    /// @brief Initializes a component; returns whether it is ready for use.
+    using Task = std::function<bool(std::stop_token)>;
+
+    /// @param notify Called on the workers whenever a component's state or download progress changes.
+    explicit ComponentStartup(std::function<void()> notify = {});
+    ComponentStartup(ComponentStartup const&) = delete;
+    ComponentStartup& operator=(ComponentStartup const&) = delete;
+
+    /// @brief Stops the tasks that are still running and waits for them.
+    ~ComponentStartup();
+
+    /// @brief Marks @p component as loading, to be initialized by @p task once start() is called.
+    ///
+    /// Components that are never added stay Disabled.
+    void add(StartupComponent& component, Task task);
+
+    /// @brief Runs the tasks of the added components, each on a worker thread of its own.
+    ///
+    /// All components are marked loading before any task runs, so a task can tell which of the
+    /// others to wait for.
+    void start();
+
+    /// @brief Asks the tasks still running to stop and waits for them.
+    ///
+    /// Tasks that do not watch their stop token, like loading a model, are waited for.
+    void stop();
+
+    /// @brief Returns a progress callback that records the model download of @p component.
+    [[nodiscard]] auto downloadProgress(StartupComponent& component) -> DownloadProgressCallback;
+
+    /// @brief Describes how far the components got, e.g. "Model: loading  Tools: ready".
+    /// @return The description, or an empty string once none is loading.
+    [[nodiscard]] auto text() const -> std::string;
+
+  private:
+    struct Entry
+    {
+        StartupComponent* component;
+        Task task;
+        std::jthread worker;
+    };
+
+    std::function<void()> _notify;
+    std::vector<Entry> _entries;
+
+    void finish(StartupComponent& component, ComponentState state);
+};
+
+} // namespace mychat
@@ -0,0 +1,334 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "VoiceBenchmark.hpp"
+
+#include <audio/AudioFileSource.hpp>
+#include <audio/AudioPipeline.hpp>
+#include <audio/SpeechChunker.hpp>
+#include <audio/TtsSpeaker.hpp>
+#include <core/CpuBudget.hpp>
+#include <core/Log.hpp>
+#include <llm/LlmEngine.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace mychat
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /// Silence after the file's last utterance, so that voice activity detection ends it.
+    constexpr auto TrailingSilenceMs = 2000.0f;
+
+    /// How long to wait for the last utterance's transcript after the file was played; whisper
+    /// drops utterances it finds no words in.
+    constexpr auto LastTranscriptTimeout = std::chrono::seconds(10);
+
+    auto msBetween(Clock::time_point from, Clock::time_point to) -> double
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    auto message(Role role, std::string content) -> ChatMessage
+    {
+        return ChatMessage {
+            .role = role,
+            .content = std::move(content),
+            .toolCalls = {},
+            .toolCallId = {},
+        };
+    }
+
+    /// @brief An utterance the pipeline transcribed, waiting for the benchmark to answer it.
+    struct Utterance
+    {
+        std::string text;
+        Clock::time_point speechEnd; ///< When the user stopped speaking.
+        Clock::time_point transcribed;
+    };
+
+    /// @brief What the pipeline's worker thread hands to the benchmark's thread.
+    struct Handoff
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Utterance> utterances;
+        std::optional<Clock::time_point> speechEnd; ///< Of the utterance being transcribed.
+        std::optional<Clock::time_point> firstAudio;
+    };
+
+    auto loadEngine(AppConfig const& config, LlmEngine& engine) -> VoidResult
+    {
+        auto engineConfig = llmEngineConfig(config.llm);
+        if (engineConfig.modelPath.empty())
+        {
+            auto path = downloadedModelPath();
+            if (!path)
+                return makeError(ErrorCode::ConfigError,
+                                 "No model to benchmark; pass --model or download one by running mychat");
+            engineConfig.modelPath = std::move(*path);
+        }
+        return engine.load(engineConfig);
+    }
+
+    /// @brief Returns the speaker for the configured voice, or nothing if its model is not there.
+    auto createSpeaker(AppConfig const& config) -> Result<std::unique_ptr<TtsSpeaker>>
+    {
+        auto const modelPath = config.tts.modelPath.empty() ? defaultTtsModelPath() : config.tts.modelPath;
+        if (!std::filesystem::exists(modelPath))
+        {
+            log::info("No TTS model, measuring without speech output");
+            return std::unique_ptr<TtsSpeaker> {};
+        }
+
+        auto speaker = std::make_unique<TtsSpeaker>();
+        auto ttsConfig = TtsSpeakerConfig {
+            .modelPath = modelPath,
+            .espeakDataPath = config.tts.espeakDataPath,
+            .phraseCacheBytes = static_cast<size_t>(std::max(0, config.tts.phraseCacheMb)) * 1024 * 1024,
+            .phraseCacheDirectory = {},
+        };
+        if (auto initialized = speaker->initialize(ttsConfig); !initialized)
+            return std::unexpected(initialized.error());
+        return speaker;
+    }
+
+    auto median(std::vector<double> values) -> std::optional<double>
+    {
+        if (values.empty())
+            return std::nullopt;
+        auto const middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+        std::ranges::nth_element(values, middle);
+        return *middle;
+    }
+
+    auto formatMs(std::optional<double> ms) -> std::string
+    {
+        return ms ? std::format("{:.0f}", *ms) : std::string("-");
+    }
+
+    auto jsonMs(std::optional<double> ms) -> nlohmann::json
+    {
+        return ms ? nlohmann::json(*ms) : nlohmann::json(nullptr);
+    }
+} // namespace
+
+auto runVoiceBenchmark(AppConfig const& config, std::filesystem::path const& audioFile)
+    -> Result<std::vector<VoiceLatencySample>>
+{
+    auto const whisperModelPath =
+        config.audio.whisperModelPath.empty() ? defaultWhisperModelPath() : config.audio.whisperModelPath;
+    if (!std::filesystem::exists(whisperModelPath))
+        return makeError(ErrorCode::AudioError, std::format("Whisper model not found: {}", whisperModelPath));
+
+    // Before the speaker and the pipeline, whose threads use it until they are destroyed.
+    auto handoff = Handoff {};
+    auto engine = LlmEngine();
+    if (auto loaded = loadEngine(config, engine); !loaded)
+        return std::unexpected(loaded.error());
+    auto speaker = createSpeaker(config);
+    if (!speaker)
+        return std::unexpected(speaker.error());
+    auto& tts = *speaker;
+
+    if (tts)
+        tts->setAudioStartCallback([&handoff] {
+            auto const now = Clock::now();
+            auto lock = std::lock_guard(handoff.mutex);
+            handoff.firstAudio = now;
+        });
+
+    // Real time, so that voice activity detection sees the same timing as from a microphone.
+    auto source = std::make_unique<AudioFileSource>(AudioFileSourceConfig {
+        .path = audioFile,
+        .speed = 1.0,
+        .trailingSilenceMs = TrailingSilenceMs,
+    });
+    auto& file = *source;
+
+    auto const silenceMs = static_cast<double>(config.audio.silenceDurationMs);
+    auto pipeline = AudioPipeline();
+    pipeline.setAudioSource(std::move(source));
+    pipeline.setSpeechEndCallback([&handoff, silenceMs] {
+        auto const now = Clock::now();
+        auto lock = std::lock_guard(handoff.mutex);
+        handoff.speechEnd = now - std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double, std::milli>(silenceMs));
+    });
+
+    auto const cpus = detectCpuTopology();
+    auto pipelineConfig = AudioPipelineConfig {
+        .whisperModelPath = whisperModelPath,
+        .vadModelPath = config.audio.vadModelPath,
+        .language = config.audio.language,
+        .deviceName = {},
+        .mode = AudioMode::VoiceActivityDetection,
+        .silenceDurationMs = static_cast<float>(config.audio.silenceDurationMs),
+        .transcriptionThreads =
+            config.audio.threads > 0
+                ? config.audio.threads
+                : planThreads(cpus, CpuWorkloads { .transcription = true, .speech = tts != nullptr })
+                      .transcriptionThreads,
+        .partialIntervalMs = static_cast<float>(config.audio.partialIntervalMs),
+        .maxUtteranceMs = static_cast<float>(config.audio.maxUtteranceMs),
+        .useGpu = config.audio.useGpu,
+        .flashAttention = config.audio.flashAttention,
+        .beamSize = config.audio.beamSize,
+        .reduceAudioContext = config.audio.reduceAudioContext,
+        .warmUp = true,
+    };
+    auto initialized = pipeline.initialize(pipelineConfig, [&handoff, &file](std::string text) {
+        auto const now = Clock::now();
+        // The file waits while the reply is generated and spoken, as a user would.
+        file.stop();
+        auto lock = std::lock_guard(handoff.mutex);
+        handoff.utterances.push_back(Utterance {
+            .text = std::move(text),
+            .speechEnd = handoff.speechEnd.value_or(now),
+            .transcribed = now,
+        });
+        handoff.speechEnd.reset();
+        handoff.cv.notify_one();
+    });
+    if (!initialized)
+        return std::unexpected(initialized.error());
+
+    log::info("Playing {} ({:.1f} s)", audioFile.string(), static_cast<double>(file.fileSamples()) / 16000.0);
+    if (auto started = pipeline.start(); !started)
+        return std::unexpected(started.error());
+
+    auto const sampler = samplerConfig(config.llm);
+    auto conversation = std::vector { message(Role::System, config.llm.systemPrompt) };
+    auto samples = std::vector<VoiceLatencySample> {};
+    auto chunker = SpeechChunker();
+    auto chunks = std::vector<std::string> {};
+    auto finishedAt = std::optional<Clock::time_point> {};
+    while (true)
+    {
+        auto utterance = Utterance {};
+        {
+            auto lock = std::unique_lock(handoff.mutex);
+            handoff.cv.wait_for(
+                lock, std::chrono::milliseconds(50), [&] { return !handoff.utterances.empty(); });
+            if (handoff.utterances.empty())
+            {
+                // Done once the whole file was played and its last utterance transcribed.
+                if (file.finished() && !finishedAt)
+                    finishedAt = Clock::now();
+                if (finishedAt && (!handoff.speechEnd || Clock::now() - *finishedAt > LastTranscriptTimeout))
+                    break;
+                continue;
+            }
+            utterance = std::move(handoff.utterances.front());
+            handoff.utterances.pop_front();
+            handoff.firstAudio.reset();
+        }
+
+        auto sample = VoiceLatencySample {
+            .transcript = utterance.text,
+            .transcriptMs = msBetween(utterance.speechEnd, utterance.transcribed),
+            .firstTokenMs = {},
+            .firstAudioMs = {},
+        };
+        log::info("Transcribed \"{}\" in {:.0f} ms", sample.transcript, sample.transcriptMs);
+
+        conversation.push_back(message(Role::User, std::move(utterance.text)));
+        chunker.reset();
+        auto const onPiece = [&](std::string_view piece) {
+            if (!sample.firstTokenMs)
+                sample.firstTokenMs = msBetween(utterance.speechEnd, Clock::now());
+            if (!tts)
+                return;
+            chunks.clear();
+            chunker.feed(piece, chunks);
+            for (auto& chunk: chunks)
+                tts->speak(std::move(chunk));
+        };
+        auto reply = engine.generate(conversation, {}, sampler, onPiece);
+        if (!reply)
+        {
+            pipeline.stop();
+            return std::unexpected(reply.error());
+        }
+        conversation.push_back(message(Role::Assistant, reply->text));
+
+        if (tts)
+        {
+            chunks.clear();
+            chunker.finish(chunks);
+            for (auto& chunk: chunks)
+                tts->speak(std::move(chunk));
+            tts->flush();
+            auto lock = std::lock_guard(handoff.mutex);
+            if (handoff.firstAudio)
+                sample.firstAudioMs = msBetween(utterance.speechEnd, *handoff.firstAudio);
+        }
+        samples.push_back(std::move(sample));
+
+        if (auto resumed = file.start(); !resumed)
+        {
+            pipeline.stop();
+            return std::unexpected(resumed.error());
+        }
+    }
+    pipeline.stop();
+    return samples;
+}
+
+auto formatVoiceBenchmarkTable(std::span<const VoiceLatencySample> samples) -> std::string
+{
+    constexpr auto RowFormat = "{:<40} {:>13} {:>14} {:>14}\n";
+    auto out = std::format(RowFormat, "utterance", "transcript ms", "first token ms", "first audio ms");
+    auto transcripts = std::vector<double> {};
+    auto firstTokens = std::vector<double> {};
+    auto firstAudios = std::vector<double> {};
+    for (auto const& sample: samples)
+    {
+        auto const text =
+            sample.transcript.size() > 40 ? sample.transcript.substr(0, 37) + "..." : sample.transcript;
+        std::format_to(std::back_inserter(out),
+                       RowFormat,
+                       text,
+                       formatMs(sample.transcriptMs),
+                       formatMs(sample.firstTokenMs),
+                       formatMs(sample.firstAudioMs));
+        transcripts.push_back(sample.transcriptMs);
+        if (sample.firstTokenMs)
+            firstTokens.push_back(*sample.firstTokenMs);
+        if (sample.firstAudioMs)
+            firstAudios.push_back(*sample.firstAudioMs);
+    }
+    std::format_to(std::back_inserter(out),
+                   RowFormat,
+                   "median",
+                   formatMs(median(std::move(transcripts))),
+                   formatMs(median(std::move(firstTokens))),
+                   formatMs(median(std::move(firstAudios))));
+    return out;
+}
+
+auto voiceBenchmarkJson(std::span<const VoiceLatencySample> samples) -> nlohmann::json
+{
+    auto result = nlohmann::json::array();
+    for (auto const& sample: samples)
+    {
+        result.push_back({
+            { "transcript", sample.transcript },
+            { "transcriptMs", sample.transcriptMs },
+            { "firstTokenMs", jsonMs(sample.firstTokenMs) },
+            { "firstAudioMs", jsonMs(sample.firstAudioMs) },
+        });
+    }
+    return result;
+}
+
+} // namespace mychat
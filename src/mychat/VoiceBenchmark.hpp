@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <mychat/Config.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mychat
+{
+
+/// @brief The latencies of one spoken turn, each measured from when the user stopped speaking.
+struct VoiceLatencySample
+{
+    std::string transcript;
+    double transcriptMs = 0.0;          ///< Until the final transcript, including the VAD's silence.
+    std::optional<double> firstTokenMs; ///< Until the reply's first token, if it had one.
+    std::optional<double> firstAudioMs; ///< Until the reply's first audio was played, if spoken.
+};
+
+/// @brief Plays @p audioFile into the voice pipeline in place of the microphone, in real time, and
+///        measures how long each utterance in it takes to be transcribed, answered and spoken.
+///
+/// Uses the configured whisper model, LLM and, if its model is there, the piper voice. Each
+/// transcript is sent to the model as a user message of one conversation, and the reply is
+/// spoken while the file waits, as a user would. The end of speech is taken to be when voice
+/// activity detection ended the utterance less its silence duration (AudioConfig::silenceDurationMs).
+/// @return One sample per utterance, or an error if a model or the file could not be loaded.
+[[nodiscard]] auto runVoiceBenchmark(AppConfig const& config, std::filesystem::path const& audioFile)
+    -> Result<std::vector<VoiceLatencySample>>;
+
+/// @brief Formats the samples as a table with one row per utterance and a row of medians.
+[[nodiscard]] auto formatVoiceBenchmarkTable(std::span<const VoiceLatencySample> samples) -> std::string;
+
+/// @brief Returns the samples as JSON, an array with one object per utterance.
+[[nodiscard]] auto voiceBenchmarkJson(std::span<const VoiceLatencySample> samples) -> nlohmann::json;
+
+} // namespace mychat
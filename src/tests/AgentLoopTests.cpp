@@ -5,13 +5,257 @@
 // we test the AgentLoop logic indirectly through integration with
 // mock MCP transport.
 
+#include <agent/AgentLoop.hpp>
+#include <agent/AgentTrace.hpp>
+#include <agent/MemoryIndex.hpp>
 #include <core/Types.hpp>
 #include <llm/ChatSession.hpp>
+#include <mcp/JsonRpc.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
 using namespace mychat;
 
+namespace
+{
+    /// @brief Answers every prompt with the same text, recording what it was asked.
+    class FixedReplyEngine: public InferenceEngine
+    {
+      public:
+        explicit FixedReplyEngine(std::string reply): _reply(std::move(reply)) {}
+
+        auto generate(std::span<const ChatMessage> messages,
+                      std::span<const ToolDefinition> /*tools*/,
+                      const SamplerConfig& /*sampler*/,
+                      StreamCallback /*streamCb*/,
+                      ToolCallCallback /*toolCallCb*/,
+                      std::stop_token /*stopToken*/) -> Result<GenerateResult> override
+        {
+            prompts.push_back(messages.back().content);
+            return GenerateResult { .text = _reply, .toolCalls = {}, .cancelled = false, .metrics = {} };
+        }
+
+        void setContextOverflowPolicy(ContextOverflowPolicy /*policy*/) override {}
+
+        auto promptTokenCount(std::span<const ChatMessage> messages,
+                              std::span<const ToolDefinition> /*tools*/) -> Result<size_t> override
+        {
+            return messages.size();
+        }
+
+        [[nodiscard]] auto contextBudget() const -> size_t override { return 1 << 20; }
+
+        auto embed(std::string_view /*text*/) -> Result<std::vector<float>> override
+        {
+            return makeError(ErrorCode::InferenceError, "No embeddings");
+        }
+
+        std::vector<std::string> prompts; ///< The last message of each prompt.
+
+      private:
+        std::string _reply;
+    };
+
+    /// @brief Replies like FixedReplyEngine and hands out another engine once, for side tasks.
+    class SharingEngine: public FixedReplyEngine
+    {
+      public:
+        SharingEngine(std::string reply, std::unique_ptr<InferenceEngine> shared):
+            FixedReplyEngine(std::move(reply)),
+            _shared(std::move(shared))
+        {
+        }
+
+        auto shareEngine() const -> Result<std::unique_ptr<InferenceEngine>> override
+        {
+            if (!_shared)
+                return makeError(ErrorCode::InferenceError, "Already shared");
+            return std::move(_shared);
+        }
+
+      private:
+        mutable std::unique_ptr<InferenceEngine> _shared;
+    };
+
+    /// @brief Calls the echo tool once per turn and then reports what it returned.
+    class EchoCallingEngine: public InferenceEngine
+    {
+      public:
+        auto generate(std::span<const ChatMessage> messages,
+                      std::span<const ToolDefinition> tools,
+                      const SamplerConfig& /*sampler*/,
+                      StreamCallback streamCb,
+                      ToolCallCallback toolCallCb,
+                      std::stop_token /*stopToken*/) -> Result<GenerateResult> override
+        {
+            auto result = GenerateResult {};
+            if (messages.back().role == Role::User && !tools.empty())
+            {
+                auto call = ToolCall {
+                    .id = "call_0",
+                    .name = "echo",
+                    .arguments = { { "text", messages.back().content } },
+                };
+                if (toolCallCb)
+                    toolCallCb(call);
+                result.toolCalls.push_back(std::move(call));
+                return result;
+            }
+
+            for (auto const& piece: { std::string("The tool said: "), messages.back().content })
+            {
+                if (streamCb)
+                    streamCb(piece);
+                result.text += piece;
+            }
+            return result;
+        }
+
+        void setContextOverflowPolicy(ContextOverflowPolicy /*policy*/) override {}
+
+        auto promptTokenCount(std::span<const ChatMessage> messages,
+                              std::span<const ToolDefinition> /*tools*/) -> Result<size_t> override
+        {
+            return messages.size() * 10;
+        }
+
+        [[nodiscard]] auto contextBudget() const -> size_t override { return 4096; }
+
+        auto embed(std::string_view /*text*/) -> Result<std::vector<float>> override
+        {
+            return makeError(ErrorCode::InferenceError, "No embeddings");
+        }
+    };
+
+    /// @brief An MCP server in the same process, with one tool that returns its text argument.
+    class EchoServerTransport: public Transport
+    {
+      public:
+        auto send(nlohmann::json const& message) -> VoidResult override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            if (message.contains("id"))
+                _inbox.push(respond(message));
+            _changed.notify_all();
+            return {};
+        }
+
+        auto receive() -> Result<nlohmann::json> override
+        {
+            auto lock = std::unique_lock(_mutex);
+            _changed.wait(lock, [this] { return _closed || !_inbox.empty(); });
+            if (_inbox.empty())
+                return makeError(ErrorCode::TransportError, "Echo transport closed");
+            auto message = std::move(_inbox.front());
+            _inbox.pop();
+            return message;
+        }
+
+        void close() override
+        {
+            auto const lock = std::lock_guard(_mutex);
+            _closed = true;
+            _changed.notify_all();
+        }
+
+        [[nodiscard]] auto isConnected() const -> bool override { return true; }
+
+      private:
+        static auto respond(nlohmann::json const& request) -> nlohmann::json
+        {
+            auto const& id = request["id"];
+            auto const method = request.value("method", std::string {});
+            auto const params = request.value("params", nlohmann::json::object());
+            if (method == "initialize")
+            {
+                auto result = nlohmann::json {
+                    { "protocolVersion", "2024-11-05" },
+                    { "capabilities", { { "tools", nlohmann::json::object() } } },
+                    { "serverInfo", { { "name", "echo" }, { "version", "1.0" } } },
+                };
+                return jsonrpc::makeResponse(id, std::move(result));
+            }
+            if (method == "tools/list")
+            {
+                auto tool = nlohmann::json {
+                    { "name", "echo" },
+                    { "description", "Returns the given text." },
+                    { "inputSchema", { { "type", "object" } } },
+                };
+                return jsonrpc::makeResponse(id, { { "tools", nlohmann::json::array({ std::move(tool) }) } });
+            }
+            if (method == "tools/call")
+            {
+                auto content = nlohmann::json {
+                    { "type", "text" },
+                    { "text", params["arguments"].value("text", std::string {}) },
+                };
+                auto result = nlohmann::json {
+                    { "content", nlohmann::json::array({ std::move(content) }) },
+                    { "isError", false },
+                };
+                return jsonrpc::makeResponse(id, std::move(result));
+            }
+            return jsonrpc::makeErrorResponse(id, -32601, "Method not found");
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        std::queue<nlohmann::json> _inbox;
+        bool _closed = false;
+    };
+
+    auto echoServerConfig() -> McpServerConfig
+    {
+        auto config = McpServerConfig {};
+        config.name = "echo";
+        config.command = "echo-server";
+        config.lazyStart = false;
+        return config;
+    }
+
+    /// @brief Runs one turn through the echo server, recording it.
+    auto recordEchoTurn(std::string_view userMessage) -> AgentTrace
+    {
+        auto recorder = TraceRecorder {};
+        auto const record = recordingTransports(recorder);
+        auto servers = ServerManager();
+        servers.setTransportFactory([&record](McpServerConfig const& config, TransportOpener /*open*/) {
+            return record(config, [] {
+                return Result<std::unique_ptr<Transport>>(std::make_unique<EchoServerTransport>());
+            });
+        });
+        REQUIRE(servers.addServer(echoServerConfig()));
+
+        auto model = EchoCallingEngine {};
+        auto engine = RecordingEngine(model, recorder);
+        auto session = ChatSession("sys");
+        auto agent = AgentLoop(engine, session, servers, AgentConfig {});
+        auto const reply = agent.processMessage(userMessage, [](std::string_view /*piece*/) {});
+        REQUIRE(reply == std::format("The tool said: {}", userMessage));
+        return recorder.trace();
+    }
+
+    /// @brief Adds a turn whose single tool call returned @p resultBytes bytes.
+    void addToolTurn(ChatSession& session, std::string const& callId, size_t resultBytes)
+    {
+        session.addUserMessage("read it");
+        session.addAssistantMessage("", { ToolCall { .id = callId, .name = "read_file", .arguments = {} } });
+        session.addToolResult(callId, std::string(resultBytes, 'x'));
+        session.addAssistantMessage("done");
+    }
+} // namespace
+
 TEST_CASE("GenerateResult correctly identifies tool calls", "[agent]")
 {
     auto result = GenerateResult {};
@@ -21,6 +265,37 @@ TEST_CASE("GenerateResult correctly identifies tool calls", "[agent]")
     CHECK(result.hasToolCalls());
 }
 
+TEST_CASE("GenerateMetrics accumulates agent steps", "[agent]")
+{
+    auto total = GenerateMetrics {};
+    CHECK(total.decodeTokensPerSecond() == 0.0);
+
+    total += GenerateMetrics {
+        .promptTokens = 100,
+        .reusedTokens = 0,
+        .generatedTokens = 20,
+        .prefillMs = 50.0,
+        .timeToFirstTokenMs = 60.0,
+        .decodeMs = 400.0,
+    };
+    total += GenerateMetrics {
+        .promptTokens = 150,
+        .reusedTokens = 120,
+        .generatedTokens = 30,
+        .prefillMs = 10.0,
+        .timeToFirstTokenMs = 15.0,
+        .decodeMs = 600.0,
+    };
+
+    CHECK(total.promptTokens == 250);
+    CHECK(total.reusedTokens == 120);
+    CHECK(total.generatedTokens == 50);
+    CHECK(total.totalTokens() == 300);
+    CHECK(total.prefillMs == 60.0);
+    CHECK(total.timeToFirstTokenMs == 60.0); // Latency of the first step only
+    CHECK(total.decodeTokensPerSecond() == 50.0);
+}
+
 TEST_CASE("ChatSession supports full agent conversation flow", "[agent]")
 {
     auto session = ChatSession("You are a helpful assistant.");
@@ -65,3 +340,210 @@ TEST_CASE("ToolDefinition can be constructed", "[agent]")
     CHECK(tool.description == "A test tool");
     CHECK(tool.inputSchema.contains("type"));
 }
+
+TEST_CASE("truncateToolOutput keeps short output unchanged", "[agent]")
+{
+    CHECK(truncateToolOutput("short", 100) == "short");
+    CHECK(truncateToolOutput(std::string(1000, 'x'), 0) == std::string(1000, 'x'));
+}
+
+TEST_CASE("truncateToolOutput keeps the beginning and the end of long output", "[agent]")
+{
+    auto const text = std::string(600, 'a') + std::string(800, 'b') + std::string(600, 'c');
+    auto const truncated = truncateToolOutput(text, 1000);
+
+    CHECK(truncated.size() <= 1000);
+    CHECK(truncated.starts_with(std::string(600, 'a')));
+    CHECK(truncated.ends_with("c"));
+    CHECK(truncated.find("bytes omitted") != std::string::npos);
+}
+
+TEST_CASE("truncateToolOutput does not split UTF-8 sequences", "[agent]")
+{
+    auto text = std::string {};
+    for (auto i = 0; i < 500; ++i)
+        text += "\u00e4"; // Two bytes each.
+    auto const truncated = truncateToolOutput(text, 101);
+
+    auto const omitted = truncated.find("\n[...");
+    REQUIRE(omitted != std::string::npos);
+    CHECK(omitted % 2 == 0);
+    CHECK((truncated.size() - truncated.find("...]\n") - 5) % 2 == 0);
+}
+
+TEST_CASE("AgentLoop compacts tool results of turns outside the recency window", "[agent]")
+{
+    auto engine = FixedReplyEngine("reply");
+    auto session = ChatSession("sys");
+    auto servers = ServerManager();
+    addToolTurn(session, "old", 5000);
+    addToolTurn(session, "recent", 5000);
+
+    auto config = AgentConfig {};
+    config.toolResultRecencyTurns = 2; // The current turn and the one before.
+    config.compactedToolResultBytes = 200;
+    auto agent = AgentLoop(engine, session, servers, config);
+    REQUIRE(agent.processMessage("next") == "reply");
+
+    auto const& messages = session.messages();
+    CHECK(messages[3].content.size() <= 200);
+    CHECK(messages[3].content.starts_with("[5000 bytes of read_file output, compacted]\nxxx"));
+    CHECK(messages[7].content.size() == 5000);
+    CHECK(engine.prompts == std::vector<std::string> { "next" });
+}
+
+TEST_CASE("AgentLoop summarizes compacted tool results over the token threshold", "[agent]")
+{
+    auto engine = FixedReplyEngine("summary");
+    auto session = ChatSession("sys");
+    auto servers = ServerManager();
+    addToolTurn(session, "only", 5000);
+
+    auto config = AgentConfig {};
+    config.toolResultRecencyTurns = 0;
+    config.compactionTokenThreshold = 3; // One token per message with this engine.
+    config.summarizeToolResults = true;
+    auto agent = AgentLoop(engine, session, servers, config);
+    REQUIRE(agent.processMessage("next") == "summary");
+
+    CHECK(session.messages()[3].content == "[5000 bytes of read_file output, compacted]\nsummary");
+    REQUIRE(engine.prompts.size() == 2);
+    CHECK(engine.prompts[0].starts_with("Output of read_file:\nxxx"));
+    CHECK(agent.lastTurnMetrics().steps == 1);
+    CHECK(agent.lastTurnMetrics().summaries == 1);
+}
+
+TEST_CASE("AgentLoop summarizes on a shared engine, leaving the conversation's alone", "[agent]")
+{
+    auto summarizer = std::make_unique<FixedReplyEngine>("summary");
+    auto const& summaries = summarizer->prompts;
+    auto engine = SharingEngine("reply", std::move(summarizer));
+    auto session = ChatSession("sys");
+    auto servers = ServerManager();
+    addToolTurn(session, "only", 5000);
+
+    auto config = AgentConfig {};
+    config.toolResultRecencyTurns = 0;
+    config.compactionTokenThreshold = 3;
+    config.summarizeToolResults = true;
+    auto agent = AgentLoop(engine, session, servers, config);
+    REQUIRE(agent.processMessage("next") == "reply");
+
+    CHECK(session.messages()[3].content == "[5000 bytes of read_file output, compacted]\nsummary");
+    REQUIRE(summaries.size() == 1);
+    CHECK(summaries[0].starts_with("Output of read_file:\nxxx"));
+    CHECK(engine.prompts == std::vector<std::string> { "next" });
+    CHECK(agent.lastTurnMetrics().steps == 1);
+    CHECK(agent.lastTurnMetrics().summaries == 1);
+}
+
+TEST_CASE("AgentLoop puts notes from earlier conversations before the user message", "[agent][memory]")
+{
+    auto engine = FixedReplyEngine("reply");
+    auto session = ChatSession("sys");
+    auto servers = ServerManager();
+    auto memory = MemoryIndex([](std::string_view text) -> Result<std::vector<float>> {
+        return text.find("deploy") != std::string_view::npos ? std::vector { 1.0f, 0.0f }
+                                                              : std::vector { 0.0f, 1.0f };
+    });
+    auto const message = [](Role role, std::string content) {
+        return ChatMessage { .role = role, .content = std::move(content), .toolCalls = {}, .toolCallId = {} };
+    };
+    REQUIRE(memory.add("earlier",
+                       std::vector { message(Role::User, "How do we deploy?"),
+                                     message(Role::Assistant, "Run make deploy.") }));
+    REQUIRE(memory.add("current", std::vector { message(Role::User, "We deploy on Fridays.") }));
+
+    auto config = AgentConfig {};
+    config.memorySnippets = 5;
+    auto agent = AgentLoop(engine, session, servers, config);
+    agent.setMemory(&memory, "current");
+    REQUIRE(agent.processMessage("deploy it") == "reply");
+
+    CHECK(agent.lastTurnMetrics().memoryNotes == 2);
+    REQUIRE(engine.prompts.size() == 1);
+    auto const& prompt = engine.prompts.front();
+    CHECK(prompt.find("- User: How do we deploy?\n") != std::string::npos);
+    CHECK(prompt.find("- Assistant: Run make deploy.\n") != std::string::npos);
+    CHECK(prompt.find("Fridays") == std::string::npos);
+    CHECK(prompt.ends_with("deploy it"));
+    CHECK(withoutMemoryNotes(session.messages()[1].content) == "deploy it");
+
+    // Nothing similar enough, no notes.
+    REQUIRE(agent.processMessage("hello") == "reply");
+    CHECK(agent.lastTurnMetrics().memoryNotes == 0);
+    CHECK(engine.prompts.back() == "hello");
+}
+
+TEST_CASE("AgentTrace records generations and MCP exchanges of a turn", "[agent][trace]")
+{
+    auto const trace = recordEchoTurn("hello");
+
+    CHECK(trace.contextBudget == 4096);
+    REQUIRE(trace.servers.size() == 1);
+    CHECK(trace.servers[0].name == "echo");
+    REQUIRE(trace.generations.size() == 2);
+    CHECK(trace.generations[0].result.toolCalls.size() == 1);
+    CHECK(trace.generations[1].pieces == std::vector<std::string> { "The tool said: ", "hello" });
+
+    auto const call = std::ranges::find_if(trace.exchanges, [](TracedExchange const& exchange) {
+        return exchange.request["method"] == "tools/call";
+    });
+    REQUIRE(call != trace.exchanges.end());
+    CHECK(call->request["params"]["arguments"]["text"] == "hello");
+    CHECK(call->response["result"]["content"][0]["text"] == "hello");
+    CHECK_FALSE(call->response.contains("id"));
+
+    auto const path = std::filesystem::temp_directory_path() / "mychat_test_agent_trace.jsonl";
+    REQUIRE(saveAgentTrace(trace, path));
+    auto const loaded = loadAgentTrace(path);
+    std::filesystem::remove(path);
+    REQUIRE(loaded.has_value());
+    CHECK(loaded->generations.size() == 2);
+    CHECK(loaded->generations[1].result.text == "The tool said: hello");
+    CHECK(loaded->generations[0].inputHash == trace.generations[0].inputHash);
+    CHECK(loaded->exchanges.size() == trace.exchanges.size());
+    CHECK(loaded->tokenCounts.size() == trace.tokenCounts.size());
+}
+
+TEST_CASE("AgentLoop replays a recorded turn without the model or the servers", "[agent][trace]")
+{
+    auto const trace = recordEchoTurn("hello");
+
+    auto servers = ServerManager();
+    servers.setTransportFactory(replayTransports(trace, ReplayTiming::Instant));
+    for (auto const& added: servers.addServers(replayServerConfigs(trace)))
+        REQUIRE(added);
+
+    auto engine = ReplayEngine(trace, ReplayTiming::Instant);
+    auto session = ChatSession("sys");
+    auto agent = AgentLoop(engine, session, servers, AgentConfig {});
+    auto streamed = std::string {};
+    auto const reply = agent.processMessage("hello", [&](std::string_view piece) { streamed += piece; });
+
+    CHECK(reply == "The tool said: hello");
+    CHECK(streamed == "The tool said: hello");
+    CHECK(engine.divergences() == 0);
+    CHECK(engine.remaining() == 0);
+    CHECK(agent.lastTurnMetrics().toolCalls == 1);
+}
+
+TEST_CASE("AgentLoop replay reports where the turn diverged from the trace", "[agent][trace]")
+{
+    auto const trace = recordEchoTurn("hello");
+
+    auto servers = ServerManager();
+    servers.setTransportFactory(replayTransports(trace, ReplayTiming::Instant));
+    for (auto const& added: servers.addServers(replayServerConfigs(trace)))
+        REQUIRE(added);
+
+    // The recorded tool call is replayed, but its prompt differs.
+    auto engine = ReplayEngine(trace, ReplayTiming::Instant);
+    auto session = ChatSession("sys");
+    auto agent = AgentLoop(engine, session, servers, AgentConfig {});
+    CHECK(agent.processMessage("goodbye") == "The tool said: hello");
+    CHECK(engine.divergences() == 2);
+
+    // A call the trace does not know is answered with an error.
+    CHECK_FALSE(servers.callTool("echo", { { "text", "goodbye" } }).has_value());
+}
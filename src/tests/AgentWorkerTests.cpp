@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <agent/AgentWorker.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief Polls the worker until the turn finishes, collecting streamed text.
+auto drainTurn(AgentWorker& worker, std::string& streamed) -> AgentEvent
+{
+    auto finished = AgentEvent {};
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (worker.busy() && std::chrono::steady_clock::now() < deadline)
+    {
+        worker.poll([&](AgentEvent& event) {
+            if (event.kind == AgentEvent::Kind::Token)
+                streamed += event.text;
+            else
+                finished = std::move(event);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return finished;
+}
+
+} // namespace
+
+TEST_CASE("AgentWorker: streams tokens and delivers the final result", "[agent][worker]")
+{
+    auto worker = AgentWorker([](std::string_view message, AgentStreamCallback streamCb, std::stop_token) {
+        streamCb("echo: ");
+        streamCb(message);
+        return Result<std::string>(std::format("echo: {}", message));
+    });
+
+    REQUIRE(worker.submit("hello"));
+    auto streamed = std::string {};
+    auto const finished = drainTurn(worker, streamed);
+
+    CHECK_FALSE(worker.busy());
+    CHECK(streamed == "echo: hello");
+    CHECK(finished.kind == AgentEvent::Kind::Finished);
+    CHECK(finished.text == "echo: hello");
+    CHECK_FALSE(finished.error.has_value());
+    CHECK_FALSE(finished.cancelled);
+}
+
+TEST_CASE("AgentWorker: wakes the UI thread for every event", "[agent][worker]")
+{
+    auto worker = AgentWorker([](std::string_view, AgentStreamCallback streamCb, std::stop_token) {
+        streamCb("a");
+        streamCb("b");
+        return Result<std::string>("ab");
+    });
+    auto wakes = std::atomic<int> { 0 };
+    worker.setWakeup([&] { ++wakes; });
+
+    REQUIRE(worker.submit("go"));
+    auto streamed = std::string {};
+    static_cast<void>(drainTurn(worker, streamed));
+
+    CHECK(streamed == "ab");
+    CHECK(wakes == 3); // Two tokens and the final event
+}
+
+TEST_CASE("AgentWorker: rejects a second turn while busy", "[agent][worker]")
+{
+    auto release = std::atomic<bool> { false };
+    auto worker = AgentWorker([&](std::string_view, AgentStreamCallback, std::stop_token) {
+        while (!release)
+            std::this_thread::yield();
+        return Result<std::string>("done");
+    });
+
+    REQUIRE(worker.submit("first"));
+    CHECK_FALSE(worker.submit("second"));
+    release = true;
+
+    auto streamed = std::string {};
+    CHECK(drainTurn(worker, streamed).text == "done");
+    CHECK(worker.submit("third"));
+    release = true;
+    drainTurn(worker, streamed);
+}
+
+TEST_CASE("AgentWorker: cancel stops a running turn", "[agent][worker]")
+{
+    auto worker = AgentWorker([](std::string_view, AgentStreamCallback streamCb, std::stop_token stopToken) {
+        while (!stopToken.stop_requested())
+        {
+            streamCb("x");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return Result<std::string>("partial");
+    });
+
+    REQUIRE(worker.submit("go"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    worker.cancel();
+
+    auto streamed = std::string {};
+    auto const finished = drainTurn(worker, streamed);
+    CHECK(finished.cancelled);
+    CHECK(finished.text == "partial");
+    CHECK_FALSE(worker.busy());
+}
+
+TEST_CASE("AgentWorker: reports task errors", "[agent][worker]")
+{
+    auto worker =
+        AgentWorker([](std::string_view, AgentStreamCallback, std::stop_token) -> Result<std::string> {
+            return makeError(ErrorCode::InferenceError, "boom");
+        });
+
+    REQUIRE(worker.submit("go"));
+    auto streamed = std::string {};
+    auto const finished = drainTurn(worker, streamed);
+    REQUIRE(finished.error.has_value());
+    CHECK(finished.error->code == ErrorCode::InferenceError);
+}
+
+TEST_CASE("AgentWorker: a newer draft or a turn stops the prefill of a draft", "[agent][worker]")
+{
+    auto mutex = std::mutex {};
+    auto drafts = std::vector<std::string> {};
+    auto running = std::atomic<bool> { false };
+    auto overlapped = std::atomic<bool> { false };
+    auto worker = AgentWorker(
+        [&](std::string_view message, AgentStreamCallback, std::stop_token) {
+            overlapped = running.load();
+            return Result<std::string>(std::string(message));
+        },
+        [&](std::string_view draft, std::stop_token stopToken) -> VoidResult {
+            {
+                auto const lock = std::lock_guard(mutex);
+                drafts.emplace_back(draft);
+            }
+            running = true;
+            while (!stopToken.stop_requested())
+                std::this_thread::yield();
+            running = false;
+            return {};
+        });
+
+    auto const waitForPrefill = [&](size_t count) {
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            {
+                auto const lock = std::lock_guard(mutex);
+                if (drafts.size() == count && running)
+                    return true;
+            }
+            std::this_thread::yield();
+        }
+        return false;
+    };
+
+    REQUIRE(worker.prefill("Hel"));
+    REQUIRE(waitForPrefill(1));
+    REQUIRE(worker.prefill("Hello"));
+    REQUIRE(waitForPrefill(2));
+
+    worker.cancelPrefill();
+    CHECK_FALSE(running);
+
+    REQUIRE(worker.prefill("Hello!"));
+    REQUIRE(waitForPrefill(3));
+    REQUIRE(worker.submit("Hello!"));
+    CHECK_FALSE(worker.prefill("ignored while busy"));
+
+    auto streamed = std::string {};
+    CHECK(drainTurn(worker, streamed).text == "Hello!");
+    CHECK_FALSE(overlapped);
+    CHECK(drafts == std::vector<std::string> { "Hel", "Hello", "Hello!" });
+}
+
+TEST_CASE("AgentWorker: ignores drafts without a prefill task", "[agent][worker]")
+{
+    auto worker = AgentWorker([](std::string_view, AgentStreamCallback, std::stop_token) {
+        return Result<std::string>("done");
+    });
+    CHECK_FALSE(worker.prefill("draft"));
+    worker.cancelPrefill();
+}
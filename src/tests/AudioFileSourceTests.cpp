@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <audio/AudioFileSource.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief Writes @p samples as a mono 16-bit PCM WAV file.
+void writeWav(std::filesystem::path const& path, std::span<const std::int16_t> samples, std::uint32_t rate)
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    auto const put = [&](auto value) { file.write(reinterpret_cast<char const*>(&value), sizeof(value)); };
+    auto const tag = [&](std::string_view name) { file.write(name.data(), 4); };
+    auto const dataBytes = static_cast<std::uint32_t>(samples.size() * 2);
+    tag("RIFF");
+    put(std::uint32_t { 36 + dataBytes });
+    tag("WAVE");
+    tag("fmt ");
+    put(std::uint32_t { 16 });
+    put(std::uint16_t { 1 }); // PCM
+    put(std::uint16_t { 1 }); // mono
+    put(rate);
+    put(std::uint32_t { rate * 2 });
+    put(std::uint16_t { 2 });
+    put(std::uint16_t { 16 });
+    tag("data");
+    put(dataBytes);
+    for (auto const sample: samples)
+        put(sample);
+}
+
+/// @brief A 16kHz WAV file of a second, rising from silence to half scale.
+auto rampFile() -> std::filesystem::path
+{
+    auto samples = std::vector<std::int16_t>(16000);
+    for (auto i = std::size_t { 0 }; i < samples.size(); ++i)
+        samples[i] = static_cast<std::int16_t>(i);
+    auto path = std::filesystem::temp_directory_path() / "mychat_test_ramp.wav";
+    writeWav(path, samples, 16000);
+    return path;
+}
+
+} // namespace
+
+TEST_CASE("decodeAudioFile reads a 16kHz WAV file as float samples", "[audio][file]")
+{
+    auto const path = rampFile();
+    auto const samples = decodeAudioFile(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(samples.has_value());
+    REQUIRE(samples->size() == 16000);
+    CHECK((*samples)[0] == Catch::Approx(0.0f));
+    CHECK((*samples)[8000] == Catch::Approx(8000.0f / 32768.0f).margin(1e-4));
+    CHECK((*samples)[15999] == Catch::Approx(15999.0f / 32768.0f).margin(1e-4));
+}
+
+TEST_CASE("decodeAudioFile fails for a missing file", "[audio][file]")
+{
+    auto const path = std::filesystem::temp_directory_path() / "mychat_test_missing.wav";
+    CHECK_FALSE(decodeAudioFile(path).has_value());
+
+    auto source = AudioFileSource(AudioFileSourceConfig {
+        .path = path,
+        .speed = 0.0,
+        .trailingSilenceMs = 0.0f,
+    });
+    CHECK_FALSE(source.initialize([](std::span<const float> /*samples*/) {}).has_value());
+    CHECK_FALSE(source.start().has_value());
+}
+
+TEST_CASE("AudioFileSource delivers the file and the trailing silence in chunks", "[audio][file]")
+{
+    auto const path = rampFile();
+    auto source =
+        AudioFileSource(AudioFileSourceConfig { .path = path, .speed = 0.0, .trailingSilenceMs = 500.0f });
+    auto delivered = std::vector<float> {};
+    auto largestChunk = std::size_t { 0 };
+    REQUIRE(source.initialize([&](std::span<const float> chunk) {
+        delivered.insert(delivered.end(), chunk.begin(), chunk.end());
+        largestChunk = std::max(largestChunk, chunk.size());
+    }));
+    std::filesystem::remove(path);
+    CHECK(source.fileSamples() == 16000);
+    CHECK_FALSE(source.finished());
+
+    REQUIRE(source.start());
+    // At speed 0 the thread delivers everything at once; stop() joins it.
+    while (!source.finished())
+        std::this_thread::yield();
+    source.stop();
+
+    REQUIRE(delivered.size() == 16000 + 8000);
+    CHECK(largestChunk == AudioFileSource::ChunkSamples);
+    CHECK(delivered[15999] == Catch::Approx(15999.0f / 32768.0f).margin(1e-4));
+    CHECK(delivered.back() == 0.0f);
+    CHECK_FALSE(source.isCapturing());
+    CHECK(source.peakLevel() == 0.0f);
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/AutoTune.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto labels(std::vector<LlmBenchmarkVariant> const& variants) -> std::vector<std::string>
+{
+    auto result = std::vector<std::string> {};
+    for (auto const& variant: variants)
+        result.push_back(variant.label);
+    return result;
+}
+
+auto sample(std::string scenario, int promptTokens, double prefillMs, int generatedTokens, double decodeMs)
+    -> LlmBenchmarkSample
+{
+    auto metrics = GenerateMetrics {};
+    metrics.promptTokens = promptTokens;
+    metrics.generatedTokens = generatedTokens;
+    metrics.prefillMs = prefillMs;
+    metrics.decodeMs = decodeMs;
+    return LlmBenchmarkSample { .scenario = std::move(scenario), .metrics = metrics };
+}
+
+} // namespace
+
+TEST_CASE("autotuneCandidates varies one setting of the best configuration", "[autotune]")
+{
+    auto best = LlmEngineConfig {};
+    best.threads = 8;
+    auto const cpus = CpuTopology { .logicalCpus = 16, .performanceCpus = 8 };
+
+    CHECK(labels(autotuneCandidates(best, AutotuneSetting::GpuLayers, cpus))
+          == std::vector<std::string> { "gpu-layers=all flash-attn=auto ubatch=auto threads=8",
+                                        "gpu-layers=0 flash-attn=auto ubatch=auto threads=8" });
+    CHECK(autotuneCandidates(best, AutotuneSetting::GpuLayers, cpus, true).size() == 3);
+    CHECK(labels(autotuneCandidates(best, AutotuneSetting::FlashAttention, cpus))
+          == std::vector<std::string> { "gpu-layers=all flash-attn=on ubatch=auto threads=8",
+                                        "gpu-layers=all flash-attn=off ubatch=auto threads=8" });
+
+    best.batchSize = 512;
+    auto const batches = autotuneCandidates(best, AutotuneSetting::MicroBatch, cpus);
+    REQUIRE(batches.size() == 3);
+    CHECK(batches[2].engine.ubatchSize == 1024);
+    CHECK(batches[2].engine.batchSize == 1024);
+
+    // The planned count, half of it, and every logical CPU.
+    auto const threads = autotuneCandidates(best, AutotuneSetting::Threads, cpus);
+    REQUIRE(threads.size() == 3);
+    CHECK(threads[0].engine.threads == 8);
+    CHECK(threads[1].engine.threads == 4);
+    CHECK(threads[2].engine.threads == 16);
+    CHECK(autotuneCandidates(best, AutotuneSetting::Threads, CpuTopology {}).size() == 1);
+}
+
+TEST_CASE("autotuneTurnMs weighs prefill and decode rates", "[autotune]")
+{
+    auto run = LlmBenchmarkRun {};
+    run.samples.push_back(sample("short-chat", 50, 50.0, 20, 1000.0));
+    run.samples.push_back(sample("long-prefill", 2000, 1000.0, 20, 1000.0));
+
+    // 1000 tokens at 2000 t/s and 200 tokens at 20 t/s.
+    auto const ms = autotuneTurnMs(run);
+    REQUIRE(ms.has_value());
+    CHECK(*ms == Catch::Approx(10500.0));
+
+    run.error = "Failed to load model";
+    CHECK_FALSE(autotuneTurnMs(run).has_value());
+    CHECK_FALSE(autotuneTurnMs(LlmBenchmarkRun {}).has_value());
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/Base64.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto bytesOf(std::string_view text) -> std::vector<std::uint8_t>
+{
+    return { text.begin(), text.end() };
+}
+
+} // namespace
+
+TEST_CASE("decodeBase64 decodes RFC 4648 test vectors", "[core][base64]")
+{
+    CHECK(decodeBase64("") == bytesOf(""));
+    CHECK(decodeBase64("Zg==") == bytesOf("f"));
+    CHECK(decodeBase64("Zm8=") == bytesOf("fo"));
+    CHECK(decodeBase64("Zm9v") == bytesOf("foo"));
+    CHECK(decodeBase64("Zm9vYg==") == bytesOf("foob"));
+    CHECK(decodeBase64("Zm9vYmE=") == bytesOf("fooba"));
+    CHECK(decodeBase64("Zm9vYmFy") == bytesOf("foobar"));
+}
+
+TEST_CASE("decodeBase64 accepts missing padding and line breaks", "[core][base64]")
+{
+    CHECK(decodeBase64("Zm9vYg") == bytesOf("foob"));
+    CHECK(decodeBase64("Zm9v\r\nYmFy\n") == bytesOf("foobar"));
+    CHECK(decodeBase64("//8=") == std::vector<std::uint8_t> { 0xFF, 0xFF });
+}
+
+TEST_CASE("decodeBase64 rejects invalid input", "[core][base64]")
+{
+    CHECK(!decodeBase64("Zm9v!").has_value());
+    CHECK(!decodeBase64("Zm9vY").has_value()); // A lone trailing character cannot encode a byte.
+    CHECK(!decodeBase64("Zm=9v").has_value());
+}
+
+TEST_CASE("encodeBase64 encodes RFC 4648 test vectors", "[core][base64]")
+{
+    CHECK(encodeBase64(bytesOf("")).empty());
+    CHECK(encodeBase64(bytesOf("f")) == "Zg==");
+    CHECK(encodeBase64(bytesOf("fo")) == "Zm8=");
+    CHECK(encodeBase64(bytesOf("foo")) == "Zm9v");
+    CHECK(encodeBase64(bytesOf("foobar")) == "Zm9vYmFy");
+    CHECK(encodeBase64(std::vector<std::uint8_t> { 0xFF, 0xFF }) == "//8=");
+    CHECK(decodeBase64(encodeBase64(bytesOf("fooba"))) == bytesOf("fooba"));
+}
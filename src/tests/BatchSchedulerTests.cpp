@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/BatchScheduler.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief Decode function recording the steps, optionally failing with a fixed status.
+struct RecordingDecoder
+{
+    std::mutex mutex;
+    std::vector<std::vector<BatchToken>> steps;
+    int status = 0;
+
+    auto function() -> BatchScheduler::DecodeFn
+    {
+        return [this](std::span<const BatchToken> batch) {
+            auto const lock = std::lock_guard(mutex);
+            steps.emplace_back(batch.begin(), batch.end());
+            return status;
+        };
+    }
+};
+
+/// @brief Returns @p count tokens of @p sequence with ids first, first + 1, ...; only the last has logits.
+auto prompt(std::int32_t sequence, std::int32_t first, size_t count) -> std::vector<BatchToken>
+{
+    auto tokens = std::vector<BatchToken> {};
+    for (auto i = size_t { 0 }; i < count; ++i)
+        tokens.push_back({ .token = first + static_cast<std::int32_t>(i),
+                           .position = static_cast<std::int32_t>(i),
+                           .sequence = sequence,
+                           .logits = i + 1 == count });
+    return tokens;
+}
+
+/// Time given to threads to submit before a held lease is released.
+constexpr auto SubmitDelay = std::chrono::milliseconds { 100 };
+
+} // namespace
+
+TEST_CASE("BatchScheduler: a single sequence decodes inline in chunks", "[llm][batch-scheduler]")
+{
+    auto decoder = RecordingDecoder {};
+    auto scheduler = BatchScheduler(decoder.function(), 4, 1);
+
+    auto const tokens = prompt(0, 100, 10);
+    auto lease = scheduler.decode(tokens);
+    REQUIRE(lease.has_value());
+    REQUIRE(decoder.steps.size() == 3);
+    CHECK(decoder.steps[0].size() == 4);
+    CHECK(decoder.steps[2].size() == 2);
+    CHECK(decoder.steps[2][static_cast<size_t>(lease->lastOutputIndex())].token == 109);
+    CHECK(scheduler.steps() == 3);
+    CHECK(scheduler.decodedTokens() == 10);
+
+    SECTION("tokens that all want logits must fit one step")
+    {
+        auto verify = prompt(0, 0, 5);
+        for (auto& token: verify)
+            token.logits = true;
+        auto const rejected = scheduler.decode(verify);
+        REQUIRE_FALSE(rejected.has_value());
+        CHECK(rejected.error().code == ErrorCode::InvalidArgument);
+    }
+
+    SECTION("decode failures are reported")
+    {
+        decoder.status = 1;
+        auto const failed = scheduler.decode(prompt(0, 0, 1));
+        REQUIRE_FALSE(failed.has_value());
+        CHECK(failed.error().code == ErrorCode::InferenceError);
+    }
+}
+
+TEST_CASE("BatchScheduler: concurrent sequences share a step", "[llm][batch-scheduler]")
+{
+    auto decoder = RecordingDecoder {};
+    auto scheduler = BatchScheduler(decoder.function(), 16, 4);
+
+    // While the first sequence holds its logits, the others queue up for the next step.
+    auto first = scheduler.decode(prompt(0, 0, 1));
+    REQUIRE(first.has_value());
+
+    auto indices = std::vector<std::int32_t>(4, -1);
+    {
+        auto sequences = std::vector<std::jthread> {};
+        for (auto seq = 1; seq < 4; ++seq)
+            sequences.emplace_back([&, seq] {
+                auto const tokens = prompt(seq, seq * 10, 1);
+                auto lease = scheduler.decode(tokens);
+                if (lease)
+                    indices[static_cast<size_t>(seq)] = lease->lastOutputIndex();
+            });
+        std::this_thread::sleep_for(SubmitDelay);
+        first->release();
+    }
+
+    REQUIRE(decoder.steps.size() == 2);
+    auto const& step = decoder.steps[1];
+    REQUIRE(step.size() == 3);
+    for (auto seq = 1; seq < 4; ++seq)
+    {
+        auto const index = indices[static_cast<size_t>(seq)];
+        REQUIRE(index >= 0);
+        CHECK(step[static_cast<size_t>(index)].sequence == seq);
+        CHECK(step[static_cast<size_t>(index)].token == seq * 10);
+    }
+}
+
+TEST_CASE("BatchScheduler: prompt chunks fill the steps around generated tokens", "[llm][batch-scheduler]")
+{
+    auto decoder = RecordingDecoder {};
+    auto scheduler = BatchScheduler(decoder.function(), 4, 2);
+
+    auto first = scheduler.decode(prompt(0, 0, 1));
+    REQUIRE(first.has_value());
+
+    auto prefillIndex = std::int32_t { -1 };
+    auto generatedIndex = std::int32_t { -1 };
+    {
+        auto prefill = std::jthread([&] {
+            auto const tokens = prompt(1, 100, 10);
+            if (auto lease = scheduler.decode(tokens))
+                prefillIndex = lease->lastOutputIndex();
+        });
+        std::this_thread::sleep_for(SubmitDelay);
+        auto generated = std::jthread([&] {
+            auto const tokens = prompt(0, 7, 1);
+            if (auto lease = scheduler.decode(tokens))
+                generatedIndex = lease->lastOutputIndex();
+        });
+        std::this_thread::sleep_for(SubmitDelay);
+        first->release();
+    }
+
+    // The generated token goes first although it arrived last; the prompt takes the rest.
+    REQUIRE(decoder.steps.size() == 4);
+    CHECK(decoder.steps[1].size() == 4);
+    CHECK(decoder.steps[1][0].token == 7);
+    CHECK(generatedIndex == 0);
+    CHECK(decoder.steps[1][1].token == 100);
+    CHECK(decoder.steps[2].size() == 4);
+    CHECK(decoder.steps[3].size() == 3);
+    REQUIRE(prefillIndex >= 0);
+    CHECK(decoder.steps[3][static_cast<size_t>(prefillIndex)].token == 109);
+    CHECK(scheduler.decodedTokens() == 12);
+}
+
+TEST_CASE("BatchScheduler: stopped and failed submissions return errors", "[llm][batch-scheduler]")
+{
+    auto decoder = RecordingDecoder {};
+    auto scheduler = BatchScheduler(decoder.function(), 8, 2);
+
+    SECTION("a stop request drops tokens not yet decoded")
+    {
+        auto first = scheduler.decode(prompt(0, 0, 1));
+        REQUIRE(first.has_value());
+        auto stop = std::stop_source {};
+        auto stopped = std::optional<Result<BatchLease>> {};
+        {
+            auto sequence =
+                std::jthread([&] { stopped = scheduler.decode(prompt(1, 0, 3), stop.get_token()); });
+            std::this_thread::sleep_for(SubmitDelay);
+            stop.request_stop();
+            first->release();
+        }
+        REQUIRE(stopped.has_value());
+        CHECK_FALSE(stopped->has_value());
+        CHECK(decoder.steps.size() == 1);
+    }
+
+    SECTION("a decode failure reaches every participant")
+    {
+        decoder.status = -1;
+        auto const failed = scheduler.decode(prompt(0, 0, 2));
+        REQUIRE_FALSE(failed.has_value());
+        CHECK(failed.error().code == ErrorCode::InferenceError);
+
+        // The scheduler keeps going after a failure.
+        decoder.status = 0;
+        CHECK(scheduler.decode(prompt(0, 0, 1)).has_value());
+    }
+}
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/Batch.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace mychat;
+
+TEST_CASE("parseBatchItem takes plain lines as prompts", "[batch]")
+{
+    auto const item = parseBatchItem("What is 2 + 2?\r", 3);
+    REQUIRE(item);
+    REQUIRE(item->has_value());
+    CHECK((*item)->id == "3");
+    CHECK((*item)->prompt == "What is 2 + 2?");
+
+    auto const blank = parseBatchItem("  \t", 4);
+    REQUIRE(blank);
+    CHECK(!blank->has_value());
+}
+
+TEST_CASE("parseBatchItem reads JSON objects with an optional id", "[batch]")
+{
+    auto const named = parseBatchItem(R"({"id": "eval-17", "prompt": "Hi"})", 1);
+    REQUIRE(named);
+    CHECK((*named)->id == "eval-17");
+    CHECK((*named)->prompt == "Hi");
+
+    auto const numbered = parseBatchItem(R"({"id": 42, "prompt": "Hi"})", 1);
+    REQUIRE(numbered);
+    CHECK((*numbered)->id == "42");
+
+    auto const unnamed = parseBatchItem(R"({"prompt": "Hi"})", 7);
+    REQUIRE(unnamed);
+    CHECK((*unnamed)->id == "7");
+}
+
+TEST_CASE("parseBatchItem rejects malformed JSON lines", "[batch]")
+{
+    auto const broken = parseBatchItem(R"({"prompt": )", 2);
+    REQUIRE(!broken);
+    CHECK(broken.error().code == ErrorCode::InvalidArgument);
+    CHECK(broken.error().message.starts_with("Line 2"));
+
+    auto const missing = parseBatchItem(R"({"id": "x", "text": "Hi"})", 5);
+    REQUIRE(!missing);
+    CHECK(missing.error().message.contains("prompt"));
+}
+
+TEST_CASE("batchResultJson reports the response or the error with metrics", "[batch]")
+{
+    auto metrics = TurnMetrics {};
+    metrics.steps = 2;
+    metrics.toolCalls = 1;
+    metrics.total.promptTokens = 300;
+    metrics.total.generatedTokens = 40;
+    metrics.total.decodeMs = 500.0;
+
+    auto const answered = batchResultJson({ .id = "a",
+                                            .response = std::string("4"),
+                                            .metrics = metrics,
+                                            .elapsedMs = 812.5,
+                                            .sequence = 1 });
+    CHECK(answered["id"] == "a");
+    CHECK(answered["response"] == "4");
+    CHECK(!answered.contains("error"));
+    CHECK(answered["metrics"]["steps"] == 2);
+    CHECK(answered["metrics"]["toolCalls"] == 1);
+    CHECK(answered["metrics"]["promptTokens"] == 300);
+    CHECK(answered["metrics"]["decodeTokensPerSecond"] == 80.0);
+    CHECK(answered["metrics"]["elapsedMs"] == 812.5);
+    CHECK(answered["metrics"]["sequence"] == 1);
+    CHECK(answered["metrics"]["summaries"] == 0);
+
+    auto const failed = batchResultJson({ .id = "b",
+                                          .response = makeError(ErrorCode::InferenceError, "Prompt too long"),
+                                          .metrics = {},
+                                          .elapsedMs = 0.0,
+                                          .sequence = 0 });
+    CHECK(failed["error"] == "Prompt too long");
+    CHECK(!failed.contains("response"));
+}
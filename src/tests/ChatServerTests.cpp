@@ -0,0 +1,394 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/ChatServer.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+using namespace mychat;
+using namespace std::chrono_literals;
+
+TEST_CASE("parseChatCompletionRequest maps OpenAI messages, tools and sampling", "[chat-server]")
+{
+    auto const body = nlohmann::json::parse(R"({
+        "model": "gpt-4o",
+        "messages": [
+            {"role": "system", "content": "Be brief."},
+            {"role": "user", "content": [{"type": "text", "text": "Weather "},
+                                         {"type": "text", "text": "in Berlin?"}]},
+            {"role": "assistant", "content": null, "tool_calls": [
+                {"id": "call_1", "type": "function",
+                 "function": {"name": "get_weather", "arguments": "{\"city\": \"Berlin\"}"}}
+            ]},
+            {"role": "tool", "tool_call_id": "call_1", "content": "12 degrees"}
+        ],
+        "tools": [{"type": "function", "function": {"name": "get_weather", "description": "Looks it up",
+                   "parameters": {"type": "object", "properties": {"city": {"type": "string"}}}}}],
+        "temperature": 0.2,
+        "seed": 7,
+        "max_tokens": 64,
+        "stream": true,
+        "stream_options": {"include_usage": true}
+    })");
+    auto defaults = SamplerConfig {};
+    defaults.topK = 12;
+
+    auto const request = parseChatCompletionRequest(body, defaults);
+    REQUIRE(request.has_value());
+    REQUIRE(request->messages.size() == 4);
+    CHECK(request->messages[0].role == Role::System);
+    CHECK(request->messages[1].content == "Weather in Berlin?");
+    REQUIRE(request->messages[2].toolCalls.size() == 1);
+    CHECK(request->messages[2].toolCalls[0].id == "call_1");
+    CHECK(request->messages[2].toolCalls[0].arguments["city"] == "Berlin");
+    CHECK(request->messages[3].role == Role::Tool);
+    CHECK(request->messages[3].toolCallId == "call_1");
+    REQUIRE(request->tools.size() == 1);
+    CHECK(request->tools[0].name == "get_weather");
+    CHECK(request->tools[0].inputSchema["properties"].contains("city"));
+    CHECK(request->sampler.temperature == 0.2f);
+    CHECK(request->sampler.seed == 7);
+    CHECK(request->sampler.topK == 12);
+    CHECK(request->maxTokens == 64);
+    CHECK(request->stream);
+    CHECK(request->streamUsage);
+}
+
+TEST_CASE("parseChatCompletionRequest rejects malformed requests", "[chat-server]")
+{
+    auto const rejects = [](std::string_view body) {
+        auto const request = parseChatCompletionRequest(nlohmann::json::parse(body), SamplerConfig {});
+        return !request && request.error().code == ErrorCode::InvalidArgument;
+    };
+    CHECK(rejects(R"({"messages": []})"));
+    CHECK(rejects(R"({"messages": [{"role": "robot", "content": "hi"}]})"));
+    CHECK(rejects(R"({"messages": [{"role": "user", "content": [{"type": "image_url"}]}]})"));
+    CHECK(rejects(R"({"messages": [{"role": "user", "content": "hi"}], "temperature": "hot"})"));
+    CHECK(rejects(R"({"messages": [{"role": "user", "content": "hi"}], "stream": "yes"})"));
+
+    // Without client tools, mychat answers the user's last message itself.
+    CHECK(rejects(R"({"messages": [{"role": "user", "content": "hi"},
+                                   {"role": "assistant", "content": "a"}]})"));
+    CHECK(rejects(R"({"messages": [{"role": "tool", "content": "12 degrees"}],
+                      "tools": [{"type": "function", "function": {"name": "f"}}]})"));
+}
+
+TEST_CASE("Chat completions are reported in OpenAI's format", "[chat-server]")
+{
+    auto completion = ChatCompletion {};
+    completion.toolCalls.push_back(
+        { .id = "call_0", .name = "get_weather", .arguments = { { "city", "Paris" } } });
+    completion.finishReason = "tool_calls";
+    completion.metrics.promptTokens = 120;
+    completion.metrics.reusedTokens = 100;
+    completion.metrics.generatedTokens = 8;
+
+    auto const json = chatCompletionJson(completion, "chatcmpl-1", "mychat", 1700000000);
+    CHECK(json["object"] == "chat.completion");
+    auto const& choice = json["choices"][0];
+    CHECK(choice["finish_reason"] == "tool_calls");
+    CHECK(choice["message"]["content"].is_null());
+    CHECK(choice["message"]["tool_calls"][0]["function"]["name"] == "get_weather");
+    CHECK(choice["message"]["tool_calls"][0]["function"]["arguments"] == R"({"city":"Paris"})");
+    CHECK(json["usage"]["total_tokens"] == 128);
+    CHECK(json["usage"]["prompt_tokens_details"]["cached_tokens"] == 100);
+
+    auto const chunk = chatCompletionChunkJson("chatcmpl-1", "mychat", 1700000000, { { "content", "Hi" } });
+    CHECK(chunk["object"] == "chat.completion.chunk");
+    CHECK(chunk["choices"][0]["delta"]["content"] == "Hi");
+    CHECK(chunk["choices"][0]["finish_reason"].is_null());
+    auto const last = chatCompletionChunkJson("chatcmpl-1", "mychat", 0, {}, "stop");
+    CHECK(last["choices"][0]["finish_reason"] == "stop");
+}
+
+#ifndef _WIN32
+
+namespace
+{
+
+    /// @brief Answers with a call of the first client tool, or streams "Hello world".
+    ///
+    /// With blocking set, generation instead runs until it is cancelled.
+    class ScriptedEngine: public InferenceEngine
+    {
+      public:
+        std::atomic<bool> blocking = false;
+        std::atomic<int> started = 0;
+        std::atomic<int> cancelled = 0;
+
+        auto generate(std::span<const ChatMessage> messages,
+                      std::span<const ToolDefinition> tools,
+                      const SamplerConfig& /*sampler*/,
+                      StreamCallback streamCb,
+                      ToolCallCallback /*toolCallCb*/,
+                      std::stop_token stopToken) -> Result<GenerateResult> override
+        {
+            ++started;
+            {
+                auto const lock = std::lock_guard(mutex);
+                lastMessages.assign(messages.begin(), messages.end());
+            }
+            auto result = GenerateResult {};
+            result.metrics.promptTokens = 40;
+            result.metrics.reusedTokens = 30;
+            if (blocking)
+            {
+                while (!stopToken.stop_requested())
+                    std::this_thread::sleep_for(1ms);
+                ++cancelled;
+                result.cancelled = true;
+                return result;
+            }
+            if (!tools.empty() && messages.back().role == Role::User)
+            {
+                result.toolCalls.push_back(
+                    { .id = "call_0", .name = tools[0].name, .arguments = { { "x", 1 } } });
+                return result;
+            }
+            for (auto const piece: { "Hello", " world" })
+            {
+                if (streamCb)
+                    streamCb(piece);
+                result.text += piece;
+                ++result.metrics.generatedTokens;
+            }
+            return result;
+        }
+
+        void setContextOverflowPolicy(ContextOverflowPolicy /*policy*/) override {}
+
+        auto promptTokenCount(std::span<const ChatMessage> messages,
+                              std::span<const ToolDefinition> /*tools*/) -> Result<size_t> override
+        {
+            return messages.size() * 8;
+        }
+
+        [[nodiscard]] auto contextBudget() const -> size_t override { return 4096; }
+
+        auto embed(std::string_view /*text*/) -> Result<std::vector<float>> override
+        {
+            return makeError(ErrorCode::InferenceError, "No embeddings");
+        }
+
+        std::mutex mutex;
+        std::vector<ChatMessage> lastMessages;
+    };
+
+    auto connectTo(int port) -> int
+    {
+        auto const fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        auto address = sockaddr_in {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(::connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0);
+        return fd;
+    }
+
+    auto httpRequest(std::string_view method, std::string_view path, std::string_view body = {})
+        -> std::string
+    {
+        return std::format(
+            "{} {} HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n"
+            "Content-Length: {}\r\n\r\n{}",
+            method,
+            path,
+            body.size(),
+            body);
+    }
+
+    /// @brief Sends @p request on a new connection and returns everything received until it closes.
+    auto fetch(int port, std::string_view request) -> std::string
+    {
+        auto const fd = connectTo(port);
+        auto const sent = ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        REQUIRE(sent == static_cast<ssize_t>(request.size()));
+        auto response = std::string {};
+        char chunk[4096];
+        while (true)
+        {
+            auto const count = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (count <= 0)
+                break;
+            response.append(chunk, static_cast<size_t>(count));
+        }
+        ::close(fd);
+        return response;
+    }
+
+    auto responseBody(std::string const& response) -> std::string
+    {
+        auto const headEnd = response.find("\r\n\r\n");
+        return headEnd == std::string::npos ? std::string {} : response.substr(headEnd + 4);
+    }
+
+    template <typename Predicate>
+    auto eventually(Predicate predicate) -> bool
+    {
+        for (auto i = 0; i < 500 && !predicate(); ++i)
+            std::this_thread::sleep_for(10ms);
+        return predicate();
+    }
+
+    auto serverConfig() -> ChatServerConfig
+    {
+        auto config = ChatServerConfig {};
+        config.port = 0;
+        config.maxQueuedRequests = 1;
+        config.systemPrompt = "You are mychat.";
+        return config;
+    }
+
+} // namespace
+
+TEST_CASE("ChatServer answers chat completions over HTTP", "[chat-server]")
+{
+    auto engine = ScriptedEngine();
+    auto servers = ServerManager();
+    auto server = ChatServer(engine, servers, AgentConfig {}, serverConfig());
+    REQUIRE(server.start().has_value());
+    auto const port = server.port();
+    REQUIRE(port > 0);
+
+    SECTION("Client tool calls are returned to the client")
+    {
+        auto const response = fetch(port,
+                                        httpRequest("POST",
+                                                    "/v1/chat/completions",
+                                                    R"({"messages": [{"role": "user", "content": "hi"}],
+                                                        "tools": [{"type": "function",
+                                                                   "function": {"name": "lookup"}}]})"));
+        CHECK(response.starts_with("HTTP/1.1 200 OK\r\n"));
+        auto const json = nlohmann::json::parse(responseBody(response));
+        CHECK(json["choices"][0]["finish_reason"] == "tool_calls");
+        CHECK(json["choices"][0]["message"]["tool_calls"][0]["function"]["name"] == "lookup");
+        CHECK(json["usage"]["prompt_tokens_details"]["cached_tokens"] == 30);
+
+        // The configured system prompt stands in for the one the request lacks.
+        auto const lock = std::lock_guard(engine.mutex);
+        REQUIRE(engine.lastMessages.size() == 2);
+        CHECK(engine.lastMessages[0].content == "You are mychat.");
+    }
+
+    SECTION("Requests without tools run through the agent loop and can be streamed")
+    {
+        auto const response = fetch(port,
+                                        httpRequest("POST",
+                                                    "/v1/chat/completions",
+                                                    R"({"messages": [{"role": "user", "content": "hi"}],
+                                                        "stream": true,
+                                                        "stream_options": {"include_usage": true}})"));
+        CHECK(response.starts_with("HTTP/1.1 200 OK\r\n"));
+        CHECK(response.contains("Content-Type: text/event-stream"));
+        auto const body = responseBody(response);
+        CHECK(body.starts_with(R"(data: {"choices":[{"delta":{"content":"","role":"assistant"})"));
+        CHECK(body.contains(R"("delta":{"content":"Hello"})"));
+        CHECK(body.contains(R"("delta":{"content":" world"})"));
+        CHECK(body.contains(R"("finish_reason":"stop")"));
+        CHECK(body.contains(R"("completion_tokens":2)"));
+        CHECK(body.ends_with("data: [DONE]\n\n"));
+    }
+
+    SECTION("max_tokens cuts the response short")
+    {
+        auto const response = fetch(port,
+                                        httpRequest("POST",
+                                                    "/v1/chat/completions",
+                                                    R"({"messages": [{"role": "user", "content": "hi"}],
+                                                        "max_tokens": 1})"));
+        auto const json = nlohmann::json::parse(responseBody(response));
+        CHECK(json["choices"][0]["finish_reason"] == "length");
+    }
+
+    SECTION("Other endpoints and malformed requests")
+    {
+        auto const models = fetch(port, httpRequest("GET", "/v1/models"));
+        CHECK(nlohmann::json::parse(responseBody(models))["data"][0]["id"] == "mychat");
+        CHECK(fetch(port, httpRequest("GET", "/v1/nothing")).starts_with("HTTP/1.1 404"));
+        CHECK(fetch(port, httpRequest("GET", "/v1/chat/completions")).starts_with("HTTP/1.1 405"));
+        CHECK(fetch(port, httpRequest("POST", "/v1/chat/completions", "{")).starts_with("HTTP/1.1 400"));
+        auto const invalid = fetch(port, httpRequest("POST", "/v1/chat/completions", R"({"messages": 1})"));
+        CHECK(invalid.starts_with("HTTP/1.1 400"));
+        CHECK(nlohmann::json::parse(responseBody(invalid))["error"]["type"] == "invalid_request_error");
+    }
+
+    server.stop();
+}
+
+TEST_CASE("ChatServer queues requests and cancels those whose client disconnects", "[chat-server]")
+{
+    auto engine = ScriptedEngine();
+    engine.blocking = true;
+    auto servers = ServerManager();
+    auto server = ChatServer(engine, servers, AgentConfig {}, serverConfig());
+    REQUIRE(server.start().has_value());
+    auto const request =
+        httpRequest("POST", "/v1/chat/completions", R"({"messages": [{"role": "user", "content": "hi"}]})");
+
+    auto const running = connectTo(server.port());
+    REQUIRE(::send(running, request.data(), request.size(), MSG_NOSIGNAL) > 0);
+    REQUIRE(eventually([&] { return engine.started == 1; }));
+
+    auto const waiting = connectTo(server.port());
+    REQUIRE(::send(waiting, request.data(), request.size(), MSG_NOSIGNAL) > 0);
+    REQUIRE(eventually([&] { return server.queuedRequests() == 1; }));
+
+    // The queue holds one request, so the next is refused.
+    CHECK(fetch(server.port(), request).starts_with("HTTP/1.1 503"));
+
+    // The waiting request is dropped without ever reaching the engine, the running one is stopped.
+    ::close(waiting);
+    std::this_thread::sleep_for(500ms);
+    ::close(running);
+    CHECK(eventually([&] { return engine.cancelled == 1 && server.queuedRequests() == 0; }));
+    std::this_thread::sleep_for(100ms);
+    CHECK(engine.started == 1);
+
+    server.stop();
+}
+
+TEST_CASE("ChatServer answers requests in parallel with several engines", "[chat-server]")
+{
+    auto first = ScriptedEngine();
+    auto second = ScriptedEngine();
+    first.blocking = true;
+    second.blocking = true;
+    auto const engines = std::array<InferenceEngine*, 2> { &first, &second };
+    auto servers = ServerManager();
+    auto server = ChatServer(engines, servers, AgentConfig {}, serverConfig());
+    REQUIRE(server.start().has_value());
+    auto const request =
+        httpRequest("POST", "/v1/chat/completions", R"({"messages": [{"role": "user", "content": "hi"}]})");
+
+    // The second request is taken by the idle engine instead of waiting for the busy one.
+    auto const a = connectTo(server.port());
+    REQUIRE(::send(a, request.data(), request.size(), MSG_NOSIGNAL) > 0);
+    REQUIRE(eventually([&] { return first.started + second.started == 1; }));
+    auto const b = connectTo(server.port());
+    REQUIRE(::send(b, request.data(), request.size(), MSG_NOSIGNAL) > 0);
+    CHECK(eventually([&] { return first.started == 1 && second.started == 1; }));
+    CHECK(server.queuedRequests() == 0);
+
+    ::close(a);
+    ::close(b);
+    CHECK(eventually([&] { return first.cancelled == 1 && second.cancelled == 1; }));
+
+    server.stop();
+}
+
+#endif
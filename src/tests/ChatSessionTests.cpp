@@ -3,6 +3,8 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <vector>
+
 using namespace mychat;
 
 TEST_CASE("ChatSession starts with system prompt", "[chat]")
@@ -95,6 +97,116 @@ TEST_CASE("ChatSession setSystemPrompt replaces prompt", "[chat]")
     CHECK(session.systemPrompt() == "new prompt");
 }
 
+TEST_CASE("ChatSession state snapshot is dropped with the system prompt", "[chat]")
+{
+    auto session = ChatSession("prompt");
+    CHECK(session.stateSnapshot().empty());
+
+    session.setStateSnapshot("/tmp/snapshot.state");
+    session.addUserMessage("Hello");
+    session.clear();
+    CHECK(session.stateSnapshot() == "/tmp/snapshot.state");
+
+    session.setSystemPrompt("other prompt");
+    CHECK(session.stateSnapshot().empty());
+}
+
+TEST_CASE("ChatSession evicts the oldest turn but keeps the latest", "[chat]")
+{
+    auto session = ChatSession("sys");
+    session.addUserMessage("first");
+    session.addAssistantMessage("calling", { ToolCall { .id = "call_0", .name = "t", .arguments = {} } });
+    session.addToolResult("call_0", "result");
+    session.addAssistantMessage("done");
+    session.addUserMessage("second");
+    session.addAssistantMessage("answer");
+
+    REQUIRE(session.evictOldestTurn());
+    auto const& messages = session.messages();
+    REQUIRE(messages.size() == 3);
+    CHECK(messages[0].role == Role::System);
+    CHECK(messages[1].content == "second");
+    CHECK(messages[2].content == "answer");
+
+    CHECK_FALSE(session.evictOldestTurn());
+    CHECK(session.messages().size() == 3);
+}
+
+TEST_CASE("ChatSession keeps token counts with their messages", "[chat]")
+{
+    auto session = ChatSession("sys");
+    session.addUserMessage("first");
+    session.addAssistantMessage("answer");
+    CHECK_FALSE(session.tokenCount().has_value());
+
+    auto const counts = std::vector<size_t> { 10, 5, 7 };
+    session.setTokenCounts(counts);
+    CHECK(session.tokenCount() == 22);
+
+    session.addUserMessage("second");
+    CHECK_FALSE(session.tokenCount().has_value()); // Not counted yet.
+    session.setTokenCounts(std::vector<size_t> { 10, 5, 7, 3 });
+    CHECK(session.tokenCount() == 25);
+
+    REQUIRE(session.evictOldestTurn());
+    CHECK(session.tokenCount() == 13);
+    CHECK(session.fork(0).tokenCount() == 10);
+
+    session.clear();
+    CHECK(session.tokenCount() == 10);
+    session.setSystemPrompt("other");
+    CHECK_FALSE(session.tokenCount().has_value());
+    session.setTokenCounts(std::vector<size_t> { 8, 99 });
+    CHECK(session.tokenCount() == 8);
+
+    session.addUserMessage("third");
+    session.setTokenCounts(std::vector<size_t> { 8, 4 });
+    session.clearTokenCounts();
+    CHECK_FALSE(session.tokenCount().has_value());
+    session.setTokenCounts(std::vector<size_t> { 9, 6 });
+    CHECK(session.tokenCount() == 15);
+}
+
+TEST_CASE("ChatSession forks share the message prefix", "[chat]")
+{
+    auto session = ChatSession("sys");
+    session.setStateSnapshot("/tmp/snapshot.state");
+    session.addUserMessage("first");
+    session.addAssistantMessage("answer");
+    session.addUserMessage("second");
+
+    auto branch = session.fork(2);
+    REQUIRE(branch.messageCount() == 2);
+    CHECK(branch.messages()[0].role == Role::System);
+    CHECK(branch.messages()[2].content == "answer");
+    CHECK(branch.stateSnapshot() == "/tmp/snapshot.state");
+
+    branch.addUserMessage("other");
+    CHECK(session.messages()[3].content == "second");
+    CHECK(session.fork(10).messageCount() == 3);
+    CHECK(session.fork(0).messages().size() == 1);
+}
+
+TEST_CASE("ChatSession pops the last turn for regeneration", "[chat]")
+{
+    auto session = ChatSession("sys");
+    CHECK_FALSE(session.popLastTurn().has_value());
+
+    session.addUserMessage("first");
+    session.addAssistantMessage("answer");
+    session.addUserMessage("second");
+    session.addAssistantMessage("calling", { ToolCall { .id = "call_0", .name = "t", .arguments = {} } });
+    session.addToolResult("call_0", "result");
+    session.addAssistantMessage("done");
+
+    CHECK(session.popLastTurn() == "second");
+    REQUIRE(session.messageCount() == 2);
+    CHECK(session.messages().back().content == "answer");
+
+    CHECK(session.popLastTurn() == "first");
+    CHECK(session.messages().size() == 1);
+}
+
 TEST_CASE("Role conversion roundtrips", "[types]")
 {
     CHECK(roleToString(Role::System) == "system");
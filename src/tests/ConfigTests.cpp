@@ -5,6 +5,8 @@
 
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <string>
 
 using namespace mychat;
 
@@ -27,7 +29,16 @@ TEST_CASE("AppConfig has expected defaults", "[config]")
     CHECK(config.llm.temperature == 0.7f);
     CHECK(config.audio.enabled == false);
     CHECK(config.audio.muteWhileSpeaking == true);
+    CHECK(config.audio.bargeIn == false);
+    CHECK(config.audio.partialIntervalMs == 0);
+    CHECK(config.audio.maxUtteranceMs == 30000);
+    CHECK(config.audio.useGpu == true);
+    CHECK(config.audio.flashAttention == false);
+    CHECK(config.audio.beamSize == 1);
+    CHECK(config.audio.reduceAudioContext == false);
+    CHECK(config.audio.warmUp == true);
     CHECK(config.agent.maxToolSteps == 10);
+    CHECK(config.memoryBudgetMb == 0);
 }
 
 TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
@@ -40,6 +51,9 @@ TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
                 "modelPath": "/tmp/test.gguf",
                 "contextSize": 4096,
                 "gpuLayers": 32,
+                "batchSize": 1024,
+                "ubatchSize": 256,
+                "threads": 6,
                 "temperature": 0.5,
                 "systemPrompt": "Test prompt"
             },
@@ -49,7 +63,13 @@ TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
                 "vadModelPath": "/tmp/silero-vad.ggml",
                 "language": "de",
                 "mode": "vad",
-                "muteWhileSpeaking": false
+                "muteWhileSpeaking": false,
+                "bargeIn": true,
+                "silenceDurationMs": 300,
+                "partialIntervalMs": 400,
+                "flashAttention": true,
+                "beamSize": 5,
+                "warmUp": false
             },
             "mcpServers": {
                 "test-server": {
@@ -76,6 +96,9 @@ TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
         CHECK(config.llm.modelPath == "/tmp/test.gguf");
         CHECK(config.llm.contextSize == 4096);
         CHECK(config.llm.gpuLayers == 32);
+        CHECK(config.llm.batchSize == 1024);
+        CHECK(config.llm.ubatchSize == 256);
+        CHECK(config.llm.threads == 6);
         CHECK(config.llm.temperature == 0.5f);
         CHECK(config.llm.systemPrompt == "Test prompt");
     }
@@ -88,6 +111,13 @@ TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
         CHECK(config.audio.language == "de");
         CHECK(config.audio.mode == VoiceMode::Vad);
         CHECK(config.audio.muteWhileSpeaking == false);
+        CHECK(config.audio.bargeIn == true);
+        CHECK(config.audio.silenceDurationMs == 300);
+        CHECK(config.audio.partialIntervalMs == 400);
+        CHECK(config.audio.useGpu == true);
+        CHECK(config.audio.flashAttention == true);
+        CHECK(config.audio.beamSize == 5);
+        CHECK(config.audio.warmUp == false);
     }
 
     SECTION("MCP server config")
@@ -111,6 +141,130 @@ TEST_CASE("loadConfigFromFile parses valid JSON config", "[config]")
     std::filesystem::remove(tempPath);
 }
 
+TEST_CASE("loadConfigFromFile parses draft model settings", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_draft_config.json";
+    {
+        auto file = std::ofstream(tempPath);
+        file << R"({
+            "llm": {
+                "modelPath": "/tmp/test.gguf",
+                "draftModelPath": "/tmp/draft.gguf",
+                "draftMaxTokens": 4,
+                "promptLookup": true,
+                "speculativePrefill": false
+            }
+        })";
+    }
+
+    auto result = loadConfigFromFile(tempPath.string());
+    REQUIRE(result.has_value());
+    CHECK(result->llm.draftModelPath == "/tmp/draft.gguf");
+    CHECK(result->llm.draftMaxTokens == 4);
+    CHECK(result->llm.promptLookup);
+    CHECK(result->llm.promptLookupNgram == 3);
+    CHECK_FALSE(result->llm.speculativePrefill);
+
+    std::filesystem::remove(tempPath);
+}
+
+TEST_CASE("loadConfigFromFile parses the model pool", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_model_pool_config.json";
+    {
+        auto file = std::ofstream(tempPath);
+        file << R"({
+            "llm": {
+                "modelPath": "/tmp/large.gguf",
+                "models": { "fast": "/tmp/small.gguf", "broken": 42 },
+                "modelPoolMb": 12000,
+                "toolSelectionModel": "fast"
+            }
+        })";
+    }
+
+    auto result = loadConfigFromFile(tempPath.string());
+    REQUIRE(result.has_value());
+    CHECK(result->llm.models == std::map<std::string, std::string> { { "fast", "/tmp/small.gguf" } });
+    CHECK(result->llm.modelPoolMb == 12000);
+    CHECK(result->llm.toolSelectionModel == "fast");
+
+    std::filesystem::remove(tempPath);
+}
+
+TEST_CASE("loadConfigFromFile parses sampler settings", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_sampler_config.json";
+    {
+        auto file = std::ofstream(tempPath);
+        file << R"({
+            "llm": {
+                "topK": 20,
+                "minP": 0.1,
+                "repeatPenalty": 1.0,
+                "dryMultiplier": 0.8
+            }
+        })";
+    }
+
+    auto result = loadConfigFromFile(tempPath.string());
+    REQUIRE(result.has_value());
+    CHECK(result->llm.topK == 20);
+    CHECK(result->llm.topP == 0.9f);
+    CHECK(result->llm.minP == 0.1f);
+    CHECK(result->llm.repeatPenalty == 1.0f);
+    CHECK(result->llm.repeatLastN == 64);
+    CHECK(result->llm.dryMultiplier == 0.8f);
+    CHECK(result->llm.xtcProbability == 0.0f);
+
+    std::filesystem::remove(tempPath);
+}
+
+TEST_CASE("loadConfigFromFile parses KV cache and attention settings", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_kv_config.json";
+    {
+        auto file = std::ofstream(tempPath);
+        file << R"({
+            "llm": {
+                "kvCacheTypeK": "q8_0",
+                "kvCacheTypeV": "q4_0",
+                "flashAttention": "on",
+                "useMmap": false,
+                "useMlock": true,
+                "offloadKqv": false
+            }
+        })";
+    }
+
+    auto result = loadConfigFromFile(tempPath.string());
+    REQUIRE(result.has_value());
+    CHECK(result->llm.kvCacheTypeK == KvCacheType::Q8_0);
+    CHECK(result->llm.kvCacheTypeV == KvCacheType::Q4_0);
+    CHECK(result->llm.flashAttention == FlashAttention::Enabled);
+    CHECK(result->llm.useMmap == false);
+    CHECK(result->llm.useMlock == true);
+    CHECK(result->llm.offloadKqv == false);
+
+    std::filesystem::remove(tempPath);
+}
+
+TEST_CASE("loadConfigFromFile ignores unknown KV cache types", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_kv_unknown_config.json";
+    {
+        auto file = std::ofstream(tempPath);
+        file << R"({ "llm": { "kvCacheTypeK": "q3_k" } })";
+    }
+
+    auto result = loadConfigFromFile(tempPath.string());
+    REQUIRE(result.has_value());
+    CHECK(result->llm.kvCacheTypeK == KvCacheType::F16);
+    CHECK(result->llm.flashAttention == FlashAttention::Auto);
+
+    std::filesystem::remove(tempPath);
+}
+
 TEST_CASE("loadConfigFromFile parses vadModelPath from audio config", "[config]")
 {
     auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_vad_config.json";
@@ -202,7 +356,9 @@ TEST_CASE("loadConfigFromFile parses TTS config", "[config]")
             "tts": {
                 "enabled": true,
                 "modelPath": "/tmp/en_US-lessac-medium.onnx",
-                "espeakDataPath": "/opt/espeak-ng-data"
+                "espeakDataPath": "/opt/espeak-ng-data",
+                "phraseCacheMb": 4,
+                "diskPhraseCache": true
             }
         })";
     }
@@ -212,6 +368,8 @@ TEST_CASE("loadConfigFromFile parses TTS config", "[config]")
     CHECK(result->tts.enabled == true);
     CHECK(result->tts.modelPath == "/tmp/en_US-lessac-medium.onnx");
     CHECK(result->tts.espeakDataPath == "/opt/espeak-ng-data");
+    CHECK(result->tts.phraseCacheMb == 4);
+    CHECK(result->tts.diskPhraseCache == true);
 
     std::filesystem::remove(tempPath);
 }
@@ -229,6 +387,8 @@ TEST_CASE("loadConfigFromFile defaults TTS config", "[config]")
     CHECK(result->tts.enabled == false);
     CHECK(result->tts.modelPath.empty());
     CHECK(result->tts.espeakDataPath.empty());
+    CHECK(result->tts.phraseCacheMb == 16);
+    CHECK(result->tts.diskPhraseCache == false);
 
     std::filesystem::remove(tempPath);
 }
@@ -239,6 +399,8 @@ TEST_CASE("AppConfig has expected TTS defaults", "[config]")
     CHECK(config.tts.enabled == false);
     CHECK(config.tts.modelPath.empty());
     CHECK(config.tts.espeakDataPath.empty());
+    CHECK(config.tts.phraseCacheMb == 16);
+    CHECK(config.tts.diskPhraseCache == false);
 }
 
 TEST_CASE("loadConfigFromFile returns error for non-existent file", "[config]")
@@ -381,12 +543,25 @@ TEST_CASE("saveConfigToFile writes a valid config that can be loaded back", "[co
     config.audio.language = "de";
     config.audio.mode = VoiceMode::Vad;
     config.audio.muteWhileSpeaking = false;
+    config.audio.bargeIn = true;
+    config.audio.partialIntervalMs = 250;
+    config.audio.maxUtteranceMs = 15000;
+    config.audio.useGpu = false;
+    config.audio.beamSize = 3;
+    config.audio.threads = 2;
+    config.audio.reduceAudioContext = true;
     config.tts.enabled = true;
     config.tts.modelPath = "/tmp/tts-model.onnx";
     config.tts.espeakDataPath = "/opt/espeak-ng-data";
+    config.tts.phraseCacheMb = 8;
+    config.tts.diskPhraseCache = true;
     config.agent.maxToolSteps = 5;
     config.agent.maxRetries = 2;
     config.agent.verbose = true;
+    config.agent.toolResultRecencyTurns = 2;
+    config.agent.summarizeToolResults = true;
+    config.agent.memorySnippets = 3;
+    config.agent.memoryMinSimilarity = 0.25f;
 
     auto saveResult = saveConfigToFile(tempPath.string(), config);
     REQUIRE(saveResult.has_value());
@@ -405,12 +580,25 @@ TEST_CASE("saveConfigToFile writes a valid config that can be loaded back", "[co
     CHECK(loaded.audio.language == "de");
     CHECK(loaded.audio.mode == VoiceMode::Vad);
     CHECK(loaded.audio.muteWhileSpeaking == false);
+    CHECK(loaded.audio.bargeIn == true);
+    CHECK(loaded.audio.partialIntervalMs == 250);
+    CHECK(loaded.audio.maxUtteranceMs == 15000);
+    CHECK(loaded.audio.useGpu == false);
+    CHECK(loaded.audio.beamSize == 3);
+    CHECK(loaded.audio.threads == 2);
+    CHECK(loaded.audio.reduceAudioContext == true);
     CHECK(loaded.tts.enabled == true);
     CHECK(loaded.tts.modelPath == "/tmp/tts-model.onnx");
     CHECK(loaded.tts.espeakDataPath == "/opt/espeak-ng-data");
+    CHECK(loaded.tts.phraseCacheMb == 8);
+    CHECK(loaded.tts.diskPhraseCache == true);
     CHECK(loaded.agent.maxToolSteps == 5);
     CHECK(loaded.agent.maxRetries == 2);
     CHECK(loaded.agent.verbose == true);
+    CHECK(loaded.agent.toolResultRecencyTurns == 2);
+    CHECK(loaded.agent.summarizeToolResults == true);
+    CHECK(loaded.agent.memorySnippets == 3);
+    CHECK(loaded.agent.memoryMinSimilarity == 0.25f);
 
     std::filesystem::remove(tempPath);
 }
@@ -425,6 +613,12 @@ TEST_CASE("saveConfigToFile round-trips MCP server config", "[config]")
         .command = "echo",
         .args = { "hello", "world" },
         .env = { { "KEY", "value" } },
+        .cachedTools = { "read_file" },
+        .cacheTtlSeconds = 60,
+        .startupTimeoutSeconds = 5,
+        .requestTimeoutSeconds = 15,
+        .lazyStart = false,
+        .idleTimeoutSeconds = 600,
     };
 
     auto saveResult = saveConfigToFile(tempPath.string(), config);
@@ -441,6 +635,48 @@ TEST_CASE("saveConfigToFile round-trips MCP server config", "[config]")
     CHECK(server.args[1] == "world");
     REQUIRE(server.env.contains("KEY"));
     CHECK(server.env.at("KEY") == "value");
+    REQUIRE(server.cachedTools.size() == 1);
+    CHECK(server.cachedTools[0] == "read_file");
+    CHECK(server.cacheTtlSeconds == 60);
+    CHECK(server.startupTimeoutSeconds == 5);
+    CHECK(server.requestTimeoutSeconds == 15);
+    CHECK(!server.lazyStart);
+    CHECK(server.idleTimeoutSeconds == 600);
+
+    std::filesystem::remove(tempPath);
+}
+
+TEST_CASE("saveConfigToFile round-trips remote MCP server config", "[config]")
+{
+    auto const tempPath = std::filesystem::temp_directory_path() / "mychat_test_save_remote_mcp.json";
+
+    auto config = AppConfig {};
+    config.mcpServers["remote"] = McpServerConfig {
+        .name = "remote",
+        .command = {},
+        .args = {},
+        .env = {},
+        .url = "http://tools.example:8080/mcp",
+        .headers = { { "Authorization", "Bearer secret" } },
+        .cachedTools = {},
+    };
+    config.useMcpDaemon = true;
+    config.mcpDaemonSocket = "/run/user/1000/mcpd.sock";
+
+    auto saveResult = saveConfigToFile(tempPath.string(), config);
+    REQUIRE(saveResult.has_value());
+
+    auto loadResult = loadConfigFromFile(tempPath.string());
+    REQUIRE(loadResult.has_value());
+
+    REQUIRE(loadResult->mcpServers.contains("remote"));
+    auto const& server = loadResult->mcpServers.at("remote");
+    CHECK(server.command.empty());
+    CHECK(server.url == "http://tools.example:8080/mcp");
+    REQUIRE(server.headers.contains("Authorization"));
+    CHECK(server.headers.at("Authorization") == "Bearer secret");
+    CHECK(loadResult->useMcpDaemon);
+    CHECK(loadResult->mcpDaemonSocket == "/run/user/1000/mcpd.sock");
 
     std::filesystem::remove(tempPath);
 }
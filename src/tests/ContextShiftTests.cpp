@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/ContextShift.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace mychat;
+
+TEST_CASE("contextShiftFor: no shift while the prompt fits", "[llm][context]")
+{
+    CHECK(contextShiftFor(100, 10, 0, 200) == 0);
+    CHECK(contextShiftFor(200, 10, 0, 200) == 0);
+    // A previous shift is dropped once the prompt fits again (e.g. after a reset).
+    CHECK(contextShiftFor(100, 10, 50, 200) == 0);
+}
+
+TEST_CASE("contextShiftFor: discards half of the evictable tokens at a time", "[llm][context]")
+{
+    auto const shift = contextShiftFor(300, 10, 0, 200);
+    CHECK(shift == 145);
+
+    // The next turns keep the same layout until it overflows again.
+    CHECK(contextShiftFor(320, 10, shift, 200) == shift);
+    auto const next = contextShiftFor(400, 10, shift, 200);
+    CHECK(next > shift);
+    CHECK(400 - next <= 200);
+}
+
+TEST_CASE("contextShiftFor: never discards the kept prefix", "[llm][context]")
+{
+    // The kept prefix alone exceeds the limit: everything else is discarded.
+    CHECK(contextShiftFor(300, 250, 0, 200) == 50);
+}
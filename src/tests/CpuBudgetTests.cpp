@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/CpuBudget.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace mychat;
+
+TEST_CASE("parseCpuList: reads ranges and single CPUs", "[core][cpu]")
+{
+    CHECK(parseCpuList("0-3,8,10-11\n") == std::vector<unsigned> { 0, 1, 2, 3, 8, 10, 11 });
+    CHECK(parseCpuList("5") == std::vector<unsigned> { 5 });
+    CHECK(parseCpuList("").empty());
+    CHECK(parseCpuList("3-1").empty());
+    CHECK(parseCpuList("0-").empty());
+    CHECK(parseCpuList("a,b").empty());
+}
+
+TEST_CASE("planThreads: keeps the LLM on the performance cores", "[core][cpu]")
+{
+    auto const hybrid = CpuTopology { .logicalCpus = 20, .performanceCpus = 8 };
+    auto const alone = planThreads(hybrid, CpuWorkloads {});
+    CHECK(alone.decodeThreads == 8);
+    CHECK(alone.batchThreads == 8);
+
+    // Piper takes an efficiency core, whisper a share of the decode threads.
+    auto const voice = planThreads(hybrid, CpuWorkloads { .transcription = true, .speech = true });
+    CHECK(voice.transcriptionThreads == 2);
+    CHECK(voice.decodeThreads == 6);
+    CHECK(voice.batchThreads == 8);
+}
+
+TEST_CASE("planThreads: shares the cores of a uniform CPU", "[core][cpu]")
+{
+    auto const uniform = CpuTopology { .logicalCpus = 16, .performanceCpus = 16 };
+    auto const voice = planThreads(uniform, CpuWorkloads { .transcription = true, .speech = true });
+    CHECK(voice.transcriptionThreads == 4);
+    CHECK(voice.batchThreads == 15);
+    CHECK(voice.decodeThreads == 11);
+
+    auto const single = planThreads(CpuTopology {}, CpuWorkloads { .transcription = true, .speech = true });
+    CHECK(single == ThreadBudget { .decodeThreads = 1, .batchThreads = 1, .transcriptionThreads = 1 });
+}
+
+TEST_CASE("detectCpuTopology: finds at least one performance core", "[core][cpu]")
+{
+    auto const cpus = detectCpuTopology();
+    CHECK(cpus.performanceCpus >= 1);
+    CHECK(cpus.performanceCpus <= cpus.logicalCpus);
+}
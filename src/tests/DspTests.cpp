@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <audio/Dsp.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// A deterministic test signal; its length is not a multiple of any vector width.
+auto testSignal(size_t count) -> std::vector<float>
+{
+    auto samples = std::vector<float>(count);
+    for (auto i = size_t { 0 }; i < count; ++i)
+        samples[i] = std::sin(static_cast<float>(i) * 0.37f) * (i % 7 == 3 ? -0.9f : 0.5f);
+    return samples;
+}
+
+auto testPcm(size_t count) -> std::vector<std::int16_t>
+{
+    auto samples = std::vector<std::int16_t>(count);
+    for (auto i = size_t { 0 }; i < count; ++i)
+        samples[i] = static_cast<std::int16_t>(static_cast<int>((i * 7919) % 65536) - 32768);
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("dsp::measure matches a scalar peak and energy pass", "[audio][dsp]")
+{
+    for (auto const count: { size_t { 0 }, size_t { 3 }, size_t { 17 }, size_t { 480 }, size_t { 1003 } })
+    {
+        auto const samples = testSignal(count);
+        auto peak = 0.0f;
+        auto sumSquares = 0.0;
+        for (auto const sample: samples)
+        {
+            peak = std::max(peak, std::abs(sample));
+            sumSquares += double { sample } * sample;
+        }
+
+        auto const levels = dsp::measure(samples);
+        CHECK(levels.peak == peak);
+        CHECK(levels.sumSquares == Catch::Approx(sumSquares).epsilon(1e-5));
+        CHECK(dsp::rms(levels, count) == Catch::Approx(count == 0 ? 0.0 : std::sqrt(sumSquares / count)));
+    }
+}
+
+TEST_CASE("dsp::dot matches a scalar dot product", "[audio][dsp]")
+{
+    for (auto const count: { size_t { 0 }, size_t { 5 }, size_t { 64 }, size_t { 191 } })
+    {
+        auto const a = testSignal(count);
+        auto const b = testSignal(count + 3);
+        auto expected = 0.0;
+        for (auto i = size_t { 0 }; i < count; ++i)
+            expected += double { a[i] } * b[i + 3];
+
+        auto const actual = dsp::dot(a, std::span(b).subspan(3));
+        CHECK(actual == Catch::Approx(expected).margin(1e-5));
+    }
+}
+
+TEST_CASE("dsp::toFloat maps 16-bit PCM to [-1, 1)", "[audio][dsp]")
+{
+    auto const pcm = testPcm(37);
+    auto converted = std::vector<float>(pcm.size());
+    dsp::toFloat(pcm, converted);
+    for (auto i = size_t { 0 }; i < pcm.size(); ++i)
+        CHECK(converted[i] == static_cast<float>(pcm[i]) / 32768.0f);
+
+    auto const extremes = std::vector<std::int16_t> { -32768, 32767, 0 };
+    auto out = std::vector<float>(extremes.size());
+    dsp::toFloat(extremes, out);
+    CHECK(out[0] == -1.0f);
+    CHECK(out[1] < 1.0f);
+    CHECK(out[2] == 0.0f);
+}
+
+TEST_CASE("dsp::downmix averages interleaved channels", "[audio][dsp]")
+{
+    for (auto const channels: { 1u, 2u, 3u, 6u })
+    {
+        auto const interleaved = testSignal(channels * 23);
+        auto mono = std::vector<float>(23);
+        dsp::downmix(interleaved, channels, mono);
+        for (auto frame = size_t { 0 }; frame < mono.size(); ++frame)
+        {
+            auto sum = 0.0f;
+            for (auto channel = 0u; channel < channels; ++channel)
+                sum += interleaved[frame * channels + channel];
+            CHECK(mono[frame] == Catch::Approx(sum / static_cast<float>(channels)).margin(1e-6));
+        }
+    }
+}
+
+TEST_CASE("dsp::downmix converts and averages 16-bit PCM", "[audio][dsp]")
+{
+    for (auto const channels: { 1u, 2u, 4u })
+    {
+        auto const interleaved = testPcm(channels * 29);
+        auto mono = std::vector<float>(29);
+        dsp::downmix(interleaved, channels, mono);
+        for (auto frame = size_t { 0 }; frame < mono.size(); ++frame)
+        {
+            auto sum = 0;
+            for (auto channel = 0u; channel < channels; ++channel)
+                sum += interleaved[frame * channels + channel];
+            CHECK(mono[frame] == Catch::Approx(sum / (32768.0 * channels)).margin(1e-6));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/GenerationOutput.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+// Counting allocator: replaces the global operator new for the test binary. Allocations are
+// only counted while a test has armed the counter.
+namespace
+{
+
+std::atomic<bool> countingEnabled = false;
+std::atomic<size_t> allocationCount = 0;
+
+/// @brief Counts heap allocations made during the lifetime of the guard.
+class AllocationCounter
+{
+  public:
+    AllocationCounter()
+    {
+        allocationCount = 0;
+        countingEnabled = true;
+    }
+
+    ~AllocationCounter() { countingEnabled = false; }
+
+    AllocationCounter(AllocationCounter const&) = delete;
+    AllocationCounter& operator=(AllocationCounter const&) = delete;
+
+    [[nodiscard]] auto count() const -> size_t { return allocationCount; }
+};
+
+auto countedAlloc(std::size_t size) -> void*
+{
+    if (countingEnabled.load(std::memory_order_relaxed))
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+/// Pieces resembling a decoded token stream, including near-misses of the tool-call tag.
+constexpr auto Pieces = std::array<std::string_view, 8> {
+    "The", " quick", " brown", " <", "tool", "s", ">", " fox.\n",
+};
+
+} // namespace
+
+auto operator new(std::size_t size) -> void*
+{
+    return countedAlloc(size);
+}
+
+auto operator new[](std::size_t size) -> void*
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+TEST_CASE("GenerationOutput: streams text and collects tool calls", "[llm][output]")
+{
+    auto const tools = std::vector {
+        ToolDefinition { .name = "read_file", .description = "Reads a file", .inputSchema = {} },
+    };
+    auto streamed = std::string {};
+    auto earlyCalls = std::vector<std::string> {};
+    auto const streamCb = StreamCallback { [&](std::string_view text) { streamed += text; } };
+    auto const toolCallCb =
+        ToolCallCallback { [&](const ToolCall& call) { earlyCalls.push_back(call.name); } };
+
+    auto output = GenerationOutput {};
+    output.begin(tools, 256);
+    output.append("Checking.", streamCb, toolCallCb);
+    output.append(R"(<tool_call>{"name": "read_file", "arguments": {}})", streamCb, toolCallCb);
+    CHECK(earlyCalls.empty());
+    output.append("</tool_call>", streamCb, toolCallCb);
+    CHECK(earlyCalls == std::vector<std::string> { "read_file" });
+
+    auto result = GenerateResult {};
+    output.finish(result, streamCb);
+    CHECK(streamed == "Checking.");
+    CHECK(result.text == "Checking.");
+    REQUIRE(result.toolCalls.size() == 1);
+    CHECK(result.toolCalls[0].name == "read_file");
+}
+
+TEST_CASE("GenerationOutput: steady-state token loop does not allocate", "[llm][output]")
+{
+    auto const tools = std::vector {
+        ToolDefinition { .name = "read_file", .description = "Reads a file", .inputSchema = {} },
+    };
+    auto streamedBytes = size_t { 0 };
+    auto const streamCb = StreamCallback { [&](std::string_view text) { streamedBytes += text.size(); } };
+    auto const toolCallCb = ToolCallCallback {};
+
+    constexpr auto Rounds = 1000;
+    auto output = GenerationOutput {};
+
+    for (auto const withTools: { false, true })
+    {
+        output.begin(withTools ? std::span<const ToolDefinition>(tools) : std::span<const ToolDefinition> {},
+                     Rounds * 64);
+
+        // Warm-up: let scratch buffers reach their working size.
+        for (auto const piece: Pieces)
+            output.append(piece, streamCb, toolCallCb);
+
+        auto allocations = size_t { 0 };
+        {
+            auto const counter = AllocationCounter {};
+            for (auto round = 0; round < Rounds; ++round)
+                for (auto const piece: Pieces)
+                    output.append(piece, streamCb, toolCallCb);
+            allocations = counter.count();
+        }
+        CHECK(allocations == 0);
+
+        auto result = GenerateResult {};
+        output.finish(result, streamCb);
+        CHECK(result.text.size() == streamedBytes);
+        CHECK(result.toolCalls.empty());
+        streamedBytes = 0;
+    }
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/Hash.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace mychat;
+
+TEST_CASE("fnv1a64 matches reference values", "[core][hash]")
+{
+    CHECK(fnv1a64(std::string_view {}) == 0xcbf29ce484222325ULL);
+    CHECK(fnv1a64("a") == 0xaf63dc4c8601ec8cULL);
+    CHECK(fnv1a64("foobar") == 0x85944171f73967e8ULL);
+    static_assert(fnv1a64("a") == 0xaf63dc4c8601ec8cULL);
+}
+
+TEST_CASE("fnv1a64 can be continued across pieces", "[core][hash]")
+{
+    CHECK(fnv1a64("bar", fnv1a64("foo")) == fnv1a64("foobar"));
+
+    auto const bytes = std::array<std::uint8_t, 3> { 'f', 'o', 'o' };
+    CHECK(fnv1a64(bytes) == fnv1a64("foo"));
+}
+
+TEST_CASE("Sha256 matches reference digests", "[core][hash]")
+{
+    CHECK(Sha256().hexDigest() == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    auto abc = Sha256();
+    abc.update("abc");
+    CHECK(abc.hexDigest() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // 56 bytes: the length no longer fits the first padding block.
+    auto twoBlocks = Sha256();
+    twoBlocks.update("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+    CHECK(twoBlocks.hexDigest() == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST_CASE("Sha256 is independent of how the message is split", "[core][hash]")
+{
+    auto const message = std::string(1000, 'a');
+    auto whole = Sha256();
+    whole.update(message);
+
+    auto pieces = Sha256();
+    for (auto offset = size_t { 0 }; offset < message.size(); offset += 37)
+        pieces.update(std::string_view(message).substr(offset, 37));
+    CHECK(pieces.hexDigest() == whole.hexDigest());
+}
@@ -0,0 +1,384 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mcp/HttpTransport.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+using namespace mychat;
+
+TEST_CASE("parseHttpUrl splits host, port and path", "[transport]")
+{
+    auto const plain = parseHttpUrl("http://localhost/mcp");
+    REQUIRE(plain.has_value());
+    CHECK(plain->host == "localhost");
+    CHECK(plain->port == 80);
+    CHECK(plain->path == "/mcp");
+
+    auto const withPort = parseHttpUrl("http://10.0.0.1:8080");
+    REQUIRE(withPort.has_value());
+    CHECK(withPort->host == "10.0.0.1");
+    CHECK(withPort->port == 8080);
+    CHECK(withPort->path == "/");
+
+    auto const ipv6 = parseHttpUrl("http://[::1]:3000/a?b=c");
+    REQUIRE(ipv6.has_value());
+    CHECK(ipv6->host == "::1");
+    CHECK(ipv6->port == 3000);
+    CHECK(ipv6->path == "/a?b=c");
+}
+
+TEST_CASE("parseHttpUrl rejects unsupported URLs", "[transport]")
+{
+    CHECK(!parseHttpUrl("https://example.com/mcp").has_value());
+    CHECK(!parseHttpUrl("ftp://example.com").has_value());
+    CHECK(!parseHttpUrl("http://:8080").has_value());
+    CHECK(!parseHttpUrl("http://host:99999").has_value());
+}
+
+TEST_CASE("HttpTransport send fails when not started", "[transport]")
+{
+    auto transport = HttpTransport();
+    CHECK(!transport.isConnected());
+    auto const result = transport.send(nlohmann::json { { "test", true } });
+    REQUIRE(!result.has_value());
+    CHECK(result.error().code == ErrorCode::TransportError);
+}
+
+#ifndef _WIN32
+namespace
+{
+
+/// @brief A minimal HTTP/1.1 server on 127.0.0.1 answering each request via a handler.
+///
+/// Connections are kept open until the client closes them, one thread per connection.
+class TestHttpServer
+{
+  public:
+    /// @brief Receives the raw request head and body and returns the raw response.
+    using Handler = std::function<std::string(std::string const& head, std::string const& body)>;
+
+    explicit TestHttpServer(Handler handler): _handler(std::move(handler))
+    {
+        _listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        auto address = sockaddr_in {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(_listener, 16);
+        auto length = socklen_t { sizeof(address) };
+        ::getsockname(_listener, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+        _acceptor = std::thread([this] { acceptLoop(); });
+    }
+
+    ~TestHttpServer()
+    {
+        ::shutdown(_listener, SHUT_RDWR);
+        ::close(_listener);
+        _acceptor.join();
+        {
+            auto const lock = std::lock_guard(_mutex);
+            for (auto const fd: _clients)
+                ::shutdown(fd, SHUT_RDWR);
+        }
+        for (auto& thread: _connections)
+            thread.join();
+    }
+
+    [[nodiscard]] auto url() const -> std::string { return std::format("http://127.0.0.1:{}/mcp", _port); }
+    [[nodiscard]] auto acceptedConnections() const -> int { return _accepted; }
+
+    [[nodiscard]] auto requests() const -> std::vector<std::string>
+    {
+        auto const lock = std::lock_guard(_mutex);
+        return _requests;
+    }
+
+  private:
+    Handler _handler;
+    int _listener = -1;
+    std::uint16_t _port = 0;
+    std::thread _acceptor;
+    std::vector<std::thread> _connections; ///< Only touched by the acceptor until it is joined.
+    std::atomic<int> _accepted = 0;
+
+    mutable std::mutex _mutex;
+    std::vector<int> _clients;
+    std::vector<std::string> _requests; ///< Heads of all requests received.
+
+    void acceptLoop()
+    {
+        while (true)
+        {
+            auto const fd = ::accept(_listener, nullptr, nullptr);
+            if (fd < 0)
+                return;
+            ++_accepted;
+            {
+                auto const lock = std::lock_guard(_mutex);
+                _clients.push_back(fd);
+            }
+            _connections.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd)
+    {
+        auto buffer = std::string {};
+        while (true)
+        {
+            auto headEnd = buffer.find("\r\n\r\n");
+            while (headEnd == std::string::npos)
+            {
+                if (!receiveMore(fd, buffer))
+                    return finish(fd);
+                headEnd = buffer.find("\r\n\r\n");
+            }
+            auto const head = buffer.substr(0, headEnd);
+            auto contentLength = size_t { 0 };
+            if (auto const pos = head.find("Content-Length: "); pos != std::string::npos)
+                contentLength = std::stoul(head.substr(pos + 16));
+            while (buffer.size() < headEnd + 4 + contentLength)
+                if (!receiveMore(fd, buffer))
+                    return finish(fd);
+            auto const body = buffer.substr(headEnd + 4, contentLength);
+            buffer.erase(0, headEnd + 4 + contentLength);
+
+            {
+                auto const lock = std::lock_guard(_mutex);
+                _requests.push_back(head);
+            }
+            auto const response = _handler(head, body);
+            if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0)
+                return finish(fd);
+        }
+    }
+
+    static auto receiveMore(int fd, std::string& buffer) -> bool
+    {
+        char chunk[4096];
+        auto const count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0)
+            return false;
+        buffer.append(chunk, static_cast<size_t>(count));
+        return true;
+    }
+
+    void finish(int fd)
+    {
+        auto const lock = std::lock_guard(_mutex);
+        std::erase(_clients, fd);
+        ::close(fd);
+    }
+};
+
+auto jsonResponse(std::string const& body, std::string_view extraHeaders = {}) -> std::string
+{
+    return std::format("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: {}\r\n{}\r\n{}",
+                       body.size(),
+                       extraHeaders,
+                       body);
+}
+
+/// @brief Echoes the request's ID back in an empty result.
+auto echoResult(std::string const& body) -> std::string
+{
+    auto const request = nlohmann::json::parse(body);
+    auto const response = nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", request["id"] },
+        { "result", nlohmann::json::object() },
+    };
+    return response.dump();
+}
+
+auto startTransport(HttpTransport& transport, std::string url, std::shared_ptr<HttpConnectionPool> pool = {})
+    -> VoidResult
+{
+    return transport.start(HttpTransportConfig {
+        .url = std::move(url),
+        .headers = { { "Authorization", "Bearer token" } },
+        .requestTimeout = std::chrono::seconds(5),
+        .pool = std::move(pool),
+    });
+}
+
+auto request(int id) -> nlohmann::json
+{
+    return nlohmann::json { { "jsonrpc", "2.0" }, { "id", id }, { "method", "ping" } };
+}
+
+} // namespace
+
+TEST_CASE("HttpTransport receives a JSON response", "[transport]")
+{
+    auto server =
+        TestHttpServer([](auto const&, auto const& body) { return jsonResponse(echoResult(body)); });
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url()).has_value());
+
+    REQUIRE(transport.send(request(1)).has_value());
+    auto const response = transport.receive();
+    REQUIRE(response.has_value());
+    CHECK((*response)["id"] == 1);
+    CHECK(response->contains("result"));
+
+    auto const requests = server.requests();
+    REQUIRE(requests.size() == 1);
+    CHECK(requests[0].starts_with("POST /mcp HTTP/1.1"));
+    CHECK(requests[0].contains("Authorization: Bearer token"));
+    CHECK(requests[0].contains("Accept: application/json, text/event-stream"));
+}
+
+TEST_CASE("HttpTransport receives notifications and the response from an event stream", "[transport]")
+{
+    auto server = TestHttpServer([](auto const&, auto const& body) {
+        auto const events = std::format(": keep-alive\n\n"
+                                        "event: message\n"
+                                        R"(data: {{"jsonrpc":"2.0","method":"notifications/progress"}})"
+                                        "\n\n"
+                                        "data: {}\r\n\r\n",
+                                        echoResult(body));
+        // Split across two chunks, the second one cutting an event in half.
+        auto const half = events.size() / 2;
+        return std::format("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                           "Transfer-Encoding: chunked\r\n\r\n{:x}\r\n{}\r\n{:x}\r\n{}\r\n0\r\n\r\n",
+                           half,
+                           events.substr(0, half),
+                           events.size() - half,
+                           events.substr(half));
+    });
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url()).has_value());
+
+    REQUIRE(transport.send(request(7)).has_value());
+    auto const notification = transport.receive();
+    REQUIRE(notification.has_value());
+    CHECK((*notification)["method"] == "notifications/progress");
+    auto const response = transport.receive();
+    REQUIRE(response.has_value());
+    CHECK((*response)["id"] == 7);
+}
+
+TEST_CASE("HttpTransport reuses keep-alive connections and keeps the session", "[transport]")
+{
+    auto server = TestHttpServer([](auto const& head, auto const& body) {
+        if (head.starts_with("GET"))
+            return std::string("HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n");
+        return jsonResponse(echoResult(body), "Mcp-Session-Id: session-1\r\n");
+    });
+    auto pool = std::make_shared<HttpConnectionPool>();
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url(), pool).has_value());
+
+    for (auto const id: { 1, 2 })
+    {
+        REQUIRE(transport.send(request(id)).has_value());
+        auto const response = transport.receive();
+        REQUIRE(response.has_value());
+        CHECK((*response)["id"] == id);
+
+        // The connection returns to the pool once its response has been read completely.
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (pool->idleConnectionCount() == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto const requests = server.requests();
+    auto posts = std::vector<std::string> {};
+    for (auto const& head: requests)
+        if (head.starts_with("POST"))
+            posts.push_back(head);
+    REQUIRE(posts.size() == 2);
+    CHECK(!posts[0].contains("Mcp-Session-Id"));
+    CHECK(posts[1].contains("Mcp-Session-Id: session-1"));
+
+    // Both POSTs share a connection; the refused event stream gets one of its own.
+    CHECK(pool->openedConnectionCount() <= 2);
+    CHECK(server.acceptedConnections() == static_cast<int>(pool->openedConnectionCount()));
+}
+
+TEST_CASE("HttpTransport answers a failed request with a JSON-RPC error", "[transport]")
+{
+    auto server = TestHttpServer([](auto const&, auto const&) {
+        return std::string("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4\r\n\r\nbusy");
+    });
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url()).has_value());
+
+    REQUIRE(transport.send(request(3)).has_value());
+    auto const response = transport.receive();
+    REQUIRE(response.has_value());
+    CHECK((*response)["id"] == 3);
+    REQUIRE(response->contains("error"));
+    CHECK((*response)["error"]["message"].get<std::string>().contains("503"));
+}
+
+TEST_CASE("HttpTransport rejects a malformed Content-Length and drops the connection", "[transport]")
+{
+    auto responses = std::atomic<int> { 0 };
+    auto server = TestHttpServer([&](auto const&, auto const& body) {
+        if (responses++ == 0)
+            return std::format("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                               "Content-Length: abc\r\n\r\n{}",
+                               echoResult(body));
+        return jsonResponse(echoResult(body));
+    });
+    auto pool = std::make_shared<HttpConnectionPool>();
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url(), pool).has_value());
+
+    REQUIRE(transport.send(request(1)).has_value());
+    auto const failed = transport.receive();
+    REQUIRE(failed.has_value());
+    CHECK((*failed)["id"] == 1);
+    REQUIRE(failed->contains("error"));
+    CHECK((*failed)["error"]["message"].get<std::string>().contains("Malformed Content-Length"));
+    CHECK(pool->idleConnectionCount() == 0);
+
+    // The unread body is not taken for the next response: that one comes on a fresh connection.
+    REQUIRE(transport.send(request(2)).has_value());
+    auto const response = transport.receive();
+    REQUIRE(response.has_value());
+    CHECK((*response)["id"] == 2);
+    CHECK(response->contains("result"));
+    CHECK(server.acceptedConnections() == 2);
+}
+
+TEST_CASE("HttpTransport close wakes up a blocked receive", "[transport]")
+{
+    auto server = TestHttpServer([](auto const&, auto const&) {
+        // An event stream that never delivers anything.
+        return std::string("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n");
+    });
+    auto transport = HttpTransport();
+    REQUIRE(startTransport(transport, server.url()).has_value());
+    REQUIRE(transport.send(request(1)).has_value());
+
+    auto closer = std::jthread([&transport] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        transport.close();
+    });
+    auto const response = transport.receive();
+    CHECK(!response.has_value());
+    CHECK(!transport.isConnected());
+}
+#endif
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/JsonReader.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace mychat;
+using Kind = json::JsonReader::Kind;
+
+TEST_CASE("JsonReader: reads members and skips the rest", "[core][json]")
+{
+    auto reader = json::JsonReader(R"( { "skip": {"a": [1, "]", {"b": null}]}, "name" : "echo", "n": -42,)"
+                                   R"( "flags": [true, false], "schema": {"type": "object"} } )");
+    REQUIRE(reader.peek() == Kind::Object);
+    REQUIRE(reader.enterObject());
+
+    auto name = std::string {};
+    auto number = std::int64_t { 0 };
+    auto flags = std::vector<bool> {};
+    auto schema = nlohmann::json {};
+    while (auto const key = reader.nextMember())
+    {
+        if (*key == "name")
+            CHECK(reader.readString(name));
+        else if (*key == "n")
+            CHECK(reader.readInteger(number));
+        else if (*key == "flags")
+        {
+            REQUIRE(reader.enterArray());
+            while (reader.nextElement())
+            {
+                auto flag = false;
+                CHECK(reader.readBoolean(flag));
+                flags.push_back(flag);
+            }
+        }
+        else if (*key == "schema")
+            schema = reader.readJson().value_or(nullptr);
+        else
+            CHECK(reader.skipValue());
+    }
+
+    CHECK_FALSE(reader.failed());
+    CHECK(reader.peek() == Kind::End);
+    CHECK(name == "echo");
+    CHECK(number == -42);
+    CHECK(flags == std::vector<bool> { true, false });
+    CHECK(schema == nlohmann::json { { "type", "object" } });
+}
+
+TEST_CASE("JsonReader: unescapes strings and keys", "[core][json]")
+{
+    auto reader = json::JsonReader(R"({"kéy": "tab\there \"quoted\" 😀 €\/"})");
+    REQUIRE(reader.enterObject());
+    auto const key = reader.nextMember();
+    REQUIRE(key.has_value());
+    CHECK(*key == "k\xC3\xA9y");
+
+    auto value = std::string {};
+    REQUIRE(reader.readString(value));
+    CHECK(value == "tab\there \"quoted\" \xF0\x9F\x98\x80 \xE2\x82\xAC/");
+    CHECK_FALSE(reader.nextMember().has_value());
+    CHECK_FALSE(reader.failed());
+}
+
+TEST_CASE("JsonReader: fails on malformed input and stays failed", "[core][json]")
+{
+    auto const fails = [](std::string_view text) {
+        auto reader = json::JsonReader(text);
+        reader.skipValue();
+        return reader.failed();
+    };
+    CHECK(fails(R"({"a": [1, 2})"));
+    CHECK(fails(R"("unterminated)"));
+    CHECK(fails("\"raw\ncontrol\""));
+    CHECK(fails("nul"));
+    CHECK(fails(""));
+
+    auto value = std::string {};
+    CHECK_FALSE(json::unescapeString(R"(\ud83d alone)", value));
+    CHECK_FALSE(json::unescapeString(R"(\x)", value));
+
+    auto reader = json::JsonReader(R"({"a": 1,})");
+    REQUIRE(reader.enterObject());
+    REQUIRE(reader.nextMember() == "a");
+    CHECK(reader.skipValue());
+    CHECK_FALSE(reader.nextMember().has_value());
+    CHECK(reader.failed());
+    CHECK(reader.peek() == Kind::Invalid);
+    CHECK_FALSE(reader.readString(value));
+}
@@ -90,3 +90,117 @@ TEST_CASE("parseResponse handles response without result or error", "[jsonrpc]")
     REQUIRE(!result.has_value());
     CHECK(result.error().code == ErrorCode::ProtocolError);
 }
+
+TEST_CASE("makeResponse and makeErrorResponse round-trip through parseResponse", "[jsonrpc]")
+{
+    auto success = jsonrpc::parseResponse(jsonrpc::makeResponse(7, nlohmann::json::object()));
+    REQUIRE(success.has_value());
+    CHECK(success->id == 7);
+    CHECK(success->isSuccess());
+
+    auto failure = jsonrpc::parseResponse(jsonrpc::makeErrorResponse("abc", -32601, "Method not found"));
+    REQUIRE(failure.has_value());
+    CHECK(failure->id == "abc");
+    REQUIRE(failure->error.has_value());
+    CHECK(failure->error->code == -32601);
+    CHECK(failure->error->message == "Method not found");
+}
+
+TEST_CASE("makeBatch and requestIds skip notifications", "[jsonrpc]")
+{
+    auto messages = std::vector<nlohmann::json> {
+        jsonrpc::makeNotification("notifications/initialized"),
+        jsonrpc::makeRequest(1, "tools/list"),
+        jsonrpc::makeRequest(2, "resources/list"),
+    };
+    auto batch = jsonrpc::makeBatch(messages);
+
+    REQUIRE(batch.is_array());
+    REQUIRE(batch.size() == 3);
+    CHECK(batch[0]["method"] == "notifications/initialized");
+
+    auto const ids = jsonrpc::requestIds(batch);
+    REQUIRE(ids.size() == 2);
+    CHECK(ids[0] == 1);
+    CHECK(ids[1] == 2);
+    CHECK(jsonrpc::requestIds(jsonrpc::makeRequest(3, "ping")) == std::vector<nlohmann::json> { 3 });
+    CHECK(jsonrpc::requestIds(jsonrpc::makeResponse(3, nlohmann::json::object())).empty());
+}
+
+TEST_CASE("parseBatchResponse correlates responses by id", "[jsonrpc]")
+{
+    auto const ids = std::vector<nlohmann::json> { 1, 2, 3 };
+    auto const message = nlohmann::json::array({
+        jsonrpc::makeErrorResponse(3, -32601, "Method not found"),
+        jsonrpc::makeResponse(1, { { "tools", nlohmann::json::array() } }),
+    });
+
+    auto const responses = jsonrpc::parseBatchResponse(message, ids);
+    REQUIRE(responses.has_value());
+    REQUIRE(responses->size() == 3);
+    CHECK((*responses)[0].isSuccess());
+    CHECK((*responses)[0].result->contains("tools"));
+    REQUIRE((*responses)[1].error.has_value());
+    CHECK((*responses)[1].id == 2);
+    CHECK((*responses)[1].error->code == -32603); // Unanswered.
+    REQUIRE((*responses)[2].error.has_value());
+    CHECK((*responses)[2].error->code == -32601);
+}
+
+TEST_CASE("parseBatchResponse applies a batch-level error to every request", "[jsonrpc]")
+{
+    auto const ids = std::vector<nlohmann::json> { 1, 2 };
+    auto const responses =
+        jsonrpc::parseBatchResponse(jsonrpc::makeErrorResponse(nullptr, -32600, "Invalid Request"), ids);
+    REQUIRE(responses.has_value());
+    REQUIRE(responses->size() == 2);
+    for (auto const& response: *responses)
+    {
+        REQUIRE(response.error.has_value());
+        CHECK(response.error->code == -32600);
+    }
+    CHECK((*responses)[1].id == 2);
+}
+
+TEST_CASE("parseBatchResponse rejects responses to unknown requests", "[jsonrpc]")
+{
+    auto const ids = std::vector<nlohmann::json> { 1 };
+    auto const message = nlohmann::json::array({ jsonrpc::makeResponse(9, nlohmann::json::object()) });
+    auto const responses = jsonrpc::parseBatchResponse(message, ids);
+    REQUIRE(!responses.has_value());
+    CHECK(responses.error().code == ErrorCode::ProtocolError);
+}
+
+TEST_CASE("scanMessage leaves params, result and error as JSON text", "[jsonrpc]")
+{
+    auto const text = std::string_view {
+        R"([{"jsonrpc":"2.0","id":7,"result":{"tools":[]}},)"
+        R"( {"jsonrpc":"2.0","method":"notifications/progress","params":{"progress":1}},)"
+        R"( {"jsonrpc":"2.0","id":"x","error":{"code":-32601,"message":"Method not found"}}])"
+    };
+    auto const messages = jsonrpc::scanMessage(text);
+
+    REQUIRE(messages.has_value());
+    REQUIRE(messages->size() == 3);
+    CHECK((*messages)[0].valid);
+    CHECK((*messages)[0].id == 7);
+    CHECK((*messages)[0].result == R"({"tools":[]})");
+    CHECK((*messages)[1].id.is_null());
+    CHECK((*messages)[1].method == "notifications/progress");
+    CHECK((*messages)[1].params == R"({"progress":1})");
+    CHECK((*messages)[2].id == "x");
+
+    auto const error = jsonrpc::parseRpcError((*messages)[2].error);
+    CHECK(error.code == -32601);
+    CHECK(error.message == "Method not found");
+}
+
+TEST_CASE("scanMessage rejects malformed messages", "[jsonrpc]")
+{
+    CHECK_FALSE(jsonrpc::scanMessage(R"({"jsonrpc":"2.0","id":1,"result":)").has_value());
+    CHECK_FALSE(jsonrpc::scanMessage(R"({"jsonrpc":"2.0"} trailing)").has_value());
+
+    auto const notJsonRpc = jsonrpc::scanMessage(R"({"id":1,"result":true})");
+    REQUIRE(notJsonRpc.has_value());
+    CHECK_FALSE(notJsonRpc->front().valid);
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/LlmBenchmark.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace mychat;
+
+TEST_CASE("llmBenchmarkVariants keeps the base configuration without a matrix", "[llm-bench]")
+{
+    auto base = LlmEngineConfig {};
+    base.modelPath = "model.gguf";
+    base.gpuLayers = 12;
+    base.threads = 6;
+    auto const variants = llmBenchmarkVariants(base, {});
+    REQUIRE(variants.size() == 1);
+    CHECK(variants[0].label == "threads=6 gpu-layers=12 kv=f16");
+    CHECK(variants[0].engine.modelPath == "model.gguf");
+    CHECK(variants[0].engine.threads == 6);
+}
+
+TEST_CASE("llmBenchmarkVariants combines every setting", "[llm-bench]")
+{
+    auto base = LlmEngineConfig {};
+    base.kvCacheTypeV = KvCacheType::Q8_0;
+    auto const matrix = LlmBenchmarkMatrix {
+        .threads = { 4, 8 },
+        .gpuLayers = { 0, 99 },
+        .kvCacheTypes = { KvCacheType::F16, KvCacheType::Q4_0 },
+    };
+    auto const variants = llmBenchmarkVariants(base, matrix);
+    REQUIRE(variants.size() == 8);
+    CHECK(variants.front().label == "threads=4 gpu-layers=0 kv=f16");
+    CHECK(variants.back().label == "threads=8 gpu-layers=99 kv=q4_0");
+    CHECK(variants.back().engine.kvCacheTypeK == KvCacheType::Q4_0);
+    CHECK(variants.back().engine.kvCacheTypeV == KvCacheType::Q4_0);
+
+    // Without KV types to compare, differing K and V types are kept and named.
+    auto const kept = llmBenchmarkVariants(base, { .threads = {}, .gpuLayers = {}, .kvCacheTypes = {} });
+    CHECK(kept.front().label == "threads=auto gpu-layers=auto kv=f16/q8_0");
+}
+
+TEST_CASE("LLM benchmark results are reported as a table and as JSON", "[llm-bench]")
+{
+    auto metrics = GenerateMetrics {};
+    metrics.promptTokens = 1100;
+    metrics.reusedTokens = 100;
+    metrics.generatedTokens = 64;
+    metrics.prefillMs = 500.0;
+    metrics.decodeMs = 2000.0;
+    metrics.timeToFirstTokenMs = 520.0;
+
+    auto runs = std::vector<LlmBenchmarkRun>(2);
+    runs[0].variant = "threads=8 gpu-layers=auto kv=f16";
+    runs[0].loadMs = 1234.0;
+    runs[0].peakResidentBytes = size_t { 512 } << 20;
+    runs[0].samples.push_back({ .scenario = "short-chat", .metrics = metrics });
+    runs[1].variant = "threads=8 gpu-layers=auto kv=q4_0";
+    runs[1].error = "Failed to create context";
+
+    CHECK(runs[0].samples[0].prefillTokensPerSecond() == 2000.0);
+
+    auto const table = formatLlmBenchmarkTable(runs);
+    CHECK(table.contains("loaded in 1234 ms, peak RSS 512 MiB"));
+    CHECK(table.contains("short-chat"));
+    CHECK(table.contains("2000.0"));
+    CHECK(table.contains("32.0"));
+    CHECK(table.contains("failed: Failed to create context"));
+
+    auto const json = llmBenchmarkJson(runs);
+    REQUIRE(json.size() == 2);
+    CHECK(json[0]["peakResidentBytes"] == 512 << 20);
+    CHECK(json[0]["samples"][0]["decodeTokensPerSecond"] == 32.0);
+    CHECK(json[0]["samples"][0]["prefillTokensPerSecond"] == 2000.0);
+    CHECK(json[1]["error"] == "Failed to create context");
+    CHECK(json[1]["samples"].empty());
+}
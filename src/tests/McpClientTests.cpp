@@ -1,41 +1,135 @@
 // SPDX-License-Identifier: Apache-2.0
+#include <mcp/JsonRpc.hpp>
 #include <mcp/McpClient.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <condition_variable>
+#include <format>
+#include <future>
+#include <mutex>
 #include <queue>
 
 using namespace mychat;
 
 /// @brief Mock transport for testing McpClient without real processes.
+///
+/// Behaves like a server connection: each queued response is delivered once a request has
+/// been sent, and receive() blocks until a message is available or the transport is closed.
 class MockTransport: public Transport
 {
   public:
-    std::queue<nlohmann::json> responses;
     std::vector<nlohmann::json> sentMessages;
+    std::vector<size_t> batchSizes;
 
     auto send(const nlohmann::json& message) -> VoidResult override
     {
+        auto const lock = std::lock_guard(_mutex);
         sentMessages.push_back(message);
+        for (auto i = jsonrpc::requestIds(message).size(); i > 0 && !_scripted.empty(); --i)
+        {
+            _inbox.push(std::move(_scripted.front()));
+            _scripted.pop();
+        }
+        _changed.notify_all();
         return {};
     }
 
+    auto sendBatch(std::span<const nlohmann::json> messages) -> VoidResult override
+    {
+        {
+            auto const lock = std::lock_guard(_mutex);
+            batchSizes.push_back(messages.size());
+        }
+        return Transport::sendBatch(messages);
+    }
+
     auto receive() -> Result<nlohmann::json> override
     {
-        if (responses.empty())
-            return makeError(ErrorCode::TransportError, "No more mock responses");
-        auto msg = responses.front();
-        responses.pop();
+        auto lock = std::unique_lock(_mutex);
+        _changed.wait(lock, [this] { return _closed || !_inbox.empty(); });
+        if (_inbox.empty())
+            return makeError(ErrorCode::TransportError, "Mock transport closed");
+        auto msg = std::move(_inbox.front());
+        _inbox.pop();
         return msg;
     }
 
-    void close() override {}
+    void close() override
+    {
+        auto const lock = std::lock_guard(_mutex);
+        _closed = true;
+        _changed.notify_all();
+    }
 
     auto isConnected() const -> bool override { return true; }
 
-    void queueResponse(nlohmann::json response) { responses.push(std::move(response)); }
+    /// @brief Queues a response that is delivered after the next request.
+    void queueResponse(nlohmann::json response)
+    {
+        auto const lock = std::lock_guard(_mutex);
+        _scripted.push(std::move(response));
+    }
+
+    /// @brief Delivers a message from the server right away.
+    void pushMessage(nlohmann::json message)
+    {
+        auto const lock = std::lock_guard(_mutex);
+        _inbox.push(std::move(message));
+        _changed.notify_all();
+    }
+
+    /// @brief Waits until @p count messages with the given method have been sent and returns them.
+    auto waitForSent(std::string_view method, size_t count) -> std::vector<nlohmann::json>
+    {
+        auto lock = std::unique_lock(_mutex);
+        auto matching = std::vector<nlohmann::json> {};
+        _changed.wait(lock, [&] {
+            matching.clear();
+            for (auto const& msg: sentMessages)
+                if (msg.value("method", "") == method)
+                    matching.push_back(msg);
+            return matching.size() >= count;
+        });
+        return matching;
+    }
+
+  private:
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::queue<nlohmann::json> _scripted;
+    std::queue<nlohmann::json> _inbox;
+    bool _closed = false;
 };
 
+namespace
+{
+
+auto initializeResponse() -> nlohmann::json
+{
+    return nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 1 },
+        { "result",
+          {
+              { "protocolVersion", "2024-11-05" },
+              { "serverInfo", { { "name", "test" }, { "version", "1.0" } } },
+              { "capabilities", { { "tools", nlohmann::json::object() } } },
+          } },
+    };
+}
+
+auto textResult(nlohmann::json id, std::string text) -> nlohmann::json
+{
+    return nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", std::move(id) },
+        { "result", { { "content", nlohmann::json::array({ { { "type", "text" }, { "text", text } } }) } } },
+    };
+}
+
+} // namespace
+
 TEST_CASE("McpClient initialize handshake", "[mcp]")
 {
     auto transport = std::make_unique<MockTransport>();
@@ -109,6 +203,49 @@ TEST_CASE("McpClient listTools", "[mcp]")
     REQUIRE(toolsResult->size() == 2);
     CHECK((*toolsResult)[0].name == "read_file");
     CHECK((*toolsResult)[1].name == "write_file");
+
+    // The initialized notification is written together with tools/list.
+    REQUIRE(mock->sentMessages.size() == 3);
+    CHECK(mock->sentMessages[1]["method"] == "notifications/initialized");
+    CHECK(mock->sentMessages[2]["method"] == "tools/list");
+    CHECK(mock->batchSizes == std::vector<size_t> { 1, 2 });
+}
+
+TEST_CASE("McpClient sends JSON-RPC batches when the server supports them", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+
+    auto initialize = initializeResponse();
+    initialize["result"]["protocolVersion"] = "2025-03-26";
+    mock->queueResponse(std::move(initialize));
+    mock->queueResponse(nlohmann::json::array({
+        nlohmann::json {
+            { "jsonrpc", "2.0" },
+            { "id", 2 },
+            { "result", { { "tools", nlohmann::json::array({ { { "name", "read_file" } } }) } } },
+        },
+    }));
+
+    auto client = McpClient(std::move(transport));
+    auto const capabilities = client.initialize();
+    REQUIRE(capabilities.has_value());
+    CHECK(capabilities->protocolVersion == "2025-03-26");
+    CHECK(capabilities->supportsBatching);
+
+    auto const tools = client.listTools();
+    REQUIRE(tools.has_value());
+    REQUIRE(tools->size() == 1);
+    CHECK((*tools)[0].name == "read_file");
+
+    // The initialized notification and tools/list share one batch message.
+    REQUIRE(mock->sentMessages.size() == 2);
+    CHECK(mock->sentMessages[0]["params"]["protocolVersion"] == "2025-03-26");
+    auto const& batch = mock->sentMessages[1];
+    REQUIRE(batch.is_array());
+    REQUIRE(batch.size() == 2);
+    CHECK(batch[0]["method"] == "notifications/initialized");
+    CHECK(batch[1]["method"] == "tools/list");
 }
 
 TEST_CASE("McpClient callTool", "[mcp]")
@@ -148,6 +285,58 @@ TEST_CASE("McpClient callTool", "[mcp]")
     CHECK(!result->isError);
 }
 
+TEST_CASE("McpClient callTool keeps binary content items as blobs", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 1 },
+        { "result", { { "capabilities", { { "tools", nlohmann::json::object() } } } } },
+    });
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 2 },
+        { "result",
+          {
+              { "content",
+                nlohmann::json::array({
+                    { { "type", "text" }, { "text", "Here you go" } },
+                    { { "type", "image" }, { "mimeType", "image/png" }, { "data", "iVBORw==" } },
+                    { { "type", "resource" },
+                      { "resource",
+                        { { "uri", "file:///notes.txt" },
+                          { "mimeType", "text/plain" },
+                          { "text", "notes" } } } },
+                    { { "type", "resource" },
+                      { "resource",
+                        { { "uri", "file:///a.bin" },
+                          { "mimeType", "application/octet-stream" },
+                          { "blob", "AAEC" } } } },
+                    { { "type", "image" }, { "mimeType", "image/png" }, { "data", "not base64!" } },
+                }) },
+          } },
+    });
+
+    auto client = McpClient(std::move(transport));
+    REQUIRE(client.initialize().has_value());
+
+    auto const result = client.callTool("render", nlohmann::json::object());
+    REQUIRE(result.has_value());
+    CHECK(result->content
+          == "Here you go\n[image/png content, 4 bytes]\nnotes\n"
+             "[resource file:///a.bin (application/octet-stream, 3 bytes)]\n[invalid image/png content]");
+
+    REQUIRE(result->blobs.size() == 2);
+    CHECK(result->blobs[0].isImage());
+    CHECK(result->blobs[0].mimeType == "image/png");
+    CHECK(*result->blobs[0].data == std::vector<std::uint8_t> { 0x89, 'P', 'N', 'G' });
+    CHECK(!result->blobs[1].isImage());
+    CHECK(result->blobs[1].uri == "file:///a.bin");
+    CHECK(*result->blobs[1].data == std::vector<std::uint8_t> { 0, 1, 2 });
+}
+
 TEST_CASE("McpClient rejects operations before initialization", "[mcp]")
 {
     auto transport = std::make_unique<MockTransport>();
@@ -161,3 +350,213 @@ TEST_CASE("McpClient rejects operations before initialization", "[mcp]")
     REQUIRE(!callResult.has_value());
     CHECK(callResult.error().code == ErrorCode::ProtocolError);
 }
+
+TEST_CASE("McpClient multiplexes concurrent requests", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(initializeResponse());
+
+    auto client = McpClient(std::move(transport));
+    REQUIRE(client.initialize().has_value());
+
+    auto const read = [&](std::string path) { return client.callTool("read", { { "path", path } }); };
+    auto first = std::async(std::launch::async, read, "a");
+    auto second = std::async(std::launch::async, read, "b");
+
+    // Both requests are in flight at once; answer them in reverse order.
+    auto const calls = mock->waitForSent("tools/call", 2);
+    for (auto it = calls.rbegin(); it != calls.rend(); ++it)
+        mock->pushMessage(textResult((*it)["id"], (*it)["params"]["arguments"]["path"].get<std::string>()));
+
+    auto const a = first.get();
+    auto const b = second.get();
+    REQUIRE(a.has_value());
+    REQUIRE(b.has_value());
+    CHECK(a->content == "a");
+    CHECK(b->content == "b");
+}
+
+TEST_CASE("McpClient routes notifications and answers pings", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(initializeResponse());
+
+    auto client = McpClient(std::move(transport));
+    auto received = std::promise<std::string>();
+    client.setNotificationHandler([&](std::string_view method, const nlohmann::json& params) {
+        received.set_value(std::format("{} {}", method, params.value("progress", 0)));
+    });
+    REQUIRE(client.initialize().has_value());
+
+    mock->pushMessage(jsonrpc::makeNotification("notifications/progress", { { "progress", 50 } }));
+    CHECK(received.get_future().get() == "notifications/progress 50");
+
+    mock->pushMessage(jsonrpc::makeRequest(99, "ping"));
+    auto const pong = mock->waitForSent("", 1);
+    REQUIRE(pong.size() == 1);
+    CHECK(pong[0]["id"] == 99);
+    CHECK(pong[0].contains("result"));
+}
+
+TEST_CASE("McpClient cancels a pending tool call", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(initializeResponse());
+
+    auto client = McpClient(std::move(transport));
+    REQUIRE(client.initialize().has_value());
+
+    auto stopSource = std::stop_source();
+    auto call = std::async(std::launch::async, [&] {
+        return client.callTool("slow", nlohmann::json::object(), stopSource.get_token());
+    });
+    auto const sent = mock->waitForSent("tools/call", 1);
+    stopSource.request_stop();
+
+    auto const result = call.get();
+    REQUIRE_FALSE(result.has_value());
+    auto const cancelled = mock->waitForSent("notifications/cancelled", 1);
+    CHECK(cancelled[0]["params"]["requestId"] == sent[0]["id"]);
+
+    // A late response to the cancelled request is ignored.
+    mock->pushMessage(textResult(sent[0]["id"], "late"));
+}
+
+TEST_CASE("McpClient times out an unanswered request", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(initializeResponse());
+
+    auto client = McpClient(std::move(transport));
+    REQUIRE(client.initialize().has_value());
+    client.setRequestTimeout(std::chrono::milliseconds(50));
+
+    auto const result = client.callTool("hung", nlohmann::json::object());
+    REQUIRE_FALSE(result.has_value());
+    CHECK(result.error().code == ErrorCode::TimeoutError);
+
+    auto const sent = mock->waitForSent("tools/call", 1);
+    auto const cancelled = mock->waitForSent("notifications/cancelled", 1);
+    CHECK(cancelled[0]["params"]["requestId"] == sent[0]["id"]);
+}
+
+TEST_CASE("McpClient lists, subscribes to and reads resources", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 1 },
+        { "result", { { "capabilities", { { "resources", { { "subscribe", true } } } } } } },
+    });
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 2 },
+        { "result",
+          { { "resources",
+              nlohmann::json::array({
+                  { { "uri", "file:///notes.md" }, { "name", "notes" }, { "mimeType", "text/markdown" } },
+                  { { "name", "no uri" } },
+              }) } } },
+    });
+    mock->queueResponse(
+        nlohmann::json { { "jsonrpc", "2.0" }, { "id", 3 }, { "result", nlohmann::json::object() } });
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 4 },
+        { "result",
+          { { "contents",
+              nlohmann::json::array({
+                  { { "uri", "file:///notes.md" }, { "mimeType", "text/markdown" }, { "text", "# Notes" } },
+                  { { "uri", "file:///logo.png" }, { "mimeType", "image/png" }, { "blob", "iVBO" } },
+              }) } } },
+    });
+
+    auto client = McpClient(std::move(transport));
+    auto const capabilities = client.initialize();
+    REQUIRE(capabilities.has_value());
+    CHECK(capabilities->hasResources);
+    CHECK(capabilities->supportsResourceSubscriptions);
+
+    auto const resources = client.listResources();
+    REQUIRE(resources.has_value());
+    REQUIRE(resources->size() == 1);
+    CHECK((*resources)[0].uri == "file:///notes.md");
+    CHECK((*resources)[0].mimeType == "text/markdown");
+
+    REQUIRE(client.subscribeResource("file:///notes.md").has_value());
+    CHECK(mock->waitForSent("resources/subscribe", 1)[0]["params"]["uri"] == "file:///notes.md");
+
+    auto const contents = client.readResource("file:///notes.md");
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->size() == 2);
+    CHECK((*contents)[0].text == "# Notes");
+    CHECK((*contents)[0].blob == nullptr);
+    REQUIRE((*contents)[1].blob != nullptr);
+    CHECK((*contents)[1].blob->size() == 3);
+    CHECK((*contents)[1].mimeType == "image/png");
+}
+
+TEST_CASE("McpClient lists and fills in prompts", "[mcp]")
+{
+    auto transport = std::make_unique<MockTransport>();
+    auto* mock = transport.get();
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 1 },
+        { "result", { { "capabilities", { { "prompts", nlohmann::json::object() } } } } },
+    });
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 2 },
+        { "result",
+          { { "prompts",
+              nlohmann::json::array({ {
+                  { "name", "review" },
+                  { "description", "Reviews code" },
+                  { "arguments", nlohmann::json::array({ { { "name", "code" }, { "required", true } } }) },
+              } }) } } },
+    });
+    mock->queueResponse(nlohmann::json {
+        { "jsonrpc", "2.0" },
+        { "id", 3 },
+        { "result",
+          { { "description", "Code review" },
+            { "messages",
+              nlohmann::json::array({
+                  { { "role", "user" }, { "content", { { "type", "text" }, { "text", "Review: x = 1" } } } },
+                  { { "role", "assistant" },
+                    { "content",
+                      { { "type", "resource" },
+                        { "resource", { { "uri", "file:///style.md" }, { "text", "Use spaces." } } } } } },
+              }) } } },
+    });
+
+    auto client = McpClient(std::move(transport));
+    auto const capabilities = client.initialize();
+    REQUIRE(capabilities.has_value());
+    CHECK(capabilities->hasPrompts);
+    CHECK_FALSE(capabilities->supportsResourceSubscriptions);
+
+    auto const prompts = client.listPrompts();
+    REQUIRE(prompts.has_value());
+    REQUIRE(prompts->size() == 1);
+    CHECK((*prompts)[0].name == "review");
+    REQUIRE((*prompts)[0].arguments.size() == 1);
+    CHECK((*prompts)[0].arguments[0].name == "code");
+    CHECK((*prompts)[0].arguments[0].required);
+
+    auto const prompt = client.getPrompt("review", { { "code", "x = 1" } });
+    REQUIRE(prompt.has_value());
+    CHECK(mock->waitForSent("prompts/get", 1)[0]["params"]["arguments"]["code"] == "x = 1");
+    CHECK(prompt->description == "Code review");
+    REQUIRE(prompt->messages.size() == 2);
+    CHECK(prompt->messages[0].role == Role::User);
+    CHECK(prompt->messages[0].content == "Review: x = 1");
+    CHECK(prompt->messages[1].role == Role::Assistant);
+    CHECK(prompt->messages[1].content == "Use spaces.");
+}
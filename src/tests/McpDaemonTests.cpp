@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mcp/McpClient.hpp>
+#include <mcp/McpDaemon.hpp>
+#include <mcp/ServerManager.hpp>
+#include <mcp/UnixSocketTransport.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <string>
+
+using namespace mychat;
+
+#ifndef _WIN32
+namespace
+{
+
+/// @brief A shell-scripted MCP server that answers with the request IDs it receives.
+///
+/// Its reported version counts the `initialize` requests it has seen.
+constexpr auto FakeServerScript =
+    R"(n=0; while read line; do id=$(echo "$line" | sed -n 's/^{"id":\([0-9]*\),.*/\1/p'); )"
+    R"(case "$line" in )"
+    R"(*'"initialize"'*) n=$((n+1)); echo '{"jsonrpc":"2.0","id":'$id',"result":{"capabilities":)"
+    R"({"tools":{}},"serverInfo":{"name":"fake","version":"'$n'"}}}';; )"
+    R"(*'"tools/list"'*) echo '{"jsonrpc":"2.0","id":'$id',"result":{"tools":[{"name":"alpha"}]}}';; )"
+    R"(*'"tools/call"'*) echo '{"jsonrpc":"2.0","id":'$id',)"
+    R"("result":{"content":[{"type":"text","text":"ok"}]}}';; )"
+    R"(esac; done)";
+
+auto testSocketPath(std::string_view name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() / std::format("mychat_test_{}.sock", name)).string();
+}
+
+auto attachClient(std::string const& socketPath) -> std::unique_ptr<McpClient>
+{
+    auto transport = std::make_unique<UnixSocketTransport>();
+    auto const started = transport->start(UnixSocketTransportConfig {
+        .socketPath = socketPath,
+        .command = "sh",
+        .args = { "-c", FakeServerScript },
+        .env = {},
+    });
+    if (!started)
+        return nullptr;
+    return std::make_unique<McpClient>(std::move(transport));
+}
+
+} // namespace
+
+TEST_CASE("UnixSocketTransport fails without a daemon", "[mcpd]")
+{
+    auto transport = UnixSocketTransport();
+    auto const result = transport.start(UnixSocketTransportConfig {
+        .socketPath = testSocketPath("absent"),
+        .command = "sh",
+        .args = {},
+        .env = {},
+    });
+    REQUIRE(!result.has_value());
+    CHECK(result.error().code == ErrorCode::TransportError);
+    CHECK(!transport.isConnected());
+}
+
+TEST_CASE("McpDaemon refuses a socket already served by another daemon", "[mcpd]")
+{
+    auto const socketPath = testSocketPath("busy");
+    auto first = McpDaemon();
+    REQUIRE(first.start(socketPath).has_value());
+
+    auto second = McpDaemon();
+    CHECK(!second.start(socketPath).has_value());
+    CHECK(std::filesystem::exists(socketPath));
+}
+
+TEST_CASE("McpDaemon shares one server between clients", "[mcpd]")
+{
+    auto const socketPath = testSocketPath("shared");
+    auto daemon = McpDaemon();
+    REQUIRE(daemon.start(socketPath).has_value());
+
+    auto first = attachClient(socketPath);
+    auto second = attachClient(socketPath);
+    REQUIRE(first);
+    REQUIRE(second);
+
+    auto const firstCapabilities = first->initialize();
+    REQUIRE(firstCapabilities.has_value());
+    auto const secondCapabilities = second->initialize();
+    REQUIRE(secondCapabilities.has_value());
+    CHECK(firstCapabilities->serverVersion == "1");
+    CHECK(secondCapabilities->serverVersion == "1"); // Answered from the cached result.
+    CHECK(daemon.serverCount() == 1);
+
+    // Both clients use ID 1 for their first call; the daemon keeps the responses apart.
+    auto const firstResult = first->callTool("alpha", nlohmann::json::object());
+    auto const secondResult = second->callTool("alpha", nlohmann::json::object());
+    REQUIRE(firstResult.has_value());
+    REQUIRE(secondResult.has_value());
+    CHECK(firstResult->content == "ok");
+    CHECK(secondResult->content == "ok");
+}
+
+TEST_CASE("McpDaemon keeps servers running when clients leave", "[mcpd]")
+{
+    auto const socketPath = testSocketPath("warm");
+    auto daemon = McpDaemon();
+    REQUIRE(daemon.start(socketPath).has_value());
+
+    {
+        auto client = attachClient(socketPath);
+        REQUIRE(client);
+        REQUIRE(client->initialize().has_value());
+    }
+
+    auto client = attachClient(socketPath);
+    REQUIRE(client);
+    auto const capabilities = client->initialize();
+    REQUIRE(capabilities.has_value());
+    CHECK(capabilities->serverVersion == "1");
+    CHECK(daemon.serverCount() == 1);
+
+    auto const tools = client->listTools();
+    REQUIRE(tools.has_value());
+    REQUIRE(tools->size() == 1);
+    CHECK((*tools)[0].name == "alpha");
+
+    daemon.stop();
+    CHECK(!std::filesystem::exists(socketPath));
+}
+
+TEST_CASE("ServerManager runs servers through the daemon when it is reachable", "[mcpd]")
+{
+    auto const config = McpServerConfig {
+        .name = "fake",
+        .command = "sh",
+        .args = { "-c", FakeServerScript },
+        .env = {},
+        .cachedTools = {},
+    };
+
+    auto const socketPath = testSocketPath("manager");
+    auto daemon = McpDaemon();
+    REQUIRE(daemon.start(socketPath).has_value());
+
+    auto manager = ServerManager();
+    manager.setDaemonSocket(socketPath);
+    REQUIRE(manager.addServer(config).has_value());
+    CHECK(daemon.serverCount() == 1);
+    auto const result = manager.callTool("alpha", nlohmann::json::object());
+    REQUIRE(result.has_value());
+    CHECK(result->content == "ok");
+
+    // Without a daemon, the server is spawned directly.
+    auto fallback = ServerManager();
+    fallback.setDaemonSocket(testSocketPath("absent"));
+    REQUIRE(fallback.addServer(config).has_value());
+    CHECK(fallback.runningServerCount() == 1);
+    CHECK(daemon.serverCount() == 1);
+}
+#endif
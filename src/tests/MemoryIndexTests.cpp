@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <agent/MemoryIndex.hpp>
+#include <core/Hash.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// Embeds text as a normalized bag of topic keywords, counting the calls.
+struct KeywordEmbedder
+{
+    int calls = 0;
+
+    auto operator()(std::string_view text) -> Result<std::vector<float>>
+    {
+        ++calls;
+        constexpr auto Topics = std::array<std::string_view, 4> { "weather", "build", "mail", "music" };
+        auto embedding = std::vector<float>(Topics.size());
+        auto norm = 0.0f;
+        for (auto i = size_t { 0 }; i < Topics.size(); ++i)
+        {
+            embedding[i] = text.find(Topics[i]) != std::string_view::npos ? 1.0f : 0.0f;
+            norm += embedding[i];
+        }
+        for (auto& value: embedding)
+            value = norm > 0.0f ? value / std::sqrt(norm) : 0.0f;
+        return embedding;
+    }
+};
+
+/// Embeds text as a pseudo-random unit vector derived from its hash.
+auto hashEmbedding(std::string_view text) -> Result<std::vector<float>>
+{
+    auto state = fnv1a64(text);
+    auto embedding = std::vector<float>(48);
+    auto norm = 0.0f;
+    for (auto& value: embedding)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        value = static_cast<float>(static_cast<std::int64_t>(state >> 11) % 2001 - 1000) / 1000.0f;
+        norm += value * value;
+    }
+    for (auto& value: embedding)
+        value /= std::sqrt(norm);
+    return embedding;
+}
+
+auto message(Role role, std::string content) -> ChatMessage
+{
+    return ChatMessage {
+        .role = role,
+        .content = std::move(content),
+        .toolCalls = {},
+        .toolCallId = {},
+    };
+}
+
+auto conversation() -> std::vector<ChatMessage>
+{
+    return {
+        message(Role::System, "You are helpful."),
+        message(Role::User, "Why does the build fail?"),
+        message(Role::Assistant, "The build lacks the fmt library."),
+        message(Role::Tool, "It will rain, says the weather service."),
+    };
+}
+
+} // namespace
+
+TEST_CASE("memoryChunks cuts messages into labeled pieces without notes", "[agent][memory]")
+{
+    auto const notes = std::array {
+        MemorySnippet { .source = "old", .text = "User: an earlier question", .score = 0.9f },
+    };
+    auto const longOutput = std::string(2000, 'x') + " tail";
+    auto const messages = std::vector {
+        message(Role::System, "system prompt"),
+        message(Role::User, withMemoryNotes(notes, "Hello there")),
+        message(Role::Tool, longOutput),
+    };
+
+    auto const chunks = memoryChunks(messages);
+    REQUIRE(chunks.size() >= 3);
+    CHECK(chunks[0] == "User: Hello there");
+    for (auto const& chunk: chunks)
+        CHECK(chunk.size() <= MemoryIndex::MaxChunkBytes);
+    CHECK(chunks[1].starts_with("Tool result: xxx"));
+    CHECK(chunks.back().ends_with("tail"));
+    CHECK(withoutMemoryNotes(messages[1].content) == "Hello there");
+    CHECK(withMemoryNotes({}, "plain") == "plain");
+}
+
+TEST_CASE("MemoryIndex finds similar chunks and skips those indexed before", "[agent][memory]")
+{
+    auto embedder = KeywordEmbedder {};
+    auto index = MemoryIndex([&](std::string_view text) { return embedder(text); });
+
+    auto added = index.add("first", conversation());
+    REQUIRE(added);
+    CHECK(*added == 3);
+    CHECK(index.contains("first"));
+    CHECK_FALSE(index.contains("second"));
+
+    // The same conversation, having gone on, only embeds its new message.
+    auto longer = conversation();
+    longer.push_back(message(Role::User, "Any new mail?"));
+    added = index.add("first", longer);
+    REQUIRE(added);
+    CHECK(*added == 1);
+    CHECK(embedder.calls == 4);
+
+    auto found = index.search("the weather tomorrow", 2);
+    REQUIRE(found);
+    REQUIRE(found->size() == 2);
+    CHECK((*found)[0].text == "Tool result: It will rain, says the weather service.");
+    CHECK((*found)[0].source == "first");
+    CHECK((*found)[0].score > 0.95f);
+    CHECK((*found)[1].score < 0.05f);
+
+    auto excluded = index.search("the weather tomorrow", 2, "first");
+    REQUIRE(excluded);
+    CHECK(excluded->empty());
+}
+
+TEST_CASE("MemoryIndex survives a save and open round trip", "[agent][memory]")
+{
+    auto const path = std::filesystem::temp_directory_path() / "mychat_test_memory.index";
+    auto embedder = KeywordEmbedder {};
+    {
+        auto index = MemoryIndex([&](std::string_view text) { return embedder(text); });
+        REQUIRE(index.add("first", conversation()));
+        REQUIRE(index.add("second", std::vector { message(Role::User, "Play some music") }));
+        CHECK(index.modified());
+        REQUIRE(index.save(path));
+        CHECK_FALSE(index.modified());
+        CHECK(index.listCount() >= 1);
+    }
+
+    auto opened = MemoryIndex([&](std::string_view text) { return embedder(text); });
+    REQUIRE(opened.open(path));
+    CHECK(opened.size() == 4);
+    CHECK(opened.contains("second"));
+
+    auto const calls = embedder.calls;
+    auto added = opened.add("second", std::vector { message(Role::User, "Play some music") });
+    REQUIRE(added);
+    CHECK(*added == 0);
+    CHECK(embedder.calls == calls);
+
+    auto found = opened.search("music please", 1);
+    REQUIRE(found);
+    REQUIRE(found->size() == 1);
+    CHECK(found->front().text == "User: Play some music");
+    CHECK(found->front().source == "second");
+
+    // A file that is not an index leaves the open one as it is.
+    auto const garbagePath = std::filesystem::path(path).concat(".garbage");
+    {
+        auto out = std::ofstream(garbagePath, std::ios::binary | std::ios::trunc);
+        out << "not an index";
+    }
+    CHECK_FALSE(opened.open(garbagePath));
+    CHECK(opened.size() == 4);
+
+    // A source record whose text offset wraps around the text section is rejected.
+    auto bytes = std::string {};
+    {
+        auto in = std::ifstream(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    auto const sourceRecords = [](std::uint32_t first, std::uint32_t second) {
+        auto const values = std::array<std::uint32_t, 8> { 0, 0, first, 0, first, 0, second, 0 };
+        return std::string(reinterpret_cast<char const*>(values.data()), sizeof(values));
+    };
+    auto at = bytes.find(sourceRecords(5, 6));
+    if (at == std::string::npos)
+        at = bytes.find(sourceRecords(6, 5));
+    REQUIRE(at != std::string::npos);
+    auto const wrapping = std::numeric_limits<std::uint64_t>::max() - 1;
+    std::memcpy(bytes.data() + at, &wrapping, sizeof(wrapping));
+    {
+        auto out = std::ofstream(garbagePath, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    CHECK_FALSE(opened.open(garbagePath));
+    CHECK(opened.size() == 4);
+
+    std::filesystem::remove(garbagePath);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("MemoryIndex finds each chunk among thousands in its clustered lists", "[agent][memory]")
+{
+    auto const path = std::filesystem::temp_directory_path() / "mychat_test_memory_large.index";
+    auto index = MemoryIndex(hashEmbedding);
+    auto messages = std::vector<ChatMessage> {};
+    for (auto i = 0; i < 3000; ++i)
+        messages.push_back(message(Role::User, std::format("note {}", i)));
+    REQUIRE(index.add("bulk", messages));
+    REQUIRE(index.save(path));
+    auto const lists = index.listCount();
+    CHECK(lists == 54);
+
+    for (auto const i: { 0, 1234, 2999 })
+    {
+        auto const text = std::format("User: note {}", i);
+        auto found = index.search(std::span<const float>(*hashEmbedding(text)), 3);
+        REQUIRE(found);
+        REQUIRE(found->size() == 3);
+        CHECK(found->front().text == text);
+        CHECK(found->front().score > 0.98f);
+        CHECK((*found)[1].score < found->front().score);
+    }
+
+    // Chunks added later join the existing lists, and are found before and after saving.
+    REQUIRE(index.add("later", std::vector { message(Role::User, "a late note") }));
+    auto const late = *hashEmbedding("User: a late note");
+    auto found = index.search(std::span<const float>(late), 1);
+    REQUIRE(found);
+    CHECK(found->front().source == "later");
+    REQUIRE(index.save(path));
+    CHECK(index.listCount() == lists);
+    found = index.search(std::span<const float>(late), 1);
+    REQUIRE(found);
+    CHECK(found->front().source == "later");
+
+    auto const wrongSize = std::vector<float>(3, 0.5f);
+    CHECK_FALSE(index.search(std::span<const float>(wrongSize), 1));
+    std::filesystem::remove(path);
+}
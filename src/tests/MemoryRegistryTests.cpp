@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/MemoryRegistry.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mychat;
+
+TEST_CASE("MemoryRegistry: accounts add up and close when destroyed", "[core][memory]")
+{
+    auto registry = MemoryRegistry {};
+    auto weights = registry.open("Weights", MemoryCategory::ModelWeights);
+    weights.set(4000);
+    {
+        auto cache = registry.open("Cache", MemoryCategory::Caches, [](std::size_t) { return 0; });
+        cache.set(6000);
+        CHECK(registry.totalBytes() == 10000);
+
+        auto const usage = registry.usage();
+        REQUIRE(usage.size() == 2);
+        CHECK(usage[0].name == "Cache");
+        CHECK(usage[0].reclaimable);
+        CHECK(usage[1].name == "Weights");
+        CHECK(usage[1].category == MemoryCategory::ModelWeights);
+        CHECK_FALSE(usage[1].reclaimable);
+    }
+    CHECK(registry.totalBytes() == 4000);
+
+    auto moved = std::move(weights);
+    CHECK(moved.bytes() == 4000);
+    CHECK(registry.usage().size() == 1);
+    moved.close();
+    CHECK(registry.totalBytes() == 0);
+    moved.set(1); // Ignored once closed.
+    CHECK(moved.bytes() == 0);
+}
+
+TEST_CASE("MemoryRegistry: shrinks caches before history until within budget", "[core][memory]")
+{
+    auto registry = MemoryRegistry {};
+    auto order = std::vector<std::string> {};
+
+    auto weights = registry.open("Weights", MemoryCategory::ModelWeights);
+    weights.set(5000);
+
+    auto history = MemoryAccount {};
+    history = registry.open("History", MemoryCategory::History, [&](std::size_t bytes) {
+        order.emplace_back("History");
+        auto const freed = std::min(bytes, history.bytes());
+        history.set(history.bytes() - freed);
+        return freed;
+    });
+    history.set(4000);
+
+    auto small = MemoryAccount {};
+    small = registry.open("Small", MemoryCategory::Caches, [&](std::size_t) {
+        order.emplace_back("Small");
+        small.set(0);
+        return std::size_t { 1000 };
+    });
+    small.set(1000);
+
+    auto large = MemoryAccount {};
+    large = registry.open("Large", MemoryCategory::Caches, [&](std::size_t) {
+        order.emplace_back("Large");
+        large.set(0);
+        return std::size_t { 2000 };
+    });
+    large.set(2000);
+
+    CHECK(registry.enforceBudget() == 0); // No budget set.
+
+    registry.setBudget(20000);
+    CHECK(registry.enforceBudget() == 0);
+    CHECK(order.empty());
+
+    registry.setBudget(7000);
+    CHECK(registry.enforceBudget() == 5000);
+    CHECK(order == std::vector<std::string> { "Large", "Small", "History" });
+    CHECK(history.bytes() == 2000);
+    CHECK(registry.totalBytes() == 7000);
+}
+
+TEST_CASE("MemoryRegistry: formats sizes", "[core][memory]")
+{
+    CHECK(formatMemorySize(512) == "512 B");
+    CHECK(formatMemorySize(64'000) == "64 KB");
+    CHECK(formatMemorySize(2'500'000) == "2.5 MB");
+    CHECK(formatMemorySize(4'200'000'000) == "4.2 GB");
+    CHECK(memoryCategoryName(MemoryCategory::KvCache) == "KV cache");
+}
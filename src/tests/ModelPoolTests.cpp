@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/ModelPool.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto fakeModelPath(std::string_view name) -> std::filesystem::path
+{
+    return std::filesystem::temp_directory_path() / std::format("mychat_test_pool_{}.gguf", name);
+}
+
+auto modelConfig(std::string path) -> LlmEngineConfig
+{
+    auto config = LlmEngineConfig {};
+    config.modelPath = std::move(path);
+    return config;
+}
+
+/// @brief Writes a fake model file of @p bytes bytes and returns its configuration.
+auto fakeModel(std::string_view name, std::size_t bytes) -> LlmEngineConfig
+{
+    auto const path = fakeModelPath(name);
+    auto file = std::ofstream(path, std::ios::binary);
+    file << std::string(bytes, '\0');
+    return modelConfig(path.string());
+}
+
+} // namespace
+
+TEST_CASE("ModelPool: keeps models resident and unloads the least recently used", "[llm][pool]")
+{
+    auto loads = std::vector<std::string> {};
+    auto pool = ModelPool(250, [&](LlmEngineConfig const& config) -> Result<std::unique_ptr<LlmEngine>> {
+        loads.push_back(std::filesystem::path(config.modelPath).stem().string());
+        return std::make_unique<LlmEngine>();
+    });
+    pool.add("small", fakeModel("small", 50));
+    pool.add("large", fakeModel("large", 150));
+    pool.add("other", fakeModel("other", 100));
+    CHECK(pool.names() == std::vector<std::string> { "small", "large", "other" });
+    CHECK(pool.state("small") == ModelState::Unloaded);
+
+    auto small = pool.acquire("small");
+    REQUIRE(small.has_value());
+    auto large = pool.acquire("large");
+    REQUIRE(large.has_value());
+    CHECK(*small != *large);
+    CHECK(pool.residentBytes() == 200);
+
+    // Switching back and forth reuses the resident engines.
+    pool.release("small");
+    auto again = pool.acquire("small");
+    REQUIRE(again.has_value());
+    CHECK(*again == *small);
+    CHECK(loads.size() == 2);
+
+    // "small" is the least recently used one that is not acquired, so it makes room.
+    pool.release("small");
+    auto other = pool.acquire("other");
+    REQUIRE(other.has_value());
+    CHECK(pool.state("small") == ModelState::Unloaded);
+    CHECK(pool.state("large") == ModelState::Resident);
+    CHECK(pool.residentBytes() == 250);
+
+    CHECK_FALSE(pool.acquire("missing").has_value());
+    for (auto const* name: { "small", "large", "other" })
+        std::filesystem::remove(fakeModelPath(name));
+}
+
+TEST_CASE("ModelPool: loads in the background and reports failures", "[llm][pool]")
+{
+    auto loaded = std::atomic<int> { 0 };
+    auto pool = ModelPool(0, [](LlmEngineConfig const& config) -> Result<std::unique_ptr<LlmEngine>> {
+        if (config.modelPath == "broken.gguf")
+            return makeError(ErrorCode::ModelLoadError, "broken");
+        return std::make_unique<LlmEngine>();
+    });
+    pool.setLoadedCallback([&](std::string_view, VoidResult const&) { ++loaded; });
+    pool.add("fine", modelConfig("fine.gguf"));
+    pool.add("broken", modelConfig("broken.gguf"));
+
+    REQUIRE(pool.load("fine"));
+    CHECK_FALSE(pool.load("missing"));
+    auto fine = pool.acquire("fine");
+    REQUIRE(fine.has_value());
+    CHECK(pool.state("fine") == ModelState::Resident);
+
+    auto broken = pool.acquire("broken");
+    REQUIRE_FALSE(broken.has_value());
+    CHECK(broken.error().message == "broken");
+    CHECK(pool.state("broken") == ModelState::Failed);
+
+    // The callback runs on the loading thread once waiters may already have woken.
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (loaded < 2 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    CHECK(loaded == 2);
+}
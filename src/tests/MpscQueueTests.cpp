@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/MpscQueue.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+TEST_CASE("MpscQueue: preserves FIFO order and reports full/empty", "[core][mpsc]")
+{
+    auto queue = MpscQueue<std::string>(3);
+    CHECK(queue.capacity() == 4);
+    CHECK(queue.tryPush("a"));
+    CHECK(queue.tryPush("b"));
+    CHECK(queue.tryPush("c"));
+    CHECK(queue.tryPush("d"));
+    CHECK_FALSE(queue.tryPush("e"));
+
+    CHECK(queue.tryPop() == "a");
+    CHECK(queue.tryPush("e"));
+    CHECK(queue.tryPop() == "b");
+    CHECK(queue.tryPop() == "c");
+    CHECK(queue.tryPop() == "d");
+    CHECK(queue.tryPop() == "e");
+    CHECK_FALSE(queue.tryPop().has_value());
+}
+
+TEST_CASE("MpscQueue: slots are reused in place", "[core][mpsc]")
+{
+    auto queue = MpscQueue<std::string>(2);
+    for (auto lap = 0; lap < 3; ++lap)
+    {
+        CHECK(queue.tryPushWith([&](std::string& slot) { slot.assign(std::string(100, 'x')); }));
+        auto capacity = std::size_t { 0 };
+        CHECK(queue.tryPopWith([&](std::string& slot) {
+            CHECK(slot.size() == 100);
+            capacity = slot.capacity();
+        }));
+        CHECK(capacity >= 100);
+        CHECK(queue.tryPushWith([](std::string& slot) { slot.assign("short"); }));
+        CHECK(queue.tryPopWith([](std::string& slot) { CHECK(slot == "short"); }));
+    }
+    auto visited = false;
+    CHECK_FALSE(queue.tryPopWith([&](std::string&) { visited = true; }));
+    CHECK_FALSE(visited);
+}
+
+TEST_CASE("MpscQueue: transfers all elements from several threads", "[core][mpsc]")
+{
+    constexpr auto ProducerCount = 4;
+    constexpr auto Count = 50'000;
+    auto queue = MpscQueue<int>(64);
+
+    auto producers = std::vector<std::jthread> {};
+    for (auto p = 0; p < ProducerCount; ++p)
+    {
+        producers.emplace_back([&queue, p] {
+            for (auto i = 0; i < Count; ++i)
+            {
+                while (!queue.tryPush(int { p * Count + i }))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // Each producer's elements arrive in the order it pushed them.
+    auto next = std::vector<int>(ProducerCount, 0);
+    for (auto received = 0; received < ProducerCount * Count;)
+    {
+        if (auto value = queue.tryPop())
+        {
+            auto const producer = *value / Count;
+            REQUIRE(*value % Count == next[static_cast<std::size_t>(producer)]);
+            ++next[static_cast<std::size_t>(producer)];
+            ++received;
+        }
+    }
+    CHECK_FALSE(queue.tryPop().has_value());
+}
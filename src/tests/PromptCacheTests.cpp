@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/PromptCache.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <format>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief chatml-like renderer that is prefix-stable.
+auto renderChatml(std::span<const ChatMessage> messages, bool addAssistant) -> Result<std::string>
+{
+    auto out = std::string {};
+    for (const auto& msg: messages)
+        out += std::format("<|{}|>{}<|end|>", roleToString(msg.role), msg.content);
+    if (addAssistant)
+        out += "<|assistant|>";
+    return out;
+}
+
+/// @brief Tokenizer that maps every byte to one token, with an optional BOS token (-1).
+auto tokenizeBytes(std::string_view text, bool addSpecial) -> Result<std::vector<TokenId>>
+{
+    auto tokens = std::vector<TokenId> {};
+    if (addSpecial)
+        tokens.push_back(-1);
+    for (auto const c: text)
+        tokens.push_back(static_cast<unsigned char>(c));
+    return tokens;
+}
+
+auto message(Role role, std::string content) -> ChatMessage
+{
+    auto msg = ChatMessage {};
+    msg.role = role;
+    msg.content = std::move(content);
+    return msg;
+}
+
+auto toVector(std::span<const TokenId> tokens) -> std::vector<TokenId>
+{
+    return { tokens.begin(), tokens.end() };
+}
+
+} // namespace
+
+TEST_CASE("PromptCache: matches full render and tokenization", "[llm][promptcache]")
+{
+    auto cache = PromptCache(renderChatml, tokenizeBytes);
+    auto messages = std::vector<ChatMessage> {
+        message(Role::System, "sys"),
+        message(Role::User, "hello"),
+    };
+
+    auto const built = cache.build(messages);
+    REQUIRE(built.has_value());
+    CHECK(toVector(*built) == *tokenizeBytes(*renderChatml(messages, true), true));
+}
+
+TEST_CASE("PromptCache: only new messages are tokenized", "[llm][promptcache]")
+{
+    auto tokenizeCalls = 0;
+    auto cache = PromptCache(renderChatml, [&](std::string_view text, bool addSpecial) {
+        ++tokenizeCalls;
+        return tokenizeBytes(text, addSpecial);
+    });
+
+    auto messages = std::vector<ChatMessage> {
+        message(Role::System, "sys"),
+        message(Role::User, "hello"),
+    };
+    REQUIRE(cache.build(messages).has_value());
+    CHECK(cache.cachedMessageCount() == 2);
+    auto const callsAfterFirst = tokenizeCalls;
+
+    messages.push_back(message(Role::Assistant, "hi"));
+    messages.push_back(message(Role::User, "again"));
+    auto const built = cache.build(messages);
+    REQUIRE(built.has_value());
+    CHECK(tokenizeCalls - callsAfterFirst == 2);
+    CHECK(cache.hits() == 2);
+    CHECK(cache.misses() == 4);
+    CHECK(toVector(*built) == *tokenizeBytes(*renderChatml(messages, true), true));
+}
+
+TEST_CASE("PromptCache: changed message invalidates the tail", "[llm][promptcache]")
+{
+    auto cache = PromptCache(renderChatml, tokenizeBytes);
+    auto messages = std::vector<ChatMessage> {
+        message(Role::System, "sys"),
+        message(Role::User, "hello"),
+        message(Role::Assistant, "hi"),
+    };
+    REQUIRE(cache.build(messages).has_value());
+
+    messages[1].content = "changed";
+    auto const built = cache.build(messages);
+    REQUIRE(built.has_value());
+    CHECK(cache.hits() == 1);
+    CHECK(toVector(*built) == *tokenizeBytes(*renderChatml(messages, true), true));
+}
+
+TEST_CASE("PromptCache: falls back for templates that are not prefix-stable", "[llm][promptcache]")
+{
+    // Renders only the most recent message in full; older ones are abbreviated.
+    auto const render = [](std::span<const ChatMessage> messages, bool addAssistant) -> Result<std::string> {
+        auto out = std::string {};
+        for (auto i = size_t { 0 }; i < messages.size(); ++i)
+            out += i + 1 == messages.size() ? messages[i].content : std::string("...");
+        if (addAssistant)
+            out += "|a|";
+        return out;
+    };
+
+    auto cache = PromptCache(render, tokenizeBytes);
+    auto messages = std::vector<ChatMessage> {
+        message(Role::User, "one"),
+        message(Role::User, "two"),
+    };
+    auto const built = cache.build(messages);
+    REQUIRE(built.has_value());
+    CHECK(toVector(*built) == *tokenizeBytes(*render(messages, true), true));
+}
+
+TEST_CASE("PromptCache: reports the token count of message prefixes", "[llm][promptcache]")
+{
+    auto cache = PromptCache(renderChatml, tokenizeBytes);
+    auto messages = std::vector<ChatMessage> {
+        message(Role::System, "sys"),
+        message(Role::User, "hello"),
+    };
+    REQUIRE(cache.build(messages).has_value());
+
+    auto const systemTokens = tokenizeBytes(*renderChatml(std::span(messages).first(1), false), true)->size();
+    CHECK(cache.prefixTokenCount(0) == 0);
+    CHECK(cache.prefixTokenCount(1) == systemTokens);
+    CHECK(cache.prefixTokenCount(2) == tokenizeBytes(*renderChatml(messages, false), true)->size());
+    CHECK_FALSE(cache.prefixTokenCount(3).has_value());
+
+    auto const counts = cache.messageTokenCounts();
+    REQUIRE(counts.size() == 2);
+    CHECK(counts[0] == systemTokens);
+    CHECK(counts[0] + counts[1] == cache.prefixTokenCount(2));
+}
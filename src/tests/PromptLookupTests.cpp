@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/PromptLookup.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace mychat;
+
+TEST_CASE("PromptLookup: proposes what followed the last occurrence of the tail", "[llm][promptlookup]")
+{
+    auto lookup = PromptLookup(3);
+    auto drafts = std::vector<TokenId> {};
+
+    // "1 2 3 4 5 6 ... 1 2" and then 3 pending: 4 5 6 followed before.
+    auto const context = std::vector<TokenId> { 1, 2, 3, 4, 5, 6, 9, 9, 1, 2 };
+    lookup.propose(context, 3, 2, drafts);
+    CHECK(drafts == std::vector<TokenId> { 4, 5 });
+
+    lookup.propose(context, 7, 4, drafts);
+    CHECK(drafts.empty());
+
+    // The most recent occurrence wins, and proposals stop at the end of the context.
+    auto const repeated = std::vector<TokenId> { 1, 2, 3, 4, 1, 2, 3, 8, 1, 2 };
+    lookup.clear();
+    lookup.propose(repeated, 3, 8, drafts);
+    CHECK(drafts == std::vector<TokenId> { 8, 1, 2 });
+}
+
+TEST_CASE("PromptLookup: indexes appended tokens and ignores stale entries", "[llm][promptlookup]")
+{
+    auto lookup = PromptLookup(2);
+    auto drafts = std::vector<TokenId> {};
+
+    auto context = std::vector<TokenId> { 5, 6, 7 };
+    lookup.propose(context, 8, 4, drafts);
+    CHECK(drafts.empty());
+
+    context.insert(context.end(), { 8, 5 });
+    lookup.propose(context, 6, 4, drafts);
+    CHECK(drafts == std::vector<TokenId> { 7, 8, 5 });
+
+    // After the context changed from token 1 on, the old continuation is not proposed.
+    context = { 5, 6, 1, 1, 1, 5 };
+    lookup.truncate(1);
+    lookup.propose(context, 6, 4, drafts);
+    CHECK(drafts == std::vector<TokenId> { 1, 1, 1, 5 });
+
+    context = { 5 };
+    lookup.propose(context, 6, 4, drafts);
+    CHECK(drafts.empty());
+}
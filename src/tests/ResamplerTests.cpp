@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <audio/Dsp.hpp>
+#include <audio/Resampler.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto sine(double frequency, unsigned sampleRate, std::size_t count) -> std::vector<float>
+{
+    auto samples = std::vector<float>(count);
+    for (auto i = std::size_t { 0 }; i < count; ++i)
+        samples[i] = static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * frequency * i / sampleRate));
+    return samples;
+}
+
+auto resample(Resampler& resampler, std::span<const float> input) -> std::vector<float>
+{
+    auto output = std::vector<float>(resampler.maxOutputFrames(input.size()));
+    output.resize(resampler.process(input, output));
+    return output;
+}
+
+/// RMS level of @p samples, skipping the filter's start-up transient.
+auto steadyRms(std::span<const float> samples) -> float
+{
+    auto const steady = samples.subspan(samples.size() / 4);
+    return dsp::rms(dsp::measure(steady), steady.size());
+}
+
+} // namespace
+
+TEST_CASE("Resampler: copies samples when both rates are equal", "[audio][resampler]")
+{
+    auto resampler = Resampler(16000, 16000);
+    CHECK(resampler.isPassthrough());
+
+    auto const input = sine(440.0, 16000, 100);
+    CHECK(resample(resampler, input) == input);
+}
+
+TEST_CASE("Resampler: converts the number of samples by the rate ratio", "[audio][resampler]")
+{
+    for (auto const& [from, to]: { std::pair { 48000u, 16000u },
+                                   std::pair { 44100u, 16000u },
+                                   std::pair { 22050u, 48000u },
+                                   std::pair { 16000u, 44100u } })
+    {
+        auto resampler = Resampler(from, to);
+        auto const output = resample(resampler, std::vector<float>(from));
+        CHECK(output.size() >= to - 1);
+        CHECK(output.size() <= to + 1);
+    }
+}
+
+TEST_CASE("Resampler: keeps tones in the passband", "[audio][resampler]")
+{
+    for (auto const& [from, to]: { std::pair { 48000u, 16000u }, std::pair { 22050u, 48000u } })
+    {
+        auto resampler = Resampler(from, to);
+        auto const output = resample(resampler, sine(1000.0, from, from / 2));
+        CHECK(steadyRms(output) == Catch::Approx(0.5 / std::numbers::sqrt2).epsilon(0.01));
+    }
+}
+
+TEST_CASE("Resampler: rejects tones that would alias when decimating", "[audio][resampler]")
+{
+    auto resampler = Resampler(48000, 16000);
+    for (auto const frequency: { 9000.0, 12000.0, 20000.0 })
+    {
+        resampler.reset();
+        auto const output = resample(resampler, sine(frequency, 48000, 24000));
+        CHECK(steadyRms(output) < 0.5f / 1000.0f); // 60 dB below the input
+    }
+}
+
+TEST_CASE("Resampler: output does not depend on how the input is split", "[audio][resampler]")
+{
+    auto const input = sine(700.0, 44100, 5000);
+
+    auto whole = Resampler(44100, 16000);
+    auto const expected = resample(whole, input);
+
+    auto pieces = Resampler(44100, 16000);
+    auto actual = std::vector<float> {};
+    for (auto offset = std::size_t { 0 }; offset < input.size(); offset += 37)
+    {
+        auto const piece = std::span(input).subspan(offset, std::min<std::size_t>(37, input.size() - offset));
+        auto const output = resample(pieces, piece);
+        actual.insert(actual.end(), output.begin(), output.end());
+    }
+    CHECK(actual == expected);
+}
@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mcp/JsonRpc.hpp>
+#include <mcp/ServerManager.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+using namespace mychat;
+
+#ifndef _WIN32
+namespace
+{
+
+/// @brief A shell-scripted MCP server that answers the handshake and one call of its only tool.
+auto fakeServer(std::string name, std::string tool) -> McpServerConfig
+{
+    auto script = std::format(
+        R"(read line; echo '{{"jsonrpc":"2.0","id":1,"result":{{"capabilities":{{"tools":{{}}}}}}}}'; )"
+        R"(read line; read line; echo '{{"jsonrpc":"2.0","id":2,"result":{{"tools":[{{"name":"{}"}}]}}}}'; )"
+        R"(read line; echo '{{"jsonrpc":"2.0","id":3,)"
+        R"("result":{{"content":[{{"type":"text","text":"ok"}}]}}}}'; )"
+        R"(cat > /dev/null)",
+        tool);
+    return McpServerConfig {
+        .name = std::move(name),
+        .command = "sh",
+        .args = { "-c", std::move(script) },
+        .env = {},
+        .cachedTools = {},
+    };
+}
+
+/// @brief A fake server that gains a second tool after its first tool call and announces it.
+auto changingServer(std::string name) -> McpServerConfig
+{
+    auto script = std::string(
+        R"(read line; echo '{"jsonrpc":"2.0","id":1,"result":{"capabilities":{"tools":{}}}}'; )"
+        R"(read line; read line; echo '{"jsonrpc":"2.0","id":2,"result":{"tools":[{"name":"alpha"}]}}'; )"
+        R"(read line; echo '{"jsonrpc":"2.0","id":3,"result":{"content":[]}}'; )"
+        R"(echo '{"jsonrpc":"2.0","method":"notifications/tools/list_changed"}'; )"
+        R"(read line; echo '{"jsonrpc":"2.0","id":4,)"
+        R"("result":{"tools":[{"name":"alpha"},{"name":"beta"}]}}'; )"
+        R"(cat > /dev/null)");
+    return McpServerConfig {
+        .name = std::move(name),
+        .command = "sh",
+        .args = { "-c", std::move(script) },
+        .env = {},
+        .cachedTools = {},
+    };
+}
+
+/// @brief An MCP server that never answers.
+auto silentServer(std::string name) -> McpServerConfig
+{
+    return McpServerConfig {
+        .name = std::move(name),
+        .command = "sh",
+        .args = { "-c", "cat > /dev/null" },
+        .env = {},
+        .cachedTools = {},
+        .startupTimeoutSeconds = 1,
+    };
+}
+
+} // namespace
+
+TEST_CASE("ServerManager addServers connects all servers", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto const configs = std::array { fakeServer("a", "alpha"), fakeServer("b", "beta") };
+
+    auto const results = manager.addServers(configs);
+    REQUIRE(results.size() == 2);
+    CHECK(results[0].has_value());
+    CHECK(results[1].has_value());
+    CHECK(manager.serverCount() == 2);
+
+    auto const tools = manager.allTools();
+    REQUIRE(tools.size() == 2);
+}
+
+TEST_CASE("ServerManager addServers times out a silent server without losing the others", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto const configs = std::array { silentServer("slow"), fakeServer("fast", "alpha") };
+
+    auto const start = std::chrono::steady_clock::now();
+    auto const results = manager.addServers(configs);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    REQUIRE(results.size() == 2);
+    REQUIRE(!results[0].has_value());
+    CHECK(results[0].error().code == ErrorCode::TimeoutError);
+    CHECK(results[1].has_value());
+
+    auto const tools = manager.allTools();
+    REQUIRE(tools.size() == 1);
+    CHECK(tools[0].name == "alpha");
+}
+
+TEST_CASE("ServerManager addServers aborts on stop request", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto const configs = std::array { silentServer("slow") };
+
+    auto stopSource = std::stop_source();
+    stopSource.request_stop();
+    auto const results = manager.addServers(configs, stopSource.get_token());
+
+    REQUIRE(results.size() == 1);
+    CHECK(!results[0].has_value());
+    CHECK(manager.serverCount() == 0);
+}
+
+TEST_CASE("ServerManager starts servers with a tool manifest on first use", "[mcp]")
+{
+    auto const directory = std::filesystem::temp_directory_path() / "mychat_test_manifests";
+    std::filesystem::remove_all(directory);
+    auto const config = fakeServer("lazy", "alpha");
+
+    {
+        auto manager = ServerManager();
+        manager.setManifestDirectory(directory);
+        REQUIRE(manager.addServer(config).has_value());
+        CHECK(manager.runningServerCount() == 1);
+    }
+
+    auto manager = ServerManager();
+    manager.setManifestDirectory(directory);
+    REQUIRE(manager.addServer(config).has_value());
+    CHECK(manager.serverCount() == 1);
+    CHECK(manager.runningServerCount() == 0);
+    REQUIRE(manager.allTools().size() == 1);
+    CHECK(manager.allTools()[0].name == "alpha");
+
+    auto const result = manager.callTool("alpha", nlohmann::json::object());
+    REQUIRE(result.has_value());
+    CHECK(result->content == "ok");
+    CHECK(manager.runningServerCount() == 1);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("ServerManager stops idle servers", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto config = fakeServer("idle", "alpha");
+    config.idleTimeoutSeconds = 1;
+
+    REQUIRE(manager.addServer(config).has_value());
+    CHECK(manager.runningServerCount() == 1);
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (manager.runningServerCount() > 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(manager.runningServerCount() == 0);
+    CHECK(manager.allTools().size() == 1);
+}
+
+TEST_CASE("ServerManager publishes a new tool snapshot when tools change", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto const empty = manager.toolSnapshot();
+    CHECK(empty->tools.empty());
+
+    REQUIRE(manager.addServer(changingServer("changing")).has_value());
+    auto const before = manager.toolSnapshot();
+    CHECK(before->version > empty->version);
+    REQUIRE(before->tools.size() == 1);
+    CHECK(manager.toolSnapshot() == before); // Unchanged tools share the snapshot.
+
+    REQUIRE(manager.callTool("alpha", nlohmann::json::object()).has_value());
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (manager.toolSnapshot() == before && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto const after = manager.toolSnapshot();
+    CHECK(after->version > before->version);
+    REQUIRE(after->tools.size() == 2);
+    CHECK(after->tools[1].name == "beta");
+    CHECK(before->tools.size() == 1); // Earlier snapshots are not modified.
+}
+#endif
+
+namespace
+{
+
+/// @brief An in-process MCP server with one text resource whose contents change on request.
+class ResourceServerTransport: public Transport
+{
+  public:
+    explicit ResourceServerTransport(bool subscriptions): _subscriptions(subscriptions) {}
+
+    auto send(nlohmann::json const& message) -> VoidResult override
+    {
+        auto const lock = std::lock_guard(_mutex);
+        auto const method = message.value("method", std::string {});
+        if (method == "resources/read")
+            ++reads;
+        if (message.contains("id"))
+            _inbox.push(jsonrpc::makeResponse(message["id"], respond(method)));
+        _changed.notify_all();
+        return {};
+    }
+
+    auto receive() -> Result<nlohmann::json> override
+    {
+        auto lock = std::unique_lock(_mutex);
+        _changed.wait(lock, [this] { return _closed || !_inbox.empty(); });
+        if (_inbox.empty())
+            return makeError(ErrorCode::TransportError, "Resource transport closed");
+        auto message = std::move(_inbox.front());
+        _inbox.pop();
+        return message;
+    }
+
+    void close() override
+    {
+        auto const lock = std::lock_guard(_mutex);
+        _closed = true;
+        _changed.notify_all();
+    }
+
+    [[nodiscard]] auto isConnected() const -> bool override { return true; }
+
+    /// @brief Changes the resource and announces it, like a watched file being edited.
+    void edit(std::string text)
+    {
+        auto const lock = std::lock_guard(_mutex);
+        _text = std::move(text);
+        _inbox.push(
+            jsonrpc::makeNotification("notifications/resources/updated", { { "uri", "file:///a.txt" } }));
+        _changed.notify_all();
+    }
+
+    std::atomic<int> reads = 0;
+
+  private:
+    auto respond(std::string const& method) -> nlohmann::json
+    {
+        if (method == "initialize")
+            return { { "capabilities", { { "resources", { { "subscribe", _subscriptions } } } } } };
+        if (method == "tools/list")
+            return { { "tools", nlohmann::json::array() } };
+        if (method == "resources/read")
+        {
+            auto content = nlohmann::json { { "uri", "file:///a.txt" }, { "text", _text } };
+            return { { "contents", nlohmann::json::array({ std::move(content) }) } };
+        }
+        return nlohmann::json::object();
+    }
+
+    bool _subscriptions;
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::queue<nlohmann::json> _inbox;
+    std::string _text = "one";
+    bool _closed = false;
+};
+
+/// @brief Adds a server backed by a ResourceServerTransport to @p manager and returns the transport.
+auto addResourceServer(ServerManager& manager, bool subscriptions) -> ResourceServerTransport*
+{
+    auto transport = std::make_unique<ResourceServerTransport>(subscriptions);
+    auto* server = transport.get();
+    auto pending = std::make_shared<std::unique_ptr<Transport>>(std::move(transport));
+    manager.setTransportFactory([pending](McpServerConfig const& /*config*/, TransportOpener /*open*/)
+                                    -> Result<std::unique_ptr<Transport>> {
+        if (!*pending)
+            return makeError(ErrorCode::TransportError, "The resource server only connects once");
+        return std::move(*pending);
+    });
+    auto config = McpServerConfig {};
+    config.name = "files";
+    REQUIRE(manager.addServer(config).has_value());
+    return server;
+}
+
+auto readText(ServerManager& manager) -> std::string
+{
+    auto const contents = manager.readResource("files", "file:///a.txt");
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->size() == 1);
+    return (*contents)[0].text;
+}
+
+} // namespace
+
+TEST_CASE("ServerManager caches resources until the server announces a change", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto* server = addResourceServer(manager, true);
+
+    CHECK(readText(manager) == "one");
+    CHECK(readText(manager) == "one");
+    CHECK(server->reads == 1);
+
+    server->edit("two");
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto text = readText(manager);
+    while (text == "one" && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        text = readText(manager);
+    }
+    CHECK(text == "two");
+    CHECK(readText(manager) == "two");
+    CHECK(server->reads == 2);
+
+    CHECK_FALSE(manager.readResource("other", "file:///a.txt").has_value());
+}
+
+TEST_CASE("ServerManager reads resources through without subscriptions", "[mcp]")
+{
+    auto manager = ServerManager();
+    auto* server = addResourceServer(manager, false);
+
+    CHECK(readText(manager) == "one");
+    CHECK(readText(manager) == "one");
+    CHECK(server->reads == 2);
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/SessionStore.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <format>
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief Returns an empty store directory for the test @p name.
+auto freshDirectory(std::string_view name) -> std::filesystem::path
+{
+    auto const directory =
+        std::filesystem::temp_directory_path() / std::format("mychat_test_sessions_{}", name);
+    std::filesystem::remove_all(directory);
+    return directory;
+}
+
+auto message(Role role, std::string content) -> ChatMessage
+{
+    return ChatMessage { .role = role, .content = std::move(content), .toolCalls = {}, .toolCallId = {} };
+}
+
+auto conversation() -> std::vector<ChatMessage>
+{
+    auto call = message(Role::Assistant, {});
+    call.toolCalls.push_back(
+        ToolCall { .id = "call_0", .name = "weather", .arguments = { { "city", "Berlin" } } });
+    auto result = message(Role::Tool, "Sunny");
+    result.toolCallId = "call_0";
+    return {
+        message(Role::System, "sys"),
+        message(Role::User, "What is the weather?\nIn Berlin."),
+        call,
+        result,
+        message(Role::Assistant, "It is sunny."),
+    };
+}
+
+} // namespace
+
+TEST_CASE("SessionStore: messages round-trip through the log", "[llm][session-store]")
+{
+    auto const directory = freshDirectory("roundtrip");
+    auto store = SessionStore(directory);
+    auto const id = store.create();
+    REQUIRE(id.has_value());
+
+    auto const messages = conversation();
+    REQUIRE(store.append(*id, messages).has_value());
+
+    // A fresh store reads everything back from disk.
+    auto const loaded = SessionStore(directory).load(*id);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->size() == 4);
+    CHECK((*loaded)[0].content == "What is the weather?\nIn Berlin.");
+    REQUIRE((*loaded)[1].toolCalls.size() == 1);
+    CHECK((*loaded)[1].toolCalls[0].name == "weather");
+    CHECK((*loaded)[1].toolCalls[0].arguments["city"] == "Berlin");
+    CHECK((*loaded)[2].role == Role::Tool);
+    CHECK((*loaded)[2].toolCallId == "call_0");
+    CHECK((*loaded)[3].content == "It is sunny.");
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("SessionStore: the index lists sessions without reading logs", "[llm][session-store]")
+{
+    auto const directory = freshDirectory("index");
+    {
+        auto store = SessionStore(directory);
+        auto const first = store.create();
+        auto const second = store.create();
+        REQUIRE(first.has_value());
+        REQUIRE(second.has_value());
+        CHECK(*first != *second);
+        REQUIRE(store.append(*first, conversation()).has_value());
+        REQUIRE(store.setStateSnapshot(*first, "/tmp/prefix.state").has_value());
+    }
+
+    // Without the logs, the index alone still describes the sessions.
+    for (auto const& entry: std::filesystem::directory_iterator(directory))
+        if (entry.path().extension() == ".log")
+            std::filesystem::remove(entry.path());
+
+    auto const sessions = SessionStore(directory).list();
+    REQUIRE(sessions.has_value());
+    REQUIRE(sessions->size() == 2);
+    auto const& updated = sessions->front();
+    CHECK(updated.title == "What is the weather?");
+    CHECK(updated.messageCount == 4);
+    CHECK(updated.stateSnapshot == "/tmp/prefix.state");
+    CHECK(sessions->back().messageCount == 0);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("SessionStore: truncation records drop replies on load", "[llm][session-store]")
+{
+    auto const directory = freshDirectory("truncate");
+    auto store = SessionStore(directory);
+    auto const id = store.create();
+    REQUIRE(id.has_value());
+    REQUIRE(store.append(*id, conversation()).has_value());
+
+    REQUIRE(store.truncate(*id, 1).has_value());
+    auto const regenerated = std::vector { message(Role::Assistant, "Let me check.") };
+    REQUIRE(store.append(*id, regenerated).has_value());
+
+    auto const loaded = store.load(*id);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->size() == 2);
+    CHECK((*loaded)[1].content == "Let me check.");
+    CHECK(store.list()->front().messageCount == 2);
+
+    CHECK_FALSE(store.append("missing", regenerated).has_value());
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("SessionStore: a record cut short by a crash is ignored", "[llm][session-store]")
+{
+    auto const directory = freshDirectory("torn");
+    auto store = SessionStore(directory);
+    auto const id = store.create();
+    REQUIRE(id.has_value());
+    REQUIRE(store.append(*id, conversation()).has_value());
+
+    auto const log = directory / std::format("{}.log", *id);
+    std::filesystem::resize_file(log, std::filesystem::file_size(log) - 3);
+
+    auto const loaded = store.load(*id);
+    REQUIRE(loaded.has_value());
+    CHECK(loaded->size() == 3);
+
+    // After a restart, the torn record is cut off so that what is appended next can be read.
+    auto reopened = SessionStore(directory);
+    auto const next = std::vector { message(Role::User, "And tomorrow?") };
+    REQUIRE(reopened.append(*id, next).has_value());
+    auto const appended = SessionStore(directory).load(*id);
+    REQUIRE(appended.has_value());
+    REQUIRE(appended->size() == 4);
+    CHECK(appended->back().content == "And tomorrow?");
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <audio/SpeechCache.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// Bytes taken by @p count samples.
+constexpr auto bytesFor(std::size_t count) -> std::size_t
+{
+    return count * sizeof(float);
+}
+
+} // namespace
+
+TEST_CASE("SpeechCache: normalizes whitespace only", "[audio][tts]")
+{
+    CHECK(SpeechCache::normalize("  Sure.\n") == "Sure.");
+    CHECK(SpeechCache::normalize("Let me \t check  that.") == "Let me check that.");
+    CHECK(SpeechCache::normalize("Sure!") != SpeechCache::normalize("sure."));
+}
+
+TEST_CASE("SpeechCache: returns stored samples and counts lookups", "[audio][tts]")
+{
+    auto cache = SpeechCache(bytesFor(100));
+    CHECK(cache.lookup("Sure.") == nullptr);
+
+    cache.store("Sure.", std::vector<float>(10, 0.5f));
+    auto const samples = cache.lookup("Sure.");
+    REQUIRE(samples != nullptr);
+    CHECK(samples->size() == 10);
+    CHECK(cache.bytes() == bytesFor(10));
+    CHECK(cache.hits() == 1);
+    CHECK(cache.misses() == 1);
+}
+
+TEST_CASE("SpeechCache: evicts least recently used phrases beyond the memory cap", "[audio][tts]")
+{
+    auto cache = SpeechCache(bytesFor(100));
+    cache.store("a", std::vector<float>(40));
+    cache.store("b", std::vector<float>(40));
+    CHECK(cache.lookup("a") != nullptr); // "b" is now the least recently used one.
+
+    cache.store("c", std::vector<float>(40));
+    CHECK(cache.size() == 2);
+    CHECK(cache.bytes() == bytesFor(80));
+    CHECK(cache.lookup("b") == nullptr);
+    CHECK(cache.lookup("a") != nullptr);
+    CHECK(cache.lookup("c") != nullptr);
+
+    // A phrase larger than the whole cache is not stored, and evicts nothing.
+    cache.store("d", std::vector<float>(101));
+    CHECK(cache.lookup("d") == nullptr);
+    CHECK(cache.size() == 2);
+}
+
+TEST_CASE("SpeechCache: persists repeated phrases to disk", "[audio][tts]")
+{
+    auto const directory = std::filesystem::temp_directory_path() / "mychat_test_speech_cache";
+    std::filesystem::remove_all(directory);
+
+    {
+        auto cache = SpeechCache(bytesFor(100), directory);
+        cache.store("Once.", std::vector<float>(5, 0.25f));
+        cache.store("Twice.", std::vector<float>(6, 0.75f));
+        CHECK(cache.lookup("Twice.") != nullptr);
+    }
+
+    auto cache = SpeechCache(bytesFor(100), directory);
+    CHECK(cache.lookup("Once.") == nullptr);
+    auto const samples = cache.lookup("Twice.");
+    REQUIRE(samples != nullptr);
+    CHECK(*samples == std::vector<float>(6, 0.75f));
+    CHECK(cache.size() == 1);
+
+    std::filesystem::remove_all(directory);
+}
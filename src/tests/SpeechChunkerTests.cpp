@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <audio/SpeechChunker.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// Feeds @p text one character at a time, as a worst-case token stream, and finishes the message.
+auto chunk(std::string_view text, SpeechChunkerConfig config = {}) -> std::vector<std::string>
+{
+    auto chunker = SpeechChunker(config);
+    auto chunks = std::vector<std::string> {};
+    for (auto const c: text)
+        chunker.feed(std::string_view(&c, 1), chunks);
+    chunker.finish(chunks);
+    return chunks;
+}
+
+} // namespace
+
+TEST_CASE("SpeechChunker: splits at sentence ends and line breaks", "[audio][tts]")
+{
+    auto const chunks = chunk("Hello there. How are you?\nFine!");
+    CHECK(chunks == std::vector<std::string> { "Hello there.", "How are you?", "Fine!" });
+}
+
+TEST_CASE("SpeechChunker: emits a sentence as soon as it is terminated", "[audio][tts]")
+{
+    auto chunker = SpeechChunker();
+    auto chunks = std::vector<std::string> {};
+    CHECK(chunker.feed("It works", chunks) == 0);
+    CHECK(chunker.feed(". And", chunks) == 1);
+    CHECK(chunks == std::vector<std::string> { "It works." });
+    chunker.finish(chunks);
+    CHECK(chunks.back() == "And");
+}
+
+TEST_CASE("SpeechChunker: splits long sentences at clause boundaries", "[audio][tts]")
+{
+    auto const chunks = chunk("Sure, I can help with that. When the build finishes, which takes a while "
+                              "on this machine, the tests run: first the unit tests, then the slow ones.");
+    CHECK(chunks
+          == std::vector<std::string> {
+              "Sure, I can help with that.",
+              "When the build finishes, which takes a while on this machine,",
+              "the tests run: first the unit tests, then the slow ones.",
+          });
+}
+
+TEST_CASE("SpeechChunker: cuts the first chunk early", "[audio][tts]")
+{
+    auto const config = SpeechChunkerConfig {
+        .firstClauseChars = 12, .firstChunkChars = 30, .minClauseChars = 40, .maxChunkChars = 240
+    };
+    CHECK(chunk("Alright then, the quick brown fox jumps over the lazy dog", config)
+          == std::vector<std::string> { "Alright then,", "the quick brown fox jumps over the lazy dog" });
+    CHECK(chunk("The quick brown fox jumps over the lazy dog and runs on", config)
+          == std::vector<std::string> { "The quick brown fox jumps over", "the lazy dog and runs on" });
+}
+
+TEST_CASE("SpeechChunker: splits at dashes", "[audio][tts]")
+{
+    auto const config = SpeechChunkerConfig {
+        .firstClauseChars = 5, .firstChunkChars = 60, .minClauseChars = 5, .maxChunkChars = 240
+    };
+    CHECK(chunk("One thing - and another—and a third", config)
+          == std::vector<std::string> { "One thing -", "and another—", "and a third" });
+}
+
+TEST_CASE("SpeechChunker: skips fenced code blocks", "[audio][tts]")
+{
+    auto const chunks = chunk("Run this:\n```bash\nmake -j8 && ./run.sh\n```\nThat's all.");
+    CHECK(chunks == std::vector<std::string> { "Run this:", "That's all." });
+}
+
+TEST_CASE("SpeechChunker: drops markdown syntax", "[audio][tts]")
+{
+    auto const chunks = chunk("## Steps\n"
+                              "1. Open **the** `config` file\n"
+                              "- See [the docs](https://example.com/docs) for more\n"
+                              "> Quoted text\n"
+                              "---\n"
+                              "42\n");
+    CHECK(chunks
+          == std::vector<std::string> {
+              "Steps",
+              "Open the config file",
+              "See the docs for more",
+              "Quoted text",
+              "42",
+          });
+}
+
+TEST_CASE("SpeechChunker: finish resets for the next message", "[audio][tts]")
+{
+    auto chunker = SpeechChunker();
+    auto chunks = std::vector<std::string> {};
+    chunker.feed("```\nunterminated code", chunks);
+    CHECK(chunker.insideCodeBlock());
+    chunker.finish(chunks);
+    CHECK(chunks.empty());
+    CHECK(!chunker.insideCodeBlock());
+
+    chunker.feed("Spoken again.", chunks);
+    chunker.finish(chunks);
+    CHECK(chunks == std::vector<std::string> { "Spoken again." });
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/SpscQueue.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+TEST_CASE("SpscQueue: rounds capacity up to a power of two", "[core][spsc]")
+{
+    CHECK(SpscQueue<int>(5).capacity() == 8);
+    CHECK(SpscQueue<int>(8).capacity() == 8);
+    CHECK(SpscQueue<int>(0).capacity() == 2);
+}
+
+TEST_CASE("SpscQueue: preserves FIFO order and reports full/empty", "[core][spsc]")
+{
+    auto queue = SpscQueue<std::string>(2);
+    CHECK(queue.empty());
+    CHECK(queue.tryPush("a"));
+    CHECK(queue.tryPush("b"));
+    CHECK_FALSE(queue.tryPush("c"));
+
+    CHECK(queue.tryPop() == "a");
+    CHECK(queue.tryPush("c"));
+    CHECK(queue.tryPop() == "b");
+    CHECK(queue.tryPop() == "c");
+    CHECK_FALSE(queue.tryPop().has_value());
+    CHECK(queue.empty());
+}
+
+TEST_CASE("SpscQueue: transfers all elements between threads", "[core][spsc]")
+{
+    constexpr auto Count = 100'000;
+    auto queue = SpscQueue<int>(64);
+
+    auto producer = std::jthread([&] {
+        for (auto i = 0; i < Count; ++i)
+        {
+            while (!queue.tryPush(int { i }))
+                std::this_thread::yield();
+        }
+    });
+
+    auto expected = 0;
+    while (expected < Count)
+    {
+        if (auto value = queue.tryPop())
+        {
+            REQUIRE(*value == expected);
+            ++expected;
+        }
+    }
+    CHECK(queue.empty());
+}
+
+TEST_CASE("SpscQueue: pushes and pops ranges partially when full or short", "[core][spsc]")
+{
+    auto queue = SpscQueue<float>(4);
+    auto const input = std::array { 1.0f, 2.0f, 3.0f };
+    CHECK(queue.tryPushSome(input) == 3);
+    CHECK(queue.tryPushSome(input) == 1);
+    CHECK(queue.tryPushSome(input) == 0);
+
+    auto output = std::array<float, 3> {};
+    REQUIRE(queue.tryPopSome(output) == 3);
+    CHECK(output == std::array { 1.0f, 2.0f, 3.0f });
+    REQUIRE(queue.tryPopSome(output) == 1);
+    CHECK(output[0] == 1.0f);
+    CHECK(queue.tryPopSome(output) == 0);
+    CHECK(queue.empty());
+}
+
+TEST_CASE("SpscQueue: transfers ranges between threads", "[core][spsc]")
+{
+    constexpr auto Count = 100'000;
+    auto queue = SpscQueue<int>(64);
+
+    auto producer = std::jthread([&] {
+        auto chunk = std::array<int, 7> {};
+        for (auto next = 0; next < Count;)
+        {
+            auto const size = std::min<size_t>(chunk.size(), static_cast<size_t>(Count - next));
+            for (auto i = size_t { 0 }; i < size; ++i)
+                chunk[i] = next + static_cast<int>(i);
+            auto const pushed = queue.tryPushSome(std::span(chunk).first(size));
+            next += static_cast<int>(pushed);
+            if (pushed == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    auto received = std::vector<int> {};
+    auto chunk = std::array<int, 5> {};
+    while (received.size() < Count)
+    {
+        auto const popped = queue.tryPopSome(chunk);
+        received.insert(received.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(popped));
+    }
+    for (auto i = 0; i < Count; ++i)
+        REQUIRE(received[static_cast<size_t>(i)] == i);
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/Startup.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+/// @brief Stands in for the agent that the model's task creates.
+struct FakeAgent
+{
+    std::vector<std::string> received;
+};
+
+/// @brief Polls @p done until it holds, for up to ten seconds.
+template <typename Predicate>
+auto eventually(Predicate done) -> bool
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("ComponentStartup: a failing or slow component leaves the others usable", "[app][startup]")
+{
+    auto notified = std::atomic<int> { 0 };
+    auto model = StartupComponent { "Model" };
+    auto tools = StartupComponent { "Tools" };
+    auto voice = StartupComponent { "Voice input" };
+    auto speech = StartupComponent { "Speech" };
+    auto startup = ComponentStartup([&] { ++notified; });
+
+    auto agent = std::unique_ptr<FakeAgent> {};
+    auto slowStopped = std::atomic<bool> { false };
+    startup.add(model, [&](std::stop_token) {
+        agent = std::make_unique<FakeAgent>();
+        return true;
+    });
+    startup.add(tools, [](std::stop_token) { return false; });
+    startup.add(voice, [&](std::stop_token stopToken) {
+        while (!stopToken.stop_requested())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        slowStopped = true;
+        return false;
+    });
+
+    CHECK(model.state() == ComponentState::Loading);
+    CHECK(speech.state() == ComponentState::Disabled);
+    CHECK(startup.text() == "Model: loading  Tools: loading  Voice input: loading");
+
+    startup.start();
+    REQUIRE(eventually([&] { return model.state() != ComponentState::Loading; }));
+    REQUIRE(eventually([&] { return tools.state() != ComponentState::Loading; }));
+    CHECK(model.state() == ComponentState::Ready);
+    CHECK(tools.state() == ComponentState::Failed);
+    CHECK(voice.state() == ComponentState::Loading);
+    CHECK(notified >= 2);
+
+    // The model is taken over while voice input is still loading.
+    REQUIRE(model.adopt());
+    REQUIRE(agent);
+    agent->received.emplace_back("hello");
+    CHECK(startup.text() == "Model: ready  Tools: failed  Voice input: loading");
+    CHECK_FALSE(voice.adopt());
+    CHECK_FALSE(speech.adopt());
+
+    startup.stop();
+    CHECK(slowStopped);
+    CHECK(voice.state() == ComponentState::Failed);
+    CHECK(startup.text().empty());
+}
+
+TEST_CASE("ComponentStartup: the agent is not used before it is adopted", "[app][startup]")
+{
+    auto model = StartupComponent { "Model" };
+    auto tools = StartupComponent { "Tools" };
+    auto startup = ComponentStartup();
+
+    auto release = std::atomic<bool> { false };
+    auto agent = std::unique_ptr<FakeAgent> {};
+    startup.add(tools, [&](std::stop_token) {
+        release.wait(false);
+        return true;
+    });
+    startup.add(model, [&](std::stop_token) {
+        // Like priming the system prompt, which waits for the tools to be known.
+        tools.waitWhileLoading();
+        agent = std::make_unique<FakeAgent>();
+        return true;
+    });
+    startup.start();
+
+    // The UI thread queues what is sent while the model is not adopted, as App does.
+    auto queued = std::deque<std::string> {};
+    auto engineReady = false;
+    auto const send = [&](std::string message) {
+        if (!engineReady)
+            engineReady = model.adopt();
+        if (!engineReady)
+        {
+            queued.push_back(std::move(message));
+            return;
+        }
+        while (!queued.empty())
+        {
+            agent->received.push_back(std::move(queued.front()));
+            queued.pop_front();
+        }
+        agent->received.push_back(std::move(message));
+    };
+
+    send("first");
+    send("second");
+    CHECK(model.state() == ComponentState::Loading);
+    CHECK(queued.size() == 2);
+
+    release = true;
+    release.notify_all();
+    REQUIRE(eventually([&] { return model.state() == ComponentState::Ready; }));
+    send("third");
+    CHECK(engineReady);
+    CHECK(queued.empty());
+    REQUIRE(agent);
+    CHECK(agent->received == std::vector<std::string> { "first", "second", "third" });
+    CHECK_FALSE(model.adopt());
+    CHECK(tools.adopt());
+}
+
+TEST_CASE("ComponentStartup: download progress shows in the text", "[app][startup]")
+{
+    auto notified = std::atomic<int> { 0 };
+    auto speech = StartupComponent { "Speech" };
+    auto startup = ComponentStartup([&] { ++notified; });
+    startup.add(speech, [](std::stop_token) { return true; });
+
+    auto const progress = startup.downloadProgress(speech);
+    progress(DownloadProgress { .received = 25, .total = 100, .bytesPerSecond = 0.0, .done = false });
+    CHECK(speech.downloadPercent() == 25);
+    CHECK(startup.text() == "Speech: downloading 25%");
+    progress(DownloadProgress { .received = 25, .total = 100, .bytesPerSecond = 0.0, .done = false });
+    CHECK(notified == 1);
+
+    progress(DownloadProgress { .received = 100, .total = 100, .bytesPerSecond = 0.0, .done = true });
+    CHECK(speech.downloadPercent() == -1);
+    CHECK(startup.text() == "Speech: loading");
+    CHECK(notified == 2);
+}
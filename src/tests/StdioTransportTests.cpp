@@ -3,6 +3,11 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <array>
+#include <chrono>
+#include <format>
+#include <future>
+
 using namespace mychat;
 
 TEST_CASE("StdioTransport starts disconnected", "[transport]")
@@ -55,6 +60,116 @@ TEST_CASE("StdioTransport can spawn and communicate with a simple process", "[tr
     transport.close();
     CHECK(!transport.isConnected());
 }
+
+TEST_CASE("StdioTransport sends a batch of messages in order", "[transport]")
+{
+    auto transport = StdioTransport();
+    auto config = StdioTransportConfig {
+        .command = "cat",
+        .args = {},
+        .env = {},
+    };
+    REQUIRE(transport.start(config).has_value());
+
+    auto const messages = std::array {
+        nlohmann::json { { "n", 1 } },
+        nlohmann::json { { "n", 2 } },
+        nlohmann::json { { "n", 3 } },
+    };
+    REQUIRE(transport.sendBatch(messages).has_value());
+
+    for (auto const& expected: messages)
+    {
+        auto received = transport.receive();
+        REQUIRE(received.has_value());
+        CHECK(*received == expected);
+    }
+}
+
+TEST_CASE("StdioTransport splits a burst of output into messages", "[transport]")
+{
+    auto transport = StdioTransport();
+    auto config = StdioTransportConfig {
+        .command = "sh",
+        .args = { "-c", R"(printf '{"n":1}\n\n{"n":2}\n{"n":3}')" },
+        .env = {},
+    };
+    REQUIRE(transport.start(config).has_value());
+
+    auto first = transport.receive();
+    REQUIRE(first.has_value());
+    CHECK((*first)["n"] == 1);
+
+    auto second = transport.receive();
+    REQUIRE(second.has_value());
+    CHECK((*second)["n"] == 2);
+
+    // The last message is never terminated, so it is not delivered.
+    CHECK(!transport.receive().has_value());
+}
+
+TEST_CASE("StdioTransport receives a message spanning many reads", "[transport]")
+{
+    constexpr auto Size = 10 * 1024 * 1024;
+
+    auto const script = std::format(
+        R"(printf '{{"data":"'; head -c {} /dev/zero | tr '\0' a; printf '"}}\n{{"n":2}}\n')", Size);
+
+    auto transport = StdioTransport();
+    auto config = StdioTransportConfig {
+        .command = "sh",
+        .args = { "-c", script },
+        .env = {},
+    };
+    REQUIRE(transport.start(config).has_value());
+
+    auto large = transport.receive();
+    REQUIRE(large.has_value());
+    auto const& data = (*large)["data"].get_ref<std::string const&>();
+    CHECK(data.size() == Size);
+    CHECK(data.find_first_not_of('a') == std::string::npos);
+
+    auto next = transport.receive();
+    REQUIRE(next.has_value());
+    CHECK((*next)["n"] == 2);
+}
+
+TEST_CASE("StdioTransport close wakes up a blocked receive", "[transport]")
+{
+    auto transport = StdioTransport();
+    auto config = StdioTransportConfig {
+        .command = "sleep",
+        .args = { "30" },
+        .env = {},
+    };
+    REQUIRE(transport.start(config).has_value());
+
+    auto received = std::async(std::launch::async, [&] { return transport.receive(); });
+    CHECK(received.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+
+    transport.close();
+    REQUIRE(received.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(!received.get().has_value());
+}
+
+TEST_CASE("StdioTransport send times out when the process stops reading", "[transport]")
+{
+    auto transport = StdioTransport();
+    auto config = StdioTransportConfig {
+        .command = "sleep",
+        .args = { "30" },
+        .env = {},
+        .writeTimeout = std::chrono::milliseconds(100),
+    };
+    REQUIRE(transport.start(config).has_value());
+
+    // Far more than a pipe buffers, so the write has to wait for the reader.
+    auto const message = nlohmann::json { { "data", std::string(1024 * 1024, 'x') } };
+    auto const result = transport.send(message);
+    REQUIRE(!result.has_value());
+    CHECK(result.error().code == ErrorCode::TimeoutError);
+    CHECK(!transport.isConnected());
+}
 #endif
 
 TEST_CASE("StdioTransport fails to start invalid command", "[transport]")
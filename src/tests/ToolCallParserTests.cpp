@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/ToolCallParser.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto testTools() -> std::vector<ToolDefinition>
+{
+    return {
+        ToolDefinition { .name = "read_file", .description = "Reads a file", .inputSchema = {} },
+        ToolDefinition { .name = "list_dir", .description = "Lists a directory", .inputSchema = {} },
+    };
+}
+
+/// Feeds @p text one character at a time, as a worst-case token stream.
+auto feedChars(ToolCallParser& parser, std::string_view text) -> std::string
+{
+    auto visible = std::string {};
+    for (auto const c: text)
+        parser.feed(std::string_view(&c, 1), visible);
+    return visible;
+}
+
+} // namespace
+
+TEST_CASE("ToolCallParser: plain text passes through", "[llm][toolcall]")
+{
+    auto const tools = testTools();
+    auto parser = ToolCallParser(tools);
+
+    auto visible = std::string {};
+    CHECK(parser.feed("Hello, world", visible) == 0);
+    parser.finish(visible);
+    CHECK(visible == "Hello, world");
+    CHECK(parser.calls().empty());
+}
+
+TEST_CASE("ToolCallParser: markup is hidden and calls complete on the closing tag", "[llm][toolcall]")
+{
+    auto const tools = testTools();
+    auto parser = ToolCallParser(tools);
+
+    auto visible =
+        feedChars(parser, R"(Let me look.<tool_call>{"name": "read_file", "arguments": {"path": "a"}})");
+    CHECK(visible == "Let me look.");
+    CHECK(parser.insideToolCall());
+    CHECK(parser.calls().empty());
+
+    CHECK(parser.feed("</tool_call>", visible) == 1);
+    REQUIRE(parser.calls().size() == 1);
+    CHECK(parser.calls()[0].name == "read_file");
+    CHECK(parser.calls()[0].arguments["path"] == "a");
+
+    // The second call is parsed independently while the first is already available.
+    feedChars(parser, R"(<tool_call>{"name": "list_dir", "arguments": {}}</tool_call>)");
+    parser.finish(visible);
+    CHECK(visible == "Let me look.");
+
+    auto const calls = parser.takeCalls();
+    REQUIRE(calls.size() == 2);
+    CHECK(calls[0].id == "call_0");
+    CHECK(calls[1].id == "call_1");
+    CHECK(calls[1].name == "list_dir");
+}
+
+TEST_CASE("ToolCallParser: partial opener is held back until decided", "[llm][toolcall]")
+{
+    auto const tools = testTools();
+    auto parser = ToolCallParser(tools);
+
+    auto visible = std::string {};
+    parser.feed("a <tool", visible);
+    CHECK(visible == "a ");
+    parser.feed("s> b", visible);
+    CHECK(visible == "a <tools> b");
+}
+
+TEST_CASE("ToolCallParser: unknown tools and malformed payloads are dropped", "[llm][toolcall]")
+{
+    auto const tools = testTools();
+    auto parser = ToolCallParser(tools);
+
+    auto visible = std::string {};
+    CHECK(parser.feed(R"(<tool_call>{"name": "rm_rf", "arguments": {}}</tool_call>)", visible) == 0);
+    CHECK(parser.feed("<tool_call>not json</tool_call>", visible) == 0);
+    parser.finish(visible);
+    CHECK(visible.empty());
+    CHECK(parser.calls().empty());
+}
+
+TEST_CASE("ToolCallParser: unterminated block is released verbatim", "[llm][toolcall]")
+{
+    auto const tools = testTools();
+    auto parser = ToolCallParser(tools);
+
+    auto visible = std::string {};
+    parser.feed(R"(x<tool_call>{"name": "read)", visible);
+    CHECK(visible == "x");
+    parser.finish(visible);
+    CHECK(visible == R"(x<tool_call>{"name": "read)");
+    CHECK(parser.calls().empty());
+}
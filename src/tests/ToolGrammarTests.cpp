@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/ToolGrammar.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace mychat;
+
+namespace
+{
+
+auto weatherTool() -> ToolDefinition
+{
+    return ToolDefinition {
+        .name = "get_weather",
+        .description = "Returns the weather",
+        .inputSchema = nlohmann::json::parse(R"({
+            "type": "object",
+            "properties": {
+                "city": { "type": "string" },
+                "units": { "enum": ["c", "f"] },
+                "days": { "type": "integer" }
+            },
+            "required": ["city"]
+        })"),
+    };
+}
+
+} // namespace
+
+TEST_CASE("ToolGrammar: empty tool set yields no grammar", "[llm][grammar]")
+{
+    CHECK(buildToolCallGrammar({}).empty());
+}
+
+TEST_CASE("ToolGrammar: root admits only tool-call blocks", "[llm][grammar]")
+{
+    auto const tools = std::vector { weatherTool() };
+    auto const grammar = buildToolCallGrammar(tools);
+
+    CHECK(grammar.starts_with("root ::= tool-call ( ws tool-call )*\n"));
+    CHECK(grammar.contains(R"(tool-call ::= "<tool_call>" ws call ws "</tool_call>")"));
+    CHECK(grammar.contains("call ::= call0-get-weather\n"));
+    CHECK(grammar.contains(R"(ws ":" ws "\"get_weather\"")"));
+}
+
+TEST_CASE("ToolGrammar: schema properties become rules", "[llm][grammar]")
+{
+    auto rules = std::string {};
+    appendSchemaRules(weatherTool().inputSchema, "args", rules);
+
+    CHECK(rules.contains("args-city ::= string\n"));
+    CHECK(rules.contains("args-days ::= integer\n"));
+    CHECK(rules.contains(R"(args-units ::= "\"c\"" | "\"f\"")"));
+    // Required property is mandatory, optional ones may follow.
+    CHECK(rules.contains(R"(args ::= "{" ws "\"city\"" ws ":" ws args-city ( ws "," ws args-opt )* ws "}")"));
+}
+
+TEST_CASE("ToolGrammar: unsupported schemas fall back to generic JSON", "[llm][grammar]")
+{
+    auto rules = std::string {};
+    appendSchemaRules(nlohmann::json::parse(R"({"anyOf": [{"type": "string"}]})"), "x", rules);
+    CHECK(rules == "x ::= value\n");
+
+    rules.clear();
+    appendSchemaRules(nlohmann::json::parse(R"({"type": "array", "items": {"type": "number"}})"), "y", rules);
+    CHECK(rules.contains("y-item ::= number\n"));
+    CHECK(rules.contains(R"(y ::= "[" ws ( y-item ( ws "," ws y-item )* )? ws "]")"));
+}
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <agent/ToolIndex.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <filesystem>
+
+using namespace mychat;
+
+namespace
+{
+
+/// Embeds text as a normalized bag of topic keywords, counting the calls.
+struct KeywordEmbedder
+{
+    int calls = 0;
+
+    auto operator()(std::string_view text) -> Result<std::vector<float>>
+    {
+        ++calls;
+        constexpr auto Topics = std::array<std::string_view, 3> { "file", "weather", "mail" };
+        auto embedding = std::vector<float>(Topics.size());
+        for (auto i = size_t { 0 }; i < Topics.size(); ++i)
+            embedding[i] = text.find(Topics[i]) != std::string_view::npos ? 1.f : 0.f;
+        return embedding;
+    }
+};
+
+auto makeTool(std::string name, std::string description) -> ToolDefinition
+{
+    return ToolDefinition {
+        .name = std::move(name),
+        .description = std::move(description),
+        .inputSchema = nlohmann::json::object(),
+    };
+}
+
+auto makeTools() -> std::vector<ToolDefinition>
+{
+    return {
+        makeTool("read", "Reads a file"),
+        makeTool("forecast", "Returns the weather"),
+        makeTool("send", "Sends a mail"),
+        makeTool("write", "Writes a file"),
+    };
+}
+
+} // namespace
+
+TEST_CASE("ToolIndex: selects the most similar tools in original order", "[agent][toolindex]")
+{
+    auto embedder = KeywordEmbedder {};
+    auto index = ToolIndex([&](std::string_view text) { return embedder(text); });
+    auto const tools = makeTools();
+
+    auto added = index.update(tools);
+    REQUIRE(added);
+    CHECK(*added == 4);
+
+    auto selected = index.select(tools, "open the file please", 2);
+    REQUIRE(selected);
+    REQUIRE(selected->size() == 2);
+    CHECK((*selected)[0].name == "read");
+    CHECK((*selected)[1].name == "write");
+}
+
+TEST_CASE("ToolIndex: unchanged tools are not embedded again", "[agent][toolindex]")
+{
+    auto embedder = KeywordEmbedder {};
+    auto index = ToolIndex([&](std::string_view text) { return embedder(text); });
+    auto tools = makeTools();
+
+    REQUIRE(index.update(tools));
+    CHECK(embedder.calls == 4);
+
+    tools.push_back(makeTool("inbox", "Lists mail"));
+    auto added = index.update(tools);
+    REQUIRE(added);
+    CHECK(*added == 1);
+    CHECK(embedder.calls == 5);
+
+    // Small tool sets are passed through without embedding the query.
+    auto all = index.select(tools, "anything", tools.size());
+    REQUIRE(all);
+    CHECK(all->size() == tools.size());
+    CHECK(embedder.calls == 5);
+}
+
+TEST_CASE("ToolIndex: embeddings survive a save and load round trip", "[agent][toolindex]")
+{
+    auto const path = std::filesystem::temp_directory_path() / "mychat_test_tool_index.bin";
+    auto const tools = makeTools();
+
+    auto first = KeywordEmbedder {};
+    auto saved = ToolIndex([&](std::string_view text) { return first(text); });
+    REQUIRE(saved.update(tools));
+    REQUIRE(saved.save(path));
+
+    auto second = KeywordEmbedder {};
+    auto loaded = ToolIndex([&](std::string_view text) { return second(text); });
+    REQUIRE(loaded.load(path));
+    CHECK(loaded.size() == tools.size());
+
+    auto added = loaded.update(tools);
+    REQUIRE(added);
+    CHECK(*added == 0);
+    CHECK(second.calls == 0);
+
+    auto selected = loaded.select(tools, "what is the weather", 1);
+    REQUIRE(selected);
+    REQUIRE(selected->size() == 1);
+    CHECK(selected->front().name == "forecast");
+
+    std::filesystem::remove(path);
+    CHECK_FALSE(loaded.load(path));
+}
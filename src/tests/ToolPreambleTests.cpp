@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <llm/ToolGrammar.hpp>
+#include <llm/ToolPreamble.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <format>
+
+using namespace mychat;
+
+namespace
+{
+
+auto weatherTool() -> ToolDefinition
+{
+    return ToolDefinition {
+        .name = "get_weather",
+        .description = "Returns the weather. Data comes from the national weather service.",
+        .inputSchema = nlohmann::json::parse(R"({
+            "type": "object",
+            "properties": {
+                "city": { "type": "string", "description": "City name" },
+                "units": { "enum": ["c", "f"] },
+                "days": { "type": "array", "items": { "type": "integer" } }
+            },
+            "required": ["city"]
+        })"),
+    };
+}
+
+/// Counts whitespace-separated words as a stand-in for a tokenizer.
+auto countWords(std::string_view text) -> Result<size_t>
+{
+    auto count = size_t { 0 };
+    auto inWord = false;
+    for (auto const c: text)
+    {
+        auto const space = c == ' ' || c == '\n';
+        if (!space && !inWord)
+            ++count;
+        inWord = !space;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST_CASE("ToolPreamble: signature lists typed arguments", "[llm][preamble]")
+{
+    CHECK(toolSignature(weatherTool()) == R"(get_weather(city: string, days?: integer[], units?: "c"|"f"))");
+}
+
+TEST_CASE("ToolPreamble: nested objects are shown up to two levels", "[llm][preamble]")
+{
+    auto const schema = nlohmann::json::parse(R"({
+        "type": "object",
+        "properties": {
+            "a": { "type": "object", "properties": { "b": { "type": "object", "properties": {} } } }
+        }
+    })");
+    CHECK(compactSchemaType(schema) == "{a?: {b?: object}}");
+    CHECK(compactSchemaType(nlohmann::json::object()) == "any");
+}
+
+TEST_CASE("ToolPreamble: rendering explains the call format", "[llm][preamble]")
+{
+    auto const tools = std::vector { weatherTool() };
+    auto const full = renderToolPreamble(tools, ToolPreambleDetail::Full);
+    CHECK(full.find(ToolCallOpenTag) != std::string::npos);
+    CHECK(full.find("national weather service") != std::string::npos);
+    CHECK(full.find("  - city: City name\n") != std::string::npos);
+
+    auto const brief = renderToolPreamble(tools, ToolPreambleDetail::Brief);
+    CHECK(brief.find("Returns the weather.\n") != std::string::npos);
+    CHECK(brief.find("national weather service") == std::string::npos);
+
+    CHECK(renderToolPreamble({}, ToolPreambleDetail::Full).empty());
+}
+
+TEST_CASE("ToolPreamble: tokens are only counted when the tool set changes", "[llm][preamble]")
+{
+    auto calls = 0;
+    auto preamble = ToolPreamble([&](std::string_view text) {
+        ++calls;
+        return countWords(text);
+    });
+    auto const tools = std::vector { weatherTool() };
+
+    auto first = preamble.update(tools, "key-a", 0);
+    REQUIRE(first);
+    CHECK(*first);
+    CHECK(preamble.tokenCount() == *countWords(preamble.text()));
+    CHECK(preamble.includedToolCount() == 1);
+
+    auto second = preamble.update(tools, "key-a", 0);
+    REQUIRE(second);
+    CHECK_FALSE(*second);
+    CHECK(calls == 1);
+
+    auto cleared = preamble.update({}, "", 0);
+    REQUIRE(cleared);
+    CHECK(*cleared);
+    CHECK(preamble.text().empty());
+    CHECK(preamble.tokenCount() == 0);
+}
+
+TEST_CASE("ToolPreamble: budget shortens descriptions before dropping tools", "[llm][preamble]")
+{
+    auto tools = std::vector<ToolDefinition> {};
+    for (auto i = 0; i < 8; ++i)
+    {
+        auto tool = weatherTool();
+        tool.name = std::format("tool_{}", i);
+        tools.push_back(std::move(tool));
+    }
+
+    auto preamble = ToolPreamble(countWords);
+    auto const full = *countWords(renderToolPreamble(tools, ToolPreambleDetail::Full));
+    auto const signatures = *countWords(renderToolPreamble(tools, ToolPreambleDetail::Signatures));
+
+    REQUIRE(preamble.update(tools, "k", full - 1));
+    CHECK(preamble.detail() != ToolPreambleDetail::Full);
+    CHECK(preamble.includedToolCount() == tools.size());
+    CHECK(preamble.tokenCount() < full);
+
+    REQUIRE(preamble.update(tools, "k", signatures - 1));
+    CHECK(preamble.detail() == ToolPreambleDetail::Signatures);
+    CHECK(preamble.includedToolCount() < tools.size());
+    CHECK(preamble.includedToolCount() > 0);
+    CHECK(preamble.tokenCount() <= signatures - 1);
+}
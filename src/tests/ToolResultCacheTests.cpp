@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <agent/ToolResultCache.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace mychat;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+auto makeResult(std::string content, bool isError = false) -> ToolResult
+{
+    return ToolResult { .callId = "call", .content = std::move(content), .isError = isError };
+}
+
+} // namespace
+
+TEST_CASE("ToolResultCache: key ignores argument member order", "[agent][toolcache]")
+{
+    auto const a = nlohmann::json::parse(R"({"path": "a.txt", "limit": 10})");
+    auto const b = nlohmann::json::parse(R"({"limit": 10, "path": "a.txt"})");
+    CHECK(ToolResultCache::makeKey("fs", "read_file", a) == ToolResultCache::makeKey("fs", "read_file", b));
+    CHECK(ToolResultCache::makeKey("fs", "read_file", a) != ToolResultCache::makeKey("git", "read_file", a));
+}
+
+TEST_CASE("ToolResultCache: hits until the entry expires", "[agent][toolcache]")
+{
+    auto cache = ToolResultCache(8);
+    auto const now = ToolResultCache::Clock::now();
+
+    CHECK_FALSE(cache.lookup("k", now).has_value());
+    cache.store("k", makeResult("content"), 10s, now);
+
+    auto const hit = cache.lookup("k", now + 5s);
+    REQUIRE(hit.has_value());
+    CHECK(hit->content == "content");
+
+    CHECK_FALSE(cache.lookup("k", now + 10s).has_value());
+    CHECK(cache.size() == 0);
+    CHECK(cache.hits() == 1);
+    CHECK(cache.misses() == 2);
+}
+
+TEST_CASE("ToolResultCache: evicts the least recently used entry", "[agent][toolcache]")
+{
+    auto cache = ToolResultCache(2);
+    auto const now = ToolResultCache::Clock::now();
+
+    cache.store("a", makeResult("a"), 60s, now);
+    cache.store("b", makeResult("b"), 60s, now);
+    CHECK(cache.lookup("a", now).has_value()); // "b" is now least recently used.
+    cache.store("c", makeResult("c"), 60s, now);
+
+    CHECK(cache.size() == 2);
+    CHECK(cache.lookup("a", now).has_value());
+    CHECK_FALSE(cache.lookup("b", now).has_value());
+    CHECK(cache.lookup("c", now).has_value());
+}
+
+TEST_CASE("ToolResultCache: does not cache errors", "[agent][toolcache]")
+{
+    auto cache = ToolResultCache(2);
+    cache.store("k", makeResult("Error: boom", true), 60s);
+    CHECK(cache.size() == 0);
+}
+
+TEST_CASE("ToolResultCache: reclaims the least recently used entries", "[agent][toolcache]")
+{
+    auto cache = ToolResultCache(8);
+    auto const now = ToolResultCache::Clock::now();
+
+    cache.store("a", makeResult(std::string(100, 'a')), 60s, now);
+    cache.store("b", makeResult(std::string(100, 'b')), 60s, now);
+    cache.store("c", makeResult(std::string(100, 'c')), 60s, now);
+    auto const entryBytes = cache.bytes() / 3;
+    CHECK(entryBytes >= 100);
+
+    CHECK(cache.reclaim(entryBytes + 1) == 2 * entryBytes);
+    CHECK(cache.size() == 1);
+    CHECK(cache.bytes() == entryBytes);
+    CHECK(cache.lookup("c", now).has_value());
+
+    cache.clear();
+    CHECK(cache.bytes() == 0);
+    CHECK(cache.reclaim(1) == 0);
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/Trace.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto tracePath(std::string const& name) -> std::filesystem::path
+{
+    return std::filesystem::temp_directory_path() / ("mychat_test_" + name + ".json");
+}
+
+auto readTrace(std::filesystem::path const& path) -> nlohmann::json
+{
+    auto file = std::ifstream(path);
+    return nlohmann::json::parse(file);
+}
+
+/// @brief Returns the events of @p written named @p name.
+auto eventsNamed(nlohmann::json const& written, std::string const& name) -> std::vector<nlohmann::json>
+{
+    auto events = std::vector<nlohmann::json> {};
+    for (auto const& event: written["traceEvents"])
+        if (event["name"] == name)
+            events.push_back(event);
+    return events;
+}
+
+} // namespace
+
+TEST_CASE("Trace: zones of several threads are written as complete events", "[core][trace]")
+{
+    auto const path = tracePath("trace_threads");
+    if constexpr (!trace::CompiledIn)
+    {
+        CHECK_FALSE(trace::start(path).has_value());
+        return;
+    }
+
+    REQUIRE(trace::start(path).has_value());
+    {
+        auto const outer = trace::Zone("test", "outer", "detail");
+        auto const inner = trace::Zone("test", "inner");
+    }
+    std::jthread([] { auto const zone = trace::Zone("test", "worker"); }).join();
+    REQUIRE(trace::stop().has_value());
+
+    auto const written = readTrace(path);
+    auto const outer = eventsNamed(written, "outer");
+    auto const inner = eventsNamed(written, "inner");
+    auto const worker = eventsNamed(written, "worker");
+    REQUIRE(outer.size() == 1);
+    REQUIRE(inner.size() == 1);
+    REQUIRE(worker.size() == 1);
+
+    CHECK(outer[0]["ph"] == "X");
+    CHECK(outer[0]["cat"] == "test");
+    CHECK(outer[0]["args"]["detail"] == "detail");
+    CHECK_FALSE(inner[0].contains("args"));
+
+    // The inner zone lies within the outer one, on the same thread.
+    CHECK(inner[0]["tid"] == outer[0]["tid"]);
+    CHECK(inner[0]["ts"].get<double>() >= outer[0]["ts"].get<double>());
+    CHECK(inner[0]["ts"].get<double>() + inner[0]["dur"].get<double>()
+          <= outer[0]["ts"].get<double>() + outer[0]["dur"].get<double>());
+    CHECK(worker[0]["tid"] != outer[0]["tid"]);
+    CHECK(written["otherData"]["droppedZones"] == 0);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Trace: nothing is recorded outside of a trace", "[core][trace]")
+{
+    if constexpr (!trace::CompiledIn)
+        return;
+
+    CHECK_FALSE(trace::enabled());
+    {
+        auto const zone = trace::Zone("test", "untraced");
+    }
+
+    auto const path = tracePath("trace_restart");
+    REQUIRE(trace::start(path).has_value());
+    CHECK(trace::enabled());
+    auto const begin = trace::Clock::now();
+    auto const end = begin + std::chrono::milliseconds { 2 };
+    trace::recordZone("test", "measured", begin, end, "a detail longer than thirty-one bytes");
+    REQUIRE(trace::stop().has_value());
+    CHECK_FALSE(trace::enabled());
+
+    auto const written = readTrace(path);
+    CHECK(eventsNamed(written, "untraced").empty());
+    auto const measured = eventsNamed(written, "measured");
+    REQUIRE(measured.size() == 1);
+    CHECK(measured[0]["dur"].get<double>() == 2000.0);
+    CHECK(measured[0]["args"]["detail"] == "a detail longer than thirty-one");
+
+    // Stopping again has nothing left to write.
+    CHECK(trace::stop().has_value());
+    std::filesystem::remove(path);
+}
@@ -1,26 +1,47 @@
 // SPDX-License-Identifier: Apache-2.0
+#include <core/Base64.hpp>
 #include <core/Log.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
 #include <string>
 #include <thread>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include <tui/Box.hpp>
+#include <tui/Damage.hpp>
 #include <tui/Dialog.hpp>
+#include <tui/FrameScheduler.hpp>
+#include <tui/Image.hpp>
 #include <tui/InputEvent.hpp>
 #include <tui/InputField.hpp>
 #include <tui/KeyCode.hpp>
 #include <tui/List.hpp>
+#include <tui/MarkdownParser.hpp>
 #include <tui/MarkdownRenderer.hpp>
 #include <tui/Modifier.hpp>
+#include <tui/Screen.hpp>
+#include <tui/Scrollback.hpp>
 #include <tui/Sixel.hpp>
 #include <tui/Spinner.hpp>
 #include <tui/StatusBar.hpp>
+#include <tui/Style.hpp>
+#include <tui/TerminalGraphics.hpp>
 #include <tui/TerminalOutput.hpp>
 #include <tui/Text.hpp>
+#include <tui/TextBuffer.hpp>
 #include <tui/Theme.hpp>
 #include <tui/VtParser.hpp>
 
@@ -83,6 +104,13 @@ auto getPaste(InputEvent const& event) -> PasteEvent const&
     return std::get<PasteEvent>(event);
 }
 
+/// @brief Extracts a TextEvent from an InputEvent, or fails the test.
+auto getText(InputEvent const& event) -> TextEvent const&
+{
+    REQUIRE(std::holds_alternative<TextEvent>(event));
+    return std::get<TextEvent>(event);
+}
+
 /// @brief Feeds an event into an InputField, discarding the result.
 void feed(InputField& field, InputEvent const& event)
 {
@@ -162,10 +190,30 @@ TEST_CASE("VtParser: multiple ASCII characters", "[tui][vtparser]")
 {
     auto parser = VtParser {};
     auto events = parser.feed("hello");
+    REQUIRE(events.size() == 1);
+    CHECK(getText(events[0]).text == "hello");
+}
+
+TEST_CASE("VtParser: text runs between keys", "[tui][vtparser]")
+{
+    auto parser = VtParser {};
+    auto events = std::vector<InputEvent> {};
+    parser.feed("x", events);
+    parser.feed("caf\xC3\xA9 au lait\r\033[Ab", events);
     REQUIRE(events.size() == 5);
-    CHECK(getKey(events[0]).codepoint == 'h');
-    CHECK(getKey(events[1]).codepoint == 'e');
-    CHECK(getKey(events[4]).codepoint == 'o');
+    CHECK(getKey(events[0]).codepoint == 'x');
+    CHECK(getText(events[1]).text == "caf\xC3\xA9 au lait");
+    CHECK(getKey(events[2]).key == KeyCode::Enter);
+    CHECK(getKey(events[3]).key == KeyCode::Up);
+    CHECK(getKey(events[4]).codepoint == 'b');
+
+    // A UTF-8 sequence cut off at the end of a read ends the run and is completed by the next.
+    events.clear();
+    parser.feed("ab\xE4\xB8", events);
+    parser.feed("\xAD", events);
+    REQUIRE(events.size() == 2);
+    CHECK(getText(events[0]).text == "ab");
+    CHECK(getKey(events[1]).codepoint == U'\u4E2D');
 }
 
 TEST_CASE("VtParser: UTF-8 two-byte", "[tui][vtparser]")
@@ -451,6 +499,27 @@ TEST_CASE("VtParser: bracketed paste with newlines", "[tui][vtparser]")
     CHECK(getPaste(events[0]).text == "line1\nline2\nline3");
 }
 
+TEST_CASE("VtParser: large bracketed paste split across reads", "[tui][vtparser]")
+{
+    auto content = std::string {};
+    for (auto i = 0; i < 20000; ++i)
+        content += std::format("line {}\t\033[201 \033\033[20~\r\n", i);
+    auto const input = "\033[200~" + content + "\033[201~a";
+
+    // Every split point of the end sequence, and one inside the content
+    auto const end = input.size();
+    for (auto const cut: { end - 7, end - 5, end - 3, end - 2, std::size_t { 1000 } })
+    {
+        auto parser = VtParser {};
+        auto events = std::vector<InputEvent> {};
+        parser.feed(std::string_view(input).substr(0, cut), events);
+        parser.feed(std::string_view(input).substr(cut), events);
+        REQUIRE(events.size() == 2);
+        CHECK(getPaste(events[0]).text == content);
+        CHECK(getKey(events[1]).codepoint == 'a');
+    }
+}
+
 TEST_CASE("VtParser: bare ESC timeout", "[tui][vtparser]")
 {
     auto parser = VtParser {};
@@ -1024,6 +1093,371 @@ TEST_CASE("InputField: Ctrl+End goes to buffer end in multiline", "[tui][inputfi
     CHECK(field.cursor() == field.text().size());
 }
 
+TEST_CASE("InputField: editing a large paste", "[tui][inputfield][multiline]")
+{
+    auto field = InputField {};
+    field.setMultiline(true);
+
+    auto pasted = std::string {};
+    for (auto i = 0; i < 5000; ++i)
+        pasted += std::format("log line {}\r\n", i);
+    feed(field, PasteEvent { .text = pasted });
+    CHECK(field.lineCount() == 5001);
+    CHECK(field.cursorLine() == 5000);
+    CHECK(field.lineAt(4999) == "log line 4999\r");
+
+    // Backspace removes CR LF together, joining the last two lines.
+    feed(field, keyEvent(KeyCode::Backspace));
+    CHECK(field.lineCount() == 5000);
+    CHECK(field.cursorColumn() == 13);
+
+    feed(field, keyEvent(KeyCode::Home, Modifier::Ctrl));
+    type(field, "> ");
+    CHECK(field.lineAt(0) == "> log line 0\r");
+    CHECK(field.cursorColumn() == 2);
+
+    feed(field, keyEvent(KeyCode::Down));
+    CHECK(field.cursorLine() == 1);
+    CHECK(field.cursorColumn() == 2);
+    CHECK(field.cursorLineOffset() == 2);
+    CHECK(field.text().substr(0, 28) == "> log line 0\r\nlog line 1\r\nlo");
+}
+
+// =============================================================================
+// TextBuffer tests
+// =============================================================================
+
+TEST_CASE("TextBuffer: edits and line index match the plain text", "[tui][textbuffer]")
+{
+    auto buffer = TextBuffer {};
+    auto expected = std::string {};
+
+    auto const check = [&] {
+        REQUIRE(buffer.size() == expected.size());
+        auto lines = std::vector<std::string> {};
+        for (auto start = std::size_t { 0 };;)
+        {
+            auto const end = expected.find('\n', start);
+            lines.push_back(expected.substr(start, end - start));
+            if (end == std::string::npos)
+                break;
+            start = end + 1;
+        }
+        REQUIRE(buffer.lineCount() == lines.size());
+        for (auto i = std::size_t { 0 }; i < lines.size(); ++i)
+            CHECK(buffer.line(i) == lines[i]);
+        for (auto pos = std::size_t { 0 }; pos <= expected.size(); ++pos)
+        {
+            auto const newlines = std::ranges::count(expected.substr(0, pos), '\n');
+            CHECK(buffer.lineOf(pos) == static_cast<std::size_t>(newlines));
+        }
+        auto const from = std::min<std::size_t>(3, expected.size());
+        CHECK(buffer.substr(from, 7) == expected.substr(from, 7));
+        CHECK(buffer.text() == expected);
+    };
+
+    // Edits at spots jumping back and forth move the gap across lines both ways.
+    auto const insert = [&](std::size_t pos, std::string_view text) {
+        buffer.insert(pos, text);
+        expected.insert(pos, text);
+    };
+    auto const erase = [&](std::size_t pos, std::size_t count) {
+        buffer.erase(pos, count);
+        expected.erase(pos, count);
+    };
+
+    insert(0, "first\nsecond\nthird");
+    check();
+    insert(6, "new\n");
+    insert(2, "\n\n");
+    insert(expected.size(), "\nlast");
+    check();
+    erase(1, 4);
+    erase(10, 8);
+    check();
+    insert(3, std::string(200, 'x') + "\n");
+    erase(0, 2);
+    check();
+
+    buffer.assign("a\nb");
+    expected = "a\nb";
+    check();
+    buffer.clear();
+    expected.clear();
+    check();
+}
+
+// =============================================================================
+// Style tests
+// =============================================================================
+
+TEST_CASE("appendSgr: encodes all attributes", "[tui][style]")
+{
+    auto style = Style {};
+    style.bold = true;
+    style.underline = true;
+    style.fg = static_cast<std::uint8_t>(4);
+    style.bg = RgbColor { .r = 1, .g = 2, .b = 3 };
+
+    auto out = std::string {};
+    appendSgr(out, style);
+    CHECK(out == "\033[1;4;38;5;4;48;2;1;2;3m");
+
+    out.clear();
+    appendSgr(out, Style {});
+    CHECK(out.empty());
+}
+
+TEST_CASE("appendSgrTransition: changes only what differs", "[tui][style]")
+{
+    auto const transition = [](Style const& from, Style const& to) {
+        auto out = std::string {};
+        appendSgrTransition(out, from, to);
+        return out;
+    };
+
+    auto bold = Style {};
+    bold.bold = true;
+    auto boldRed = bold;
+    boldRed.fg = static_cast<std::uint8_t>(1);
+    auto italicRed = Style {};
+    italicRed.italic = true;
+    italicRed.fg = static_cast<std::uint8_t>(1);
+
+    CHECK(transition(bold, bold).empty());
+    CHECK(transition(bold, Style {}) == "\033[m");
+    CHECK(transition(Style {}, bold) == "\033[1m");
+    CHECK(transition(bold, boldRed) == "\033[38;5;1m");
+    CHECK(transition(boldRed, bold) == "\033[39m");
+    CHECK(transition(boldRed, italicRed) == "\033[22;3m");
+
+    // Resetting is shorter than turning off many attributes one by one.
+    auto busy = Style {};
+    busy.italic = true;
+    busy.underline = true;
+    busy.strikethrough = true;
+    busy.fg = RgbColor { .r = 10, .g = 20, .b = 30 };
+    CHECK(transition(busy, bold) == "\033[0;1m");
+}
+
+TEST_CASE("StyleTable: returns the transition", "[tui][style]")
+{
+    auto table = StyleTable {};
+    auto bold = Style {};
+    bold.bold = true;
+    auto const boldId = table.intern(bold);
+    CHECK(table.intern(Style {}) == DefaultStyleId);
+    CHECK(table.intern(bold) == boldId);
+    CHECK(table.sgr(boldId) == "\033[1m");
+    CHECK(table.transition(DefaultStyleId, boldId) == "\033[1m");
+    CHECK(table.transition(boldId, DefaultStyleId) == "\033[m");
+    CHECK(table.transition(boldId, boldId).empty());
+
+    // Remembering many transitions keeps them correct.
+    for (auto i = 0; i < 100; ++i)
+    {
+        auto style = Style {};
+        style.fg = static_cast<std::uint8_t>(i);
+        auto const id = table.intern(style);
+        CHECK(table.transition(DefaultStyleId, id) == std::format("\033[38;5;{}m", i));
+        CHECK(table.transition(boldId, id) == std::format("\033[0;38;5;{}m", i));
+    }
+    CHECK(table.size() == 102);
+    CHECK(table.transition(DefaultStyleId, boldId) == "\033[1m");
+}
+
+TEST_CASE("PackedStyle: round-trips styles in 8 bytes", "[tui][style]")
+{
+    static_assert(sizeof(PackedStyle) == 8);
+
+    auto style = Style {};
+    style.fg = RgbColor { .r = 1, .g = 2, .b = 3 };
+    style.bg = std::uint8_t { 200 };
+    style.italic = true;
+    style.inverse = true;
+    CHECK(PackedStyle(style).unpack() == style);
+    CHECK(PackedStyle(Style {}).unpack() == Style {});
+    CHECK(PackedStyle(Style {}).bits() == 0);
+
+    auto other = style;
+    other.dim = true;
+    CHECK(PackedStyle(other) != PackedStyle(style));
+    other = style;
+    other.bg = RgbColor { .r = 0, .g = 0, .b = 200 };
+    CHECK(PackedStyle(other) != PackedStyle(style));
+}
+
+// =============================================================================
+// Screen tests
+// =============================================================================
+
+namespace
+{
+/// @brief Creates a screen whose terminal is known to be blank.
+auto blankScreen(int rows, int cols) -> Screen
+{
+    auto screen = Screen {};
+    screen.resize(rows, cols);
+    screen.clear();
+    return screen;
+}
+
+auto diffOf(Screen& screen) -> std::string
+{
+    auto out = std::string {};
+    screen.diff(out);
+    return out;
+}
+} // namespace
+
+TEST_CASE("Screen: draws changed cells only", "[tui][screen]")
+{
+    auto screen = blankScreen(3, 10);
+    screen.moveTo(2, 3);
+    screen.write("ab");
+    CHECK(diffOf(screen) == "\033[2;3Hab");
+    CHECK(screen.cell(2, 3).text == "a");
+
+    // Redrawing the same contents emits nothing.
+    screen.moveTo(2, 1);
+    screen.write("  ab");
+    CHECK(diffOf(screen).empty());
+
+    screen.moveTo(2, 3);
+    screen.write("ac");
+    CHECK(diffOf(screen) == "\033[2;4Hc");
+}
+
+TEST_CASE("Screen: bridges short gaps and moves over long ones", "[tui][screen]")
+{
+    auto screen = blankScreen(1, 20);
+    screen.moveTo(1, 1);
+    screen.write("abcdefghij");
+    static_cast<void>(diffOf(screen));
+
+    screen.moveTo(1, 1);
+    screen.write("Xbc" "Yefghij" "Z");
+    CHECK(diffOf(screen) == "\033[1HXbcY\033[6CZ");
+}
+
+TEST_CASE("Screen: unknown cells are drawn even if blank", "[tui][screen]")
+{
+    auto screen = Screen {};
+    screen.resize(2, 4);
+    screen.moveTo(1, 1);
+    screen.clearLine();
+    CHECK(diffOf(screen) == "\033[1H    ");
+
+    screen.moveTo(1, 1);
+    screen.clearLine();
+    CHECK(diffOf(screen).empty());
+
+    screen.invalidate(1, 1);
+    screen.moveTo(1, 1);
+    screen.write("ab");
+    CHECK(diffOf(screen) == "\033[1Hab");
+}
+
+TEST_CASE("Screen: cells not drawn are left alone", "[tui][screen]")
+{
+    auto screen = Screen {};
+    screen.resize(3, 4);
+    screen.moveTo(3, 1);
+    screen.write("ok");
+    // Rows 1 and 2 are unknown but not drawn, like a scrolling region the screen does not manage.
+    CHECK(diffOf(screen) == "\033[3Hok");
+}
+
+TEST_CASE("Screen: styles are switched and reset", "[tui][screen]")
+{
+    auto screen = blankScreen(1, 10);
+    auto bold = Style {};
+    bold.bold = true;
+    screen.moveTo(1, 1);
+    screen.write("a", bold);
+    screen.write("b");
+    CHECK(diffOf(screen) == "\033[1H\033[1ma\033[mb");
+
+    screen.moveTo(1, 5);
+    screen.write("cd", bold);
+    CHECK(diffOf(screen) == "\033[1;5H\033[1mcd\033[m");
+}
+
+TEST_CASE("Screen: wide characters take two cells", "[tui][screen]")
+{
+    auto screen = blankScreen(1, 6);
+    screen.moveTo(1, 1);
+    screen.write("\u4E16x");
+    CHECK(screen.cell(1, 1).width == 2);
+    CHECK(screen.cell(1, 2).width == 0);
+    CHECK(screen.cell(1, 3).text == "x");
+    CHECK(diffOf(screen) == "\033[1H\u4E16x");
+
+    // Overwriting the right half erases the left half.
+    screen.moveTo(1, 2);
+    screen.write("y");
+    CHECK(screen.cell(1, 1).text == " ");
+    CHECK(diffOf(screen) == "\033[1H y");
+
+    // A wide character does not fit into the last column.
+    screen.moveTo(1, 6);
+    screen.write("\u4E16");
+    CHECK(screen.cell(1, 6).text == " ");
+}
+
+TEST_CASE("Screen: combining marks join the previous cell", "[tui][screen]")
+{
+    auto screen = blankScreen(1, 4);
+    screen.moveTo(1, 1);
+    screen.write("e\u0301x");
+    CHECK(screen.cell(1, 1).text == "e\u0301");
+    CHECK(screen.cell(1, 2).text == "x");
+}
+
+TEST_CASE("Screen: an emoji sequence fills one wide cell", "[tui][screen]")
+{
+    auto screen = blankScreen(1, 4);
+    screen.moveTo(1, 1);
+    screen.write("\U0001F468\u200D\U0001F469\u200D\U0001F467x");
+    CHECK(screen.cell(1, 1).text == "\U0001F468\u200D\U0001F469\u200D\U0001F467");
+    CHECK(screen.cell(1, 1).width == 2);
+    CHECK(screen.cell(1, 2).width == 0);
+    CHECK(screen.cell(1, 3).text == "x");
+}
+
+TEST_CASE("Screen: clips at the edges", "[tui][screen]")
+{
+    auto screen = blankScreen(2, 3);
+    screen.moveTo(1, 2);
+    screen.write("abcd");
+    screen.moveTo(5, 1);
+    screen.write("off screen");
+    CHECK(screen.cell(1, 3).text == "b");
+    CHECK(diffOf(screen) == "\033[1;2Hab");
+}
+
+TEST_CASE("Screen: a keystroke redraw is much smaller than a full one", "[tui][screen]")
+{
+    auto screen = Screen {};
+    screen.resize(5, 80);
+    auto const drawLine = [&](std::string_view text) {
+        screen.moveTo(3, 1);
+        screen.write("\u2502 ");
+        screen.write(text);
+        screen.clearToEndOfLine();
+        screen.moveTo(3, 80);
+        screen.write("\u2502");
+    };
+
+    // The first frame draws the whole line, as every frame did without a screen.
+    drawLine("Hello, worl");
+    auto const full = diffOf(screen);
+    drawLine("Hello, world");
+    auto const keystroke = diffOf(screen);
+    CHECK(keystroke == "\033[3;14Hd");
+    CHECK(keystroke.size() * 10 < full.size());
+}
+
 // =============================================================================
 // TerminalOutput tests (non-interactive, buffer inspection)
 // =============================================================================
@@ -1050,6 +1484,32 @@ TEST_CASE("TerminalOutput: dimensions default", "[tui][output]")
     CHECK(output.rows() > 0);
 }
 
+TEST_CASE("FrameScheduler: flushes at most once per interval", "[tui][frames]")
+{
+    using namespace std::chrono_literals;
+
+    auto output = TerminalOutput {};
+    auto frames = FrameScheduler(output, 10ms);
+    auto const start = FrameScheduler::Clock::now();
+
+    // Nothing pending: nothing to flush, and no reason to wake up early.
+    CHECK_FALSE(frames.flushIfDue(start));
+    CHECK(frames.timeout(16ms, start) == 16ms);
+
+    // The first frame after a quiet period goes out right away.
+    output.writeRaw("a");
+    CHECK(frames.flushIfDue(start));
+    CHECK_FALSE(output.hasPendingOutput());
+
+    // Output within the interval waits for it to pass.
+    output.writeRaw("b");
+    CHECK_FALSE(frames.flushIfDue(start + 4ms));
+    CHECK(output.hasPendingOutput());
+    CHECK(frames.timeout(16ms, start + 4ms) == 6ms);
+    CHECK(frames.flushIfDue(start + 10ms));
+    CHECK_FALSE(output.hasPendingOutput());
+}
+
 // =============================================================================
 // MarkdownRenderer tests
 // =============================================================================
@@ -1141,6 +1601,118 @@ TEST_CASE("MarkdownRenderer: default theme is valid", "[tui][markdown]")
     CHECK(theme.italic.italic);
 }
 
+// =============================================================================
+// MarkdownParser tests
+// =============================================================================
+
+namespace
+{
+/// @brief Parses @p pieces in turn and returns the spans, each wrapped in a tag naming its kind.
+///
+/// Adjacent spans of the same kind are merged, as they render the same.
+auto parseMarkdown(std::vector<std::string_view> const& pieces) -> std::string
+{
+    auto spans = std::vector<std::pair<MarkdownSpan, std::string>> {};
+    auto const sink = MarkdownParser::Sink([&](MarkdownSpan kind, std::string_view text) {
+        if (!spans.empty() && spans.back().first == kind)
+            spans.back().second += text;
+        else
+            spans.emplace_back(kind, std::string(text));
+    });
+    auto parser = MarkdownParser {};
+    for (auto const piece: pieces)
+        parser.feed(piece, sink);
+    parser.finish(sink);
+
+    static constexpr auto Names =
+        std::array { "", "h1", "h2", "h3", "pre", "code", "b", "i", "a", "li", "quote", "think", "" };
+    auto out = std::string {};
+    for (auto const& [kind, text]: spans)
+    {
+        auto const name = std::string_view(Names[static_cast<std::size_t>(kind)]);
+        out += name.empty() ? text : std::format("<{}>{}</{}>", name, text, name);
+    }
+    return out;
+}
+
+/// @brief Parses @p markdown one character at a time.
+auto parseMarkdownByChar(std::string_view markdown) -> std::string
+{
+    auto pieces = std::vector<std::string_view> {};
+    for (auto i = std::size_t { 0 }; i < markdown.size(); ++i)
+        pieces.push_back(markdown.substr(i, 1));
+    return parseMarkdown(pieces);
+}
+} // namespace
+
+TEST_CASE("MarkdownParser: block types", "[tui][markdown]")
+{
+    CHECK(parseMarkdown({ "# One\n## Two\n#### Four\n#nope\n" })
+          == "<h1>One</h1>\n<h2>Two</h2>\n<h3>Four</h3>\n#nope\n");
+    CHECK(parseMarkdown({ "- a\n  2. b\n> c\n>d\n" })
+          == "<li>- </li>a\n<li>  2. </li>b\n<quote>> </quote>c\n<quote>></quote>d\n");
+    CHECK(parseMarkdown({ "```cpp\nint *p;\n  ```\nafter\n" }) == "<pre>int *p;</pre>\nafter\n");
+    CHECK(parseMarkdown({ "~~~~\n```\n~~~~\n" }) == "<pre>```</pre>\n");
+    CHECK(parseMarkdown({ "a\n\nb" }) == "a\n\nb\n");
+}
+
+TEST_CASE("MarkdownParser: inline spans", "[tui][markdown]")
+{
+    CHECK(parseMarkdown({ "x **b** *i* __u__ `c` [l](u) y\n" })
+          == "x <b>b</b> <i>i</i> <b>u</b> <code>c</code> <a>l</a> y\n");
+    CHECK(parseMarkdown({ "a_b [x] [y](z" }) == "a_b [x] [y](z\n");
+    CHECK(parseMarkdown({ "`open *it*\n" }) == "`open <i>it</i>\n");
+}
+
+TEST_CASE("MarkdownParser: think blocks", "[tui][markdown]")
+{
+    CHECK(parseMarkdown({ "<think>\nhmm\n</think>\nAnswer\n" }) == "<think>hmm</think>\nAnswer\n");
+    CHECK(parseMarkdown({ "<think>hmm</think>Answer" }) == "<think>hmm</think>Answer\n");
+    CHECK(parseMarkdown({ "a <b> <thin\n" }) == "a <b> <thin\n");
+    CHECK(parseMarkdown({ "```\n<think>\n```\n" }) == "<pre><think></pre>\n");
+}
+
+TEST_CASE("MarkdownParser: output does not depend on how the text is split", "[tui][markdown]")
+{
+    auto const markdown = std::string_view { "<think>\nplan\n</think>\n# Title\n\nSome **bold**, *it*, "
+                                             "`x` and [a](b).\n- item `unclosed\n1. **two\n"
+                                             "```\ncode *not*\n```\n> end" };
+    auto const whole = parseMarkdown({ markdown });
+    CHECK(parseMarkdownByChar(markdown) == whole);
+    for (auto split = std::size_t { 1 }; split < markdown.size(); ++split)
+        CHECK(parseMarkdown({ markdown.substr(0, split), markdown.substr(split) }) == whole);
+}
+
+TEST_CASE("MarkdownParser: text is emitted before its line ends", "[tui][markdown]")
+{
+    auto spans = std::vector<std::pair<MarkdownSpan, std::string>> {};
+    auto const sink = MarkdownParser::Sink([&](MarkdownSpan kind, std::string_view text) {
+        spans.emplace_back(kind, std::string(text));
+    });
+    auto parser = MarkdownParser {};
+
+    parser.feed("Hello wor", sink);
+    REQUIRE(spans.size() == 1);
+    CHECK(spans[0] == std::pair { MarkdownSpan::Text, std::string("Hello wor") });
+    CHECK(parser.midLine());
+
+    // An open span is held back until it closes.
+    parser.feed("ld **bo", sink);
+    CHECK(spans.back().second == "ld ");
+    parser.feed("ld** ", sink);
+    CHECK(spans[spans.size() - 2] == std::pair { MarkdownSpan::Bold, std::string("bold") });
+    CHECK(spans.back() == std::pair { MarkdownSpan::Text, std::string(" ") });
+
+    // A heading streams as soon as its marker is complete.
+    parser.feed("\n## Ti", sink);
+    CHECK(spans.back() == std::pair { MarkdownSpan::Heading2, std::string("Ti") });
+    CHECK(parser.midLine());
+
+    parser.finish(sink);
+    CHECK(spans.back() == std::pair { MarkdownSpan::LineBreak, std::string("\n") });
+    CHECK_FALSE(parser.midLine());
+}
+
 // =============================================================================
 // Sixel tests
 // =============================================================================
@@ -1204,6 +1776,259 @@ TEST_CASE("Sixel: single color image", "[tui][sixel]")
     CHECK_FALSE(result->empty());
 }
 
+TEST_CASE("Sixel: quantizes to the given number of colors", "[tui][sixel]")
+{
+    // A gradient of 64 distinct colors.
+    auto pixels = std::vector<std::uint8_t> {};
+    for (auto i = 0; i < 64; ++i)
+    {
+        auto const red = static_cast<std::uint8_t>(i * 4);
+        pixels.insert(pixels.end(), { red, 0, static_cast<std::uint8_t>(255 - red), 255 });
+    }
+    auto const image = ImageData {
+        .pixels = std::span<const std::uint8_t>(pixels),
+        .width = 64,
+        .height = 1,
+    };
+
+    auto const palette = SixelPalette::quantize(image, 8);
+    CHECK(palette.size() == 8);
+
+    auto const exact = SixelPalette::quantize(image, 256);
+    CHECK(exact.size() == 32); // Red and blue fall into 32 histogram cells each, together.
+    CHECK(palette.averageError(image) > exact.averageError(image));
+}
+
+TEST_CASE("Sixel: nearest palette color", "[tui][sixel]")
+{
+    auto colors = std::vector<SixelColor> {};
+    for (auto i = 0; i < 13; ++i)
+        colors.push_back(SixelColor { .r = static_cast<std::uint8_t>(i * 20), .g = 0, .b = 0 });
+    colors.push_back(SixelColor { .r = 0, .g = 0, .b = 0 }); // Duplicate of the first.
+    auto const palette = SixelPalette(colors);
+
+    CHECK(palette.nearest({ .r = 0, .g = 0, .b = 0 }) == 0);
+    CHECK(palette.nearest({ .r = 29, .g = 0, .b = 0 }) == 1);
+    CHECK(palette.nearest({ .r = 175, .g = 10, .b = 0 }) == 9);
+    CHECK(palette.nearest({ .r = 255, .g = 255, .b = 255 }) == 12);
+}
+
+TEST_CASE("Sixel: reuses a palette and encodes large images in bands", "[tui][sixel]")
+{
+    auto const width = 40;
+    auto const height = 600; // 100 bands, enough for several threads.
+    auto pixels = std::vector<std::uint8_t>(static_cast<std::size_t>(width * height * 4));
+    for (auto y = 0; y < height; ++y)
+    {
+        for (auto x = 0; x < width; ++x)
+        {
+            auto* pixel = pixels.data() + (y * width + x) * 4;
+            pixel[0] = (x < width / 2) ? 255 : 0;
+            pixel[1] = static_cast<std::uint8_t>(y % 256);
+            pixel[2] = 0;
+            pixel[3] = 255;
+        }
+    }
+    auto const image = ImageData {
+        .pixels = std::span<const std::uint8_t>(pixels),
+        .width = width,
+        .height = height,
+    };
+
+    auto const palette = SixelPalette::quantize(image, 16);
+    auto const result = encodeSixel(image, palette);
+    REQUIRE(result.has_value());
+    CHECK(std::ranges::count(*result, '-') == height / 6);
+    CHECK(*result == encodeSixel(image, 16).value());
+
+    auto const empty = encodeSixel(image, SixelPalette {});
+    REQUIRE_FALSE(empty.has_value());
+    CHECK(empty.error().code == mychat::ErrorCode::InvalidArgument);
+}
+
+TEST_CASE("Sixel: repeats runs of equal sixels", "[tui][sixel]")
+{
+    auto pixels = std::vector<std::uint8_t> {};
+    for (auto i = 0; i < 10; ++i)
+        pixels.insert(pixels.end(), { 255, 255, 255, 255 });
+    auto const image = ImageData {
+        .pixels = std::span<const std::uint8_t>(pixels),
+        .width = 10,
+        .height = 1,
+    };
+
+    auto const result = encodeSixel(image, 1);
+    REQUIRE(result.has_value());
+    CHECK(*result == "#0;2;100;100;100#0!10@$-");
+}
+
+// =============================================================================
+// Terminal graphics tests
+// =============================================================================
+
+namespace
+{
+
+auto noiseImage(int width, int height) -> std::vector<std::uint8_t>
+{
+    auto pixels = std::vector<std::uint8_t>(static_cast<std::size_t>(width * height * 4));
+    auto state = std::uint32_t { 12345 };
+    for (auto& byte: pixels)
+    {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<std::uint8_t>(state >> 24);
+    }
+    return pixels;
+}
+
+} // namespace
+
+TEST_CASE("TerminalGraphics: detects the image protocol from the environment", "[tui][graphics]")
+{
+    auto const detect = [](std::map<std::string, std::string> const& env) {
+        return detectImageCapabilities([&](char const* name) -> char const* {
+            auto const it = env.find(name);
+            return it != env.end() ? it->second.c_str() : nullptr;
+        });
+    };
+
+    auto const plain = detect({ { "TERM", "xterm-256color" } });
+    CHECK(plain.protocol == ImageProtocol::Sixel);
+    CHECK(plain.local);
+
+    CHECK(detect({ { "TERM", "xterm-kitty" } }).protocol == ImageProtocol::Kitty);
+    CHECK(detect({ { "KITTY_WINDOW_ID", "1" } }).protocol == ImageProtocol::Kitty);
+    CHECK(detect({ { "TERM_PROGRAM", "iTerm.app" } }).protocol == ImageProtocol::ITerm2);
+
+    auto const remote = detect({
+        { "LC_TERMINAL", "iTerm2" },
+        { "SSH_CONNECTION", "10.0.0.1 22 10.0.0.2 22" },
+    });
+    CHECK(remote.protocol == ImageProtocol::ITerm2);
+    CHECK_FALSE(remote.local);
+}
+
+TEST_CASE("TerminalGraphics: kitty image is sent in chunks", "[tui][graphics]")
+{
+    // Noise does not compress, so it takes several chunks.
+    auto const pixels = noiseImage(64, 64);
+    auto const image = ImageData { .pixels = pixels, .width = 64, .height = 64 };
+
+    auto const sequence = encodeKittyImage(image);
+    REQUIRE(sequence.has_value());
+    REQUIRE(sequence->starts_with("\033_Ga=T,f=32,s=64,v=64,o=z,q=2,m=1;"));
+
+    auto payload = std::string {};
+    auto chunks = 0;
+    auto lastMore = '1';
+    for (auto pos = std::size_t { 0 }; pos < sequence->size();)
+    {
+        auto const end = sequence->find("\033\\", pos);
+        REQUIRE(end != std::string::npos);
+        auto const command = std::string_view(*sequence).substr(pos, end - pos);
+        auto const separator = command.find(';');
+        REQUIRE(separator != std::string_view::npos);
+        auto const data = command.substr(separator + 1);
+        CHECK(data.size() <= 4096);
+        lastMore = command[separator - 1];
+        payload += data;
+        ++chunks;
+        pos = end + 2;
+    }
+    CHECK(chunks > 1);
+    CHECK(lastMore == '0');
+
+    auto const compressed = mychat::decodeBase64(payload);
+    REQUIRE(compressed.has_value());
+    CHECK(compressed->front() == 0x78); // zlib header
+}
+
+TEST_CASE("TerminalGraphics: kitty image passed in a temporary file", "[tui][graphics]")
+{
+    auto const pixels = noiseImage(3, 2);
+    auto const image = ImageData { .pixels = pixels, .width = 3, .height = 2 };
+
+    auto const path = shareKittyImage(image, KittyMedium::TempFile);
+    REQUIRE(path.has_value());
+    CHECK(path->find("tty-graphics-protocol") != std::string::npos);
+    {
+        auto file = std::ifstream(*path, std::ios::binary);
+        auto const contents = std::vector<std::uint8_t>(std::istreambuf_iterator<char>(file), {});
+        CHECK(contents == pixels);
+    }
+    std::filesystem::remove(*path);
+
+    auto const sequence = encodeKittyImageReference(image, KittyMedium::SharedMemory, "/img");
+    CHECK(sequence == "\033_Ga=T,f=32,s=3,v=2,t=s,q=2;L2ltZw==\033\\");
+}
+
+TEST_CASE("TerminalGraphics: PNG and iTerm2 inline image", "[tui][graphics]")
+{
+    auto const pixels = noiseImage(5, 3);
+    auto const image = ImageData { .pixels = pixels, .width = 5, .height = 3 };
+
+    auto const png = encodePng(image);
+    REQUIRE(png.has_value());
+    auto const signature = std::vector<std::uint8_t> { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    CHECK(std::equal(signature.begin(), signature.end(), png->begin()));
+    // IHDR: length 13, type, width 5, height 3, 8-bit RGBA
+    auto const ihdr =
+        std::vector<std::uint8_t> { 0, 0, 0, 13, 'I', 'H', 'D', 'R', 0, 0, 0, 5, 0, 0, 0, 3, 8, 6 };
+    CHECK(std::equal(ihdr.begin(), ihdr.end(), png->begin() + 8));
+
+    auto const sequence = encodeITerm2Image(image);
+    REQUIRE(sequence.has_value());
+    auto const header = std::format("\033]1337;File=inline=1;size={};width=5px;height=3px;", png->size());
+    CHECK(sequence->starts_with(header));
+    CHECK(sequence->ends_with("\a"));
+
+    auto const invalid = ImageData { .pixels = pixels, .width = 50, .height = 30 };
+    CHECK_FALSE(encodePng(invalid).has_value());
+    CHECK_FALSE(encodeKittyImage(invalid).has_value());
+}
+
+TEST_CASE("Image: decodes a PNG to RGBA", "[tui][image]")
+{
+    // A 2x1 RGBA PNG with a red and a blue pixel.
+    auto const png = std::vector<std::uint8_t> {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44,
+        0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0xf4,
+        0x22, 0x7f, 0x8a, 0x00, 0x00, 0x00, 0x0e, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0xf8,
+        0xcf, 0xc0, 0x00, 0x42, 0xff, 0x01, 0x0f, 0xf9, 0x03, 0xfd, 0x85, 0x11, 0x99, 0x76, 0x00,
+        0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+    };
+    auto const image = decodeImage(png);
+    REQUIRE(image.has_value());
+    CHECK(image->width == 2);
+    CHECK(image->height == 1);
+    CHECK(image->pixels == std::vector<std::uint8_t> { 255, 0, 0, 255, 0, 0, 255, 255 });
+}
+
+TEST_CASE("Image: rejects data that is no image", "[tui][image]")
+{
+    auto const bytes = std::vector<std::uint8_t> { 'n', 'o', 'p', 'e' };
+    CHECK_FALSE(decodeImage(bytes).has_value());
+}
+
+TEST_CASE("Image: fitImage averages pixels when shrinking", "[tui][image]")
+{
+    auto const pixels = std::vector<std::uint8_t> {
+        200, 0, 0, 255, 100, 0, 0, 255, // first row
+        0, 200, 0, 255, 0, 100, 0, 255, // second row
+    };
+    auto const image = ImageData { .pixels = pixels, .width = 2, .height = 2 };
+
+    auto const shrunk = fitImage(image, 1, 10);
+    CHECK(shrunk.width == 1);
+    CHECK(shrunk.height == 1);
+    CHECK(shrunk.pixels == std::vector<std::uint8_t> { 75, 75, 0, 255 });
+
+    auto const unchanged = fitImage(image, 4, 4);
+    CHECK(unchanged.width == 2);
+    CHECK(unchanged.height == 2);
+    CHECK(unchanged.pixels == pixels);
+}
+
 // =============================================================================
 // LogPanel tests
 // =============================================================================
@@ -1265,6 +2090,53 @@ TEST_CASE("LogPanel: MaxEntries eviction", "[tui][logpanel]")
     CHECK(panel.entryCount() == static_cast<std::size_t>(LogPanel::MaxEntries));
 }
 
+TEST_CASE("LogPanel: damage covers the rows a change affects", "[tui][logpanel]")
+{
+    auto output = TerminalOutput {};
+    auto panel = LogPanel {};
+    panel.render(output, 20, 40);
+    CHECK(!panel.damage().dirty());
+
+    // Collapsed, a new message only changes the count in the header.
+    panel.addLog(LogLevel::Info, "one");
+    CHECK(!panel.damage().all());
+    CHECK(panel.damage().region() == Rect { .row = 0, .col = 0, .width = 40, .height = 1 });
+    panel.renderDamage(output, 20, 40);
+    CHECK(!panel.damage().dirty());
+
+    panel.toggle();
+    CHECK(panel.damage().all());
+    panel.renderDamage(output, 20, 40);
+
+    for (auto i = 0; i < LogPanel::MaxVisibleExpanded + 2; ++i)
+        panel.addLog(LogLevel::Info, std::format("message {}", i));
+    panel.render(output, 20, 40);
+
+    auto const version = panel.damage().version();
+    panel.scrollDown(); // at the bottom already
+    CHECK(panel.damage().version() == version);
+    panel.scrollUp();
+    CHECK(panel.damage().region()
+          == Rect { .row = 1, .col = 0, .width = 40, .height = LogPanel::MaxVisibleExpanded });
+}
+
+TEST_CASE("Damage: unites the changed regions", "[tui][damage]")
+{
+    auto damage = Damage {};
+    damage.add(Rect { .row = 0, .col = 2, .width = 1, .height = 1 });
+    damage.add(Rect { .row = 1, .col = 0, .width = 2, .height = 2 });
+    CHECK(damage.version() == 2);
+    CHECK(damage.region() == Rect { .row = 0, .col = 0, .width = 3, .height = 3 });
+    CHECK(!damage.all());
+
+    damage.clear();
+    CHECK(!damage.dirty());
+    CHECK(damage.version() == 2);
+
+    damage.add(Rect {}); // cells not known yet
+    CHECK(damage.all());
+}
+
 TEST_CASE("LogPanel: handleClick on header row toggles", "[tui][logpanel]")
 {
     auto panel = LogPanel {};
@@ -1387,31 +2259,161 @@ TEST_CASE("log::setCallback(nullptr): reverts to stderr without crash", "[core][
     mychat::log::info("this goes to stderr");
 }
 
+TEST_CASE("log: formats long messages and skips disabled levels", "[core][log]")
+{
+    auto received = std::vector<std::string> {};
+    mychat::log::setCallback([&](mychat::log::Level, std::string_view message) {
+        received.emplace_back(message);
+    });
+
+    auto const longText = std::string(1000, 'x');
+    mychat::log::info("long {} end", longText);
+    mychat::log::debug("not at the default level {}", 1);
+    CHECK_FALSE(mychat::log::enabled(mychat::log::Level::Debug));
+
+    mychat::log::setLevel(mychat::log::Level::Debug);
+    mychat::log::debug("now {}", 2);
+    mychat::log::setLevel(mychat::log::Level::Info);
+    mychat::log::setCallback(nullptr);
+
+    REQUIRE(received.size() == 2);
+    CHECK(received[0] == "long " + longText + " end");
+    CHECK(received[1] == "now 2");
+}
+
+namespace
+{
+    auto readLines(std::filesystem::path const& path) -> std::vector<std::string>
+    {
+        auto lines = std::vector<std::string> {};
+        auto file = std::ifstream(path);
+        for (auto line = std::string {}; std::getline(file, line);)
+            lines.push_back(line);
+        return lines;
+    }
+} // namespace
+
+TEST_CASE("log::openFileSink: writes text and JSON lines from a background thread", "[core][log]")
+{
+    auto const directory = std::filesystem::temp_directory_path() / "mychat_test_log_file";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    mychat::log::setCallback([](mychat::log::Level, std::string_view) {});
+
+    REQUIRE(mychat::log::openFileSink({ .path = directory / "text.log" }));
+    mychat::log::warning("disk {} full", 97);
+    mychat::log::closeFileSink();
+
+    auto const text = readLines(directory / "text.log");
+    REQUIRE(text.size() == 1);
+    CHECK(text[0].contains("Z [WARN ] [t"));
+    CHECK(text[0].ends_with("] disk 97 full"));
+
+    REQUIRE(mychat::log::openFileSink(
+        { .path = directory / "json.log", .format = mychat::log::FileFormat::JsonLines }));
+    mychat::log::error("say \"hi\"\n");
+    mychat::log::closeFileSink();
+    mychat::log::setCallback(nullptr);
+
+    auto const json = readLines(directory / "json.log");
+    REQUIRE(json.size() == 1);
+    auto const object = nlohmann::json::parse(json[0]);
+    CHECK(object["level"] == "error");
+    CHECK(object["thread"].get<int>() > 0);
+    CHECK(object["msg"] == "say \"hi\"\n");
+    CHECK(object["ts"].get<std::string>().ends_with("Z"));
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("log::openFileSink: rotates the file and keeps the newest ones", "[core][log]")
+{
+    auto const directory = std::filesystem::temp_directory_path() / "mychat_test_log_rotation";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    mychat::log::setCallback([](mychat::log::Level, std::string_view) {});
+
+    auto const path = directory / "mychat.log";
+    REQUIRE(mychat::log::openFileSink({ .path = path, .maxBytes = 100, .maxFiles = 2 }));
+    for (auto i = 0; i < 10; ++i)
+        mychat::log::info("message {}", i); // Each line is about 50 bytes: two fit in a file.
+    mychat::log::closeFileSink();
+    mychat::log::setCallback(nullptr);
+
+    auto const current = readLines(path);
+    auto const previous = readLines(directory / "mychat.log.1");
+    auto const oldest = readLines(directory / "mychat.log.2");
+    REQUIRE(current.size() == 2);
+    CHECK(current[1].ends_with("message 9"));
+    REQUIRE(previous.size() == 2);
+    CHECK(previous[1].ends_with("message 7"));
+    REQUIRE(oldest.size() == 2);
+    CHECK(oldest[1].ends_with("message 5"));
+    CHECK_FALSE(std::filesystem::exists(directory / "mychat.log.3"));
+
+    std::filesystem::remove_all(directory);
+}
+
 // =============================================================================
-// LogPanel thread-safety tests
+// Log queue tests
 // =============================================================================
 
-TEST_CASE("LogPanel: concurrent addLog from multiple threads", "[tui][logpanel][thread]")
+TEST_CASE("log::enableQueue: threads log into the LogPanel through the queue", "[tui][logpanel][thread]")
 {
     auto panel = LogPanel {};
     constexpr auto ThreadCount = 4;
     constexpr auto MessagesPerThread = 25; // 4*25=100 = MaxEntries, no eviction
 
+    mychat::log::setCallback([&](mychat::log::Level, std::string_view message) {
+        panel.addLog(LogLevel::Info, std::string(message));
+    });
+    auto notified = std::atomic<int> { 0 };
+    mychat::log::enableQueue(256, [&] { ++notified; });
+
     auto threads = std::vector<std::thread> {};
     threads.reserve(ThreadCount);
-
     for (auto t = 0; t < ThreadCount; ++t)
     {
-        threads.emplace_back([&panel, t]() {
+        threads.emplace_back([t]() {
             for (auto i = 0; i < MessagesPerThread; ++i)
-                panel.addLog(LogLevel::Info, std::format("thread {} msg {}", t, i));
+                mychat::log::info("thread {} msg {}", t, i);
         });
     }
 
+    // Nothing is delivered on the logging threads; the panel fills as this thread drains.
+    auto drained = std::size_t { 0 };
+    while (drained < ThreadCount * MessagesPerThread)
+        drained += mychat::log::drainQueue();
     for (auto& th: threads)
         th.join();
 
+    mychat::log::setCallback(nullptr);
+    mychat::log::disableQueue();
+
     CHECK(panel.entryCount() == static_cast<std::size_t>(ThreadCount * MessagesPerThread));
+    CHECK(notified == ThreadCount * MessagesPerThread);
+    CHECK(mychat::log::takeDroppedCount() == 0);
+}
+
+TEST_CASE("log::enableQueue: drops and counts messages when full", "[core][log]")
+{
+    auto received = std::vector<std::string> {};
+    mychat::log::setCallback([&](mychat::log::Level, std::string_view message) {
+        received.emplace_back(message);
+    });
+    mychat::log::enableQueue(4);
+
+    for (auto i = 0; i < 6; ++i)
+        mychat::log::info("msg {}", i);
+    CHECK(received.empty());
+
+    mychat::log::disableQueue();
+    mychat::log::info("direct");
+    mychat::log::setCallback(nullptr);
+
+    CHECK(received == std::vector<std::string> { "msg 0", "msg 1", "msg 2", "msg 3", "direct" });
+    CHECK(mychat::log::takeDroppedCount() == 2);
+    CHECK(mychat::log::takeDroppedCount() == 0);
 }
 
 // =============================================================================
@@ -1619,6 +2621,55 @@ TEST_CASE("List: filtering", "[tui][list]")
     CHECK(list.visibleItems().size() == 3);
 }
 
+TEST_CASE("List: fuzzy filtering ranks matches", "[tui][list]")
+{
+    auto items = std::vector<ListItem> {
+        { .label = "gemma-2-9b", .description = "", .filterText = "", .enabled = true },
+        { .label = "Qwen2.5-7B-Instruct", .description = "", .filterText = "", .enabled = true },
+        { .label = "llama", .description = "", .filterText = "qwen legacy", .enabled = true },
+        { .label = "qwq-32b", .description = "", .filterText = "", .enabled = true },
+    };
+    auto list = List(items);
+
+    list.setFilter("QW");
+    CHECK(list.visibleItems() == std::vector<std::size_t> { 1, 2, 3 });
+
+    list.setFilter("qwi");
+    CHECK(list.visibleItems() == std::vector<std::size_t> { 1 }); // "Q-w-...-I-nstruct"
+    CHECK(list.selectedIndex() == 1);
+
+    // Shortening the filter searches all items again.
+    list.setFilter("q");
+    CHECK(list.visibleItems().size() == 3);
+
+    CHECK(fuzzyMatchScore("abc", "abc") > fuzzyMatchScore("a-b-c", "abc"));
+    CHECK(fuzzyMatchScore("foo bar", "b") > fuzzyMatchScore("foobar", "b"));
+    CHECK(fuzzyMatchScore("xyz", "") == 0);
+    CHECK_FALSE(fuzzyMatchScore("abc", "cb").has_value());
+}
+
+TEST_CASE("List: refining the filter matches a fresh search", "[tui][list]")
+{
+    auto items = std::vector<ListItem> {};
+    for (auto i = 0; i < 2000; ++i)
+    {
+        auto const label = std::format("tool_{}_{}", i % 37, i);
+        items.push_back(ListItem { .label = label, .description = "", .filterText = "", .enabled = true });
+    }
+    auto list = List(items);
+    auto fresh = List(items);
+
+    for (auto const* const filter: { "t", "to", "to1", "to12", "to12_" })
+    {
+        list.setFilter(filter);
+        fresh.clearFilter();
+        fresh.setFilter(std::string("#") + filter); // Nothing matches; the next search starts over.
+        fresh.setFilter(filter);
+        CHECK(list.visibleItems() == fresh.visibleItems());
+    }
+    CHECK_FALSE(list.visibleItems().empty());
+}
+
 TEST_CASE("List: keyboard events", "[tui][list]")
 {
     auto items = std::vector<ListItem> {
@@ -1682,6 +2733,48 @@ TEST_CASE("Text: word wrap", "[tui][text]")
         CHECK(displayWidth(line) <= 10);
 }
 
+TEST_CASE("Text: wrapping keeps each span's style", "[tui][text]")
+{
+    auto bold = Style {};
+    bold.bold = true;
+    auto line = TextLine {};
+    line.append(std::string_view { "plain words " });
+    line.append("bold words", bold);
+    auto text = Text {};
+    text.setLines({ line });
+
+    auto const wrapped = text.wrap(11);
+    REQUIRE(wrapped.size() == 2);
+    REQUIRE(wrapped[0].spans.size() == 1);
+    CHECK(wrapped[0].spans[0].text == "plain words");
+    REQUIRE(wrapped[1].spans.size() == 1);
+    CHECK(wrapped[1].spans[0].text == "bold words");
+    CHECK(wrapped[1].spans[0].style.bold);
+
+    text.setWrapMode(WrapMode::Char);
+    auto const chars = text.wrap(8);
+    REQUIRE(chars.size() == 3);
+    REQUIRE(chars[1].spans.size() == 2);
+    CHECK(chars[1].spans[0].text == "rds ");
+    CHECK(chars[1].spans[1].text == "bold");
+    CHECK(chars[1].spans[1].style.bold);
+}
+
+TEST_CASE("Text: memoized wrapping follows content changes", "[tui][text]")
+{
+    auto text = Text("one two three four");
+    CHECK(text.lineCount(9) == 3);
+    CHECK(text.wrap(9).size() == 3);
+    CHECK(text.lineCount(100) == 1);
+
+    text.setText("one two");
+    CHECK(text.lineCount(100) == 1);
+    CHECK(text.lineCount(3) == 2);
+
+    text.setWrapMode(WrapMode::None);
+    CHECK(text.lineCount(3) == 1);
+}
+
 TEST_CASE("Text: truncate", "[tui][text]")
 {
     auto result = mychat::tui::truncate("Hello, world!", 8);
@@ -1708,6 +2801,202 @@ TEST_CASE("Text: alignment", "[tui][text]")
     CHECK(text.align() == TextAlign::Right);
 }
 
+// =============================================================================
+// Unicode tests
+// =============================================================================
+
+TEST_CASE("Unicode: display width of wide and combining characters", "[tui][unicode]")
+{
+    CHECK(displayWidth("\u65E5\u672C") == 4);            // 日本
+    CHECK(displayWidth("\U0001F600!") == 3);              // 😀!
+    CHECK(displayWidth("e\u0301") == 1);                  // é, decomposed
+    CHECK(displayWidth("a\tb") == 2);                     // Controls take no column
+    CHECK(displayWidth("\xFF") == codepointWidth(U'\uFFFD')); // Malformed UTF-8
+}
+
+TEST_CASE("Unicode: emoji sequences take the width of one cluster", "[tui][unicode]")
+{
+    auto const family = std::string_view { "\U0001F468\u200D\U0001F469\u200D\U0001F467" }; // 👨‍👩‍👧
+    CHECK(displayWidth(family) == 2);
+    CHECK(graphemeCount(family) == 1);
+    CHECK(displayWidth("\u2764\uFE0F") == 2);             // ❤️, text default with VS16
+    CHECK(displayWidth("\u2764") == 1);                    // ❤, text presentation
+    CHECK(displayWidth("\U0001F1E9\U0001F1EA") == 2);      // 🇩🇪
+    CHECK(displayWidth("\U0001F1E9\U0001F1EA\U0001F1EB\U0001F1F7") == 4); // 🇩🇪🇫🇷
+    CHECK(displayWidth("\U0001F44D\U0001F3FD") == 2);      // 👍🏽
+    CHECK(displayWidth("a\U0001F44D\U0001F3FDb") == 4);
+    CHECK(columnPrefixLength(family, 1) == 0);
+    CHECK(columnPrefixLength(family, 2) == family.size());
+}
+
+TEST_CASE("Unicode: printable ASCII prefix", "[tui][unicode]")
+{
+    // Long enough to cover the vector loops and the scalar tail.
+    auto const ascii = std::string(70, 'x');
+    CHECK(printableAsciiPrefix(ascii) == 70);
+    for (auto const pos: { 0, 15, 16, 31, 32, 47, 69 })
+    {
+        auto text = ascii;
+        text[static_cast<std::size_t>(pos)] = '\n';
+        CHECK(printableAsciiPrefix(text) == static_cast<std::size_t>(pos));
+        text[static_cast<std::size_t>(pos)] = '\xC3';
+        CHECK(printableAsciiPrefix(text) == static_cast<std::size_t>(pos));
+    }
+    CHECK(displayWidth(ascii + "\u65E5" + ascii) == 142);
+}
+
+TEST_CASE("Unicode: grapheme boundaries", "[tui][unicode]")
+{
+    auto const text = std::string_view { "ae\u0301\r\n\u65E5b" };
+    CHECK(graphemeBoundaries(text) == std::vector<std::size_t> { 0, 1, 4, 6, 9, 10 });
+    CHECK(graphemeCount(text) == 5);
+    CHECK(graphemeCount("hello") == 5);
+    CHECK(nextGraphemeBoundary(text, 1) == 4);
+    CHECK(previousGraphemeBoundary(text, 4) == 1);
+    CHECK(previousGraphemeBoundary(text, 6) == 4);
+    CHECK(previousGraphemeBoundary(text, 10) == 9);
+    CHECK(previousGraphemeBoundary(text, 0) == 0);
+}
+
+TEST_CASE("Unicode: column prefix keeps whole clusters", "[tui][unicode]")
+{
+    CHECK(columnPrefixLength("hello", 3) == 3);
+    CHECK(columnPrefixLength("hello", 10) == 5);
+    CHECK(columnPrefixLength("ae\u0301x", 2) == 4);         // Keeps the combining accent
+    CHECK(columnPrefixLength("\u65E5\u672C", 3) == 3);      // 日 fits, 本 does not
+    CHECK(mychat::tui::truncate("\u65E5\u672C\u8A9E\u3067\u3059", 6) == "\u65E5\u672C\u2026");
+}
+
+// =============================================================================
+// Scrollback tests
+// =============================================================================
+
+namespace
+{
+using Rows = std::vector<std::string>;
+
+/// @brief Returns the text of the rows @p view shows, one string per row.
+auto visibleText(Scrollback const& scrollback, ScrollbackView const& view) -> Rows
+{
+    auto result = Rows {};
+    for (auto const& row: view.visibleRows())
+        result.emplace_back(scrollback.lineText(row.line).substr(row.begin, row.end - row.begin));
+    return result;
+}
+} // namespace
+
+TEST_CASE("Scrollback: lines, spans and messages", "[tui][scrollback]")
+{
+    auto bold = Style {};
+    bold.bold = true;
+
+    auto scrollback = Scrollback {};
+    CHECK(scrollback.lineCount() == 1);
+    scrollback.beginMessage();
+    scrollback.append("You: ", bold);
+    scrollback.append("hi\r\n\n");
+    scrollback.beginMessage();
+    scrollback.append("a **b**", bold);
+    scrollback.append(" c");
+
+    REQUIRE(scrollback.lineCount() == 3);
+    CHECK(scrollback.lineText(0) == "You: hi");
+    CHECK(scrollback.lineText(1).empty());
+    CHECK(scrollback.lineText(2) == "a **b** c");
+    CHECK(scrollback.lineMessage(0) == 1);
+    CHECK(scrollback.lineMessage(1) == 1);
+    CHECK(scrollback.lineMessage(2) == 2);
+
+    auto spans = std::vector<std::pair<std::string, bool>> {};
+    scrollback.forEachSpan(0, 2, 100, [&](std::string_view text, Style const& style) {
+        spans.emplace_back(std::string(text), style.bold);
+    });
+    CHECK(spans == std::vector<std::pair<std::string, bool>> { { "u: ", true }, { "hi", false } });
+
+    scrollback.clear();
+    CHECK(scrollback.lineCount() == 1);
+    CHECK(scrollback.lineText(0).empty());
+    CHECK(scrollback.messageCount() == 0);
+}
+
+TEST_CASE("ScrollbackView: follows the end and wraps at its width", "[tui][scrollback]")
+{
+    auto scrollback = Scrollback {};
+    auto view = ScrollbackView(scrollback);
+    view.setSize(4, 3);
+
+    scrollback.append("one\nabcdefghij\n");
+    CHECK(visibleText(scrollback, view) == Rows { "efgh", "ij", "" });
+    CHECK(view.tailColumn() == 1);
+
+    scrollback.append("xy");
+    CHECK(visibleText(scrollback, view) == Rows { "efgh", "ij", "xy" });
+    CHECK(view.tailColumn() == 3);
+
+    // Resizing wraps the lines again.
+    view.setSize(10, 3);
+    CHECK(visibleText(scrollback, view) == Rows { "one", "abcdefghij", "xy" });
+
+    CHECK(ScrollbackView::wrapRows("", 4) == std::vector<std::size_t> { 0 });
+    CHECK(ScrollbackView::wrapRows("\u65E5\u672C\u8A9E", 5) == std::vector<std::size_t> { 0, 6 });
+}
+
+TEST_CASE("ScrollbackView: scrolls back and follows again at the end", "[tui][scrollback]")
+{
+    auto scrollback = Scrollback {};
+    for (auto i = 0; i < 10000; ++i)
+        scrollback.append(std::format("line {}\n", i));
+
+    auto view = ScrollbackView(scrollback);
+    view.setSize(20, 3);
+    CHECK(visibleText(scrollback, view) == Rows { "line 9998", "line 9999", "" });
+
+    view.scrollBy(-2);
+    CHECK_FALSE(view.following());
+    CHECK(visibleText(scrollback, view) == Rows { "line 9996", "line 9997", "line 9998" });
+
+    // New output does not move a view that was scrolled back.
+    scrollback.append("more\n");
+    CHECK(visibleText(scrollback, view) == Rows { "line 9996", "line 9997", "line 9998" });
+
+    // Scrolling stops with the first line at the top.
+    view.scrollBy(-20000);
+    CHECK(visibleText(scrollback, view) == Rows { "line 0", "line 1", "line 2" });
+
+    view.scrollBy(20000);
+    CHECK(view.following());
+    CHECK(visibleText(scrollback, view) == Rows { "line 9999", "more", "" });
+
+    // Output shorter than the view does not scroll.
+    auto shortScrollback = Scrollback {};
+    shortScrollback.append("only\n");
+    auto shortView = ScrollbackView(shortScrollback);
+    shortView.setSize(20, 3);
+    shortView.scrollBy(-1);
+    CHECK(shortView.following());
+}
+
+TEST_CASE("MarkdownRenderer: records into a scrollback while suspended", "[tui][scrollback]")
+{
+    auto output = TerminalOutput {};
+    auto scrollback = Scrollback {};
+    auto renderer = MarkdownRenderer(output);
+    renderer.recordTo(&scrollback);
+    renderer.setSuspended(true);
+
+    renderer.beginStream();
+    renderer.feedToken("# Title\n> quo");
+    renderer.feedToken("te\n");
+    renderer.endStream();
+    CHECK_FALSE(output.hasPendingOutput());
+
+    REQUIRE(scrollback.lineCount() == 4);
+    CHECK(scrollback.lineText(0) == "Title");
+    CHECK(scrollback.lineText(1) == "│ quote");
+    CHECK(scrollback.lineText(2).empty());
+    scrollback.forEachSpan(0, 0, 5, [](std::string_view, Style const& style) { CHECK(style.bold); });
+}
+
 // =============================================================================
 // Spinner tests
 // =============================================================================
@@ -1750,6 +3039,26 @@ TEST_CASE("Spinner: reset", "[tui][spinner]")
     CHECK(spinner.frameIndex() == 0);
 }
 
+TEST_CASE("Spinner: a new frame damages its cells until rendered", "[tui][spinner]")
+{
+    static constexpr auto Frames = std::array { std::string_view { "-" }, std::string_view { "\U0001F30D" } };
+    auto spinner = Spinner(Frames, std::chrono::milliseconds { 0 });
+    CHECK(!spinner.damage().dirty());
+
+    REQUIRE(spinner.tick());
+    auto const version = spinner.damage().version();
+    CHECK(version > 0);
+    CHECK(spinner.damage().region() == Rect { .row = 0, .col = 0, .width = 2, .height = 1 });
+
+    auto output = TerminalOutput {};
+    spinner.render(output);
+    CHECK(!spinner.damage().dirty());
+    CHECK(spinner.damage().version() == version);
+
+    spinner.reset();
+    CHECK(spinner.damage().dirty());
+}
+
 TEST_CASE("ProgressBar: basic functionality", "[tui][spinner]")
 {
     auto bar = ProgressBar(20);
@@ -1802,6 +3111,31 @@ TEST_CASE("StatusBar: styling", "[tui][statusbar]")
     CHECK(style.keyStyle.bold);
 }
 
+TEST_CASE("StatusBar: only changes damage the bar", "[tui][statusbar]")
+{
+    auto output = TerminalOutput {};
+    auto bar = StatusBar {};
+    bar.setHints({ { .key = "Ctrl+C", .action = "Quit" } });
+    bar.setRightText("12 tok/s");
+    bar.render(output, 24, 80);
+    CHECK(!bar.damage().dirty());
+
+    auto const version = bar.damage().version();
+    bar.setHints({ { .key = "Ctrl+C", .action = "Quit" } });
+    bar.setRightText("12 tok/s");
+    bar.setStyle(bar.style());
+    CHECK(!bar.damage().dirty());
+    CHECK(bar.damage().version() == version);
+
+    bar.setRightText("13 tok/s");
+    CHECK(bar.damage().dirty());
+    CHECK(bar.damage().region() == Rect { .row = 0, .col = 0, .width = 80, .height = 1 });
+
+    bar.render(output, 24, 80);
+    bar.invalidate();
+    CHECK(bar.damage().all());
+}
+
 TEST_CASE("StatusBar: render does not crash", "[tui][statusbar]")
 {
     auto output = TerminalOutput {};
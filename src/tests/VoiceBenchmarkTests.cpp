@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <mychat/VoiceBenchmark.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace mychat;
+
+namespace
+{
+
+auto samples() -> std::vector<VoiceLatencySample>
+{
+    return {
+        { .transcript = "What time is it?",
+          .transcriptMs = 300.0,
+          .firstTokenMs = 450.0,
+          .firstAudioMs = 700.0 },
+        { .transcript = "And in Tokyo?", .transcriptMs = 200.0, .firstTokenMs = 350.0, .firstAudioMs = {} },
+        { .transcript = "Thanks.", .transcriptMs = 250.0, .firstTokenMs = {}, .firstAudioMs = 500.0 },
+    };
+}
+
+} // namespace
+
+TEST_CASE("formatVoiceBenchmarkTable lists each utterance and the medians", "[voice-bench]")
+{
+    auto const table = formatVoiceBenchmarkTable(samples());
+    CHECK(table.find("What time is it?") != std::string::npos);
+    CHECK(table.find("first audio ms") != std::string::npos);
+
+    auto const medians = table.substr(table.find("median"));
+    // 250 of three transcripts; of the first tokens and audio, only those measured count.
+    CHECK(medians.find(" 250 ") != std::string::npos);
+    CHECK(medians.find(" 450 ") != std::string::npos);
+    CHECK(medians.find(" 700") != std::string::npos);
+}
+
+TEST_CASE("voiceBenchmarkJson has null for latencies not measured", "[voice-bench]")
+{
+    auto const json = voiceBenchmarkJson(samples());
+    REQUIRE(json.size() == 3);
+    CHECK(json[0]["transcript"] == "What time is it?");
+    CHECK(json[0]["firstAudioMs"].get<double>() == Catch::Approx(700.0));
+    CHECK(json[1]["firstAudioMs"].is_null());
+    CHECK(json[2]["firstTokenMs"].is_null());
+    CHECK(json[2]["transcriptMs"].get<double>() == Catch::Approx(250.0));
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <core/WorkerPool.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace mychat;
+
+TEST_CASE("WorkerPool: returns task results through futures", "[core][pool]")
+{
+    auto pool = WorkerPool(2);
+    auto futures = std::vector<std::future<int>> {};
+    for (auto i = 0; i < 10; ++i)
+        futures.push_back(pool.submit([i] { return i * i; }));
+    for (auto i = 0; i < 10; ++i)
+        CHECK(futures[static_cast<size_t>(i)].get() == i * i);
+}
+
+TEST_CASE("WorkerPool: never runs more tasks at once than it has workers", "[core][pool]")
+{
+    auto running = std::atomic<int> { 0 };
+    auto peak = std::atomic<int> { 0 };
+    {
+        auto pool = WorkerPool(3);
+        auto futures = std::vector<std::future<void>> {};
+        for (auto i = 0; i < 12; ++i)
+            futures.push_back(pool.submit([&] {
+                auto const now = ++running;
+                auto previous = peak.load();
+                while (now > previous && !peak.compare_exchange_weak(previous, now))
+                    ;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                --running;
+            }));
+        for (auto& future: futures)
+            future.get();
+    }
+    CHECK(peak.load() > 1);
+    CHECK(peak.load() <= 3);
+}
+
+TEST_CASE("WorkerPool: destruction finishes queued tasks", "[core][pool]")
+{
+    auto done = std::atomic<int> { 0 };
+    {
+        auto pool = WorkerPool(1);
+        for (auto i = 0; i < 5; ++i)
+            (void) pool.submit([&] { ++done; });
+    }
+    CHECK(done.load() == 5);
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace mychat::tui
+{
+
+/// @brief A rectangle of cells, relative to the top-left cell (0, 0) of a widget.
+struct Rect
+{
+    int row = 0;
+    int col = 0;
+    int width = 0;
+    int height = 0;
+
+    [[nodiscard]] constexpr auto empty() const noexcept -> bool { return width <= 0 || height <= 0; }
+
+    /// @brief Returns the smallest rectangle containing this one and @p other.
+    [[nodiscard]] constexpr auto united(Rect const& other) const noexcept -> Rect
+    {
+        if (empty())
+            return other;
+        if (other.empty())
+            return *this;
+        auto const top = std::min(row, other.row);
+        auto const left = std::min(col, other.col);
+        auto const bottom = std::max(row + height, other.row + other.height);
+        auto const right = std::max(col + width, other.col + other.width);
+        return Rect { .row = top, .col = left, .width = right - left, .height = bottom - top };
+    }
+
+    [[nodiscard]] constexpr auto operator==(Rect const&) const noexcept -> bool = default;
+};
+
+/// @brief What of a widget changed since it was last drawn.
+///
+/// Every change bumps the version, so an owner can tell whether a widget needs drawing at all by
+/// comparing it with the version it drew, and adds the cells it affects to the region, so only
+/// those need to be redrawn. A change may not know its cells yet (e.g. before the widget was ever
+/// drawn); it makes the widget dirty with an empty region, which means all of it.
+class Damage
+{
+  public:
+    /// @brief Records a change of the cells in @p rect.
+    constexpr void add(Rect const& rect) noexcept
+    {
+        _region = _region.united(rect);
+        _dirty = true;
+        ++_version;
+    }
+
+    /// @brief Records a change of the whole widget.
+    constexpr void addAll() noexcept
+    {
+        _all = true;
+        _dirty = true;
+        ++_version;
+    }
+
+    /// @brief Forgets the changes, once they were drawn.
+    constexpr void clear() noexcept
+    {
+        _region = {};
+        _dirty = false;
+        _all = false;
+    }
+
+    /// @brief Returns the number of changes ever made; it never goes back.
+    [[nodiscard]] constexpr auto version() const noexcept -> std::uint64_t { return _version; }
+
+    /// @brief Returns whether anything changed since the last clear().
+    [[nodiscard]] constexpr auto dirty() const noexcept -> bool { return _dirty; }
+
+    /// @brief Returns whether the whole widget needs to be redrawn.
+    [[nodiscard]] constexpr auto all() const noexcept -> bool { return _all || (_dirty && _region.empty()); }
+
+    /// @brief Returns the cells changed since the last clear(); meaningless if all() is true.
+    [[nodiscard]] constexpr auto region() const noexcept -> Rect const& { return _region; }
+
+  private:
+    Rect _region;
+    std::uint64_t _version = 0;
+    bool _dirty = false;
+    bool _all = false;
+};
+
+} // namespace mychat::tui
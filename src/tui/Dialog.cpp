@@ -369,13 +369,19 @@ auto InputDialog::processEvent(InputEvent const& event) -> DialogResult
         }
     }
 
-    // Handle paste events
+    // Handle paste events and typed text
     if (auto const* paste = std::get_if<PasteEvent>(&event))
     {
         _value.insert(_cursor, paste->text);
         _cursor += paste->text.size();
         return DialogResult::Changed;
     }
+    if (auto const* text = std::get_if<TextEvent>(&event))
+    {
+        _value.insert(_cursor, text->text);
+        _cursor += text->text.size();
+        return DialogResult::Changed;
+    }
 
     return DialogResult::None;
 }
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+
+#include <tui/FrameScheduler.hpp>
+
+namespace mychat::tui
+{
+
+FrameScheduler::FrameScheduler(TerminalOutput& output, std::chrono::milliseconds interval):
+    _output(output), _interval(interval)
+{
+}
+
+auto FrameScheduler::due(Clock::time_point now) const noexcept -> bool
+{
+    return now - _lastFrame >= _interval;
+}
+
+auto FrameScheduler::flushIfDue(Clock::time_point now) -> bool
+{
+    if (!_output.hasPendingOutput() || !due(now))
+        return false;
+    flush(now);
+    return true;
+}
+
+void FrameScheduler::flush(Clock::time_point now)
+{
+    if (!_output.hasPendingOutput())
+        return;
+    _output.flushSynchronized();
+    _lastFrame = now;
+}
+
+auto FrameScheduler::timeout(std::chrono::milliseconds idle, Clock::time_point now) const
+    -> std::chrono::milliseconds
+{
+    if (!_output.hasPendingOutput())
+        return idle;
+    auto const remaining = std::chrono::ceil<std::chrono::milliseconds>(_lastFrame + _interval - now);
+    return std::clamp(remaining, std::chrono::milliseconds { 0 }, idle);
+}
+
+} // namespace mychat::tui
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <tui/TerminalOutput.hpp>
+
+#include <chrono>
+
+namespace mychat::tui
+{
+
+/// @brief Coalesces terminal output into frames flushed at a bounded rate.
+///
+/// Output is buffered by TerminalOutput as usual; the scheduler decides when the buffer goes out.
+/// A frame is flushed at most once per interval, and right away when the previous one is older,
+/// so a burst of streamed tokens, spinner and voice meter updates costs one write per frame while
+/// a lone update is not delayed. Each frame is written in synchronized output mode.
+class FrameScheduler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Default minimum time between two frames, for about 80 frames per second.
+    static constexpr auto DefaultInterval = std::chrono::milliseconds { 12 };
+
+    /// @brief Constructs a scheduler flushing @p output.
+    /// @param output The terminal output to flush; must outlive the scheduler.
+    /// @param interval Minimum time between two frames.
+    explicit FrameScheduler(TerminalOutput& output, std::chrono::milliseconds interval = DefaultInterval);
+
+    /// @brief Returns true if the interval since the last frame has passed.
+    [[nodiscard]] auto due(Clock::time_point now = Clock::now()) const noexcept -> bool;
+
+    /// @brief Flushes the pending output as one frame if it is due.
+    /// @return True if a frame was flushed.
+    auto flushIfDue(Clock::time_point now = Clock::now()) -> bool;
+
+    /// @brief Flushes the pending output as one frame now.
+    void flush(Clock::time_point now = Clock::now());
+
+    /// @brief Returns how long to wait for input before the pending output is due, at most @p idle.
+    [[nodiscard]] auto timeout(std::chrono::milliseconds idle, Clock::time_point now = Clock::now()) const
+        -> std::chrono::milliseconds;
+
+  private:
+    TerminalOutput& _output;
+    std::chrono::milliseconds _interval;
+    Clock::time_point _lastFrame {};
+};
+
+} // namespace mychat::tui
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <format>
+#include <memory>
+
+#include <tui/Image.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_GIF
+#define STBI_ONLY_BMP
+#define STBI_NO_STDIO
+#if defined(_MSC_VER)
+    #pragma warning(push, 0)
+#endif
+#include <stb_image.h>
+#if defined(_MSC_VER)
+    #pragma warning(pop)
+#endif
+
+namespace mychat::tui
+{
+
+auto decodeImage(std::span<const std::uint8_t> bytes) -> Result<Image>
+{
+    if (bytes.size() > static_cast<size_t>(INT_MAX))
+        return makeError(ErrorCode::InvalidArgument, "Image too large");
+
+    auto width = 0;
+    auto height = 0;
+    auto channels = 0;
+    auto const pixels = std::unique_ptr<stbi_uc, decltype(&stbi_image_free)>(
+        stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &channels, 4),
+        &stbi_image_free);
+    if (!pixels)
+        return makeError(ErrorCode::InvalidArgument,
+                         std::format("Cannot decode image: {}", stbi_failure_reason()));
+
+    auto const size = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+    return Image {
+        .pixels = std::vector<std::uint8_t>(pixels.get(), pixels.get() + size),
+        .width = width,
+        .height = height,
+    };
+}
+
+auto fitImage(ImageData const& image, int maxWidth, int maxHeight) -> Image
+{
+    if (image.width <= 0 || image.height <= 0 || maxWidth <= 0 || maxHeight <= 0)
+        return {};
+    if (image.pixels.size() < static_cast<size_t>(image.width) * static_cast<size_t>(image.height) * 4)
+        return {};
+
+    auto const scale = std::min({ 1.0,
+                                  static_cast<double>(maxWidth) / image.width,
+                                  static_cast<double>(maxHeight) / image.height });
+    auto const width = std::max(1, static_cast<int>(image.width * scale));
+    auto const height = std::max(1, static_cast<int>(image.height * scale));
+
+    auto result = Image { .pixels = {}, .width = width, .height = height };
+    if (width == image.width && height == image.height)
+    {
+        result.pixels.assign(image.pixels.begin(), image.pixels.end());
+        return result;
+    }
+
+    result.pixels.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+    for (auto y = 0; y < height; ++y)
+    {
+        // The source rows and columns covered by this target pixel; at least one of each.
+        auto const y0 = y * image.height / height;
+        auto const y1 = std::max(y0 + 1, (y + 1) * image.height / height);
+        for (auto x = 0; x < width; ++x)
+        {
+            auto const x0 = x * image.width / width;
+            auto const x1 = std::max(x0 + 1, (x + 1) * image.width / width);
+
+            auto sums = std::array<unsigned, 4> {};
+            for (auto sy = y0; sy < y1; ++sy)
+                for (auto sx = x0; sx < x1; ++sx)
+                    for (auto c = 0; c < 4; ++c)
+                        sums[c] += image.pixels[(static_cast<size_t>(sy) * image.width + sx) * 4 + c];
+
+            auto const count = static_cast<unsigned>((y1 - y0) * (x1 - x0));
+            auto* out = &result.pixels[(static_cast<size_t>(y) * width + x) * 4];
+            for (auto c = 0; c < 4; ++c)
+                out[c] = static_cast<std::uint8_t>(sums[c] / count);
+        }
+    }
+    return result;
+}
+
+} // namespace mychat::tui
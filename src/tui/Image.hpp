@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <tui/Sixel.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief An RGBA image that owns its pixel data.
+struct Image
+{
+    std::vector<std::uint8_t> pixels; ///< RGBA pixel data (4 bytes per pixel).
+    int width = 0;                    ///< Image width in pixels.
+    int height = 0;                   ///< Image height in pixels.
+
+    /// @brief Returns a view of the image for encodeSixel().
+    [[nodiscard]] auto view() const noexcept -> ImageData
+    {
+        return ImageData { .pixels = pixels, .width = width, .height = height };
+    }
+};
+
+/// @brief Decodes a PNG, JPEG, GIF (first frame) or BMP file held in memory.
+/// @param bytes The encoded file contents.
+/// @return The decoded RGBA image, or an error if the format is unsupported or the data is corrupt.
+[[nodiscard]] auto decodeImage(std::span<const std::uint8_t> bytes) -> Result<Image>;
+
+/// @brief Shrinks an image to fit into @p maxWidth x @p maxHeight, keeping its aspect ratio.
+///
+/// Each target pixel averages the source pixels it covers. Images that already fit are
+/// copied unchanged.
+[[nodiscard]] auto fitImage(ImageData const& image, int maxWidth, int maxHeight) -> Image;
+
+} // namespace mychat::tui
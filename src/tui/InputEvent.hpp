@@ -52,7 +52,15 @@ struct PasteEvent
     std::string text; ///< Pasted text content.
 };
 
+/// @brief Run of typed text, delivered at once instead of as one KeyEvent per character.
+///
+/// Holds printable characters only; a run of a single character is still a KeyEvent.
+struct TextEvent
+{
+    std::string text; ///< The text, valid UTF-8.
+};
+
 /// @brief Discriminated union of all possible terminal input events.
-using InputEvent = std::variant<KeyEvent, MouseEvent, ResizeEvent, PasteEvent>;
+using InputEvent = std::variant<KeyEvent, MouseEvent, ResizeEvent, PasteEvent, TextEvent>;
 
 } // namespace mychat::tui
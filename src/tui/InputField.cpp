@@ -1,8 +1,9 @@
 // SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
 #include <string>
 
-#include <libunicode/utf8_grapheme_segmenter.h>
 #include <tui/InputField.hpp>
+#include <tui/Unicode.hpp>
 
 namespace mychat::tui
 {
@@ -41,23 +42,23 @@ namespace
     }
 
     /// @brief Advances past one UTF-8 codepoint.
-    auto nextUtf8(std::string_view s, std::size_t pos) -> std::size_t
+    auto nextUtf8(TextBuffer const& s, std::size_t pos) -> std::size_t
     {
         if (pos >= s.size())
             return pos;
         ++pos;
-        while (pos < s.size() && (static_cast<unsigned char>(s[pos]) & 0xC0) == 0x80)
+        while (pos < s.size() && (static_cast<unsigned char>(s.at(pos)) & 0xC0) == 0x80)
             ++pos;
         return pos;
     }
 
     /// @brief Moves back one UTF-8 codepoint.
-    auto prevUtf8(std::string_view s, std::size_t pos) -> std::size_t
+    auto prevUtf8(TextBuffer const& s, std::size_t pos) -> std::size_t
     {
         if (pos == 0)
             return 0;
         --pos;
-        while (pos > 0 && (static_cast<unsigned char>(s[pos]) & 0xC0) == 0x80)
+        while (pos > 0 && (static_cast<unsigned char>(s.at(pos)) & 0xC0) == 0x80)
             --pos;
         return pos;
     }
@@ -75,12 +76,24 @@ auto InputField::processEvent(InputEvent const& event) -> InputFieldAction
         return InputFieldAction::Changed;
     }
 
+    if (auto const* text = std::get_if<TextEvent>(&event))
+    {
+        insertText(text->text);
+        _lastWasKill = false;
+        return InputFieldAction::Changed;
+    }
+
     return InputFieldAction::None;
 }
 
-auto InputField::text() const noexcept -> std::string_view
+auto InputField::text() const -> std::string_view
+{
+    return _buffer.text();
+}
+
+auto InputField::empty() const noexcept -> bool
 {
-    return _buffer;
+    return _buffer.empty();
 }
 
 auto InputField::cursor() const noexcept -> std::size_t
@@ -106,7 +119,7 @@ void InputField::clear()
 
 void InputField::setText(std::string_view text)
 {
-    _buffer = std::string(text);
+    _buffer.assign(text);
     _cursor = _buffer.size();
 }
 
@@ -321,8 +334,8 @@ void InputField::killToEnd()
 {
     if (_cursor < _buffer.size())
     {
-        auto killed = _buffer.substr(_cursor);
-        _buffer.erase(_cursor);
+        auto killed = _buffer.substr(_cursor, _buffer.size() - _cursor);
+        _buffer.erase(_cursor, killed.size());
         pushKillRing(std::move(killed));
     }
     _lastWasKill = true;
@@ -434,19 +447,19 @@ void InputField::moveForwardWord()
 {
     auto const size = _buffer.size();
     // Emacs forward-word: skip non-word chars, then skip word chars
-    while (_cursor < size && !isWordCharAt(_buffer[_cursor]))
+    while (_cursor < size && !isWordCharAt(_buffer.at(_cursor)))
         _cursor = nextUtf8(_buffer, _cursor);
-    while (_cursor < size && isWordCharAt(_buffer[_cursor]))
+    while (_cursor < size && isWordCharAt(_buffer.at(_cursor)))
         _cursor = nextUtf8(_buffer, _cursor);
 }
 
 void InputField::moveBackwardWord()
 {
     // Skip whitespace/non-word characters
-    while (_cursor > 0 && !isWordCharAt(_buffer[prevUtf8(_buffer, _cursor)]))
+    while (_cursor > 0 && !isWordCharAt(_buffer.at(prevUtf8(_buffer, _cursor))))
         _cursor = prevUtf8(_buffer, _cursor);
     // Skip word characters
-    while (_cursor > 0 && isWordCharAt(_buffer[prevUtf8(_buffer, _cursor)]))
+    while (_cursor > 0 && isWordCharAt(_buffer.at(prevUtf8(_buffer, _cursor))))
         _cursor = prevUtf8(_buffer, _cursor);
 }
 
@@ -455,11 +468,11 @@ void InputField::historyPrev()
     if (_history.empty())
         return;
     if (_historyIndex == _history.size())
-        _savedLine = _buffer;
+        _savedLine = std::string(_buffer.text());
     if (_historyIndex > 0)
     {
         --_historyIndex;
-        _buffer = _history[_historyIndex];
+        _buffer.assign(_history[_historyIndex]);
         _cursor = _buffer.size();
     }
 }
@@ -471,12 +484,12 @@ void InputField::historyNext()
     ++_historyIndex;
     if (_historyIndex == _history.size())
     {
-        _buffer = _savedLine;
+        _buffer.assign(_savedLine);
         _savedLine.clear();
     }
     else
     {
-        _buffer = _history[_historyIndex];
+        _buffer.assign(_history[_historyIndex]);
     }
     _cursor = _buffer.size();
 }
@@ -495,7 +508,8 @@ void InputField::transpose()
     auto first = _buffer.substr(prevPos, pos - prevPos);
     auto second = _buffer.substr(pos, nextPos - pos);
 
-    _buffer.replace(prevPos, nextPos - prevPos, second + first);
+    _buffer.erase(prevPos, nextPos - prevPos);
+    _buffer.insert(prevPos, second + first);
     _cursor = nextPos;
 }
 
@@ -532,45 +546,35 @@ void InputField::insertText(std::string_view text)
 auto InputField::nextGraphemeCluster(std::size_t pos) const -> std::size_t
 {
     if (pos >= _buffer.size())
-        return pos;
+        return _buffer.size();
 
-    // Use libunicode utf8_grapheme_segmenter for proper grapheme cluster boundaries.
-    // The iterator's _clusterStart pointer tracks byte positions in the original string_view.
-    auto const sv = std::string_view(_buffer).substr(pos);
-    auto segmenter = unicode::utf8_grapheme_segmenter(sv);
-    auto it = segmenter.begin();
-    if (it == segmenter.end())
-        return nextUtf8(_buffer, pos);
-
-    ++it; // Advance past the first grapheme cluster
-    if (it != segmenter.end())
-    {
-        // The iterator's _clusterStart points into the original sv data
-        auto const byteOffset = static_cast<std::size_t>(it._clusterStart - sv.data());
-        return pos + byteOffset;
-    }
-
-    // The first cluster spans to the end
-    return _buffer.size();
+    // Clusters never span lines, except that a CR ending a line forms one with its line break.
+    auto const line = _buffer.lineOf(pos);
+    auto const start = _buffer.lineStart(line);
+    auto const text = _buffer.line(line);
+    if (pos - start >= text.size())
+        return pos + 1;
+    auto const next = nextGraphemeBoundary(text, pos - start);
+    if (next == text.size() && text.back() == '\r' && line + 1 < _buffer.lineCount())
+        return start + next + 1;
+    return start + next;
 }
 
 auto InputField::prevGraphemeCluster(std::size_t pos) const -> std::size_t
 {
     if (pos == 0)
         return 0;
+    pos = std::min(pos, _buffer.size());
 
-    // Segment the text up to pos and find the last cluster boundary.
-    auto const sv = std::string_view(_buffer).substr(0, pos);
-    auto segmenter = unicode::utf8_grapheme_segmenter(sv);
-
-    auto lastBoundaryOffset = std::size_t { 0 };
-    for (auto it = segmenter.begin(); it != segmenter.end(); ++it)
+    auto const line = _buffer.lineOf(pos);
+    auto const start = _buffer.lineStart(line);
+    if (pos == start)
     {
-        auto const currentOffset = static_cast<std::size_t>(it._clusterStart - sv.data());
-        lastBoundaryOffset = currentOffset;
+        // The line break before, with the CR before it if there is one
+        auto const previous = _buffer.line(line - 1);
+        return !previous.empty() && previous.back() == '\r' ? pos - 2 : pos - 1;
     }
-
-    return lastBoundaryOffset;
+    return start + previousGraphemeBoundary(_buffer.line(line), pos - start);
 }
 
 auto InputField::isWordCharAt(char c) -> bool
@@ -594,60 +598,32 @@ auto InputField::isMultiline() const noexcept -> bool
 
 auto InputField::lineCount() const noexcept -> int
 {
-    if (_buffer.empty())
-        return 1;
-
-    int count = 1;
-    for (char c : _buffer)
-    {
-        if (c == '\n')
-            ++count;
-    }
-    return count;
+    return static_cast<int>(_buffer.lineCount());
 }
 
 auto InputField::cursorLine() const noexcept -> int
 {
-    int line = 0;
-    for (std::size_t i = 0; i < _cursor && i < _buffer.size(); ++i)
-    {
-        if (_buffer[i] == '\n')
-            ++line;
-    }
-    return line;
+    return static_cast<int>(_buffer.lineOf(_cursor));
 }
 
-auto InputField::cursorColumn() const noexcept -> int
+auto InputField::cursorColumn() const -> int
 {
-    auto const lineStart = findLineStart(_cursor);
-    return countGraphemesInRange(lineStart, _cursor);
+    auto const line = _buffer.lineOf(_cursor);
+    auto const& graphemes = lineGraphemes(line);
+    auto const offset = _cursor - _buffer.lineStart(line);
+    return static_cast<int>(std::ranges::lower_bound(graphemes, offset) - graphemes.begin());
+}
+
+auto InputField::cursorLineOffset() const noexcept -> std::size_t
+{
+    return _cursor - _buffer.lineStart(_buffer.lineOf(_cursor));
 }
 
 auto InputField::lineAt(int lineIndex) const -> std::string_view
 {
-    if (lineIndex < 0)
+    if (lineIndex < 0 || lineIndex >= lineCount())
         return {};
-
-    std::size_t start = 0;
-    int currentLine = 0;
-
-    // Find start of requested line
-    while (currentLine < lineIndex && start < _buffer.size())
-    {
-        if (_buffer[start] == '\n')
-            ++currentLine;
-        ++start;
-    }
-
-    if (currentLine < lineIndex)
-        return {};  // Line index out of range
-
-    // Find end of line
-    std::size_t end = start;
-    while (end < _buffer.size() && _buffer[end] != '\n')
-        ++end;
-
-    return std::string_view(_buffer).substr(start, end - start);
+    return _buffer.line(static_cast<std::size_t>(lineIndex));
 }
 
 void InputField::setMaxLines(int maxLines)
@@ -662,63 +638,30 @@ auto InputField::maxLines() const noexcept -> int
 
 auto InputField::findLineStart(std::size_t pos) const -> std::size_t
 {
-    if (pos == 0)
-        return 0;
-
-    // Search backward for newline
-    std::size_t i = pos;
-    while (i > 0)
-    {
-        --i;
-        if (_buffer[i] == '\n')
-            return i + 1;
-    }
-    return 0;
+    return _buffer.lineStart(_buffer.lineOf(pos));
 }
 
 auto InputField::findLineEnd(std::size_t pos) const -> std::size_t
 {
-    std::size_t i = pos;
-    while (i < _buffer.size() && _buffer[i] != '\n')
-        ++i;
-    return i;
+    return _buffer.lineEnd(_buffer.lineOf(pos));
 }
 
-auto InputField::countGraphemesInRange(std::size_t start, std::size_t end) const -> int
+auto InputField::lineGraphemes(std::size_t line) const -> std::vector<std::size_t> const&
 {
-    if (start >= end || start >= _buffer.size())
-        return 0;
-
-    auto const sv = std::string_view(_buffer).substr(start, end - start);
-    auto segmenter = unicode::utf8_grapheme_segmenter(sv);
-    int count = 0;
-    for ([[maybe_unused]] auto const& cluster : segmenter)
-        ++count;
-    return count;
-}
-
-auto InputField::moveToGraphemeInLine(std::size_t lineStart, int graphemeIndex) const -> std::size_t
-{
-    auto const lineEnd = findLineEnd(lineStart);
-    if (lineStart >= lineEnd)
-        return lineStart;
-
-    auto const sv = std::string_view(_buffer).substr(lineStart, lineEnd - lineStart);
-    auto segmenter = unicode::utf8_grapheme_segmenter(sv);
-
-    int currentIndex = 0;
-    for (auto it = segmenter.begin(); it != segmenter.end(); ++it)
+    if (_graphemesRevision != _buffer.revision() || _graphemesLine != line)
     {
-        if (currentIndex >= graphemeIndex)
-        {
-            auto const offset = static_cast<std::size_t>(it._clusterStart - sv.data());
-            return lineStart + offset;
-        }
-        ++currentIndex;
+        _graphemes = graphemeBoundaries(_buffer.line(line));
+        _graphemesRevision = _buffer.revision();
+        _graphemesLine = line;
     }
+    return _graphemes;
+}
 
-    // Grapheme index exceeds line length, return end of line
-    return lineEnd;
+auto InputField::moveToGraphemeInLine(std::size_t line, int graphemeIndex) const -> std::size_t
+{
+    auto const& graphemes = lineGraphemes(line);
+    auto const index = std::min(static_cast<std::size_t>(std::max(0, graphemeIndex)), graphemes.size() - 1);
+    return _buffer.lineStart(line) + graphemes[index];
 }
 
 void InputField::moveToBufferStart()
@@ -751,16 +694,9 @@ void InputField::moveUp()
         return;
     }
 
-    // Remember current column (in graphemes)
-    auto const column = cursorColumn();
-
-    // Find start of current line, then go back to previous line
-    auto const currentLineStart = findLineStart(_cursor);
-    auto const prevLineEnd = currentLineStart > 0 ? currentLineStart - 1 : 0;
-    auto const prevLineStart = findLineStart(prevLineEnd);
-
     // Move to same column in previous line (or end if line is shorter)
-    _cursor = moveToGraphemeInLine(prevLineStart, column);
+    auto const column = cursorColumn();
+    _cursor = moveToGraphemeInLine(static_cast<std::size_t>(currentLineNum - 1), column);
 }
 
 void InputField::moveDown()
@@ -774,15 +710,9 @@ void InputField::moveDown()
         return;
     }
 
-    // Remember current column (in graphemes)
-    auto const column = cursorColumn();
-
-    // Find end of current line, then go to next line
-    auto const currentLineEnd = findLineEnd(_cursor);
-    auto const nextLineStart = currentLineEnd < _buffer.size() ? currentLineEnd + 1 : _buffer.size();
-
     // Move to same column in next line (or end if line is shorter)
-    _cursor = moveToGraphemeInLine(nextLineStart, column);
+    auto const column = cursorColumn();
+    _cursor = moveToGraphemeInLine(static_cast<std::size_t>(currentLineNum + 1), column);
 }
 
 void InputField::insertNewline()
@@ -794,7 +724,7 @@ void InputField::insertNewline()
     if (_maxLines > 0 && lineCount() >= _maxLines)
         return;
 
-    _buffer.insert(_cursor, 1, '\n');
+    _buffer.insert(_cursor, "\n");
     ++_cursor;
 }
 
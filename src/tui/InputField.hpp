@@ -2,11 +2,13 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include <tui/InputEvent.hpp>
+#include <tui/TextBuffer.hpp>
 
 namespace mychat::tui
 {
@@ -27,6 +29,10 @@ enum class InputFieldAction : std::uint8_t
 /// renders based on text() and cursor(). Operates on grapheme cluster boundaries
 /// using libunicode for correct Unicode handling.
 ///
+/// The text is kept in a TextBuffer, so editing and the line queries take the same time however
+/// much text was pasted. Renderers should prefer lineAt() over text(), which has to make the
+/// whole buffer contiguous.
+///
 /// Supports both single-line and multiline modes. In multiline mode:
 /// - Shift+Enter inserts a newline
 /// - Up/Down navigate between lines (history when on first/last line)
@@ -41,7 +47,12 @@ class InputField
     [[nodiscard]] auto processEvent(InputEvent const& event) -> InputFieldAction;
 
     /// @brief Returns the current buffer content.
-    [[nodiscard]] auto text() const noexcept -> std::string_view;
+    ///
+    /// The view is valid until the buffer changes.
+    [[nodiscard]] auto text() const -> std::string_view;
+
+    /// @brief Returns whether the buffer is empty.
+    [[nodiscard]] auto empty() const noexcept -> bool;
 
     /// @brief Returns the cursor position as a byte offset into text().
     [[nodiscard]] auto cursor() const noexcept -> std::size_t;
@@ -82,9 +93,14 @@ class InputField
     [[nodiscard]] auto cursorLine() const noexcept -> int;
 
     /// @brief Returns the current cursor column within the line (0-based, in graphemes).
-    [[nodiscard]] auto cursorColumn() const noexcept -> int;
+    [[nodiscard]] auto cursorColumn() const -> int;
+
+    /// @brief Returns the cursor position as a byte offset into its line.
+    [[nodiscard]] auto cursorLineOffset() const noexcept -> std::size_t;
 
     /// @brief Returns the content of a specific line (0-based index).
+    ///
+    /// The view is valid until the buffer changes or text() is called.
     [[nodiscard]] auto lineAt(int lineIndex) const -> std::string_view;
 
     /// @brief Sets the maximum number of lines allowed in multiline mode (0 = unlimited).
@@ -94,7 +110,7 @@ class InputField
     [[nodiscard]] auto maxLines() const noexcept -> int;
 
   private:
-    std::string _buffer;
+    TextBuffer _buffer;
     std::size_t _cursor = 0;
     std::string _prompt;
     bool _multiline = false;
@@ -106,6 +122,11 @@ class InputField
     std::string _savedLine;
     std::size_t _maxHistory = 100;
 
+    // Grapheme cluster offsets of the line last asked for, until the buffer changes
+    mutable std::vector<std::size_t> _graphemes;
+    mutable std::size_t _graphemesLine = 0;
+    mutable std::uint64_t _graphemesRevision = ~std::uint64_t { 0 };
+
     // Kill ring (Emacs-style)
     std::vector<std::string> _killRing;
     std::size_t _killRingIndex = 0;
@@ -153,8 +174,10 @@ class InputField
     // Line position helpers
     [[nodiscard]] auto findLineStart(std::size_t pos) const -> std::size_t;
     [[nodiscard]] auto findLineEnd(std::size_t pos) const -> std::size_t;
-    [[nodiscard]] auto countGraphemesInRange(std::size_t start, std::size_t end) const -> int;
-    [[nodiscard]] auto moveToGraphemeInLine(std::size_t lineStart, int graphemeIndex) const -> std::size_t;
+    [[nodiscard]] auto moveToGraphemeInLine(std::size_t line, int graphemeIndex) const -> std::size_t;
+
+    /// @brief Returns the offsets of the grapheme clusters in line @p line, followed by its length.
+    [[nodiscard]] auto lineGraphemes(std::size_t line) const -> std::vector<std::size_t> const&;
 
     // Unicode helpers (using libunicode)
     [[nodiscard]] auto nextGraphemeCluster(std::size_t pos) const -> std::size_t;
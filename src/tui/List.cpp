@@ -1,8 +1,10 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <tui/List.hpp>
+#include <tui/Unicode.hpp>
 
 #include <algorithm>
 #include <cctype>
+#include <numeric>
 
 namespace mychat::tui
 {
@@ -10,23 +12,84 @@ namespace mychat::tui
 namespace
 {
 
+constexpr auto MatchScore = 16;       ///< Per matched character.
+constexpr auto ConsecutiveBonus = 12; ///< For a character matched right after the previous one.
+constexpr auto WordStartBonus = 8;    ///< For a character matched at the start of a word.
+constexpr auto GapStartPenalty = 3;   ///< For skipping characters between matched ones...
+constexpr auto GapPenalty = 1;        ///< ...plus this per further character skipped...
+constexpr auto MaxGapPenalty = 8;     ///< ...up to this much per gap.
+constexpr auto MaxLeadingPenalty = 8; ///< For characters before the first match, one each.
+
+auto toLower(char ch) -> char
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+}
+
 auto toLower(std::string_view str) -> std::string
 {
     auto result = std::string {};
     result.reserve(str.size());
     for (auto ch: str)
-        result += static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        result += toLower(ch);
     return result;
 }
 
-auto containsIgnoreCase(std::string_view haystack, std::string_view needle) -> bool
+auto isWordStart(std::string_view text, std::size_t pos) -> bool
+{
+    return pos == 0 || !std::isalnum(static_cast<unsigned char>(text[pos - 1]));
+}
+
+/// @brief fuzzyMatchScore() of text and pattern that are already lowercase.
+auto scoreLowercase(std::string_view text, std::string_view pattern) -> std::optional<int>
 {
-    if (needle.empty())
-        return true;
+    if (pattern.empty())
+        return 0;
+
+    // Where the leftmost match ends...
+    auto matched = std::size_t { 0 };
+    auto end = std::string_view::npos;
+    for (auto i = std::size_t { 0 }; i < text.size(); ++i)
+    {
+        if (text[i] == pattern[matched] && ++matched == pattern.size())
+        {
+            end = i;
+            break;
+        }
+    }
+    if (end == std::string_view::npos)
+        return std::nullopt;
+
+    // ...and where the shortest match ending there starts.
+    auto start = end;
+    for (auto i = end + 1; i-- > 0;)
+    {
+        if (text[i] == pattern[matched - 1] && --matched == 0)
+        {
+            start = i;
+            break;
+        }
+    }
 
-    auto const lowerHaystack = toLower(haystack);
-    auto const lowerNeedle = toLower(needle);
-    return lowerHaystack.find(lowerNeedle) != std::string::npos;
+    auto score = -std::min(static_cast<int>(start), MaxLeadingPenalty);
+    auto previous = std::string_view::npos;
+    for (auto i = start; i <= end && matched < pattern.size(); ++i)
+    {
+        if (text[i] != pattern[matched])
+            continue;
+        score += MatchScore;
+        if (previous != std::string_view::npos && previous + 1 == i)
+            score += ConsecutiveBonus;
+        else if (previous != std::string_view::npos)
+        {
+            auto const skipped = static_cast<int>(i - previous - 1);
+            score -= std::min(GapStartPenalty + (skipped - 1) * GapPenalty, MaxGapPenalty);
+        }
+        if (isWordStart(text, i))
+            score += WordStartBonus;
+        previous = i;
+        ++matched;
+    }
+    return score;
 }
 
 } // namespace
@@ -34,6 +97,7 @@ auto containsIgnoreCase(std::string_view haystack, std::string_view needle) -> b
 List::List(std::vector<ListItem> items): _items(std::move(items))
 {
     _style = defaultListStyle();
+    rebuildLowerTexts();
     rebuildVisibleIndices();
 }
 
@@ -42,6 +106,7 @@ void List::setItems(std::vector<ListItem> items)
     _items = std::move(items);
     _selectedVisibleIndex = 0;
     _scrollOffset = 0;
+    rebuildLowerTexts();
     rebuildVisibleIndices();
 }
 
@@ -92,8 +157,12 @@ void List::setFilter(std::string_view filter)
     if (_filter == filter)
         return;
 
+    // Whatever matches the longer filter also matches the shorter one it extends.
+    auto lowerFilter = toLower(filter);
+    auto const refine = lowerFilter.starts_with(_lowerFilter);
     _filter = filter;
-    rebuildVisibleIndices();
+    _lowerFilter = std::move(lowerFilter);
+    rebuildVisibleIndices(refine);
 }
 
 auto List::filter() const noexcept -> std::string_view
@@ -193,7 +262,9 @@ void List::render(TerminalOutput& output, int startRow, int startCol, int width,
 
     ensureSelectionVisible(maxRows);
 
+    // Only the items in the window are looked at.
     auto const visibleCount = std::min(static_cast<std::size_t>(maxRows), _visibleIndices.size() - _scrollOffset);
+    auto const cursorWidth = displayWidth(_style.cursor);
 
     for (auto i = std::size_t { 0 }; i < static_cast<std::size_t>(maxRows); ++i)
     {
@@ -219,7 +290,6 @@ void List::render(TerminalOutput& output, int startRow, int startCol, int width,
             output.writeRaw(_style.noCursor);
 
         // Item label
-        auto const cursorWidth = static_cast<int>(_style.cursor.size() > 2 ? 2 : _style.cursor.size());
         auto const labelMaxWidth = width - cursorWidth;
 
         auto const& itemStyle = [&]() -> Style const& {
@@ -229,13 +299,16 @@ void List::render(TerminalOutput& output, int startRow, int startCol, int width,
         }();
 
         auto displayLabel = item.label;
-        if (static_cast<int>(displayLabel.size()) > labelMaxWidth)
-            displayLabel = displayLabel.substr(0, static_cast<std::size_t>(labelMaxWidth - 1)) + "\u2026";
+        if (displayWidth(displayLabel) > labelMaxWidth)
+        {
+            displayLabel.resize(columnPrefixLength(displayLabel, labelMaxWidth - 1));
+            displayLabel += "\u2026";
+        }
 
         output.write(displayLabel, itemStyle);
 
         // Padding
-        auto const labelLen = static_cast<int>(displayLabel.size());
+        auto const labelLen = displayWidth(displayLabel);
         auto const padding = std::max(0, labelMaxWidth - labelLen);
         if (padding > 0)
             output.writeRaw(std::string(static_cast<std::size_t>(padding), ' '));
@@ -347,14 +420,47 @@ void List::pageUp(int pageSize)
         selectPrevious();
 }
 
-void List::rebuildVisibleIndices()
+void List::rebuildLowerTexts()
 {
-    _visibleIndices.clear();
+    _lowerTexts.clear();
+    _lowerTextStarts.clear();
+    _lowerTextStarts.reserve(_items.size() + 1);
+    for (auto const& item: _items)
+    {
+        _lowerTextStarts.push_back(_lowerTexts.size());
+        for (auto const ch: item.filterText.empty() ? item.label : item.filterText)
+            _lowerTexts += toLower(ch);
+    }
+    _lowerTextStarts.push_back(_lowerTexts.size());
+}
 
-    for (auto i = std::size_t { 0 }; i < _items.size(); ++i)
+void List::rebuildVisibleIndices(bool refine)
+{
+    if (_lowerFilter.empty())
     {
-        if (matchesFilter(_items[i]))
-            _visibleIndices.push_back(i);
+        _visibleIndices.resize(_items.size());
+        std::iota(_visibleIndices.begin(), _visibleIndices.end(), std::size_t { 0 });
+    }
+    else
+    {
+        _ranking.clear();
+        auto const consider = [&](std::size_t index) {
+            if (auto const score = scoreLowercase(lowerText(index), _lowerFilter))
+                _ranking.emplace_back(*score, index);
+        };
+        if (refine)
+            std::ranges::for_each(_visibleIndices, consider);
+        else
+            for (auto i = std::size_t { 0 }; i < _items.size(); ++i)
+                consider(i);
+
+        // Best score first, in item order among equals.
+        std::ranges::sort(_ranking, [](auto const& a, auto const& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        _visibleIndices.clear();
+        for (auto const& [score, index]: _ranking)
+            _visibleIndices.push_back(index);
     }
 
     // Reset selection to first enabled item
@@ -382,13 +488,15 @@ void List::ensureSelectionVisible(int maxRows) const
         _scrollOffset = _selectedVisibleIndex - static_cast<std::size_t>(maxRows) + 1;
 }
 
-auto List::matchesFilter(ListItem const& item) const -> bool
+auto List::lowerText(std::size_t index) const noexcept -> std::string_view
 {
-    if (_filter.empty())
-        return true;
+    auto const start = _lowerTextStarts[index];
+    return std::string_view(_lowerTexts).substr(start, _lowerTextStarts[index + 1] - start);
+}
 
-    auto const& text = item.filterText.empty() ? item.label : item.filterText;
-    return containsIgnoreCase(text, _filter);
+auto fuzzyMatchScore(std::string_view text, std::string_view pattern) -> std::optional<int>
+{
+    return scoreLowercase(toLower(text), toLower(pattern));
 }
 
 auto defaultListStyle() -> ListStyle
@@ -8,6 +8,8 @@
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace mychat::tui
@@ -47,6 +49,11 @@ struct ListStyle
 ///
 /// Supports keyboard navigation (Up/Down, j/k, Home/End, PageUp/PageDown),
 /// filtering, and selection. Renders within a specified region.
+///
+/// Filtering matches the filter as a subsequence of each item's filter text, ignoring ASCII case,
+/// and ranks the matches by fuzzyMatchScore(). The lowercase filter texts are kept in one buffer,
+/// and a filter extending the previous one only searches the previous matches, so typing into a
+/// filter gets cheaper as the matches narrow down.
 class List
 {
   public:
@@ -81,6 +88,9 @@ class List
     void setSelectedIndex(std::size_t index);
 
     /// @brief Sets the filter text for fuzzy matching.
+    ///
+    /// The visible items become the matching ones, best match first; the first enabled one is
+    /// selected.
     /// @param filter The filter text.
     void setFilter(std::string_view filter);
 
@@ -90,7 +100,7 @@ class List
     /// @brief Clears the filter.
     void clearFilter();
 
-    /// @brief Returns the filtered/visible items.
+    /// @brief Returns the indices of the items matching the filter, in rank order.
     [[nodiscard]] auto visibleItems() const noexcept -> std::vector<std::size_t> const&;
 
     /// @brief Processes an input event and returns the resulting action.
@@ -135,18 +145,33 @@ class List
 
   private:
     std::vector<ListItem> _items;
-    std::vector<std::size_t> _visibleIndices;   ///< Indices of items matching the filter.
-    std::size_t _selectedVisibleIndex = 0;      ///< Index into _visibleIndices.
-    mutable std::size_t _scrollOffset = 0;      ///< First visible item in scroll window.
+    std::vector<std::size_t> _visibleIndices;          ///< Indices of items matching the filter.
+    std::size_t _selectedVisibleIndex = 0;             ///< Index into _visibleIndices.
+    mutable std::size_t _scrollOffset = 0;             ///< First visible item in scroll window.
     std::string _filter;
+    std::string _lowerFilter;                          ///< The filter in lowercase.
+    std::string _lowerTexts;                           ///< Lowercase filter texts, one after another.
+    std::vector<std::size_t> _lowerTextStarts;         ///< Start of each in _lowerTexts, and the end.
+    std::vector<std::pair<int, std::size_t>> _ranking; ///< Scores and indices of matches, reused.
     ListStyle _style;
 
-    void rebuildVisibleIndices();
+    void rebuildLowerTexts();
+
+    /// @brief Filters the items, or only the visible ones if @p refine is set.
+    void rebuildVisibleIndices(bool refine = false);
+
     void ensureSelectionVisible(int maxRows) const;
-    [[nodiscard]] auto matchesFilter(ListItem const& item) const -> bool;
+    [[nodiscard]] auto lowerText(std::size_t index) const noexcept -> std::string_view;
     [[nodiscard]] auto handleKey(KeyEvent const& key) -> ListAction;
 };
 
+/// @brief Scores how well @p pattern matches @p text as a subsequence, ignoring ASCII case.
+///
+/// Matched characters score, more so when they are consecutive or start a word; gaps between
+/// them and a late start cost. The shortest match ending where the leftmost one ends is scored.
+/// @return The score (higher is better), or std::nullopt if @p pattern does not occur in @p text.
+[[nodiscard]] auto fuzzyMatchScore(std::string_view text, std::string_view pattern) -> std::optional<int>;
+
 /// @brief Returns a default list style with sensible defaults.
 [[nodiscard]] auto defaultListStyle() -> ListStyle;
 
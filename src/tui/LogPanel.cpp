@@ -10,38 +10,37 @@ namespace mychat::tui
 
 void LogPanel::addLog(LogLevel level, std::string message)
 {
-    auto const lock = std::lock_guard(_mutex);
     _entries.push_back(LogEntry { .level = level, .message = std::move(message) });
     if (static_cast<int>(_entries.size()) > MaxEntries)
         _entries.pop_front();
 
     // Reset scroll to bottom when new entries arrive
     _scrollOffset = 0;
+
+    // Collapsed, only the count in the header changes.
+    _damage.add(Rect { .row = 0, .col = 0, .width = _cols, .height = _expanded ? totalHeight() : 1 });
 }
 
 void LogPanel::toggle()
 {
-    auto const lock = std::lock_guard(_mutex);
     _expanded = !_expanded;
     if (_expanded)
         _scrollOffset = 0; // Reset scroll when expanding
+    _damage.addAll();
 }
 
 auto LogPanel::isExpanded() const noexcept -> bool
 {
-    auto const lock = std::lock_guard(_mutex);
     return _expanded;
 }
 
 auto LogPanel::entryCount() const noexcept -> std::size_t
 {
-    auto const lock = std::lock_guard(_mutex);
     return _entries.size();
 }
 
 auto LogPanel::totalHeight() const noexcept -> int
 {
-    auto const lock = std::lock_guard(_mutex);
     if (!_expanded)
         return 1; // Just the header row
 
@@ -51,46 +50,14 @@ auto LogPanel::totalHeight() const noexcept -> int
 
 void LogPanel::render(TerminalOutput& output, int startRow, int cols)
 {
-    auto const lock = std::lock_guard(_mutex);
-    auto const entrySize = static_cast<int>(_entries.size());
-
-    // Header row: separator line with toggle symbol
-    output.moveTo(startRow, 1);
-    output.clearLine();
-
-    auto const* const toggleSymbol = _expanded ? "\u25BC" : "\u25B6"; // ▼ or ▶
-    auto const headerText = std::format("{} Logs ({})", toggleSymbol, entrySize);
-
-    // Draw separator with embedded header
-    auto headerStyle = Style {};
-    headerStyle.fg = static_cast<std::uint8_t>(8); // Gray
-    headerStyle.bold = true;
-
-    auto separatorStyle = Style {};
-    separatorStyle.fg = static_cast<std::uint8_t>(8); // Gray
-
-    // Draw: ── ▶ Logs (N) ───────────
-    auto const leftBar = 2;
-    auto headerPrefix = std::string {};
-    for (auto i = 0; i < leftBar; ++i)
-        headerPrefix += "\u2500"; // ─
-    headerPrefix += " ";
-
-    output.write(headerPrefix, separatorStyle);
-    output.write(headerText, headerStyle);
-    output.write(" ", separatorStyle);
-
-    // Fill rest with ─
-    auto const usedCols = leftBar + 1 + static_cast<int>(headerText.size()) + 1;
-    auto const remainingCols = std::max(0, cols - usedCols);
-    auto fillStr = std::string {};
-    for (auto i = 0; i < remainingCols; ++i)
-        fillStr += "\u2500"; // ─
-    output.write(fillStr, separatorStyle);
-
+    _damage.clear();
+    _cols = cols;
+    renderHeader(output, startRow, cols);
     if (!_expanded)
         return;
 
+    auto const entrySize = static_cast<int>(_entries.size());
+
     // Render visible entries (newest first, with scroll offset)
     auto const visibleCount = std::min(entrySize, MaxVisibleExpanded);
     auto const maxScrollable = std::max(0, entrySize - MaxVisibleExpanded);
@@ -160,15 +127,67 @@ void LogPanel::render(TerminalOutput& output, int startRow, int cols)
     }
 }
 
+void LogPanel::renderHeader(TerminalOutput& output, int startRow, int cols) const
+{
+    // Header row: separator line with toggle symbol
+    output.moveTo(startRow, 1);
+    output.clearLine();
+
+    auto const* const toggleSymbol = _expanded ? "\u25BC" : "\u25B6"; // ▼ or ▶
+    auto const headerText = std::format("{} Logs ({})", toggleSymbol, _entries.size());
+
+    // Draw separator with embedded header
+    auto headerStyle = Style {};
+    headerStyle.fg = static_cast<std::uint8_t>(8); // Gray
+    headerStyle.bold = true;
+
+    auto separatorStyle = Style {};
+    separatorStyle.fg = static_cast<std::uint8_t>(8); // Gray
+
+    // Draw: ── ▶ Logs (N) ───────────
+    auto const leftBar = 2;
+    auto headerPrefix = std::string {};
+    for (auto i = 0; i < leftBar; ++i)
+        headerPrefix += "\u2500"; // ─
+    headerPrefix += " ";
+
+    output.write(headerPrefix, separatorStyle);
+    output.write(headerText, headerStyle);
+    output.write(" ", separatorStyle);
+
+    // Fill rest with ─
+    auto const usedCols = leftBar + 1 + static_cast<int>(headerText.size()) + 1;
+    auto const remainingCols = std::max(0, cols - usedCols);
+    auto fillStr = std::string {};
+    for (auto i = 0; i < remainingCols; ++i)
+        fillStr += "\u2500"; // ─
+    output.write(fillStr, separatorStyle);
+}
+
+void LogPanel::renderDamage(TerminalOutput& output, int startRow, int cols)
+{
+    if (!_damage.dirty())
+        return;
+    if (_damage.all() || cols != _cols || _damage.region().row + _damage.region().height > 1)
+    {
+        render(output, startRow, cols);
+        return;
+    }
+    renderHeader(output, startRow, cols);
+    _damage.clear();
+}
+
+void LogPanel::invalidate()
+{
+    _damage.addAll();
+}
+
 auto LogPanel::handleClick(int /*x*/, int y, int panelStartRow) -> bool
 {
     // Click on the header row toggles the panel
     if (y == panelStartRow)
     {
-        auto const lock = std::lock_guard(_mutex);
-        _expanded = !_expanded;
-        if (_expanded)
-            _scrollOffset = 0;
+        toggle();
         return true;
     }
     return false;
@@ -176,15 +195,22 @@ auto LogPanel::handleClick(int /*x*/, int y, int panelStartRow) -> bool
 
 void LogPanel::scrollUp()
 {
-    auto const lock = std::lock_guard(_mutex);
     auto const maxScrollable = std::max(0, static_cast<int>(_entries.size()) - MaxVisibleExpanded);
-    _scrollOffset = std::min(_scrollOffset + 1, maxScrollable);
+    scrollTo(std::min(_scrollOffset + 1, maxScrollable));
 }
 
 void LogPanel::scrollDown()
 {
-    auto const lock = std::lock_guard(_mutex);
-    _scrollOffset = std::max(0, _scrollOffset - 1);
+    scrollTo(std::max(0, _scrollOffset - 1));
+}
+
+void LogPanel::scrollTo(int offset)
+{
+    if (offset == _scrollOffset)
+        return;
+    _scrollOffset = offset;
+    if (_expanded)
+        _damage.add(Rect { .row = 1, .col = 0, .width = _cols, .height = totalHeight() - 1 });
 }
 
 } // namespace mychat::tui
@@ -4,9 +4,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <deque>
-#include <mutex>
 #include <string>
 
+#include <tui/Damage.hpp>
 #include <tui/TerminalOutput.hpp>
 
 namespace mychat::tui
@@ -32,6 +32,12 @@ struct LogEntry
 /// Supports toggling between collapsed (1 header row) and expanded (header + entries)
 /// states. In expanded state, supports scrolling through entries via mouse scroll
 /// or keyboard navigation.
+///
+/// Changes damage the rows they affect: a message logged while collapsed only changes the count
+/// in the header, so renderDamage() redraws just that row.
+///
+/// The panel belongs to the UI thread; messages logged elsewhere reach it through the log queue
+/// (see log::enableQueue()).
 class LogPanel
 {
   public:
@@ -58,6 +64,18 @@ class LogPanel
     /// @param cols The terminal width in columns.
     void render(TerminalOutput& output, int startRow, int cols);
 
+    /// @brief Redraws the rows changed since the panel was last rendered, if any.
+    /// @param output The terminal output to render to.
+    /// @param startRow The 1-based row where the panel header is drawn.
+    /// @param cols The terminal width in columns.
+    void renderDamage(TerminalOutput& output, int startRow, int cols);
+
+    /// @brief Makes the whole panel dirty, e.g. after the screen was cleared.
+    void invalidate();
+
+    /// @brief Returns what changed since the panel was last rendered.
+    [[nodiscard]] auto damage() const noexcept -> Damage const& { return _damage; }
+
     /// @brief Handles a mouse click event, checking if it hits the toggle symbol or triggers scroll.
     /// @param x Column of the click (1-based).
     /// @param y Row of the click (1-based).
@@ -78,10 +96,17 @@ class LogPanel
     static constexpr int MaxVisibleExpanded = 7;
 
   private:
-    mutable std::mutex _mutex;
     std::deque<LogEntry> _entries;
     bool _expanded = false;
     int _scrollOffset = 0; ///< Scroll offset from the newest entry (0 = bottom, showing newest).
+    int _cols = 0;         ///< The width last rendered across.
+    Damage _damage;
+
+    /// @brief Draws the header row.
+    void renderHeader(TerminalOutput& output, int startRow, int cols) const;
+
+    /// @brief Scrolls to @p offset, damaging the entry rows if that moves them.
+    void scrollTo(int offset);
 };
 
 } // namespace mychat::tui
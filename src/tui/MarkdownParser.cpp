@@ -0,0 +1,515 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <tui/MarkdownParser.hpp>
+
+namespace mychat::tui
+{
+
+namespace
+{
+
+    /// @brief Whether the start of a line opens a block of some type.
+    enum class Match : std::uint8_t
+    {
+        No,
+        Yes,
+        Undecided, ///< More of the line is needed to tell.
+    };
+
+    /// @brief Result of matching the start of a line against a block type.
+    struct Opening
+    {
+        Match match = Match::No;
+        std::string_view marker; ///< The text that opens the block, if it matches.
+    };
+
+    /// @brief Matches a code fence: up to 3 spaces, then 3 or more backticks or tildes.
+    ///
+    /// The marker is the fence itself. @p complete tells whether @p line is the whole line.
+    auto matchCodeFence(std::string_view line, bool complete) -> Opening
+    {
+        auto pos = std::size_t { 0 };
+        while (pos < line.size() && pos < 3 && line[pos] == ' ')
+            ++pos;
+        if (pos == line.size())
+            return { .match = complete ? Match::No : Match::Undecided, .marker = {} };
+
+        auto const fenceChar = line[pos];
+        if (fenceChar != '`' && fenceChar != '~')
+            return {};
+
+        auto const fenceStart = pos;
+        while (pos < line.size() && line[pos] == fenceChar)
+            ++pos;
+        if (pos == line.size() && !complete)
+            return { .match = Match::Undecided, .marker = {} };
+        if (pos - fenceStart < 3)
+            return {};
+        return { .match = Match::Yes, .marker = line.substr(fenceStart, pos - fenceStart) };
+    }
+
+    /// @brief Matches a heading: 1 to 6 '#' and a space, which end the marker.
+    auto matchHeading(std::string_view line, bool complete) -> Opening
+    {
+        auto level = std::size_t { 0 };
+        while (level < line.size() && level < 6 && line[level] == '#')
+            ++level;
+        if (level == 0)
+            return {};
+        if (level == line.size())
+            return { .match = complete ? Match::No : Match::Undecided, .marker = {} };
+        if (line[level] != ' ')
+            return {};
+        return { .match = Match::Yes, .marker = line.substr(0, level + 1) };
+    }
+
+    /// @brief Matches a blockquote: '>' and an optional space.
+    auto matchBlockquote(std::string_view line, bool complete) -> Opening
+    {
+        if (line.empty() || line[0] != '>')
+            return {};
+        if (line.size() == 1 && !complete)
+            return { .match = Match::Undecided, .marker = {} };
+        return { .match = Match::Yes, .marker = line.substr(0, line.size() > 1 && line[1] == ' ' ? 2 : 1) };
+    }
+
+    /// @brief Matches a list item: indentation, then -, * or +, or a number and . or ), then a space.
+    auto matchListMarker(std::string_view line, bool complete) -> Opening
+    {
+        auto const undecided = Opening { .match = complete ? Match::No : Match::Undecided, .marker = {} };
+
+        auto pos = std::size_t { 0 };
+        while (pos < line.size() && line[pos] == ' ')
+            ++pos;
+        if (pos == line.size())
+            return undecided;
+
+        if (line[pos] != '-' && line[pos] != '*' && line[pos] != '+')
+        {
+            auto const digitStart = pos;
+            while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9')
+                ++pos;
+            if (pos == digitStart)
+                return {};
+            if (pos == line.size())
+                return undecided;
+            if (line[pos] != '.' && line[pos] != ')')
+                return {};
+        }
+
+        if (pos + 1 == line.size())
+            return undecided;
+        if (line[pos + 1] != ' ')
+            return {};
+        return { .match = Match::Yes, .marker = line.substr(0, pos + 2) };
+    }
+
+    auto headingSpan(std::size_t level) -> MarkdownSpan
+    {
+        switch (level)
+        {
+            case 1: return MarkdownSpan::Heading1;
+            case 2: return MarkdownSpan::Heading2;
+            default: return MarkdownSpan::Heading3;
+        }
+    }
+
+} // namespace
+
+void MarkdownParser::feed(std::string_view text, Sink const& sink)
+{
+    _sink = &sink;
+    for (auto const c: text)
+        processChar(c);
+    emitRun();
+    _sink = nullptr;
+}
+
+void MarkdownParser::finish(Sink const& sink)
+{
+    _sink = &sink;
+    auto const held = std::exchange(_tag, {});
+    for (auto const c: held)
+        processUntagged(c);
+    if (_lineStarted)
+        endLine();
+    emitRun();
+    _sink = nullptr;
+}
+
+auto MarkdownParser::midLine() const noexcept -> bool
+{
+    return _lineStarted;
+}
+
+void MarkdownParser::reset()
+{
+    *this = MarkdownParser {};
+}
+
+void MarkdownParser::processChar(char c)
+{
+    if (c != '\n')
+        _lineStarted = true;
+
+    if (_block == Block::Code || (_tag.empty() && c != '<'))
+    {
+        processUntagged(c);
+        return;
+    }
+
+    auto const tag = std::string_view { _block == Block::Think ? "</think>" : "<think>" };
+    _tag += c;
+    if (_tag == tag)
+    {
+        _tag.clear();
+        handleTag();
+        return;
+    }
+    if (tag.starts_with(_tag))
+        return;
+
+    // Not a tag after all. Its '<' is text; a later '<' may still start one.
+    auto const held = std::exchange(_tag, {});
+    processUntagged(held[0]);
+    for (auto const ch: std::string_view(held).substr(1))
+        processChar(ch);
+}
+
+void MarkdownParser::processUntagged(char c)
+{
+    if (c == '\n')
+    {
+        endLine();
+        return;
+    }
+
+    auto const text = std::string_view(&c, 1);
+    switch (_line)
+    {
+        case Line::Undecided:
+            if (_block == Block::Think)
+            {
+                _line = Line::Think;
+                emit(MarkdownSpan::Think, text);
+            }
+            else
+            {
+                _lineStart += c;
+                decideLine(false);
+            }
+            break;
+        case Line::Inline: inlineChar(c); break;
+        case Line::Heading: emit(_headingSpan, text); break;
+        case Line::Code: emit(MarkdownSpan::CodeBlock, text); break;
+        case Line::Think: emit(MarkdownSpan::Think, text); break;
+        case Line::Ignored: break;
+    }
+}
+
+void MarkdownParser::decideLine(bool complete)
+{
+    auto const line = std::string_view(_lineStart);
+
+    if (_block == Block::Code)
+    {
+        auto const fence = matchCodeFence(line, complete);
+        if (fence.match == Match::Undecided)
+            return;
+        if (fence.match == Match::Yes && fence.marker.size() >= _fence.size())
+        {
+            _block = Block::Normal;
+            _fence.clear();
+            _line = Line::Ignored;
+        }
+        else
+        {
+            _line = Line::Code;
+            emit(MarkdownSpan::CodeBlock, line);
+        }
+        _lineStart.clear();
+        return;
+    }
+
+    auto const fence = matchCodeFence(line, complete);
+    auto const heading = matchHeading(line, complete);
+    auto const blockquote = matchBlockquote(line, complete);
+    auto const listMarker = matchListMarker(line, complete);
+    auto const openings = { fence, heading, blockquote, listMarker };
+    if (std::ranges::any_of(openings, [](Opening const& o) { return o.match == Match::Undecided; }))
+        return;
+
+    // The markers view _lineStart, so it is cleared only once the line's start is rendered.
+    auto rest = line;
+    if (fence.match == Match::Yes)
+    {
+        _block = Block::Code;
+        _fence = fence.marker;
+        _line = Line::Ignored;
+    }
+    else if (heading.match == Match::Yes)
+    {
+        _line = Line::Heading;
+        _headingSpan = headingSpan(heading.marker.size() - 1);
+        emit(_headingSpan, rest.substr(heading.marker.size()));
+    }
+    else
+    {
+        _line = Line::Inline;
+        if (blockquote.match == Match::Yes)
+        {
+            emit(MarkdownSpan::BlockquoteMarker, blockquote.marker);
+            rest.remove_prefix(blockquote.marker.size());
+        }
+        else if (listMarker.match == Match::Yes)
+        {
+            emit(MarkdownSpan::ListMarker, listMarker.marker);
+            rest.remove_prefix(listMarker.marker.size());
+        }
+        for (auto const c: rest)
+            inlineChar(c);
+    }
+    _lineStart.clear();
+}
+
+void MarkdownParser::endLine()
+{
+    if (_line == Line::Undecided && _block != Block::Think)
+        decideLine(true);
+    if (_line == Line::Inline)
+        endInline();
+
+    // Code fences and lines holding only a think tag render nothing.
+    if (_line != Line::Ignored && (_lineVisible || !_lineHasTag))
+        emit(MarkdownSpan::LineBreak, "\n");
+
+    _line = Line::Undecided;
+    _lineStarted = false;
+    _lineVisible = false;
+    _lineHasTag = false;
+}
+
+void MarkdownParser::handleTag()
+{
+    // The tag ends what precedes it on the line, like a line break without the break.
+    if (_line == Line::Undecided && !_lineStart.empty())
+        decideLine(true);
+    if (_block == Block::Code)
+        return; // The tag is part of a fence's info string.
+    if (_line == Line::Inline)
+        endInline();
+
+    _lineHasTag = true;
+    if (_block == Block::Think)
+    {
+        _block = Block::Normal;
+        _line = _lineVisible ? Line::Inline : Line::Undecided;
+    }
+    else
+    {
+        _block = Block::Think;
+        _line = Line::Think;
+    }
+}
+
+void MarkdownParser::inlineChar(char c)
+{
+    if (!_pending.empty())
+    {
+        _pending += c;
+        resolvePending();
+        return;
+    }
+
+    if (c == '`' || c == '*' || c == '_' || c == '[')
+    {
+        _pending = c;
+        _scanned = 1;
+        _linkBracket = 0;
+        return;
+    }
+
+    emit(MarkdownSpan::Text, std::string_view(&c, 1));
+}
+
+void MarkdownParser::resolvePending()
+{
+    // Decides a span the way renderInline() would, as soon as the text seen so far settles it.
+    auto const text = std::string_view(_pending);
+    auto constexpr npos = std::string_view::npos;
+    auto const find = [&](std::string_view closer, std::size_t from) {
+        // Earlier searches covered the text before _scanned, except where a closer may straddle it.
+        auto const resumed = _scanned + 1 > closer.size() ? _scanned + 1 - closer.size() : 0;
+        return text.find(closer, std::max(from, resumed));
+    };
+    auto const wait = [&] { _scanned = text.size(); };
+
+    auto kind = MarkdownSpan::Text; // The opening character is literal unless it starts a span.
+    auto content = text.substr(0, 1);
+    auto consumed = std::size_t { 1 };
+    switch (text[0])
+    {
+        case '`': {
+            auto const endTick = find("`", 1);
+            if (endTick == npos)
+                return wait();
+            kind = MarkdownSpan::CodeInline;
+            content = text.substr(1, endTick - 1);
+            consumed = endTick + 1;
+            break;
+        }
+        case '*':
+        case '_': {
+            if (text.size() < 2)
+                return;
+            auto const doubled = text[1] == text[0];
+            if (text[0] == '_' && !doubled)
+                break;
+            auto const marker = text.substr(0, doubled ? 2 : 1);
+            auto const end = find(marker, marker.size());
+            if (end == npos)
+                return wait();
+            kind = doubled ? MarkdownSpan::Bold : MarkdownSpan::Italic;
+            content = text.substr(marker.size(), end - marker.size());
+            consumed = end + marker.size();
+            break;
+        }
+        case '[': {
+            if (_linkBracket == 0)
+            {
+                auto const bracket = find("]", 1);
+                if (bracket == npos)
+                    return wait();
+                _linkBracket = bracket;
+            }
+            if (_linkBracket + 1 == text.size())
+                return wait();
+            if (text[_linkBracket + 1] != '(')
+                break;
+            auto const paren = find(")", _linkBracket + 2);
+            if (paren == npos)
+                return wait();
+            kind = MarkdownSpan::Link;
+            content = text.substr(1, _linkBracket - 1);
+            consumed = paren + 1;
+            break;
+        }
+        default: break;
+    }
+
+    emit(kind, content);
+    auto const rest = std::exchange(_pending, {}).substr(consumed);
+    for (auto const c: rest)
+        inlineChar(c);
+}
+
+void MarkdownParser::endInline()
+{
+    // Spans not closed by the end of the line are decided by the line alone.
+    renderInline(std::exchange(_pending, {}));
+}
+
+void MarkdownParser::renderInline(std::string_view text)
+{
+    auto pos = std::size_t { 0 };
+    while (pos < text.size())
+    {
+        // Inline code: `...`
+        if (text[pos] == '`')
+        {
+            auto const endTick = text.find('`', pos + 1);
+            if (endTick != std::string_view::npos)
+            {
+                emit(MarkdownSpan::CodeInline, text.substr(pos + 1, endTick - pos - 1));
+                pos = endTick + 1;
+                continue;
+            }
+        }
+
+        // Bold: **...**
+        if (pos + 1 < text.size() && text[pos] == '*' && text[pos + 1] == '*')
+        {
+            auto const endBold = text.find("**", pos + 2);
+            if (endBold != std::string_view::npos)
+            {
+                emit(MarkdownSpan::Bold, text.substr(pos + 2, endBold - pos - 2));
+                pos = endBold + 2;
+                continue;
+            }
+        }
+
+        // Italic: *...*
+        if (text[pos] == '*')
+        {
+            auto const endItalic = text.find('*', pos + 1);
+            if (endItalic != std::string_view::npos)
+            {
+                emit(MarkdownSpan::Italic, text.substr(pos + 1, endItalic - pos - 1));
+                pos = endItalic + 1;
+                continue;
+            }
+        }
+
+        // Bold: __...__
+        if (pos + 1 < text.size() && text[pos] == '_' && text[pos + 1] == '_')
+        {
+            auto const endBold = text.find("__", pos + 2);
+            if (endBold != std::string_view::npos)
+            {
+                emit(MarkdownSpan::Bold, text.substr(pos + 2, endBold - pos - 2));
+                pos = endBold + 2;
+                continue;
+            }
+        }
+
+        // Link: [text](url)
+        if (text[pos] == '[')
+        {
+            auto const endBracket = text.find(']', pos + 1);
+            if (endBracket != std::string_view::npos && endBracket + 1 < text.size()
+                && text[endBracket + 1] == '(')
+            {
+                auto const endParen = text.find(')', endBracket + 2);
+                if (endParen != std::string_view::npos)
+                {
+                    emit(MarkdownSpan::Link, text.substr(pos + 1, endBracket - pos - 1));
+                    pos = endParen + 1;
+                    continue;
+                }
+            }
+        }
+
+        // Regular character — find the next special character
+        auto const nextSpecial = text.find_first_of("`*_[", pos + 1);
+        auto const end = (nextSpecial != std::string_view::npos) ? nextSpecial : text.size();
+        emit(MarkdownSpan::Text, text.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+void MarkdownParser::emit(MarkdownSpan kind, std::string_view text)
+{
+    if (text.empty())
+        return;
+
+    _lineVisible = true;
+    if (kind != _runKind)
+    {
+        emitRun();
+        _runKind = kind;
+    }
+    _run += text;
+}
+
+void MarkdownParser::emitRun()
+{
+    if (!_run.empty() && _sink)
+        (*_sink)(_runKind, _run);
+    _run.clear();
+}
+
+} // namespace mychat::tui
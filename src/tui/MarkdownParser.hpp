@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace mychat::tui
+{
+
+/// @brief What a span of parsed markdown is, which determines how it is styled.
+enum class MarkdownSpan : std::uint8_t
+{
+    Text,             ///< Plain text.
+    Heading1,         ///< Text of a level 1 heading.
+    Heading2,         ///< Text of a level 2 heading.
+    Heading3,         ///< Text of a heading of level 3 or deeper.
+    CodeBlock,        ///< Text inside a fenced code block.
+    CodeInline,       ///< Inline `code`, without the backticks.
+    Bold,             ///< **bold** or __bold__ text, without the markers.
+    Italic,           ///< *italic* text, without the markers.
+    Link,             ///< The text of a [link](url).
+    ListMarker,       ///< A list item's indentation and bullet or number.
+    BlockquoteMarker, ///< The > starting a blockquote line.
+    Think,            ///< Text inside <think>...</think>.
+    LineBreak,        ///< The end of a rendered line.
+};
+
+/// @brief Resumable markdown parser for streamed text.
+///
+/// Text can be fed in pieces of any size, and the spans are the same however it is split. The
+/// parser keeps its position, so feeding a piece costs time proportional to its length. Text is
+/// emitted as soon as its styling is certain: plain text right away, and an inline span once its
+/// closing marker arrives. Only what is still ambiguous is held back: the start of a line until
+/// its block type shows, an inline span until it closes or its line ends, and what could be the
+/// beginning of a <think> tag.
+///
+/// Think tags may appear anywhere in a line; a line holding nothing but a tag renders nothing.
+class MarkdownParser
+{
+  public:
+    /// @brief Receives the parsed spans, in order.
+    using Sink = std::function<void(MarkdownSpan kind, std::string_view text)>;
+
+    /// @brief Parses the next piece of the markdown text.
+    void feed(std::string_view text, Sink const& sink);
+
+    /// @brief Ends the current line as if a line break followed, if a line is started.
+    void finish(Sink const& sink);
+
+    /// @brief Returns true if text was fed since the last line break.
+    [[nodiscard]] auto midLine() const noexcept -> bool;
+
+    /// @brief Forgets all state, as if the parser was just constructed.
+    void reset();
+
+  private:
+    enum class Block : std::uint8_t
+    {
+        Normal,
+        Code,
+        Think,
+    };
+
+    /// How the rest of the current line is parsed.
+    enum class Line : std::uint8_t
+    {
+        Undecided, ///< Its start is buffered until its block type is known.
+        Inline,    ///< Inline markup: paragraphs, list items and blockquotes.
+        Heading,   ///< Plain text in a heading style.
+        Code,      ///< A line of a code block.
+        Think,     ///< A line of a think block.
+        Ignored,   ///< A code fence, which renders nothing.
+    };
+
+    Block _block = Block::Normal;
+    std::string _fence; ///< The fence that opened the current code block.
+
+    Line _line = Line::Undecided;
+    MarkdownSpan _headingSpan = MarkdownSpan::Heading1;
+    std::string _lineStart;    ///< The start of the line while it is Undecided.
+    bool _lineStarted = false; ///< Text was fed since the last line break.
+    bool _lineVisible = false; ///< Something was emitted for the current line.
+    bool _lineHasTag = false;  ///< A think tag was consumed on the current line.
+
+    std::string _pending;         ///< An inline span from its opening marker on, while undecided.
+    std::size_t _scanned = 0;     ///< Length of _pending already searched for the closing marker.
+    std::size_t _linkBracket = 0; ///< Position of a link's ] in _pending, or 0 if not found yet.
+    std::string _tag;             ///< Text that may be the beginning of a think tag.
+
+    Sink const* _sink = nullptr; ///< The sink of the current call.
+    MarkdownSpan _runKind = MarkdownSpan::Text;
+    std::string _run; ///< Text of the span being collected, emitted when the kind changes.
+
+    void processChar(char c);
+    void processUntagged(char c);
+    void decideLine(bool complete);
+    void endLine();
+    void handleTag();
+
+    void inlineChar(char c);
+    void resolvePending();
+    void endInline();
+    void renderInline(std::string_view text);
+
+    void emit(MarkdownSpan kind, std::string_view text);
+    void emitRun();
+};
+
+} // namespace mychat::tui
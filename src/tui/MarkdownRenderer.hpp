@@ -4,6 +4,8 @@
 #include <string>
 #include <string_view>
 
+#include <tui/MarkdownParser.hpp>
+#include <tui/Scrollback.hpp>
 #include <tui/TerminalOutput.hpp>
 
 namespace mychat::tui
@@ -47,12 +49,24 @@ class MarkdownRenderer
     void beginStream();
 
     /// @brief Feeds a token (partial text) for incremental rendering.
+    ///
+    /// Whatever of the token can be styled already is written to the output, without waiting for
+    /// the end of its line, but not flushed; the caller decides when. The work done is
+    /// proportional to the token's length.
     /// @param token The next chunk of text from the LLM.
     void feedToken(std::string_view token);
 
     /// @brief Ends the streaming session and flushes remaining buffered content.
     void endStream();
 
+    /// @brief Also appends everything rendered to @p scrollback from now on, or stops if it is null.
+    void recordTo(Scrollback* scrollback);
+
+    /// @brief Holds back the output while @p suspended; what is rendered meanwhile is only recorded.
+    ///
+    /// Used while the chat area shows older output, which is drawn from the recording afterwards.
+    void setSuspended(bool suspended);
+
     /// @brief Returns the default theme with sensible terminal colors.
     [[nodiscard]] static auto defaultTheme() -> MarkdownTheme;
 
@@ -60,26 +74,19 @@ class MarkdownRenderer
     TerminalOutput& _output;
     MarkdownTheme _theme;
 
-    // Streaming state
-    std::string _streamBuffer;
+    MarkdownParser _parser;
     bool _streaming = false;
-    bool _inCodeBlock = false;
-    bool _inThinkBlock = false;
-    std::string _codeFence; ///< The fence string (e.g. "```") that opened the current code block.
-
-    /// @brief Renders a single line of markdown (not inside a code block).
-    void renderLine(std::string_view line);
+    Scrollback* _scrollback = nullptr;
+    bool _suspended = false;
 
-    /// @brief Renders inline markdown elements (bold, italic, code, links).
-    void renderInline(std::string_view text);
+    /// @brief Returns the sink writing the parser's spans to the output.
+    [[nodiscard]] auto spanWriter() -> MarkdownParser::Sink;
 
-    /// @brief Processes buffered streaming content, rendering complete lines.
-    void processStreamBuffer();
+    /// @brief Writes a parsed span in its theme style.
+    void writeSpan(MarkdownSpan kind, std::string_view text);
 
-    /// @brief Renders a heading line.
-    /// @param level The heading level (1-6).
-    /// @param text The heading text.
-    void renderHeading(int level, std::string_view text);
+    /// @brief Writes @p text in the default style.
+    void writePlain(std::string_view text);
 };
 
 } // namespace mychat::tui
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <format>
+#include <utility>
+
+#include <tui/Screen.hpp>
+#include <tui/Unicode.hpp>
+
+namespace mychat::tui
+{
+
+namespace
+{
+
+    /// Longest run of unchanged cells that is rewritten rather than skipped with a cursor move.
+    constexpr auto MaxRewrittenGap = 3;
+
+    void appendCursorPosition(std::string& out, int row, int col)
+    {
+        if (col == 1)
+            out += std::format("\033[{}H", row);
+        else
+            out += std::format("\033[{};{}H", row, col);
+    }
+
+    /// @brief Appends a relative cursor movement by @p n in the direction of @p final (A, B, C or D).
+    void appendCursorStep(std::string& out, int n, char final)
+    {
+        if (n == 1)
+            out += std::format("\033[{}", final);
+        else if (n > 1)
+            out += std::format("\033[{}{}", n, final);
+    }
+
+    /// @brief Appends the shortest sequence moving the cursor; a @p fromRow of 0 means unknown.
+    void appendCursorMove(std::string& out, int fromRow, int fromCol, int toRow, int toCol)
+    {
+        if (fromRow == toRow && fromCol == toCol)
+            return;
+
+        auto absolute = std::string {};
+        appendCursorPosition(absolute, toRow, toCol);
+        if (fromRow == 0)
+        {
+            out += absolute;
+            return;
+        }
+
+        auto relative = std::string {};
+        appendCursorStep(relative, fromRow - toRow, 'A');
+        appendCursorStep(relative, toRow - fromRow, 'B');
+
+        auto horizontal = std::string {};
+        appendCursorStep(horizontal, toCol - fromCol, 'C');
+        appendCursorStep(horizontal, fromCol - toCol, 'D');
+        auto fromLineStart = std::string { "\r" };
+        appendCursorStep(fromLineStart, toCol - 1, 'C');
+        relative += horizontal.size() <= fromLineStart.size() ? horizontal : fromLineStart;
+
+        out += relative.size() < absolute.size() ? relative : absolute;
+    }
+
+} // namespace
+
+void Screen::resize(int rows, int cols)
+{
+    _rows = std::max(0, rows);
+    _cols = std::max(0, cols);
+    auto const count = static_cast<std::size_t>(_rows * _cols);
+    _front.assign(count, Cell { .text = " ", .width = UnknownWidth, .style = {} });
+    _back.assign(count, Cell {});
+    _touched.assign(count, 0);
+    _dirty.assign(static_cast<std::size_t>(_rows), 0);
+}
+
+void Screen::clear()
+{
+    std::ranges::fill(_front, Cell {});
+    std::ranges::fill(_back, Cell {});
+    std::ranges::fill(_touched, std::uint8_t { 0 });
+    std::ranges::fill(_dirty, std::uint8_t { 0 });
+}
+
+void Screen::invalidate(int firstRow, int lastRow)
+{
+    firstRow = std::max(1, firstRow);
+    lastRow = std::min(_rows, lastRow);
+    for (auto row = firstRow; row <= lastRow; ++row)
+        for (auto col = 1; col <= _cols; ++col)
+            _front[index(row, col)].width = UnknownWidth;
+}
+
+void Screen::moveTo(int row, int col)
+{
+    _row = row;
+    _col = col;
+}
+
+void Screen::write(std::string_view text, StyleId style)
+{
+    auto const rowVisible = _row >= 1 && _row <= _rows;
+    for (auto pos = std::size_t { 0 }; pos < text.size();)
+    {
+        auto const end = nextGraphemeBoundary(text, pos);
+        auto const bytes = text.substr(pos, end - pos);
+        pos = end;
+
+        auto const lead = static_cast<unsigned char>(bytes.front());
+        if (lead < 0x20 || lead == 0x7f)
+            continue;
+
+        auto const width = clusterWidth(bytes);
+        if (width == 0)
+        {
+            // Combining marks and joiners at the start of the text extend the cluster left of the cursor.
+            auto col = std::min(_col - 1, _cols);
+            if (rowVisible && col >= 1)
+            {
+                if (_back[index(_row, col)].width == 0 && col > 1)
+                    --col;
+                _back[index(_row, col)].text += bytes;
+                _touched[index(_row, col)] = 1;
+                _dirty[static_cast<std::size_t>(_row - 1)] = 1;
+            }
+            continue;
+        }
+
+        if (rowVisible && _col >= 1 && _col <= _cols)
+        {
+            if (width == 2 && _col == _cols)
+                put(_col, Cell { .text = " ", .width = 1, .style = style }); // A wide cluster does not fit.
+            else
+            {
+                auto const cellWidth = static_cast<std::uint8_t>(width);
+                put(_col, Cell { .text = std::string(bytes), .width = cellWidth, .style = style });
+                if (width == 2)
+                    put(_col + 1, Cell { .text = {}, .width = 0, .style = style });
+            }
+        }
+        _col += width;
+    }
+}
+
+void Screen::clearToEndOfLine()
+{
+    if (_row < 1 || _row > _rows)
+        return;
+    for (auto col = std::max(1, _col); col <= _cols; ++col)
+        put(col, Cell {});
+}
+
+void Screen::clearLine()
+{
+    if (_row < 1 || _row > _rows)
+        return;
+    for (auto col = 1; col <= _cols; ++col)
+        put(col, Cell {});
+}
+
+auto Screen::cell(int row, int col) const -> Cell const&
+{
+    return _back[index(row, col)];
+}
+
+void Screen::put(int col, Cell cell)
+{
+    auto const touch = [this](std::size_t i) {
+        _touched[i] = 1;
+        _dirty[i / static_cast<std::size_t>(_cols)] = 1;
+    };
+
+    auto const i = index(_row, col);
+    auto const& target = _back[i];
+    if (target.width == 0 && cell.width != 0 && col > 1)
+    {
+        // Overwriting the right half of a wide cluster erases its left half.
+        _back[i - 1] = Cell { .text = " ", .width = 1, .style = _back[i - 1].style };
+        touch(i - 1);
+    }
+    else if (target.width == 2 && cell.width != 2 && col < _cols)
+    {
+        // Overwriting the left half of a wide cluster erases its right half.
+        _back[i + 1] = Cell { .text = " ", .width = 1, .style = _back[i + 1].style };
+        touch(i + 1);
+    }
+
+    _back[i] = std::move(cell);
+    touch(i);
+}
+
+void Screen::diff(std::string& out)
+{
+    auto const changed = [this](std::size_t i) {
+        return _touched[i] != 0 && (_front[i].width == UnknownWidth || _front[i] != _back[i]);
+    };
+    // Whether the cell can be rewritten as part of a run because the terminal shows it already.
+    auto const rewritable = [this](std::size_t i) {
+        return _front[i].width == 1 && _front[i] == _back[i];
+    };
+
+    auto& styles = StyleTable::instance();
+    auto cursorRow = 0; // Unknown
+    auto cursorCol = 0;
+    auto current = DefaultStyleId;
+
+    for (auto row = 1; row <= _rows; ++row)
+    {
+        if (_dirty[static_cast<std::size_t>(row - 1)] == 0)
+            continue;
+
+        for (auto col = 1; col <= _cols;)
+        {
+            if (!changed(index(row, col)))
+            {
+                ++col;
+                continue;
+            }
+
+            // A wide cluster is written from its left half.
+            if (_back[index(row, col)].width == 0 && col > 1)
+                --col;
+            appendCursorMove(out, cursorRow, cursorCol, row, col);
+            cursorRow = row;
+            cursorCol = col;
+
+            for (auto first = true; col <= _cols; first = false)
+            {
+                if (!first && !changed(index(row, col)))
+                {
+                    // Bridge a short gap of cells the terminal shows already; moving costs more.
+                    auto gapEnd = col;
+                    while (gapEnd <= _cols && gapEnd - col < MaxRewrittenGap && rewritable(index(row, gapEnd))
+                           && !changed(index(row, gapEnd)))
+                        ++gapEnd;
+                    if (gapEnd > _cols || !changed(index(row, gapEnd)))
+                        break;
+                }
+
+                auto const i = index(row, col);
+                auto const& cell = _back[i];
+                if (cell.width != 0)
+                {
+                    out += styles.transition(current, cell.style);
+                    current = cell.style;
+                    out += cell.text;
+                    cursorCol += cell.width;
+                }
+                _front[i] = cell;
+                ++col;
+            }
+
+            // After the last column the cursor waits to wrap, which terminals handle differently.
+            if (cursorCol > _cols)
+                cursorRow = 0;
+        }
+
+        auto const first = index(row, 1);
+        std::fill_n(_touched.begin() + static_cast<std::ptrdiff_t>(first), _cols, std::uint8_t { 0 });
+        _dirty[static_cast<std::size_t>(row - 1)] = 0;
+    }
+
+    out += styles.transition(current, DefaultStyleId);
+}
+
+} // namespace mychat::tui
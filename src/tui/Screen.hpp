@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <tui/Style.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief One character cell of a Screen.
+struct Cell
+{
+    std::string text = " ";         ///< The cluster shown (UTF-8); empty for the right half of a wide one.
+    std::uint8_t width = 1;         ///< Columns the cluster takes: 1 or 2, or 0 for a wide one's right half.
+    StyleId style = DefaultStyleId; ///< The style the cluster is drawn in, from StyleTable::instance().
+
+    auto operator==(Cell const&) const -> bool = default;
+};
+
+/// @brief Double-buffered grid of cells that turns redraws into minimal terminal updates.
+///
+/// Widgets draw into the back buffer. diff() then emits only the cells that differ from the
+/// front buffer, which mirrors what the terminal shows, and makes the two equal. Cells that were
+/// not drawn since the last diff() are never emitted, so regions the screen does not manage
+/// (like a scrolling chat area) are left alone. Regions written to behind the screen's back must
+/// be invalidated, after which the cells drawn there next are emitted again.
+class Screen
+{
+  public:
+    /// @brief Resizes the grid; all of the terminal's contents are unknown afterwards.
+    void resize(int rows, int cols);
+
+    [[nodiscard]] auto rows() const noexcept -> int { return _rows; }
+    [[nodiscard]] auto columns() const noexcept -> int { return _cols; }
+
+    /// @brief Records that the terminal was cleared: both buffers become blank.
+    void clear();
+
+    /// @brief Forgets what the terminal shows in the given rows (1-based, inclusive).
+    void invalidate(int firstRow, int lastRow);
+
+    /// @brief Forgets what the terminal shows anywhere.
+    void invalidate() { invalidate(1, _rows); }
+
+    /// @brief Moves the drawing cursor (1-based). Positions off the grid clip what is drawn.
+    void moveTo(int row, int col);
+
+    /// @brief Draws @p text at the drawing cursor and advances it, clipping at the right edge.
+    ///
+    /// Control characters are skipped; escape sequences are not interpreted.
+    void write(std::string_view text, StyleId style = DefaultStyleId);
+
+    /// @brief Draws @p text in @p style, interning it in StyleTable::instance().
+    void write(std::string_view text, Style const& style)
+    {
+        write(text, StyleTable::instance().intern(style));
+    }
+
+    /// @brief Blanks the cells from the drawing cursor to the end of its row.
+    void clearToEndOfLine();
+
+    /// @brief Blanks the row of the drawing cursor.
+    void clearLine();
+
+    /// @brief Returns the back buffer's cell at the given position (1-based).
+    [[nodiscard]] auto cell(int row, int col) const -> Cell const&;
+
+    /// @brief Appends the output that updates the terminal to the back buffer, and adopts it.
+    ///
+    /// Expects the terminal's SGR state to be the default, and leaves it so.
+    void diff(std::string& out);
+
+  private:
+    /// Marks a front cell whose contents on the terminal are unknown.
+    static constexpr auto UnknownWidth = std::uint8_t { 0xff };
+
+    int _rows = 0;
+    int _cols = 0;
+    std::vector<Cell> _front;           ///< What the terminal shows.
+    std::vector<Cell> _back;            ///< What it should show.
+    std::vector<std::uint8_t> _touched; ///< Per cell: drawn since the last diff().
+    std::vector<std::uint8_t> _dirty;   ///< Per row: has touched cells.
+    int _row = 1;                       ///< Drawing cursor.
+    int _col = 1;
+
+    [[nodiscard]] auto index(int row, int col) const noexcept -> std::size_t
+    {
+        return static_cast<std::size_t>((row - 1) * _cols + (col - 1));
+    }
+
+    /// @brief Stores @p cell in the back buffer, blanking halves of wide clusters it breaks up.
+    void put(int col, Cell cell);
+};
+
+} // namespace mychat::tui
@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <limits>
+
+#include <tui/Scrollback.hpp>
+#include <tui/TerminalOutput.hpp>
+#include <tui/Unicode.hpp>
+
+namespace mychat::tui
+{
+
+// =============================================================================
+// Scrollback
+// =============================================================================
+
+Scrollback::Scrollback()
+{
+    clear();
+}
+
+void Scrollback::beginMessage()
+{
+    ++_messages;
+    auto& open = _lines.back();
+    if (open.offset == _text.size())
+        open.message = _messages;
+}
+
+void Scrollback::append(std::string_view text, Style const& style)
+{
+    if (text.empty())
+        return;
+
+    auto const id = StyleTable::instance().intern(style);
+    while (true)
+    {
+        auto const lineBreak = text.find('\n');
+        appendToOpenLine(text.substr(0, lineBreak), id);
+        if (lineBreak == std::string_view::npos)
+            break;
+
+        _lines.push_back(Line {
+            .offset = static_cast<std::uint32_t>(_text.size()),
+            .firstSpan = static_cast<std::uint32_t>(_spans.size()),
+            .message = _messages,
+        });
+        text.remove_prefix(lineBreak + 1);
+    }
+}
+
+void Scrollback::clear()
+{
+    _text.clear();
+    _lines.assign(1, Line { .offset = 0, .firstSpan = 0, .message = 0 });
+    _spans.clear();
+    _messages = 0;
+}
+
+auto Scrollback::lineText(std::size_t line) const noexcept -> std::string_view
+{
+    auto const begin = std::size_t { _lines[line].offset };
+    return std::string_view(_text).substr(begin, lineEndOffset(line) - begin);
+}
+
+auto Scrollback::lineMessage(std::size_t line) const noexcept -> std::uint32_t
+{
+    return _lines[line].message;
+}
+
+void Scrollback::appendToOpenLine(std::string_view text, StyleId style)
+{
+    while (!text.empty())
+    {
+        auto const carriageReturn = text.find('\r');
+        auto const piece = text.substr(0, carriageReturn);
+        if (!piece.empty())
+        {
+            // Consecutive text in the same style extends the open line's last span.
+            if (_spans.size() == _lines.back().firstSpan || _spans.back().style != style)
+                _spans.push_back(Span { .offset = static_cast<std::uint32_t>(_text.size()), .style = style });
+            _text.append(piece);
+        }
+        if (carriageReturn == std::string_view::npos)
+            break;
+        text.remove_prefix(carriageReturn + 1);
+    }
+}
+
+// =============================================================================
+// ScrollbackView
+// =============================================================================
+
+ScrollbackView::ScrollbackView(Scrollback const& scrollback): _scrollback(scrollback)
+{
+}
+
+void ScrollbackView::setSize(int width, int height)
+{
+    _width = std::max(0, width);
+    _height = std::max(0, height);
+}
+
+void ScrollbackView::scrollBy(int rows)
+{
+    auto const lastLine = _scrollback.lineCount() - 1;
+    if (rows < 0)
+    {
+        if (_following)
+        {
+            _line = lastLine;
+            _row = rowCount(lastLine) - 1;
+            _following = false;
+        }
+        _line = std::min(_line, lastLine);
+        _row = std::min(_row, rowCount(_line) - 1);
+
+        for (auto remaining = static_cast<std::size_t>(-static_cast<long long>(rows)); remaining > 0;)
+        {
+            if (_row >= remaining)
+            {
+                _row -= remaining;
+                break;
+            }
+            if (_line == 0)
+            {
+                _row = 0;
+                break;
+            }
+            remaining -= _row + 1;
+            --_line;
+            _row = rowCount(_line) - 1;
+        }
+
+        // The first line stops at the top of the view: the bottom row is at least a page from it.
+        auto topLine = std::size_t { 0 };
+        auto topRow = static_cast<std::size_t>(std::max(0, _height - 1));
+        for (auto count = rowCount(topLine); topRow >= count; count = rowCount(topLine))
+        {
+            if (topLine == lastLine)
+            {
+                // Everything fits in the view.
+                scrollToBottom();
+                return;
+            }
+            topRow -= count;
+            ++topLine;
+        }
+        if (_line < topLine || (_line == topLine && _row < topRow))
+        {
+            _line = topLine;
+            _row = topRow;
+        }
+    }
+    else if (rows > 0 && !_following)
+    {
+        _line = std::min(_line, lastLine);
+        _row = std::min(_row, rowCount(_line) - 1);
+
+        for (auto remaining = static_cast<std::size_t>(rows);;)
+        {
+            auto const count = rowCount(_line);
+            if (_row + remaining < count)
+            {
+                _row += remaining;
+                break;
+            }
+            if (_line == lastLine)
+            {
+                _row = count - 1;
+                break;
+            }
+            remaining -= count - _row;
+            ++_line;
+            _row = 0;
+        }
+    }
+
+    if (!_following && _line == lastLine && _row + 1 == rowCount(lastLine))
+        scrollToBottom();
+}
+
+void ScrollbackView::scrollToBottom()
+{
+    _following = true;
+    _line = 0;
+    _row = 0;
+}
+
+auto ScrollbackView::visibleRows() const -> std::vector<ScrollbackRow>
+{
+    auto rows = std::vector<ScrollbackRow> {};
+    auto const height = static_cast<std::size_t>(_height);
+    if (height == 0)
+        return rows;
+    rows.reserve(height);
+
+    // Walk up from the bottom row, wrapping only the lines that come into view.
+    auto const lastLine = _scrollback.lineCount() - 1;
+    auto line = _following ? lastLine : std::min(_line, lastLine);
+    auto row = _following ? std::numeric_limits<std::size_t>::max() : _row;
+    while (rows.size() < height)
+    {
+        auto const text = _scrollback.lineText(line);
+        auto const starts = wrapRows(text, _width);
+        for (auto r = std::min(row, starts.size() - 1); rows.size() < height; --r)
+        {
+            auto const end = r + 1 < starts.size() ? starts[r + 1] : text.size();
+            rows.push_back(ScrollbackRow { .line = line, .begin = starts[r], .end = end });
+            if (r == 0)
+                break;
+        }
+        if (line == 0)
+            break;
+        --line;
+        row = std::numeric_limits<std::size_t>::max();
+    }
+
+    std::ranges::reverse(rows);
+    return rows;
+}
+
+void ScrollbackView::render(TerminalOutput& output, int startRow) const
+{
+    auto const rows = visibleRows();
+    auto const blankRows = _height - static_cast<int>(rows.size());
+    auto const write = [&](std::string_view text, Style const& style) { output.write(text, style); };
+    for (auto i = 0; i < _height; ++i)
+    {
+        output.moveTo(startRow + i, 1);
+        if (i >= blankRows)
+        {
+            auto const& row = rows[static_cast<std::size_t>(i - blankRows)];
+            _scrollback.forEachSpan(row.line, row.begin, row.end, write);
+        }
+        output.clearToEndOfLine();
+    }
+}
+
+auto ScrollbackView::tailColumn() const -> int
+{
+    auto const text = _scrollback.lineText(_scrollback.lineCount() - 1);
+    auto const lastRow = wrapRows(text, _width).back();
+    return std::clamp(1 + displayWidth(text.substr(lastRow)), 1, std::max(1, _width));
+}
+
+auto ScrollbackView::wrapRows(std::string_view text, int width) -> std::vector<std::size_t>
+{
+    auto starts = std::vector<std::size_t> { 0 };
+    if (width <= 0)
+        return starts;
+
+    for (auto pos = std::size_t { 0 };;)
+    {
+        auto const rest = text.substr(pos);
+        auto length = columnPrefixLength(rest, width);
+        if (length == 0)
+            length = nextGraphemeBoundary(rest, 0);
+        pos += length;
+        if (pos >= text.size())
+            break;
+        starts.push_back(pos);
+    }
+    return starts;
+}
+
+auto ScrollbackView::rowCount(std::size_t line) const -> std::size_t
+{
+    return wrapRows(_scrollback.lineText(line), _width).size();
+}
+
+} // namespace mychat::tui
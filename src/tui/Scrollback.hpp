@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <tui/Style.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat::tui
+{
+
+class TerminalOutput;
+
+/// @brief Conversation output kept as styled lines, to be drawn again at any width.
+///
+/// All text lives in a single arena, without the line breaks. A line is an offset into it, and
+/// a run of fixed-size span records gives its styles as IDs in StyleTable::instance(). Appending
+/// never moves what is stored, so a long session costs little more than its text.
+///
+/// The last line is open: text appended goes there until a line break ends it. It is what the
+/// bottom row of a terminal showing the output holds.
+class Scrollback
+{
+  public:
+    Scrollback();
+
+    /// @brief Starts the next message; the lines opened from here on belong to it.
+    ///
+    /// An empty open line moves to the new message as well.
+    void beginMessage();
+
+    /// @brief Appends @p text in @p style; each line break in it ends the open line.
+    ///
+    /// Carriage returns are dropped.
+    void append(std::string_view text, Style const& style = {});
+
+    /// @brief Removes all lines and messages.
+    void clear();
+
+    /// @brief Returns the number of lines, including the open one; at least 1.
+    [[nodiscard]] auto lineCount() const noexcept -> std::size_t { return _lines.size(); }
+
+    /// @brief Returns the number of messages begun, which is the number of the current one.
+    [[nodiscard]] auto messageCount() const noexcept -> std::uint32_t { return _messages; }
+
+    /// @brief Returns the bytes allocated for the text, lines and spans.
+    [[nodiscard]] auto memoryBytes() const noexcept -> std::size_t
+    {
+        return _text.capacity() + _lines.capacity() * sizeof(Line) + _spans.capacity() * sizeof(Span);
+    }
+
+    /// @brief Returns the text of line @p line, without styles.
+    [[nodiscard]] auto lineText(std::size_t line) const noexcept -> std::string_view;
+
+    /// @brief Returns the number of the message line @p line belongs to, counting from 1, or 0 for
+    /// lines before the first message.
+    [[nodiscard]] auto lineMessage(std::size_t line) const noexcept -> std::uint32_t;
+
+    /// @brief Calls @p visit with the text and style of each span's part within bytes [begin, end)
+    /// of line @p line.
+    template <typename Visitor>
+    void forEachSpan(std::size_t line, std::size_t begin, std::size_t end, Visitor&& visit) const
+    {
+        auto const lineBegin = _lines[line].offset;
+        auto const lineEnd = lineEndOffset(line);
+        auto const from = lineBegin + std::min(begin, lineEnd - lineBegin);
+        auto const to = lineBegin + std::min(end, lineEnd - lineBegin);
+        auto const lastSpan = line + 1 < _lines.size() ? _lines[line + 1].firstSpan : _spans.size();
+        auto const& styles = StyleTable::instance();
+        for (auto i = std::size_t { _lines[line].firstSpan }; i < lastSpan; ++i)
+        {
+            auto const spanBegin = std::max<std::size_t>(_spans[i].offset, from);
+            auto const spanEnd = std::min<std::size_t>(i + 1 < lastSpan ? _spans[i + 1].offset : lineEnd, to);
+            if (spanBegin < spanEnd)
+            {
+                auto const text = std::string_view(_text).substr(spanBegin, spanEnd - spanBegin);
+                visit(text, styles.style(_spans[i].style));
+            }
+        }
+    }
+
+  private:
+    struct Line
+    {
+        std::uint32_t offset;    ///< Start of the line's text in the arena.
+        std::uint32_t firstSpan; ///< Index of the line's first span record.
+        std::uint32_t message;   ///< Number of the message the line belongs to.
+    };
+
+    struct Span
+    {
+        std::uint32_t offset; ///< Start of the span's text in the arena; it ends where the next begins.
+        StyleId style;        ///< The span's style.
+    };
+
+    std::string _text;          ///< The arena holding all lines' text.
+    std::vector<Line> _lines;
+    std::vector<Span> _spans;
+    std::uint32_t _messages = 0;
+
+    [[nodiscard]] auto lineEndOffset(std::size_t line) const noexcept -> std::size_t
+    {
+        return line + 1 < _lines.size() ? _lines[line + 1].offset : _text.size();
+    }
+
+    void appendToOpenLine(std::string_view text, StyleId style);
+};
+
+/// @brief One terminal row of a Scrollback line wrapped to a width.
+struct ScrollbackRow
+{
+    std::size_t line;  ///< Index of the line.
+    std::size_t begin; ///< Byte offset of the row's start within the line.
+    std::size_t end;   ///< Byte offset of the row's end within the line.
+};
+
+/// @brief Virtualized viewport onto a Scrollback.
+///
+/// The position is kept as the line and wrapped row shown at the bottom, so only the lines that
+/// come into view are ever wrapped: scrolling, drawing and resizing cost time proportional to
+/// the rows shown, however long the conversation. Lines wrap at grapheme clusters, the way the
+/// terminal wraps the output the first time.
+///
+/// The view follows the end of the scrollback until scrolled back, and again once scrolled down
+/// all the way.
+class ScrollbackView
+{
+  public:
+    explicit ScrollbackView(Scrollback const& scrollback);
+
+    /// @brief Sets the size of the viewport in columns and rows.
+    void setSize(int width, int height);
+
+    [[nodiscard]] auto width() const noexcept -> int { return _width; }
+    [[nodiscard]] auto height() const noexcept -> int { return _height; }
+
+    /// @brief Scrolls by @p rows: back towards older output if negative, forward if positive.
+    ///
+    /// Stops where the first line is at the top, or at the end, where the view follows again.
+    void scrollBy(int rows);
+
+    /// @brief Scrolls to the end and follows it.
+    void scrollToBottom();
+
+    /// @brief Returns whether the view shows and follows the end of the scrollback.
+    [[nodiscard]] auto following() const noexcept -> bool { return _following; }
+
+    /// @brief Returns the rows shown, top to bottom; fewer than the height if there are not as many.
+    [[nodiscard]] auto visibleRows() const -> std::vector<ScrollbackRow>;
+
+    /// @brief Draws the viewport with its top row at @p startRow.
+    ///
+    /// The text is aligned to the bottom, as output scrolled into the terminal is; rows above it
+    /// are cleared.
+    void render(TerminalOutput& output, int startRow) const;
+
+    /// @brief Returns the column, 1-based, after the end of the open line's last row.
+    ///
+    /// This is where the terminal's cursor is when the view follows and shows all of the output.
+    [[nodiscard]] auto tailColumn() const -> int;
+
+    /// @brief Returns the byte offsets where the rows of @p text wrapped at @p width start.
+    ///
+    /// There is at least one row; each holds at least one grapheme cluster.
+    [[nodiscard]] static auto wrapRows(std::string_view text, int width) -> std::vector<std::size_t>;
+
+  private:
+    Scrollback const& _scrollback;
+    int _width = 80;
+    int _height = 24;
+    bool _following = true;
+    std::size_t _line = 0; ///< The line shown at the bottom, unless following.
+    std::size_t _row = 0;  ///< The row of that line shown at the bottom, unless following.
+
+    [[nodiscard]] auto rowCount(std::size_t line) const -> std::size_t;
+};
+
+} // namespace mychat::tui
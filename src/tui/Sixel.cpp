@@ -1,234 +1,511 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <format>
+#include <iterator>
 #include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <tui/Sixel.hpp>
 
+#if defined(__AVX2__)
+    #define MYCHAT_SIXEL_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define MYCHAT_SIXEL_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define MYCHAT_SIXEL_NEON 1
+    #include <arm_neon.h>
+#endif
+
 namespace mychat::tui
 {
 
 namespace
 {
-    struct RgbPixel
+    /// @brief Colors compared at a time by SIMD nearest-color search; the palette is padded to it.
+    constexpr auto PaletteLanes = std::size_t { 8 };
+
+    /// @brief Channel value of padding colors, far enough from any real color to never be nearest.
+    constexpr auto FarAway = 10000.0f;
+
+    /// @brief Bits per channel of the quantization histogram.
+    constexpr auto HistogramBits = 5;
+    constexpr auto HistogramSide = 1 << HistogramBits;
+
+    /// @brief Fewest bands worth handing to a thread of their own.
+    constexpr auto MinBandsPerThread = 16;
+
+    /// @brief Pixels averageError() looks at, at most.
+    constexpr auto ErrorSamples = std::size_t { 4096 };
+
+    /// @brief Shortest run of equal sixels written as a repeat introducer.
+    constexpr auto MinRepeat = 4;
+
+    auto pixelAt(ImageData const& image, std::size_t index) -> SixelColor
     {
-        std::uint8_t r = 0;
-        std::uint8_t g = 0;
-        std::uint8_t b = 0;
+        return SixelColor { .r = image.pixels[index * 4],
+                            .g = image.pixels[index * 4 + 1],
+                            .b = image.pixels[index * 4 + 2] };
+    }
+
+    auto validate(ImageData const& image) -> VoidResult
+    {
+        if (image.width <= 0 || image.height <= 0)
+            return makeError(ErrorCode::InvalidArgument, "Image dimensions must be positive");
+
+        auto const pixelCount =
+            static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height);
+        if (image.pixels.size() < pixelCount * 4)
+            return makeError(ErrorCode::InvalidArgument, "Pixel data too small for given dimensions");
+        return {};
+    }
+
+    // -------------------------------------------------------------------------
+    // Quantization
+    // -------------------------------------------------------------------------
+
+    /// @brief Pixels of one histogram cell: their number and the sums of their channels.
+    struct HistogramCell
+    {
+        std::uint32_t count = 0;
+        std::uint64_t r = 0;
+        std::uint64_t g = 0;
+        std::uint64_t b = 0;
     };
 
-    struct ColorBucket
+    using Histogram = std::vector<HistogramCell>;
+
+    auto cellIndex(int r, int g, int b) -> std::size_t
     {
-        std::vector<RgbPixel> pixels;
+        return static_cast<std::size_t>((r << (2 * HistogramBits)) | (g << HistogramBits) | b);
+    }
+
+    /// @brief A box of histogram cells, inclusive on both ends of each channel.
+    struct ColorBox
+    {
+        std::array<int, 3> lo {};
+        std::array<int, 3> hi {};
+        std::uint64_t count = 0; ///< Pixels in the box.
+
+        [[nodiscard]] auto splittable() const -> bool { return lo != hi; }
     };
 
-    /// @brief Finds the channel (0=R, 1=G, 2=B) with the widest range in the bucket.
-    auto widestChannel(ColorBucket const& bucket) -> int
+    /// @brief Calls @p visit with each cell of @p box and its coordinates.
+    template <typename Visitor>
+    void forEachCell(Histogram const& histogram, ColorBox const& box, Visitor&& visit)
     {
-        auto minR = std::uint8_t { 255 };
-        auto maxR = std::uint8_t { 0 };
-        auto minG = std::uint8_t { 255 };
-        auto maxG = std::uint8_t { 0 };
-        auto minB = std::uint8_t { 255 };
-        auto maxB = std::uint8_t { 0 };
-        for (auto const& p: bucket.pixels)
+        for (auto r = box.lo[0]; r <= box.hi[0]; ++r)
+            for (auto g = box.lo[1]; g <= box.hi[1]; ++g)
+                for (auto b = box.lo[2]; b <= box.hi[2]; ++b)
+                    visit(histogram[cellIndex(r, g, b)], std::array { r, g, b });
+    }
+
+    /// @brief Shrinks @p box to the cells holding pixels, and counts them.
+    void shrink(Histogram const& histogram, ColorBox& box)
+    {
+        auto lo = std::array { HistogramSide, HistogramSide, HistogramSide };
+        auto hi = std::array { -1, -1, -1 };
+        auto count = std::uint64_t { 0 };
+        forEachCell(histogram, box, [&](HistogramCell const& cell, std::array<int, 3> const& at) {
+            if (cell.count == 0)
+                return;
+            count += cell.count;
+            for (auto c = std::size_t { 0 }; c < 3; ++c)
+            {
+                lo[c] = std::min(lo[c], at[c]);
+                hi[c] = std::max(hi[c], at[c]);
+            }
+        });
+        box.count = count;
+        if (count > 0)
         {
-            minR = std::min(minR, p.r);
-            maxR = std::max(maxR, p.r);
-            minG = std::min(minG, p.g);
-            maxG = std::max(maxG, p.g);
-            minB = std::min(minB, p.b);
-            maxB = std::max(maxB, p.b);
+            box.lo = lo;
+            box.hi = hi;
         }
-        auto const rangeR = maxR - minR;
-        auto const rangeG = maxG - minG;
-        auto const rangeB = maxB - minB;
-        if (rangeR >= rangeG && rangeR >= rangeB)
-            return 0;
-        if (rangeG >= rangeR && rangeG >= rangeB)
-            return 1;
-        return 2;
     }
 
-    /// @brief Computes the average color of a bucket.
-    auto averageColor(ColorBucket const& bucket) -> RgbPixel
+    /// @brief Splits @p box at the median of its widest channel; @p box keeps the lower half.
+    auto split(Histogram const& histogram, ColorBox& box) -> ColorBox
+    {
+        auto channel = std::size_t { 0 };
+        for (auto c = std::size_t { 1 }; c < 3; ++c)
+            if (box.hi[c] - box.lo[c] > box.hi[channel] - box.lo[channel])
+                channel = c;
+
+        auto slices = std::array<std::uint64_t, HistogramSide> {};
+        forEachCell(histogram, box, [&](HistogramCell const& cell, std::array<int, 3> const& at) {
+            slices[static_cast<std::size_t>(at[channel])] += cell.count;
+        });
+
+        // Both halves keep at least one slice, so both hold pixels after shrinking.
+        auto cut = box.lo[channel];
+        auto sum = slices[static_cast<std::size_t>(cut)];
+        while (cut + 1 < box.hi[channel] && sum * 2 < box.count)
+            sum += slices[static_cast<std::size_t>(++cut)];
+
+        auto upper = box;
+        box.hi[channel] = cut;
+        upper.lo[channel] = cut + 1;
+        shrink(histogram, box);
+        shrink(histogram, upper);
+        return upper;
+    }
+
+    auto averageColor(Histogram const& histogram, ColorBox const& box) -> SixelColor
     {
-        if (bucket.pixels.empty())
+        auto sum = HistogramCell {};
+        auto count = std::uint64_t { 0 };
+        forEachCell(histogram, box, [&](HistogramCell const& cell, std::array<int, 3> const&) {
+            count += cell.count;
+            sum.r += cell.r;
+            sum.g += cell.g;
+            sum.b += cell.b;
+        });
+        if (count == 0)
             return {};
-        auto sumR = std::uint64_t { 0 };
-        auto sumG = std::uint64_t { 0 };
-        auto sumB = std::uint64_t { 0 };
-        for (auto const& p: bucket.pixels)
+        return SixelColor { .r = static_cast<std::uint8_t>(sum.r / count),
+                            .g = static_cast<std::uint8_t>(sum.g / count),
+                            .b = static_cast<std::uint8_t>(sum.b / count) };
+    }
+
+    // -------------------------------------------------------------------------
+    // Encoding
+    // -------------------------------------------------------------------------
+
+    /// @brief Appends a row of sixels, with runs as repeat introducers and trailing blanks dropped.
+    void appendSixelRow(std::string& out, std::span<const std::uint8_t> row)
+    {
+        auto end = row.size();
+        while (end > 0 && row[end - 1] == 0)
+            --end;
+
+        for (auto x = std::size_t { 0 }; x < end;)
         {
-            sumR += p.r;
-            sumG += p.g;
-            sumB += p.b;
+            auto run = std::size_t { 1 };
+            while (x + run < end && row[x + run] == row[x])
+                ++run;
+            auto const sixel = static_cast<char>(row[x] + 63);
+            if (run >= MinRepeat)
+                std::format_to(std::back_inserter(out), "!{}{}", run, sixel);
+            else
+                out.append(run, sixel);
+            x += run;
         }
-        auto const n = static_cast<std::uint64_t>(bucket.pixels.size());
-        auto result = RgbPixel {};
-        result.r = static_cast<std::uint8_t>(sumR / n);
-        result.g = static_cast<std::uint8_t>(sumG / n);
-        result.b = static_cast<std::uint8_t>(sumB / n);
-        return result;
     }
 
-    /// @brief Median-cut color quantization.
-    /// @param pixels The input pixels.
-    /// @param maxColors Target palette size.
-    /// @return Quantized palette.
-    auto medianCut(std::vector<RgbPixel> const& pixels, int maxColors) -> std::vector<RgbPixel>
+    /// @brief Encodes bands [firstBand, endBand) of six rows each.
+    auto encodeBands(ImageData const& image, SixelPalette const& palette, int firstBand, int endBand)
+        -> std::string
     {
-        auto buckets = std::vector<ColorBucket> {};
-        buckets.push_back(ColorBucket { .pixels = pixels });
+        auto const width = static_cast<std::size_t>(image.width);
+        auto const colorCount = static_cast<std::size_t>(palette.size());
 
-        while (static_cast<int>(buckets.size()) < maxColors)
+        // The sixels of every color across the band, and which colors it uses
+        auto sixels = std::vector<std::uint8_t>(colorCount * width);
+        auto used = std::vector<bool>(colorCount);
+        auto usedColors = std::vector<std::size_t> {};
+        usedColors.reserve(colorCount);
+
+        auto out = std::string {};
+        auto last = pixelAt(image, 0);
+        auto lastIndex = static_cast<std::size_t>(palette.nearest(last));
+        for (auto band = firstBand; band < endBand; ++band)
         {
-            // Find the bucket with the most pixels
-            auto largestIdx = std::size_t { 0 };
-            auto largestSize = std::size_t { 0 };
-            for (auto i = std::size_t { 0 }; i < buckets.size(); ++i)
+            auto const top = band * 6;
+            auto const bottom = std::min(top + 6, image.height);
+            for (auto y = top; y < bottom; ++y)
             {
-                if (buckets[i].pixels.size() > largestSize)
+                auto const bit = static_cast<std::uint8_t>(1 << (y - top));
+                auto const rowStart = static_cast<std::size_t>(y) * width;
+                for (auto x = std::size_t { 0 }; x < width; ++x)
                 {
-                    largestSize = buckets[i].pixels.size();
-                    largestIdx = i;
+                    // Neighbouring pixels mostly share their color.
+                    auto const pixel = pixelAt(image, rowStart + x);
+                    if (pixel != last)
+                    {
+                        last = pixel;
+                        lastIndex = static_cast<std::size_t>(palette.nearest(pixel));
+                    }
+                    sixels[lastIndex * width + x] |= bit;
+                    if (!used[lastIndex])
+                    {
+                        used[lastIndex] = true;
+                        usedColors.push_back(lastIndex);
+                    }
                 }
             }
 
-            if (largestSize <= 1)
-                break;
+            std::ranges::sort(usedColors);
+            for (auto const color: usedColors)
+            {
+                auto const row = std::span(sixels).subspan(color * width, width);
+                std::format_to(std::back_inserter(out), "#{}", color);
+                appendSixelRow(out, row);
+                out += '$'; // Carriage return (go to beginning of same sixel band)
+                std::ranges::fill(row, std::uint8_t { 0 });
+                used[color] = false;
+            }
+            usedColors.clear();
+            out += '-'; // New line (advance to next sixel band)
+        }
+        return out;
+    }
+} // namespace
 
-            auto& bucket = buckets[largestIdx];
-            auto const channel = widestChannel(bucket);
+// =============================================================================
+// SixelPalette
+// =============================================================================
 
-            // Sort by the widest channel
-            std::ranges::sort(bucket.pixels, [channel](auto const& a, auto const& b) {
-                switch (channel)
-                {
-                    case 0: return a.r < b.r;
-                    case 1: return a.g < b.g;
-                    default: return a.b < b.b;
-                }
-            });
+SixelPalette::SixelPalette(std::vector<SixelColor> colors): _colors(std::move(colors))
+{
+    if (_colors.size() > 256)
+        _colors.resize(256);
 
-            // Split at the median
-            auto const mid = bucket.pixels.size() / 2;
-            auto newBucket = ColorBucket {};
-            newBucket.pixels.assign(bucket.pixels.begin() + static_cast<std::ptrdiff_t>(mid),
-                                    bucket.pixels.end());
-            bucket.pixels.resize(mid);
-            buckets.push_back(std::move(newBucket));
-        }
+    auto const padded = (_colors.size() + PaletteLanes - 1) / PaletteLanes * PaletteLanes;
+    _red.assign(padded, FarAway);
+    _green.assign(padded, FarAway);
+    _blue.assign(padded, FarAway);
+    for (auto i = std::size_t { 0 }; i < _colors.size(); ++i)
+    {
+        _red[i] = _colors[i].r;
+        _green[i] = _colors[i].g;
+        _blue[i] = _colors[i].b;
+    }
+}
 
-        auto palette = std::vector<RgbPixel> {};
-        palette.reserve(buckets.size());
-        for (auto const& bucket: buckets)
-            palette.push_back(averageColor(bucket));
-        return palette;
+auto SixelPalette::quantize(ImageData const& image, int maxColors) -> SixelPalette
+{
+    if (!validate(image))
+        return {};
+    maxColors = std::clamp(maxColors, 1, 256);
+
+    auto histogram = Histogram(static_cast<std::size_t>(1) << (3 * HistogramBits));
+    auto const pixelCount = static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height);
+    constexpr auto Shift = 8 - HistogramBits;
+    for (auto i = std::size_t { 0 }; i < pixelCount; ++i)
+    {
+        auto const pixel = pixelAt(image, i);
+        auto& cell = histogram[cellIndex(pixel.r >> Shift, pixel.g >> Shift, pixel.b >> Shift)];
+        ++cell.count;
+        cell.r += pixel.r;
+        cell.g += pixel.g;
+        cell.b += pixel.b;
     }
 
-    /// @brief Finds the closest palette color to the given pixel.
-    auto closestColor(RgbPixel const& pixel, std::vector<RgbPixel> const& palette) -> int
+    auto boxes = std::vector<ColorBox> {};
+    constexpr auto Top = HistogramSide - 1;
+    boxes.push_back(ColorBox { .lo = { 0, 0, 0 }, .hi = { Top, Top, Top } });
+    shrink(histogram, boxes.front());
+
+    while (static_cast<int>(boxes.size()) < maxColors)
     {
-        auto bestIdx = 0;
-        auto bestDist = std::numeric_limits<int>::max();
-        for (auto i = 0; i < static_cast<int>(palette.size()); ++i)
+        // Split the box with the most pixels that holds more than one cell
+        auto largest = boxes.end();
+        for (auto it = boxes.begin(); it != boxes.end(); ++it)
+            if (it->splittable() && (largest == boxes.end() || it->count > largest->count))
+                largest = it;
+        if (largest == boxes.end())
+            break;
+
+        auto upper = split(histogram, *largest);
+        boxes.push_back(upper);
+    }
+
+    auto colors = std::vector<SixelColor> {};
+    colors.reserve(boxes.size());
+    for (auto const& box: boxes)
+        colors.push_back(averageColor(histogram, box));
+    return SixelPalette(std::move(colors));
+}
+
+auto SixelPalette::nearest(SixelColor color) const noexcept -> int
+{
+    auto const r = static_cast<float>(color.r);
+    auto const g = static_cast<float>(color.g);
+    auto const b = static_cast<float>(color.b);
+    auto const padded = _red.size();
+
+    // Each lane keeps the nearest of the colors it sees, the first of equally near ones.
+    auto distances = std::array<float, PaletteLanes> {};
+    auto indices = std::array<float, PaletteLanes> {};
+#if defined(MYCHAT_SIXEL_AVX2)
+    auto const pr = _mm256_set1_ps(r);
+    auto const pg = _mm256_set1_ps(g);
+    auto const pb = _mm256_set1_ps(b);
+    auto best = _mm256_set1_ps(std::numeric_limits<float>::max());
+    auto bestIndex = _mm256_setzero_ps();
+    auto index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    auto const step = _mm256_set1_ps(8);
+    for (auto i = std::size_t { 0 }; i < padded; i += 8)
+    {
+        auto const dr = _mm256_sub_ps(_mm256_loadu_ps(_red.data() + i), pr);
+        auto const dg = _mm256_sub_ps(_mm256_loadu_ps(_green.data() + i), pg);
+        auto const db = _mm256_sub_ps(_mm256_loadu_ps(_blue.data() + i), pb);
+        auto const d =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)), _mm256_mul_ps(db, db));
+        auto const nearer = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, d, nearer);
+        bestIndex = _mm256_blendv_ps(bestIndex, index, nearer);
+        index = _mm256_add_ps(index, step);
+    }
+    _mm256_storeu_ps(distances.data(), best);
+    _mm256_storeu_ps(indices.data(), bestIndex);
+#elif defined(MYCHAT_SIXEL_SSE2)
+    auto const pr = _mm_set1_ps(r);
+    auto const pg = _mm_set1_ps(g);
+    auto const pb = _mm_set1_ps(b);
+    auto const step = _mm_set1_ps(8);
+    for (auto half = std::size_t { 0 }; half < 2; ++half)
+    {
+        auto best = _mm_set1_ps(std::numeric_limits<float>::max());
+        auto bestIndex = _mm_setzero_ps();
+        auto const offset = static_cast<float>(half * 4);
+        auto index = _mm_setr_ps(offset, offset + 1, offset + 2, offset + 3);
+        for (auto i = half * 4; i < padded; i += 8)
         {
-            auto const& c = palette[static_cast<std::size_t>(i)];
-            auto const dr = static_cast<int>(pixel.r) - static_cast<int>(c.r);
-            auto const dg = static_cast<int>(pixel.g) - static_cast<int>(c.g);
-            auto const db = static_cast<int>(pixel.b) - static_cast<int>(c.b);
-            auto const dist = dr * dr + dg * dg + db * db;
-            if (dist < bestDist)
-            {
-                bestDist = dist;
-                bestIdx = i;
-            }
+            auto const dr = _mm_sub_ps(_mm_loadu_ps(_red.data() + i), pr);
+            auto const dg = _mm_sub_ps(_mm_loadu_ps(_green.data() + i), pg);
+            auto const db = _mm_sub_ps(_mm_loadu_ps(_blue.data() + i), pb);
+            auto const d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            auto const nearer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(best, d);
+            bestIndex = _mm_or_ps(_mm_and_ps(nearer, index), _mm_andnot_ps(nearer, bestIndex));
+            index = _mm_add_ps(index, step);
         }
-        return bestIdx;
+        _mm_storeu_ps(distances.data() + half * 4, best);
+        _mm_storeu_ps(indices.data() + half * 4, bestIndex);
     }
-} // namespace
+#elif defined(MYCHAT_SIXEL_NEON)
+    auto const pr = vdupq_n_f32(r);
+    auto const pg = vdupq_n_f32(g);
+    auto const pb = vdupq_n_f32(b);
+    auto const step = vdupq_n_f32(8);
+    for (auto half = std::size_t { 0 }; half < 2; ++half)
+    {
+        auto best = vdupq_n_f32(std::numeric_limits<float>::max());
+        auto bestIndex = vdupq_n_f32(0);
+        auto const first = std::array { 0.0f, 1.0f, 2.0f, 3.0f };
+        auto index = vaddq_f32(vld1q_f32(first.data()), vdupq_n_f32(static_cast<float>(half * 4)));
+        for (auto i = half * 4; i < padded; i += 8)
+        {
+            auto const dr = vsubq_f32(vld1q_f32(_red.data() + i), pr);
+            auto const dg = vsubq_f32(vld1q_f32(_green.data() + i), pg);
+            auto const db = vsubq_f32(vld1q_f32(_blue.data() + i), pb);
+            auto const d = vaddq_f32(vaddq_f32(vmulq_f32(dr, dr), vmulq_f32(dg, dg)), vmulq_f32(db, db));
+            auto const nearer = vcltq_f32(d, best);
+            best = vminq_f32(best, d);
+            bestIndex = vbslq_f32(nearer, index, bestIndex);
+            index = vaddq_f32(index, step);
+        }
+        vst1q_f32(distances.data() + half * 4, best);
+        vst1q_f32(indices.data() + half * 4, bestIndex);
+    }
+#else
+    distances.fill(std::numeric_limits<float>::max());
+    for (auto i = std::size_t { 0 }; i < padded; ++i)
+    {
+        auto const dr = _red[i] - r;
+        auto const dg = _green[i] - g;
+        auto const db = _blue[i] - b;
+        auto const d = dr * dr + dg * dg + db * db;
+        auto const lane = i % PaletteLanes;
+        if (d < distances[lane])
+        {
+            distances[lane] = d;
+            indices[lane] = static_cast<float>(i);
+        }
+    }
+#endif
 
-auto encodeSixel(ImageData const& image, int maxColors) -> Result<std::string>
+    auto bestLane = std::size_t { 0 };
+    for (auto lane = std::size_t { 1 }; lane < PaletteLanes; ++lane)
+    {
+        if (distances[lane] < distances[bestLane]
+            || (distances[lane] == distances[bestLane] && indices[lane] < indices[bestLane]))
+            bestLane = lane;
+    }
+    return static_cast<int>(indices[bestLane]);
+}
+
+auto SixelPalette::averageError(ImageData const& image) const -> double
 {
-    if (image.width <= 0 || image.height <= 0)
-        return makeError(ErrorCode::InvalidArgument, "Image dimensions must be positive");
+    if (empty() || !validate(image))
+        return std::numeric_limits<double>::infinity();
 
     auto const pixelCount = static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height);
-    if (image.pixels.size() < pixelCount * 4)
-        return makeError(ErrorCode::InvalidArgument, "Pixel data too small for given dimensions");
-
-    maxColors = std::clamp(maxColors, 1, 256);
-
-    // Extract RGB pixels (ignore alpha)
-    auto pixels = std::vector<RgbPixel>(pixelCount);
-    for (auto i = std::size_t { 0 }; i < pixelCount; ++i)
+    auto const stride = std::max(std::size_t { 1 }, pixelCount / ErrorSamples);
+    auto sum = 0.0;
+    auto samples = std::size_t { 0 };
+    for (auto i = std::size_t { 0 }; i < pixelCount; i += stride)
     {
-        auto pixel = RgbPixel {};
-        pixel.r = image.pixels[i * 4];
-        pixel.g = image.pixels[i * 4 + 1];
-        pixel.b = image.pixels[i * 4 + 2];
-        pixels[i] = pixel;
+        auto const pixel = pixelAt(image, i);
+        auto const& color = _colors[static_cast<std::size_t>(nearest(pixel))];
+        auto const dr = static_cast<double>(pixel.r) - color.r;
+        auto const dg = static_cast<double>(pixel.g) - color.g;
+        auto const db = static_cast<double>(pixel.b) - color.b;
+        sum += dr * dr + dg * dg + db * db;
+        ++samples;
     }
+    return std::sqrt(sum / static_cast<double>(samples));
+}
 
-    // Quantize colors
-    auto const palette = medianCut(pixels, maxColors);
+// =============================================================================
+// Encoding
+// =============================================================================
 
-    // Map each pixel to a palette index
-    auto indexed = std::vector<int>(pixelCount);
-    for (auto i = std::size_t { 0 }; i < pixelCount; ++i)
-        indexed[i] = closestColor(pixels[i], palette);
+auto encodeSixel(ImageData const& image, int maxColors) -> Result<std::string>
+{
+    if (auto const valid = validate(image); !valid)
+        return std::unexpected(valid.error());
+    return encodeSixel(image, SixelPalette::quantize(image, maxColors));
+}
 
-    // Build sixel output
-    auto result = std::string {};
+auto encodeSixel(ImageData const& image, SixelPalette const& palette) -> Result<std::string>
+{
+    if (auto const valid = validate(image); !valid)
+        return std::unexpected(valid.error());
+    if (palette.empty())
+        return makeError(ErrorCode::InvalidArgument, "Sixel palette is empty");
 
     // Define palette: #idx;2;r%;g%;b% (percentage 0-100)
-    for (auto i = 0; i < static_cast<int>(palette.size()); ++i)
+    auto result = std::string {};
+    for (auto i = 0; auto const& c: palette.colors())
     {
-        auto const& c = palette[static_cast<std::size_t>(i)];
-        result += std::format("#{};2;{};{};{}", i, c.r * 100 / 255, c.g * 100 / 255, c.b * 100 / 255);
+        std::format_to(std::back_inserter(result),
+                       "#{};2;{};{};{}",
+                       i,
+                       c.r * 100 / 255,
+                       c.g * 100 / 255,
+                       c.b * 100 / 255);
+        ++i;
     }
 
-    // Encode sixel data: process in bands of 6 rows
-    auto const width = image.width;
-    auto const height = image.height;
-    for (auto bandY = 0; bandY < height; bandY += 6)
+    // Encode sixel data in bands of 6 rows, runs of them on threads of their own
+    auto const bands = (image.height + 5) / 6;
+    auto const hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    auto const threadCount = std::clamp(bands / MinBandsPerThread, 1, hardwareThreads);
+    auto parts = std::vector<std::string>(static_cast<std::size_t>(threadCount));
     {
-        for (auto colorIdx = 0; colorIdx < static_cast<int>(palette.size()); ++colorIdx)
+        auto threads = std::vector<std::jthread> {};
+        threads.reserve(parts.size());
+        auto const bandsFor = [&](int part) { return bands * part / threadCount; };
+        for (auto part = 1; part < threadCount; ++part)
         {
-            auto hasPixels = false;
-            auto row = std::string {};
-            for (auto x = 0; x < width; ++x)
-            {
-                auto sixelByte = std::uint8_t { 0 };
-                for (auto bit = 0; bit < 6; ++bit)
-                {
-                    auto const y = bandY + bit;
-                    if (y < height)
-                    {
-                        auto const pixelIdx = static_cast<std::size_t>(y) * static_cast<std::size_t>(width)
-                                              + static_cast<std::size_t>(x);
-                        if (indexed[pixelIdx] == colorIdx)
-                        {
-                            sixelByte |= static_cast<std::uint8_t>(1 << bit);
-                            hasPixels = true;
-                        }
-                    }
-                }
-                row += static_cast<char>(sixelByte + 63);
-            }
-            if (hasPixels)
-            {
-                result += std::format("#{}", colorIdx);
-                result += row;
-                result += '$'; // Carriage return (go to beginning of same sixel band)
-            }
+            threads.emplace_back([&, part] {
+                parts[static_cast<std::size_t>(part)] =
+                    encodeBands(image, palette, bandsFor(part), bandsFor(part + 1));
+            });
         }
-        result += '-'; // New line (advance to next sixel band)
+        parts.front() = encodeBands(image, palette, 0, bandsFor(1));
     }
 
+    for (auto const& part: parts)
+        result += part;
     return result;
 }
 
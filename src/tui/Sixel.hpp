@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <span>
 #include <string>
+#include <vector>
 
 namespace mychat::tui
 {
@@ -18,6 +19,56 @@ struct ImageData
     int height = 0;                       ///< Image height in pixels.
 };
 
+/// @brief A color of a sixel palette.
+struct SixelColor
+{
+    std::uint8_t r = 0;
+    std::uint8_t g = 0;
+    std::uint8_t b = 0;
+
+    [[nodiscard]] auto operator==(SixelColor const&) const -> bool = default;
+};
+
+/// @brief The colors an image is reduced to for sixel encoding.
+///
+/// A palette quantized from one image can encode others of similar colors, such as the frames of
+/// an animation, without quantizing each of them again; averageError() tells how well it fits.
+class SixelPalette
+{
+  public:
+    SixelPalette() = default;
+
+    /// @brief Creates a palette of the given colors; at most 256 are used.
+    explicit SixelPalette(std::vector<SixelColor> colors);
+
+    /// @brief Reduces the colors of @p image to at most @p maxColors (1-256).
+    ///
+    /// Median cut over a histogram of 5 bits per channel: the box of colors holding the most pixels
+    /// is split at the median of its widest channel until there are enough boxes. Each color is the
+    /// average of the pixels in its box.
+    [[nodiscard]] static auto quantize(ImageData const& image, int maxColors = 256) -> SixelPalette;
+
+    [[nodiscard]] auto colors() const noexcept -> std::span<const SixelColor> { return _colors; }
+    [[nodiscard]] auto size() const noexcept -> int { return static_cast<int>(_colors.size()); }
+    [[nodiscard]] auto empty() const noexcept -> bool { return _colors.empty(); }
+
+    /// @brief Returns the index of the color nearest to @p color, the first of equally near ones.
+    ///
+    /// Compares 4 or 8 colors at a time where SIMD is available. The palette must not be empty.
+    [[nodiscard]] auto nearest(SixelColor color) const noexcept -> int;
+
+    /// @brief Returns the root mean square distance of @p image's pixels to their nearest colors.
+    ///
+    /// Looks at a sample of at most a few thousand pixels, so it is cheap next to encoding.
+    [[nodiscard]] auto averageError(ImageData const& image) const -> double;
+
+  private:
+    std::vector<SixelColor> _colors;
+    std::vector<float> _red;   ///< Channels of the colors, padded with far away ones to whole
+    std::vector<float> _green; ///< SIMD registers.
+    std::vector<float> _blue;
+};
+
 /// @brief Encodes RGBA image data to a sixel string.
 ///
 /// Performs color quantization (median-cut) to reduce to the specified number
@@ -29,4 +80,10 @@ struct ImageData
 /// @return The sixel-encoded string, or an error.
 [[nodiscard]] auto encodeSixel(ImageData const& image, int maxColors = 256) -> Result<std::string>;
 
+/// @brief Encodes RGBA image data to a sixel string using the colors of @p palette.
+///
+/// Large images are encoded in parallel, a run of six-row bands per thread.
+/// @return The sixel-encoded string, or an error if the palette is empty or the image invalid.
+[[nodiscard]] auto encodeSixel(ImageData const& image, SixelPalette const& palette) -> Result<std::string>;
+
 } // namespace mychat::tui
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <tui/Spinner.hpp>
+#include <tui/Unicode.hpp>
 
 #include <algorithm>
 #include <cmath>
@@ -201,7 +202,9 @@ auto Spinner::tick() -> bool
     if (now - _lastTick >= _interval)
     {
         _lastTick = now;
+        damageFrame();
         _frameIndex = (_frameIndex + 1) % _frames.size();
+        damageFrame();
         return true;
     }
     return false;
@@ -226,13 +229,19 @@ auto Spinner::frameCount() const noexcept -> std::size_t
 
 void Spinner::reset()
 {
-    _frameIndex = 0;
+    if (_frameIndex != 0)
+    {
+        damageFrame();
+        _frameIndex = 0;
+        damageFrame();
+    }
     _lastTick = std::chrono::steady_clock::now();
 }
 
 void Spinner::render(TerminalOutput& output, Style const& style) const
 {
     output.write(currentFrame(), style);
+    _damage.clear();
 }
 
 void Spinner::renderWithLabel(TerminalOutput& output,
@@ -247,9 +256,17 @@ void Spinner::renderWithLabel(TerminalOutput& output,
 
 void Spinner::setType(SpinnerType type)
 {
+    damageFrame();
     _frames = spinnerFrames(type);
     _interval = spinnerInterval(type);
     _frameIndex = 0;
+    damageFrame();
+}
+
+void Spinner::damageFrame()
+{
+    // Frames differ in width (emoji take two cells), and the old one must be covered as well.
+    _damage.add(Rect { .row = 0, .col = 0, .width = std::max(1, displayWidth(currentFrame())), .height = 1 });
 }
 
 auto Spinner::interval() const noexcept -> std::chrono::milliseconds
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <tui/Damage.hpp>
 #include <tui/TerminalOutput.hpp>
 
 #include <array>
@@ -37,7 +38,8 @@ enum class SpinnerType : std::uint8_t
 /// @brief A loading/progress spinner animation.
 ///
 /// Tracks animation state and renders the current frame. Call tick() periodically
-/// to advance the animation.
+/// to advance the animation. Each new frame damages the spinner's cells, so the owner can repaint
+/// just them rather than whatever the spinner is drawn in.
 class Spinner
 {
   public:
@@ -66,11 +68,14 @@ class Spinner
     /// @brief Resets the spinner to the first frame.
     void reset();
 
-    /// @brief Renders the spinner at the current cursor position.
+    /// @brief Renders the spinner at the current cursor position, clearing its damage.
     /// @param output The terminal output to render to.
     /// @param style The style to apply to the spinner.
     void render(TerminalOutput& output, Style const& style = {}) const;
 
+    /// @brief Returns what changed since the spinner was last rendered.
+    [[nodiscard]] auto damage() const noexcept -> Damage const& { return _damage; }
+
     /// @brief Renders the spinner with a label.
     /// @param output The terminal output to render to.
     /// @param label The label to display after the spinner.
@@ -97,6 +102,10 @@ class Spinner
     std::chrono::milliseconds _interval;
     std::size_t _frameIndex = 0;
     std::chrono::steady_clock::time_point _lastTick;
+    mutable Damage _damage;
+
+    /// @brief Damages the cells of the current frame, before switching to another one.
+    void damageFrame();
 };
 
 /// @brief A progress bar component.
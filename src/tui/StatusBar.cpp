@@ -8,37 +8,66 @@ namespace mychat::tui
 
 void StatusBar::setHints(std::vector<KeyHint> hints)
 {
+    if (hints == _hints)
+        return;
     _hints = std::move(hints);
+    damageBar();
 }
 
 void StatusBar::addHint(std::string key, std::string action)
 {
     _hints.push_back(KeyHint { .key = std::move(key), .action = std::move(action) });
+    damageBar();
 }
 
 void StatusBar::clearHints()
 {
+    if (_hints.empty())
+        return;
     _hints.clear();
+    damageBar();
 }
 
 void StatusBar::setLeftText(std::string text)
 {
+    if (text == _leftText)
+        return;
     _leftText = std::move(text);
+    damageBar();
 }
 
 void StatusBar::setCenterText(std::string text)
 {
+    if (text == _centerText)
+        return;
     _centerText = std::move(text);
+    damageBar();
 }
 
 void StatusBar::setRightText(std::string text)
 {
+    if (text == _rightText)
+        return;
     _rightText = std::move(text);
+    damageBar();
 }
 
 void StatusBar::setStyle(StatusBarStyle style)
 {
+    if (style == _style)
+        return;
     _style = std::move(style);
+    damageBar();
+}
+
+void StatusBar::invalidate()
+{
+    _damage.addAll();
+}
+
+void StatusBar::damageBar()
+{
+    _damage.add(Rect { .row = 0, .col = 0, .width = _width, .height = 1 });
 }
 
 auto StatusBar::style() const noexcept -> StatusBarStyle const&
@@ -48,6 +77,8 @@ auto StatusBar::style() const noexcept -> StatusBarStyle const&
 
 void StatusBar::render(TerminalOutput& output, int row, int width) const
 {
+    _damage.clear();
+    _width = width;
     output.moveTo(row, 1);
 
     // Fill background
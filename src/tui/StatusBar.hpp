@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <tui/Damage.hpp>
 #include <tui/TerminalOutput.hpp>
 
 #include <string>
@@ -14,6 +15,8 @@ struct KeyHint
 {
     std::string key;        ///< The key combination (e.g., "Ctrl+C").
     std::string action;     ///< The action description (e.g., "Quit").
+
+    auto operator==(KeyHint const&) const -> bool = default;
 };
 
 /// @brief Configuration for StatusBar styling.
@@ -24,12 +27,17 @@ struct StatusBarStyle
     Style actionStyle;      ///< Style for the action description.
     Style separator;        ///< Style for separators between hints.
     std::string_view separatorChar = "  ";  ///< Character(s) between hints.
+
+    auto operator==(StatusBarStyle const&) const -> bool = default;
 };
 
 /// @brief A status bar component for displaying keyboard shortcuts and status info.
 ///
 /// Typically rendered at the bottom of the screen. Supports left, center, and right
 /// aligned sections for different types of information.
+///
+/// Setting what the bar already shows changes nothing, so an owner may set everything on each
+/// update and render only when damage() says the bar is dirty.
 class StatusBar
 {
   public:
@@ -67,7 +75,13 @@ class StatusBar
     /// @brief Returns the current style configuration.
     [[nodiscard]] auto style() const noexcept -> StatusBarStyle const&;
 
-    /// @brief Renders the status bar at the specified row.
+    /// @brief Makes the whole bar dirty, e.g. after the screen was cleared.
+    void invalidate();
+
+    /// @brief Returns what changed since the bar was last rendered.
+    [[nodiscard]] auto damage() const noexcept -> Damage const& { return _damage; }
+
+    /// @brief Renders the status bar at the specified row, clearing its damage.
     /// @param output The terminal output to render to.
     /// @param row The row to render at (1-based).
     /// @param width The width to render across.
@@ -83,6 +97,11 @@ class StatusBar
     std::string _centerText;
     std::string _rightText;
     StatusBarStyle _style;
+    mutable Damage _damage;
+    mutable int _width = 0; ///< The width last rendered across.
+
+    /// @brief Records a change of the bar; any change can move all of its sections.
+    void damageBar();
 
     [[nodiscard]] auto formatHints() const -> std::string;
     [[nodiscard]] auto hintsWidth() const -> int;
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <format>
+#include <limits>
+
+#include <tui/Style.hpp>
+
+namespace mychat::tui
+{
+
+namespace
+{
+
+    /// @brief Appends a parameter to an SGR parameter list.
+    void appendParameter(std::string& parameters, std::string_view parameter)
+    {
+        if (!parameters.empty())
+            parameters += ';';
+        parameters += parameter;
+    }
+
+    /// @brief Appends the parameters selecting @p color, based at 38 (foreground) or 48 (background).
+    ///
+    /// The default color is selected by base + 1.
+    void appendColor(std::string& parameters, Color const& color, int base)
+    {
+        if (auto const* idx = std::get_if<std::uint8_t>(&color))
+            appendParameter(parameters, std::format("{};5;{}", base, *idx));
+        else if (auto const* rgb = std::get_if<RgbColor>(&color))
+            appendParameter(parameters, std::format("{};2;{};{};{}", base, rgb->r, rgb->g, rgb->b));
+        else
+            appendParameter(parameters, std::format("{}", base + 1));
+    }
+
+    /// @brief Returns the SGR parameters that set @p style's attributes, assuming none are set.
+    auto fullParameters(Style const& style) -> std::string
+    {
+        auto parameters = std::string {};
+        if (style.bold)
+            appendParameter(parameters, "1");
+        if (style.dim)
+            appendParameter(parameters, "2");
+        if (style.italic)
+            appendParameter(parameters, "3");
+        if (style.underline)
+            appendParameter(parameters, "4");
+        if (style.inverse)
+            appendParameter(parameters, "7");
+        if (style.strikethrough)
+            appendParameter(parameters, "9");
+        if (!std::holds_alternative<std::monostate>(style.fg))
+            appendColor(parameters, style.fg, 38);
+        if (!std::holds_alternative<std::monostate>(style.bg))
+            appendColor(parameters, style.bg, 48);
+        return parameters;
+    }
+
+    /// @brief Returns the SGR parameters that change the attributes of @p from to those of @p to.
+    auto changedParameters(Style const& from, Style const& to) -> std::string
+    {
+        auto parameters = std::string {};
+
+        // Bold and dim are turned off together.
+        if ((from.bold && !to.bold) || (from.dim && !to.dim))
+        {
+            appendParameter(parameters, "22");
+            if (to.bold)
+                appendParameter(parameters, "1");
+            if (to.dim)
+                appendParameter(parameters, "2");
+        }
+        else
+        {
+            if (to.bold && !from.bold)
+                appendParameter(parameters, "1");
+            if (to.dim && !from.dim)
+                appendParameter(parameters, "2");
+        }
+
+        auto const toggle = [&](bool wasSet, bool isSet, std::string_view on, std::string_view off) {
+            if (wasSet != isSet)
+                appendParameter(parameters, isSet ? on : off);
+        };
+        toggle(from.italic, to.italic, "3", "23");
+        toggle(from.underline, to.underline, "4", "24");
+        toggle(from.inverse, to.inverse, "7", "27");
+        toggle(from.strikethrough, to.strikethrough, "9", "29");
+
+        if (from.fg != to.fg)
+            appendColor(parameters, to.fg, 38);
+        if (from.bg != to.bg)
+            appendColor(parameters, to.bg, 48);
+        return parameters;
+    }
+
+} // namespace
+
+void appendSgr(std::string& out, Style const& style)
+{
+    if (style == Style {})
+        return;
+
+    out += "\033[";
+    out += fullParameters(style);
+    out += 'm';
+}
+
+void appendSgrTransition(std::string& out, Style const& from, Style const& to)
+{
+    if (from == to)
+        return;
+
+    if (to == Style {})
+    {
+        out += "\033[m";
+        return;
+    }
+
+    // Either change what differs, or reset and set everything, whichever is shorter.
+    auto const changed = changedParameters(from, to);
+    auto const full = fullParameters(to);
+    out += "\033[";
+    if (changed.size() <= full.size() + 2)
+        out += changed;
+    else
+    {
+        out += "0;";
+        out += full;
+    }
+    out += 'm';
+}
+
+// =============================================================================
+// PackedStyle
+// =============================================================================
+
+namespace
+{
+    constexpr auto ColorMask = std::uint32_t { 0xFFFFFF };
+    constexpr auto KindShift = 24;
+    constexpr auto KindMask = std::uint32_t { 3 };
+    constexpr auto AttributeShift = 26;
+
+    // Color kinds
+    constexpr auto DefaultColor = std::uint32_t { 0 };
+    constexpr auto IndexedColor = std::uint32_t { 1 };
+    constexpr auto TrueColor = std::uint32_t { 2 };
+
+    // Attribute flags
+    constexpr auto Bold = std::uint32_t { 1 };
+    constexpr auto Italic = std::uint32_t { 2 };
+    constexpr auto Underline = std::uint32_t { 4 };
+    constexpr auto Strikethrough = std::uint32_t { 8 };
+    constexpr auto Dim = std::uint32_t { 16 };
+    constexpr auto Inverse = std::uint32_t { 32 };
+
+    auto packColor(Color const& color) -> std::uint32_t
+    {
+        if (auto const* idx = std::get_if<std::uint8_t>(&color))
+            return (IndexedColor << KindShift) | *idx;
+        if (auto const* rgb = std::get_if<RgbColor>(&color))
+        {
+            auto const value = (std::uint32_t { rgb->r } << 16) | (std::uint32_t { rgb->g } << 8) | rgb->b;
+            return (TrueColor << KindShift) | value;
+        }
+        return DefaultColor << KindShift;
+    }
+
+    auto unpackColor(std::uint32_t word) -> Color
+    {
+        auto const value = word & ColorMask;
+        switch ((word >> KindShift) & KindMask)
+        {
+            case IndexedColor: return static_cast<std::uint8_t>(value);
+            case TrueColor:
+                return RgbColor { .r = static_cast<std::uint8_t>(value >> 16),
+                                  .g = static_cast<std::uint8_t>(value >> 8),
+                                  .b = static_cast<std::uint8_t>(value) };
+            default: return std::monostate {};
+        }
+    }
+} // namespace
+
+PackedStyle::PackedStyle(Style const& style) noexcept: _fg(packColor(style.fg)), _bg(packColor(style.bg))
+{
+    auto attributes = std::uint32_t { 0 };
+    attributes |= style.bold ? Bold : 0;
+    attributes |= style.italic ? Italic : 0;
+    attributes |= style.underline ? Underline : 0;
+    attributes |= style.strikethrough ? Strikethrough : 0;
+    attributes |= style.dim ? Dim : 0;
+    attributes |= style.inverse ? Inverse : 0;
+    _fg |= attributes << AttributeShift;
+}
+
+auto PackedStyle::unpack() const noexcept -> Style
+{
+    auto const attributes = _fg >> AttributeShift;
+    return Style {
+        .fg = unpackColor(_fg),
+        .bg = unpackColor(_bg),
+        .bold = (attributes & Bold) != 0,
+        .italic = (attributes & Italic) != 0,
+        .underline = (attributes & Underline) != 0,
+        .strikethrough = (attributes & Strikethrough) != 0,
+        .dim = (attributes & Dim) != 0,
+        .inverse = (attributes & Inverse) != 0,
+    };
+}
+
+// =============================================================================
+// StyleTable
+// =============================================================================
+
+StyleTable::StyleTable()
+{
+    _entries.push_back(Entry { .style = {}, .packed = {}, .sgr = {} });
+    _ids.emplace(PackedStyle {}.bits(), DefaultStyleId);
+}
+
+auto StyleTable::instance() -> StyleTable&
+{
+    static auto table = StyleTable {};
+    return table;
+}
+
+auto StyleTable::intern(Style const& style) -> StyleId
+{
+    auto const packed = PackedStyle(style);
+    if (auto const found = _ids.find(packed.bits()); found != _ids.end())
+        return found->second;
+    if (_entries.size() > std::numeric_limits<StyleId>::max())
+        return DefaultStyleId;
+
+    auto const id = static_cast<StyleId>(_entries.size());
+    auto& entry = _entries.emplace_back(Entry { .style = style, .packed = packed, .sgr = {} });
+    appendSgr(entry.sgr, style);
+    _ids.emplace(packed.bits(), id);
+    return id;
+}
+
+auto StyleTable::transition(StyleId from, StyleId to) -> std::string_view
+{
+    if (from == to)
+        return {};
+    if (from == DefaultStyleId)
+        return _entries[to].sgr; // Nothing to turn off, so all of it is set.
+
+    auto const key = (std::uint32_t { from } << 16) | to;
+    if (auto const found = _transitions.find(key); found != _transitions.end())
+        return found->second;
+
+    if (_transitions.size() >= TransitionCapacity)
+        _transitions.clear();
+    auto& sgr = _transitions[key];
+    appendSgrTransition(sgr, _entries[from].style, _entries[to].style);
+    return sgr;
+}
+
+} // namespace mychat::tui
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief RGB color representation.
+struct RgbColor
+{
+    std::uint8_t r = 0;
+    std::uint8_t g = 0;
+    std::uint8_t b = 0;
+
+    auto operator==(RgbColor const&) const -> bool = default;
+};
+
+/// @brief Color representation: default, 256-color index, or true color (RGB).
+using Color = std::variant<std::monostate, std::uint8_t, RgbColor>;
+
+/// @brief Text styling attributes for terminal output.
+struct Style
+{
+    Color fg;                   ///< Foreground color.
+    Color bg;                   ///< Background color.
+    bool bold = false;          ///< Bold text.
+    bool italic = false;        ///< Italic text.
+    bool underline = false;     ///< Underlined text.
+    bool strikethrough = false; ///< Strikethrough text.
+    bool dim = false;           ///< Dim/faint text.
+    bool inverse = false;       ///< Inverse/reverse video.
+
+    auto operator==(Style const&) const -> bool = default;
+};
+
+/// @brief Appends the SGR (Select Graphic Rendition) sequence that sets @p style's attributes.
+///
+/// Appends nothing for the default style. Attributes set before are not reset.
+void appendSgr(std::string& out, Style const& style);
+
+/// @brief Appends the shortest SGR sequence that changes the terminal's attributes from @p from to
+/// @p to.
+///
+/// Appends nothing if both are equal, and the SGR reset if @p to is the default style.
+void appendSgrTransition(std::string& out, Style const& from, Style const& to);
+
+/// @brief A Style packed into 8 bytes, compared as one integer.
+///
+/// Each color is a 32-bit word of a 24-bit value and a 2-bit kind (default, indexed, RGB); the
+/// attribute flags take the top bits of the foreground's word.
+class PackedStyle
+{
+  public:
+    constexpr PackedStyle() = default;
+    explicit PackedStyle(Style const& style) noexcept;
+
+    [[nodiscard]] auto unpack() const noexcept -> Style;
+
+    /// @brief Returns all of the style as one integer; equal styles have equal bits.
+    [[nodiscard]] auto bits() const noexcept -> std::uint64_t { return (std::uint64_t { _fg } << 32) | _bg; }
+
+    auto operator==(PackedStyle const&) const -> bool = default;
+
+  private:
+    std::uint32_t _fg = 0; ///< Color in bits 0-23, its kind in 24-25, attributes in 26-31.
+    std::uint32_t _bg = 0; ///< Color in bits 0-23, its kind in 24-25.
+};
+
+/// @brief Identifies a style in a StyleTable.
+using StyleId = std::uint16_t;
+
+/// @brief The ID of the default style in every StyleTable.
+constexpr auto DefaultStyleId = StyleId { 0 };
+
+/// @brief Interns styles as 16-bit IDs, with their SGR sequences encoded once.
+///
+/// Screen cells and scrollback spans store IDs instead of styles, which keeps them small and makes
+/// comparing styles an integer compare. Widgets and themes use a handful of styles, so each one's
+/// SGR sequence and the transitions between recently used pairs are encoded once instead of for
+/// every span written. IDs stay valid for the table's lifetime.
+///
+/// Not thread-safe; the shared instance() belongs to the UI thread.
+class StyleTable
+{
+  public:
+    StyleTable();
+
+    /// @brief Returns the table shared by screens, scrollbacks and themes.
+    [[nodiscard]] static auto instance() -> StyleTable&;
+
+    /// @brief Returns the ID of @p style, adding it if new.
+    ///
+    /// Once all 65536 IDs are taken, new styles get the default style's.
+    [[nodiscard]] auto intern(Style const& style) -> StyleId;
+
+    [[nodiscard]] auto style(StyleId id) const noexcept -> Style const& { return _entries[id].style; }
+    [[nodiscard]] auto packed(StyleId id) const noexcept -> PackedStyle { return _entries[id].packed; }
+
+    /// @brief Returns what appendSgr() appends for the style.
+    [[nodiscard]] auto sgr(StyleId id) const noexcept -> std::string_view { return _entries[id].sgr; }
+
+    /// @brief Returns what appendSgrTransition() appends for the styles @p from and @p to.
+    ///
+    /// The view is valid until the next call.
+    [[nodiscard]] auto transition(StyleId from, StyleId to) -> std::string_view;
+
+    /// @brief Returns the number of styles interned, including the default one.
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return _entries.size(); }
+
+  private:
+    /// @brief Transitions remembered before starting over; the styles in use change rarely.
+    static constexpr auto TransitionCapacity = std::size_t { 4096 };
+
+    struct Entry
+    {
+        Style style;
+        PackedStyle packed;
+        std::string sgr;
+    };
+
+    std::vector<Entry> _entries;
+    std::unordered_map<std::uint64_t, StyleId> _ids;             ///< By packed bits.
+    std::unordered_map<std::uint32_t, std::string> _transitions; ///< By both IDs.
+};
+
+} // namespace mychat::tui
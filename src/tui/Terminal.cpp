@@ -82,6 +82,11 @@ auto Terminal::poll(int timeoutMs) -> std::vector<InputEvent>
     return _input.poll(timeoutMs);
 }
 
+void Terminal::wake() noexcept
+{
+    _input.wake();
+}
+
 auto Terminal::columns() const noexcept -> int
 {
     return _output.columns();
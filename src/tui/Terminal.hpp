@@ -45,6 +45,9 @@ class Terminal
     /// @return Vector of parsed events.
     [[nodiscard]] auto poll(int timeoutMs = -1) -> std::vector<InputEvent>;
 
+    /// @brief Convenience: wakes a blocked poll() from any thread. See TerminalInput::wake().
+    void wake() noexcept;
+
     /// @brief Returns terminal width in columns.
     [[nodiscard]] auto columns() const noexcept -> int;
 
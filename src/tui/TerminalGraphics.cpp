@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <core/Base64.hpp>
+#include <tui/TerminalGraphics.hpp>
+
+namespace mychat::tui
+{
+
+namespace
+{
+    /// @brief Longest payload of one kitty graphics escape sequence.
+    constexpr auto KittyChunkSize = std::size_t { 4096 };
+
+    /// @brief Kitty only deletes transferred temporary files with this in their path.
+    constexpr auto KittyTempFilePrefix = std::string_view("tty-graphics-protocol-mychat-");
+
+    auto equals(char const* value, std::string_view expected) -> bool
+    {
+        return value != nullptr && std::string_view(value) == expected;
+    }
+
+    auto pixelBytes(ImageData const& image) -> std::size_t
+    {
+        return static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * 4;
+    }
+
+    auto validate(ImageData const& image) -> VoidResult
+    {
+        if (image.width <= 0 || image.height <= 0)
+            return makeError(ErrorCode::InvalidArgument, "Image dimensions must be positive");
+        if (image.pixels.size() < pixelBytes(image))
+            return makeError(ErrorCode::InvalidArgument, "Pixel data too small for given dimensions");
+        return {};
+    }
+
+    auto compress(std::span<const std::uint8_t> data) -> Result<std::vector<std::uint8_t>>
+    {
+        auto compressed = std::vector<std::uint8_t>(compressBound(static_cast<uLong>(data.size())));
+        auto size = static_cast<uLongf>(compressed.size());
+        // Screenshots are sent once; fast compression gets most of the gain.
+        if (compress2(compressed.data(), &size, data.data(), static_cast<uLong>(data.size()), Z_BEST_SPEED)
+            != Z_OK)
+            return makeError(ErrorCode::Unknown, "Cannot compress image");
+        compressed.resize(size);
+        return compressed;
+    }
+
+    auto systemError(std::string_view what) -> Error
+    {
+        return Error { .code = ErrorCode::IoError,
+                       .message = std::format("{}: {}", what, std::strerror(errno)) };
+    }
+
+    /// @brief Writes all of @p data to @p fd and closes it.
+    auto writeAndClose(int fd, std::span<const std::uint8_t> data) -> VoidResult
+    {
+        while (!data.empty())
+        {
+            auto const written = ::write(fd, data.data(), data.size());
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+            {
+                auto error = systemError("Cannot write image");
+                ::close(fd);
+                return std::unexpected(std::move(error));
+            }
+            data = data.subspan(static_cast<std::size_t>(written));
+        }
+        ::close(fd);
+        return {};
+    }
+
+    void appendUint32(std::vector<std::uint8_t>& out, std::uint32_t value)
+    {
+        for (auto shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+
+    void appendPngChunk(std::vector<std::uint8_t>& out,
+                        std::string_view type,
+                        std::span<const std::uint8_t> data)
+    {
+        appendUint32(out, static_cast<std::uint32_t>(data.size()));
+        auto const start = out.size();
+        out.insert(out.end(), type.begin(), type.end());
+        out.insert(out.end(), data.begin(), data.end());
+        auto const crc = crc32(0, out.data() + start, static_cast<uInt>(out.size() - start));
+        appendUint32(out, static_cast<std::uint32_t>(crc));
+    }
+} // namespace
+
+// =============================================================================
+// Detection
+// =============================================================================
+
+auto detectImageCapabilities(EnvironmentLookup const& lookup) -> ImageCapabilities
+{
+    auto capabilities = ImageCapabilities {};
+    auto const* const termProgram = lookup("TERM_PROGRAM");
+    if (lookup("KITTY_WINDOW_ID") != nullptr || equals(lookup("TERM"), "xterm-kitty")
+        || equals(lookup("TERM"), "xterm-ghostty") || equals(termProgram, "ghostty"))
+        capabilities.protocol = ImageProtocol::Kitty;
+    else if (equals(termProgram, "iTerm.app") || equals(termProgram, "WezTerm")
+             || equals(lookup("LC_TERMINAL"), "iTerm2"))
+        capabilities.protocol = ImageProtocol::ITerm2;
+
+    capabilities.local = lookup("SSH_CONNECTION") == nullptr && lookup("SSH_CLIENT") == nullptr
+                         && lookup("SSH_TTY") == nullptr;
+    return capabilities;
+}
+
+auto detectImageCapabilities() -> ImageCapabilities
+{
+    return detectImageCapabilities([](char const* name) -> char const* { return std::getenv(name); });
+}
+
+// =============================================================================
+// Kitty
+// =============================================================================
+
+auto encodeKittyImage(ImageData const& image) -> Result<std::string>
+{
+    if (auto const valid = validate(image); !valid)
+        return std::unexpected(valid.error());
+    auto const compressed = compress(image.pixels.first(pixelBytes(image)));
+    if (!compressed)
+        return std::unexpected(compressed.error());
+
+    auto const payload = encodeBase64(*compressed);
+    auto result = std::string {};
+    result.reserve(payload.size() + payload.size() / KittyChunkSize * 16 + 64);
+    for (auto offset = std::size_t { 0 }; offset < payload.size(); offset += KittyChunkSize)
+    {
+        auto const chunk = std::string_view(payload).substr(offset, KittyChunkSize);
+        auto const more = offset + KittyChunkSize < payload.size() ? 1 : 0;
+        // Only the first chunk carries the keys; the rest just say whether more follow.
+        if (offset == 0)
+            std::format_to(std::back_inserter(result),
+                           "\033_Ga=T,f=32,s={},v={},o=z,q=2,m={};{}\033\\",
+                           image.width,
+                           image.height,
+                           more,
+                           chunk);
+        else
+            std::format_to(std::back_inserter(result), "\033_Gm={};{}\033\\", more, chunk);
+    }
+    return result;
+}
+
+auto encodeKittyImageReference(ImageData const& image, KittyMedium medium, std::string_view name)
+    -> std::string
+{
+    auto const nameBytes = std::span(reinterpret_cast<std::uint8_t const*>(name.data()), name.size());
+    return std::format("\033_Ga=T,f=32,s={},v={},t={},q=2;{}\033\\",
+                       image.width,
+                       image.height,
+                       medium == KittyMedium::SharedMemory ? 's' : 't',
+                       encodeBase64(nameBytes));
+}
+
+auto shareKittyImage(ImageData const& image, KittyMedium medium) -> Result<std::string>
+{
+    if (auto const valid = validate(image); !valid)
+        return std::unexpected(valid.error());
+    auto const pixels = image.pixels.first(pixelBytes(image));
+
+    if (medium == KittyMedium::SharedMemory)
+    {
+        static auto counter = std::atomic<unsigned> { 0 };
+        auto const number = counter.fetch_add(1, std::memory_order_relaxed);
+        auto name = std::format("/mychat-image-{}-{}", ::getpid(), number);
+        auto const fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+            return std::unexpected(systemError("Cannot create shared memory for image"));
+        if (auto written = writeAndClose(fd, pixels); !written)
+        {
+            ::shm_unlink(name.c_str());
+            return std::unexpected(written.error());
+        }
+        return name;
+    }
+
+    auto const* const tmpdir = std::getenv("TMPDIR");
+    auto const* const directory = tmpdir != nullptr && *tmpdir != '\0' ? tmpdir : "/tmp";
+    auto path = std::format("{}/{}XXXXXX", directory, KittyTempFilePrefix);
+    auto const fd = ::mkstemp(path.data());
+    if (fd < 0)
+        return std::unexpected(systemError("Cannot create temporary file for image"));
+    if (auto written = writeAndClose(fd, pixels); !written)
+    {
+        ::unlink(path.c_str());
+        return std::unexpected(written.error());
+    }
+    return path;
+}
+
+// =============================================================================
+// iTerm2
+// =============================================================================
+
+auto encodePng(ImageData const& image) -> Result<std::vector<std::uint8_t>>
+{
+    if (auto const valid = validate(image); !valid)
+        return std::unexpected(valid.error());
+
+    // Each row starts with its filter type, 0 for none.
+    auto const stride = static_cast<std::size_t>(image.width) * 4;
+    auto rows = std::vector<std::uint8_t> {};
+    rows.reserve((stride + 1) * static_cast<std::size_t>(image.height));
+    for (auto y = std::size_t { 0 }; y < static_cast<std::size_t>(image.height); ++y)
+    {
+        rows.push_back(0);
+        auto const row = image.pixels.subspan(y * stride, stride);
+        rows.insert(rows.end(), row.begin(), row.end());
+    }
+    auto const compressed = compress(rows);
+    if (!compressed)
+        return std::unexpected(compressed.error());
+
+    auto header = std::vector<std::uint8_t> {};
+    appendUint32(header, static_cast<std::uint32_t>(image.width));
+    appendUint32(header, static_cast<std::uint32_t>(image.height));
+    // 8 bits per channel, RGBA, deflate, no filtering, no interlacing
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+    auto png = std::vector<std::uint8_t> { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.reserve(png.size() + compressed->size() + 64);
+    appendPngChunk(png, "IHDR", header);
+    appendPngChunk(png, "IDAT", *compressed);
+    appendPngChunk(png, "IEND", {});
+    return png;
+}
+
+auto encodeITerm2Image(ImageData const& image) -> Result<std::string>
+{
+    auto const png = encodePng(image);
+    if (!png)
+        return std::unexpected(png.error());
+    return std::format("\033]1337;File=inline=1;size={};width={}px;height={}px;preserveAspectRatio=1:{}\a",
+                       png->size(),
+                       image.width,
+                       image.height,
+                       encodeBase64(*png));
+}
+
+} // namespace mychat::tui
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <core/Error.hpp>
+#include <tui/Sixel.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief How images are sent to the terminal.
+enum class ImageProtocol : std::uint8_t
+{
+    Sixel,  ///< DCS sixel data, quantized to a palette.
+    Kitty,  ///< Kitty graphics protocol (APC G); RGBA sent as is.
+    ITerm2, ///< iTerm2 inline images (OSC 1337); the image sent as PNG.
+};
+
+/// @brief What the terminal can do with images, and how it can be reached.
+struct ImageCapabilities
+{
+    ImageProtocol protocol = ImageProtocol::Sixel;
+    bool local = false; ///< Whether the terminal runs on this machine, so it can read its files.
+};
+
+/// @brief Looks up an environment variable; returns nullptr if it is not set.
+using EnvironmentLookup = std::function<char const*(char const*)>;
+
+/// @brief Tells the image protocol of the terminal from the environment it set.
+///
+/// Kitty and Ghostty are recognized by KITTY_WINDOW_ID, TERM or TERM_PROGRAM, iTerm2 and WezTerm
+/// by TERM_PROGRAM or LC_TERMINAL (which iTerm2 also forwards over SSH). Anything else gets sixel.
+/// A session is local unless the SSH_CONNECTION, SSH_CLIENT or SSH_TTY variables are set.
+[[nodiscard]] auto detectImageCapabilities(EnvironmentLookup const& lookup) -> ImageCapabilities;
+
+/// @brief Detects the image capabilities from the process environment.
+[[nodiscard]] auto detectImageCapabilities() -> ImageCapabilities;
+
+/// @brief Where a kitty terminal reads pixels transferred outside of the escape sequence.
+enum class KittyMedium : std::uint8_t
+{
+    SharedMemory, ///< A POSIX shared memory object (t=s).
+    TempFile,     ///< A temporary file (t=t).
+};
+
+/// @brief Returns the kitty sequence displaying @p image with its pixels compressed in the sequence.
+///
+/// The pixels are zlib-compressed and base64-encoded (o=z), in chunks of at most 4096 bytes as the
+/// protocol requires, so it works over any connection.
+[[nodiscard]] auto encodeKittyImage(ImageData const& image) -> Result<std::string>;
+
+/// @brief Returns the kitty sequence displaying @p image from pixels placed in @p medium at @p name.
+///
+/// The terminal removes the shared memory object or file once it has read it.
+[[nodiscard]] auto encodeKittyImageReference(ImageData const& image,
+                                             KittyMedium medium,
+                                             std::string_view name) -> std::string;
+
+/// @brief Places the pixels of @p image where a kitty terminal on this machine can read them.
+/// @return The name of the shared memory object or the path of the temporary file.
+[[nodiscard]] auto shareKittyImage(ImageData const& image, KittyMedium medium) -> Result<std::string>;
+
+/// @brief Encodes @p image as a PNG (8-bit RGBA, no filtering).
+[[nodiscard]] auto encodePng(ImageData const& image) -> Result<std::vector<std::uint8_t>>;
+
+/// @brief Returns the iTerm2 sequence displaying @p image inline at its size in pixels.
+[[nodiscard]] auto encodeITerm2Image(ImageData const& image) -> Result<std::string>;
+
+} // namespace mychat::tui
@@ -35,6 +35,39 @@ namespace
     constexpr auto DisableMouseTracking = "\033[?1000l";
     constexpr auto EnableBracketedPaste = "\033[?2004h";
     constexpr auto DisableBracketedPaste = "\033[?2004l";
+
+    /// How long a bare ESC waits for the rest of an escape sequence.
+    constexpr auto EscapeTimeoutMs = 50;
+
+    /// How much input one read takes; large enough that a big paste needs few system calls.
+    constexpr auto ReadChunkSize = std::size_t { 64 } * 1024;
+
+    /// @brief Creates a pipe whose ends never block.
+    auto createNonBlockingPipe(int (&fds)[2]) -> bool
+    {
+        if (pipe(fds) == -1)
+            return false;
+        for (auto const fd: fds)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        return true;
+    }
+
+    void closePipe(int (&fds)[2])
+    {
+        if (fds[0] == -1)
+            return;
+        close(fds[0]);
+        close(fds[1]);
+        fds[0] = -1;
+        fds[1] = -1;
+    }
+
+    void drainPipe(int fd)
+    {
+        auto buf = std::array<char, 64> {};
+        while (read(fd, buf.data(), buf.size()) > 0)
+            ;
+    }
 } // namespace
 
 TerminalInput::TerminalInput() = default;
@@ -56,6 +89,10 @@ auto TerminalInput::initialize() -> VoidResult
     auto const flags = fcntl(_resizePipe[0], F_GETFL, 0);
     fcntl(_resizePipe[0], F_SETFL, flags | O_NONBLOCK);
 
+    // A full wake pipe already has a wake pending, so writers never need to block.
+    if (!createNonBlockingPipe(_wakePipe))
+        return makeError(ErrorCode::IoError, "Failed to create wake-up pipe");
+
     enableRawMode();
     enableProtocols();
 
@@ -77,15 +114,21 @@ void TerminalInput::shutdown()
         _resizePipe[0] = -1;
         _resizePipe[1] = -1;
     }
+    closePipe(_wakePipe);
 }
 
 auto TerminalInput::poll(int timeoutMs) -> std::vector<InputEvent>
 {
-    auto fds = std::array<struct pollfd, 2> {};
+    if (_parser.hasPendingEscape() && (timeoutMs < 0 || timeoutMs > EscapeTimeoutMs))
+        timeoutMs = EscapeTimeoutMs;
+
+    auto fds = std::array<struct pollfd, 3> {};
     fds[0] = { .fd = _fd, .events = POLLIN, .revents = 0 };
     fds[1] = { .fd = _resizePipe[0], .events = POLLIN, .revents = 0 };
+    fds[2] = { .fd = _wakePipe[0], .events = POLLIN, .revents = 0 };
 
-    auto const nfds = (_resizePipe[0] != -1) ? 2 : 1;
+    // Both pipes exist once initialized; poll() ignores negative descriptors before that.
+    auto const nfds = (_resizePipe[0] != -1) ? 3 : 1;
     auto const pollResult = ::poll(fds.data(), static_cast<nfds_t>(nfds), timeoutMs);
 
     if (pollResult <= 0)
@@ -98,6 +141,10 @@ auto TerminalInput::poll(int timeoutMs) -> std::vector<InputEvent>
 
     auto events = std::vector<InputEvent> {};
 
+    // A wake produces no event; the caller checks what it was woken for.
+    if (nfds >= 3 && (fds[2].revents & POLLIN) != 0)
+        drainPipe(_wakePipe[0]);
+
     // Check resize pipe
     if (nfds >= 2 && (fds[1].revents & POLLIN) != 0)
     {
@@ -115,14 +162,10 @@ auto TerminalInput::poll(int timeoutMs) -> std::vector<InputEvent>
     // Check stdin
     if ((fds[0].revents & POLLIN) != 0)
     {
-        auto buf = std::array<char, 512> {};
+        auto buf = std::array<char, ReadChunkSize> {};
         auto const n = read(_fd, buf.data(), buf.size());
         if (n > 0)
-        {
-            auto parsed = _parser.feed(std::string_view(buf.data(), static_cast<size_t>(n)));
-            events.insert(
-                events.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
-        }
+            _parser.feed(std::string_view(buf.data(), static_cast<size_t>(n)), events);
     }
 
     return events;
@@ -138,6 +181,16 @@ void TerminalInput::notifyResize(int /*cols*/, int /*rows*/)
     }
 }
 
+void TerminalInput::wake() noexcept
+{
+    if (_wakePipe[1] != -1)
+    {
+        auto const byte = char { 1 };
+        auto const result = write(_wakePipe[1], &byte, 1);
+        static_cast<void>(result);
+    }
+}
+
 auto TerminalInput::resizePipeReadFd() const noexcept -> int
 {
     return _resizePipe[0];
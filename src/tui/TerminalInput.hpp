@@ -17,7 +17,8 @@ namespace mychat::tui
 ///
 /// Manages raw mode, enables Kitty keyboard protocol, SGR mouse reporting,
 /// and bracketed paste. Uses poll() for non-blocking reads with timeout.
-/// SIGWINCH is handled via a self-pipe pattern for thread-safe resize notification.
+/// SIGWINCH is handled via a self-pipe pattern for thread-safe resize notification, and a second
+/// self-pipe lets other threads wake a blocked poll().
 class TerminalInput
 {
   public:
@@ -37,10 +38,17 @@ class TerminalInput
     void shutdown();
 
     /// @brief Polls for input events with optional timeout.
+    ///
+    /// A bare ESC still waiting to be told apart from an escape sequence shortens the timeout.
     /// @param timeoutMs -1 = block indefinitely, 0 = non-blocking, >0 = timeout in milliseconds.
-    /// @return Vector of parsed events (empty on timeout or no data).
+    /// @return Vector of parsed events (empty on timeout, wake() or no data).
     [[nodiscard]] auto poll(int timeoutMs = -1) -> std::vector<InputEvent>;
 
+    /// @brief Makes a blocked poll() return, or the next one if none is blocked.
+    ///
+    /// Safe to call from any thread and from signal handlers. Wakes coalesce until poll() runs.
+    void wake() noexcept;
+
     /// @brief Injects a synthetic resize event.
     ///
     /// Writes to the self-pipe to wake poll(). Typically called from a SIGWINCH handler.
@@ -57,6 +65,7 @@ class TerminalInput
     struct termios _origTermios {};
     bool _rawMode = false;
     int _resizePipe[2] = { -1, -1 }; ///< Self-pipe for SIGWINCH.
+    int _wakePipe[2] = { -1, -1 };   ///< Self-pipe for wake().
 
     void enableRawMode();
     void disableRawMode();
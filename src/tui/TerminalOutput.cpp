@@ -11,6 +11,23 @@
 namespace mychat::tui
 {
 
+namespace
+{
+    /// @brief Returns the kitty sequence for @p image, passing its pixels out of band if possible.
+    auto kittySequence(ImageData const& image, bool local) -> Result<std::string>
+    {
+        if (local)
+        {
+            for (auto const medium: { KittyMedium::SharedMemory, KittyMedium::TempFile })
+            {
+                if (auto const name = shareKittyImage(image, medium))
+                    return encodeKittyImageReference(image, medium, *name);
+            }
+        }
+        return encodeKittyImage(image);
+    }
+} // namespace
+
 // --- SyncGuard ---
 
 SyncGuard::SyncGuard(int fd): _fd(fd)
@@ -25,41 +42,82 @@ SyncGuard::~SyncGuard()
     static_cast<void>(::write(_fd, End, std::strlen(End)));
 }
 
+// --- FrameGuard ---
+
+FrameGuard::FrameGuard(TerminalOutput& output): _output(output)
+{
+    _output.beginFrame();
+}
+
+FrameGuard::~FrameGuard()
+{
+    _output.endFrame();
+}
+
 // --- TerminalOutput ---
 
 auto TerminalOutput::initialize() -> VoidResult
 {
     updateDimensions();
+    _imageCapabilities = detectImageCapabilities();
     return {};
 }
 
 void TerminalOutput::write(std::string_view text, Style const& style)
 {
-    appendSgr(style);
+    if (inFrame())
+    {
+        _screen.write(text, style);
+        return;
+    }
+    invalidateFromCursor();
+    setSgr(style);
     _buffer.append(text);
-    appendSgrReset();
 }
 
 void TerminalOutput::writeRaw(std::string_view text)
 {
+    if (inFrame())
+    {
+        _screen.write(text);
+        return;
+    }
+    invalidateFromCursor();
+    // Line breaks draw nothing, but scrolling erases the new line with the background color.
+    auto const onlyLineBreaks = text.find_first_not_of("\r\n") == std::string_view::npos;
+    auto const& sgr = StyleTable::instance().style(_sgr);
+    if (!onlyLineBreaks || !std::holds_alternative<std::monostate>(sgr.bg) || sgr.inverse)
+        setSgr({});
     _buffer.append(text);
 }
 
 void TerminalOutput::moveTo(int row, int col)
 {
+    if (inFrame())
+    {
+        _screen.moveTo(row, col);
+        return;
+    }
+    setCursorRow(row);
     _buffer += std::format("\033[{};{}H", row, col);
 }
 
 void TerminalOutput::moveUp(int n)
 {
     if (n > 0)
+    {
+        forgetCursor();
         _buffer += std::format("\033[{}A", n);
+    }
 }
 
 void TerminalOutput::moveDown(int n)
 {
     if (n > 0)
+    {
+        forgetCursor();
         _buffer += std::format("\033[{}B", n);
+    }
 }
 
 void TerminalOutput::moveLeft(int n)
@@ -76,21 +134,40 @@ void TerminalOutput::moveRight(int n)
 
 void TerminalOutput::clearLine()
 {
+    if (inFrame())
+    {
+        _screen.clearLine();
+        return;
+    }
+    invalidateCursorRows();
+    setSgr({});
     _buffer += "\033[2K";
 }
 
 void TerminalOutput::clearToEndOfLine()
 {
+    if (inFrame())
+    {
+        _screen.clearToEndOfLine();
+        return;
+    }
+    invalidateCursorRows();
+    setSgr({});
     _buffer += "\033[K";
 }
 
 void TerminalOutput::clearToStartOfLine()
 {
+    invalidateCursorRows();
+    setSgr({});
     _buffer += "\033[1K";
 }
 
 void TerminalOutput::clearScreen()
 {
+    _screen.clear();
+    setCursorRow(1);
+    setSgr({});
     _buffer += "\033[2J\033[H";
 }
 
@@ -101,11 +178,16 @@ void TerminalOutput::clearScrollback()
 
 void TerminalOutput::enterAltScreen()
 {
+    _screen.invalidate();
+    forgetCursor();
     _buffer += "\033[?1049h";
 }
 
 void TerminalOutput::leaveAltScreen()
 {
+    _screen.invalidate();
+    forgetCursor();
+    setSgr({});
     _buffer += "\033[?1049l";
 }
 
@@ -115,23 +197,49 @@ auto TerminalOutput::syncGuard() -> SyncGuard
     return SyncGuard(STDOUT_FILENO);
 }
 
+void TerminalOutput::beginFrame()
+{
+    if (_frameDepth++ > 0)
+        return;
+    if (_screen.rows() != _rows || _screen.columns() != _cols)
+        _screen.resize(_rows, _cols);
+}
+
+void TerminalOutput::endFrame()
+{
+    if (--_frameDepth > 0)
+        return;
+    setSgr({});
+    _screen.diff(_buffer);
+    forgetCursor();
+}
+
+auto TerminalOutput::frame() -> FrameGuard
+{
+    return FrameGuard(*this);
+}
+
 void TerminalOutput::setDoubleWidth()
 {
+    invalidateCursorRows();
     _buffer += "\033#6";
 }
 
 void TerminalOutput::setDoubleHeightTop()
 {
+    invalidateCursorRows();
     _buffer += "\033#3";
 }
 
 void TerminalOutput::setDoubleHeightBottom()
 {
+    invalidateCursorRows();
     _buffer += "\033#4";
 }
 
 void TerminalOutput::setSingleWidth()
 {
+    invalidateCursorRows();
     _buffer += "\033#5";
 }
 
@@ -147,31 +255,68 @@ void TerminalOutput::hideCursor()
 
 void TerminalOutput::saveCursor()
 {
+    // The terminal saves the SGR attributes along with the cursor.
+    _savedSgr = _sgr;
     _buffer += "\0337";
 }
 
 void TerminalOutput::restoreCursor()
 {
+    forgetCursor();
+    _sgr = _savedSgr;
     _buffer += "\0338";
 }
 
 void TerminalOutput::setScrollRegion(int top, int bottom)
 {
+    // Setting the scroll region homes the cursor.
+    _scrollTop = top;
+    _scrollBottom = bottom;
+    setCursorRow(1);
     _buffer += std::format("\033[{};{}r", top, bottom);
 }
 
 void TerminalOutput::resetScrollRegion()
 {
+    _scrollTop = 0;
+    _scrollBottom = 0;
+    setCursorRow(1);
     _buffer += "\033[r";
 }
 
 void TerminalOutput::writeSixel(std::string_view sixelData)
 {
+    invalidateFromCursor();
+    setSgr({});
     _buffer += "\033Pq";
     _buffer.append(sixelData);
     _buffer += "\033\\";
 }
 
+auto TerminalOutput::writeImage(ImageData const& image) -> VoidResult
+{
+    auto sequence = Result<std::string> {};
+    switch (_imageCapabilities.protocol)
+    {
+        case ImageProtocol::Kitty: sequence = kittySequence(image, _imageCapabilities.local); break;
+        case ImageProtocol::ITerm2: sequence = encodeITerm2Image(image); break;
+        case ImageProtocol::Sixel: {
+            auto const sixel = encodeSixel(image);
+            if (!sixel)
+                return std::unexpected(sixel.error());
+            writeSixel(*sixel);
+            return {};
+        }
+    }
+    if (!sequence)
+        return std::unexpected(sequence.error());
+
+    invalidateFromCursor();
+    setSgr({});
+    _buffer += *sequence;
+    return {};
+}
+
 void TerminalOutput::flush()
 {
     if (!_buffer.empty())
@@ -181,6 +326,15 @@ void TerminalOutput::flush()
     }
 }
 
+void TerminalOutput::flushSynchronized()
+{
+    if (_buffer.empty())
+        return;
+    _buffer.insert(0, "\033[?2026h");
+    _buffer += "\033[?2026l";
+    flush();
+}
+
 auto TerminalOutput::columns() const noexcept -> int
 {
     return _cols;
@@ -199,86 +353,51 @@ void TerminalOutput::updateDimensions()
         _cols = ws.ws_col;
         _rows = ws.ws_row;
     }
+    if (_screen.rows() != _rows || _screen.columns() != _cols)
+        _screen.resize(_rows, _cols);
 }
 
-void TerminalOutput::appendSgr(Style const& style)
+void TerminalOutput::setCursorRow(int row)
 {
-    // Check if style is default (no attributes set)
-    auto const isDefaultFg = std::holds_alternative<std::monostate>(style.fg);
-    auto const isDefaultBg = std::holds_alternative<std::monostate>(style.bg);
-    if (isDefaultFg && isDefaultBg && !style.bold && !style.italic && !style.underline && !style.strikethrough
-        && !style.dim && !style.inverse)
-        return;
-
-    _buffer += "\033[";
-    auto needSemicolon = false;
-    auto const appendSep = [&]() {
-        if (needSemicolon)
-            _buffer += ';';
-        needSemicolon = true;
-    };
-
-    if (style.bold)
-    {
-        appendSep();
-        _buffer += '1';
-    }
-    if (style.dim)
-    {
-        appendSep();
-        _buffer += '2';
-    }
-    if (style.italic)
-    {
-        appendSep();
-        _buffer += '3';
-    }
-    if (style.underline)
-    {
-        appendSep();
-        _buffer += '4';
-    }
-    if (style.inverse)
-    {
-        appendSep();
-        _buffer += '7';
-    }
-    if (style.strikethrough)
-    {
-        appendSep();
-        _buffer += '9';
-    }
+    _cursorTop = row;
+    _cursorBottom = row;
+}
 
-    // Foreground color
-    if (auto const* idx = std::get_if<std::uint8_t>(&style.fg))
-    {
-        appendSep();
-        _buffer += std::format("38;5;{}", *idx);
-    }
-    else if (auto const* rgb = std::get_if<RgbColor>(&style.fg))
-    {
-        appendSep();
-        _buffer += std::format("38;2;{};{};{}", rgb->r, rgb->g, rgb->b);
-    }
+void TerminalOutput::forgetCursor()
+{
+    _cursorTop = 1;
+    _cursorBottom = _rows;
+}
 
-    // Background color
-    if (auto const* idx = std::get_if<std::uint8_t>(&style.bg))
+void TerminalOutput::invalidateFromCursor()
+{
+    // Text moves the cursor down only, and scrolls the region when it reaches its bottom. A
+    // cursor outside of the region stops at the bottom of the screen instead.
+    auto const top = _scrollTop > 0 ? _scrollTop : 1;
+    auto const bottom = _scrollBottom > 0 ? _scrollBottom : _rows;
+    if (_cursorTop >= top && _cursorBottom <= bottom)
     {
-        appendSep();
-        _buffer += std::format("48;5;{}", *idx);
+        _screen.invalidate(top, bottom);
+        _cursorBottom = bottom;
     }
-    else if (auto const* rgb = std::get_if<RgbColor>(&style.bg))
+    else
     {
-        appendSep();
-        _buffer += std::format("48;2;{};{};{}", rgb->r, rgb->g, rgb->b);
+        _screen.invalidate(_cursorTop, _rows);
+        _cursorBottom = _rows;
     }
+}
 
-    _buffer += 'm';
+void TerminalOutput::invalidateCursorRows()
+{
+    _screen.invalidate(_cursorTop, _cursorBottom);
 }
 
-void TerminalOutput::appendSgrReset()
+void TerminalOutput::setSgr(Style const& style)
 {
-    _buffer += "\033[m";
+    auto& styles = StyleTable::instance();
+    auto const id = styles.intern(style);
+    _buffer += styles.transition(_sgr, id);
+    _sgr = id;
 }
 
 } // namespace mychat::tui
@@ -2,6 +2,9 @@
 #pragma once
 
 #include <core/Error.hpp>
+#include <tui/Screen.hpp>
+#include <tui/Style.hpp>
+#include <tui/TerminalGraphics.hpp>
 
 #include <cstdint>
 #include <string>
@@ -11,30 +14,6 @@
 namespace mychat::tui
 {
 
-/// @brief RGB color representation.
-struct RgbColor
-{
-    std::uint8_t r = 0;
-    std::uint8_t g = 0;
-    std::uint8_t b = 0;
-};
-
-/// @brief Color representation: default, 256-color index, or true color (RGB).
-using Color = std::variant<std::monostate, std::uint8_t, RgbColor>;
-
-/// @brief Text styling attributes for terminal output.
-struct Style
-{
-    Color fg;                   ///< Foreground color.
-    Color bg;                   ///< Background color.
-    bool bold = false;          ///< Bold text.
-    bool italic = false;        ///< Italic text.
-    bool underline = false;     ///< Underlined text.
-    bool strikethrough = false; ///< Strikethrough text.
-    bool dim = false;           ///< Dim/faint text.
-    bool inverse = false;       ///< Inverse/reverse video.
-};
-
 /// @brief RAII guard for synchronized terminal output.
 ///
 /// Uses CSI ?2026h/l (synchronized output mode) to prevent tearing.
@@ -59,15 +38,43 @@ class SyncGuard
     int _fd;
 };
 
+class TerminalOutput;
+
+/// @brief RAII guard for a frame of TerminalOutput.
+///
+/// The constructor begins a frame, the destructor ends it. See TerminalOutput::frame().
+class FrameGuard
+{
+  public:
+    explicit FrameGuard(TerminalOutput& output);
+    ~FrameGuard();
+
+    FrameGuard(FrameGuard const&) = delete;
+    auto operator=(FrameGuard const&) -> FrameGuard& = delete;
+    FrameGuard(FrameGuard&&) = delete;
+    auto operator=(FrameGuard&&) -> FrameGuard& = delete;
+
+  private:
+    TerminalOutput& _output;
+};
+
 /// @brief Handles styled terminal output, cursor control, and screen management.
 ///
 /// Buffers output internally and flushes on demand. Supports SGR styling,
 /// cursor movement, alt screen, synchronized output, double-width/height lines,
-/// and sixel image output.
+/// and image output (sixel, kitty or iTerm2).
+///
+/// The terminal's SGR attributes are tracked, so consecutive spans only emit the attributes that
+/// change between them.
+///
+/// Output drawn within a frame goes to a Screen, and ending the frame emits only what changed
+/// since the previous frame. Output outside of frames is written through directly; the rows it
+/// may have touched are invalidated, so the next frame redraws what it draws there.
 class TerminalOutput
 {
   public:
-    /// @brief Initializes the terminal output by querying terminal dimensions.
+    /// @brief Initializes the terminal output by querying terminal dimensions and detecting
+    /// the image protocol.
     /// @return Success or IoError.
     [[nodiscard]] auto initialize() -> VoidResult;
 
@@ -77,6 +84,8 @@ class TerminalOutput
     void write(std::string_view text, Style const& style = {});
 
     /// @brief Writes raw text without styling.
+    ///
+    /// Line breaks alone keep the current attributes unless they affect how lines are erased.
     /// @param text The text to write directly to the buffer.
     void writeRaw(std::string_view text);
 
@@ -124,6 +133,20 @@ class TerminalOutput
     /// @return An RAII SyncGuard object.
     [[nodiscard]] auto syncGuard() -> SyncGuard;
 
+    /// @brief Begins a frame; frames nest, and only the outermost one takes effect.
+    ///
+    /// Within a frame, write(), writeRaw(), moveTo(), clearLine() and clearToEndOfLine() draw
+    /// into the screen instead of writing to the terminal; raw text must not contain escape
+    /// sequences then. The terminal's cursor position is unspecified after the frame.
+    void beginFrame();
+
+    /// @brief Ends a frame, appending the minimal update of what was drawn to the buffer.
+    void endFrame();
+
+    /// @brief Creates a frame guard.
+    /// @return An RAII FrameGuard object.
+    [[nodiscard]] auto frame() -> FrameGuard;
+
     /// @brief Sets the current line to double-width (ESC #6).
     void setDoubleWidth();
 
@@ -160,9 +183,38 @@ class TerminalOutput
     /// @param sixelData The sixel-encoded image data (without DCS/ST framing).
     void writeSixel(std::string_view sixelData);
 
+    /// @brief Writes an image at the cursor with the terminal's image protocol.
+    ///
+    /// Kitty terminals on this machine read the pixels from shared memory, or a temporary file if
+    /// that fails; remote ones get them compressed in the sequence. iTerm2 gets a PNG, and other
+    /// terminals sixel data.
+    /// @return An error if the image is invalid or cannot be encoded.
+    [[nodiscard]] auto writeImage(ImageData const& image) -> VoidResult;
+
+    /// @brief Returns the image capabilities detected by initialize().
+    [[nodiscard]] auto imageCapabilities() const noexcept -> ImageCapabilities const&
+    {
+        return _imageCapabilities;
+    }
+
+    /// @brief Overrides the detected image capabilities.
+    void setImageCapabilities(ImageCapabilities capabilities) noexcept { _imageCapabilities = capabilities; }
+
     /// @brief Flushes the internal buffer to stdout.
     void flush();
 
+    /// @brief Flushes the internal buffer to stdout in one write, in synchronized output mode.
+    void flushSynchronized();
+
+    /// @brief Returns true if output is buffered but not flushed yet.
+    [[nodiscard]] auto hasPendingOutput() const noexcept -> bool { return !_buffer.empty(); }
+
+    /// @brief Returns the output buffered but not flushed yet.
+    [[nodiscard]] auto pendingOutput() const noexcept -> std::string_view { return _buffer; }
+
+    /// @brief Drops the buffered output instead of flushing it, keeping the buffer's capacity.
+    void discardPendingOutput() noexcept { _buffer.clear(); }
+
     /// @brief Returns the terminal width in columns.
     [[nodiscard]] auto columns() const noexcept -> int;
 
@@ -176,12 +228,35 @@ class TerminalOutput
     std::string _buffer; ///< Output buffer for batching writes.
     int _cols = 80;
     int _rows = 24;
+    ImageCapabilities _imageCapabilities;
+
+    StyleId _sgr = DefaultStyleId;      ///< The terminal's current SGR attributes.
+    StyleId _savedSgr = DefaultStyleId; ///< The SGR attributes saved by saveCursor().
+
+    Screen _screen;
+    int _frameDepth = 0;
+    int _cursorTop = 1;        ///< First row the terminal's cursor may be on.
+    int _cursorBottom = _rows; ///< Last row the terminal's cursor may be on.
+    int _scrollTop = 0;        ///< First row of the scroll region, or 0 for the full screen.
+    int _scrollBottom = 0;     ///< Last row of the scroll region, or 0 for the full screen.
+
+    [[nodiscard]] auto inFrame() const noexcept -> bool { return _frameDepth > 0; }
+
+    /// @brief Records that the terminal's cursor is at @p row.
+    void setCursorRow(int row);
+
+    /// @brief Records that the terminal's cursor may be anywhere.
+    void forgetCursor();
+
+    /// @brief Invalidates the rows that text written at the cursor may change, and widens the
+    /// cursor's range to where the text may leave it.
+    void invalidateFromCursor();
 
-    /// @brief Appends SGR (Select Graphic Rendition) sequences for the given style.
-    void appendSgr(Style const& style);
+    /// @brief Invalidates the rows the cursor may be on.
+    void invalidateCursorRows();
 
-    /// @brief Appends the SGR reset sequence.
-    void appendSgrReset();
+    /// @brief Appends the SGR (Select Graphic Rendition) sequence switching to @p style.
+    void setSgr(Style const& style);
 };
 
 } // namespace mychat::tui
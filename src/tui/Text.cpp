@@ -7,6 +7,30 @@
 namespace mychat::tui
 {
 
+namespace
+{
+    /// @brief Calls @p visit with the text and style of each span's part in [begin, end), where
+    /// the offsets count through the line's spans concatenated.
+    template <typename Visitor>
+    void forEachSpanIn(TextLine const& line, std::size_t begin, std::size_t end, Visitor&& visit)
+    {
+        auto offset = std::size_t { 0 };
+        for (auto const& span: line.spans)
+        {
+            auto const spanEnd = offset + span.text.size();
+            if (spanEnd > begin && offset < end)
+            {
+                auto const from = std::max(begin, offset) - offset;
+                auto const to = std::min(end, spanEnd) - offset;
+                visit(std::string_view(span.text).substr(from, to - from), span.style);
+            }
+            offset = spanEnd;
+            if (offset >= end)
+                break;
+        }
+    }
+} // namespace
+
 // =============================================================================
 // TextLine
 // =============================================================================
@@ -40,6 +64,7 @@ Text::Text(std::string_view content, Style const& style)
 
 void Text::setText(std::string_view content, Style const& style)
 {
+    invalidateWrap();
     _lines.clear();
 
     // Split by newlines
@@ -70,6 +95,7 @@ void Text::setText(std::string_view content, Style const& style)
 
 void Text::setLines(std::vector<TextLine> lines)
 {
+    invalidateWrap();
     _lines = std::move(lines);
 }
 
@@ -106,6 +132,8 @@ auto Text::align() const noexcept -> TextAlign
 
 void Text::setWrapMode(WrapMode mode)
 {
+    if (mode != _wrapMode)
+        invalidateWrap();
     _wrapMode = mode;
 }
 
@@ -126,13 +154,12 @@ auto Text::maxWidth() const noexcept -> int
 
 void Text::render(TerminalOutput& output, int startRow, int startCol, int width) const
 {
-    auto const wrapped = wrap(width);
+    auto const& lines = wrapped(width);
 
-    for (auto i = std::size_t { 0 }; i < wrapped.size(); ++i)
+    for (auto i = std::size_t { 0 }; i < lines.size(); ++i)
     {
-        auto const& line = wrapped[i];
+        auto const& line = lines[i];
         auto const row = startRow + static_cast<int>(i);
-        auto const lineWidth = line.width();
 
         // Calculate starting column based on alignment
         auto col = startCol;
@@ -142,90 +169,136 @@ void Text::render(TerminalOutput& output, int startRow, int startCol, int width)
                 col = startCol;
                 break;
             case TextAlign::Center:
-                col = startCol + (width - lineWidth) / 2;
+                col = startCol + (width - line.width) / 2;
                 break;
             case TextAlign::Right:
-                col = startCol + width - lineWidth;
+                col = startCol + width - line.width;
                 break;
         }
 
         output.moveTo(row, col);
 
-        for (auto const& span: line.spans)
-            output.write(span.text, span.style);
+        auto const write = [&](std::string_view text, Style const& style) { output.write(text, style); };
+        forEachSpanIn(_lines[line.line], line.begin, line.end, write);
     }
 }
 
 auto Text::lineCount(int width) const -> int
 {
-    return static_cast<int>(wrap(width).size());
+    return static_cast<int>(wrapped(width).size());
 }
 
 auto Text::wrap(int width) const -> std::vector<TextLine>
 {
-    if (_wrapMode == WrapMode::None || width <= 0)
-        return _lines;
-
     auto result = std::vector<TextLine> {};
+    for (auto const& line: wrapped(width))
+    {
+        auto& wrappedLine = result.emplace_back();
+        auto const append = [&](std::string_view text, Style const& style) {
+            wrappedLine.append(std::string(text), style);
+        };
+        forEachSpanIn(_lines[line.line], line.begin, line.end, append);
+    }
+    return result;
+}
 
-    for (auto const& inputLine: _lines)
+auto Text::wrapped(int width) const -> std::vector<WrappedLine> const&
+{
+    width = std::max(0, width);
+    if (width == _wrapWidth)
+        return _wrapped;
+
+    _wrapped.clear();
+    _wrapWidth = width;
+    for (auto i = std::size_t { 0 }; i < _lines.size(); ++i)
+        wrapLine(i, width);
+    return _wrapped;
+}
+
+void Text::wrapLine(std::size_t index, int width) const
+{
+    auto const& spans = _lines[index].spans;
+    auto joined = std::string {};
+    if (spans.size() > 1)
+        for (auto const& span: spans)
+            joined += span.text;
+    auto const text = spans.size() == 1 ? std::string_view(spans.front().text) : std::string_view(joined);
+
+    auto const add = [&](std::size_t begin, std::size_t end, int lineWidth) {
+        _wrapped.push_back(WrappedLine { .line = index, .begin = begin, .end = end, .width = lineWidth });
+    };
+
+    auto const textWidth = displayWidth(text);
+    if (_wrapMode == WrapMode::None || width == 0 || textWidth <= width)
     {
-        // Combine all spans into a single string for wrapping
-        auto fullText = std::string {};
-        auto defaultStyle = Style {};
+        add(0, text.size(), textWidth);
+        return;
+    }
 
-        for (auto const& span: inputLine.spans)
+    if (_wrapMode == WrapMode::Char)
+    {
+        // At least one grapheme cluster per line
+        for (auto pos = std::size_t { 0 }; pos < text.size();)
         {
-            fullText += span.text;
-            if (fullText.size() == span.text.size())
-                defaultStyle = span.style;
+            auto const rest = text.substr(pos);
+            auto length = columnPrefixLength(rest, width);
+            if (length == 0)
+                length = nextGraphemeBoundary(rest, 0);
+            add(pos, pos + length, displayWidth(rest.substr(0, length)));
+            pos += length;
         }
+        return;
+    }
 
-        if (displayWidth(fullText) <= width)
+    // Word wrapping: lines break at whitespace, which is dropped at the breaks.
+    auto const isSpace = [&](std::size_t pos) {
+        return std::isspace(static_cast<unsigned char>(text[pos])) != 0;
+    };
+    auto lineBegin = std::string_view::npos;
+    auto lineEnd = std::size_t { 0 };
+    auto lineWidth = 0;
+    for (auto pos = std::size_t { 0 }; pos < text.size();)
+    {
+        auto wordBegin = pos;
+        while (wordBegin < text.size() && isSpace(wordBegin))
+            ++wordBegin;
+        auto wordEnd = wordBegin;
+        while (wordEnd < text.size() && !isSpace(wordEnd))
+            ++wordEnd;
+        pos = wordEnd;
+        if (wordBegin == wordEnd)
+            break;
+
+        auto const wordWidth = displayWidth(text.substr(wordBegin, wordEnd - wordBegin));
+        auto const gapWidth = lineBegin == std::string_view::npos
+                                  ? 0
+                                  : displayWidth(text.substr(lineEnd, wordBegin - lineEnd));
+        if (lineBegin != std::string_view::npos && lineWidth + gapWidth + wordWidth <= width)
         {
-            result.push_back(inputLine);
+            // Word fits on the current line
+            lineEnd = wordEnd;
+            lineWidth += gapWidth + wordWidth;
             continue;
         }
 
-        // Need to wrap
-        if (_wrapMode == WrapMode::Word)
-        {
-            auto const wrapped = wordWrap(fullText, width);
-            for (auto const& wrappedLine: wrapped)
-            {
-                auto line = TextLine {};
-                line.append(wrappedLine, defaultStyle);
-                result.push_back(std::move(line));
-            }
-        }
-        else
-        {
-            // Character-level wrapping
-            auto pos = std::size_t { 0 };
-            while (pos < fullText.size())
-            {
-                auto lineLen = std::size_t { 0 };
-                auto lineWidth = 0;
-
-                while (pos + lineLen < fullText.size() && lineWidth < width)
-                {
-                    auto const ch = static_cast<unsigned char>(fullText[pos + lineLen]);
-                    // Skip UTF-8 continuation bytes for width calculation
-                    if ((ch & 0xC0) != 0x80)
-                        ++lineWidth;
-                    ++lineLen;
-                }
-
-                auto line = TextLine {};
-                line.append(fullText.substr(pos, lineLen), defaultStyle);
-                result.push_back(std::move(line));
-
-                pos += lineLen;
-            }
-        }
+        // First word of a line, even if too long
+        if (lineBegin != std::string_view::npos)
+            add(lineBegin, lineEnd, lineWidth);
+        lineBegin = wordBegin;
+        lineEnd = wordEnd;
+        lineWidth = wordWidth;
     }
 
-    return result;
+    if (lineBegin != std::string_view::npos)
+        add(lineBegin, lineEnd, lineWidth);
+    else
+        add(0, 0, 0); // Only whitespace
+}
+
+void Text::invalidateWrap() noexcept
+{
+    _wrapWidth = -1;
+    _wrapped.clear();
 }
 
 // =============================================================================
@@ -317,41 +390,9 @@ auto truncate(std::string_view text, int width) -> std::string
         return std::string(width, '.');
 
     auto const targetWidth = width - 1; // Leave room for ellipsis
-    auto result = std::string {};
-    auto currentWidth = 0;
-
-    for (auto i = std::size_t { 0 }; i < text.size() && currentWidth < targetWidth; ++i)
-    {
-        auto const ch = static_cast<unsigned char>(text[i]);
-        result += text[i];
-
-        // Only count non-continuation bytes for width
-        if ((ch & 0xC0) != 0x80)
-            ++currentWidth;
-    }
-
+    auto result = std::string(text.substr(0, columnPrefixLength(text, targetWidth)));
     result += "\u2026"; // …
     return result;
 }
 
-auto displayWidth(std::string_view text) -> int
-{
-    auto width = 0;
-
-    for (auto i = std::size_t { 0 }; i < text.size(); ++i)
-    {
-        auto const ch = static_cast<unsigned char>(text[i]);
-
-        // Skip UTF-8 continuation bytes
-        if ((ch & 0xC0) == 0x80)
-            continue;
-
-        // TODO: Use libunicode for proper width calculation (wcwidth equivalent)
-        // For now, assume 1 cell per codepoint (which is wrong for wide chars like CJK)
-        ++width;
-    }
-
-    return width;
-}
-
 } // namespace mychat::tui
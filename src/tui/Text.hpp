@@ -2,6 +2,7 @@
 #pragma once
 
 #include <tui/TerminalOutput.hpp>
+#include <tui/Unicode.hpp>
 
 #include <cstddef>
 #include <string>
@@ -112,14 +113,38 @@ class Text
     [[nodiscard]] auto lineCount(int width) const -> int;
 
     /// @brief Calculates the wrapped lines for the given width.
+    ///
+    /// Wrapping is memoized for the last width asked for, so render() and lineCount() at that
+    /// width do not wrap again. Changing the content or the wrapping mode forgets it.
     /// @param width The available width.
     [[nodiscard]] auto wrap(int width) const -> std::vector<TextLine>;
 
   private:
+    /// @brief A wrapped line: a byte range of one of the lines' text, across its spans.
+    struct WrappedLine
+    {
+        std::size_t line = 0;  ///< Index into _lines.
+        std::size_t begin = 0; ///< Offset into the line's text, its spans concatenated.
+        std::size_t end = 0;
+        int width = 0; ///< Display width of the range.
+    };
+
     std::vector<TextLine> _lines;
     TextAlign _align = TextAlign::Left;
     WrapMode _wrapMode = WrapMode::Word;
     int _maxWidth = 0;
+
+    mutable int _wrapWidth = -1;               ///< Width _wrapped holds the wrapping for, or -1.
+    mutable std::vector<WrappedLine> _wrapped; ///< The lines wrapped at _wrapWidth.
+
+    /// @brief Returns the lines wrapped at @p width, wrapping them if _wrapped is for another width.
+    [[nodiscard]] auto wrapped(int width) const -> std::vector<WrappedLine> const&;
+
+    /// @brief Appends the wrapped lines of line @p index to _wrapped.
+    void wrapLine(std::size_t index, int width) const;
+
+    /// @brief Forgets the memoized wrapping.
+    void invalidateWrap() noexcept;
 };
 
 /// @brief Word-wraps a string at the given width.
@@ -134,8 +159,4 @@ class Text
 /// @return The truncated string.
 [[nodiscard]] auto truncate(std::string_view text, int width) -> std::string;
 
-/// @brief Returns the display width of a string (accounting for multi-byte characters).
-/// @param text The text to measure.
-[[nodiscard]] auto displayWidth(std::string_view text) -> int;
-
 } // namespace mychat::tui
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <cstring>
+
+#include <tui/TextBuffer.hpp>
+
+namespace mychat::tui
+{
+
+namespace
+{
+    /// @brief Smallest gap left after growing the buffer.
+    constexpr auto MinGrowth = std::size_t { 64 };
+} // namespace
+
+void TextBuffer::assign(std::string_view text)
+{
+    _data.assign(text);
+    _gapBegin = _data.size();
+    _gapEnd = _data.size();
+    _linesBefore.clear();
+    _linesAfter.clear();
+    for (auto pos = text.find('\n'); pos != std::string_view::npos; pos = text.find('\n', pos + 1))
+        _linesBefore.push_back(pos + 1);
+    ++_revision;
+}
+
+void TextBuffer::insert(std::size_t pos, std::string_view text)
+{
+    if (text.empty())
+        return;
+
+    moveGap(pos);
+    reserveGap(text.size());
+    std::memcpy(_data.data() + _gapBegin, text.data(), text.size());
+    for (auto i = text.find('\n'); i != std::string_view::npos; i = text.find('\n', i + 1))
+        _linesBefore.push_back(_gapBegin + i + 1);
+    _gapBegin += text.size();
+    ++_revision;
+}
+
+void TextBuffer::erase(std::size_t pos, std::size_t count)
+{
+    pos = std::min(pos, size());
+    count = std::min(count, size() - pos);
+    if (count == 0)
+        return;
+
+    // Lines starting within (pos, pos + count] lose the line break before them.
+    moveGap(pos);
+    auto const end = size();
+    while (!_linesAfter.empty() && end - _linesAfter.back() <= pos + count)
+        _linesAfter.pop_back();
+    _gapEnd += count;
+    ++_revision;
+}
+
+auto TextBuffer::substr(std::size_t pos, std::size_t count) const -> std::string
+{
+    pos = std::min(pos, size());
+    count = std::min(count, size() - pos);
+    auto result = std::string {};
+    result.reserve(count);
+    if (pos < _gapBegin)
+    {
+        auto const before = std::min(count, _gapBegin - pos);
+        result.append(_data, pos, before);
+        pos += before;
+        count -= before;
+    }
+    result.append(_data, pos + gapSize(), count);
+    return result;
+}
+
+auto TextBuffer::text() const -> std::string_view
+{
+    moveGap(size());
+    return std::string_view(_data).substr(0, _gapBegin);
+}
+
+auto TextBuffer::lineOf(std::size_t pos) const noexcept -> std::size_t
+{
+    auto const before = std::ranges::upper_bound(_linesBefore, pos) - _linesBefore.begin();
+    if (pos < _gapBegin || _linesAfter.empty())
+        return static_cast<std::size_t>(before);
+
+    // A line after the gap starts at or before pos if its distance from the end is at least size - pos.
+    auto const distance = size() - std::min(pos, size());
+    auto const after = _linesAfter.end() - std::ranges::lower_bound(_linesAfter, distance);
+    return static_cast<std::size_t>(before + after);
+}
+
+auto TextBuffer::lineStart(std::size_t line) const noexcept -> std::size_t
+{
+    if (line == 0)
+        return 0;
+    if (line <= _linesBefore.size())
+        return _linesBefore[line - 1];
+    auto const afterIndex = line - _linesBefore.size() - 1;
+    if (afterIndex >= _linesAfter.size())
+        return size();
+    return size() - _linesAfter[_linesAfter.size() - 1 - afterIndex];
+}
+
+auto TextBuffer::lineEnd(std::size_t line) const noexcept -> std::size_t
+{
+    return line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+}
+
+auto TextBuffer::line(std::size_t line) const -> std::string_view
+{
+    auto const begin = lineStart(line);
+    auto const end = lineEnd(line);
+    if (begin < _gapBegin && _gapBegin < end)
+        moveGap(_gapBegin - begin < end - _gapBegin ? begin : end);
+    auto const offset = begin < _gapBegin ? begin : begin + gapSize();
+    return std::string_view(_data).substr(offset, end - begin);
+}
+
+void TextBuffer::moveGap(std::size_t pos) const
+{
+    pos = std::min(pos, size());
+    auto const end = size();
+    if (pos < _gapBegin)
+    {
+        auto const count = _gapBegin - pos;
+        std::memmove(_data.data() + _gapEnd - count, _data.data() + pos, count);
+        _gapBegin -= count;
+        _gapEnd -= count;
+        while (!_linesBefore.empty() && _linesBefore.back() > pos)
+        {
+            _linesAfter.push_back(end - _linesBefore.back());
+            _linesBefore.pop_back();
+        }
+    }
+    else if (pos > _gapBegin)
+    {
+        auto const count = pos - _gapBegin;
+        std::memmove(_data.data() + _gapBegin, _data.data() + _gapEnd, count);
+        _gapBegin += count;
+        _gapEnd += count;
+        while (!_linesAfter.empty() && end - _linesAfter.back() <= pos)
+        {
+            _linesBefore.push_back(end - _linesAfter.back());
+            _linesAfter.pop_back();
+        }
+    }
+}
+
+void TextBuffer::reserveGap(std::size_t count)
+{
+    if (gapSize() >= count)
+        return;
+
+    // Grow geometrically, so typing a long text moves what follows the gap only a few times.
+    auto const growth = std::max({ count - gapSize(), _data.size() / 2, MinGrowth });
+    _data.insert(_gapEnd, growth, '\0');
+    _gapEnd += growth;
+}
+
+} // namespace mychat::tui
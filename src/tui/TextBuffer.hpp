@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief Gap buffer of UTF-8 text with an index of where its lines start.
+///
+/// The text is kept in one allocation with a gap at the last edit, so a run of edits at the
+/// cursor moves nothing but the bytes typed. Line starts before the gap are kept as offsets from
+/// the start, and those after it as distances from the end, so they too are unaffected by edits
+/// at the gap; only moving the gap converts the ones it passes. Edits at the gap take time
+/// proportional to the text inserted or erased, and line lookups are binary searches.
+///
+/// Views into the text require the part they cover to be contiguous, for which the gap is moved
+/// out of the way: text() moves it to the end, line() only out of that line.
+class TextBuffer
+{
+  public:
+    /// @brief Replaces the whole text.
+    void assign(std::string_view text);
+
+    /// @brief Inserts @p text at byte @p pos.
+    void insert(std::size_t pos, std::string_view text);
+
+    /// @brief Erases @p count bytes starting at byte @p pos.
+    void erase(std::size_t pos, std::size_t count);
+
+    /// @brief Removes all text.
+    void clear() { assign({}); }
+
+    /// @brief Returns the size of the text in bytes.
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return _data.size() - gapSize(); }
+
+    [[nodiscard]] auto empty() const noexcept -> bool { return size() == 0; }
+
+    /// @brief Returns the byte at @p pos.
+    [[nodiscard]] auto at(std::size_t pos) const noexcept -> char
+    {
+        return _data[pos < _gapBegin ? pos : pos + gapSize()];
+    }
+
+    /// @brief Returns a copy of @p count bytes starting at @p pos.
+    [[nodiscard]] auto substr(std::size_t pos, std::size_t count) const -> std::string;
+
+    /// @brief Returns the whole text.
+    ///
+    /// The view is valid until the next edit.
+    [[nodiscard]] auto text() const -> std::string_view;
+
+    /// @brief Returns the number of lines; an empty text has one.
+    [[nodiscard]] auto lineCount() const noexcept -> std::size_t
+    {
+        return 1 + _linesBefore.size() + _linesAfter.size();
+    }
+
+    /// @brief Returns the index of the line holding byte @p pos.
+    [[nodiscard]] auto lineOf(std::size_t pos) const noexcept -> std::size_t;
+
+    /// @brief Returns the byte offset where line @p line starts.
+    [[nodiscard]] auto lineStart(std::size_t line) const noexcept -> std::size_t;
+
+    /// @brief Returns the byte offset where line @p line ends, before its line break.
+    [[nodiscard]] auto lineEnd(std::size_t line) const noexcept -> std::size_t;
+
+    /// @brief Returns line @p line, without its line break.
+    ///
+    /// The view is valid until the next edit or call to text(). Views of other lines stay valid, as
+    /// the gap only moves within this line.
+    [[nodiscard]] auto line(std::size_t line) const -> std::string_view;
+
+    /// @brief Returns a counter that changes with every edit.
+    [[nodiscard]] auto revision() const noexcept -> std::uint64_t { return _revision; }
+
+  private:
+    // Making part of the text contiguous moves the gap, which leaves the text itself unchanged.
+    mutable std::string _data;
+    mutable std::size_t _gapBegin = 0;
+    mutable std::size_t _gapEnd = 0;
+    mutable std::vector<std::size_t> _linesBefore; ///< Starts of lines 1.. at or before the gap, ascending.
+    mutable std::vector<std::size_t> _linesAfter;  ///< Distances from the end of the starts after the gap,
+                                                   ///< nearest to the gap last.
+    std::uint64_t _revision = 0;
+
+    [[nodiscard]] auto gapSize() const noexcept -> std::size_t { return _gapEnd - _gapBegin; }
+
+    /// @brief Moves the gap to byte @p pos.
+    void moveGap(std::size_t pos) const;
+
+    /// @brief Makes the gap hold at least @p count bytes.
+    void reserveGap(std::size_t count);
+};
+
+} // namespace mychat::tui
@@ -215,6 +215,7 @@ auto monoTheme() -> Theme
 
 ThemeManager::ThemeManager(): _current(darkTheme())
 {
+    internStyles();
 }
 
 auto ThemeManager::instance() -> ThemeManager&
@@ -231,11 +232,28 @@ auto ThemeManager::current() const noexcept -> Theme const&
 void ThemeManager::setCurrent(Theme theme)
 {
     _current = std::move(theme);
+    internStyles();
 }
 
 void ThemeManager::reset()
 {
     _current = darkTheme();
+    internStyles();
+}
+
+void ThemeManager::internStyles()
+{
+    auto& table = StyleTable::instance();
+    auto const& theme = _current;
+    auto const styles = {
+        &theme.textNormal, &theme.textMuted, &theme.textBold, &theme.textAccent, &theme.buttonNormal,
+        &theme.buttonFocused, &theme.buttonDisabled, &theme.listItem, &theme.listItemSelected,
+        &theme.listItemDisabled, &theme.inputNormal, &theme.inputFocused, &theme.inputPlaceholder,
+        &theme.dialogBorder, &theme.dialogTitle, &theme.dialogBackground, &theme.statusBackground,
+        &theme.statusKey, &theme.statusAction, &theme.success, &theme.warning, &theme.error, &theme.info
+    };
+    for (auto const* style: styles)
+        static_cast<void>(table.intern(*style));
 }
 
 auto currentTheme() -> Theme const&
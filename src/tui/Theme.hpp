@@ -99,6 +99,9 @@ struct Theme
 ///
 /// The TUI uses a global theme for consistent styling. Components can
 /// access the current theme through this interface.
+///
+/// The current theme's styles are interned in StyleTable::instance() when it is set, so their
+/// IDs and SGR sequences are ready before the first frame draws with them.
 class ThemeManager
 {
   public:
@@ -117,6 +120,8 @@ class ThemeManager
   private:
     ThemeManager();
     Theme _current;
+
+    void internStyles();
 };
 
 /// @brief Convenience function to get the current theme.
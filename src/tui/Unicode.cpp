@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#include <libunicode/utf8_grapheme_segmenter.h>
+#include <libunicode/width.h>
+
+#include <tui/Unicode.hpp>
+
+#if defined(__AVX2__)
+    #define MYCHAT_UNICODE_AVX2 1
+    #define MYCHAT_UNICODE_SSE2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define MYCHAT_UNICODE_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define MYCHAT_UNICODE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace mychat::tui
+{
+
+namespace
+{
+
+    auto isAscii(char c) noexcept -> bool
+    {
+        return (static_cast<unsigned char>(c) & 0x80) == 0;
+    }
+
+    auto isPrintableAscii(char c) noexcept -> bool
+    {
+        return c >= 0x20 && c < 0x7f;
+    }
+
+    /// @brief Whether a grapheme cluster boundary lies between @p before and @p after, both ASCII.
+    ///
+    /// Only CR LF forms a cluster of two ASCII characters.
+    auto asciiBoundary(char before, char after) noexcept -> bool
+    {
+        return before != '\r' || after != '\n';
+    }
+
+    /// @brief Finds the end of the grapheme cluster at @p pos using the full segmentation rules.
+    auto segmentedNext(std::string_view text, std::size_t pos) -> std::size_t
+    {
+        auto segmenter = unicode::utf8_grapheme_segmenter(text.substr(pos));
+        auto const it = segmenter.begin();
+        if (it == segmenter.end())
+            return text.size();
+
+        // The segmenter yields the cluster's codepoints; step over as many, decoding as it does.
+        auto const codepoints = (*it).size();
+        auto end = pos;
+        for (auto i = std::size_t { 0 }; i < codepoints && end < text.size(); ++i)
+            end += decodeUtf8(text, end).second;
+        return end > pos ? end : pos + decodeUtf8(text, pos).second;
+    }
+
+    auto isRegionalIndicator(char32_t codepoint) noexcept -> bool
+    {
+        return codepoint >= 0x1F1E6 && codepoint <= 0x1F1FF;
+    }
+
+} // namespace
+
+auto decodeUtf8(std::string_view text, std::size_t pos) -> std::pair<char32_t, std::size_t>
+{
+    auto const lead = static_cast<unsigned char>(text[pos]);
+    auto length = std::size_t { 1 };
+    auto codepoint = char32_t { lead };
+    if (lead >= 0xF0)
+    {
+        length = 4;
+        codepoint = lead & 0x07u;
+    }
+    else if (lead >= 0xE0)
+    {
+        length = 3;
+        codepoint = lead & 0x0Fu;
+    }
+    else if (lead >= 0xC0)
+    {
+        length = 2;
+        codepoint = lead & 0x1Fu;
+    }
+    else if (lead >= 0x80)
+        return { U'�', 1 };
+
+    if (pos + length > text.size())
+        return { U'�', 1 };
+    for (auto i = std::size_t { 1 }; i < length; ++i)
+    {
+        auto const byte = static_cast<unsigned char>(text[pos + i]);
+        if ((byte & 0xC0) != 0x80)
+            return { U'�', 1 };
+        codepoint = (codepoint << 6) | (byte & 0x3Fu);
+    }
+    return { codepoint, length };
+}
+
+auto codepointWidth(char32_t codepoint) -> int
+{
+    if (codepoint < 0x20 || codepoint == 0x7f)
+        return 0;
+    if (codepoint < 0x7f)
+        return 1;
+    // libunicode looks this up in its generated multi-stage property tables.
+    return std::clamp(unicode::width(codepoint), 0, 2);
+}
+
+auto clusterWidth(std::string_view cluster) -> int
+{
+    if (cluster.empty())
+        return 0;
+    auto const [first, length] = decodeUtf8(cluster, 0);
+    auto const width = codepointWidth(first);
+    if (width == 0 || length == cluster.size())
+        return width;
+
+    // A pair of regional indicators is a flag, and variation selector 16 asks for emoji presentation.
+    if (isRegionalIndicator(first) || cluster.find("\uFE0F") != std::string_view::npos)
+        return 2;
+    // Emoji joined by ZWJ or followed by a skin tone modifier show as one glyph as wide as the first.
+    return width;
+}
+
+auto printableAsciiPrefix(std::string_view text) noexcept -> std::size_t
+{
+    auto const* data = text.data();
+    auto const count = text.size();
+    auto i = std::size_t { 0 };
+
+    // Printable ASCII is 0x20..0x7e; bytes of 0x80 and up compare as negative.
+#if defined(MYCHAT_UNICODE_AVX2)
+    auto const below32 = _mm256_set1_epi8(0x1f);
+    auto const del32 = _mm256_set1_epi8(0x7f);
+    for (; i + 32 <= count; i += 32)
+    {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+        auto const printable = _mm256_and_si256(_mm256_cmpgt_epi8(v, below32), _mm256_cmpgt_epi8(del32, v));
+        auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(printable));
+        if (mask != 0xffffffffu)
+            return i + static_cast<std::size_t>(std::countr_one(mask));
+    }
+#endif
+#if defined(MYCHAT_UNICODE_SSE2)
+    auto const below = _mm_set1_epi8(0x1f);
+    auto const del = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= count; i += 16)
+    {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+        auto const printable = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmpgt_epi8(del, v));
+        auto const mask = static_cast<std::uint32_t>(_mm_movemask_epi8(printable));
+        if (mask != 0xffffu)
+            return i + static_cast<std::size_t>(std::countr_one(mask));
+    }
+#elif defined(MYCHAT_UNICODE_NEON)
+    auto const* bytes = reinterpret_cast<std::uint8_t const*>(data);
+    for (; i + 16 <= count; i += 16)
+    {
+        auto const v = vld1q_u8(bytes + i);
+        auto const printable = vandq_u8(vcgtq_u8(v, vdupq_n_u8(0x1f)), vcltq_u8(v, vdupq_n_u8(0x7f)));
+        if (vminvq_u8(printable) != 0xff)
+            break; // The scalar loop finds the exact position.
+    }
+#endif
+
+    while (i < count && isPrintableAscii(data[i]))
+        ++i;
+    return i;
+}
+
+auto displayWidth(std::string_view text) -> int
+{
+    auto width = 0;
+    auto pos = std::size_t { 0 };
+    while (pos < text.size())
+    {
+        // All but the last character of a printable ASCII run are clusters of one column each.
+        auto const run = printableAsciiPrefix(text.substr(pos));
+        if (run > 1)
+        {
+            width += static_cast<int>(run) - 1;
+            pos += run - 1;
+            continue;
+        }
+
+        auto const end = nextGraphemeBoundary(text, pos);
+        width += clusterWidth(text.substr(pos, end - pos));
+        pos = end;
+    }
+    return width;
+}
+
+auto columnPrefixLength(std::string_view text, int columns) -> std::size_t
+{
+    auto remaining = columns;
+    auto pos = std::size_t { 0 };
+    while (pos < text.size() && remaining > 0)
+    {
+        // All but the last character of a printable ASCII run are clusters of one column each.
+        auto const run = printableAsciiPrefix(text.substr(pos));
+        if (run > 1)
+        {
+            auto const taken = std::min(run - 1, static_cast<std::size_t>(remaining));
+            pos += taken;
+            remaining -= static_cast<int>(taken);
+            continue;
+        }
+
+        auto const end = nextGraphemeBoundary(text, pos);
+        auto const width = displayWidth(text.substr(pos, end - pos));
+        if (width > remaining)
+            break;
+        remaining -= width;
+        pos = end;
+    }
+
+    // Zero-width clusters at the end still fit.
+    while (pos < text.size())
+    {
+        auto const end = nextGraphemeBoundary(text, pos);
+        if (displayWidth(text.substr(pos, end - pos)) != 0)
+            break;
+        pos = end;
+    }
+    return pos;
+}
+
+auto nextGraphemeBoundary(std::string_view text, std::size_t pos) -> std::size_t
+{
+    if (pos >= text.size())
+        return pos;
+    if (pos + 1 == text.size() && isAscii(text[pos]))
+        return text.size();
+    if (isAscii(text[pos]) && isAscii(text[pos + 1]))
+        return asciiBoundary(text[pos], text[pos + 1]) ? pos + 1 : pos + 2;
+    return segmentedNext(text, pos);
+}
+
+auto previousGraphemeBoundary(std::string_view text, std::size_t pos) -> std::size_t
+{
+    if (pos == 0)
+        return 0;
+    pos = std::min(pos, text.size());
+
+    // A boundary lies between two ASCII characters other than CR LF. Segment from the nearest one.
+    auto start = pos - 1;
+    while (start > 0 && !(isAscii(text[start - 1]) && isAscii(text[start])
+                          && asciiBoundary(text[start - 1], text[start])))
+        --start;
+
+    auto boundary = start;
+    for (auto next = nextGraphemeBoundary(text, start); next < pos; next = nextGraphemeBoundary(text, next))
+        boundary = next;
+    return boundary;
+}
+
+auto graphemeBoundaries(std::string_view text) -> std::vector<std::size_t>
+{
+    auto boundaries = std::vector<std::size_t> {};
+    boundaries.reserve(text.size() + 1);
+    boundaries.push_back(0);
+    for (auto pos = std::size_t { 0 }; pos < text.size();)
+    {
+        pos = nextGraphemeBoundary(text, pos);
+        boundaries.push_back(pos);
+    }
+    return boundaries;
+}
+
+auto graphemeCount(std::string_view text) -> int
+{
+    auto count = 0;
+    for (auto pos = std::size_t { 0 }; pos < text.size(); ++count)
+    {
+        auto const run = printableAsciiPrefix(text.substr(pos));
+        if (run > 1)
+        {
+            // All but the last character of the run are clusters of their own.
+            count += static_cast<int>(run) - 2;
+            pos += run - 1;
+            continue;
+        }
+        pos = nextGraphemeBoundary(text, pos);
+    }
+    return count;
+}
+
+} // namespace mychat::tui
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mychat::tui
+{
+
+/// @brief Decodes the UTF-8 sequence at @p pos, returning its codepoint and length in bytes.
+///
+/// Malformed bytes decode to U+FFFD one at a time.
+[[nodiscard]] auto decodeUtf8(std::string_view text, std::size_t pos) -> std::pair<char32_t, std::size_t>;
+
+/// @brief Returns the number of columns a codepoint takes on the terminal: 0, 1 or 2.
+///
+/// Control characters, combining marks and joiners take none; East Asian wide characters and
+/// emoji take two.
+[[nodiscard]] auto codepointWidth(char32_t codepoint) -> int;
+
+/// @brief Returns the number of columns a grapheme cluster takes on the terminal: 0, 1 or 2.
+///
+/// A cluster is as wide as its first codepoint, so a ZWJ sequence or an emoji with a skin tone
+/// modifier counts once. Flags (pairs of regional indicators) and clusters with variation
+/// selector 16 show as emoji and take two columns.
+[[nodiscard]] auto clusterWidth(std::string_view cluster) -> int;
+
+/// @brief Returns the length of the run of printable ASCII characters that @p text starts with.
+///
+/// Scans 16 or 32 bytes at a time where SIMD is available. Each such character takes one column
+/// and is a grapheme cluster of its own, unless a combining mark follows it.
+[[nodiscard]] auto printableAsciiPrefix(std::string_view text) noexcept -> std::size_t;
+
+/// @brief Returns the number of columns @p text takes on the terminal.
+///
+/// This is the sum of its grapheme clusters' widths (see clusterWidth()), which is how Screen
+/// lays out text.
+[[nodiscard]] auto displayWidth(std::string_view text) -> int;
+
+/// @brief Returns the length of the longest prefix of whole grapheme clusters that fits @p columns.
+[[nodiscard]] auto columnPrefixLength(std::string_view text, int columns) -> std::size_t;
+
+/// @brief Returns the end of the grapheme cluster starting at byte @p pos.
+///
+/// Returns @p pos if it is at or past the end of @p text.
+[[nodiscard]] auto nextGraphemeBoundary(std::string_view text, std::size_t pos) -> std::size_t;
+
+/// @brief Returns the start of the grapheme cluster ending at byte @p pos.
+///
+/// Returns 0 if @p pos is 0.
+[[nodiscard]] auto previousGraphemeBoundary(std::string_view text, std::size_t pos) -> std::size_t;
+
+/// @brief Returns the byte offsets where @p text's grapheme clusters start, followed by its size.
+[[nodiscard]] auto graphemeBoundaries(std::string_view text) -> std::vector<std::size_t>;
+
+/// @brief Returns the number of grapheme clusters in @p text.
+[[nodiscard]] auto graphemeCount(std::string_view text) -> int;
+
+} // namespace mychat::tui
@@ -1,10 +1,13 @@
 // SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
 #include <charconv>
 #include <cstdint>
 #include <ranges>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include <tui/Unicode.hpp>
 #include <tui/VtParser.hpp>
 
 namespace mychat::tui
@@ -13,6 +16,34 @@ namespace mychat::tui
 namespace
 {
 
+    /// @brief Sequence ending a bracketed paste.
+    constexpr auto PasteEnd = std::string_view { "\033[201~" };
+
+    /// @brief Returns the length of the run of printable text @p data starts with, and the number
+    /// of characters in it.
+    ///
+    /// The run is printable ASCII and complete UTF-8 sequences; a sequence cut off at the end of
+    /// @p data is left to the byte-wise path, which waits for the rest.
+    auto textRun(std::string_view data) -> std::pair<std::size_t, std::size_t>
+    {
+        auto length = std::size_t { 0 };
+        auto characters = std::size_t { 0 };
+        while (length < data.size())
+        {
+            auto const ascii = printableAsciiPrefix(data.substr(length));
+            length += ascii;
+            characters += ascii;
+            if (length == data.size() || static_cast<std::uint8_t>(data[length]) < 0xC0)
+                break;
+            auto const [codepoint, sequenceLength] = decodeUtf8(data, length);
+            if (sequenceLength == 1 || codepoint < 0xA0)
+                break;
+            length += sequenceLength;
+            ++characters;
+        }
+        return { length, characters };
+    }
+
     /// @brief Parses semicolon-separated integer parameters from a CSI parameter string.
     /// @param buf The parameter string (e.g. "0;10;20").
     /// @return Vector of parsed integer values.
@@ -104,21 +135,36 @@ namespace
 auto VtParser::feed(std::string_view data) -> std::vector<InputEvent>
 {
     auto events = std::vector<InputEvent> {};
-    for (auto const ch: data)
+    feed(data, events);
+    return events;
+}
+
+void VtParser::feed(std::string_view data, std::vector<InputEvent>& events)
+{
+    auto pos = std::size_t { 0 };
+    while (pos < data.size())
     {
-        auto const byte = static_cast<std::uint8_t>(ch);
-        switch (_state)
+        if (_state == State::PasteBody)
         {
-            case State::Ground: processGround(byte, events); break;
-            case State::Escape: processEscape(byte, events); break;
-            case State::CsiEntry:
-            case State::CsiParam: processCsi(byte, events); break;
-            case State::Ss3: processSs3(byte, events); break;
-            case State::PasteBody: processPaste(byte, events); break;
-            case State::Utf8Sequence: processUtf8(byte, events); break;
+            pos += processPaste(data.substr(pos), events);
+            continue;
         }
+
+        // Typed text comes as one event per run; a single character stays a key press.
+        if (_state == State::Ground)
+        {
+            auto const [length, characters] = textRun(data.substr(pos));
+            if (characters > 1)
+            {
+                events.emplace_back(TextEvent { .text = std::string(data.substr(pos, length)) });
+                pos += length;
+                continue;
+            }
+        }
+
+        processByte(static_cast<std::uint8_t>(data[pos]), events);
+        ++pos;
     }
-    return events;
 }
 
 auto VtParser::timeout() -> std::vector<InputEvent>
@@ -133,6 +179,20 @@ auto VtParser::timeout() -> std::vector<InputEvent>
     return events;
 }
 
+void VtParser::processByte(std::uint8_t byte, std::vector<InputEvent>& events)
+{
+    switch (_state)
+    {
+        case State::Ground: processGround(byte, events); break;
+        case State::Escape: processEscape(byte, events); break;
+        case State::CsiEntry:
+        case State::CsiParam: processCsi(byte, events); break;
+        case State::Ss3: processSs3(byte, events); break;
+        case State::Utf8Sequence: processUtf8(byte, events); break;
+        case State::PasteBody: break;
+    }
+}
+
 void VtParser::processGround(std::uint8_t byte, std::vector<InputEvent>& events)
 {
     if (byte == 0x1B)
@@ -281,20 +341,41 @@ void VtParser::processSs3(std::uint8_t byte, std::vector<InputEvent>& events)
     }
 }
 
-void VtParser::processPaste(std::uint8_t byte, std::vector<InputEvent>& events)
+auto VtParser::processPaste(std::string_view data, std::vector<InputEvent>& events) -> std::size_t
 {
-    _pasteBuf += static_cast<char>(byte);
-
-    // Check for bracketed paste end: ESC[201~
-    static constexpr auto PasteEnd = std::string_view { "\033[201~" };
-    if (_pasteBuf.size() >= PasteEnd.size() && _pasteBuf.ends_with(PasteEnd))
+    auto pos = std::size_t { 0 };
+    while (pos < data.size())
     {
-        // Remove the end sequence from the paste buffer
-        _pasteBuf.resize(_pasteBuf.size() - PasteEnd.size());
-        events.emplace_back(PasteEvent { .text = std::move(_pasteBuf) });
-        _pasteBuf.clear();
-        _state = State::Ground;
+        // Everything up to the next ESC is pasted text.
+        if (_pasteEndMatched == 0)
+        {
+            auto const escape = std::min(data.find('\033', pos), data.size());
+            _pasteBuf.append(data.substr(pos, escape - pos));
+            pos = escape;
+            if (pos == data.size())
+                break;
+        }
+
+        // Match the end sequence ESC[201~, which may be split across feeds.
+        if (data[pos] != PasteEnd[_pasteEndMatched])
+        {
+            // Not the end after all; ESC only starts the sequence, so the byte is looked at again.
+            _pasteBuf.append(PasteEnd.substr(0, _pasteEndMatched));
+            _pasteEndMatched = 0;
+            continue;
+        }
+
+        ++pos;
+        if (++_pasteEndMatched == PasteEnd.size())
+        {
+            events.emplace_back(PasteEvent { .text = std::move(_pasteBuf) });
+            _pasteBuf.clear();
+            _pasteEndMatched = 0;
+            _state = State::Ground;
+            break;
+        }
     }
+    return pos;
 }
 
 void VtParser::processUtf8(std::uint8_t byte, std::vector<InputEvent>& events)
@@ -384,6 +465,7 @@ void VtParser::dispatchCsi(char finalByte, std::vector<InputEvent>& events)
     if (finalByte == '~' && _paramBuf == "200")
     {
         _pasteBuf.clear();
+        _pasteEndMatched = 0;
         _state = State::PasteBody;
         return;
     }
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
@@ -17,6 +18,10 @@ namespace mychat::tui
 /// Handles CSI sequences, CSIu (Kitty keyboard protocol), SS3 sequences,
 /// SGR mouse reporting, bracketed paste, UTF-8 multi-byte sequences,
 /// and bare ESC disambiguation via timeout().
+///
+/// Text is not taken a byte at a time: runs of printable characters are found with a SIMD scan
+/// and become one TextEvent, and a bracketed paste is copied up to each ESC in one go, so large
+/// pastes parse at about the speed of memchr().
 class VtParser
 {
   public:
@@ -25,6 +30,11 @@ class VtParser
     /// @return Vector of parsed input events.
     [[nodiscard]] auto feed(std::string_view data) -> std::vector<InputEvent>;
 
+    /// @brief Feeds raw bytes and appends the parsed events to @p events.
+    ///
+    /// Lets the caller reuse one vector across reads.
+    void feed(std::string_view data, std::vector<InputEvent>& events);
+
     /// @brief Call after a timeout (e.g. 50ms) with no new data.
     ///
     /// Resolves ambiguous sequences like a bare ESC that could be the start
@@ -32,6 +42,9 @@ class VtParser
     /// @return Vector of resolved events (typically 0 or 1).
     [[nodiscard]] auto timeout() -> std::vector<InputEvent>;
 
+    /// @brief Returns true if a bare ESC waits for timeout() to be resolved.
+    [[nodiscard]] auto hasPendingEscape() const noexcept -> bool { return _state == State::Escape; }
+
   private:
     /// @brief Parser state machine states.
     enum class State : std::uint8_t
@@ -46,10 +59,14 @@ class VtParser
     };
 
     State _state = State::Ground;
-    std::string _paramBuf;  ///< Buffer for CSI parameter bytes.
-    std::string _utf8Buf;   ///< Buffer for UTF-8 multi-byte sequence.
-    std::string _pasteBuf;  ///< Buffer for bracketed paste content.
-    int _utf8Remaining = 0; ///< Expected remaining UTF-8 continuation bytes.
+    std::string _paramBuf;            ///< Buffer for CSI parameter bytes.
+    std::string _utf8Buf;             ///< Buffer for UTF-8 multi-byte sequence.
+    std::string _pasteBuf;            ///< Buffer for bracketed paste content.
+    int _utf8Remaining = 0;           ///< Expected remaining UTF-8 continuation bytes.
+    std::size_t _pasteEndMatched = 0; ///< Bytes of the paste end sequence seen so far.
+
+    /// @brief Processes a single byte in any state but PasteBody.
+    void processByte(std::uint8_t byte, std::vector<InputEvent>& events);
 
     /// @brief Processes a single byte in the Ground state.
     void processGround(std::uint8_t byte, std::vector<InputEvent>& events);
@@ -63,8 +80,9 @@ class VtParser
     /// @brief Processes a single byte in the Ss3 state.
     void processSs3(std::uint8_t byte, std::vector<InputEvent>& events);
 
-    /// @brief Processes a single byte in the PasteBody state.
-    void processPaste(std::uint8_t byte, std::vector<InputEvent>& events);
+    /// @brief Processes bytes in the PasteBody state, up to and including the paste end sequence.
+    /// @return The number of bytes of @p data consumed.
+    auto processPaste(std::string_view data, std::vector<InputEvent>& events) -> std::size_t;
 
     /// @brief Processes a single byte in the Utf8Sequence state.
     void processUtf8(std::uint8_t byte, std::vector<InputEvent>& events);